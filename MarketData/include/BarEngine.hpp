@@ -0,0 +1,867 @@
+#ifndef BARENGINE_HPP
+#define BARENGINE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+#include "libipc/ipc.h"
+#include "MarketTick.hpp"
+#include "InstrumentIndex.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+enum EBarFlag
+{
+    EBAR_FLAG_TRUNCATED = 0x01,     // 交易时段提前结束或暂停，K线结束时间早于周期边界
+    EBAR_FLAG_TIMER = 0x02          // 由Flush到时完成，而非下一周期行情触发
+};
+
+// 已完成K线，时间为当地零点起算纳秒，成交量、成交额为K线内增量
+struct TBar
+{
+    char InstrumentID[TMarketTick::INSTRUMENT_ID_LEN];
+    uint32_t TradingDay;
+    int32_t Period;             // 秒
+    int64_t StartTime;
+    int64_t EndTime;
+    double Open;
+    double High;
+    double Low;
+    double Close;
+    int64_t Volume;
+    double Turnover;
+    double OpenInterest;
+    uint32_t TickCount;
+    uint32_t Flags;
+};
+
+// K线输出，在调用OnTick/Flush/OnSegmentStatus的线程回调
+class BarSink
+{
+public:
+    virtual ~BarSink() {}
+    virtual void OnBar(int slot, int resolution, const TBar& bar) = 0;
+};
+
+// 已完成K线发布到CPP-IPC通道，单写多读(ipc::route)
+class IPCBarPublisher: public BarSink
+{
+public:
+    IPCBarPublisher(): m_SendTimeout(0), m_Published(0), m_Dropped(0)
+    {
+    }
+
+    // sendTimeout为通道满时的最长等待毫秒数，0表示直接丢弃
+    bool Init(const char* channel, uint64_t sendTimeout = 0)
+    {
+        m_Route.reset(new ipc::route(channel, ipc::sender));
+        m_SendTimeout = sendTimeout;
+        return m_Route->valid();
+    }
+
+    // 无接收端时不写入通道，直接计入丢弃
+    virtual void OnBar(int, int, const TBar& bar)
+    {
+        if(m_Route->recv_count() > 0 && m_Route->try_send(&bar, sizeof(bar), m_SendTimeout))
+        {
+            m_Published++;
+        }
+        else
+        {
+            m_Dropped++;
+        }
+    }
+
+    uint64_t GetPublished() const
+    {
+        return m_Published;
+    }
+
+    uint64_t GetDropped() const
+    {
+        return m_Dropped;
+    }
+
+protected:
+    std::unique_ptr<ipc::route> m_Route;
+    uint64_t m_SendTimeout;
+    uint64_t m_Published;
+    uint64_t m_Dropped;
+};
+
+struct TBarEngineStats
+{
+    uint64_t Ticks;
+    uint64_t Bars;
+    uint64_t Late;              // 所属K线已完成或早于当前K线，成交量计入当前或下一根K线
+    uint64_t VolumeResets;      // 累计成交量回退，本条行情增量记为0
+    uint64_t OutOfSession;      // 不在任何交易时段内，不计入K线
+    uint64_t Unregistered;
+};
+
+// 增量K线合成
+// 行情累计成交量、成交额按合约转换为增量，一条行情在一次遍历中更新全部周期的
+// 当前K线。时间统一换算为交易日起点(17:00，与ydUtil.h一致)起算，夜盘跨零点无需
+// 特殊处理；交易日变化时完成全部未完成K线并将累计量基准清零。
+// K线按交易时段对齐：第一根K线从时段开始计，时段结束处截断；时段前的集合竞价
+// 行情并入下一时段第一根K线，时段结束后CloseGrace内的收盘行情并入该时段最后一根
+// K线，其余时段外行情丢弃。未设置交易时段的合约按交易日时间自然对齐。
+// 交易时段可静态配置，并由YD notifyTradingSegmentDetail、MDS市场状态等实时事件
+// 提前结束或恢复。
+// 已完成K线按合约、周期存入结构体数组环形缓冲，各字段分别连续存放，并回调BarSink。
+// 所有接口须在同一线程调用(通常为行情回调线程)。
+class BarEngine
+{
+public:
+    enum
+    {
+        MAX_RESOLUTIONS = 8,
+        MAX_SEGMENTS = 16,
+        NO_SCHEDULE = -1,
+        INVALID_SLOT = TradeUtil::InstrumentIndex::INVALID_SLOT
+    };
+
+    BarEngine(): m_Index(NULL), m_States(NULL), m_ResolutionCount(0), m_RingSize(0), m_RingCount(NULL),
+        m_Sink(NULL), m_CountInitialVolume(false), m_CloseGrace(3000000000LL), m_FlushDelay(0)
+    {
+        memset(m_Periods, 0, sizeof(m_Periods));
+        memset(&m_Ring, 0, sizeof(m_Ring));
+        memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+
+    ~BarEngine()
+    {
+        Release();
+    }
+
+    // periods为各周期秒数，ringSize为每合约每周期保留的已完成K线数；
+    // countInitialVolume为false时合约首条行情只作为累计量基准，适用于盘中启动
+    bool Init(int capacity, const int* periods, int resolutionCount, int ringSize, BarSink* sink, bool countInitialVolume = false)
+    {
+        if(capacity <= 0 || resolutionCount <= 0 || resolutionCount > MAX_RESOLUTIONS || ringSize <= 0)
+        {
+            return false;
+        }
+        for(int i = 0; i < resolutionCount; i++)
+        {
+            if(periods[i] <= 0)
+            {
+                return false;
+            }
+            m_Periods[i] = periods[i];
+            m_PeriodNs[i] = periods[i] * 1000000000LL;
+        }
+        m_ResolutionCount = resolutionCount;
+        m_RingSize = ringSize;
+        m_Sink = sink;
+        m_CountInitialVolume = countInitialVolume;
+        // 重复Init时释放上次分配的索引与K线缓冲，已注册合约随之清空
+        Release();
+        m_Index = new TradeUtil::InstrumentIndex(capacity);
+        if(posix_memalign((void**)&m_States, 64, sizeof(TInstrumentState) * capacity) != 0)
+        {
+            m_States = NULL;
+            return false;
+        }
+        memset(m_States, 0, sizeof(TInstrumentState) * capacity);
+        size_t rings = (size_t)capacity * resolutionCount;
+        size_t bars = rings * ringSize;
+        m_RingCount = (uint64_t*)calloc(rings, sizeof(uint64_t));
+        bool ret = m_RingCount != NULL;
+        ret = Allocate(m_Ring.Start, bars) && ret;
+        ret = Allocate(m_Ring.End, bars) && ret;
+        ret = Allocate(m_Ring.Open, bars) && ret;
+        ret = Allocate(m_Ring.High, bars) && ret;
+        ret = Allocate(m_Ring.Low, bars) && ret;
+        ret = Allocate(m_Ring.Close, bars) && ret;
+        ret = Allocate(m_Ring.Volume, bars) && ret;
+        ret = Allocate(m_Ring.Turnover, bars) && ret;
+        ret = Allocate(m_Ring.OpenInterest, bars) && ret;
+        ret = Allocate(m_Ring.TickCount, bars) && ret;
+        ret = Allocate(m_Ring.TradingDay, bars) && ret;
+        ret = Allocate(m_Ring.Flags, bars) && ret;
+        return ret;
+    }
+
+    // 收盘后迟到行情并入最后一根K线的时限，默认3秒
+    void SetCloseGrace(int64_t graceNs)
+    {
+        m_CloseGrace = graceNs;
+    }
+
+    // Flush在K线结束时间之后再等待的时长，用于容忍行情延迟
+    void SetFlushDelay(int64_t delayNs)
+    {
+        m_FlushDelay = delayNs;
+    }
+
+    // 交易时段表，同一品种或交易所的合约共用
+    int AddSchedule()
+    {
+        TSchedule schedule;
+        memset(&schedule, 0, sizeof(schedule));
+        m_Schedules.push_back(schedule);
+        return (int)m_Schedules.size() - 1;
+    }
+
+    // 时段为"HH:MM:SS"当地时间，夜盘可跨零点如"21:00:00"~"02:30:00"，时段间不能重叠
+    bool AddSegment(int schedule, const char* start, const char* end)
+    {
+        if(schedule < 0 || schedule >= (int)m_Schedules.size())
+        {
+            return false;
+        }
+        TSegment segment;
+        segment.Start = ToTradingTime(ParseTimeOfDay(start));
+        segment.End = ToTradingTime(ParseTimeOfDay(end));
+        if(segment.End == 0)
+        {
+            // 17:00结束的时段
+            segment.End = NANOS_PER_DAY;
+        }
+        segment.ConfigEnd = segment.End;
+        if(segment.End <= segment.Start)
+        {
+            return false;
+        }
+        TSchedule& config = m_Schedules[schedule];
+        if(!InsertSegment(config.Config, config.ConfigCount, segment))
+        {
+            return false;
+        }
+        memcpy(config.Segments, config.Config, sizeof(config.Config));
+        config.Count = config.ConfigCount;
+        return true;
+    }
+
+    // 恢复全部交易时段为静态配置，须在交易日开始前调用
+    void ResetSchedules()
+    {
+        for(size_t i = 0; i < m_Schedules.size(); i++)
+        {
+            memcpy(m_Schedules[i].Segments, m_Schedules[i].Config, sizeof(m_Schedules[i].Config));
+            m_Schedules[i].Count = m_Schedules[i].ConfigCount;
+        }
+    }
+
+    // 须在收到行情前注册，热路径应缓存返回的序号
+    int RegisterInstrument(const char* instrumentID, int schedule = NO_SCHEDULE)
+    {
+        if(schedule >= (int)m_Schedules.size())
+        {
+            return INVALID_SLOT;
+        }
+        int slot = m_Index->Register(instrumentID);
+        if(slot != INVALID_SLOT)
+        {
+            TInstrumentState& state = m_States[slot];
+            strncpy(state.InstrumentID, instrumentID, sizeof(state.InstrumentID) - 1);
+            state.Schedule = schedule;
+            for(int r = 0; r < MAX_RESOLUTIONS; r++)
+            {
+                state.LastStart[r] = -1;
+            }
+        }
+        return slot;
+    }
+
+    int FindInstrument(const char* instrumentID) const
+    {
+        return m_Index->Find(instrumentID);
+    }
+
+    void OnTick(const TMarketTick& tick)
+    {
+        int slot = m_Index->Find(tick.InstrumentID);
+        if(slot == INVALID_SLOT)
+        {
+            m_Stats.Unregistered++;
+            return;
+        }
+        OnTick(slot, tick);
+    }
+
+    void OnTick(int slot, const TMarketTick& tick)
+    {
+        TInstrumentState& state = m_States[slot];
+        m_Stats.Ticks++;
+        if(tick.TradingDay != state.TradingDay)
+        {
+            if(state.TradingDay != 0)
+            {
+                // 新交易日累计量从0开始
+                CompleteAll(slot, 0);
+                state.LastVolume = 0;
+                state.LastTurnover = 0;
+                for(int r = 0; r < m_ResolutionCount; r++)
+                {
+                    state.LastStart[r] = -1;
+                    state.CarryVolume[r] = 0;
+                    state.CarryTurnover[r] = 0;
+                }
+            }
+            else if(!m_CountInitialVolume)
+            {
+                state.LastVolume = tick.Volume;
+                state.LastTurnover = tick.Turnover;
+            }
+            state.TradingDay = tick.TradingDay;
+        }
+        int64_t volume = tick.Volume - state.LastVolume;
+        double turnover = tick.Turnover - state.LastTurnover;
+        if(volume < 0)
+        {
+            m_Stats.VolumeResets++;
+            volume = 0;
+            turnover = 0;
+        }
+        if(turnover < 0)
+        {
+            turnover = 0;
+        }
+        state.LastVolume = tick.Volume;
+        state.LastTurnover = tick.Turnover;
+
+        int64_t time = ToTradingTime(tick.ExchangeTime);
+        const TSegment* segment = NULL;
+        if(state.Schedule != NO_SCHEDULE && !Locate(m_Schedules[state.Schedule], time, segment))
+        {
+            m_Stats.OutOfSession++;
+            return;
+        }
+        bool late = false;
+        for(int r = 0; r < m_ResolutionCount; r++)
+        {
+            int64_t start;
+            int64_t end;
+            GetBarRange(r, segment, time, start, end);
+            if(state.IsOpen[r] && start == state.Start[r])
+            {
+                UpdateBar(state, r, tick, volume, turnover);
+            }
+            else if(state.IsOpen[r] && start < state.Start[r])
+            {
+                // 早于当前K线，只计成交量
+                late = true;
+                state.Volume[r] += volume;
+                state.Turnover[r] += turnover;
+            }
+            else if(start <= state.LastStart[r])
+            {
+                // 所属K线已由Flush完成，成交量计入下一根K线
+                late = true;
+                state.CarryVolume[r] += volume;
+                state.CarryTurnover[r] += turnover;
+            }
+            else
+            {
+                if(state.IsOpen[r])
+                {
+                    Complete(slot, r, 0);
+                }
+                OpenBar(state, r, tick, start, end, volume, turnover);
+            }
+        }
+        m_Stats.Late += late ? 1 : 0;
+    }
+
+    // 完成结束时间早于now(当地零点起算纳秒)的K线，应定时调用以及时输出不活跃合约的K线
+    void Flush(int64_t now)
+    {
+        int64_t time = ToTradingTime(now);
+        int count = m_Index->Size();
+        for(int slot = 0; slot < count; slot++)
+        {
+            TInstrumentState& state = m_States[slot];
+            for(int r = 0; r < m_ResolutionCount; r++)
+            {
+                if(state.IsOpen[r] && state.Start[r] < time && state.End[r] + m_FlushDelay <= time)
+                {
+                    Complete(slot, r, EBAR_FLAG_TIMER);
+                }
+            }
+        }
+    }
+
+    // 实时交易状态，now为当地零点起算纳秒
+    // 停止交易时截断所在时段并完成相关K线；恢复交易时若不在任何时段内则新增时段，
+    // 直到原时段结束或下一时段开始
+    void OnSegmentStatus(int schedule, int64_t now, bool trading)
+    {
+        if(schedule < 0 || schedule >= (int)m_Schedules.size())
+        {
+            return;
+        }
+        TSchedule& config = m_Schedules[schedule];
+        int64_t time = ToTradingTime(now);
+        if(!trading)
+        {
+            for(int i = 0; i < config.Count; i++)
+            {
+                if(config.Segments[i].Start <= time && time < config.Segments[i].End)
+                {
+                    config.Segments[i].End = time;
+                }
+            }
+            int count = m_Index->Size();
+            for(int slot = 0; slot < count; slot++)
+            {
+                TInstrumentState& state = m_States[slot];
+                if(state.Schedule != schedule)
+                {
+                    continue;
+                }
+                for(int r = 0; r < m_ResolutionCount; r++)
+                {
+                    if(state.IsOpen[r] && state.Start[r] < time)
+                    {
+                        uint32_t flags = 0;
+                        if(state.End[r] > time)
+                        {
+                            state.End[r] = time;
+                            flags = EBAR_FLAG_TRUNCATED;
+                        }
+                        Complete(slot, r, flags);
+                    }
+                }
+            }
+            return;
+        }
+        for(int i = 0; i < config.Count; i++)
+        {
+            if(config.Segments[i].Start <= time && time < config.Segments[i].End)
+            {
+                return;
+            }
+        }
+        TSegment segment;
+        segment.Start = time;
+        segment.End = NANOS_PER_DAY;
+        for(int i = 0; i < config.Count; i++)
+        {
+            const TSegment& current = config.Segments[i];
+            if(current.Start > time)
+            {
+                segment.End = current.Start;
+                break;
+            }
+            if(current.End <= time && time < current.ConfigEnd)
+            {
+                segment.End = current.ConfigEnd;
+            }
+        }
+        segment.ConfigEnd = segment.End;
+        InsertSegment(config.Segments, config.Count, segment);
+    }
+
+#ifdef YD_DATA_STRUCT_H
+    // YD notifyTradingSegmentDetail，SegmentTime为START_HOUR起算秒数
+    void OnSegmentStatus(int schedule, const YDTradingSegmentDetail& detail)
+    {
+        OnSegmentStatus(schedule, FromTradingTime(detail.SegmentTime * 1000000000LL), detail.TradingStatus != YD_TS_NoTrading);
+    }
+#endif
+
+#ifdef _MDS_BASE_MODEL_H
+    // MDS市场状态，TradingSessionID首字符'T'为交易期间(含午间休市，休市由静态时段处理)，'E'为闭市
+    void OnSegmentStatus(int schedule, const MdsTradingSessionStatusMsgT& status)
+    {
+        int32_t time = status.updateTime;
+        int64_t now = ((time / 10000000 * 60 + time / 100000 % 100) * 60 + time / 1000 % 100) * 1000000000LL +
+                      time % 1000 * 1000000LL;
+        if(status.TradingSessionID[0] == 'T')
+        {
+            OnSegmentStatus(schedule, now, true);
+        }
+        else if(status.TradingSessionID[0] == 'E')
+        {
+            OnSegmentStatus(schedule, now, false);
+        }
+    }
+#endif
+
+    // 已保存的已完成K线数
+    int GetBarCount(int slot, int resolution) const
+    {
+        uint64_t count = m_RingCount[(size_t)slot * m_ResolutionCount + resolution];
+        return count < (uint64_t)m_RingSize ? (int)count : m_RingSize;
+    }
+
+    // ago为0表示最近一根已完成K线
+    bool GetBar(int slot, int resolution, int ago, TBar& bar) const
+    {
+        if(ago < 0 || ago >= GetBarCount(slot, resolution))
+        {
+            return false;
+        }
+        uint64_t index = m_RingCount[(size_t)slot * m_ResolutionCount + resolution] - 1 - ago;
+        size_t pos = ((size_t)slot * m_ResolutionCount + resolution) * m_RingSize + index % m_RingSize;
+        memcpy(bar.InstrumentID, m_States[slot].InstrumentID, sizeof(bar.InstrumentID));
+        bar.TradingDay = m_Ring.TradingDay[pos];
+        bar.Period = m_Periods[resolution];
+        bar.StartTime = FromTradingTime(m_Ring.Start[pos]);
+        bar.EndTime = FromTradingTime(m_Ring.End[pos]);
+        bar.Open = m_Ring.Open[pos];
+        bar.High = m_Ring.High[pos];
+        bar.Low = m_Ring.Low[pos];
+        bar.Close = m_Ring.Close[pos];
+        bar.Volume = m_Ring.Volume[pos];
+        bar.Turnover = m_Ring.Turnover[pos];
+        bar.OpenInterest = m_Ring.OpenInterest[pos];
+        bar.TickCount = m_Ring.TickCount[pos];
+        bar.Flags = m_Ring.Flags[pos];
+        return true;
+    }
+
+    // 按时间先后复制最近count根K线，返回实际条数
+    int CopyBars(int slot, int resolution, int count, TBar* bars) const
+    {
+        int n = GetBarCount(slot, resolution);
+        if(count > n)
+        {
+            count = n;
+        }
+        for(int i = 0; i < count; i++)
+        {
+            GetBar(slot, resolution, count - 1 - i, bars[i]);
+        }
+        return count;
+    }
+
+    // 收盘价序列，供批量计算指标；written为已写入总数，最新一根位于(written - 1) % RingSize
+    const double* GetCloseSeries(int slot, int resolution, uint64_t& written) const
+    {
+        written = m_RingCount[(size_t)slot * m_ResolutionCount + resolution];
+        return m_Ring.Close + ((size_t)slot * m_ResolutionCount + resolution) * m_RingSize;
+    }
+
+    // 当前未完成K线
+    bool GetCurrentBar(int slot, int resolution, TBar& bar) const
+    {
+        const TInstrumentState& state = m_States[slot];
+        if(!state.IsOpen[resolution])
+        {
+            return false;
+        }
+        FillBar(state, resolution, 0, bar);
+        return true;
+    }
+
+    int GetResolutionCount() const
+    {
+        return m_ResolutionCount;
+    }
+
+    void GetStats(TBarEngineStats& stats) const
+    {
+        stats = m_Stats;
+    }
+
+protected:
+    struct TSegment
+    {
+        int64_t Start;          // 交易日起点起算纳秒
+        int64_t End;
+        int64_t ConfigEnd;      // 截断前的结束时间
+    };
+
+    struct TSchedule
+    {
+        TSegment Config[MAX_SEGMENTS];
+        TSegment Segments[MAX_SEGMENTS];
+        int ConfigCount;
+        int Count;
+    };
+
+    // 各周期当前K线按字段分数组存放
+    struct alignas(64) TInstrumentState
+    {
+        int64_t Start[MAX_RESOLUTIONS];
+        int64_t End[MAX_RESOLUTIONS];
+        double Open[MAX_RESOLUTIONS];
+        double High[MAX_RESOLUTIONS];
+        double Low[MAX_RESOLUTIONS];
+        double Close[MAX_RESOLUTIONS];
+        int64_t Volume[MAX_RESOLUTIONS];
+        double Turnover[MAX_RESOLUTIONS];
+        double OpenInterest[MAX_RESOLUTIONS];
+        uint32_t TickCount[MAX_RESOLUTIONS];
+        bool IsOpen[MAX_RESOLUTIONS];
+        int64_t LastStart[MAX_RESOLUTIONS];     // 最近完成K线的开始时间
+        int64_t CarryVolume[MAX_RESOLUTIONS];
+        double CarryTurnover[MAX_RESOLUTIONS];
+        int64_t LastVolume;
+        double LastTurnover;
+        double LastPrice;
+        uint32_t TradingDay;
+        int32_t Schedule;
+        char InstrumentID[TMarketTick::INSTRUMENT_ID_LEN];
+    };
+
+    struct TBarRing
+    {
+        int64_t* Start;
+        int64_t* End;
+        double* Open;
+        double* High;
+        double* Low;
+        double* Close;
+        int64_t* Volume;
+        double* Turnover;
+        double* OpenInterest;
+        uint32_t* TickCount;
+        uint32_t* TradingDay;
+        uint32_t* Flags;
+    };
+
+    template <typename T>
+    static bool Allocate(T*& field, size_t count)
+    {
+        if(posix_memalign((void**)&field, 64, sizeof(T) * count) != 0)
+        {
+            field = NULL;
+            return false;
+        }
+        memset(field, 0, sizeof(T) * count);
+        return true;
+    }
+
+    void Release()
+    {
+        delete m_Index;
+        m_Index = NULL;
+        free(m_States);
+        m_States = NULL;
+        free(m_RingCount);
+        m_RingCount = NULL;
+        free(m_Ring.Start);
+        free(m_Ring.End);
+        free(m_Ring.Open);
+        free(m_Ring.High);
+        free(m_Ring.Low);
+        free(m_Ring.Close);
+        free(m_Ring.Volume);
+        free(m_Ring.Turnover);
+        free(m_Ring.OpenInterest);
+        free(m_Ring.TickCount);
+        free(m_Ring.TradingDay);
+        free(m_Ring.Flags);
+        memset(&m_Ring, 0, sizeof(m_Ring));
+    }
+
+    static bool InsertSegment(TSegment* segments, int& count, const TSegment& segment)
+    {
+        if(count >= MAX_SEGMENTS)
+        {
+            return false;
+        }
+        int pos = 0;
+        while(pos < count && segments[pos].Start < segment.Start)
+        {
+            pos++;
+        }
+        if((pos > 0 && segments[pos - 1].End > segment.Start) || (pos < count && segment.End > segments[pos].Start))
+        {
+            return false;
+        }
+        memmove(&segments[pos + 1], &segments[pos], sizeof(TSegment) * (count - pos));
+        segments[pos] = segment;
+        count++;
+        return true;
+    }
+
+    // 确定行情所属时段，time可能被调整到时段边界，跳过已被截断为空的时段
+    force_inline inline bool Locate(const TSchedule& schedule, int64_t& time, const TSegment*& segment) const
+    {
+        const TSegment* previous = NULL;
+        for(int i = 0; i < schedule.Count; i++)
+        {
+            const TSegment& current = schedule.Segments[i];
+            if(current.End <= current.Start)
+            {
+                continue;
+            }
+            if(time < current.Start)
+            {
+                if(previous != NULL && time - previous->End <= m_CloseGrace)
+                {
+                    segment = previous;
+                    time = previous->End;
+                }
+                else
+                {
+                    segment = &current;
+                    time = current.Start;
+                }
+                return true;
+            }
+            if(time <= current.End)
+            {
+                segment = &current;
+                return true;
+            }
+            previous = &current;
+        }
+        if(previous != NULL && time - previous->End <= m_CloseGrace)
+        {
+            segment = previous;
+            time = previous->End;
+            return true;
+        }
+        return false;
+    }
+
+    force_inline inline void GetBarRange(int r, const TSegment* segment, int64_t time, int64_t& start, int64_t& end) const
+    {
+        int64_t period = m_PeriodNs[r];
+        if(segment == NULL)
+        {
+            start = time / period * period;
+            end = start + period;
+            return;
+        }
+        int64_t index = (time - segment->Start) / period;
+        start = segment->Start + index * period;
+        // 时段结束时刻的行情属于最后一根K线
+        if(start >= segment->End && index > 0)
+        {
+            start -= period;
+        }
+        end = start + period < segment->End ? start + period : segment->End;
+    }
+
+    force_inline inline void OpenBar(TInstrumentState& state, int r, const TMarketTick& tick, int64_t start, int64_t end,
+                                     int64_t volume, double turnover)
+    {
+        double price = tick.LastPrice > 0 ? tick.LastPrice : state.LastPrice;
+        state.Start[r] = start;
+        state.End[r] = end;
+        state.Open[r] = price;
+        state.High[r] = price;
+        state.Low[r] = price;
+        state.Close[r] = price;
+        state.Volume[r] = volume + state.CarryVolume[r];
+        state.Turnover[r] = turnover + state.CarryTurnover[r];
+        state.OpenInterest[r] = tick.OpenInterest;
+        state.TickCount[r] = 1;
+        state.IsOpen[r] = true;
+        state.CarryVolume[r] = 0;
+        state.CarryTurnover[r] = 0;
+        if(tick.LastPrice > 0)
+        {
+            state.LastPrice = tick.LastPrice;
+        }
+    }
+
+    force_inline inline void UpdateBar(TInstrumentState& state, int r, const TMarketTick& tick, int64_t volume, double turnover)
+    {
+        double price = tick.LastPrice;
+        if(price > 0)
+        {
+            // 开盘前无成交价时以首个成交价作为开盘价
+            if(state.Open[r] <= 0)
+            {
+                state.Open[r] = price;
+                state.High[r] = price;
+                state.Low[r] = price;
+            }
+            state.High[r] = price > state.High[r] ? price : state.High[r];
+            state.Low[r] = price < state.Low[r] ? price : state.Low[r];
+            state.Close[r] = price;
+            state.LastPrice = price;
+        }
+        state.Volume[r] += volume;
+        state.Turnover[r] += turnover;
+        state.OpenInterest[r] = tick.OpenInterest;
+        state.TickCount[r]++;
+    }
+
+    void FillBar(const TInstrumentState& state, int r, uint32_t flags, TBar& bar) const
+    {
+        memcpy(bar.InstrumentID, state.InstrumentID, sizeof(bar.InstrumentID));
+        bar.TradingDay = state.TradingDay;
+        bar.Period = m_Periods[r];
+        bar.StartTime = FromTradingTime(state.Start[r]);
+        bar.EndTime = FromTradingTime(state.End[r]);
+        bar.Open = state.Open[r];
+        bar.High = state.High[r];
+        bar.Low = state.Low[r];
+        bar.Close = state.Close[r];
+        bar.Volume = state.Volume[r];
+        bar.Turnover = state.Turnover[r];
+        bar.OpenInterest = state.OpenInterest[r];
+        bar.TickCount = state.TickCount[r];
+        bar.Flags = flags;
+    }
+
+    void Complete(int slot, int r, uint32_t flags)
+    {
+        TInstrumentState& state = m_States[slot];
+        size_t ring = (size_t)slot * m_ResolutionCount + r;
+        size_t pos = ring * m_RingSize + m_RingCount[ring] % m_RingSize;
+        m_RingCount[ring]++;
+        m_Ring.Start[pos] = state.Start[r];
+        m_Ring.End[pos] = state.End[r];
+        m_Ring.Open[pos] = state.Open[r];
+        m_Ring.High[pos] = state.High[r];
+        m_Ring.Low[pos] = state.Low[r];
+        m_Ring.Close[pos] = state.Close[r];
+        m_Ring.Volume[pos] = state.Volume[r];
+        m_Ring.Turnover[pos] = state.Turnover[r];
+        m_Ring.OpenInterest[pos] = state.OpenInterest[r];
+        m_Ring.TickCount[pos] = state.TickCount[r];
+        m_Ring.TradingDay[pos] = state.TradingDay;
+        m_Ring.Flags[pos] = flags;
+        state.IsOpen[r] = false;
+        state.LastStart[r] = state.Start[r];
+        m_Stats.Bars++;
+        if(m_Sink != NULL)
+        {
+            TBar bar;
+            FillBar(state, r, flags, bar);
+            m_Sink->OnBar(slot, r, bar);
+        }
+    }
+
+    void CompleteAll(int slot, uint32_t flags)
+    {
+        for(int r = 0; r < m_ResolutionCount; r++)
+        {
+            if(m_States[slot].IsOpen[r])
+            {
+                Complete(slot, r, flags);
+            }
+        }
+    }
+
+private:
+    BarEngine(const BarEngine&);
+    BarEngine& operator=(const BarEngine&);
+private:
+    TradeUtil::InstrumentIndex* m_Index;
+    TInstrumentState* m_States;
+    int m_Periods[MAX_RESOLUTIONS];
+    int64_t m_PeriodNs[MAX_RESOLUTIONS];
+    int m_ResolutionCount;
+    int m_RingSize;
+    uint64_t* m_RingCount;      // 每合约每周期已写入K线总数
+    TBarRing m_Ring;
+    std::vector<TSchedule> m_Schedules;
+    BarSink* m_Sink;
+    bool m_CountInitialVolume;
+    int64_t m_CloseGrace;
+    int64_t m_FlushDelay;
+    TBarEngineStats m_Stats;
+};
+
+}
+
+#endif // BARENGINE_HPP
@@ -0,0 +1,479 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <vector>
+#include "ThostFtdcUserApiStruct.h"
+#include "xquote_api_struct.h"
+#include "ydDataStruct.h"
+#include "mds_global/mds_base_model.h"
+#include "BarEngine.hpp"
+#include "HRTimer.hpp"
+
+struct TCollectSink: public MarketData::BarSink
+{
+    virtual void OnBar(int slot, int resolution, const MarketData::TBar& bar)
+    {
+        Slots.push_back(slot);
+        Resolutions.push_back(resolution);
+        Bars.push_back(bar);
+    }
+
+    int Count(int slot, int resolution) const
+    {
+        int n = 0;
+        for(size_t i = 0; i < Bars.size(); i++)
+        {
+            n += (Slots[i] == slot && Resolutions[i] == resolution) ? 1 : 0;
+        }
+        return n;
+    }
+
+    void Clear()
+    {
+        Slots.clear();
+        Resolutions.clear();
+        Bars.clear();
+    }
+
+    std::vector<int> Slots;
+    std::vector<int> Resolutions;
+    std::vector<MarketData::TBar> Bars;
+};
+
+static int64_t T(const char* hhmmss, int millisec = 0)
+{
+    return MarketData::ParseTimeOfDay(hhmmss, millisec);
+}
+
+static void MakeTick(MarketData::TMarketTick& tick, const char* instrumentID, uint32_t tradingDay, int64_t time,
+                     double price, int64_t volume)
+{
+    memset(&tick, 0, sizeof(tick));
+    strncpy(tick.InstrumentID, instrumentID, sizeof(tick.InstrumentID) - 1);
+    tick.TradingDay = tradingDay;
+    tick.ExchangeTime = time;
+    tick.LastPrice = price;
+    tick.Volume = volume;
+    tick.Turnover = volume * 10.0;
+    tick.OpenInterest = 1000;
+}
+
+static void TestTickAdapter()
+{
+    MarketData::TMarketTick tick;
+    CThostFtdcDepthMarketDataField ctp;
+    memset(&ctp, 0, sizeof(ctp));
+    strcpy(ctp.InstrumentID, "rb2410");
+    strcpy(ctp.ExchangeID, "SHFE");
+    strcpy(ctp.TradingDay, "20240603");
+    strcpy(ctp.ActionDay, "20240531");
+    strcpy(ctp.UpdateTime, "21:00:01");
+    ctp.UpdateMillisec = 500;
+    ctp.LastPrice = 3600;
+    ctp.Volume = 120;
+    ctp.Turnover = 4320000;
+    ctp.BidPrice1 = 3599;
+    ctp.AskPrice1 = 3601;
+    ctp.BidPrice2 = 1.7976931348623157e308;
+    ctp.BidVolume1 = 5;
+    ctp.AskVolume5 = 9;
+    ctp.SettlementPrice = 1.7976931348623157e308;
+    MarketData::TickAdapter::Convert(ctp, tick);
+    assert(strcmp(tick.InstrumentID, "rb2410") == 0);
+    assert(strcmp(tick.ExchangeID, "SHFE") == 0);
+    assert(tick.TradingDay == 20240603 && tick.ActionDay == 20240531);
+    assert(tick.ExchangeTime == T("21:00:01", 500));
+    assert(tick.DepthLevels == 5);
+    assert(tick.Volume == 120 && tick.BidPrice[0] == 3599 && tick.AskPrice[0] == 3601);
+    assert(tick.BidPrice[1] == 0 && tick.BidVolume[0] == 5 && tick.AskVolume[4] == 9);
+
+    XTPMarketDataStruct xtp;
+    memset(&xtp, 0, sizeof(xtp));
+    xtp.exchange_id = XTP_EXCHANGE_SH;
+    strcpy(xtp.ticker, "600000");
+    xtp.data_time = 20240603093000120LL;
+    xtp.last_price = 7.15;
+    xtp.qty = 10000;
+    xtp.turnover = 71500;
+    for(int i = 0; i < 10; i++)
+    {
+        xtp.bid[i] = 7.14 - i * 0.01;
+        xtp.ask[i] = 7.15 + i * 0.01;
+        xtp.bid_qty[i] = 100 * (i + 1);
+        xtp.ask_qty[i] = 200 * (i + 1);
+    }
+    MarketData::TickAdapter::Convert(xtp, tick);
+    assert(strcmp(tick.InstrumentID, "600000") == 0 && strcmp(tick.ExchangeID, "SSE") == 0);
+    assert(tick.TradingDay == 20240603 && tick.ExchangeTime == T("09:30:00", 120));
+    assert(tick.DepthLevels == 10 && tick.BidVolume[9] == 1000 && tick.AskPrice[9] == xtp.ask[9]);
+
+    YDExchange exchange;
+    memset(&exchange, 0, sizeof(exchange));
+    strcpy(exchange.ExchangeID, "DCE");
+    YDInstrument instrument;
+    memset(&instrument, 0, sizeof(instrument));
+    strcpy(instrument.InstrumentID, "m2409");
+    instrument.m_pExchange = &exchange;
+    YDMarketData yd;
+    memset(&yd, 0, sizeof(yd));
+    yd.m_pInstrument = &instrument;
+    yd.TradingDay = 20240603;
+    yd.LastPrice = 3300;
+    yd.Volume = 50;
+    // 21:00:00.250为17:00起算4小时
+    yd.TimeStamp = 4 * 3600 * 1000 + 250;
+    MarketData::TickAdapter::Convert(yd, tick);
+    assert(strcmp(tick.InstrumentID, "m2409") == 0 && strcmp(tick.ExchangeID, "DCE") == 0);
+    assert(tick.ExchangeTime == T("21:00:00", 250) && tick.Volume == 50 && tick.DepthLevels == 1);
+    // 跨零点
+    yd.TimeStamp = 8 * 3600 * 1000;
+    MarketData::TickAdapter::Convert(yd, tick);
+    assert(tick.ExchangeTime == T("01:00:00"));
+}
+
+// 夜盘跨零点，逐笔对照简单分桶结果
+static void TestNightSession()
+{
+    const int periods[] = {1, 60, 300};
+    TCollectSink sink;
+    MarketData::BarEngine engine;
+    assert(engine.Init(16, periods, 3, 512, &sink, true));
+    int schedule = engine.AddSchedule();
+    assert(engine.AddSegment(schedule, "21:00:00", "02:30:00"));
+    assert(!engine.AddSegment(schedule, "02:00:00", "03:00:00"));
+    int slot = engine.RegisterInstrument("au2408", schedule);
+    assert(slot == 0);
+
+    // 21:00~02:30共330分钟，集合竞价并入第一根，收盘行情并入最后一根
+    const int minutes = 330;
+    std::vector<double> open(minutes, 0), high(minutes, 0), low(minutes, 1e9), close(minutes, 0);
+    std::vector<int64_t> volume(minutes, 0);
+    MarketData::TMarketTick tick;
+    int64_t cumVolume = 0;
+    unsigned seed = 7;
+    const int64_t sessionStart = MarketData::ToTradingTime(T("21:00:00"));
+    // 20:59:00竞价，之后每500毫秒一笔直到02:30:00.500
+    std::vector<int64_t> times;
+    times.push_back(T("20:59:00"));
+    for(int64_t t = sessionStart; t <= sessionStart + minutes * 60000000000LL + 500000000LL; t += 500000000LL)
+    {
+        times.push_back(MarketData::FromTradingTime(t));
+    }
+    for(size_t i = 0; i < times.size(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        double price = 500 + (seed >> 16) % 100 * 0.02;
+        int64_t delta = (seed >> 8) % 7;
+        cumVolume += delta;
+        MakeTick(tick, "au2408", 20240603, times[i], price, cumVolume);
+        engine.OnTick(tick);
+        int64_t offset = MarketData::ToTradingTime(times[i]) - sessionStart;
+        int m = offset < 0 ? 0 : (int)(offset / 60000000000LL);
+        m = m >= minutes ? minutes - 1 : m;
+        if(open[m] == 0)
+        {
+            open[m] = price;
+        }
+        high[m] = price > high[m] ? price : high[m];
+        low[m] = price < low[m] ? price : low[m];
+        close[m] = price;
+        volume[m] += delta;
+    }
+    // 时段外
+    MakeTick(tick, "au2408", 20240603, T("03:00:00"), 600, cumVolume + 100);
+    engine.OnTick(tick);
+    MarketData::TBarEngineStats stats;
+    engine.GetStats(stats);
+    assert(stats.OutOfSession == 1 && stats.Late == 0 && stats.Unregistered == 0);
+    // 夜盘最后一根K线由Flush完成
+    engine.Flush(T("02:29:30"));
+    assert(sink.Count(slot, 1) == minutes - 1);
+    engine.Flush(T("02:35:00"));
+    assert(sink.Count(slot, 1) == minutes);
+    assert(sink.Count(slot, 2) == minutes / 5);
+    assert(sink.Count(slot, 0) == minutes * 60);
+
+    int64_t total[3] = {0, 0, 0};
+    int minute = 0;
+    for(size_t i = 0; i < sink.Bars.size(); i++)
+    {
+        const MarketData::TBar& bar = sink.Bars[i];
+        int r = sink.Resolutions[i];
+        total[r] += bar.Volume;
+        assert(bar.TradingDay == 20240603 && strcmp(bar.InstrumentID, "au2408") == 0);
+        assert(bar.Period == periods[r]);
+        if(r != 1)
+        {
+            continue;
+        }
+        assert(bar.StartTime == MarketData::FromTradingTime(sessionStart + minute * 60000000000LL));
+        assert(bar.EndTime == MarketData::FromTradingTime(sessionStart + (minute + 1) * 60000000000LL));
+        assert(bar.Open == open[minute] && bar.High == high[minute] && bar.Low == low[minute]);
+        assert(bar.Close == close[minute] && bar.Volume == volume[minute]);
+        assert(bar.Turnover == volume[minute] * 10.0);
+        assert(bar.Flags == (minute == minutes - 1 ? (uint32_t)MarketData::EBAR_FLAG_TIMER : 0u));
+        minute++;
+    }
+    assert(total[0] == cumVolume && total[1] == cumVolume && total[2] == cumVolume);
+    // 第一根K线含竞价行情，收盘行情在02:29 K线
+    MarketData::TBar bar;
+    MarketData::TBar bars[4];
+    assert(engine.GetBarCount(slot, 1) == minutes);
+    assert(engine.GetBar(slot, 1, 0, bar) && bar.StartTime == T("02:29:00") && bar.EndTime == T("02:30:00"));
+    assert(engine.GetBar(slot, 2, 0, bar) && bar.StartTime == T("02:25:00"));
+    assert(engine.GetBar(slot, 1, minutes - 1, bar) && bar.StartTime == T("21:00:00") && bar.Open == open[0]);
+    assert(!engine.GetBar(slot, 1, minutes, bar));
+    // 环形缓冲只保留最近512根1秒K线
+    assert(engine.GetBarCount(slot, 0) == 512);
+    assert(engine.GetBar(slot, 0, 511, bar) && bar.StartTime == T("02:21:28"));
+    assert(engine.CopyBars(slot, 1, 4, bars) == 4);
+    assert(bars[0].StartTime == T("02:26:00") && bars[3].StartTime == T("02:29:00"));
+    uint64_t written = 0;
+    const double* closes = engine.GetCloseSeries(slot, 1, written);
+    assert(written == (uint64_t)minutes && closes[(written - 1) % 512] == close[minutes - 1]);
+    assert(!engine.GetCurrentBar(slot, 1, bar));
+}
+
+// 日盘小节休息、盘中启动、Flush、迟到行情、交易日切换
+static void TestDaySession()
+{
+    const int periods[] = {60, 300};
+    TCollectSink sink;
+    MarketData::BarEngine engine;
+    assert(engine.Init(16, periods, 2, 64, &sink));
+    int schedule = engine.AddSchedule();
+    assert(engine.AddSegment(schedule, "09:00:00", "10:15:00"));
+    assert(engine.AddSegment(schedule, "10:30:00", "11:30:00"));
+    assert(engine.AddSegment(schedule, "13:30:00", "15:00:00"));
+    int rb = engine.RegisterInstrument("rb2410", schedule);
+    int ag = engine.RegisterInstrument("ag2408", schedule);
+    int free = engine.RegisterInstrument("BTC");
+    assert(engine.RegisterInstrument("x", 5) == MarketData::BarEngine::INVALID_SLOT);
+    assert(engine.FindInstrument("ag2408") == ag);
+
+    MarketData::TMarketTick tick;
+    // 盘中启动，首条行情只作为基准
+    MakeTick(tick, "rb2410", 20240603, T("10:14:10"), 3600, 10000);
+    engine.OnTick(rb, tick);
+    MarketData::TBar bar;
+    assert(engine.GetCurrentBar(rb, 0, bar) && bar.Volume == 0 && bar.StartTime == T("10:14:00"));
+    MakeTick(tick, "rb2410", 20240603, T("10:14:59", 900), 3605, 10010);
+    engine.OnTick(rb, tick);
+    // 10:15:00.500收盘行情并入10:14 K线，10:10的5分钟K线截止10:15
+    MakeTick(tick, "rb2410", 20240603, T("10:15:00", 500), 3603, 10015);
+    engine.OnTick(rb, tick);
+    assert(engine.GetCurrentBar(rb, 0, bar) && bar.StartTime == T("10:14:00") && bar.Volume == 15 && bar.Close == 3603);
+    assert(engine.GetCurrentBar(rb, 1, bar) && bar.StartTime == T("10:10:00") && bar.EndTime == T("10:15:00"));
+    assert(sink.Bars.empty());
+    // 休息期间超过CloseGrace的行情并入10:30第一根K线
+    MakeTick(tick, "rb2410", 20240603, T("10:20:00"), 3604, 10016);
+    engine.OnTick(rb, tick);
+    assert(sink.Bars.size() == 2 && sink.Bars[0].High == 3605 && sink.Bars[0].Low == 3600);
+    assert(engine.GetCurrentBar(rb, 0, bar) && bar.StartTime == T("10:30:00") && bar.Volume == 1);
+    MakeTick(tick, "rb2410", 20240603, T("10:30:01"), 3606, 10020);
+    engine.OnTick(rb, tick);
+    assert(engine.GetCurrentBar(rb, 0, bar) && bar.Volume == 5 && bar.Open == 3604 && bar.Close == 3606 && bar.TickCount == 2);
+
+    // 不活跃合约由Flush完成，之后到达的迟到行情计入下一根K线
+    sink.Clear();
+    MakeTick(tick, "ag2408", 20240603, T("10:30:10"), 7000, 0);
+    engine.OnTick(ag, tick);
+    MakeTick(tick, "ag2408", 20240603, T("10:30:20"), 7001, 3);
+    engine.OnTick(ag, tick);
+    engine.SetFlushDelay(500000000LL);
+    engine.Flush(T("10:31:00", 400));
+    assert(sink.Bars.empty());
+    engine.Flush(T("10:31:00", 500));
+    assert(sink.Bars.size() == 2 && sink.Slots[0] == rb && sink.Slots[1] == ag);
+    assert(sink.Bars[1].Volume == 3 && sink.Bars[1].Flags == MarketData::EBAR_FLAG_TIMER);
+    MakeTick(tick, "ag2408", 20240603, T("10:30:59", 900), 7002, 5);
+    engine.OnTick(ag, tick);
+    MarketData::TBarEngineStats stats;
+    engine.GetStats(stats);
+    assert(stats.Late == 1);
+    MakeTick(tick, "ag2408", 20240603, T("10:31:30"), 7003, 6);
+    engine.OnTick(ag, tick);
+    assert(engine.GetCurrentBar(ag, 0, bar) && bar.Volume == 3 && bar.Open == 7003);
+    // 当前K线之前的乱序行情只计成交量
+    MakeTick(tick, "ag2408", 20240603, T("10:30:58"), 7100, 8);
+    engine.OnTick(ag, tick);
+    assert(engine.GetCurrentBar(ag, 0, bar) && bar.Volume == 5 && bar.High == 7003);
+    // 累计量回退
+    MakeTick(tick, "ag2408", 20240603, T("10:31:40"), 7004, 7);
+    engine.OnTick(ag, tick);
+    engine.GetStats(stats);
+    assert(stats.VolumeResets == 1 && stats.Late == 2);
+    assert(engine.GetCurrentBar(ag, 0, bar) && bar.Volume == 5 && bar.Close == 7004);
+
+    // 未设置交易时段的合约自然对齐
+    MakeTick(tick, "BTC", 20240603, T("03:07:31"), 60000, 1);
+    engine.OnTick(free, tick);
+    assert(engine.GetCurrentBar(free, 1, bar) && bar.StartTime == T("03:05:00") && bar.EndTime == T("03:10:00"));
+
+    // 新交易日，1分钟K线已由Flush完成
+    sink.Clear();
+    MakeTick(tick, "rb2410", 20240604, T("10:00:00"), 3610, 7);
+    engine.OnTick(rb, tick);
+    assert(sink.Count(rb, 0) == 0 && sink.Count(rb, 1) == 1 && sink.Bars[0].TradingDay == 20240603);
+    assert(engine.GetCurrentBar(rb, 0, bar) && bar.Volume == 7 && bar.TradingDay == 20240604);
+
+    MakeTick(tick, "IF2409", 20240603, T("10:00:00"), 3500, 1);
+    engine.OnTick(tick);
+    engine.GetStats(stats);
+    assert(stats.Unregistered == 1);
+}
+
+// 交易状态事件截断和恢复交易时段
+static void TestSegmentStatus()
+{
+    const int periods[] = {60, 300};
+    TCollectSink sink;
+    MarketData::BarEngine engine;
+    assert(engine.Init(16, periods, 2, 64, &sink, true));
+    int schedule = engine.AddSchedule();
+    assert(engine.AddSegment(schedule, "13:30:00", "15:00:00"));
+    int slot = engine.RegisterInstrument("m2409", schedule);
+
+    MarketData::TMarketTick tick;
+    MakeTick(tick, "m2409", 20240603, T("13:56:10"), 3300, 10);
+    engine.OnTick(slot, tick);
+    MakeTick(tick, "m2409", 20240603, T("13:57:20"), 3301, 12);
+    engine.OnTick(slot, tick);
+    assert(sink.Bars.size() == 1);
+    // YD 13:57:30暂停交易
+    YDTradingSegmentDetail detail;
+    memset(&detail, 0, sizeof(detail));
+    detail.SegmentTime = (int)(MarketData::ToTradingTime(T("13:57:30")) / 1000000000LL);
+    detail.TradingStatus = YD_TS_NoTrading;
+    engine.OnSegmentStatus(schedule, detail);
+    assert(sink.Bars.size() == 3);
+    assert(sink.Bars[1].StartTime == T("13:57:00") && sink.Bars[1].EndTime == T("13:57:30"));
+    assert(sink.Bars[1].Flags == MarketData::EBAR_FLAG_TRUNCATED);
+    assert(sink.Bars[2].Period == 300 && sink.Bars[2].StartTime == T("13:55:00") && sink.Bars[2].Volume == 12);
+    // 暂停期间且之后无交易时段的行情丢弃
+    MakeTick(tick, "m2409", 20240603, T("14:05:00"), 3302, 13);
+    engine.OnTick(slot, tick);
+    MarketData::TBarEngineStats stats;
+    engine.GetStats(stats);
+    assert(stats.OutOfSession == 1);
+    // 14:10:15恢复连续交易，K线从恢复时刻对齐
+    detail.SegmentTime = (int)(MarketData::ToTradingTime(T("14:10:15")) / 1000000000LL);
+    detail.TradingStatus = YD_TS_Continuous;
+    engine.OnSegmentStatus(schedule, detail);
+    engine.OnSegmentStatus(schedule, T("14:20:00"), true);
+    MakeTick(tick, "m2409", 20240603, T("14:11:20"), 3303, 15);
+    engine.OnTick(slot, tick);
+    MarketData::TBar bar;
+    assert(engine.GetCurrentBar(slot, 0, bar) && bar.StartTime == T("14:11:15") && bar.Volume == 2);
+    assert(engine.GetCurrentBar(slot, 1, bar) && bar.StartTime == T("14:10:15") && bar.EndTime == T("14:15:15"));
+    // 最后一根K线截止原时段结束
+    MakeTick(tick, "m2409", 20240603, T("14:59:59"), 3304, 16);
+    engine.OnTick(slot, tick);
+    assert(engine.GetCurrentBar(slot, 0, bar) && bar.StartTime == T("14:59:15") && bar.EndTime == T("15:00:00"));
+
+    // MDS 'E'闭市、'T'恢复
+    sink.Clear();
+    MdsTradingSessionStatusMsgT status;
+    memset(&status, 0, sizeof(status));
+    status.updateTime = 145930000;
+    strcpy(status.TradingSessionID, "E110");
+    engine.OnSegmentStatus(schedule, status);
+    assert(sink.Bars.size() == 2 && sink.Bars[0].Flags == MarketData::EBAR_FLAG_TRUNCATED);
+    assert(sink.Bars[0].StartTime == T("14:59:15") && sink.Bars[0].EndTime == T("14:59:30"));
+    assert(sink.Bars[1].EndTime == T("14:59:30") && sink.Bars[1].StartTime == T("14:55:15"));
+    status.updateTime = 145940000;
+    strcpy(status.TradingSessionID, "T111");
+    engine.OnSegmentStatus(schedule, status);
+    MakeTick(tick, "m2409", 20240603, T("14:59:50"), 3305, 17);
+    engine.OnTick(slot, tick);
+    assert(engine.GetCurrentBar(slot, 1, bar) && bar.StartTime == T("14:59:40") && bar.EndTime == T("15:00:00"));
+
+    // 重置为静态配置
+    engine.ResetSchedules();
+    MakeTick(tick, "m2409", 20240604, T("14:05:00"), 3306, 1);
+    engine.OnTick(slot, tick);
+    assert(engine.GetCurrentBar(slot, 1, bar) && bar.StartTime == T("14:05:00"));
+}
+
+static void TestIPCPublisher()
+{
+    const char* channel = "BarEngineTest";
+    ipc::route::clear_storage(channel);
+    MarketData::IPCBarPublisher publisher;
+    assert(publisher.Init(channel));
+
+    const int periods[] = {60};
+    MarketData::BarEngine engine;
+    // 重复Init释放上次的缓冲，已注册合约清空
+    assert(engine.Init(8, periods, 1, 32, &publisher, true));
+    assert(engine.RegisterInstrument("IF2406") >= 0);
+    assert(engine.Init(4, periods, 1, 16, &publisher, true));
+    assert(engine.FindInstrument("IF2406") == MarketData::BarEngine::INVALID_SLOT);
+    int slot = engine.RegisterInstrument("IF2406");
+    MarketData::TMarketTick tick;
+    // 无接收端时计入丢弃
+    MakeTick(tick, "IF2406", 20240603, T("09:30:10"), 3500, 1);
+    engine.OnTick(slot, tick);
+    MakeTick(tick, "IF2406", 20240603, T("09:31:10"), 3501, 3);
+    engine.OnTick(slot, tick);
+    assert(publisher.GetPublished() == 0 && publisher.GetDropped() == 1);
+
+    ipc::route receiver(channel, ipc::receiver);
+    MakeTick(tick, "IF2406", 20240603, T("09:32:10"), 3502, 6);
+    engine.OnTick(slot, tick);
+    assert(publisher.GetPublished() == 1);
+    ipc::buff_t buffer = receiver.recv(1000);
+    assert(buffer.size() == sizeof(MarketData::TBar));
+    const MarketData::TBar* bar = (const MarketData::TBar*)buffer.data();
+    assert(strcmp(bar->InstrumentID, "IF2406") == 0 && bar->StartTime == T("09:31:00") && bar->Volume == 2);
+}
+
+int main(int argc, char* argv[])
+{
+    TestTickAdapter();
+    TestNightSession();
+    TestDaySession();
+    TestSegmentStatus();
+    TestIPCPublisher();
+
+    // 全市场行情合成1秒、1分钟、5分钟、15分钟K线
+    const int N = 2000;
+    const int TICKS = 2000000;
+    const int periods[] = {1, 60, 300, 900};
+    MarketData::BarEngine engine;
+    assert(engine.Init(N, periods, 4, 256, NULL));
+    int schedule = engine.AddSchedule();
+    engine.AddSegment(schedule, "09:30:00", "11:30:00");
+    engine.AddSegment(schedule, "13:00:00", "15:00:00");
+    std::vector<MarketData::TMarketTick> ticks(N);
+    std::vector<int> slots(N);
+    for(int i = 0; i < N; i++)
+    {
+        char instrumentID[32];
+        snprintf(instrumentID, sizeof(instrumentID), "%06d", 600000 + i);
+        slots[i] = engine.RegisterInstrument(instrumentID, schedule);
+        MakeTick(ticks[i], instrumentID, 20240603, T("09:30:00"), 10.0, 0);
+    }
+    unsigned seed = 1;
+    TimeUtil::HRTimer timer;
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < TICKS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int n = (seed >> 8) % N;
+        MarketData::TMarketTick& tick = ticks[n];
+        tick.ExchangeTime = T("09:30:00") + (int64_t)i * 3000000LL;
+        tick.LastPrice = 10.0 + (seed >> 20) % 16 * 0.01;
+        tick.Volume += 100;
+        tick.Turnover += 1000;
+        engine.OnTick(slots[n], tick);
+    }
+    uint64_t end = timer.GetTimeNs();
+    MarketData::TBarEngineStats stats;
+    engine.GetStats(stats);
+    fprintf(stderr, "BarEngine %d instruments %d ticks %lu bars OnTick Latency: %.1f ns\n", N, TICKS, stats.Bars,
+            (double)(end - start) / TICKS);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 BarEngineTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include -I../../CPP-IPC/include -I../../CTP/6.7.8/include -I../../XTP/2.2.36.1/include -I../../YD/1.486.96/include -I../../OES/0.17.4.1/include -L../../CPP-IPC/lib -lipc -lrt
@@ -0,0 +1,467 @@
+#ifndef BOOKFACTOR_HPP
+#define BOOKFACTOR_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include "MarketTick.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+// 盘口因子，计算档数由levels指定，分母为0(一侧无挂单等)时结果为0
+enum EBookFactor
+{
+    EFACTOR_SPREAD = 0,             // 卖一 - 买一
+    EFACTOR_MID,                    // (买一 + 卖一) / 2
+    EFACTOR_IMBALANCE,              // 一档量不平衡 (买一量 - 卖一量) / (买一量 + 卖一量)
+    EFACTOR_DEPTH_IMBALANCE,        // 多档累计量不平衡
+    EFACTOR_MICROPRICE,             // (买一 * 卖一量 + 卖一 * 买一量) / (买一量 + 卖一量)
+    EFACTOR_WEIGHTED_MID,           // 买卖双方多档成交量加权均价的平均
+    EFACTOR_BID_SLOPE,              // 买方深度斜率 (买一 - 最深有效买价) / 买方累计量
+    EFACTOR_ASK_SLOPE,              // 卖方深度斜率 (最深有效卖价 - 卖一) / 卖方累计量
+    EFACTOR_COUNT
+};
+
+enum
+{
+    EFACTOR_MASK_ALL = (1 << EFACTOR_COUNT) - 1
+};
+
+// 一批合约的盘口快照，按档位、字段分数组存放，同一档各合约连续，便于按合约向量化
+// 容量按8(AVX-512一次处理的double个数)向上取整，末组不足的位置一并计算，结果无意义
+class BookBlock
+{
+public:
+    enum
+    {
+        MAX_LEVELS = TMarketTick::DEPTH_LEVELS,
+        LANES = 8,
+        INVALID_INDEX = -1
+    };
+
+    BookBlock(): m_Capacity(0), m_Count(0), m_Data(NULL)
+    {
+    }
+
+    ~BookBlock()
+    {
+        free(m_Data);
+    }
+
+    bool Init(int capacity)
+    {
+        if(capacity <= 0 || m_Data != NULL)
+        {
+            return false;
+        }
+        m_Capacity = (capacity + LANES - 1) / LANES * LANES;
+        size_t size = sizeof(double) * m_Capacity * (4 * MAX_LEVELS + EFACTOR_COUNT);
+        if(posix_memalign((void**)&m_Data, 64, size) != 0)
+        {
+            m_Data = NULL;
+            return false;
+        }
+        memset(m_Data, 0, size);
+        return true;
+    }
+
+    // 清空已装载快照，各档数据由下次装载覆盖
+    void Clear()
+    {
+        m_Count = 0;
+    }
+
+    int Count() const
+    {
+        return m_Count;
+    }
+
+    int Capacity() const
+    {
+        return m_Capacity;
+    }
+
+    // 第level档各合约数据，level从0开始
+    double* BidPrice(int level) const
+    {
+        return m_Data + (size_t)level * m_Capacity;
+    }
+
+    double* AskPrice(int level) const
+    {
+        return m_Data + (size_t)(MAX_LEVELS + level) * m_Capacity;
+    }
+
+    double* BidQty(int level) const
+    {
+        return m_Data + (size_t)(2 * MAX_LEVELS + level) * m_Capacity;
+    }
+
+    double* AskQty(int level) const
+    {
+        return m_Data + (size_t)(3 * MAX_LEVELS + level) * m_Capacity;
+    }
+
+    // 计算结果，下标与装载顺序一致
+    double* Factor(int factor) const
+    {
+        return m_Data + (size_t)(4 * MAX_LEVELS + factor) * m_Capacity;
+    }
+
+    // 装载一个合约快照，返回下标，已满返回INVALID_INDEX
+    int Add(const TMarketTick& tick)
+    {
+        if(m_Count >= m_Capacity)
+        {
+            return INVALID_INDEX;
+        }
+        int i = m_Count++;
+        for(int level = 0; level < MAX_LEVELS; level++)
+        {
+            BidPrice(level)[i] = tick.BidPrice[level];
+            AskPrice(level)[i] = tick.AskPrice[level];
+            BidQty(level)[i] = (double)tick.BidVolume[level];
+            AskQty(level)[i] = (double)tick.AskVolume[level];
+        }
+        return i;
+    }
+
+#ifdef _XQUOTE_API_STRUCT_H_
+    // XTP OnDepthMarketData
+    int Add(const XTPMarketDataStruct& data)
+    {
+        if(m_Count >= m_Capacity)
+        {
+            return INVALID_INDEX;
+        }
+        int i = m_Count++;
+        for(int level = 0; level < MAX_LEVELS; level++)
+        {
+            BidPrice(level)[i] = data.bid[level];
+            AskPrice(level)[i] = data.ask[level];
+            BidQty(level)[i] = (double)data.bid_qty[level];
+            AskQty(level)[i] = (double)data.ask_qty[level];
+        }
+        return i;
+    }
+#endif
+
+#ifdef _MDS_BASE_MODEL_H
+    // MDS Level2快照，价格单位为元后四位
+    int Add(const MdsL2StockSnapshotBodyT& data)
+    {
+        if(m_Count >= m_Capacity)
+        {
+            return INVALID_INDEX;
+        }
+        int i = m_Count++;
+        for(int level = 0; level < MAX_LEVELS; level++)
+        {
+            BidPrice(level)[i] = data.BidLevels[level].Price / 10000.0;
+            AskPrice(level)[i] = data.OfferLevels[level].Price / 10000.0;
+            BidQty(level)[i] = (double)data.BidLevels[level].OrderQty;
+            AskQty(level)[i] = (double)data.OfferLevels[level].OrderQty;
+        }
+        return i;
+    }
+#endif
+
+private:
+    BookBlock(const BookBlock&);
+    BookBlock& operator=(const BookBlock&);
+private:
+    int m_Capacity;
+    int m_Count;
+    double* m_Data;
+};
+
+// 盘口因子批量计算
+// 标量版本为参考实现，AVX2、AVX-512版本每次处理4、8个合约，运算顺序与标量版本一致，
+// 结果逐位相同；标量版本须在未启用FMA(未使用-mfma/-march=native)时编译才可作为参考。
+// mask为(1 << EBookFactor)组合，只写入选中因子的结果。
+struct BookFactor
+{
+    typedef void (*ComputeFunc)(const BookBlock& block, int levels, uint32_t mask);
+
+    static void ComputeScalar(const BookBlock& block, int levels, uint32_t mask)
+    {
+        int count = block.Count();
+        double* out[EFACTOR_COUNT];
+        for(int f = 0; f < EFACTOR_COUNT; f++)
+        {
+            out[f] = block.Factor(f);
+        }
+        const double* b0 = block.BidPrice(0);
+        const double* a0 = block.AskPrice(0);
+        const double* bq0 = block.BidQty(0);
+        const double* aq0 = block.AskQty(0);
+        for(int i = 0; i < count; i++)
+        {
+            double bidQty = bq0[i];
+            double askQty = aq0[i];
+            double l1 = bidQty + askQty;
+            bool both = bidQty > 0 && askQty > 0;
+            double sumBid = 0;
+            double sumAsk = 0;
+            double notionalBid = 0;
+            double notionalAsk = 0;
+            double bidDeep = b0[i];
+            double askDeep = a0[i];
+            for(int level = 0; level < levels; level++)
+            {
+                double bp = block.BidPrice(level)[i];
+                double ap = block.AskPrice(level)[i];
+                double bq = block.BidQty(level)[i];
+                double aq = block.AskQty(level)[i];
+                sumBid = sumBid + bq;
+                sumAsk = sumAsk + aq;
+                notionalBid = notionalBid + bp * bq;
+                notionalAsk = notionalAsk + ap * aq;
+                bidDeep = bq > 0 ? bp : bidDeep;
+                askDeep = aq > 0 ? ap : askDeep;
+            }
+            double depth = sumBid + sumAsk;
+            if(mask & (1 << EFACTOR_SPREAD))
+            {
+                out[EFACTOR_SPREAD][i] = both ? a0[i] - b0[i] : 0;
+            }
+            if(mask & (1 << EFACTOR_MID))
+            {
+                out[EFACTOR_MID][i] = both ? 0.5 * (a0[i] + b0[i]) : 0;
+            }
+            if(mask & (1 << EFACTOR_IMBALANCE))
+            {
+                out[EFACTOR_IMBALANCE][i] = l1 > 0 ? (bidQty - askQty) / l1 : 0;
+            }
+            if(mask & (1 << EFACTOR_DEPTH_IMBALANCE))
+            {
+                out[EFACTOR_DEPTH_IMBALANCE][i] = depth > 0 ? (sumBid - sumAsk) / depth : 0;
+            }
+            if(mask & (1 << EFACTOR_MICROPRICE))
+            {
+                out[EFACTOR_MICROPRICE][i] = both ? (b0[i] * askQty + a0[i] * bidQty) / l1 : 0;
+            }
+            if(mask & (1 << EFACTOR_WEIGHTED_MID))
+            {
+                out[EFACTOR_WEIGHTED_MID][i] = sumBid > 0 && sumAsk > 0 ? 0.5 * (notionalBid / sumBid + notionalAsk / sumAsk) : 0;
+            }
+            if(mask & (1 << EFACTOR_BID_SLOPE))
+            {
+                out[EFACTOR_BID_SLOPE][i] = sumBid > 0 ? (b0[i] - bidDeep) / sumBid : 0;
+            }
+            if(mask & (1 << EFACTOR_ASK_SLOPE))
+            {
+                out[EFACTOR_ASK_SLOPE][i] = sumAsk > 0 ? (askDeep - a0[i]) / sumAsk : 0;
+            }
+        }
+    }
+
+    // 按4个合约一组处理，容量为8的倍数，尾部填充合约一并计算
+    __attribute__((target("avx2")))
+    static void ComputeAVX2(const BookBlock& block, int levels, uint32_t mask)
+    {
+        int count = block.Count();
+        double* out[EFACTOR_COUNT];
+        for(int f = 0; f < EFACTOR_COUNT; f++)
+        {
+            out[f] = block.Factor(f);
+        }
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d half = _mm256_set1_pd(0.5);
+        for(int i = 0; i < count; i += 4)
+        {
+            __m256d b0 = _mm256_load_pd(block.BidPrice(0) + i);
+            __m256d a0 = _mm256_load_pd(block.AskPrice(0) + i);
+            __m256d bidQty = _mm256_load_pd(block.BidQty(0) + i);
+            __m256d askQty = _mm256_load_pd(block.AskQty(0) + i);
+            __m256d l1 = _mm256_add_pd(bidQty, askQty);
+            __m256d hasBid = _mm256_cmp_pd(bidQty, zero, _CMP_GT_OQ);
+            __m256d hasAsk = _mm256_cmp_pd(askQty, zero, _CMP_GT_OQ);
+            __m256d both = _mm256_and_pd(hasBid, hasAsk);
+            __m256d sumBid = zero;
+            __m256d sumAsk = zero;
+            __m256d notionalBid = zero;
+            __m256d notionalAsk = zero;
+            __m256d bidDeep = b0;
+            __m256d askDeep = a0;
+            for(int level = 0; level < levels; level++)
+            {
+                __m256d bp = _mm256_load_pd(block.BidPrice(level) + i);
+                __m256d ap = _mm256_load_pd(block.AskPrice(level) + i);
+                __m256d bq = _mm256_load_pd(block.BidQty(level) + i);
+                __m256d aq = _mm256_load_pd(block.AskQty(level) + i);
+                sumBid = _mm256_add_pd(sumBid, bq);
+                sumAsk = _mm256_add_pd(sumAsk, aq);
+                notionalBid = _mm256_add_pd(notionalBid, _mm256_mul_pd(bp, bq));
+                notionalAsk = _mm256_add_pd(notionalAsk, _mm256_mul_pd(ap, aq));
+                bidDeep = _mm256_blendv_pd(bidDeep, bp, _mm256_cmp_pd(bq, zero, _CMP_GT_OQ));
+                askDeep = _mm256_blendv_pd(askDeep, ap, _mm256_cmp_pd(aq, zero, _CMP_GT_OQ));
+            }
+            __m256d depth = _mm256_add_pd(sumBid, sumAsk);
+            __m256d hasSumBid = _mm256_cmp_pd(sumBid, zero, _CMP_GT_OQ);
+            __m256d hasSumAsk = _mm256_cmp_pd(sumAsk, zero, _CMP_GT_OQ);
+            // 分母为0的通道除法结果为inf/nan，与0掩码相与后为+0
+            if(mask & (1 << EFACTOR_SPREAD))
+            {
+                _mm256_store_pd(out[EFACTOR_SPREAD] + i, _mm256_and_pd(both, _mm256_sub_pd(a0, b0)));
+            }
+            if(mask & (1 << EFACTOR_MID))
+            {
+                _mm256_store_pd(out[EFACTOR_MID] + i, _mm256_and_pd(both, _mm256_mul_pd(half, _mm256_add_pd(a0, b0))));
+            }
+            if(mask & (1 << EFACTOR_IMBALANCE))
+            {
+                __m256d value = _mm256_div_pd(_mm256_sub_pd(bidQty, askQty), l1);
+                _mm256_store_pd(out[EFACTOR_IMBALANCE] + i, _mm256_and_pd(_mm256_cmp_pd(l1, zero, _CMP_GT_OQ), value));
+            }
+            if(mask & (1 << EFACTOR_DEPTH_IMBALANCE))
+            {
+                __m256d value = _mm256_div_pd(_mm256_sub_pd(sumBid, sumAsk), depth);
+                _mm256_store_pd(out[EFACTOR_DEPTH_IMBALANCE] + i, _mm256_and_pd(_mm256_cmp_pd(depth, zero, _CMP_GT_OQ), value));
+            }
+            if(mask & (1 << EFACTOR_MICROPRICE))
+            {
+                __m256d value = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(b0, askQty), _mm256_mul_pd(a0, bidQty)), l1);
+                _mm256_store_pd(out[EFACTOR_MICROPRICE] + i, _mm256_and_pd(both, value));
+            }
+            if(mask & (1 << EFACTOR_WEIGHTED_MID))
+            {
+                __m256d value = _mm256_mul_pd(half, _mm256_add_pd(_mm256_div_pd(notionalBid, sumBid), _mm256_div_pd(notionalAsk, sumAsk)));
+                _mm256_store_pd(out[EFACTOR_WEIGHTED_MID] + i, _mm256_and_pd(_mm256_and_pd(hasSumBid, hasSumAsk), value));
+            }
+            if(mask & (1 << EFACTOR_BID_SLOPE))
+            {
+                __m256d value = _mm256_div_pd(_mm256_sub_pd(b0, bidDeep), sumBid);
+                _mm256_store_pd(out[EFACTOR_BID_SLOPE] + i, _mm256_and_pd(hasSumBid, value));
+            }
+            if(mask & (1 << EFACTOR_ASK_SLOPE))
+            {
+                __m256d value = _mm256_div_pd(_mm256_sub_pd(askDeep, a0), sumAsk);
+                _mm256_store_pd(out[EFACTOR_ASK_SLOPE] + i, _mm256_and_pd(hasSumAsk, value));
+            }
+        }
+    }
+
+    // AVX-512隐含FMA，关闭乘加融合以保持与标量版本结果一致
+    __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    static void ComputeAVX512(const BookBlock& block, int levels, uint32_t mask)
+    {
+        int count = block.Count();
+        double* out[EFACTOR_COUNT];
+        for(int f = 0; f < EFACTOR_COUNT; f++)
+        {
+            out[f] = block.Factor(f);
+        }
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512d half = _mm512_set1_pd(0.5);
+        for(int i = 0; i < count; i += 8)
+        {
+            __m512d b0 = _mm512_load_pd(block.BidPrice(0) + i);
+            __m512d a0 = _mm512_load_pd(block.AskPrice(0) + i);
+            __m512d bidQty = _mm512_load_pd(block.BidQty(0) + i);
+            __m512d askQty = _mm512_load_pd(block.AskQty(0) + i);
+            __m512d l1 = _mm512_add_pd(bidQty, askQty);
+            __mmask8 hasBid = _mm512_cmp_pd_mask(bidQty, zero, _CMP_GT_OQ);
+            __mmask8 hasAsk = _mm512_cmp_pd_mask(askQty, zero, _CMP_GT_OQ);
+            __mmask8 both = hasBid & hasAsk;
+            __m512d sumBid = zero;
+            __m512d sumAsk = zero;
+            __m512d notionalBid = zero;
+            __m512d notionalAsk = zero;
+            __m512d bidDeep = b0;
+            __m512d askDeep = a0;
+            for(int level = 0; level < levels; level++)
+            {
+                __m512d bp = _mm512_load_pd(block.BidPrice(level) + i);
+                __m512d ap = _mm512_load_pd(block.AskPrice(level) + i);
+                __m512d bq = _mm512_load_pd(block.BidQty(level) + i);
+                __m512d aq = _mm512_load_pd(block.AskQty(level) + i);
+                sumBid = _mm512_add_pd(sumBid, bq);
+                sumAsk = _mm512_add_pd(sumAsk, aq);
+                notionalBid = _mm512_add_pd(notionalBid, _mm512_mul_pd(bp, bq));
+                notionalAsk = _mm512_add_pd(notionalAsk, _mm512_mul_pd(ap, aq));
+                bidDeep = _mm512_mask_mov_pd(bidDeep, _mm512_cmp_pd_mask(bq, zero, _CMP_GT_OQ), bp);
+                askDeep = _mm512_mask_mov_pd(askDeep, _mm512_cmp_pd_mask(aq, zero, _CMP_GT_OQ), ap);
+            }
+            __m512d depth = _mm512_add_pd(sumBid, sumAsk);
+            __mmask8 hasSumBid = _mm512_cmp_pd_mask(sumBid, zero, _CMP_GT_OQ);
+            __mmask8 hasSumAsk = _mm512_cmp_pd_mask(sumAsk, zero, _CMP_GT_OQ);
+            if(mask & (1 << EFACTOR_SPREAD))
+            {
+                _mm512_store_pd(out[EFACTOR_SPREAD] + i, _mm512_maskz_sub_pd(both, a0, b0));
+            }
+            if(mask & (1 << EFACTOR_MID))
+            {
+                _mm512_store_pd(out[EFACTOR_MID] + i, _mm512_maskz_mul_pd(both, half, _mm512_add_pd(a0, b0)));
+            }
+            if(mask & (1 << EFACTOR_IMBALANCE))
+            {
+                __mmask8 valid = _mm512_cmp_pd_mask(l1, zero, _CMP_GT_OQ);
+                _mm512_store_pd(out[EFACTOR_IMBALANCE] + i, _mm512_maskz_div_pd(valid, _mm512_sub_pd(bidQty, askQty), l1));
+            }
+            if(mask & (1 << EFACTOR_DEPTH_IMBALANCE))
+            {
+                __mmask8 valid = _mm512_cmp_pd_mask(depth, zero, _CMP_GT_OQ);
+                _mm512_store_pd(out[EFACTOR_DEPTH_IMBALANCE] + i, _mm512_maskz_div_pd(valid, _mm512_sub_pd(sumBid, sumAsk), depth));
+            }
+            if(mask & (1 << EFACTOR_MICROPRICE))
+            {
+                __m512d numerator = _mm512_add_pd(_mm512_mul_pd(b0, askQty), _mm512_mul_pd(a0, bidQty));
+                _mm512_store_pd(out[EFACTOR_MICROPRICE] + i, _mm512_maskz_div_pd(both, numerator, l1));
+            }
+            if(mask & (1 << EFACTOR_WEIGHTED_MID))
+            {
+                __mmask8 valid = hasSumBid & hasSumAsk;
+                __m512d sum = _mm512_add_pd(_mm512_maskz_div_pd(valid, notionalBid, sumBid), _mm512_maskz_div_pd(valid, notionalAsk, sumAsk));
+                _mm512_store_pd(out[EFACTOR_WEIGHTED_MID] + i, _mm512_maskz_mul_pd(valid, half, sum));
+            }
+            if(mask & (1 << EFACTOR_BID_SLOPE))
+            {
+                _mm512_store_pd(out[EFACTOR_BID_SLOPE] + i, _mm512_maskz_div_pd(hasSumBid, _mm512_sub_pd(b0, bidDeep), sumBid));
+            }
+            if(mask & (1 << EFACTOR_ASK_SLOPE))
+            {
+                _mm512_store_pd(out[EFACTOR_ASK_SLOPE] + i, _mm512_maskz_div_pd(hasSumAsk, _mm512_sub_pd(askDeep, a0), sumAsk));
+            }
+        }
+    }
+
+    static ComputeFunc GetComputeFunc()
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f"))
+        {
+            return &BookFactor::ComputeAVX512;
+        }
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return &BookFactor::ComputeAVX2;
+        }
+        return &BookFactor::ComputeScalar;
+    }
+
+    // levels取值1~MAX_LEVELS
+    static void Compute(const BookBlock& block, int levels, uint32_t mask = EFACTOR_MASK_ALL)
+    {
+        static const ComputeFunc compute = GetComputeFunc();
+        if(levels < 1)
+        {
+            levels = 1;
+        }
+        if(levels > BookBlock::MAX_LEVELS)
+        {
+            levels = BookBlock::MAX_LEVELS;
+        }
+        compute(block, levels, mask);
+    }
+};
+
+}
+
+#endif // BOOKFACTOR_HPP
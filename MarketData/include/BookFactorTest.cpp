@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "xquote_api_struct.h"
+#include "mds_global/mds_base_model.h"
+#include "BookFactor.hpp"
+#include "HRTimer.hpp"
+
+static unsigned g_Seed = 12345;
+
+static unsigned Random()
+{
+    g_Seed = g_Seed * 1103515245 + 12345;
+    return g_Seed >> 8;
+}
+
+// 随机盘口，含空盘口、单边盘口、档位不足等情形
+static void FillRandom(XTPMarketDataStruct& data, int i)
+{
+    memset(&data, 0, sizeof(data));
+    snprintf(data.ticker, sizeof(data.ticker), "%06d", 600000 + i);
+    data.exchange_id = XTP_EXCHANGE_SH;
+    int kind = Random() % 16;
+    int bidLevels = kind == 0 ? 0 : (kind == 1 ? 3 : 10);
+    int askLevels = kind == 2 ? 0 : (kind == 3 ? 1 : 10);
+    double mid = 2.0 + Random() % 100000 * 0.01;
+    for(int level = 0; level < bidLevels; level++)
+    {
+        data.bid[level] = mid - 0.01 * (level + 1);
+        data.bid_qty[level] = (Random() % 1000 + 1) * 100;
+    }
+    for(int level = 0; level < askLevels; level++)
+    {
+        data.ask[level] = mid + 0.01 * (level + 1);
+        data.ask_qty[level] = (Random() % 1000 + 1) * 100;
+    }
+    // 中间档位数量为0
+    if(kind == 4)
+    {
+        data.bid_qty[5] = 0;
+    }
+}
+
+static void TestExample()
+{
+    MarketData::BookBlock block;
+    assert(block.Init(3));
+    assert(block.Capacity() == 8);
+    assert(!block.Init(3));
+    MarketData::TMarketTick tick;
+    memset(&tick, 0, sizeof(tick));
+    tick.BidPrice[0] = 10.0;
+    tick.BidPrice[1] = 9.0;
+    tick.AskPrice[0] = 11.0;
+    tick.AskPrice[1] = 12.0;
+    tick.AskPrice[2] = 13.0;
+    tick.BidVolume[0] = 300;
+    tick.BidVolume[1] = 100;
+    tick.AskVolume[0] = 100;
+    tick.AskVolume[1] = 100;
+    tick.AskVolume[2] = 200;
+    assert(block.Add(tick) == 0);
+    // 卖方无挂单
+    memset(tick.AskPrice, 0, sizeof(tick.AskPrice));
+    memset(tick.AskVolume, 0, sizeof(tick.AskVolume));
+    assert(block.Add(tick) == 1);
+
+    MarketData::BookFactor::ComputeFunc funcs[] = {&MarketData::BookFactor::ComputeScalar,
+                                                   &MarketData::BookFactor::ComputeAVX2,
+                                                   &MarketData::BookFactor::ComputeAVX512};
+    __builtin_cpu_init();
+    int kernels = __builtin_cpu_supports("avx512f") ? 3 : (__builtin_cpu_supports("avx2") ? 2 : 1);
+    for(int k = 0; k < kernels; k++)
+    {
+        funcs[k](block, 10, MarketData::EFACTOR_MASK_ALL);
+        assert(block.Factor(MarketData::EFACTOR_SPREAD)[0] == 1.0);
+        assert(block.Factor(MarketData::EFACTOR_MID)[0] == 10.5);
+        assert(block.Factor(MarketData::EFACTOR_IMBALANCE)[0] == 0.5);
+        assert(block.Factor(MarketData::EFACTOR_DEPTH_IMBALANCE)[0] == 0.0);
+        assert(block.Factor(MarketData::EFACTOR_MICROPRICE)[0] == 10.75);
+        // 买方均价9.75，卖方均价12.25
+        assert(block.Factor(MarketData::EFACTOR_WEIGHTED_MID)[0] == 11.0);
+        assert(block.Factor(MarketData::EFACTOR_BID_SLOPE)[0] == 1.0 / 400);
+        assert(block.Factor(MarketData::EFACTOR_ASK_SLOPE)[0] == 2.0 / 400);
+
+        assert(block.Factor(MarketData::EFACTOR_SPREAD)[1] == 0);
+        assert(block.Factor(MarketData::EFACTOR_MID)[1] == 0);
+        assert(block.Factor(MarketData::EFACTOR_IMBALANCE)[1] == 1.0);
+        assert(block.Factor(MarketData::EFACTOR_DEPTH_IMBALANCE)[1] == 1.0);
+        assert(block.Factor(MarketData::EFACTOR_MICROPRICE)[1] == 0);
+        assert(block.Factor(MarketData::EFACTOR_WEIGHTED_MID)[1] == 0);
+        assert(block.Factor(MarketData::EFACTOR_BID_SLOPE)[1] == 1.0 / 400);
+        assert(block.Factor(MarketData::EFACTOR_ASK_SLOPE)[1] == 0);
+
+        // 只取一档
+        funcs[k](block, 1, MarketData::EFACTOR_MASK_ALL);
+        assert(block.Factor(MarketData::EFACTOR_DEPTH_IMBALANCE)[0] == 0.5);
+        assert(block.Factor(MarketData::EFACTOR_WEIGHTED_MID)[0] == 10.5);
+        assert(block.Factor(MarketData::EFACTOR_BID_SLOPE)[0] == 0);
+    }
+
+    // MDS价格为元后四位
+    MdsL2StockSnapshotBodyT snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.BidLevels[0].Price = 71400;
+    snapshot.BidLevels[0].OrderQty = 500;
+    snapshot.OfferLevels[0].Price = 71500;
+    snapshot.OfferLevels[0].OrderQty = 1500;
+    assert(block.Add(snapshot) == 2);
+    MarketData::BookFactor::Compute(block, 5, 1 << MarketData::EFACTOR_MICROPRICE);
+    assert(block.Factor(MarketData::EFACTOR_MICROPRICE)[2] == (7.14 * 1500 + 7.15 * 500) / 2000);
+    block.Clear();
+    assert(block.Count() == 0);
+    for(int i = 0; i < block.Capacity(); i++)
+    {
+        assert(block.Add(tick) == i);
+    }
+    assert(block.Add(tick) == MarketData::BookBlock::INVALID_INDEX);
+}
+
+// 各向量版本与标量参考实现逐位比对
+static void TestEquivalence()
+{
+    const int N = 1003;
+    std::vector<XTPMarketDataStruct> data(N);
+    MarketData::BookBlock scalar;
+    MarketData::BookBlock vector;
+    assert(scalar.Init(N) && vector.Init(N));
+    for(int i = 0; i < N; i++)
+    {
+        FillRandom(data[i], i);
+        assert(scalar.Add(data[i]) == i);
+        assert(vector.Add(data[i]) == i);
+    }
+    assert(scalar.Capacity() == 1008);
+
+    MarketData::BookFactor::ComputeFunc funcs[] = {&MarketData::BookFactor::ComputeAVX2,
+                                                   &MarketData::BookFactor::ComputeAVX512};
+    const char* names[] = {"AVX2", "AVX512"};
+    __builtin_cpu_init();
+    int kernels = __builtin_cpu_supports("avx512f") ? 2 : (__builtin_cpu_supports("avx2") ? 1 : 0);
+    const uint32_t masks[] = {MarketData::EFACTOR_MASK_ALL, (1 << MarketData::EFACTOR_MICROPRICE) | (1 << MarketData::EFACTOR_ASK_SLOPE)};
+    for(int k = 0; k < kernels; k++)
+    {
+        for(int levels = 1; levels <= MarketData::BookBlock::MAX_LEVELS; levels++)
+        {
+            for(int m = 0; m < 2; m++)
+            {
+                for(int f = 0; f < MarketData::EFACTOR_COUNT; f++)
+                {
+                    memset(scalar.Factor(f), 0xFF, sizeof(double) * scalar.Capacity());
+                    memset(vector.Factor(f), 0xFF, sizeof(double) * vector.Capacity());
+                }
+                MarketData::BookFactor::ComputeScalar(scalar, levels, masks[m]);
+                funcs[k](vector, levels, masks[m]);
+                for(int f = 0; f < MarketData::EFACTOR_COUNT; f++)
+                {
+                    if(memcmp(scalar.Factor(f), vector.Factor(f), sizeof(double) * scalar.Count()) != 0)
+                    {
+                        fprintf(stderr, "%s levels %d factor %d mismatch\n", names[k], levels, f);
+                        assert(false);
+                    }
+                    for(int i = 0; i < scalar.Count() && (masks[m] & (1 << f)); i++)
+                    {
+                        assert(!isnan(scalar.Factor(f)[i]) && !isinf(scalar.Factor(f)[i]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 策略原有写法，逐合约直接读取XTP结构体
+static void ComputeAoS(const XTPMarketDataStruct* data, int count, double* out)
+{
+    for(int i = 0; i < count; i++)
+    {
+        const XTPMarketDataStruct& d = data[i];
+        double sumBid = 0;
+        double sumAsk = 0;
+        double notionalBid = 0;
+        double notionalAsk = 0;
+        double bidDeep = d.bid[0];
+        double askDeep = d.ask[0];
+        for(int level = 0; level < 10; level++)
+        {
+            sumBid += d.bid_qty[level];
+            sumAsk += d.ask_qty[level];
+            notionalBid += d.bid[level] * d.bid_qty[level];
+            notionalAsk += d.ask[level] * d.ask_qty[level];
+            bidDeep = d.bid_qty[level] > 0 ? d.bid[level] : bidDeep;
+            askDeep = d.ask_qty[level] > 0 ? d.ask[level] : askDeep;
+        }
+        double l1 = (double)(d.bid_qty[0] + d.ask_qty[0]);
+        bool both = d.bid_qty[0] > 0 && d.ask_qty[0] > 0;
+        double* o = out + i * MarketData::EFACTOR_COUNT;
+        o[MarketData::EFACTOR_SPREAD] = both ? d.ask[0] - d.bid[0] : 0;
+        o[MarketData::EFACTOR_MID] = both ? 0.5 * (d.ask[0] + d.bid[0]) : 0;
+        o[MarketData::EFACTOR_IMBALANCE] = l1 > 0 ? (d.bid_qty[0] - d.ask_qty[0]) / l1 : 0;
+        o[MarketData::EFACTOR_DEPTH_IMBALANCE] = sumBid + sumAsk > 0 ? (sumBid - sumAsk) / (sumBid + sumAsk) : 0;
+        o[MarketData::EFACTOR_MICROPRICE] = both ? (d.bid[0] * d.ask_qty[0] + d.ask[0] * d.bid_qty[0]) / l1 : 0;
+        o[MarketData::EFACTOR_WEIGHTED_MID] = sumBid > 0 && sumAsk > 0 ? 0.5 * (notionalBid / sumBid + notionalAsk / sumAsk) : 0;
+        o[MarketData::EFACTOR_BID_SLOPE] = sumBid > 0 ? (d.bid[0] - bidDeep) / sumBid : 0;
+        o[MarketData::EFACTOR_ASK_SLOPE] = sumAsk > 0 ? (askDeep - d.ask[0]) / sumAsk : 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    TestExample();
+    TestEquivalence();
+
+    // 沪深全市场约5000只证券一轮快照
+    const int N = 5000;
+    const int ROUNDS = 200;
+    std::vector<XTPMarketDataStruct> data(N);
+    for(int i = 0; i < N; i++)
+    {
+        FillRandom(data[i], i);
+    }
+    std::vector<double> aos(N * MarketData::EFACTOR_COUNT);
+    MarketData::BookBlock block;
+    assert(block.Init(N));
+    TimeUtil::HRTimer timer;
+
+    uint64_t start = timer.GetTimeNs();
+    for(int r = 0; r < ROUNDS; r++)
+    {
+        ComputeAoS(&data[0], N, &aos[0]);
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "BookFactor AoS scalar %d instruments: %.1f ns/instrument\n", N, (double)(end - start) / ROUNDS / N);
+
+    start = timer.GetTimeNs();
+    for(int r = 0; r < ROUNDS; r++)
+    {
+        block.Clear();
+        for(int i = 0; i < N; i++)
+        {
+            block.Add(data[i]);
+        }
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "BookFactor SoA load %d instruments: %.1f ns/instrument\n", N, (double)(end - start) / ROUNDS / N);
+
+    MarketData::BookFactor::ComputeFunc funcs[] = {&MarketData::BookFactor::ComputeScalar,
+                                                   &MarketData::BookFactor::ComputeAVX2,
+                                                   &MarketData::BookFactor::ComputeAVX512};
+    const char* names[] = {"Scalar", "AVX2", "AVX512"};
+    __builtin_cpu_init();
+    int kernels = __builtin_cpu_supports("avx512f") ? 3 : (__builtin_cpu_supports("avx2") ? 2 : 1);
+    for(int k = 0; k < kernels; k++)
+    {
+        start = timer.GetTimeNs();
+        for(int r = 0; r < ROUNDS; r++)
+        {
+            funcs[k](block, 10, MarketData::EFACTOR_MASK_ALL);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "BookFactor %s %d instruments 10 levels: %.1f ns/instrument\n", names[k], N,
+                (double)(end - start) / ROUNDS / N);
+        for(int i = 0; i < N; i++)
+        {
+            assert(block.Factor(MarketData::EFACTOR_MICROPRICE)[i] == aos[i * MarketData::EFACTOR_COUNT + MarketData::EFACTOR_MICROPRICE]);
+        }
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 BookFactorTest.cpp -o test -I. -I../../FMTLogger/include -I../../XTP/2.2.36.1/include -I../../OES/0.17.4.1/include
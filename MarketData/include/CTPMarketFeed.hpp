@@ -0,0 +1,122 @@
+#ifndef CTPMARKETFEED_HPP
+#define CTPMARKETFEED_HPP
+
+#include "ThostFtdcMdApi.h"
+#include "MarketFeed.hpp"
+
+namespace MarketData
+{
+
+// CTP行情适配，CTP无回调线程绑核接口，由发布端在首次回调时按CallbackCpu绑核
+// Protocol为UDP时使用UDP行情，配置Multicast时使用组播行情
+class CTPMarketFeed: public MarketFeed, public CThostFtdcMdSpi
+{
+public:
+    CTPMarketFeed(): m_Api(NULL), m_RequestID(0)
+    {
+    }
+
+    virtual ~CTPMarketFeed()
+    {
+        Stop();
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        MarketFeed::Init(config, sink);
+        if(m_Config.FrontAddress.empty() && m_Config.Multicast.empty())
+        {
+            return false;
+        }
+        std::string code;
+        std::string exchange;
+        m_Instruments.clear();
+        for(size_t i = 0; i < m_Config.Instruments.size(); i++)
+        {
+            SplitInstrument(m_Config.Instruments[i], code, exchange);
+            m_Instruments.push_back(code);
+        }
+        m_Api = CThostFtdcMdApi::CreateFtdcMdApi(m_Config.FlowPath.c_str(), m_Config.Protocol == "UDP", !m_Config.Multicast.empty());
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        m_Api->RegisterSpi(this);
+        std::vector<std::string>& fronts = m_Config.Multicast.empty() ? m_Config.FrontAddress : m_Config.Multicast;
+        for(size_t i = 0; i < fronts.size(); i++)
+        {
+            m_Api->RegisterFront(&fronts[i][0]);
+        }
+        m_Sink->SetCallbackCpu(m_Config.CallbackCpu);
+        return true;
+    }
+
+    virtual bool Start()
+    {
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        m_Api->Init();
+        return true;
+    }
+
+    virtual void Stop()
+    {
+        if(m_Api != NULL)
+        {
+            m_Api->RegisterSpi(NULL);
+            m_Api->Release();
+            m_Api = NULL;
+        }
+    }
+
+    virtual void OnFrontConnected()
+    {
+        CThostFtdcReqUserLoginField request;
+        memset(&request, 0, sizeof(request));
+        strncpy(request.BrokerID, m_Config.BrokerID.c_str(), sizeof(request.BrokerID) - 1);
+        strncpy(request.UserID, m_Config.UserID.c_str(), sizeof(request.UserID) - 1);
+        strncpy(request.Password, m_Config.Password.c_str(), sizeof(request.Password) - 1);
+        m_Api->ReqUserLogin(&request, ++m_RequestID);
+    }
+
+    virtual void OnFrontDisconnected(int nReason)
+    {
+        char message[32];
+        snprintf(message, sizeof(message), "reason 0x%X", nReason);
+        m_Sink->OnStatus(false, message);
+    }
+
+    virtual void OnRspUserLogin(CThostFtdcRspUserLoginField* pRspUserLogin, CThostFtdcRspInfoField* pRspInfo, int nRequestID, bool bIsLast)
+    {
+        if(pRspInfo != NULL && pRspInfo->ErrorID != 0)
+        {
+            m_Sink->OnStatus(false, pRspInfo->ErrorMsg);
+            return;
+        }
+        m_Sink->OnStatus(true, "login");
+        std::vector<char*> argv;
+        MakeArgv(m_Instruments, argv);
+        if(!argv.empty())
+        {
+            m_Api->SubscribeMarketData(&argv[0], (int)argv.size());
+        }
+    }
+
+    virtual void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData)
+    {
+        int64_t recvTime = GetTimeNs();
+        static thread_local TMarketTick tick;
+        TickAdapter::Convert(*pDepthMarketData, tick);
+        m_Sink->OnTick(tick, recvTime);
+    }
+private:
+    CThostFtdcMdApi* m_Api;
+    int m_RequestID;
+    std::vector<std::string> m_Instruments;
+};
+
+}
+
+#endif // CTPMARKETFEED_HPP
@@ -0,0 +1,373 @@
+#ifndef EESQUOTEARBITER_HPP
+#define EESQUOTEARBITER_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "EESQuoteApi.h"
+#include "InstrumentIndex.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+// 单条行情线路的统计，只由该线路的回调线程写入
+struct TQuoteSourceStats
+{
+    enum
+    {
+        LAG_BUCKET_COUNT = 32   // 落后最快线路的时间按2的幂分桶，桶i上界为2^i ns
+    };
+    uint64_t Received;
+    uint64_t Wins;          // 先到并被转发
+    uint64_t Duplicates;    // 与最新转发行情相同
+    uint64_t Stale;         // 早于最新转发行情
+    uint64_t Gaps;          // 跳过或乱序的行情条数
+    uint64_t OutOfWindow;   // 落后超过HISTORY_SIZE条转发行情，落后时间按下界计入
+    uint64_t Unregistered;  // 未注册合约
+    uint64_t Connected;
+    uint64_t LagHistogram[LAG_BUCKET_COUNT];
+};
+
+// REM EES行情A/B线路仲裁
+// 同一合约的行情按(更新时间, 成交量)去重，更新时间按18:00起算以兼容夜盘跨日，
+// 任一线路先到的新行情立即转发给下游EESQuoteEvent，其余线路的相同行情丢弃并
+// 记录其落后于最先到达线路的时间。每个合约保留最近HISTORY_SIZE条转发行情，
+// 用于识别迟到行情和统计各线路的跳号；各线路按自身最近送达的行情判断新旧，
+// 落后超出历史窗口的行情单独计数，其转发序号按窗口下界估计，跳号只少计不多计。
+// 每条线路由独立线程回调，同一合约的仲裁与下游回调在合约自旋锁内完成，
+// 下游对同一合约的回调串行且有序，不同合约可并发回调。
+class EESQuoteArbiter
+{
+public:
+    enum
+    {
+        MAX_SOURCE_COUNT = 4,
+        HISTORY_SIZE = 8
+    };
+
+    EESQuoteArbiter(): m_Index(NULL), m_States(NULL), m_SourceCount(0), m_Handler(NULL)
+    {
+        memset(m_Stats, 0, sizeof(m_Stats));
+    }
+
+    ~EESQuoteArbiter()
+    {
+        delete m_Index;
+        free(m_States);
+    }
+
+    bool Init(int capacity, int sourceCount, EESQuoteEvent* handler)
+    {
+        if(sourceCount <= 0 || sourceCount > MAX_SOURCE_COUNT || handler == NULL)
+        {
+            return false;
+        }
+        delete m_Index;
+        free(m_States);
+        m_States = NULL;
+        m_Index = new TradeUtil::InstrumentIndex(capacity);
+        void* memory = NULL;
+        if(posix_memalign(&memory, 64, sizeof(TInstrumentState) * capacity) != 0)
+        {
+            return false;
+        }
+        memset(memory, 0, sizeof(TInstrumentState) * capacity);
+        m_States = (TInstrumentState*)memory;
+        m_SourceCount = sourceCount;
+        m_Handler = handler;
+        return true;
+    }
+
+    // 须在线路连接前注册全部订阅合约，热路径只做查找
+    int RegisterInstrument(const char* instrumentID)
+    {
+        return m_Index->Register(instrumentID);
+    }
+
+    // 在线路回调线程调用，返回是否转发
+    bool OnQuote(int source, EesEqsIntrumentType instrumentType, EESMarketDepthQuoteData* quote, uint64_t nowNs)
+    {
+        TQuoteSourceStats& stats = m_Stats[source];
+        stats.Received++;
+        int slot = m_Index->Find(quote->InstrumentID);
+        if(slot == TradeUtil::InstrumentIndex::INVALID_SLOT)
+        {
+            stats.Unregistered++;
+            return false;
+        }
+        uint64_t key = GetQuoteKey(*quote);
+        TInstrumentState& state = m_States[slot];
+        Lock(state);
+        bool forward = key > state.LastKey;
+        if(forward)
+        {
+            // 本线路尚未送达的已转发行情计为跳号
+            if(state.SourceSeq[source] != 0)
+            {
+                stats.Gaps += state.ForwardSeq - state.SourceSeq[source];
+            }
+            state.ForwardSeq++;
+            state.LastKey = key;
+            state.HistoryKey[state.ForwardSeq % HISTORY_SIZE] = key;
+            state.HistoryNs[state.ForwardSeq % HISTORY_SIZE] = nowNs;
+            state.SourceSeq[source] = state.ForwardSeq;
+            state.SourceKey[source] = key;
+            stats.Wins++;
+            stats.LagHistogram[0]++;
+            m_Handler->OnQuoteUpdated(instrumentType, quote);
+        }
+        else
+        {
+            if(key == state.LastKey)
+            {
+                stats.Duplicates++;
+            }
+            else
+            {
+                stats.Stale++;
+            }
+            // 本线路自身重复或乱序的行情不参与跳号统计
+            if(key > state.SourceKey[source])
+            {
+                state.SourceKey[source] = key;
+                uint64_t seq = FindHistory(state, key);
+                if(seq > 0)
+                {
+                    stats.LagHistogram[GetLagBucket(nowNs - state.HistoryNs[seq % HISTORY_SIZE])]++;
+                    if(state.SourceSeq[source] != 0 && seq > state.SourceSeq[source] + 1)
+                    {
+                        stats.Gaps += seq - state.SourceSeq[source] - 1;
+                    }
+                    if(seq > state.SourceSeq[source])
+                    {
+                        state.SourceSeq[source] = seq;
+                    }
+                }
+                else if(state.ForwardSeq > HISTORY_SIZE)
+                {
+                    uint64_t oldest = state.ForwardSeq - HISTORY_SIZE + 1;
+                    if(key < state.HistoryKey[oldest % HISTORY_SIZE])
+                    {
+                        // 早于历史窗口，实际序号不大于oldest - 1
+                        stats.OutOfWindow++;
+                        stats.LagHistogram[GetLagBucket(nowNs - state.HistoryNs[oldest % HISTORY_SIZE])]++;
+                        if(oldest - 1 > state.SourceSeq[source])
+                        {
+                            state.SourceSeq[source] = oldest - 1;
+                        }
+                    }
+                }
+            }
+        }
+        Unlock(state);
+        return forward;
+    }
+
+    void SetConnected(int source, bool connected)
+    {
+        m_Stats[source].Connected = connected ? 1 : 0;
+    }
+
+    // 统计快照，读线程调用时各计数为近似值
+    void GetSourceStats(int source, TQuoteSourceStats& stats) const
+    {
+        memcpy(&stats, &m_Stats[source], sizeof(stats));
+    }
+
+    static double GetWinRate(const TQuoteSourceStats& stats)
+    {
+        uint64_t total = stats.Wins + stats.Duplicates + stats.Stale;
+        return total > 0 ? (double)stats.Wins / total : 0.0;
+    }
+
+    // 落后时间分位数，返回所在分桶上界(ns)，先到为0
+    static uint64_t GetLagPercentile(const TQuoteSourceStats& stats, double percentile)
+    {
+        uint64_t total = 0;
+        for(int i = 0; i < TQuoteSourceStats::LAG_BUCKET_COUNT; i++)
+        {
+            total += stats.LagHistogram[i];
+        }
+        uint64_t target = (uint64_t)(total * percentile);
+        uint64_t count = 0;
+        for(int i = 0; i < TQuoteSourceStats::LAG_BUCKET_COUNT; i++)
+        {
+            count += stats.LagHistogram[i];
+            if(count > target)
+            {
+                return i == 0 ? 0 : (1ull << i);
+            }
+        }
+        return 1ull << (TQuoteSourceStats::LAG_BUCKET_COUNT - 1);
+    }
+
+    // 高32位为18:00起算的毫秒数，低32位为成交量
+    static force_inline inline uint64_t GetQuoteKey(const EESMarketDepthQuoteData& quote)
+    {
+        const char* time = quote.UpdateTime;
+        int seconds = ((time[0] - '0') * 10 + time[1] - '0') * 3600 + ((time[3] - '0') * 10 + time[4] - '0') * 60
+                      + (time[6] - '0') * 10 + time[7] - '0';
+        seconds = (seconds + 6 * 3600) % 86400;
+        uint64_t milliseconds = (uint64_t)seconds * 1000 + quote.UpdateMillisec;
+        return (milliseconds << 32) | (uint32_t)quote.Volume;
+    }
+
+    static force_inline inline uint64_t GetMonotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+    }
+protected:
+    struct alignas(64) TInstrumentState
+    {
+        std::atomic<uint32_t> Locked;
+        uint32_t Reserved;
+        uint64_t LastKey;
+        uint64_t ForwardSeq;     // 已转发行情序号，从1开始
+        uint64_t SourceSeq[MAX_SOURCE_COUNT];   // 各线路已送达的最大转发序号
+        uint64_t SourceKey[MAX_SOURCE_COUNT];   // 各线路最近送达的行情key
+        uint64_t HistoryKey[HISTORY_SIZE];
+        uint64_t HistoryNs[HISTORY_SIZE];
+    };
+
+    static force_inline inline void Lock(TInstrumentState& state)
+    {
+        while(state.Locked.exchange(1, std::memory_order_acquire) != 0)
+        {
+            while(state.Locked.load(std::memory_order_relaxed) != 0)
+            {
+                __builtin_ia32_pause();
+            }
+        }
+    }
+
+    static force_inline inline void Unlock(TInstrumentState& state)
+    {
+        state.Locked.store(0, std::memory_order_release);
+    }
+
+    // 返回key对应的转发序号，不在最近历史中返回0
+    static force_inline inline uint64_t FindHistory(const TInstrumentState& state, uint64_t key)
+    {
+        for(uint64_t i = 0; i < HISTORY_SIZE && i < state.ForwardSeq; i++)
+        {
+            uint64_t seq = state.ForwardSeq - i;
+            if(state.HistoryKey[seq % HISTORY_SIZE] == key)
+            {
+                return seq;
+            }
+        }
+        return 0;
+    }
+
+    static force_inline inline int GetLagBucket(uint64_t lagNs)
+    {
+        int bucket = lagNs == 0 ? 0 : 64 - __builtin_clzll(lagNs);
+        return bucket < TQuoteSourceStats::LAG_BUCKET_COUNT ? bucket : TQuoteSourceStats::LAG_BUCKET_COUNT - 1;
+    }
+private:
+    EESQuoteArbiter(const EESQuoteArbiter&);
+    EESQuoteArbiter& operator=(const EESQuoteArbiter&);
+private:
+    TradeUtil::InstrumentIndex* m_Index;
+    TInstrumentState* m_States;
+    int m_SourceCount;
+    EESQuoteEvent* m_Handler;
+    // 各线路统计分占缓存行，避免线路线程间伪共享
+    struct alignas(64) TAlignedStats: public TQuoteSourceStats {};
+    TAlignedStats m_Stats[MAX_SOURCE_COUNT];
+};
+
+// 单条线路的回调适配，分别传给ConnServer(EqsTcpInfo)与InitMulticast(EqsMulticastInfo)
+class EESQuoteSource: public EESQuoteEvent
+{
+public:
+    EESQuoteSource(EESQuoteArbiter* arbiter, int source): m_Arbiter(arbiter), m_Source(source)
+    {
+    }
+
+    virtual void OnEqsConnected()
+    {
+        m_Arbiter->SetConnected(m_Source, true);
+    }
+
+    virtual void OnEqsDisconnected()
+    {
+        m_Arbiter->SetConnected(m_Source, false);
+    }
+
+    virtual void OnQuoteUpdated(EesEqsIntrumentType chInstrumentType, EESMarketDepthQuoteData* pDepthQuoteData)
+    {
+        m_Arbiter->OnQuote(m_Source, chInstrumentType, pDepthQuoteData, EESQuoteArbiter::GetMonotonicNs());
+    }
+protected:
+    EESQuoteArbiter* m_Arbiter;
+    int m_Source;
+};
+
+// 模拟行情接口，测试时替代CreateEESQuoteApi创建的实例，由Push主动推送行情
+class EESMockQuoteApi: public EESQuoteApi
+{
+public:
+    EESMockQuoteApi(): m_Handler(NULL)
+    {
+    }
+
+    virtual bool ConnServer(vector<EqsTcpInfo>& vecEti, EESQuoteEvent* pQuoteEventHandler)
+    {
+        m_Handler = pQuoteEventHandler;
+        m_Handler->OnEqsConnected();
+        return true;
+    }
+
+    virtual bool InitMulticast(vector<EqsMulticastInfo>& vecEmi, EESQuoteEvent* pQuoteEventHandler)
+    {
+        m_Handler = pQuoteEventHandler;
+        return true;
+    }
+
+    virtual void LoginToEqs(EqsLoginParam& loginParam)
+    {
+        m_Handler->OnLoginResponse(true, "");
+    }
+
+    virtual void QuerySymbolList()
+    {
+    }
+
+    virtual void RegisterSymbol(EesEqsIntrumentType chInstrumentType, const char* pSymbol)
+    {
+        m_Handler->OnSymbolRegisterResponse(chInstrumentType, pSymbol, true);
+    }
+
+    virtual void UnregisterSymbol(EesEqsIntrumentType chInstrumentType, const char* pSymbol)
+    {
+        m_Handler->OnSymbolUnregisterResponse(chInstrumentType, pSymbol, true);
+    }
+
+    virtual void DisConnServer()
+    {
+        if(m_Handler != NULL)
+        {
+            m_Handler->OnEqsDisconnected();
+        }
+    }
+
+    void Push(EesEqsIntrumentType instrumentType, EESMarketDepthQuoteData* quote)
+    {
+        m_Handler->OnQuoteUpdated(instrumentType, quote);
+    }
+protected:
+    EESQuoteEvent* m_Handler;
+};
+
+}
+
+#endif // EESQUOTEARBITER_HPP
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include "EESQuoteArbiter.hpp"
+#include "HRTimer.hpp"
+
+// 下游：校验同一合约的转发行情严格递增
+class QuoteHandler: public EESQuoteEvent
+{
+public:
+    QuoteHandler(): m_Count(0)
+    {
+        memset(m_LastKey, 0, sizeof(m_LastKey));
+    }
+
+    virtual void OnQuoteUpdated(EesEqsIntrumentType chInstrumentType, EESMarketDepthQuoteData* pDepthQuoteData)
+    {
+        int slot = atoi(pDepthQuoteData->InstrumentID + 2) % 64;
+        uint64_t key = MarketData::EESQuoteArbiter::GetQuoteKey(*pDepthQuoteData);
+        assert(key > m_LastKey[slot]);
+        m_LastKey[slot] = key;
+        m_Count++;
+    }
+
+    std::atomic<uint64_t> m_Count;
+    uint64_t m_LastKey[64];
+};
+
+static void FillQuote(EESMarketDepthQuoteData& quote, const char* instrumentID, int tick)
+{
+    memset(&quote, 0, sizeof(quote));
+    strcpy(quote.InstrumentID, instrumentID);
+    // 21:00:00起每500ms一笔
+    int seconds = 21 * 3600 + tick / 2;
+    snprintf(quote.UpdateTime, sizeof(quote.UpdateTime), "%02d:%02d:%02d", (seconds / 3600) % 24, (seconds / 60) % 60, seconds % 60);
+    quote.UpdateMillisec = (tick & 1) * 500;
+    quote.Volume = tick;
+    quote.LastPrice = 3500.0 + tick;
+}
+
+int main(int argc, char* argv[])
+{
+    // 夜盘跨日的更新时间仍递增
+    {
+        EESMarketDepthQuoteData quote;
+        FillQuote(quote, "rb2410", 0);
+        strcpy(quote.UpdateTime, "23:59:59");
+        uint64_t night = MarketData::EESQuoteArbiter::GetQuoteKey(quote);
+        strcpy(quote.UpdateTime, "00:00:01");
+        uint64_t midnight = MarketData::EESQuoteArbiter::GetQuoteKey(quote);
+        strcpy(quote.UpdateTime, "09:00:00");
+        uint64_t day = MarketData::EESQuoteArbiter::GetQuoteKey(quote);
+        assert(night < midnight && midnight < day);
+    }
+
+    QuoteHandler handler;
+    MarketData::EESQuoteArbiter arbiter;
+    assert(arbiter.Init(1024, 2, &handler));
+    for(int i = 0; i < 64; i++)
+    {
+        char instrumentID[32] = {0};
+        snprintf(instrumentID, sizeof(instrumentID), "rb%04d", 2400 + i);
+        assert(arbiter.RegisterInstrument(instrumentID) >= 0);
+    }
+
+    // A为TCP线路，B为组播线路
+    MarketData::EESQuoteSource sourceA(&arbiter, 0);
+    MarketData::EESQuoteSource sourceB(&arbiter, 1);
+    MarketData::EESMockQuoteApi tcpApi;
+    MarketData::EESMockQuoteApi multicastApi;
+    vector<EqsTcpInfo> tcpInfo(1);
+    vector<EqsMulticastInfo> multicastInfo(1);
+    assert(tcpApi.ConnServer(tcpInfo, &sourceA));
+    assert(multicastApi.InitMulticast(multicastInfo, &sourceB));
+    MarketData::TQuoteSourceStats statsA, statsB;
+    arbiter.GetSourceStats(0, statsA);
+    assert(statsA.Connected == 1);
+
+    EESMarketDepthQuoteData quote[8];
+    for(int i = 0; i < 8; i++)
+    {
+        FillQuote(quote[i], "rb2400", i + 1);
+    }
+    // tick1 A先到，B重复
+    tcpApi.Push(EQS_FUTURE, &quote[1]);
+    multicastApi.Push(EQS_FUTURE, &quote[1]);
+    assert(handler.m_Count == 1);
+    // tick2 B先到
+    multicastApi.Push(EQS_FUTURE, &quote[2]);
+    tcpApi.Push(EQS_FUTURE, &quote[2]);
+    // A丢失tick3，tick4先到，计跳号1
+    multicastApi.Push(EQS_FUTURE, &quote[3]);
+    tcpApi.Push(EQS_FUTURE, &quote[4]);
+    // B迟到的tick4
+    tcpApi.Push(EQS_FUTURE, &quote[5]);
+    multicastApi.Push(EQS_FUTURE, &quote[4]);
+    multicastApi.Push(EQS_FUTURE, &quote[5]);
+    assert(handler.m_Count == 5);
+    arbiter.GetSourceStats(0, statsA);
+    arbiter.GetSourceStats(1, statsB);
+    assert(statsA.Wins == 3 && statsA.Duplicates == 1 && statsA.Gaps == 1);
+    assert(statsB.Wins == 2 && statsB.Duplicates == 2 && statsB.Stale == 1 && statsB.Gaps == 0);
+    // B落后A共20条，超出历史窗口的12条单独计数，追上后不计跳号
+    {
+        EESMarketDepthQuoteData lagging[20];
+        for(int i = 0; i < 20; i++)
+        {
+            FillQuote(lagging[i], "rb2401", i + 1);
+            tcpApi.Push(EQS_FUTURE, &lagging[i]);
+        }
+        for(int i = 0; i < 20; i++)
+        {
+            multicastApi.Push(EQS_FUTURE, &lagging[i]);
+        }
+        MarketData::TQuoteSourceStats lagStats;
+        arbiter.GetSourceStats(1, lagStats);
+        assert(lagStats.OutOfWindow == 12 && lagStats.Gaps == 0);
+        assert(lagStats.Stale - statsB.Stale == 19 && lagStats.Duplicates - statsB.Duplicates == 1);
+        assert(handler.m_Count == 25);
+    }
+    // 未注册合约丢弃
+    FillQuote(quote[0], "ag2412", 1);
+    tcpApi.Push(EQS_FUTURE, &quote[0]);
+    arbiter.GetSourceStats(0, statsA);
+    assert(statsA.Unregistered == 1 && handler.m_Count == 25);
+    tcpApi.DisConnServer();
+    arbiter.GetSourceStats(0, statsA);
+    assert(statsA.Connected == 0);
+
+    // 两线程分别作为A、B线路推送相同行情
+    const int N = 100000;
+    std::vector<EESMarketDepthQuoteData> ticks(N);
+    for(int i = 0; i < N; i++)
+    {
+        char instrumentID[32] = {0};
+        snprintf(instrumentID, sizeof(instrumentID), "rb%04d", 2400 + (i & 63));
+        FillQuote(ticks[i], instrumentID, 100 + (i >> 6));
+    }
+    uint64_t forwarded = handler.m_Count;
+    uint64_t gaps[2] = {statsA.Gaps, statsB.Gaps};
+    TimeUtil::HRTimer timer;
+    uint64_t start = timer.GetTimeNs();
+    std::thread threadB([&]()
+    {
+        for(int i = 0; i < N; i++)
+        {
+            multicastApi.Push(EQS_FUTURE, &ticks[i]);
+        }
+    });
+    for(int i = 0; i < N; i++)
+    {
+        tcpApi.Push(EQS_FUTURE, &ticks[i]);
+    }
+    threadB.join();
+    uint64_t end = timer.GetTimeNs();
+    assert(handler.m_Count - forwarded == (uint64_t)N);
+    fprintf(stderr, "EESQuoteArbiter OnQuote Latency: %.1f ns\n", (double)(end - start) / (2 * N));
+    for(int source = 0; source < 2; source++)
+    {
+        MarketData::TQuoteSourceStats stats;
+        arbiter.GetSourceStats(source, stats);
+        // 两线路均无丢包，落后超出窗口也不应新增跳号
+        assert(stats.Gaps == gaps[source]);
+        fprintf(stderr, "Source %d WinRate: %.3f Gaps: %lu Stale: %lu OutOfWindow: %lu Lag P50: %lu ns P99: %lu ns\n",
+                source, MarketData::EESQuoteArbiter::GetWinRate(stats), stats.Gaps, stats.Stale, stats.OutOfWindow,
+                MarketData::EESQuoteArbiter::GetLagPercentile(stats, 0.5),
+                MarketData::EESQuoteArbiter::GetLagPercentile(stats, 0.99));
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 EESQuoteArbiterTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include -I../../REM/3.1.3.49/include
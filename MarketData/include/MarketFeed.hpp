@@ -0,0 +1,271 @@
+#ifndef MARKETFEED_HPP
+#define MARKETFEED_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "MarketTick.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+// 单个行情源配置，各柜台只使用其中部分字段
+// CPU编号统一从0开始，由各柜台适配转换为柜台接口约定的编号
+struct TFeedConfig
+{
+    std::string Name;                       // 行情源名称，CPP-IPC通道名为<IPCPrefix>.<Name>
+    std::string Vendor;                     // 柜台名称：CTP、XTP、REM、Tora、MDS或插件注册的名称
+    uint16_t Source;                        // 写入TMarketTick::Source
+    std::vector<std::string> FrontAddress;  // CTP/Tora为tcp://ip:port，XTP/REM为ip:port
+    std::vector<std::string> Multicast;     // 组播地址，CTP/Tora为udp://ip:port，REM为ip:port
+    std::string LocalIP;                    // 组播接收网卡地址或XTP本地地址
+    std::string Interface;                  // Tora组播接收网卡名
+    std::string Protocol;                   // TCP/UDP
+    std::string BrokerID;
+    std::string UserID;
+    std::string Password;
+    std::string FlowPath;                   // 柜台流文件目录
+    std::string ConfigFile;                 // MDS配置文件
+    int ClientID;                           // XTP客户端编号
+    int BufferSize;                         // XTP UDP接收缓存MB
+    int HeartBeatInterval;                  // XTP心跳间隔秒
+    std::vector<std::string> Instruments;   // 合约代码，股票为600000.SH/000001.SZ
+    std::vector<int> RecvCpus;              // 柜台接收线程绑核(XTP、Tora、MDS)
+    std::vector<int> ParseCpus;             // 柜台解析线程绑核(XTP)
+    int CallbackCpu;                        // 行情回调线程绑核，-1不绑核
+    bool MultiThreaded;                     // 柜台从多个线程回调时为true，发布端改用多写者通道
+
+    TFeedConfig(): Source(0), ClientID(1), BufferSize(512), HeartBeatInterval(15), CallbackCpu(-1), MultiThreaded(false)
+    {
+    }
+};
+
+// 行情源运行统计，由该行情源的回调线程写入
+struct TFeedStats
+{
+    uint64_t Received;          // 柜台行情回调次数
+    uint64_t Published;         // 写入CPP-IPC通道
+    uint64_t Dropped;           // 通道满或无接收端
+    uint64_t Unregistered;      // 快照表中未注册的合约
+    uint64_t Invalid;           // 无法转换的行情
+    int64_t LastRecvTime;
+    bool Connected;
+};
+
+// 行情源输出，由网关实现；柜台适配在回调线程完成转换后调用OnTick
+// 通过虚接口调用，柜台插件不依赖CPP-IPC及快照表
+class FeedSink
+{
+public:
+    virtual ~FeedSink() {}
+    // recvTime为进入柜台回调时的UTC纳秒
+    virtual void OnTick(TMarketTick& tick, int64_t recvTime) = 0;
+    virtual void OnInvalid() = 0;
+    virtual void OnStatus(bool connected, const char* message) = 0;
+    // 柜台无绑核接口时由适配设置，回调线程首次回调时绑核
+    virtual void SetCallbackCpu(int cpu) = 0;
+};
+
+// 柜台行情适配接口
+// Init创建柜台接口并完成绑核等须在连接前进行的设置，Start连接、登录并订阅，Stop释放柜台接口。
+// 适配在回调中使用线程局部的TMarketTick作转换缓冲，柜台多线程回调时互不干扰。
+class MarketFeed
+{
+public:
+    MarketFeed(): m_Sink(NULL)
+    {
+    }
+
+    virtual ~MarketFeed()
+    {
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        m_Config = config;
+        m_Sink = sink;
+        return true;
+    }
+
+    virtual bool Start() = 0;
+    virtual void Stop() = 0;
+
+    const TFeedConfig& GetConfig() const
+    {
+        return m_Config;
+    }
+
+    static force_inline inline int64_t GetTimeNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    // 拆分600000.SH形式的合约代码，无后缀时exchange为空
+    static void SplitInstrument(const std::string& instrument, std::string& code, std::string& exchange)
+    {
+        size_t pos = instrument.rfind('.');
+        if(pos == std::string::npos)
+        {
+            code = instrument;
+            exchange.clear();
+            return;
+        }
+        code = instrument.substr(0, pos);
+        exchange = instrument.substr(pos + 1);
+    }
+
+    // 沪深交易所后缀：SH/SSE为SH，SZ/SZSE为SZ，其余返回NULL
+    static force_inline inline const char* GetStockSuffix(const char* exchange)
+    {
+        if(strcmp(exchange, "SH") == 0 || strcmp(exchange, "SSE") == 0)
+        {
+            return "SH";
+        }
+        if(strcmp(exchange, "SZ") == 0 || strcmp(exchange, "SZSE") == 0)
+        {
+            return "SZ";
+        }
+        return NULL;
+    }
+
+    // 快照表键：沪深证券代码可能重复(000001.SH/000001.SZ)，带交易所后缀；期货合约代码直接作键
+    static force_inline inline void FormatBoardKey(const char* code, const char* exchange, char* key, size_t size)
+    {
+        const char* suffix = GetStockSuffix(exchange);
+        size_t length = strnlen(code, size - 1);
+        memcpy(key, code, length);
+        if(suffix != NULL && length + 3 < size)
+        {
+            key[length++] = '.';
+            key[length++] = suffix[0];
+            key[length++] = suffix[1];
+        }
+        key[length] = '\0';
+    }
+
+    // 按交易所后缀分组合约代码，供柜台按交易所批量订阅
+    void GroupInstruments(std::map<std::string, std::vector<std::string> >& groups) const
+    {
+        std::string code;
+        std::string exchange;
+        for(size_t i = 0; i < m_Config.Instruments.size(); i++)
+        {
+            SplitInstrument(m_Config.Instruments[i], code, exchange);
+            groups[exchange].push_back(code);
+        }
+    }
+
+    // CPU列表格式化为"0,5,18"，offset为柜台编号与0起编号的差
+    static std::string FormatCpuList(const std::vector<int>& cpus, int offset = 0)
+    {
+        std::string text;
+        char buffer[16];
+        for(size_t i = 0; i < cpus.size(); i++)
+        {
+            snprintf(buffer, sizeof(buffer), i == 0 ? "%d" : ",%d", cpus[i] + offset);
+            text += buffer;
+        }
+        return text;
+    }
+
+    // 拆分ip:port
+    static bool SplitAddress(const std::string& address, std::string& ip, int& port)
+    {
+        size_t pos = address.rfind(':');
+        if(pos == std::string::npos)
+        {
+            return false;
+        }
+        ip = address.substr(0, pos);
+        port = atoi(address.c_str() + pos + 1);
+        return port > 0 && port < 65536;
+    }
+
+    // 柜台接口要求char*[]参数
+    static void MakeArgv(std::vector<std::string>& items, std::vector<char*>& argv)
+    {
+        argv.clear();
+        for(size_t i = 0; i < items.size(); i++)
+        {
+            argv.push_back(&items[i][0]);
+        }
+    }
+protected:
+    TFeedConfig m_Config;
+    FeedSink* m_Sink;
+private:
+    MarketFeed(const MarketFeed&);
+    MarketFeed& operator=(const MarketFeed&);
+};
+
+typedef MarketFeed* (*CreateMarketFeedFunc)();
+
+template<class T>
+MarketFeed* CreateMarketFeed()
+{
+    return new T();
+}
+
+// 柜台名称到适配创建函数的注册表
+// 柜台插件动态库导出 extern "C" void RegisterMarketFeeds(MarketData::MarketFeedRegistry*)，
+// 网关加载插件后调用该函数注册插件中的适配，注册表实例属于网关，不依赖跨动态库的静态变量。
+class MarketFeedRegistry
+{
+public:
+    MarketFeedRegistry()
+    {
+    }
+
+    bool Register(const char* vendor, CreateMarketFeedFunc func)
+    {
+        return m_Table.insert(std::make_pair(std::string(vendor), func)).second;
+    }
+
+    MarketFeed* Create(const std::string& vendor) const
+    {
+        std::map<std::string, CreateMarketFeedFunc>::const_iterator it = m_Table.find(vendor);
+        return it == m_Table.end() ? NULL : it->second();
+    }
+
+    bool Contains(const std::string& vendor) const
+    {
+        return m_Table.find(vendor) != m_Table.end();
+    }
+private:
+    MarketFeedRegistry(const MarketFeedRegistry&);
+    MarketFeedRegistry& operator=(const MarketFeedRegistry&);
+private:
+    std::map<std::string, CreateMarketFeedFunc> m_Table;
+};
+
+typedef void (*RegisterMarketFeedsFunc)(MarketFeedRegistry* registry);
+
+// 当前线程绑定到指定CPU，cpu小于0时不绑核
+inline bool PinCurrentThread(int cpu)
+{
+    if(cpu < 0)
+    {
+        return true;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+}
+
+}
+
+#endif // MARKETFEED_HPP
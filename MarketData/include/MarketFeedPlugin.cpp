@@ -0,0 +1,39 @@
+// 行情网关柜台插件
+// 每个柜台编译为一个动态库，网关按配置Plugins加载后调用RegisterMarketFeeds注册适配。
+// 柜台头文件须在MarketTick.hpp之前包含，以启用对应的TickAdapter::Convert。
+// 注册表与TFeedConfig中的std::string跨动态库传递，插件须与网关使用相同的_GLIBCXX_USE_CXX11_ABI编译。
+
+#if defined(MARKET_FEED_CTP)
+#include "CTPMarketFeed.hpp"
+#elif defined(MARKET_FEED_XTP)
+#include "XTPMarketFeed.hpp"
+#elif defined(MARKET_FEED_REM)
+#include "REMMarketFeed.hpp"
+#elif defined(MARKET_FEED_TORA)
+#include "ToraMarketFeed.hpp"
+#elif defined(MARKET_FEED_MDS)
+#include "MdsMarketFeed.hpp"
+#else
+#error "define one of MARKET_FEED_CTP/XTP/REM/TORA/MDS"
+#endif
+
+extern "C" void RegisterMarketFeeds(MarketData::MarketFeedRegistry* registry)
+{
+#if defined(MARKET_FEED_CTP)
+    registry->Register("CTP", &MarketData::CreateMarketFeed<MarketData::CTPMarketFeed>);
+#elif defined(MARKET_FEED_XTP)
+    registry->Register("XTP", &MarketData::CreateMarketFeed<MarketData::XTPMarketFeed>);
+#elif defined(MARKET_FEED_REM)
+    registry->Register("REM", &MarketData::CreateMarketFeed<MarketData::REMMarketFeed>);
+#elif defined(MARKET_FEED_TORA)
+    registry->Register("Tora", &MarketData::CreateMarketFeed<MarketData::ToraMarketFeed>);
+#elif defined(MARKET_FEED_MDS)
+    registry->Register("MDS", &MarketData::CreateMarketFeed<MarketData::MdsMarketFeed>);
+#endif
+}
+
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 -shared -fPIC -DMARKET_FEED_CTP MarketFeedPlugin.cpp -o libCTPMarketFeed.so -I. -I../../CTP/6.7.8/include -lthostmduserapi_se
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 -shared -fPIC -DMARKET_FEED_XTP MarketFeedPlugin.cpp -o libXTPMarketFeed.so -I. -I../../XTP/2.2.36.1/include -L../../XTP/2.2.36.1/lib -lxtpquoteapi
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 -shared -fPIC -DMARKET_FEED_REM MarketFeedPlugin.cpp -o libREMMarketFeed.so -I. -I../../REM/3.1.3.49/include -L../../REM/3.1.3.49/lib -lEESQuoteApi
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 -shared -fPIC -DMARKET_FEED_TORA MarketFeedPlugin.cpp -o libToraMarketFeed.so -I. -I../../Tora/lev2mdapi_4.0.7/include -L../../Tora/lev2mdapi_4.0.7/lib -llev2mdapi
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 -shared -fPIC -DMARKET_FEED_MDS MarketFeedPlugin.cpp -o libMDSMarketFeed.so -I. -I../../OES/0.17.4.1/include -L../../OES/0.17.4.1/lib -l:liboes_0.17.4.1.so
@@ -0,0 +1,448 @@
+#ifndef MARKETGATEWAY_HPP
+#define MARKETGATEWAY_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <atomic>
+#include <set>
+#include <string>
+#include <vector>
+#include "libipc/ipc.h"
+#include "YAMLBinding.hpp"
+#include "MarketFeed.hpp"
+#include "SnapshotBoard.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+YAML_BIND(TFeedConfig,
+    YAML_REQUIRED(Name),
+    YAML_REQUIRED(Vendor),
+    YAML_FIELD(Source),
+    YAML_FIELD(FrontAddress),
+    YAML_FIELD(Multicast),
+    YAML_FIELD(LocalIP),
+    YAML_FIELD(Interface),
+    YAML_FIELD(Protocol),
+    YAML_FIELD(BrokerID),
+    YAML_FIELD(UserID),
+    YAML_FIELD(Password),
+    YAML_FIELD(FlowPath),
+    YAML_FIELD(ConfigFile),
+    YAML_FIELD(ClientID),
+    YAML_FIELD(BufferSize),
+    YAML_FIELD(HeartBeatInterval),
+    YAML_FIELD(Instruments),
+    YAML_FIELD(RecvCpus),
+    YAML_FIELD(ParseCpus),
+    YAML_FIELD(CallbackCpu),
+    YAML_FIELD(MultiThreaded))
+
+struct TGatewayConfig
+{
+    std::string IPCPrefix;                  // CPP-IPC通道名前缀
+    std::string BoardName;                  // 快照表共享内存名，如/MarketBoard
+    int BoardCapacity;
+    int MainCpu;                            // 网关主线程绑核，-1不绑核
+    int StatsInterval;                      // 统计输出间隔秒，0不输出
+    std::vector<std::string> Plugins;       // 柜台插件动态库
+    std::vector<TFeedConfig> Feeds;
+
+    TGatewayConfig(): BoardCapacity(4096), MainCpu(-1), StatsInterval(60)
+    {
+    }
+};
+
+YAML_BIND(TGatewayConfig,
+    YAML_REQUIRED(IPCPrefix),
+    YAML_REQUIRED(BoardName),
+    YAML_FIELD(BoardCapacity),
+    YAML_FIELD(MainCpu),
+    YAML_FIELD(StatsInterval),
+    YAML_FIELD(Plugins),
+    YAML_REQUIRED(Feeds))
+
+// 单个行情源的发布端
+// 在柜台回调线程上写入快照表并发送到该行情源独占的CPP-IPC通道，不经过中间队列和线程。
+// 单线程回调的行情源使用ipc::route(单写多读)，多线程回调的行情源使用ipc::channel(多写多读)，
+// 接收端须使用同一类型连接。快照表按FormatBoardKey生成的键查找，沪深证券带交易所后缀，
+// 未注册的合约只发送到通道。
+class FeedPublisher: public FeedSink
+{
+public:
+    FeedPublisher(): m_Route(NULL), m_Channel(NULL), m_Board(NULL), m_Source(0), m_CallbackCpu(-1), m_MultiThreaded(false)
+    {
+        m_Received.store(0, std::memory_order_relaxed);
+        m_Published.store(0, std::memory_order_relaxed);
+        m_Dropped.store(0, std::memory_order_relaxed);
+        m_Unregistered.store(0, std::memory_order_relaxed);
+        m_Invalid.store(0, std::memory_order_relaxed);
+        m_LastRecvTime.store(0, std::memory_order_relaxed);
+        m_Connected.store(false, std::memory_order_relaxed);
+    }
+
+    virtual ~FeedPublisher()
+    {
+        delete m_Route;
+        delete m_Channel;
+    }
+
+    bool Init(const char* channel, const TFeedConfig& config, SnapshotBoard* board)
+    {
+        m_Name = config.Name;
+        m_Board = board;
+        m_Source = config.Source;
+        m_MultiThreaded = config.MultiThreaded;
+        if(m_MultiThreaded)
+        {
+            m_Channel = new ipc::channel(channel, ipc::sender);
+            return m_Channel->valid();
+        }
+        m_Route = new ipc::route(channel, ipc::sender);
+        return m_Route->valid();
+    }
+
+    virtual void OnTick(TMarketTick& tick, int64_t recvTime)
+    {
+        if(m_CallbackCpu >= 0)
+        {
+            PinCallbackThread();
+        }
+        Increase(m_Received);
+        m_LastRecvTime.store(recvTime, std::memory_order_relaxed);
+        tick.Source = m_Source;
+        tick.RecvTime = recvTime;
+        char key[TMarketTick::INSTRUMENT_ID_LEN];
+        MarketFeed::FormatBoardKey(tick.InstrumentID, tick.ExchangeID, key, sizeof(key));
+        int slot = m_Board->Find(key);
+        if(slot != SnapshotBoard::INVALID_SLOT)
+        {
+            m_Board->Update(slot, tick);
+        }
+        else
+        {
+            Increase(m_Unregistered);
+        }
+        // 无接收端时直接计为丢弃，不进入发送路径
+        bool sent = false;
+        if(m_Route != NULL)
+        {
+            sent = m_Route->recv_count() > 0 && m_Route->try_send(&tick, sizeof(tick), 0);
+        }
+        else
+        {
+            sent = m_Channel->recv_count() > 0 && m_Channel->try_send(&tick, sizeof(tick), 0);
+        }
+        Increase(sent ? m_Published : m_Dropped);
+    }
+
+    virtual void OnInvalid()
+    {
+        Increase(m_Invalid);
+    }
+
+    // 连接状态变化不在行情路径上，直接输出
+    virtual void OnStatus(bool connected, const char* message)
+    {
+        m_Connected.store(connected, std::memory_order_relaxed);
+        fprintf(stderr, "MarketGateway feed %s %s %s\n", m_Name.c_str(), connected ? "connected" : "disconnected",
+                message != NULL ? message : "");
+    }
+
+    virtual void SetCallbackCpu(int cpu)
+    {
+        m_CallbackCpu = cpu;
+    }
+
+    void GetStats(TFeedStats& stats) const
+    {
+        stats.Received = m_Received.load(std::memory_order_relaxed);
+        stats.Published = m_Published.load(std::memory_order_relaxed);
+        stats.Dropped = m_Dropped.load(std::memory_order_relaxed);
+        stats.Unregistered = m_Unregistered.load(std::memory_order_relaxed);
+        stats.Invalid = m_Invalid.load(std::memory_order_relaxed);
+        stats.LastRecvTime = m_LastRecvTime.load(std::memory_order_relaxed);
+        stats.Connected = m_Connected.load(std::memory_order_relaxed);
+    }
+protected:
+    // 每个回调线程首次回调时绑核一次
+    void PinCallbackThread()
+    {
+        static thread_local const FeedPublisher* pinned = NULL;
+        if(pinned != this)
+        {
+            PinCurrentThread(m_CallbackCpu);
+            pinned = this;
+        }
+    }
+
+    force_inline inline void Increase(std::atomic<uint64_t>& counter)
+    {
+        if(m_MultiThreaded)
+        {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+private:
+    FeedPublisher(const FeedPublisher&);
+    FeedPublisher& operator=(const FeedPublisher&);
+private:
+    ipc::route* m_Route;
+    ipc::channel* m_Channel;
+    SnapshotBoard* m_Board;
+    uint16_t m_Source;
+    int m_CallbackCpu;
+    bool m_MultiThreaded;
+    std::string m_Name;
+    std::atomic<uint64_t> m_Received;
+    std::atomic<uint64_t> m_Published;
+    std::atomic<uint64_t> m_Dropped;
+    std::atomic<uint64_t> m_Unregistered;
+    std::atomic<uint64_t> m_Invalid;
+    std::atomic<int64_t> m_LastRecvTime;
+    std::atomic<bool> m_Connected;
+};
+
+// 多行情源网关
+// 按配置加载柜台插件，为每个行情源创建柜台适配与发布端，所有行情源共用一张快照表，
+// 配置中各行情源订阅的合约在启动前注册到快照表。柜台回调线程直接完成转换与发布。
+class MarketGateway
+{
+public:
+    MarketGateway(): m_Started(false)
+    {
+    }
+
+    ~MarketGateway()
+    {
+        Stop();
+        // 适配的代码可能在插件中，先释放适配再卸载插件
+        for(size_t i = 0; i < m_Feeds.size(); i++)
+        {
+            delete m_Feeds[i];
+            delete m_Publishers[i];
+        }
+        for(size_t i = 0; i < m_Plugins.size(); i++)
+        {
+            dlclose(m_Plugins[i]);
+        }
+    }
+
+    static bool LoadConfig(const char* path, TGatewayConfig& config, std::string& error)
+    {
+        YAMLUtil::SchemaLoader loader;
+        if(!loader.LoadFile(path, config))
+        {
+            const YAMLUtil::TBindError& bindError = loader.GetError();
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer), "%s:%d:%d %s %s", path, bindError.Line, bindError.Column,
+                     bindError.Path.c_str(), bindError.Message.c_str());
+            error = buffer;
+            return false;
+        }
+        return true;
+    }
+
+    static void GetChannelName(const std::string& prefix, const std::string& feed, char* name, size_t size)
+    {
+        snprintf(name, size, "%s.%s", prefix.c_str(), feed.c_str());
+    }
+
+    // 清理异常退出后残留的通道共享内存，须在接收端连接之前调用
+    static void ClearChannels(const TGatewayConfig& config)
+    {
+        for(size_t i = 0; i < config.Feeds.size(); i++)
+        {
+            char name[128] = {0};
+            GetChannelName(config.IPCPrefix, config.Feeds[i].Name, name, sizeof(name));
+            if(config.Feeds[i].MultiThreaded)
+            {
+                ipc::channel::clear_storage(name);
+            }
+            else
+            {
+                ipc::route::clear_storage(name);
+            }
+        }
+    }
+
+    // 进程内的柜台适配可在Init前直接注册
+    MarketFeedRegistry& GetRegistry()
+    {
+        return m_Registry;
+    }
+
+    bool LoadPlugin(const std::string& path)
+    {
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if(handle == NULL)
+        {
+            m_Error = dlerror();
+            return false;
+        }
+        RegisterMarketFeedsFunc func = (RegisterMarketFeedsFunc)dlsym(handle, "RegisterMarketFeeds");
+        if(func == NULL)
+        {
+            m_Error = path + " has no RegisterMarketFeeds";
+            dlclose(handle);
+            return false;
+        }
+        func(&m_Registry);
+        m_Plugins.push_back(handle);
+        return true;
+    }
+
+    bool Init(const TGatewayConfig& config)
+    {
+        if(!m_Feeds.empty())
+        {
+            m_Error = "gateway already initialized";
+            return false;
+        }
+        m_Config = config;
+        PinCurrentThread(m_Config.MainCpu);
+        for(size_t i = 0; i < m_Config.Plugins.size(); i++)
+        {
+            if(!LoadPlugin(m_Config.Plugins[i]))
+            {
+                return false;
+            }
+        }
+        if(!m_Board.Create(m_Config.BoardName.c_str(), m_Config.BoardCapacity))
+        {
+            m_Error = "failed to create snapshot board " + m_Config.BoardName;
+            return false;
+        }
+        // 快照表合约注册须在行情回调开始前完成
+        std::set<std::string> names;
+        std::string code;
+        std::string exchange;
+        char key[TMarketTick::INSTRUMENT_ID_LEN];
+        for(size_t i = 0; i < m_Config.Feeds.size(); i++)
+        {
+            const TFeedConfig& feed = m_Config.Feeds[i];
+            if(!names.insert(feed.Name).second)
+            {
+                m_Error = "duplicate feed " + feed.Name;
+                return false;
+            }
+            if(!m_Registry.Contains(feed.Vendor))
+            {
+                m_Error = "unknown vendor " + feed.Vendor + " of feed " + feed.Name;
+                return false;
+            }
+            for(size_t j = 0; j < feed.Instruments.size(); j++)
+            {
+                MarketFeed::SplitInstrument(feed.Instruments[j], code, exchange);
+                MarketFeed::FormatBoardKey(code.c_str(), exchange.c_str(), key, sizeof(key));
+                if(m_Board.Register(key) == SnapshotBoard::INVALID_SLOT)
+                {
+                    m_Error = std::string("snapshot board full at ") + key;
+                    return false;
+                }
+            }
+        }
+        for(size_t i = 0; i < m_Config.Feeds.size(); i++)
+        {
+            const TFeedConfig& feed = m_Config.Feeds[i];
+            char channel[128] = {0};
+            GetChannelName(m_Config.IPCPrefix, feed.Name, channel, sizeof(channel));
+            FeedPublisher* publisher = new FeedPublisher();
+            m_Publishers.push_back(publisher);
+            m_Feeds.push_back(m_Registry.Create(feed.Vendor));
+            if(!publisher->Init(channel, feed, &m_Board))
+            {
+                m_Error = std::string("failed to create channel ") + channel;
+                return false;
+            }
+            if(!m_Feeds.back()->Init(feed, publisher))
+            {
+                m_Error = "failed to init feed " + feed.Name;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Start()
+    {
+        for(size_t i = 0; i < m_Feeds.size(); i++)
+        {
+            if(!m_Feeds[i]->Start())
+            {
+                m_Error = "failed to start feed " + m_Config.Feeds[i].Name;
+                for(size_t j = 0; j < i; j++)
+                {
+                    m_Feeds[j]->Stop();
+                }
+                return false;
+            }
+        }
+        m_Started = !m_Feeds.empty();
+        return m_Started;
+    }
+
+    void Stop()
+    {
+        if(!m_Started)
+        {
+            return;
+        }
+        for(size_t i = m_Feeds.size(); i > 0; i--)
+        {
+            m_Feeds[i - 1]->Stop();
+        }
+        m_Started = false;
+    }
+
+    int GetFeedCount() const
+    {
+        return (int)m_Feeds.size();
+    }
+
+    const TFeedConfig& GetFeedConfig(int index) const
+    {
+        return m_Config.Feeds[index];
+    }
+
+    void GetStats(int index, TFeedStats& stats) const
+    {
+        m_Publishers[index]->GetStats(stats);
+    }
+
+    SnapshotBoard& GetBoard()
+    {
+        return m_Board;
+    }
+
+    const std::string& GetError() const
+    {
+        return m_Error;
+    }
+private:
+    MarketGateway(const MarketGateway&);
+    MarketGateway& operator=(const MarketGateway&);
+private:
+    TGatewayConfig m_Config;
+    MarketFeedRegistry m_Registry;
+    SnapshotBoard m_Board;
+    std::vector<void*> m_Plugins;
+    std::vector<MarketFeed*> m_Feeds;
+    std::vector<FeedPublisher*> m_Publishers;
+    std::string m_Error;
+    bool m_Started;
+};
+
+}
+
+#endif // MARKETGATEWAY_HPP
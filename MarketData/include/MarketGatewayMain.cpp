@@ -0,0 +1,113 @@
+// 多行情源网关
+// 每台主机一个网关进程，按YAML配置加载柜台插件并启动各行情源，行情经CPP-IPC通道及快照表发布。
+//
+//   MarketGateway -c MarketGateway.yml [-x]
+//
+// 配置示例，CPU编号从0开始：
+//   IPCPrefix: MD
+//   BoardName: /MarketBoard
+//   MainCpu: 1
+//   Plugins: [./libXTPMarketFeed.so, ./libMDSMarketFeed.so]
+//   Feeds:
+//     - {Name: XTP, Vendor: XTP, Source: 1, Protocol: UDP, FrontAddress: ["10.0.0.1:6002"], UserID: "...",
+//        Password: "...", RecvCpus: [2], ParseCpus: [3], Instruments: [600000.SH, 000001.SZ]}
+//     - {Name: MDS, Vendor: MDS, Source: 2, ConfigFile: ./mds_client.conf, RecvCpus: [4], CallbackCpu: 5,
+//        Instruments: [600000.SH]}
+
+#include "MarketGateway.hpp"
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t g_Running = 1;
+
+static void OnSignal(int)
+{
+    g_Running = 0;
+}
+
+static void Usage()
+{
+    fprintf(stderr, "\nusage:\n");
+    fprintf(stderr, "  MarketGateway [options]\n");
+    fprintf(stderr, "\noptions:\n");
+    fprintf(stderr, "  -c <file>                  - gateway config\n");
+    fprintf(stderr, "  -x                         - clear stale channels before start\n");
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void PrintStats(MarketData::MarketGateway& gateway)
+{
+    MarketData::TFeedStats stats;
+    for(int i = 0; i < gateway.GetFeedCount(); i++)
+    {
+        gateway.GetStats(i, stats);
+        fprintf(stderr, "feed %s connected %d received %lu published %lu dropped %lu unregistered %lu invalid %lu last %ld\n",
+                gateway.GetFeedConfig(i).Name.c_str(), stats.Connected, stats.Received, stats.Published, stats.Dropped,
+                stats.Unregistered, stats.Invalid, stats.LastRecvTime);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* configPath = NULL;
+    bool clear = false;
+    int c;
+    while((c = getopt(argc, argv, "c:x")) != -1)
+    {
+        switch(c)
+        {
+        case 'c':
+            configPath = optarg;
+            break;
+        case 'x':
+            clear = true;
+            break;
+        default:
+            Usage();
+        }
+    }
+    if(configPath == NULL)
+    {
+        Usage();
+    }
+
+    MarketData::TGatewayConfig config;
+    std::string error;
+    if(!MarketData::MarketGateway::LoadConfig(configPath, config, error))
+    {
+        fprintf(stderr, "ERROR: %s\n", error.c_str());
+        return 1;
+    }
+    if(clear)
+    {
+        MarketData::MarketGateway::ClearChannels(config);
+    }
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    MarketData::MarketGateway gateway;
+    if(!gateway.Init(config) || !gateway.Start())
+    {
+        fprintf(stderr, "ERROR: %s\n", gateway.GetError().c_str());
+        return 1;
+    }
+    fprintf(stderr, "MarketGateway started %d feeds, board %s %d instruments\n", gateway.GetFeedCount(),
+            config.BoardName.c_str(), gateway.GetBoard().Count());
+    int elapsed = 0;
+    while(g_Running)
+    {
+        sleep(1);
+        if(config.StatsInterval > 0 && ++elapsed >= config.StatsInterval)
+        {
+            PrintStats(gateway);
+            elapsed = 0;
+        }
+    }
+    gateway.Stop();
+    PrintStats(gateway);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 MarketGatewayMain.cpp -o MarketGateway -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include -I../../YAMLUtil/include -I../../CPP-IPC/include -I../../YAML-CPP/0.8.0/include -L../../CPP-IPC/lib -L../../YAML-CPP/0.8.0/lib -lipc -lyaml-cpp -ldl -lrt
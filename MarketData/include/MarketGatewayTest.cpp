@@ -0,0 +1,371 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "TORATstpLev2ApiStruct.h"
+#include "mds_api/mds_async_api.h"
+#include "REMMarketFeed.hpp"
+#include "EESQuoteArbiter.hpp"
+#include "MarketGateway.hpp"
+#include "HRTimer.hpp"
+
+static const char* CONFIG =
+    "IPCPrefix: MarketGatewayTest\n"
+    "BoardName: /MarketGatewayTest\n"
+    "BoardCapacity: 16\n"
+    "StatsInterval: 0\n"
+    "Feeds:\n"
+    "  - Name: MockA\n"
+    "    Vendor: Mock\n"
+    "    Source: 1\n"
+    "    CallbackCpu: 0\n"
+    "    Instruments: [600000.SH, 000001.SZ]\n"
+    "  - Name: MockB\n"
+    "    Vendor: Mock\n"
+    "    Source: 2\n"
+    "    MultiThreaded: true\n"
+    "    Instruments: [rb2410]\n";
+
+// 模拟柜台，Start后在自建线程上按订阅合约推送行情，Stop等待推送线程结束
+class MockMarketFeed: public MarketData::MarketFeed
+{
+public:
+    enum {TICK_COUNT = 100};
+
+    virtual bool Init(const MarketData::TFeedConfig& config, MarketData::FeedSink* sink)
+    {
+        MarketData::MarketFeed::Init(config, sink);
+        m_Sink->SetCallbackCpu(m_Config.CallbackCpu);
+        return !m_Config.Instruments.empty();
+    }
+
+    virtual bool Start()
+    {
+        m_Thread = std::thread(&MockMarketFeed::Run, this);
+        return true;
+    }
+
+    virtual void Stop()
+    {
+        if(m_Thread.joinable())
+        {
+            m_Thread.join();
+        }
+    }
+
+    void Run()
+    {
+        m_Sink->OnStatus(true, "mock");
+        MarketData::TMarketTick tick;
+        std::string code;
+        std::string exchange;
+        for(int i = 1; i <= TICK_COUNT; i++)
+        {
+            for(size_t j = 0; j < m_Config.Instruments.size(); j++)
+            {
+                SplitInstrument(m_Config.Instruments[j], code, exchange);
+                memset(&tick, 0, sizeof(tick));
+                strncpy(tick.InstrumentID, code.c_str(), sizeof(tick.InstrumentID) - 1);
+                strncpy(tick.ExchangeID, exchange == "SH" ? "SSE" : exchange == "SZ" ? "SZSE" : "", sizeof(tick.ExchangeID) - 1);
+                tick.Volume = i;
+                tick.LastPrice = 10 + i * 0.01;
+                m_Sink->OnTick(tick, GetTimeNs());
+            }
+        }
+        // 快照表中未注册的合约只发送到通道
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, "unknown", sizeof(tick.InstrumentID) - 1);
+        m_Sink->OnTick(tick, GetTimeNs());
+        m_Sink->OnInvalid();
+    }
+private:
+    std::thread m_Thread;
+};
+
+static void TestConfig()
+{
+    MarketData::TGatewayConfig config;
+    YAMLUtil::SchemaLoader loader;
+    assert(loader.LoadString(CONFIG, config));
+    assert(config.IPCPrefix == "MarketGatewayTest" && config.BoardCapacity == 16 && config.MainCpu == -1);
+    assert(config.Feeds.size() == 2);
+    assert(config.Feeds[0].Name == "MockA" && config.Feeds[0].Source == 1 && config.Feeds[0].CallbackCpu == 0);
+    assert(config.Feeds[0].Instruments.size() == 2 && !config.Feeds[0].MultiThreaded);
+    assert(config.Feeds[1].MultiThreaded && config.Feeds[1].CallbackCpu == -1 && config.Feeds[1].BufferSize == 512);
+
+    // 缺少Feeds
+    MarketData::TGatewayConfig missing;
+    assert(!loader.LoadString("IPCPrefix: MD\nBoardName: /MD\n", missing));
+    assert(loader.GetError().Path.find("Feeds") != std::string::npos);
+
+    std::vector<int> cpus;
+    cpus.push_back(0);
+    cpus.push_back(5);
+    assert(MarketData::MarketFeed::FormatCpuList(cpus) == "0,5");
+    assert(MarketData::MarketFeed::FormatCpuList(cpus, 1) == "1,6");
+    std::string ip;
+    int port = 0;
+    assert(MarketData::MarketFeed::SplitAddress("10.0.0.1:6002", ip, port) && ip == "10.0.0.1" && port == 6002);
+    assert(!MarketData::MarketFeed::SplitAddress("10.0.0.1", ip, port));
+}
+
+static void TestGateway()
+{
+    MarketData::TGatewayConfig config;
+    YAMLUtil::SchemaLoader loader;
+    assert(loader.LoadString(CONFIG, config));
+    MarketData::MarketGateway::ClearChannels(config);
+    MarketData::SnapshotBoard::Remove(config.BoardName.c_str());
+
+    // 未注册的柜台与重名行情源
+    {
+        MarketData::MarketGateway gateway;
+        assert(!gateway.Init(config));
+        assert(gateway.GetError().find("unknown vendor Mock") != std::string::npos);
+    }
+    {
+        MarketData::TGatewayConfig duplicate = config;
+        duplicate.Feeds[1].Name = "MockA";
+        MarketData::MarketGateway gateway;
+        gateway.GetRegistry().Register("Mock", &MarketData::CreateMarketFeed<MockMarketFeed>);
+        assert(!gateway.Init(duplicate));
+        assert(gateway.GetError() == "duplicate feed MockA");
+        assert(!gateway.LoadPlugin("./libNotExist.so"));
+    }
+
+    MarketData::MarketGateway gateway;
+    assert(gateway.GetRegistry().Register("Mock", &MarketData::CreateMarketFeed<MockMarketFeed>));
+    assert(!gateway.GetRegistry().Register("Mock", &MarketData::CreateMarketFeed<MockMarketFeed>));
+    assert(gateway.Init(config));
+    assert(gateway.GetFeedCount() == 2 && gateway.GetBoard().Count() == 3);
+
+    char name[128] = {0};
+    MarketData::MarketGateway::GetChannelName(config.IPCPrefix, "MockA", name, sizeof(name));
+    ipc::route receiverA(name, ipc::receiver);
+    MarketData::MarketGateway::GetChannelName(config.IPCPrefix, "MockB", name, sizeof(name));
+    ipc::channel receiverB(name, ipc::receiver);
+    // 发布端不等待接收端，通道满时丢弃，接收数须与发布数一致
+    std::atomic<bool> stopped(false);
+    uint64_t receivedA = 0;
+    uint64_t receivedB = 0;
+    std::thread threadA([&]()
+    {
+        while(true)
+        {
+            ipc::buff_t buffer = receiverA.recv(100);
+            if(buffer.empty())
+            {
+                if(stopped)
+                {
+                    break;
+                }
+                continue;
+            }
+            assert(buffer.size() == sizeof(MarketData::TMarketTick));
+            const MarketData::TMarketTick* tick = (const MarketData::TMarketTick*)buffer.data();
+            assert(tick->Source == 1 && tick->RecvTime > 0);
+            receivedA++;
+        }
+    });
+    std::thread threadB([&]()
+    {
+        while(true)
+        {
+            ipc::buff_t buffer = receiverB.recv(100);
+            if(buffer.empty())
+            {
+                if(stopped)
+                {
+                    break;
+                }
+                continue;
+            }
+            assert(((const MarketData::TMarketTick*)buffer.data())->Source == 2);
+            receivedB++;
+        }
+    });
+    assert(gateway.Start());
+    gateway.Stop();
+    stopped = true;
+    threadA.join();
+    threadB.join();
+
+    MarketData::TFeedStats stats;
+    gateway.GetStats(0, stats);
+    assert(stats.Connected && stats.Received == MockMarketFeed::TICK_COUNT * 2 + 1);
+    assert(stats.Published + stats.Dropped == stats.Received && stats.Published == receivedA && stats.Published > 0);
+    assert(stats.Unregistered == 1 && stats.Invalid == 1 && stats.LastRecvTime > 0);
+    gateway.GetStats(1, stats);
+    assert(stats.Received == MockMarketFeed::TICK_COUNT + 1 && stats.Unregistered == 1);
+    assert(stats.Published + stats.Dropped == stats.Received && stats.Published == receivedB && stats.Published > 0);
+
+    // 其他进程从快照表读取各合约最新行情
+    MarketData::SnapshotBoard reader;
+    assert(reader.Open(config.BoardName.c_str()));
+    const char* instruments[] = {"600000.SH", "000001.SZ", "rb2410"};
+    for(int i = 0; i < 3; i++)
+    {
+        int slot = reader.Resolve(instruments[i]);
+        assert(slot != MarketData::SnapshotBoard::INVALID_SLOT);
+        MarketData::TMarketTick tick;
+        assert(reader.Read(slot, tick));
+        assert(tick.Volume == MockMarketFeed::TICK_COUNT && tick.Source == (i < 2 ? 1 : 2));
+    }
+    MarketData::SnapshotBoard::Remove(config.BoardName.c_str());
+}
+
+// REM适配经模拟行情接口完成登录、订阅与行情发布
+static void TestREMFeed()
+{
+    MarketData::SnapshotBoard::Remove("/MarketGatewayTestREM");
+    MarketData::SnapshotBoard board;
+    assert(board.Create("/MarketGatewayTestREM", 4));
+    int slot = board.Register("IF2406");
+    MarketData::TFeedConfig config;
+    config.Name = "REM";
+    config.Vendor = "REM";
+    config.Source = 3;
+    config.FrontAddress.push_back("127.0.0.1:20000");
+    config.Instruments.push_back("IF2406");
+    ipc::route::clear_storage("MarketGatewayTest.REM");
+    MarketData::FeedPublisher publisher;
+    assert(publisher.Init("MarketGatewayTest.REM", config, &board));
+
+    MarketData::REMMarketFeed feed;
+    assert(feed.Init(config, &publisher));
+    MarketData::EESMockQuoteApi api;
+    feed.SetApi(&api);
+    assert(feed.Start());
+
+    EESMarketDepthQuoteData quote;
+    memset(&quote, 0, sizeof(quote));
+    strncpy(quote.InstrumentID, "IF2406", sizeof(quote.InstrumentID) - 1);
+    snprintf(quote.TradingDay, sizeof(quote.TradingDay), "20240603");
+    snprintf(quote.UpdateTime, sizeof(quote.UpdateTime), "09:30:01");
+    quote.UpdateMillisec = 500;
+    quote.LastPrice = 3600.2;
+    quote.BidPrice1 = 3600;
+    quote.BidVolume1 = 3;
+    quote.AskPrice1 = 3600.4;
+    quote.AskVolume1 = 5;
+    quote.Volume = 1000;
+    api.Push(EQS_FUTURE, &quote);
+
+    MarketData::TMarketTick tick;
+    assert(board.Read(slot, tick));
+    assert(strcmp(tick.InstrumentID, "IF2406") == 0 && tick.Source == 3 && tick.TradingDay == 20240603);
+    assert(tick.DepthLevels == 5 && tick.LastPrice == 3600.2 && tick.BidVolume[0] == 3 && tick.AskPrice[0] == 3600.4);
+    assert(tick.ExchangeTime == (9 * 3600 + 30 * 60 + 1) * 1000000000LL + 500000000LL);
+    MarketData::TFeedStats stats;
+    publisher.GetStats(stats);
+    assert(stats.Connected && stats.Received == 1 && stats.Dropped == 1);
+    feed.Stop();
+    publisher.GetStats(stats);
+    assert(!stats.Connected);
+    MarketData::SnapshotBoard::Remove("/MarketGatewayTestREM");
+}
+
+static void TestConvert()
+{
+    TORALEV2API::CTORATstpLev2MarketDataField tora;
+    memset(&tora, 0, sizeof(tora));
+    strncpy(tora.SecurityID, "600000", sizeof(tora.SecurityID) - 1);
+    tora.ExchangeID = TORALEV2API::TORA_TSTP_EXD_SSE;
+    tora.DataTimeStamp = 93000250;
+    tora.LastPrice = 10.5;
+    tora.BidPrice1 = 10.49;
+    tora.BidVolume10 = 700;
+    tora.AskPrice10 = 10.6;
+    tora.TotalVolumeTrade = 12345;
+    MarketData::TMarketTick tick;
+    MarketData::TickAdapter::Convert(tora, tick);
+    assert(strcmp(tick.InstrumentID, "600000") == 0 && strcmp(tick.ExchangeID, "SSE") == 0);
+    assert(tick.ExchangeTime == (9 * 3600 + 30 * 60) * 1000000000LL + 250000000LL);
+    assert(tick.DepthLevels == 10 && tick.LastPrice == 10.5 && tick.BidPrice[0] == 10.49);
+    assert(tick.BidVolume[9] == 700 && tick.AskPrice[9] == 10.6 && tick.Volume == 12345);
+
+    MdsMktDataSnapshotT mds;
+    memset(&mds, 0, sizeof(mds));
+    mds.head.exchId = MDS_EXCH_SZSE;
+    mds.head.tradeDate = 20240603;
+    mds.head.updateTime = 145959000;
+    mds.head.bodyType = MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT;
+    strncpy(mds.l2Stock.SecurityID, "000001", sizeof(mds.l2Stock.SecurityID) - 1);
+    mds.l2Stock.TradePx = 105000;
+    mds.l2Stock.BidLevels[9].Price = 104100;
+    mds.l2Stock.OfferLevels[0].OrderQty = 800;
+    assert(MarketData::TickAdapter::Convert(mds, tick));
+    assert(strcmp(tick.InstrumentID, "000001") == 0 && strcmp(tick.ExchangeID, "SZSE") == 0 && tick.TradingDay == 20240603);
+    assert(tick.ExchangeTime == (14 * 3600 + 59 * 60 + 59) * 1000000000LL);
+    assert(tick.DepthLevels == 10 && tick.LastPrice == 10.5 && tick.BidPrice[9] == 10.41 && tick.AskVolume[0] == 800);
+    mds.head.bodyType = MDS_MSGTYPE_INDEX_SNAPSHOT_FULL_REFRESH;
+    assert(!MarketData::TickAdapter::Convert(mds, tick));
+}
+
+int main(int argc, char* argv[])
+{
+    TestConfig();
+    TestGateway();
+    TestREMFeed();
+    TestConvert();
+
+    // 回调线程上发布一笔行情：快照表更新及通道发送
+    MarketData::SnapshotBoard::Remove("/MarketGatewayTestBench");
+    MarketData::SnapshotBoard board;
+    assert(board.Create("/MarketGatewayTestBench", 4));
+    board.Register("rb2410");
+    // 沪深相同代码按交易所后缀区分
+    {
+        char key[MarketData::TMarketTick::INSTRUMENT_ID_LEN];
+        MarketData::MarketFeed::FormatBoardKey("000001", "SSE", key, sizeof(key));
+        assert(strcmp(key, "000001.SH") == 0);
+        MarketData::MarketFeed::FormatBoardKey("000001", "SZ", key, sizeof(key));
+        assert(strcmp(key, "000001.SZ") == 0);
+        MarketData::MarketFeed::FormatBoardKey("rb2410", "SHFE", key, sizeof(key));
+        assert(strcmp(key, "rb2410") == 0);
+    }
+    int shSlot = board.Register("000001.SH");
+    int szSlot = board.Register("000001.SZ");
+    assert(shSlot != szSlot);
+    MarketData::TFeedConfig config;
+    config.Name = "Bench";
+    ipc::route::clear_storage("MarketGatewayTest.Bench");
+    MarketData::FeedPublisher publisher;
+    assert(publisher.Init("MarketGatewayTest.Bench", config, &board));
+    MarketData::TMarketTick tick;
+    MarketData::TFeedStats stats;
+    // 无接收端时不发送，计为丢弃
+    memset(&tick, 0, sizeof(tick));
+    strncpy(tick.InstrumentID, "000001", sizeof(tick.InstrumentID) - 1);
+    strncpy(tick.ExchangeID, "SZSE", sizeof(tick.ExchangeID) - 1);
+    tick.Volume = 7;
+    publisher.OnTick(tick, 1);
+    publisher.GetStats(stats);
+    assert(stats.Dropped == 1 && stats.Published == 0 && stats.Unregistered == 0);
+    assert(board.Read(szSlot, tick) && tick.Volume == 7);
+    assert(board.Read(shSlot, tick) && tick.Volume == 0);
+    ipc::route receiver("MarketGatewayTest.Bench", ipc::receiver);
+    memset(&tick, 0, sizeof(tick));
+    strncpy(tick.InstrumentID, "rb2410", sizeof(tick.InstrumentID) - 1);
+    const int N = 100000;
+    TimeUtil::HRTimer timer;
+    int64_t elapsed = 0;
+    for(int i = 0; i < N; i++)
+    {
+        tick.Volume = i;
+        int64_t start = timer.GetTimeNs();
+        publisher.OnTick(tick, start);
+        elapsed += timer.GetTimeNs() - start;
+        receiver.recv(0);
+    }
+    publisher.GetStats(stats);
+    assert(stats.Received == (uint64_t)N + 1 && stats.Unregistered == 0);
+    fprintf(stderr, "FeedPublisher OnTick Latency: %.1f ns, published %lu dropped %lu\n", (double)elapsed / N,
+            stats.Published, stats.Dropped);
+    MarketData::SnapshotBoard::Remove("/MarketGatewayTestBench");
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 MarketGatewayTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include -I../../YAMLUtil/include -I../../CPP-IPC/include -I../../YAML-CPP/0.8.0/include -I../../REM/3.1.3.49/include -I../../Tora/lev2mdapi_4.0.7/include -I../../OES/0.17.4.1/include -L../../CPP-IPC/lib -L../../YAML-CPP/0.8.0/lib -L../../REM/3.1.3.49/lib -L../../OES/0.17.4.1/lib -lipc -lyaml-cpp -lEESQuoteApi -l:liboes_0.17.4.1.a -ldl -lrt -lm
@@ -0,0 +1,308 @@
+#ifndef MARKETTICK_HPP
+#define MARKETTICK_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace MarketData
+{
+
+// 统一行情快照格式，各柜台行情回调及离线解码统一转换为此格式
+// 价格为0表示该档无报价，成交量、成交额为交易日内累计值，与柜台原始字段一致
+struct alignas(64) TMarketTick
+{
+    enum
+    {
+        DEPTH_LEVELS = 10,
+        INSTRUMENT_ID_LEN = 32,
+        EXCHANGE_ID_LEN = 8
+    };
+    char InstrumentID[INSTRUMENT_ID_LEN];
+    char ExchangeID[EXCHANGE_ID_LEN];
+    uint32_t TradingDay;        // YYYYMMDD
+    uint32_t ActionDay;         // 行情自然日YYYYMMDD，夜盘时与TradingDay不同
+    int64_t ExchangeTime;       // 交易所行情时间，ActionDay当地零点起算纳秒
+    int64_t RecvTime;           // 本地接收时间，UTC纳秒
+    uint64_t Sequence;          // 源行情序号，无则为0
+    uint16_t Source;            // 行情源编号
+    uint8_t DepthLevels;        // 有效档位数
+    uint8_t Reserved[5];
+    double LastPrice;
+    double PreClosePrice;
+    double PreSettlementPrice;
+    double OpenPrice;
+    double HighPrice;
+    double LowPrice;
+    double UpperLimitPrice;
+    double LowerLimitPrice;
+    int64_t Volume;
+    double Turnover;
+    double OpenInterest;
+    double BidPrice[DEPTH_LEVELS];
+    double AskPrice[DEPTH_LEVELS];
+    int64_t BidVolume[DEPTH_LEVELS];
+    int64_t AskVolume[DEPTH_LEVELS];
+};
+
+// 交易日起点，与ydUtil.h的START_HOUR一致，夜盘跨零点后交易日内时间仍单调递增
+enum
+{
+    TRADING_DAY_START_HOUR = 17
+};
+
+static const int64_t NANOS_PER_DAY = 86400LL * 1000000000LL;
+
+// 当地零点起算纳秒转换为交易日起点起算纳秒
+inline int64_t ToTradingTime(int64_t timeOfDay)
+{
+    int64_t t = timeOfDay - TRADING_DAY_START_HOUR * 3600LL * 1000000000LL;
+    return t < 0 ? t + NANOS_PER_DAY : t;
+}
+
+inline int64_t FromTradingTime(int64_t tradingTime)
+{
+    int64_t t = tradingTime + TRADING_DAY_START_HOUR * 3600LL * 1000000000LL;
+    return t >= NANOS_PER_DAY ? t - NANOS_PER_DAY : t;
+}
+
+// "HH:MM:SS"与毫秒转换为当地零点起算纳秒
+inline int64_t ParseTimeOfDay(const char* hhmmss, int millisec = 0)
+{
+    int64_t hour = (hhmmss[0] - '0') * 10 + (hhmmss[1] - '0');
+    int64_t minute = (hhmmss[3] - '0') * 10 + (hhmmss[4] - '0');
+    int64_t second = (hhmmss[6] - '0') * 10 + (hhmmss[7] - '0');
+    return ((hour * 60 + minute) * 60 + second) * 1000000000LL + millisec * 1000000LL;
+}
+
+// 柜台价格字段中的无效值(DBL_MAX等)统一置0
+inline double NormalizePrice(double price)
+{
+    return (price > 1e15 || price < -1e15) ? 0.0 : price;
+}
+
+// 柜台行情结构体适配，需在本头文件之前包含对应柜台头文件
+struct TickAdapter
+{
+#ifdef THOST_FTDCSTRUCT_H
+    // CTP OnRtnDepthMarketData，五档
+    static inline void Convert(const CThostFtdcDepthMarketDataField& data, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, data.InstrumentID, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, data.ExchangeID, sizeof(tick.ExchangeID) - 1);
+        tick.TradingDay = (uint32_t)atoi(data.TradingDay);
+        tick.ActionDay = (uint32_t)atoi(data.ActionDay);
+        tick.ExchangeTime = ParseTimeOfDay(data.UpdateTime, data.UpdateMillisec);
+        tick.DepthLevels = 5;
+        tick.LastPrice = NormalizePrice(data.LastPrice);
+        tick.PreClosePrice = NormalizePrice(data.PreClosePrice);
+        tick.PreSettlementPrice = NormalizePrice(data.PreSettlementPrice);
+        tick.OpenPrice = NormalizePrice(data.OpenPrice);
+        tick.HighPrice = NormalizePrice(data.HighestPrice);
+        tick.LowPrice = NormalizePrice(data.LowestPrice);
+        tick.UpperLimitPrice = NormalizePrice(data.UpperLimitPrice);
+        tick.LowerLimitPrice = NormalizePrice(data.LowerLimitPrice);
+        tick.Volume = data.Volume;
+        tick.Turnover = data.Turnover;
+        tick.OpenInterest = data.OpenInterest;
+        const double bidPrice[5] = {data.BidPrice1, data.BidPrice2, data.BidPrice3, data.BidPrice4, data.BidPrice5};
+        const double askPrice[5] = {data.AskPrice1, data.AskPrice2, data.AskPrice3, data.AskPrice4, data.AskPrice5};
+        const int bidVolume[5] = {data.BidVolume1, data.BidVolume2, data.BidVolume3, data.BidVolume4, data.BidVolume5};
+        const int askVolume[5] = {data.AskVolume1, data.AskVolume2, data.AskVolume3, data.AskVolume4, data.AskVolume5};
+        for(int i = 0; i < 5; i++)
+        {
+            tick.BidPrice[i] = NormalizePrice(bidPrice[i]);
+            tick.AskPrice[i] = NormalizePrice(askPrice[i]);
+            tick.BidVolume[i] = bidVolume[i];
+            tick.AskVolume[i] = askVolume[i];
+        }
+    }
+#endif
+
+#ifdef _XQUOTE_API_STRUCT_H_
+    // XTP OnDepthMarketData，data_time为YYYYMMDDHHMMSSsss，现货无结算价及持仓量
+    static inline void Convert(const XTPMarketDataStruct& data, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, data.ticker, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, data.exchange_id == XTP_EXCHANGE_SH ? "SSE" : "SZSE", sizeof(tick.ExchangeID) - 1);
+        int64_t day = data.data_time / 1000000000LL;
+        int64_t hhmmsssss = data.data_time % 1000000000LL;
+        tick.TradingDay = (uint32_t)day;
+        tick.ActionDay = (uint32_t)day;
+        tick.ExchangeTime = ((hhmmsssss / 10000000 * 60 + hhmmsssss / 100000 % 100) * 60 + hhmmsssss / 1000 % 100) * 1000000000LL +
+                            hhmmsssss % 1000 * 1000000LL;
+        tick.DepthLevels = TMarketTick::DEPTH_LEVELS;
+        tick.LastPrice = data.last_price;
+        tick.PreClosePrice = data.pre_close_price;
+        tick.PreSettlementPrice = data.pre_settl_price;
+        tick.OpenPrice = data.open_price;
+        tick.HighPrice = data.high_price;
+        tick.LowPrice = data.low_price;
+        tick.UpperLimitPrice = data.upper_limit_price;
+        tick.LowerLimitPrice = data.lower_limit_price;
+        tick.Volume = data.qty;
+        tick.Turnover = data.turnover;
+        tick.OpenInterest = (double)data.total_long_positon;
+        memcpy(tick.BidPrice, data.bid, sizeof(tick.BidPrice));
+        memcpy(tick.AskPrice, data.ask, sizeof(tick.AskPrice));
+        memcpy(tick.BidVolume, data.bid_qty, sizeof(tick.BidVolume));
+        memcpy(tick.AskVolume, data.ask_qty, sizeof(tick.AskVolume));
+    }
+#endif
+
+#ifdef YD_DATA_STRUCT_H
+    // YD notifyMarketData，一档，TimeStamp为START_HOUR起算毫秒
+    static inline void Convert(const YDMarketData& data, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        const YDInstrument* instrument = data.m_pInstrument;
+        strncpy(tick.InstrumentID, instrument->InstrumentID, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, instrument->m_pExchange->ExchangeID, sizeof(tick.ExchangeID) - 1);
+        tick.TradingDay = (uint32_t)data.TradingDay;
+        tick.ExchangeTime = FromTradingTime((int64_t)data.TimeStamp * 1000000LL);
+        tick.DepthLevels = 1;
+        tick.LastPrice = NormalizePrice(data.LastPrice);
+        tick.PreClosePrice = NormalizePrice(data.PreClosePrice);
+        tick.PreSettlementPrice = NormalizePrice(data.PreSettlementPrice);
+        tick.UpperLimitPrice = NormalizePrice(data.UpperLimitPrice);
+        tick.LowerLimitPrice = NormalizePrice(data.LowerLimitPrice);
+        tick.Volume = data.Volume;
+        tick.Turnover = data.Turnover;
+        tick.OpenInterest = data.OpenInterest;
+        tick.BidPrice[0] = NormalizePrice(data.BidPrice);
+        tick.AskPrice[0] = NormalizePrice(data.AskPrice);
+        tick.BidVolume[0] = data.BidVolume;
+        tick.AskVolume[0] = data.AskVolume;
+    }
+#endif
+
+#ifdef EES_EQS_ID_LEN
+    // REM EES OnQuoteUpdated，五档
+    static inline void Convert(const EESMarketDepthQuoteData& data, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, data.InstrumentID, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, data.ExchangeID, sizeof(tick.ExchangeID) - 1);
+        tick.TradingDay = (uint32_t)atoi(data.TradingDay);
+        tick.ExchangeTime = ParseTimeOfDay(data.UpdateTime, data.UpdateMillisec);
+        tick.DepthLevels = 5;
+        tick.LastPrice = NormalizePrice(data.LastPrice);
+        tick.PreClosePrice = NormalizePrice(data.PreClosePrice);
+        tick.PreSettlementPrice = NormalizePrice(data.PreSettlementPrice);
+        tick.OpenPrice = NormalizePrice(data.OpenPrice);
+        tick.HighPrice = NormalizePrice(data.HighestPrice);
+        tick.LowPrice = NormalizePrice(data.LowestPrice);
+        tick.UpperLimitPrice = NormalizePrice(data.UpperLimitPrice);
+        tick.LowerLimitPrice = NormalizePrice(data.LowerLimitPrice);
+        tick.Volume = data.Volume;
+        tick.Turnover = data.Turnover;
+        tick.OpenInterest = (double)data.OpenInterest;
+        const double bidPrice[5] = {data.BidPrice1, data.BidPrice2, data.BidPrice3, data.BidPrice4, data.BidPrice5};
+        const double askPrice[5] = {data.AskPrice1, data.AskPrice2, data.AskPrice3, data.AskPrice4, data.AskPrice5};
+        const int bidVolume[5] = {data.BidVolume1, data.BidVolume2, data.BidVolume3, data.BidVolume4, data.BidVolume5};
+        const int askVolume[5] = {data.AskVolume1, data.AskVolume2, data.AskVolume3, data.AskVolume4, data.AskVolume5};
+        for(int i = 0; i < 5; i++)
+        {
+            tick.BidPrice[i] = NormalizePrice(bidPrice[i]);
+            tick.AskPrice[i] = NormalizePrice(askPrice[i]);
+            tick.BidVolume[i] = bidVolume[i];
+            tick.AskVolume[i] = askVolume[i];
+        }
+    }
+#endif
+
+#ifdef _TORA_TSTPLEV2APISTRUCT_H
+    // 华鑫Tora Level2 OnRtnMarketData，十档，DataTimeStamp为HHMMSSsss，结构体中无交易日
+    static inline void Convert(const TORALEV2API::CTORATstpLev2MarketDataField& data, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, data.SecurityID, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, data.ExchangeID == TORALEV2API::TORA_TSTP_EXD_SSE ? "SSE" : "SZSE", sizeof(tick.ExchangeID) - 1);
+        int64_t timestamp = data.DataTimeStamp;
+        tick.ExchangeTime = ((timestamp / 10000000 * 60 + timestamp / 100000 % 100) * 60 + timestamp / 1000 % 100) * 1000000000LL +
+                            timestamp % 1000 * 1000000LL;
+        tick.DepthLevels = TMarketTick::DEPTH_LEVELS;
+        tick.LastPrice = NormalizePrice(data.LastPrice);
+        tick.PreClosePrice = NormalizePrice(data.PreClosePrice);
+        tick.OpenPrice = NormalizePrice(data.OpenPrice);
+        tick.HighPrice = NormalizePrice(data.HighestPrice);
+        tick.LowPrice = NormalizePrice(data.LowestPrice);
+        tick.UpperLimitPrice = NormalizePrice(data.UpperLimitPrice);
+        tick.LowerLimitPrice = NormalizePrice(data.LowerLimitPrice);
+        tick.Volume = data.TotalVolumeTrade;
+        tick.Turnover = data.TotalValueTrade;
+        const double bidPrice[10] = {data.BidPrice1, data.BidPrice2, data.BidPrice3, data.BidPrice4, data.BidPrice5,
+                                     data.BidPrice6, data.BidPrice7, data.BidPrice8, data.BidPrice9, data.BidPrice10};
+        const double askPrice[10] = {data.AskPrice1, data.AskPrice2, data.AskPrice3, data.AskPrice4, data.AskPrice5,
+                                     data.AskPrice6, data.AskPrice7, data.AskPrice8, data.AskPrice9, data.AskPrice10};
+        const int64_t bidVolume[10] = {data.BidVolume1, data.BidVolume2, data.BidVolume3, data.BidVolume4, data.BidVolume5,
+                                       data.BidVolume6, data.BidVolume7, data.BidVolume8, data.BidVolume9, data.BidVolume10};
+        const int64_t askVolume[10] = {data.AskVolume1, data.AskVolume2, data.AskVolume3, data.AskVolume4, data.AskVolume5,
+                                       data.AskVolume6, data.AskVolume7, data.AskVolume8, data.AskVolume9, data.AskVolume10};
+        for(int i = 0; i < 10; i++)
+        {
+            tick.BidPrice[i] = NormalizePrice(bidPrice[i]);
+            tick.AskPrice[i] = NormalizePrice(askPrice[i]);
+            tick.BidVolume[i] = bidVolume[i];
+            tick.AskVolume[i] = askVolume[i];
+        }
+    }
+#endif
+
+#ifdef _MDS_MKT_PACKETS_H
+    // MDS L1/L2股票、期权快照，价格及金额单位为0.0001元，其余快照类型返回false
+    // 消息类型eMdsMsgTypeT定义在mds_mkt_packets.h，仅包含mds_base_model.h时不启用
+    static inline bool Convert(const MdsMktDataSnapshotT& data, TMarketTick& tick)
+    {
+        switch(data.head.bodyType)
+        {
+        case MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT:
+            ConvertMdsBody(data.head, data.l2Stock, 10, tick);
+            return true;
+        case MDS_MSGTYPE_MARKET_DATA_SNAPSHOT_FULL_REFRESH:
+            ConvertMdsBody(data.head, data.stock, 5, tick);
+            return true;
+        case MDS_MSGTYPE_OPTION_SNAPSHOT_FULL_REFRESH:
+            ConvertMdsBody(data.head, data.option, 5, tick);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    template<class Body>
+    static inline void ConvertMdsBody(const MdsMktDataSnapshotHeadT& head, const Body& body, int levels, TMarketTick& tick)
+    {
+        memset(&tick, 0, sizeof(tick));
+        strncpy(tick.InstrumentID, body.SecurityID, sizeof(tick.InstrumentID) - 1);
+        strncpy(tick.ExchangeID, head.exchId == MDS_EXCH_SSE ? "SSE" : "SZSE", sizeof(tick.ExchangeID) - 1);
+        tick.TradingDay = (uint32_t)head.tradeDate;
+        tick.ActionDay = (uint32_t)head.tradeDate;
+        int64_t timestamp = head.updateTime;
+        tick.ExchangeTime = ((timestamp / 10000000 * 60 + timestamp / 100000 % 100) * 60 + timestamp / 1000 % 100) * 1000000000LL +
+                            timestamp % 1000 * 1000000LL;
+        tick.DepthLevels = (uint8_t)levels;
+        tick.LastPrice = body.TradePx / 10000.0;
+        tick.PreClosePrice = body.PrevClosePx / 10000.0;
+        tick.OpenPrice = body.OpenPx / 10000.0;
+        tick.HighPrice = body.HighPx / 10000.0;
+        tick.LowPrice = body.LowPx / 10000.0;
+        tick.Volume = (int64_t)body.TotalVolumeTraded;
+        tick.Turnover = body.TotalValueTraded / 10000.0;
+        tick.OpenInterest = (double)body.TotalLongPosition;
+        for(int i = 0; i < levels; i++)
+        {
+            tick.BidPrice[i] = body.BidLevels[i].Price / 10000.0;
+            tick.AskPrice[i] = body.OfferLevels[i].Price / 10000.0;
+            tick.BidVolume[i] = body.BidLevels[i].OrderQty;
+            tick.AskVolume[i] = body.OfferLevels[i].OrderQty;
+        }
+    }
+#endif
+};
+
+}
+
+#endif // MARKETTICK_HPP
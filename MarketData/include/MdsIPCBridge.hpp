@@ -0,0 +1,291 @@
+#ifndef MDSIPCBRIDGE_HPP
+#define MDSIPCBRIDGE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "libipc/ipc.h"
+#include "mds_api/mds_async_api.h"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+// 按消息类型划分的行情流，每个流再按证券分片到多个CPP-IPC通道
+enum EMdsStreamType
+{
+    EMDS_STREAM_SNAPSHOT = 0,   // L1/L2快照、委托队列、市场总览
+    EMDS_STREAM_TRADE = 1,      // L2逐笔成交
+    EMDS_STREAM_ORDER = 2,      // L2逐笔委托
+    EMDS_STREAM_STATUS = 3,     // 市场状态、证券状态
+    EMDS_STREAM_COUNT = 4,
+    EMDS_STREAM_NONE = 0xFF
+};
+
+struct TMdsBridgeStats
+{
+    uint64_t Received;
+    uint64_t Published;
+    uint64_t Dropped;           // 通道满或无接收端
+    uint64_t Filtered;          // 非行情消息或被屏蔽的消息来源
+    uint64_t Invalid;           // 消息长度非法
+    int64_t QueueRemaining;     // MDS异步队列当前积压
+    int64_t MaxQueueRemaining;
+    int64_t QueueLength;
+};
+
+// MDS异步API回调到CPP-IPC的桥接
+// OnMsg直接注册为MdsAsyncApi_AddChannel的fnOnMsg，在MDS回调线程上将消息体从
+// MDS异步队列原地写入CPP-IPC共享内存环形队列，中间不再经过自有队列和线程。
+// 通道按 "<prefix>.<stream>.<shard>" 命名，每个通道单写多读(ipc::route)，
+// 同一证券的消息总在同一分片内，保持逐笔序号有序。
+// 通道中只写入消息体(MdsMktRspMsgBodyT中的实际成员)，消息类型由通道隐含，
+// 快照流可通过MdsMktDataSnapshotHeadT::bodyType区分L1/L2。
+class MdsIPCBridge
+{
+public:
+    enum
+    {
+        MAX_SHARD_COUNT = 64,
+        QUEUE_SAMPLE_MASK = 1023,   // 每1024条消息采样一次异步队列积压
+        MIN_MSG_SIZE = 16           // 分片读取偏移12处的证券代码
+    };
+
+    MdsIPCBridge(): m_Context(NULL), m_ShardMask(0), m_SendTimeout(0), m_QueueLength(0)
+    {
+        memset(m_StreamTable, EMDS_STREAM_NONE, sizeof(m_StreamTable));
+        m_StreamTable[MDS_MSGTYPE_MARKET_DATA_SNAPSHOT_FULL_REFRESH] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_INDEX_SNAPSHOT_FULL_REFRESH] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_OPTION_SNAPSHOT_FULL_REFRESH] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_BEST_ORDERS_SNAPSHOT] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_MARKET_DATA_INCREMENTAL] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_BEST_ORDERS_INCREMENTAL] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_MARKET_OVERVIEW] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_VIRTUAL_AUCTION_PRICE] = EMDS_STREAM_SNAPSHOT;
+        m_StreamTable[MDS_MSGTYPE_L2_TRADE] = EMDS_STREAM_TRADE;
+        m_StreamTable[MDS_MSGTYPE_L2_ORDER] = EMDS_STREAM_ORDER;
+        m_StreamTable[MDS_MSGTYPE_L2_SSE_ORDER] = EMDS_STREAM_ORDER;
+        m_StreamTable[MDS_MSGTYPE_TRADING_SESSION_STATUS] = EMDS_STREAM_STATUS;
+        m_StreamTable[MDS_MSGTYPE_SECURITY_STATUS] = EMDS_STREAM_STATUS;
+        // 默认接收全部消息来源
+        memset(m_SourceEnable, 1, sizeof(m_SourceEnable));
+        m_Received.store(0, std::memory_order_relaxed);
+        m_Published.store(0, std::memory_order_relaxed);
+        m_Dropped.store(0, std::memory_order_relaxed);
+        m_Filtered.store(0, std::memory_order_relaxed);
+        m_Invalid.store(0, std::memory_order_relaxed);
+        m_QueueRemaining.store(0, std::memory_order_relaxed);
+        m_MaxQueueRemaining.store(0, std::memory_order_relaxed);
+    }
+
+    // shardCount取2的幂，sendTimeout为通道满时的最长等待毫秒数，0表示直接丢弃
+    bool Init(const char* prefix, int shardCount, uint64_t sendTimeout = 0)
+    {
+        if(shardCount <= 0 || shardCount > MAX_SHARD_COUNT || (shardCount & (shardCount - 1)) != 0)
+        {
+            return false;
+        }
+        m_ShardMask = shardCount - 1;
+        m_SendTimeout = sendTimeout;
+        m_Routes.clear();
+        for(int stream = 0; stream < EMDS_STREAM_COUNT; stream++)
+        {
+            for(int shard = 0; shard < shardCount; shard++)
+            {
+                char name[128] = {0};
+                GetChannelName(prefix, stream, shard, name, sizeof(name));
+                std::unique_ptr<ipc::route> route(new ipc::route(name, ipc::sender));
+                if(!route->valid())
+                {
+                    return false;
+                }
+                m_Routes.push_back(std::move(route));
+            }
+        }
+        return true;
+    }
+
+    static void GetChannelName(const char* prefix, int stream, int shard, char* name, size_t size)
+    {
+        static const char* StreamName[EMDS_STREAM_COUNT] = {"Snapshot", "Trade", "Order", "Status"};
+        snprintf(name, size, "%s.%s.%d", prefix, StreamName[stream], shard);
+    }
+
+    // 清理异常退出后残留的通道共享内存，须在接收端连接之前调用
+    static void ClearChannels(const char* prefix, int shardCount)
+    {
+        for(int stream = 0; stream < EMDS_STREAM_COUNT; stream++)
+        {
+            for(int shard = 0; shard < shardCount; shard++)
+            {
+                char name[128] = {0};
+                GetChannelName(prefix, stream, shard, name, sizeof(name));
+                ipc::route::clear_storage(name);
+            }
+        }
+    }
+
+    // 屏蔽指定来源的消息，如不需要逐笔重建数据时屏蔽MDS_MSGSRC_VDE_LEVEL2_REBUILD
+    void SetSourceEnable(uint8_t source, bool enable)
+    {
+        m_SourceEnable[source] = enable ? 1 : 0;
+    }
+
+    // 绑定异步API运行时环境，用于队列积压采样及线程绑核
+    void SetContext(MdsAsyncApiContextT* context)
+    {
+        m_Context = context;
+        if(m_Context != NULL)
+        {
+            m_QueueLength = MdsAsyncApi_GetAsyncQueueLength(m_Context);
+        }
+    }
+
+    // CPU编号从1开始，I/O线程与回调线程分核绑定，须在MdsAsyncApi_Start之前调用
+    bool SetCpuset(const char* ioThreadCpuset, const char* callbackThreadCpuset)
+    {
+        if(m_Context == NULL)
+        {
+            return false;
+        }
+        bool ret = MdsAsyncApi_SetIoThreadCpusetCfg(m_Context, ioThreadCpuset);
+        ret = MdsAsyncApi_SetCallbackThreadCpusetCfg(m_Context, callbackThreadCpuset) && ret;
+        return ret;
+    }
+
+    // 从配置文件添加通道，消息回调直接指向桥接
+    MdsAsyncApiChannelT* AddChannelFromFile(const char* tag, const char* cfgFile, const char* section, const char* addrKey)
+    {
+        if(m_Context == NULL)
+        {
+            return NULL;
+        }
+        return MdsAsyncApi_AddChannelFromFile(m_Context, tag, cfgFile, section, addrKey, &MdsIPCBridge::OnMsg, this, NULL, NULL, NULL, NULL);
+    }
+
+    // F_MDSAPI_ASYNC_ON_MSG_T，pCallbackParams为MdsIPCBridge指针
+    static int32 OnMsg(MdsApiSessionInfoT* pSessionInfo, SMsgHeadT* pMsgHead, void* pMsgItem, void* pCallbackParams)
+    {
+        ((MdsIPCBridge*)pCallbackParams)->Publish(pMsgHead->msgId, pMsgItem, pMsgHead->msgSize);
+        // 丢弃不视为处理失败，避免异步API断开通道
+        return 0;
+    }
+
+    // 仅在MDS回调线程调用
+    bool Publish(uint8_t msgId, const void* body, int32_t size)
+    {
+        uint64_t received = m_Received.load(std::memory_order_relaxed) + 1;
+        m_Received.store(received, std::memory_order_relaxed);
+        if((received & QUEUE_SAMPLE_MASK) == 0)
+        {
+            SampleQueue();
+        }
+        uint8_t stream = m_StreamTable[msgId];
+        if(stream == EMDS_STREAM_NONE)
+        {
+            Increase(m_Filtered);
+            return false;
+        }
+        // 先校验长度再读取消息体
+        if(size < MIN_MSG_SIZE || size > (int32_t)sizeof(MdsMktRspMsgBodyT))
+        {
+            Increase(m_Invalid);
+            return false;
+        }
+        const uint8_t* data = (const uint8_t*)body;
+        if(m_SourceEnable[data[3]] == 0)
+        {
+            Increase(m_Filtered);
+            return false;
+        }
+        ipc::route* route = m_Routes[stream * (m_ShardMask + 1) + GetShard(stream, data)].get();
+        // 分片无接收端时直接丢弃，不等待发送超时
+        if(route->recv_count() > 0 && route->try_send(body, size, m_SendTimeout))
+        {
+            Increase(m_Published);
+            return true;
+        }
+        Increase(m_Dropped);
+        return false;
+    }
+
+    // 采样MDS异步队列积压，可由监控线程定期调用
+    void SampleQueue()
+    {
+        if(m_Context == NULL)
+        {
+            return;
+        }
+        int64_t remaining = MdsAsyncApi_GetAsyncQueueRemainingCount(m_Context);
+        m_QueueRemaining.store(remaining, std::memory_order_relaxed);
+        if(remaining > m_MaxQueueRemaining.load(std::memory_order_relaxed))
+        {
+            m_MaxQueueRemaining.store(remaining, std::memory_order_relaxed);
+        }
+    }
+
+    void GetStats(TMdsBridgeStats& stats) const
+    {
+        stats.Received = m_Received.load(std::memory_order_relaxed);
+        stats.Published = m_Published.load(std::memory_order_relaxed);
+        stats.Dropped = m_Dropped.load(std::memory_order_relaxed);
+        stats.Filtered = m_Filtered.load(std::memory_order_relaxed);
+        stats.Invalid = m_Invalid.load(std::memory_order_relaxed);
+        stats.QueueRemaining = m_QueueRemaining.load(std::memory_order_relaxed);
+        stats.MaxQueueRemaining = m_MaxQueueRemaining.load(std::memory_order_relaxed);
+        stats.QueueLength = m_Context != NULL ? m_QueueLength : 0;
+    }
+
+    int GetShardCount() const
+    {
+        return m_ShardMask + 1;
+    }
+
+    // 快照、逐笔消息偏移12处为整数证券代码，按交易所与证券代码分片，body至少MIN_MSG_SIZE字节
+    int GetShard(int stream, const void* body) const
+    {
+        const uint8_t* data = (const uint8_t*)body;
+        if(stream == EMDS_STREAM_STATUS)
+        {
+            return data[0] & m_ShardMask;
+        }
+        int32_t instrId;
+        memcpy(&instrId, data + 12, sizeof(instrId));
+        uint32_t key = ((uint32_t)instrId ^ ((uint32_t)data[0] << 24)) * 2654435761u;
+        return (key >> 16) & m_ShardMask;
+    }
+protected:
+    static force_inline void Increase(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+private:
+    MdsIPCBridge(const MdsIPCBridge&);
+    MdsIPCBridge& operator=(const MdsIPCBridge&);
+private:
+    MdsAsyncApiContextT* m_Context;
+    int m_ShardMask;
+    uint64_t m_SendTimeout;
+    int64_t m_QueueLength;
+    uint8_t m_StreamTable[256];
+    uint8_t m_SourceEnable[256];
+    std::vector<std::unique_ptr<ipc::route> > m_Routes;
+    std::atomic<uint64_t> m_Received;
+    std::atomic<uint64_t> m_Published;
+    std::atomic<uint64_t> m_Dropped;
+    std::atomic<uint64_t> m_Filtered;
+    std::atomic<uint64_t> m_Invalid;
+    std::atomic<int64_t> m_QueueRemaining;
+    std::atomic<int64_t> m_MaxQueueRemaining;
+};
+
+}
+
+#endif // MDSIPCBRIDGE_HPP
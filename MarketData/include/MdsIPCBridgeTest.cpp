@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <assert.h>
+#include <thread>
+#include <stdio.h>
+#include "MdsIPCBridge.hpp"
+#include "HRTimer.hpp"
+
+static void FillSnapshot(MdsMktDataSnapshotT& snapshot, uint8_t exchId, int32_t instrId, int32_t updateTime)
+{
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.head.exchId = exchId;
+    snapshot.head.__origMdSource = MDS_MSGSRC_VDE_LEVEL2;
+    snapshot.head.instrId = instrId;
+    snapshot.head.updateTime = updateTime;
+    snapshot.head.bodyType = MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT;
+    snapshot.head.bodyLength = sizeof(snapshot.l2Stock);
+    snapshot.l2Stock.TradePx = 105000;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* prefix = "MdsIPCBridgeTest";
+    MarketData::MdsIPCBridge::ClearChannels(prefix, 2);
+    MarketData::MdsIPCBridge bridge;
+    assert(!bridge.Init(prefix, 3));
+    assert(bridge.Init(prefix, 2));
+
+    MdsMktDataSnapshotT snapshot;
+    FillSnapshot(snapshot, MDS_EXCH_SSE, 600000, 93000000);
+    int shard = bridge.GetShard(MarketData::EMDS_STREAM_SNAPSHOT, &snapshot);
+    char name[128] = {0};
+    MarketData::MdsIPCBridge::GetChannelName(prefix, MarketData::EMDS_STREAM_SNAPSHOT, shard, name, sizeof(name));
+    ipc::route receiver(name, ipc::receiver);
+    MarketData::MdsIPCBridge::GetChannelName(prefix, MarketData::EMDS_STREAM_TRADE, 0, name, sizeof(name));
+    ipc::route tradeReceiver(name, ipc::receiver);
+
+    // 经MDS回调签名发布快照，接收端收到原始消息体
+    SMsgHeadT head;
+    memset(&head, 0, sizeof(head));
+    head.msgId = MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT;
+    head.msgSize = sizeof(snapshot.head) + snapshot.head.bodyLength;
+    assert(MarketData::MdsIPCBridge::OnMsg(NULL, &head, &snapshot, &bridge) == 0);
+    ipc::buff_t buffer = receiver.recv(1000);
+    assert(buffer.size() == (size_t)head.msgSize);
+    const MdsMktDataSnapshotT* received = (const MdsMktDataSnapshotT*)buffer.data();
+    assert(received->head.instrId == 600000 && received->l2Stock.TradePx == 105000);
+    assert(received->head.bodyType == MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT);
+
+    // 同一证券总在同一分片
+    FillSnapshot(snapshot, MDS_EXCH_SSE, 600000, 93000003);
+    assert(bridge.GetShard(MarketData::EMDS_STREAM_SNAPSHOT, &snapshot) == shard);
+
+    // 逐笔成交按证券分片，仅分片0有接收端
+    MdsL2TradeT trade;
+    memset(&trade, 0, sizeof(trade));
+    trade.exchId = MDS_EXCH_SZSE;
+    trade.__origMdSource = MDS_MSGSRC_SZSE_MDGW_BINARY;
+    trade.ApplSeqNum = 1;
+    int sent = 0;
+    for(int32_t instrId = 1; instrId <= 16; instrId++)
+    {
+        trade.instrId = instrId;
+        if(bridge.GetShard(MarketData::EMDS_STREAM_TRADE, &trade) == 0)
+        {
+            assert(bridge.Publish(MDS_MSGTYPE_L2_TRADE, &trade, sizeof(trade)));
+            sent++;
+        }
+    }
+    assert(sent > 0);
+    for(int i = 0; i < sent; i++)
+    {
+        ipc::buff_t tradeBuffer = tradeReceiver.recv(1000);
+        assert(tradeBuffer.size() == sizeof(MdsL2TradeT));
+        assert(bridge.GetShard(MarketData::EMDS_STREAM_TRADE, tradeBuffer.data()) == 0);
+    }
+
+    // 非行情消息与被屏蔽来源不发布
+    MarketData::TMdsBridgeStats stats;
+    bridge.GetStats(stats);
+    uint64_t filtered = stats.Filtered;
+    assert(!bridge.Publish(MDS_MSGTYPE_HEARTBEAT, &snapshot, sizeof(snapshot.head)));
+    bridge.SetSourceEnable(MDS_MSGSRC_VDE_LEVEL2, false);
+    assert(!bridge.Publish(MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT, &snapshot, head.msgSize));
+    bridge.SetSourceEnable(MDS_MSGSRC_VDE_LEVEL2, true);
+    assert(!bridge.Publish(MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT, &snapshot, sizeof(MdsMktRspMsgBodyT) + 1));
+    assert(!bridge.Publish(MDS_MSGTYPE_L2_TRADE, &trade, MarketData::MdsIPCBridge::MIN_MSG_SIZE - 1));
+    bridge.GetStats(stats);
+    assert(stats.Filtered == filtered + 2 && stats.Invalid == 2);
+
+    // 无接收端的分片直接计为丢弃
+    uint64_t dropped = stats.Dropped;
+    for(int32_t instrId = 1; instrId <= 16; instrId++)
+    {
+        trade.instrId = instrId;
+        if(bridge.GetShard(MarketData::EMDS_STREAM_TRADE, &trade) != 0)
+        {
+            assert(!bridge.Publish(MDS_MSGTYPE_L2_TRADE, &trade, sizeof(trade)));
+            bridge.GetStats(stats);
+            assert(stats.Dropped == ++dropped);
+            break;
+        }
+    }
+
+    // 异步API运行时环境：绑核配置与队列深度
+    MdsAsyncApiContextT* context = MdsAsyncApi_CreateContextSimple(NULL, NULL, 4096);
+    if(context != NULL)
+    {
+        bridge.SetContext(context);
+        assert(bridge.SetCpuset("1", "1"));
+        bridge.SampleQueue();
+        bridge.GetStats(stats);
+        fprintf(stderr, "MdsAsyncApi QueueLength: %ld, QueueRemaining: %ld\n", stats.QueueLength, stats.QueueRemaining);
+        bridge.SetContext(NULL);
+        MdsAsyncApi_ReleaseContext(context);
+    }
+
+    // 延迟测试：快照分片上有接收端，由接收线程消费
+    TimeUtil::HRTimer timer;
+    const int N = 100000;
+    std::atomic<int> consumed(0);
+    std::thread consumer([&]()
+    {
+        while(consumed.load(std::memory_order_relaxed) < N)
+        {
+            ipc::buff_t data = receiver.recv(100);
+            if(!data.empty())
+            {
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+    // 重新初始化为通道满时等待，通道为单写者，不能另建发布端
+    assert(bridge.Init(prefix, 2, 1000));
+    bridge.GetStats(stats);
+    uint64_t published = stats.Published;
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        snapshot.head.updateTime = 93000000 + i;
+        MarketData::MdsIPCBridge::OnMsg(NULL, &head, &snapshot, &bridge);
+    }
+    uint64_t end = timer.GetTimeNs();
+    consumer.join();
+    bridge.GetStats(stats);
+    assert(stats.Published - published == (uint64_t)N);
+    fprintf(stderr, "MdsIPCBridge Publish %d Bytes Latency: %.1f ns\n", head.msgSize, (double)(end - start) / N);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 MdsIPCBridgeTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../CPP-IPC/include -I../../OES/0.17.4.1/include -L../../CPP-IPC/lib -L../../OES/0.17.4.1/lib -lipc -l:liboes_0.17.4.1.a -lrt -lm
@@ -0,0 +1,126 @@
+#ifndef MDSMARKETFEED_HPP
+#define MDSMARKETFEED_HPP
+
+#include <unistd.h>
+#include "mds_api/mds_async_api.h"
+#include "MarketFeed.hpp"
+
+namespace MarketData
+{
+
+// 宽睿MDS异步API行情适配，连接地址与订阅条件取ConfigFile中的mds_client区段
+// 通信(收包)线程按RecvCpus通过MdsAsyncApi_SetCommunicationCpusetCfg绑核；配置CallbackCpu时
+// 显式启用独立回调线程并通过MdsAsyncApi_SetCallbackThreadCpusetCfg绑核(MDS的CPU编号从1开始)，
+// 未配置时沿用配置文件中的cpuset与async_callback设置。
+// 转换L1/L2股票及期权快照，逐笔等其余消息不发布。
+class MdsMarketFeed: public MarketFeed
+{
+public:
+    MdsMarketFeed(): m_Context(NULL)
+    {
+    }
+
+    virtual ~MdsMarketFeed()
+    {
+        Stop();
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        MarketFeed::Init(config, sink);
+        if(m_Config.ConfigFile.empty())
+        {
+            return false;
+        }
+        m_Context = MdsAsyncApi_CreateContext(m_Config.ConfigFile.c_str());
+        if(m_Context == NULL)
+        {
+            return false;
+        }
+        bool ret = true;
+        if(!m_Config.RecvCpus.empty())
+        {
+            ret = MdsAsyncApi_SetCommunicationCpusetCfg(m_Context, FormatCpuList(m_Config.RecvCpus, 1).c_str()) && ret;
+        }
+        if(m_Config.CallbackCpu >= 0)
+        {
+            std::vector<int> cpus(1, m_Config.CallbackCpu);
+            ret = MdsAsyncApi_SetAsyncCallbackAble(m_Context, TRUE) && ret;
+            ret = MdsAsyncApi_SetCallbackThreadCpusetCfg(m_Context, FormatCpuList(cpus, 1).c_str()) && ret;
+        }
+        MdsAsyncApiChannelT* channel = MdsAsyncApi_AddChannelFromFile(m_Context, m_Config.Name.c_str(), m_Config.ConfigFile.c_str(),
+                                                                      MDSAPI_CFG_DEFAULT_SECTION, MDSAPI_CFG_DEFAULT_KEY_TCP_ADDR,
+                                                                      &MdsMarketFeed::OnMsg, this, &MdsMarketFeed::OnConnect, this,
+                                                                      &MdsMarketFeed::OnDisconnect, this);
+        return ret && channel != NULL;
+    }
+
+    virtual bool Start()
+    {
+        return m_Context != NULL && MdsAsyncApi_Start(m_Context);
+    }
+
+    virtual void Stop()
+    {
+        if(m_Context != NULL)
+        {
+            MdsAsyncApi_Stop(m_Context);
+            for(int i = 0; i < 300 && !MdsAsyncApi_IsAllTerminated(m_Context); i++)
+            {
+                usleep(10000);
+            }
+            MdsAsyncApi_ReleaseContext(m_Context);
+            m_Context = NULL;
+        }
+    }
+
+    // F_MDSAPI_ASYNC_ON_MSG_T，在MDS回调线程上转换并发布
+    static int32 OnMsg(MdsApiSessionInfoT* pSessionInfo, SMsgHeadT* pMsgHead, void* pMsgItem, void* pCallbackParams)
+    {
+        MdsMarketFeed* feed = (MdsMarketFeed*)pCallbackParams;
+        switch(pMsgHead->msgId)
+        {
+        case MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT:
+        case MDS_MSGTYPE_MARKET_DATA_SNAPSHOT_FULL_REFRESH:
+        case MDS_MSGTYPE_OPTION_SNAPSHOT_FULL_REFRESH:
+            feed->OnSnapshot(((MdsMktRspMsgBodyT*)pMsgItem)->mktDataSnapshot);
+            break;
+        default:
+            break;
+        }
+        return 0;
+    }
+
+    void OnSnapshot(const MdsMktDataSnapshotT& snapshot)
+    {
+        int64_t recvTime = GetTimeNs();
+        static thread_local TMarketTick tick;
+        if(TickAdapter::Convert(snapshot, tick))
+        {
+            m_Sink->OnTick(tick, recvTime);
+        }
+        else
+        {
+            m_Sink->OnInvalid();
+        }
+    }
+
+    // 连接完成后按配置文件执行默认订阅
+    static int32 OnConnect(MdsAsyncApiChannelT* pAsyncChannel, void* pCallbackParams)
+    {
+        ((MdsMarketFeed*)pCallbackParams)->m_Sink->OnStatus(true, "connected");
+        return MdsAsyncApi_DefaultOnConnect(pAsyncChannel, NULL);
+    }
+
+    static int32 OnDisconnect(MdsAsyncApiChannelT* pAsyncChannel, void* pCallbackParams)
+    {
+        ((MdsMarketFeed*)pCallbackParams)->m_Sink->OnStatus(false, "disconnected");
+        return 0;
+    }
+private:
+    MdsAsyncApiContextT* m_Context;
+};
+
+}
+
+#endif // MDSMARKETFEED_HPP
@@ -0,0 +1,1072 @@
+#ifndef PCAPDECODER_HPP
+#define PCAPDECODER_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <immintrin.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ci/tools.h>
+#include <ci/tools/ipcsum_base.h>
+#include <ci/tools/ippacket.h>
+#include "MarketTick.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+enum EPcapLinkType
+{
+    EPCAP_LINKTYPE_ETHERNET = 1
+};
+
+// 抓包文件中的一帧，Data指向文件映射内存
+struct TPcapPacket
+{
+    int64_t Timestamp;          // UTC纳秒
+    const uint8_t* Data;
+    uint32_t CapLen;
+    uint32_t OrigLen;
+    uint16_t LinkType;
+};
+
+// 只读映射pcap/pcapng文件，顺序遍历其中的数据帧
+// pcap支持微秒、纳秒两种时间戳及大小端文件；pcapng支持多段(SHB)、多接口(IDB)、
+// EPB/SPB数据块及if_tsresol时间戳精度，其余块类型跳过。
+// onload_tcpdump与efsink_packed的输出均为pcap格式。
+class PcapFile
+{
+public:
+    enum EFormat
+    {
+        EFORMAT_NONE = 0,
+        EFORMAT_PCAP = 1,
+        EFORMAT_PCAPNG = 2
+    };
+
+    PcapFile(): m_Data(NULL), m_Size(0), m_Offset(0), m_Format(EFORMAT_NONE), m_Swapped(false),
+        m_LinkType(0), m_TsScale(1000), m_Truncated(false)
+    {
+    }
+
+    ~PcapFile()
+    {
+        Close();
+    }
+
+    bool Open(const char* path)
+    {
+        Close();
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < 4)
+        {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(data == MAP_FAILED)
+        {
+            return false;
+        }
+        // 顺序读取，内核加大预读窗口
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        m_Data = (const uint8_t*)data;
+        m_Size = st.st_size;
+        if(!ParseFileHeader())
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if(m_Data != NULL)
+        {
+            munmap((void*)m_Data, m_Size);
+        }
+        m_Data = NULL;
+        m_Size = 0;
+        m_Offset = 0;
+        m_Format = EFORMAT_NONE;
+        m_Interfaces.clear();
+        m_Truncated = false;
+    }
+
+    // 读取下一帧，文件结束或记录不完整时返回false
+    force_inline inline bool Next(TPcapPacket& packet)
+    {
+        if(m_Format == EFORMAT_PCAP)
+        {
+            return NextPcap(packet);
+        }
+        return NextPcapng(packet);
+    }
+
+    // 从p起读取len字节是否不越过文件映射
+    force_inline inline bool Contains(const uint8_t* p, size_t len) const
+    {
+        return p + len <= m_Data + m_Size;
+    }
+
+    EFormat GetFormat() const
+    {
+        return m_Format;
+    }
+
+    // 末尾记录不完整，抓包进程被中断时常见
+    bool IsTruncated() const
+    {
+        return m_Truncated;
+    }
+
+    size_t GetSize() const
+    {
+        return m_Size;
+    }
+
+protected:
+    struct TInterface
+    {
+        uint16_t LinkType;
+        uint32_t SnapLen;
+        bool Pow2;              // if_tsresol最高位，时间戳单位为2^-Exponent秒
+        uint8_t Exponent;       // 默认10^-6秒
+    };
+
+    force_inline inline uint16_t Read16(const uint8_t* p) const
+    {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return m_Swapped ? __builtin_bswap16(v) : v;
+    }
+
+    force_inline inline uint32_t Read32(const uint8_t* p) const
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return m_Swapped ? __builtin_bswap32(v) : v;
+    }
+
+    bool ParseFileHeader()
+    {
+        uint32_t magic;
+        memcpy(&magic, m_Data, sizeof(magic));
+        if(magic == 0x0A0D0D0A)
+        {
+            m_Format = EFORMAT_PCAPNG;
+            m_Offset = 0;
+            return true;
+        }
+        if(m_Size < 24)
+        {
+            return false;
+        }
+        m_Swapped = magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1;
+        uint32_t native = m_Swapped ? __builtin_bswap32(magic) : magic;
+        if(native == 0xA1B2C3D4)
+        {
+            m_TsScale = 1000;
+        }
+        else if(native == 0xA1B23C4D)
+        {
+            m_TsScale = 1;
+        }
+        else
+        {
+            return false;
+        }
+        m_LinkType = (uint16_t)Read32(m_Data + 20);
+        m_Format = EFORMAT_PCAP;
+        m_Offset = 24;
+        return true;
+    }
+
+    force_inline inline bool NextPcap(TPcapPacket& packet)
+    {
+        if(m_Offset + 16 > m_Size)
+        {
+            m_Truncated = m_Offset != m_Size;
+            return false;
+        }
+        const uint8_t* record = m_Data + m_Offset;
+        uint32_t capLen = Read32(record + 8);
+        if(m_Offset + 16 + capLen > m_Size)
+        {
+            m_Truncated = true;
+            return false;
+        }
+        packet.Timestamp = (int64_t)Read32(record) * 1000000000LL + (int64_t)Read32(record + 4) * m_TsScale;
+        packet.Data = record + 16;
+        packet.CapLen = capLen;
+        packet.OrigLen = Read32(record + 12);
+        packet.LinkType = m_LinkType;
+        m_Offset += 16 + capLen;
+        return true;
+    }
+
+    bool NextPcapng(TPcapPacket& packet)
+    {
+        while(m_Offset + 12 <= m_Size)
+        {
+            const uint8_t* block = m_Data + m_Offset;
+            uint32_t type;
+            memcpy(&type, block, sizeof(type));
+            if(type == 0x0A0D0D0A)
+            {
+                // 新段，字节序由Byte-Order Magic确定，接口编号重新开始
+                uint32_t order;
+                memcpy(&order, block + 8, sizeof(order));
+                if(order != 0x1A2B3C4D && order != 0x4D3C2B1A)
+                {
+                    m_Truncated = true;
+                    return false;
+                }
+                m_Swapped = order == 0x4D3C2B1A;
+                m_Interfaces.clear();
+            }
+            else
+            {
+                type = Read32(block);
+            }
+            uint32_t length = Read32(block + 4);
+            if(length < 12 || (length & 3) != 0 || m_Offset + length > m_Size)
+            {
+                m_Truncated = true;
+                return false;
+            }
+            m_Offset += length;
+            if(type == 1 && length >= 20)
+            {
+                ParseInterface(block, length);
+            }
+            else if(type == 6 && length >= 32)
+            {
+                uint32_t interface = Read32(block + 8);
+                uint32_t capLen = Read32(block + 20);
+                if(interface >= m_Interfaces.size() || capLen > length - 32)
+                {
+                    continue;
+                }
+                uint64_t ts = ((uint64_t)Read32(block + 12) << 32) | Read32(block + 16);
+                packet.Timestamp = ToNanoseconds(m_Interfaces[interface], ts);
+                packet.Data = block + 28;
+                packet.CapLen = capLen;
+                packet.OrigLen = Read32(block + 24);
+                packet.LinkType = m_Interfaces[interface].LinkType;
+                return true;
+            }
+            else if(type == 3 && length >= 16 && !m_Interfaces.empty())
+            {
+                // SPB无时间戳，捕获长度由原始长度、快照长度和块长度共同确定
+                uint32_t capLen = Read32(block + 8);
+                if(m_Interfaces[0].SnapLen != 0 && capLen > m_Interfaces[0].SnapLen)
+                {
+                    capLen = m_Interfaces[0].SnapLen;
+                }
+                if(capLen > length - 16)
+                {
+                    capLen = length - 16;
+                }
+                packet.Timestamp = 0;
+                packet.Data = block + 12;
+                packet.CapLen = capLen;
+                packet.OrigLen = Read32(block + 8);
+                packet.LinkType = m_Interfaces[0].LinkType;
+                return true;
+            }
+        }
+        m_Truncated = m_Offset != m_Size;
+        return false;
+    }
+
+    void ParseInterface(const uint8_t* block, uint32_t length)
+    {
+        TInterface interface;
+        interface.LinkType = Read16(block + 8);
+        interface.SnapLen = Read32(block + 12);
+        interface.Pow2 = false;
+        interface.Exponent = 6;
+        uint32_t offset = 16;
+        while(offset + 4 <= length - 4)
+        {
+            uint16_t code = Read16(block + offset);
+            uint16_t size = Read16(block + offset + 2);
+            if(code == 0 || offset + 4 + size > length - 4)
+            {
+                break;
+            }
+            if(code == 9 && size == 1)
+            {
+                uint8_t resolution = block[offset + 4];
+                interface.Pow2 = (resolution & 0x80) != 0;
+                interface.Exponent = resolution & 0x7F;
+            }
+            offset += 4 + ((size + 3) & ~3u);
+        }
+        m_Interfaces.push_back(interface);
+    }
+
+    static int64_t ToNanoseconds(const TInterface& interface, uint64_t ts)
+    {
+        if(interface.Pow2)
+        {
+            if(interface.Exponent >= 64)
+            {
+                return 0;
+            }
+            uint64_t mask = (interface.Exponent == 0) ? 0 : ((1ULL << interface.Exponent) - 1);
+            return (int64_t)((ts >> interface.Exponent) * 1000000000ULL +
+                             (uint64_t)(((unsigned __int128)(ts & mask) * 1000000000ULL) >> interface.Exponent));
+        }
+        static const uint64_t Pow10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+                                         10000000ULL, 100000000ULL, 1000000000ULL};
+        if(interface.Exponent <= 9)
+        {
+            return (int64_t)(ts * Pow10[9 - interface.Exponent]);
+        }
+        uint64_t divisor = 1;
+        for(int i = 9; i < interface.Exponent && i < 28; i++)
+        {
+            divisor *= 10;
+        }
+        return (int64_t)(ts / divisor);
+    }
+
+protected:
+    const uint8_t* m_Data;
+    size_t m_Size;
+    size_t m_Offset;
+    EFormat m_Format;
+    bool m_Swapped;
+    uint16_t m_LinkType;
+    int64_t m_TsScale;          // pcap时间戳小数部分到纳秒的倍数
+    std::vector<TInterface> m_Interfaces;
+    bool m_Truncated;
+};
+
+// 以太网/VLAN/IPv4/UDP报头向量化校验
+// 对VLAN层数0~2各构造一组64字节的掩码与期望值模板(以太类型、IP版本与首部长度、
+// 分片标志与偏移、协议号、组播目的地址)，每帧取前64字节报头窗口与模板按字节
+// 比较，一次比较完成全部定长字段的校验。报头窗口按批校验，AVX2每帧两次256位
+// 比较，SSE2每帧四次128位比较，标量实现作为参照。
+// 匹配模板的帧首部长度固定为20字节；带IP选项等不匹配的帧由调用方走标量路径分类。
+class PacketValidator
+{
+public:
+    enum
+    {
+        WINDOW_SIZE = 64,
+        MAX_VLAN_TAGS = 2,
+        BATCH_SIZE = 32,
+        IP4_HEADER_SIZE = sizeof(ci_ip4_hdr),
+        UDP_HEADER_SIZE = sizeof(ci_udp_hdr)
+    };
+
+    struct alignas(64) TTemplate
+    {
+        uint8_t Mask[WINDOW_SIZE];
+        uint8_t Value[WINDOW_SIZE];
+    };
+
+    // 返回批内校验通过帧的位图
+    typedef uint32_t (*ValidateFunc)(const uint8_t* const* windows, const TTemplate* const* templates, int count);
+
+    static void BuildTemplate(int vlanTags, bool multicastOnly, TTemplate& tpl)
+    {
+        memset(&tpl, 0, sizeof(tpl));
+        int l3 = GetL3Offset(vlanTags);
+        tpl.Mask[l3 - 2] = 0xFF;
+        tpl.Value[l3 - 2] = CI_ETH_P_IP >> 8;
+        tpl.Mask[l3 - 1] = 0xFF;
+        tpl.Value[l3 - 1] = CI_ETH_P_IP & 0xFF;
+        tpl.Mask[l3 + offsetof(ci_ip4_hdr, ip_ihl_version)] = 0xFF;
+        tpl.Value[l3 + offsetof(ci_ip4_hdr, ip_ihl_version)] = CI_IP4_IHL_VERSION(IP4_HEADER_SIZE);
+        // MF标志及片偏移为0，DF不限
+        tpl.Mask[l3 + offsetof(ci_ip4_hdr, ip_frag_off_be16)] = 0x3F;
+        tpl.Mask[l3 + offsetof(ci_ip4_hdr, ip_frag_off_be16) + 1] = 0xFF;
+        tpl.Mask[l3 + offsetof(ci_ip4_hdr, ip_protocol)] = 0xFF;
+        tpl.Value[l3 + offsetof(ci_ip4_hdr, ip_protocol)] = IPPROTO_UDP;
+        if(multicastOnly)
+        {
+            tpl.Mask[l3 + offsetof(ci_ip4_hdr, ip_daddr_be32)] = 0xF0;
+            tpl.Value[l3 + offsetof(ci_ip4_hdr, ip_daddr_be32)] = 0xE0;
+        }
+    }
+
+    static force_inline inline int GetL3Offset(int vlanTags)
+    {
+        return sizeof(ci_ethhdr_t) + vlanTags * (sizeof(ci_ethhdr_vlan_t) - sizeof(ci_ethhdr_t));
+    }
+
+    // 统计802.1Q/802.1ad标签层数，超过MAX_VLAN_TAGS或帧过短返回-1，返回值非负时以太类型字段在CapLen内
+    static force_inline inline int CountVlanTags(const uint8_t* frame, uint32_t capLen)
+    {
+        int tags = 0;
+        uint32_t offset = offsetof(ci_ethhdr_t, ether_type);
+        while(offset + 2 <= capLen)
+        {
+            uint16_t type = (uint16_t)((frame[offset] << 8) | frame[offset + 1]);
+            if(type != CI_ETH_P_VLAN && type != 0x88A8)
+            {
+                return tags;
+            }
+            if(++tags > MAX_VLAN_TAGS)
+            {
+                return -1;
+            }
+            offset += sizeof(ci_ethhdr_vlan_t) - sizeof(ci_ethhdr_t);
+        }
+        return -1;
+    }
+
+    static uint32_t ValidateScalar(const uint8_t* const* windows, const TTemplate* const* templates, int count)
+    {
+        uint32_t valid = 0;
+        for(int i = 0; i < count; i++)
+        {
+            const TTemplate* tpl = templates[i];
+            bool match = true;
+            for(int j = 0; j < WINDOW_SIZE; j++)
+            {
+                match = match && (windows[i][j] & tpl->Mask[j]) == tpl->Value[j];
+            }
+            valid |= (uint32_t)match << i;
+        }
+        return valid;
+    }
+
+    static uint32_t ValidateSSE2(const uint8_t* const* windows, const TTemplate* const* templates, int count)
+    {
+        uint32_t valid = 0;
+        for(int i = 0; i < count; i++)
+        {
+            const __m128i* w = (const __m128i*)windows[i];
+            const __m128i* mask = (const __m128i*)templates[i]->Mask;
+            const __m128i* value = (const __m128i*)templates[i]->Value;
+            __m128i eq = _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(w), mask[0]), value[0]);
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(w + 1), mask[1]), value[1]));
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(w + 2), mask[2]), value[2]));
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(w + 3), mask[3]), value[3]));
+            valid |= (uint32_t)(_mm_movemask_epi8(eq) == 0xFFFF) << i;
+        }
+        return valid;
+    }
+
+    __attribute__((target("avx2")))
+    static uint32_t ValidateAVX2(const uint8_t* const* windows, const TTemplate* const* templates, int count)
+    {
+        uint32_t valid = 0;
+        for(int i = 0; i < count; i++)
+        {
+            const __m256i* w = (const __m256i*)windows[i];
+            const __m256i* mask = (const __m256i*)templates[i]->Mask;
+            const __m256i* value = (const __m256i*)templates[i]->Value;
+            __m256i eq0 = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(w), mask[0]), value[0]);
+            __m256i eq1 = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(w + 1), mask[1]), value[1]);
+            valid |= (uint32_t)(_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1)) == -1) << i;
+        }
+        return valid;
+    }
+
+    static ValidateFunc GetValidateFunc()
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return &PacketValidator::ValidateAVX2;
+        }
+        return &PacketValidator::ValidateSSE2;
+    }
+
+    // IPv4首部校验和，ihl为首部字节数
+    static force_inline inline bool CheckIPChecksum(const uint8_t* ip, int ihl)
+    {
+        uint32_t sum = 0;
+        for(int i = 0; i < ihl; i += 2)
+        {
+            sum += (uint32_t)((ip[i] << 8) | ip[i + 1]);
+        }
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        return sum == 0xFFFF;
+    }
+};
+
+// 解出的UDP报文，在行情源解码线程处理
+struct TPcapDatagram
+{
+    int64_t Timestamp;          // 抓包时间，UTC纳秒
+    const uint8_t* Payload;
+    uint32_t Length;
+    uint32_t Group;             // 目的地址，网络字节序
+    uint16_t Port;
+    uint16_t Feed;
+    uint32_t Reserved;
+};
+
+// 行情源报文解码器，每个行情源一个实例，只在所属解码线程调用，可保存逐笔重建等状态
+class PcapFeedDecoder
+{
+public:
+    virtual ~PcapFeedDecoder() {}
+    // 返回解出的行情条数，报文格式错误返回-1
+    virtual int Decode(const TPcapDatagram& datagram, TMarketTick* ticks, int maxTicks) = 0;
+};
+
+// 统一行情输出，在行情源所属解码线程回调；多个行情源共用时须自行处理并发
+class PcapTickSink
+{
+public:
+    virtual ~PcapTickSink() {}
+    virtual void OnTick(int feed, const TMarketTick& tick) = 0;
+};
+
+// 报文负载为连续的TMarketTick，即行情网关转发的统一格式
+class RawTickDecoder: public PcapFeedDecoder
+{
+public:
+    virtual int Decode(const TPcapDatagram& datagram, TMarketTick* ticks, int maxTicks)
+    {
+        if(datagram.Length % sizeof(TMarketTick) != 0)
+        {
+            return -1;
+        }
+        int count = datagram.Length / sizeof(TMarketTick);
+        if(count > maxTicks)
+        {
+            count = maxTicks;
+        }
+        memcpy(ticks, datagram.Payload, count * sizeof(TMarketTick));
+        for(int i = 0; i < count; i++)
+        {
+            ticks[i].RecvTime = datagram.Timestamp;
+            ticks[i].Source = datagram.Feed;
+        }
+        return count;
+    }
+};
+
+struct TPcapDecoderStats
+{
+    uint64_t Packets;
+    uint64_t Bytes;
+    uint64_t Datagrams;         // 发往已注册行情源的UDP报文
+    uint64_t FastPath;          // 通过模板校验的帧
+    uint64_t Unrouted;          // 未注册的组播组或端口
+    uint64_t Filtered;          // 非IPv4 UDP、非组播或非以太网帧
+    uint64_t Fragments;         // IP分片，不重组
+    uint64_t Malformed;         // 长度或首部校验和错误
+    uint64_t Truncated;         // 抓包快照长度不足
+    uint64_t Ticks;
+    uint64_t DecodeErrors;
+};
+
+// 离线抓包行情解码
+// 调用线程映射抓包文件并按批校验报头，按(组播组, 端口)路由到行情源，每个行情源
+// 固定由一个解码线程处理，经单生产者单消费者队列传递报文描述(负载仍指向文件映射，
+// 不拷贝)，同一行情源的报文按抓包顺序解码。解码线程数默认取CPU核数减一。
+class PcapDecoder
+{
+public:
+    enum
+    {
+        MAX_FEED_COUNT = 1024,
+        MAX_TICKS_PER_DATAGRAM = 64,
+        QUEUE_SIZE = 1 << 16,
+        INVALID_FEED = -1
+    };
+
+    PcapDecoder(): m_MulticastOnly(true), m_VerifyChecksum(true), m_WorkerCount(0), m_RunWorkers(0)
+    {
+        m_Validate = PacketValidator::GetValidateFunc();
+        memset(&m_Stats, 0, sizeof(m_Stats));
+        m_RouteMask = 0;
+    }
+
+    // 须在Run之前调用；multicastOnly为false时同时接收单播UDP
+    void SetOptions(int workerCount, bool multicastOnly = true, bool verifyChecksum = true)
+    {
+        m_WorkerCount = workerCount;
+        m_MulticastOnly = multicastOnly;
+        m_VerifyChecksum = verifyChecksum;
+    }
+
+    // 测试或指定指令集时替换校验实现
+    void SetValidateFunc(PacketValidator::ValidateFunc validate)
+    {
+        m_Validate = validate;
+    }
+
+    // 返回行情源编号，地址非法、重复或超出容量返回INVALID_FEED
+    int AddFeed(const char* group, uint16_t port, PcapFeedDecoder* decoder, PcapTickSink* sink)
+    {
+        struct in_addr addr;
+        if(inet_pton(AF_INET, group, &addr) != 1 || decoder == NULL || sink == NULL ||
+           m_Feeds.size() >= MAX_FEED_COUNT || FindFeed(addr.s_addr, port) != INVALID_FEED)
+        {
+            return INVALID_FEED;
+        }
+        TFeed feed;
+        feed.Group = addr.s_addr;
+        feed.Port = port;
+        feed.Decoder = decoder;
+        feed.Sink = sink;
+        m_Feeds.push_back(feed);
+        BuildRoutes();
+        return (int)m_Feeds.size() - 1;
+    }
+
+    // 顺序解码多个抓包文件(如按时间切分的抓包)，文件打开失败返回false，已解出的行情仍然有效；
+    // 解码线程一个也未能创建时不读取文件，直接返回false
+    bool Run(const std::vector<std::string>& files)
+    {
+        for(int tags = 0; tags <= PacketValidator::MAX_VLAN_TAGS; tags++)
+        {
+            PacketValidator::BuildTemplate(tags, m_MulticastOnly, m_Templates[tags]);
+        }
+        if(!StartWorkers())
+        {
+            return false;
+        }
+        bool ret = true;
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            PcapFile file;
+            if(!file.Open(files[i].c_str()))
+            {
+                ret = false;
+                break;
+            }
+            ReadFile(file);
+            // 报文负载指向文件映射，关闭文件前等待解码线程处理完毕
+            Drain();
+        }
+        StopWorkers();
+        return ret;
+    }
+
+    void GetStats(TPcapDecoderStats& stats) const
+    {
+        stats = m_Stats;
+    }
+
+    int GetFeedCount() const
+    {
+        return (int)m_Feeds.size();
+    }
+
+    // 最近一次Run实际启动的解码线程数，SetOptions传0时按CPU核数与行情源数确定
+    int GetWorkerCount() const
+    {
+        return m_RunWorkers;
+    }
+
+protected:
+    struct TFeed
+    {
+        uint32_t Group;
+        uint16_t Port;
+        PcapFeedDecoder* Decoder;
+        PcapTickSink* Sink;
+    };
+
+    struct alignas(64) TWorker
+    {
+        std::atomic<uint64_t> Head;
+        char Padding0[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> Tail;
+        std::atomic<bool> Done;
+        char Padding1[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)];
+        TPcapDatagram Queue[QUEUE_SIZE];
+        // 以下只由读文件线程使用
+        TPcapDatagram Pending[PacketValidator::BATCH_SIZE];
+        int PendingCount;
+        // 以下只由解码线程使用，Ticks缓冲区在启动线程前分配
+        TMarketTick* DecodeBuffer;
+        uint64_t Ticks;
+        uint64_t DecodeErrors;
+        std::thread Thread;
+    };
+
+    static force_inline inline uint32_t RouteHash(uint32_t group, uint16_t port)
+    {
+        uint64_t key = ((uint64_t)group << 16) | port;
+        return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    void BuildRoutes()
+    {
+        uint32_t size = 16;
+        while(size < m_Feeds.size() * 4)
+        {
+            size <<= 1;
+        }
+        m_Routes.assign(size, INVALID_FEED);
+        m_RouteMask = size - 1;
+        for(size_t i = 0; i < m_Feeds.size(); i++)
+        {
+            uint32_t pos = RouteHash(m_Feeds[i].Group, m_Feeds[i].Port) & m_RouteMask;
+            while(m_Routes[pos] != INVALID_FEED)
+            {
+                pos = (pos + 1) & m_RouteMask;
+            }
+            m_Routes[pos] = (int)i;
+        }
+    }
+
+    force_inline inline int FindFeed(uint32_t group, uint16_t port) const
+    {
+        if(m_Routes.empty())
+        {
+            return INVALID_FEED;
+        }
+        uint32_t pos = RouteHash(group, port) & m_RouteMask;
+        while(m_Routes[pos] != INVALID_FEED)
+        {
+            const TFeed& feed = m_Feeds[m_Routes[pos]];
+            if(feed.Group == group && feed.Port == port)
+            {
+                return m_Routes[pos];
+            }
+            pos = (pos + 1) & m_RouteMask;
+        }
+        return INVALID_FEED;
+    }
+
+    // 内存分配失败时以已创建的解码线程继续，一个也未创建返回false
+    bool StartWorkers()
+    {
+        int count = m_WorkerCount;
+        if(count <= 0)
+        {
+            count = (int)std::thread::hardware_concurrency() - 1;
+        }
+        if(count < 1)
+        {
+            count = 1;
+        }
+        if(m_Feeds.size() > 0 && count > (int)m_Feeds.size())
+        {
+            count = (int)m_Feeds.size();
+        }
+        for(int i = 0; i < count; i++)
+        {
+            void* memory = NULL;
+            if(posix_memalign(&memory, 64, sizeof(TWorker)) != 0)
+            {
+                break;
+            }
+            TMarketTick* buffer = NULL;
+            if(posix_memalign((void**)&buffer, 64, sizeof(TMarketTick) * MAX_TICKS_PER_DATAGRAM) != 0)
+            {
+                free(memory);
+                break;
+            }
+            TWorker* worker = new(memory) TWorker();
+            worker->DecodeBuffer = buffer;
+            worker->Head.store(0, std::memory_order_relaxed);
+            worker->Tail.store(0, std::memory_order_relaxed);
+            worker->Done.store(false, std::memory_order_relaxed);
+            worker->PendingCount = 0;
+            worker->Ticks = 0;
+            worker->DecodeErrors = 0;
+            m_Workers.push_back(worker);
+        }
+        for(size_t i = 0; i < m_Workers.size(); i++)
+        {
+            TWorker* worker = m_Workers[i];
+            worker->Thread = std::thread([this, worker]() { DecodeLoop(*worker); });
+        }
+        m_RunWorkers = (int)m_Workers.size();
+        return !m_Workers.empty();
+    }
+
+    void StopWorkers()
+    {
+        for(size_t i = 0; i < m_Workers.size(); i++)
+        {
+            TWorker* worker = m_Workers[i];
+            worker->Done.store(true, std::memory_order_release);
+            worker->Thread.join();
+            m_Stats.Ticks += worker->Ticks;
+            m_Stats.DecodeErrors += worker->DecodeErrors;
+            free(worker->DecodeBuffer);
+            worker->~TWorker();
+            free(worker);
+        }
+        m_Workers.clear();
+    }
+
+    void DecodeLoop(TWorker& worker)
+    {
+        TMarketTick* ticks = worker.DecodeBuffer;
+        uint64_t head = worker.Head.load(std::memory_order_relaxed);
+        while(true)
+        {
+            // 先读Done再读Tail，Done置位后Tail不再增加
+            bool done = worker.Done.load(std::memory_order_acquire);
+            uint64_t tail = worker.Tail.load(std::memory_order_acquire);
+            if(head == tail)
+            {
+                if(done)
+                {
+                    break;
+                }
+                _mm_pause();
+                continue;
+            }
+            for(; head != tail; head++)
+            {
+                const TPcapDatagram& datagram = worker.Queue[head & (QUEUE_SIZE - 1)];
+                const TFeed& feed = m_Feeds[datagram.Feed];
+                int count = feed.Decoder->Decode(datagram, ticks, MAX_TICKS_PER_DATAGRAM);
+                if(count < 0)
+                {
+                    worker.DecodeErrors++;
+                    continue;
+                }
+                for(int i = 0; i < count; i++)
+                {
+                    feed.Sink->OnTick(datagram.Feed, ticks[i]);
+                }
+                worker.Ticks += count;
+            }
+            worker.Head.store(head, std::memory_order_release);
+        }
+    }
+
+    void ReadFile(PcapFile& file)
+    {
+        TPcapPacket packets[PacketValidator::BATCH_SIZE];
+        int count = 0;
+        while(file.Next(packets[count]))
+        {
+            if(++count == PacketValidator::BATCH_SIZE)
+            {
+                ProcessBatch(file, packets, count);
+                count = 0;
+            }
+        }
+        ProcessBatch(file, packets, count);
+    }
+
+    void ProcessBatch(const PcapFile& file, const TPcapPacket* packets, int count)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+        alignas(64) static const uint8_t Empty[PacketValidator::WINDOW_SIZE] = {0};
+        // 校验函数只读前count项，置零仅为消除编译器的未初始化告警
+        const uint8_t* windows[PacketValidator::BATCH_SIZE] = {NULL};
+        const PacketValidator::TTemplate* templates[PacketValidator::BATCH_SIZE] = {NULL};
+        int tags[PacketValidator::BATCH_SIZE];
+        for(int i = 0; i < count; i++)
+        {
+            const TPcapPacket& packet = packets[i];
+            m_Stats.Packets++;
+            m_Stats.Bytes += packet.CapLen;
+            tags[i] = packet.LinkType == EPCAP_LINKTYPE_ETHERNET ? PacketValidator::CountVlanTags(packet.Data, packet.CapLen) : -1;
+            templates[i] = &m_Templates[tags[i] < 0 ? 0 : tags[i]];
+            if(tags[i] < 0)
+            {
+                windows[i] = Empty;
+            }
+            else if(file.Contains(packet.Data, PacketValidator::WINDOW_SIZE))
+            {
+                // 窗口中超出CapLen的字节属于下一条记录，由后续长度检查排除
+                windows[i] = packet.Data;
+            }
+            else
+            {
+                // 文件末尾的帧拷贝到补零窗口，避免越界读
+                uint32_t size = packet.CapLen < (uint32_t)PacketValidator::WINDOW_SIZE ? packet.CapLen : (uint32_t)PacketValidator::WINDOW_SIZE;
+                memset(m_Scratch[i], 0, PacketValidator::WINDOW_SIZE);
+                memcpy(m_Scratch[i], packet.Data, size);
+                windows[i] = m_Scratch[i];
+            }
+        }
+        uint32_t valid = m_Validate(windows, templates, count);
+        for(int i = 0; i < count; i++)
+        {
+            const TPcapPacket& packet = packets[i];
+            if(tags[i] < 0)
+            {
+                m_Stats.Filtered++;
+                continue;
+            }
+            int l3 = PacketValidator::GetL3Offset(tags[i]);
+            int ihl = PacketValidator::IP4_HEADER_SIZE;
+            if(valid & (1u << i))
+            {
+                m_Stats.FastPath++;
+            }
+            else
+            {
+                ihl = Classify(packet, l3);
+                if(ihl <= 0)
+                {
+                    continue;
+                }
+            }
+            Route(packet, l3, ihl);
+        }
+        Flush();
+    }
+
+    // 未通过模板校验的帧，返回IP首部长度，不需解码的帧计入统计后返回0
+    int Classify(const TPcapPacket& packet, int l3)
+    {
+        uint16_t etherType = (uint16_t)((packet.Data[l3 - 2] << 8) | packet.Data[l3 - 1]);
+        if(etherType != CI_ETH_P_IP)
+        {
+            m_Stats.Filtered++;
+            return 0;
+        }
+        if(packet.CapLen < l3 + sizeof(ci_ip4_hdr))
+        {
+            m_Stats.Truncated++;
+            return 0;
+        }
+        const ci_ip4_hdr* ip = (const ci_ip4_hdr*)(packet.Data + l3);
+        if(CI_IP4_VERSION(ip) != 4 || ip->ip_protocol != IPPROTO_UDP)
+        {
+            m_Stats.Filtered++;
+            return 0;
+        }
+        if(m_MulticastOnly && !CI_IP_IS_MULTICAST(ip->ip_daddr_be32))
+        {
+            m_Stats.Filtered++;
+            return 0;
+        }
+        int ihl = CI_IP4_IHL(ip);
+        if(ihl < (int)sizeof(ci_ip4_hdr))
+        {
+            m_Stats.Malformed++;
+            return 0;
+        }
+        if(ip->ip_frag_off_be16 & (CI_IP4_OFFSET_MASK | CI_IP4_FRAG_MORE))
+        {
+            m_Stats.Fragments++;
+            return 0;
+        }
+        return ihl;
+    }
+
+    force_inline inline void Route(const TPcapPacket& packet, int l3, int ihl)
+    {
+        if(packet.CapLen < l3 + ihl + sizeof(ci_udp_hdr))
+        {
+            m_Stats.Truncated++;
+            return;
+        }
+        const uint8_t* frame = packet.Data;
+        const ci_ip4_hdr* ip = (const ci_ip4_hdr*)(frame + l3);
+        const ci_udp_hdr* udp = (const ci_udp_hdr*)(frame + l3 + ihl);
+        uint32_t totalLen = CI_BSWAP_BE16(ip->ip_tot_len_be16);
+        uint32_t udpLen = CI_UDP_PAYLEN(udp);
+        if(totalLen < ihl + sizeof(ci_udp_hdr) || udpLen < sizeof(ci_udp_hdr) || udpLen > totalLen - ihl ||
+           (m_VerifyChecksum && !PacketValidator::CheckIPChecksum(frame + l3, ihl)))
+        {
+            m_Stats.Malformed++;
+            return;
+        }
+        if(packet.CapLen < l3 + ihl + udpLen)
+        {
+            m_Stats.Truncated++;
+            return;
+        }
+        int feed = FindFeed(ip->ip_daddr_be32, CI_BSWAP_BE16(udp->udp_dest_be16));
+        if(feed == INVALID_FEED)
+        {
+            m_Stats.Unrouted++;
+            return;
+        }
+        m_Stats.Datagrams++;
+        TWorker& worker = *m_Workers[feed % m_Workers.size()];
+        TPcapDatagram& datagram = worker.Pending[worker.PendingCount++];
+        datagram.Timestamp = packet.Timestamp;
+        datagram.Payload = frame + l3 + ihl + sizeof(ci_udp_hdr);
+        datagram.Length = udpLen - sizeof(ci_udp_hdr);
+        datagram.Group = ip->ip_daddr_be32;
+        datagram.Port = CI_BSWAP_BE16(udp->udp_dest_be16);
+        datagram.Feed = (uint16_t)feed;
+        datagram.Reserved = 0;
+    }
+
+    void Drain()
+    {
+        for(size_t i = 0; i < m_Workers.size(); i++)
+        {
+            TWorker& worker = *m_Workers[i];
+            while(worker.Head.load(std::memory_order_acquire) != worker.Tail.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // 每批每个解码线程只发布一次队尾
+    void Flush()
+    {
+        for(size_t i = 0; i < m_Workers.size(); i++)
+        {
+            TWorker& worker = *m_Workers[i];
+            if(worker.PendingCount == 0)
+            {
+                continue;
+            }
+            uint64_t tail = worker.Tail.load(std::memory_order_relaxed);
+            while(tail + worker.PendingCount - worker.Head.load(std::memory_order_acquire) > QUEUE_SIZE)
+            {
+                std::this_thread::yield();
+            }
+            for(int j = 0; j < worker.PendingCount; j++)
+            {
+                worker.Queue[(tail + j) & (QUEUE_SIZE - 1)] = worker.Pending[j];
+            }
+            worker.Tail.store(tail + worker.PendingCount, std::memory_order_release);
+            worker.PendingCount = 0;
+        }
+    }
+
+protected:
+    PacketValidator::ValidateFunc m_Validate;
+    PacketValidator::TTemplate m_Templates[PacketValidator::MAX_VLAN_TAGS + 1];
+    alignas(64) uint8_t m_Scratch[PacketValidator::BATCH_SIZE][PacketValidator::WINDOW_SIZE];
+    std::vector<TFeed> m_Feeds;
+    std::vector<int> m_Routes;
+    uint32_t m_RouteMask;
+    std::vector<TWorker*> m_Workers;
+    bool m_MulticastOnly;
+    bool m_VerifyChecksum;
+    int m_WorkerCount;
+    int m_RunWorkers;
+    TPcapDecoderStats m_Stats;
+};
+
+}
+
+#endif // PCAPDECODER_HPP
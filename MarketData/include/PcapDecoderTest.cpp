@@ -0,0 +1,473 @@
+#include "PcapDecoder.hpp"
+#include <assert.h>
+#include <mutex>
+#include "HRTimer.hpp"
+
+// 构造抓包帧
+struct TFrameSpec
+{
+    int VlanTags;
+    uint16_t EtherType;
+    uint8_t Protocol;
+    int OptionBytes;            // IP选项字节数
+    uint16_t FragOff;
+    uint32_t Group;             // 主机字节序
+    uint16_t Port;
+    bool BadChecksum;
+    int SnapCut;                // 截短的字节数
+};
+
+static TFrameSpec DefaultSpec(uint32_t group, uint16_t port)
+{
+    TFrameSpec spec;
+    spec.VlanTags = 0;
+    spec.EtherType = CI_ETH_P_IP;
+    spec.Protocol = IPPROTO_UDP;
+    spec.OptionBytes = 0;
+    spec.FragOff = 0;
+    spec.Group = group;
+    spec.Port = port;
+    spec.BadChecksum = false;
+    spec.SnapCut = 0;
+    return spec;
+}
+
+static void Put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static std::vector<uint8_t> BuildFrame(const TFrameSpec& spec, const void* payload, int size)
+{
+    std::vector<uint8_t> frame(14 + spec.VlanTags * 4 + 20 + spec.OptionBytes + 8 + size, 0);
+    uint8_t* p = frame.data();
+    p[0] = 0x01;
+    p[1] = 0x00;
+    p[2] = 0x5E;
+    for(int i = 0; i < spec.VlanTags; i++)
+    {
+        Put16(p + 12 + i * 4, i == 0 && spec.VlanTags == 2 ? 0x88A8 : CI_ETH_P_VLAN);
+        Put16(p + 14 + i * 4, 100 + i);
+    }
+    int l3 = 14 + spec.VlanTags * 4;
+    Put16(p + l3 - 2, spec.EtherType);
+    uint8_t* ip = p + l3;
+    int ihl = 20 + spec.OptionBytes;
+    ip[0] = 0x40 | (ihl / 4);
+    Put16(ip + 2, ihl + 8 + size);
+    Put16(ip + 6, 0x4000 | spec.FragOff);
+    ip[8] = 64;
+    ip[9] = spec.Protocol;
+    ip[12] = 10;
+    ip[15] = 1;
+    Put16(ip + 16, spec.Group >> 16);
+    Put16(ip + 18, spec.Group & 0xFFFF);
+    uint32_t sum = 0;
+    for(int i = 0; i < ihl; i += 2)
+    {
+        sum += (ip[i] << 8) | ip[i + 1];
+    }
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    Put16(ip + 10, (uint16_t)~sum ^ (spec.BadChecksum ? 1 : 0));
+    uint8_t* udp = ip + ihl;
+    Put16(udp, 40000);
+    Put16(udp + 2, spec.Port);
+    Put16(udp + 4, 8 + size);
+    memcpy(udp + 8, payload, size);
+    frame.resize(frame.size() - spec.SnapCut);
+    return frame;
+}
+
+struct TCapture
+{
+    std::vector<uint8_t> Frame;
+    int64_t Timestamp;
+    uint32_t OrigLen;
+};
+
+static void Append(std::vector<uint8_t>& out, const void* data, size_t size)
+{
+    out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+static uint32_t Swap(uint32_t v, bool swapped)
+{
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+static void WritePcap(const char* path, const std::vector<TCapture>& captures, bool nano, bool swapped)
+{
+    std::vector<uint8_t> out;
+    uint32_t header[6] = {Swap(nano ? 0xA1B23C4D : 0xA1B2C3D4, swapped), Swap(0x00040002, swapped), 0, 0,
+                          Swap(65535, swapped), Swap(1, swapped)};
+    if(swapped)
+    {
+        // 版本号为两个16位字段
+        uint16_t version[2] = {__builtin_bswap16(2), __builtin_bswap16(4)};
+        memcpy(&header[1], version, sizeof(version));
+    }
+    Append(out, header, sizeof(header));
+    for(size_t i = 0; i < captures.size(); i++)
+    {
+        const TCapture& c = captures[i];
+        uint32_t record[4] = {Swap((uint32_t)(c.Timestamp / 1000000000), swapped),
+                              Swap((uint32_t)(c.Timestamp % 1000000000 / (nano ? 1 : 1000)), swapped),
+                              Swap((uint32_t)c.Frame.size(), swapped), Swap(c.OrigLen, swapped)};
+        Append(out, record, sizeof(record));
+        Append(out, c.Frame.data(), c.Frame.size());
+    }
+    FILE* fp = fopen(path, "wb");
+    assert(fp != NULL);
+    fwrite(out.data(), 1, out.size(), fp);
+    fclose(fp);
+}
+
+// 两个接口：接口0为纳秒精度，接口1为默认微秒精度的其他链路类型
+static void WritePcapng(const char* path, const std::vector<TCapture>& captures)
+{
+    std::vector<uint8_t> out;
+    uint32_t shb[7] = {0x0A0D0D0A, 28, 0x1A2B3C4D, 0x00000001, 0xFFFFFFFF, 0xFFFFFFFF, 28};
+    Append(out, shb, sizeof(shb));
+    uint32_t idb0[8] = {1, 32, 1, 0, 0x00010009, 0x00000009, 0, 32};
+    Append(out, idb0, sizeof(idb0));
+    uint32_t idb1[5] = {1, 20, 113, 0, 20};
+    Append(out, idb1, sizeof(idb1));
+    uint32_t nrb[4] = {4, 16, 0, 16};
+    Append(out, nrb, sizeof(nrb));
+    for(size_t i = 0; i < captures.size(); i++)
+    {
+        const TCapture& c = captures[i];
+        uint32_t padded = (c.Frame.size() + 3) & ~3u;
+        uint32_t length = 32 + padded;
+        uint64_t ts = c.Timestamp;
+        uint32_t epb[7] = {6, length, 0, (uint32_t)(ts >> 32), (uint32_t)ts, (uint32_t)c.Frame.size(), c.OrigLen};
+        Append(out, epb, sizeof(epb));
+        Append(out, c.Frame.data(), c.Frame.size());
+        out.resize(out.size() + padded - c.Frame.size(), 0);
+        Append(out, &length, sizeof(length));
+    }
+    // 其他链路类型的帧计入Filtered
+    uint8_t frame[60] = {0};
+    uint32_t epb[7] = {6, 92, 1, 0, 0, 60, 60};
+    Append(out, epb, sizeof(epb));
+    Append(out, frame, sizeof(frame));
+    uint32_t length = 92;
+    Append(out, &length, sizeof(length));
+    FILE* fp = fopen(path, "wb");
+    assert(fp != NULL);
+    fwrite(out.data(), 1, out.size(), fp);
+    fclose(fp);
+}
+
+class CollectSink: public MarketData::PcapTickSink
+{
+public:
+    virtual void OnTick(int feed, const MarketData::TMarketTick& tick)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Ticks[feed].push_back(tick);
+    }
+    std::mutex m_Mutex;
+    std::vector<MarketData::TMarketTick> m_Ticks[4];
+};
+
+enum
+{
+    FEED_COUNT = 4,
+    TEST_ROUNDS = 500
+};
+
+static const uint32_t FeedGroup[FEED_COUNT] = {0xEF010101, 0xEF010102, 0xEF010101, 0xE8000001};
+static const uint16_t FeedPort[FEED_COUNT] = {30001, 30001, 30002, 20000};
+
+static MarketData::TMarketTick MakeTick(int feed, uint64_t sequence)
+{
+    MarketData::TMarketTick tick;
+    memset(&tick, 0, sizeof(tick));
+    snprintf(tick.InstrumentID, sizeof(tick.InstrumentID), "IF%04d", feed);
+    tick.Sequence = sequence;
+    tick.LastPrice = 4000.0 + sequence * 0.2;
+    tick.Volume = sequence * 3;
+    tick.DepthLevels = 5;
+    return tick;
+}
+
+// 每轮每个行情源一个有效报文(轮换VLAN层数与IP选项)，另加各类应过滤的帧
+static std::vector<TCapture> BuildCaptures(uint64_t* expectedSeq, MarketData::TPcapDecoderStats& expected)
+{
+    std::vector<TCapture> captures;
+    memset(&expected, 0, sizeof(expected));
+    int64_t ts = 1700000000LL * 1000000000LL;
+    MarketData::TMarketTick ticks[2];
+    for(int round = 0; round < TEST_ROUNDS; round++)
+    {
+        for(int feed = 0; feed < FEED_COUNT; feed++)
+        {
+            int count = 1 + (round + feed) % 2;
+            for(int i = 0; i < count; i++)
+            {
+                ticks[i] = MakeTick(feed, ++expectedSeq[feed]);
+            }
+            TFrameSpec spec = DefaultSpec(FeedGroup[feed], FeedPort[feed]);
+            spec.VlanTags = (round + feed) % 3;
+            spec.OptionBytes = (round % 7 == 0) ? 4 : 0;
+            TCapture c;
+            c.Frame = BuildFrame(spec, ticks, count * sizeof(MarketData::TMarketTick));
+            c.OrigLen = c.Frame.size();
+            c.Timestamp = ts += 1000;
+            captures.push_back(c);
+            expected.Datagrams++;
+            expected.Ticks += count;
+            expected.FastPath += spec.OptionBytes == 0;
+        }
+        TFrameSpec spec = DefaultSpec(FeedGroup[round % FEED_COUNT], FeedPort[round % FEED_COUNT]);
+        uint8_t junk[100] = {0};
+        switch(round % 8)
+        {
+        case 0:
+            spec.Protocol = IPPROTO_TCP;
+            expected.Filtered++;
+            break;
+        case 1:
+            spec.EtherType = 0x0806;
+            expected.Filtered++;
+            break;
+        case 2:
+            spec.FragOff = 0x2000;
+            expected.Fragments++;
+            break;
+        case 3:
+            spec.Group = 0x0A000001;
+            expected.Filtered++;
+            break;
+        case 4:
+            spec.BadChecksum = true;
+            expected.Malformed++;
+            expected.FastPath++;
+            break;
+        case 5:
+            spec.SnapCut = 10;
+            expected.Truncated++;
+            expected.FastPath++;
+            break;
+        case 6:
+            spec.Port = 39999;
+            expected.Unrouted++;
+            expected.FastPath++;
+            break;
+        default:
+            // 负载长度非法，由解码器计错
+            spec.VlanTags = 1;
+            expected.Datagrams++;
+            expected.DecodeErrors++;
+            expected.FastPath++;
+            break;
+        }
+        TCapture c;
+        c.Frame = BuildFrame(spec, junk, sizeof(junk));
+        c.OrigLen = c.Frame.size() + spec.SnapCut;
+        c.Timestamp = ts += 1000;
+        captures.push_back(c);
+    }
+    expected.Packets = captures.size();
+    for(size_t i = 0; i < captures.size(); i++)
+    {
+        expected.Bytes += captures[i].Frame.size();
+    }
+    return captures;
+}
+
+static void CheckRun(const char* path, const std::vector<TCapture>& captures, const uint64_t* expectedSeq,
+                     const MarketData::TPcapDecoderStats& expected, int workers, MarketData::PacketValidator::ValidateFunc validate,
+                     int extraFiltered)
+{
+    CollectSink sink;
+    MarketData::RawTickDecoder decoders[FEED_COUNT];
+    MarketData::PcapDecoder decoder;
+    decoder.SetOptions(workers);
+    decoder.SetValidateFunc(validate);
+    for(int feed = 0; feed < FEED_COUNT; feed++)
+    {
+        char group[32];
+        struct in_addr addr;
+        addr.s_addr = htonl(FeedGroup[feed]);
+        inet_ntop(AF_INET, &addr, group, sizeof(group));
+        assert(decoder.AddFeed(group, FeedPort[feed], &decoders[feed], &sink) == feed);
+    }
+    assert(decoder.AddFeed("239.1.1.1", 30001, &decoders[0], &sink) == MarketData::PcapDecoder::INVALID_FEED);
+    assert(decoder.AddFeed("239.1.1", 30001, &decoders[0], &sink) == MarketData::PcapDecoder::INVALID_FEED);
+    std::vector<std::string> files(1, path);
+    assert(decoder.Run(files));
+    MarketData::TPcapDecoderStats stats;
+    decoder.GetStats(stats);
+    assert(stats.Packets == expected.Packets + extraFiltered);
+    assert(stats.Bytes == expected.Bytes + extraFiltered * 60);
+    assert(stats.Datagrams == expected.Datagrams);
+    assert(stats.FastPath == expected.FastPath);
+    assert(stats.Unrouted == expected.Unrouted);
+    assert(stats.Filtered == expected.Filtered + extraFiltered);
+    assert(stats.Fragments == expected.Fragments);
+    assert(stats.Malformed == expected.Malformed);
+    assert(stats.Truncated == expected.Truncated);
+    assert(stats.Ticks == expected.Ticks);
+    assert(stats.DecodeErrors == expected.DecodeErrors);
+    // 每个行情源按抓包顺序输出，接收时间为抓包时间
+    for(int feed = 0; feed < FEED_COUNT; feed++)
+    {
+        assert(sink.m_Ticks[feed].size() == expectedSeq[feed]);
+        int64_t lastTime = 0;
+        for(size_t i = 0; i < sink.m_Ticks[feed].size(); i++)
+        {
+            const MarketData::TMarketTick& tick = sink.m_Ticks[feed][i];
+            MarketData::TMarketTick ref = MakeTick(feed, i + 1);
+            assert(tick.Sequence == i + 1);
+            assert(tick.Source == feed);
+            assert(tick.LastPrice == ref.LastPrice && tick.Volume == ref.Volume);
+            assert(strcmp(tick.InstrumentID, ref.InstrumentID) == 0);
+            assert(tick.RecvTime >= lastTime && tick.RecvTime > 1700000000LL * 1000000000LL);
+            lastTime = tick.RecvTime;
+        }
+    }
+    // 首帧时间戳精度
+    assert(sink.m_Ticks[0][0].RecvTime == captures[0].Timestamp);
+}
+
+static void TestValidator()
+{
+    MarketData::PacketValidator::TTemplate templates[3];
+    for(int tags = 0; tags < 3; tags++)
+    {
+        MarketData::PacketValidator::BuildTemplate(tags, tags != 1, templates[tags]);
+    }
+    alignas(64) uint8_t windows[MarketData::PacketValidator::BATCH_SIZE][MarketData::PacketValidator::WINDOW_SIZE];
+    const uint8_t* windowPtrs[MarketData::PacketValidator::BATCH_SIZE];
+    const MarketData::PacketValidator::TTemplate* templatePtrs[MarketData::PacketValidator::BATCH_SIZE];
+    uint64_t matched = 0;
+    for(int round = 0; round < 20000; round++)
+    {
+        int count = 1 + rand() % MarketData::PacketValidator::BATCH_SIZE;
+        for(int i = 0; i < count; i++)
+        {
+            const MarketData::PacketValidator::TTemplate& tpl = templates[rand() % 3];
+            for(int j = 0; j < MarketData::PacketValidator::WINDOW_SIZE; j++)
+            {
+                windows[i][j] = (tpl.Value[j] & tpl.Mask[j]) | (rand() & ~tpl.Mask[j]);
+            }
+            // 约一半窗口翻转一个比特
+            if(rand() % 2)
+            {
+                windows[i][rand() % MarketData::PacketValidator::WINDOW_SIZE] ^= 1 << (rand() % 8);
+            }
+            windowPtrs[i] = windows[i];
+            templatePtrs[i] = &tpl;
+        }
+        uint32_t scalar = MarketData::PacketValidator::ValidateScalar(windowPtrs, templatePtrs, count);
+        assert(MarketData::PacketValidator::ValidateSSE2(windowPtrs, templatePtrs, count) == scalar);
+        if(__builtin_cpu_supports("avx2"))
+        {
+            assert(MarketData::PacketValidator::ValidateAVX2(windowPtrs, templatePtrs, count) == scalar);
+        }
+        matched += __builtin_popcount(scalar);
+    }
+    assert(matched > 0);
+}
+
+static void Benchmark(const char* path, int workers)
+{
+    enum { PACKETS = 400000 };
+    std::vector<TCapture> captures;
+    MarketData::TMarketTick tick = MakeTick(0, 1);
+    captures.reserve(PACKETS);
+    for(int i = 0; i < PACKETS; i++)
+    {
+        TFrameSpec spec = DefaultSpec(0xEF000000 + i % 64, 30000);
+        spec.VlanTags = i % 2;
+        TCapture c;
+        c.Frame = BuildFrame(spec, &tick, sizeof(tick));
+        c.OrigLen = c.Frame.size();
+        c.Timestamp = 1700000000LL * 1000000000LL + i * 100LL;
+        captures.push_back(c);
+    }
+    WritePcap(path, captures, true, false);
+    std::vector<MarketData::RawTickDecoder> decoders(64);
+    class CountSink: public MarketData::PcapTickSink
+    {
+    public:
+        virtual void OnTick(int, const MarketData::TMarketTick& tick)
+        {
+            m_Sum += tick.Sequence;
+        }
+        uint64_t m_Sum = 0;
+    };
+    std::vector<CountSink> sinks(64);
+    MarketData::PacketValidator::ValidateFunc funcs[3] = {&MarketData::PacketValidator::ValidateScalar,
+        &MarketData::PacketValidator::ValidateSSE2, &MarketData::PacketValidator::ValidateAVX2};
+    const char* names[3] = {"Scalar", "SSE2", "AVX2"};
+    for(int f = 0; f < 3; f++)
+    {
+        if(f == 2 && !__builtin_cpu_supports("avx2"))
+        {
+            continue;
+        }
+        MarketData::PcapDecoder decoder;
+        decoder.SetOptions(workers);
+        decoder.SetValidateFunc(funcs[f]);
+        for(int i = 0; i < 64; i++)
+        {
+            char group[32];
+            snprintf(group, sizeof(group), "239.0.0.%d", i);
+            decoder.AddFeed(group, 30000, &decoders[i], &sinks[i]);
+        }
+        TimeUtil::HRTimer timer;
+        uint64_t start = timer.GetTimeNs();
+        decoder.Run(std::vector<std::string>(1, path));
+        uint64_t end = timer.GetTimeNs();
+        MarketData::TPcapDecoderStats stats;
+        decoder.GetStats(stats);
+        assert(stats.Ticks == PACKETS);
+        assert(decoder.GetWorkerCount() >= 1);
+        fprintf(stderr, "PcapDecoder %s Workers: %d %.1f ns/packet %.0f MB/s\n", names[f], decoder.GetWorkerCount(),
+                (double)(end - start) / PACKETS, stats.Bytes * 1e3 / (end - start));
+    }
+    unlink(path);
+}
+
+int main(int argc, char** argv)
+{
+    srand(1);
+    TestValidator();
+
+    uint64_t expectedSeq[FEED_COUNT] = {0};
+    MarketData::TPcapDecoderStats expected;
+    std::vector<TCapture> captures = BuildCaptures(expectedSeq, expected);
+    const char* path = "/tmp/PcapDecoderTest.pcap";
+    MarketData::PacketValidator::ValidateFunc validate = MarketData::PacketValidator::GetValidateFunc();
+    for(int workers = 1; workers <= 3; workers++)
+    {
+        WritePcap(path, captures, false, false);
+        CheckRun(path, captures, expectedSeq, expected, workers, validate, 0);
+        WritePcap(path, captures, true, true);
+        CheckRun(path, captures, expectedSeq, expected, workers, &MarketData::PacketValidator::ValidateScalar, 0);
+        WritePcapng(path, captures);
+        CheckRun(path, captures, expectedSeq, expected, workers, &MarketData::PacketValidator::ValidateSSE2, 1);
+    }
+    // 末尾记录不完整
+    WritePcap(path, captures, true, false);
+    assert(truncate(path, 24 + 16 + captures[0].Frame.size() + 20) == 0);
+    MarketData::PcapFile file;
+    assert(file.Open(path));
+    MarketData::TPcapPacket packet;
+    assert(file.Next(packet) && packet.CapLen == captures[0].Frame.size());
+    assert(!file.Next(packet) && file.IsTruncated());
+    file.Close();
+    unlink(path);
+    assert(!file.Open(path));
+    fprintf(stderr, "PcapDecoder Test Passed\n");
+
+    Benchmark(path, argc > 1 ? atoi(argv[1]) : 0);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -Wno-literal-suffix PcapDecoderTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../onload-8.0.0.34/src/include
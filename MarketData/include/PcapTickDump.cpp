@@ -0,0 +1,191 @@
+// 离线抓包行情解码工具
+// 将onload_tcpdump、efsink_packed等抓取的pcap/pcapng文件按行情源解码为统一行情格式，
+// 每个行情源输出一个文件：二进制为连续的TMarketTick，CSV为一档行情。
+//
+//   PcapTickDump -o outdir -f raw@239.1.1.1:30001 [-f ...] [-t workers] [-u] [-c] [-n] file...
+
+#include "PcapDecoder.hpp"
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+class FileTickSink: public MarketData::PcapTickSink
+{
+public:
+    FileTickSink(): m_File(NULL), m_CSV(false)
+    {
+    }
+
+    ~FileTickSink()
+    {
+        if(m_File != NULL)
+        {
+            fclose(m_File);
+        }
+    }
+
+    bool Open(const char* path, bool csv)
+    {
+        m_File = fopen(path, "wb");
+        if(m_File == NULL)
+        {
+            return false;
+        }
+        setvbuf(m_File, NULL, _IOFBF, 1 << 20);
+        m_CSV = csv;
+        if(m_CSV)
+        {
+            fprintf(m_File, "InstrumentID,ExchangeID,TradingDay,ActionDay,ExchangeTime,RecvTime,Sequence,"
+                            "LastPrice,Volume,Turnover,OpenInterest,BidPrice1,BidVolume1,AskPrice1,AskVolume1\n");
+        }
+        return true;
+    }
+
+    virtual void OnTick(int feed, const MarketData::TMarketTick& tick)
+    {
+        if(!m_CSV)
+        {
+            fwrite(&tick, sizeof(tick), 1, m_File);
+            return;
+        }
+        fprintf(m_File, "%s,%s,%u,%u,%ld,%ld,%lu,%.4f,%ld,%.4f,%.4f,%.4f,%ld,%.4f,%ld\n", tick.InstrumentID,
+                tick.ExchangeID, tick.TradingDay, tick.ActionDay, tick.ExchangeTime, tick.RecvTime, tick.Sequence,
+                tick.LastPrice, tick.Volume, tick.Turnover, tick.OpenInterest, tick.BidPrice[0], tick.BidVolume[0],
+                tick.AskPrice[0], tick.AskVolume[0]);
+    }
+
+protected:
+    FILE* m_File;
+    bool m_CSV;
+};
+
+// 新增交易所报文解码器在此注册
+static MarketData::PcapFeedDecoder* CreateDecoder(const char* name)
+{
+    if(strcmp(name, "raw") == 0)
+    {
+        return new MarketData::RawTickDecoder();
+    }
+    return NULL;
+}
+
+static void Usage()
+{
+    fprintf(stderr, "\nusage:\n");
+    fprintf(stderr, "  PcapTickDump [options] file...\n");
+    fprintf(stderr, "\noptions:\n");
+    fprintf(stderr, "  -o <dir>                   - output directory\n");
+    fprintf(stderr, "  -f <decoder>@<group>:<port> - feed to decode (may be repeated), decoders: raw\n");
+    fprintf(stderr, "  -t <workers>               - decoder threads, default CPU count - 1\n");
+    fprintf(stderr, "  -u                         - also accept unicast UDP\n");
+    fprintf(stderr, "  -n                         - skip IP header checksum verification\n");
+    fprintf(stderr, "  -c                         - CSV output\n");
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    const char* outDir = NULL;
+    std::vector<std::string> feedSpecs;
+    int workers = 0;
+    bool multicastOnly = true;
+    bool verifyChecksum = true;
+    bool csv = false;
+    int c;
+    while((c = getopt(argc, argv, "o:f:t:unc")) != -1)
+    {
+        switch(c)
+        {
+        case 'o':
+            outDir = optarg;
+            break;
+        case 'f':
+            feedSpecs.push_back(optarg);
+            break;
+        case 't':
+            workers = atoi(optarg);
+            break;
+        case 'u':
+            multicastOnly = false;
+            break;
+        case 'n':
+            verifyChecksum = false;
+            break;
+        case 'c':
+            csv = true;
+            break;
+        default:
+            Usage();
+        }
+    }
+    if(outDir == NULL || feedSpecs.empty() || optind == argc)
+    {
+        Usage();
+    }
+    if(mkdir(outDir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "ERROR: mkdir %s failed: %s\n", outDir, strerror(errno));
+        return 1;
+    }
+
+    MarketData::PcapDecoder decoder;
+    decoder.SetOptions(workers, multicastOnly, verifyChecksum);
+    std::vector<MarketData::PcapFeedDecoder*> decoders;
+    std::vector<FileTickSink*> sinks;
+    for(size_t i = 0; i < feedSpecs.size(); i++)
+    {
+        // decoder@group:port
+        char name[64] = {0};
+        char group[64] = {0};
+        unsigned port = 0;
+        if(sscanf(feedSpecs[i].c_str(), "%63[^@]@%63[^:]:%u", name, group, &port) != 3 || port > 65535)
+        {
+            fprintf(stderr, "ERROR: bad feed %s\n", feedSpecs[i].c_str());
+            Usage();
+        }
+        MarketData::PcapFeedDecoder* feedDecoder = CreateDecoder(name);
+        if(feedDecoder == NULL)
+        {
+            fprintf(stderr, "ERROR: unknown decoder %s\n", name);
+            return 1;
+        }
+        char path[512] = {0};
+        snprintf(path, sizeof(path), "%s/%s_%u.%s", outDir, group, port, csv ? "csv" : "tick");
+        FileTickSink* sink = new FileTickSink();
+        if(!sink->Open(path, csv))
+        {
+            fprintf(stderr, "ERROR: open %s failed: %s\n", path, strerror(errno));
+            return 1;
+        }
+        if(decoder.AddFeed(group, (uint16_t)port, feedDecoder, sink) == MarketData::PcapDecoder::INVALID_FEED)
+        {
+            fprintf(stderr, "ERROR: bad or duplicate feed %s\n", feedSpecs[i].c_str());
+            return 1;
+        }
+        decoders.push_back(feedDecoder);
+        sinks.push_back(sink);
+    }
+
+    std::vector<std::string> files(argv + optind, argv + argc);
+    bool ret = decoder.Run(files);
+    MarketData::TPcapDecoderStats stats;
+    decoder.GetStats(stats);
+    fprintf(stderr, "packets %lu bytes %lu datagrams %lu fast_path %lu unrouted %lu filtered %lu fragments %lu "
+                    "malformed %lu truncated %lu ticks %lu decode_errors %lu\n",
+            stats.Packets, stats.Bytes, stats.Datagrams, stats.FastPath, stats.Unrouted, stats.Filtered,
+            stats.Fragments, stats.Malformed, stats.Truncated, stats.Ticks, stats.DecodeErrors);
+    for(size_t i = 0; i < sinks.size(); i++)
+    {
+        delete sinks[i];
+        delete decoders[i];
+    }
+    if(!ret)
+    {
+        fprintf(stderr, "ERROR: failed to open capture\n");
+        return 1;
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -Wno-literal-suffix PcapTickDump.cpp -o PcapTickDump -pthread -I. -I../../onload-8.0.0.34/src/include
@@ -0,0 +1,157 @@
+#ifndef REMMARKETFEED_HPP
+#define REMMARKETFEED_HPP
+
+#include <string.h>
+#include "EESQuoteApi.h"
+#include "MarketFeed.hpp"
+
+namespace MarketData
+{
+
+// 盛立REM EES行情适配，期货合约无后缀，股票为600000.SH/000001.SZ
+// FrontAddress为TCP行情服务ip:port，Multicast为组播ip:port@交易所代码，配置组播时不连接TCP行情；
+// EES无回调线程绑核接口，由发布端在首次回调时按CallbackCpu绑核。
+class REMMarketFeed: public MarketFeed, public EESQuoteEvent
+{
+public:
+    REMMarketFeed(): m_Api(NULL), m_Owned(true)
+    {
+    }
+
+    virtual ~REMMarketFeed()
+    {
+        Stop();
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        MarketFeed::Init(config, sink);
+        std::string ip;
+        int port = 0;
+        for(size_t i = 0; i < m_Config.FrontAddress.size(); i++)
+        {
+            if(!SplitAddress(m_Config.FrontAddress[i], ip, port))
+            {
+                return false;
+            }
+            EqsTcpInfo info;
+            snprintf(info.m_eqsId, sizeof(info.m_eqsId), "%d", (int)i);
+            strncpy(info.m_eqsIp, ip.c_str(), sizeof(info.m_eqsIp) - 1);
+            info.m_eqsPort = (unsigned short)port;
+            m_TcpInfo.push_back(info);
+        }
+        for(size_t i = 0; i < m_Config.Multicast.size(); i++)
+        {
+            std::string address = m_Config.Multicast[i];
+            std::string exchange;
+            size_t pos = address.find('@');
+            if(pos != std::string::npos)
+            {
+                exchange = address.substr(pos + 1);
+                address = address.substr(0, pos);
+            }
+            if(!SplitAddress(address, ip, port))
+            {
+                return false;
+            }
+            EqsMulticastInfo info;
+            strncpy(info.m_mcIp, ip.c_str(), sizeof(info.m_mcIp) - 1);
+            info.m_mcPort = (unsigned short)port;
+            strncpy(info.m_mcLoacalIp, m_Config.LocalIP.c_str(), sizeof(info.m_mcLoacalIp) - 1);
+            info.m_mcLocalPort = (unsigned short)port;
+            strncpy(info.m_exchangeId, exchange.c_str(), sizeof(info.m_exchangeId) - 1);
+            m_MulticastInfo.push_back(info);
+        }
+        if(m_TcpInfo.empty() && m_MulticastInfo.empty())
+        {
+            return false;
+        }
+        m_Api = CreateEESQuoteApi();
+        m_Sink->SetCallbackCpu(m_Config.CallbackCpu);
+        return m_Api != NULL;
+    }
+
+    // 设置已创建的行情接口，用于测试时替换为模拟接口，适配不负责释放
+    void SetApi(EESQuoteApi* api)
+    {
+        Stop();
+        m_Api = api;
+        m_Owned = false;
+    }
+
+    virtual bool Start()
+    {
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        if(!m_MulticastInfo.empty())
+        {
+            return m_Api->InitMulticast(m_MulticastInfo, this);
+        }
+        return m_Api->ConnServer(m_TcpInfo, this);
+    }
+
+    virtual void Stop()
+    {
+        if(m_Api != NULL)
+        {
+            if(m_MulticastInfo.empty())
+            {
+                m_Api->DisConnServer();
+            }
+            if(m_Owned)
+            {
+                DestroyEESQuoteApi(m_Api);
+            }
+            m_Api = NULL;
+        }
+    }
+
+    virtual void OnEqsConnected()
+    {
+        EqsLoginParam param;
+        strncpy(param.m_loginId, m_Config.UserID.c_str(), sizeof(param.m_loginId) - 1);
+        strncpy(param.m_password, m_Config.Password.c_str(), sizeof(param.m_password) - 1);
+        m_Api->LoginToEqs(param);
+    }
+
+    virtual void OnEqsDisconnected()
+    {
+        m_Sink->OnStatus(false, "disconnected");
+    }
+
+    virtual void OnLoginResponse(bool bSuccess, const char* pReason)
+    {
+        m_Sink->OnStatus(bSuccess, pReason);
+        if(!bSuccess)
+        {
+            return;
+        }
+        std::string code;
+        std::string exchange;
+        for(size_t i = 0; i < m_Config.Instruments.size(); i++)
+        {
+            SplitInstrument(m_Config.Instruments[i], code, exchange);
+            EesEqsIntrumentType type = exchange == "SH" ? EQS_SH_STOCK : (exchange == "SZ" ? EQS_SZ_STOCK : EQS_FUTURE);
+            m_Api->RegisterSymbol(type, code.c_str());
+        }
+    }
+
+    virtual void OnQuoteUpdated(EesEqsIntrumentType chInstrumentType, EESMarketDepthQuoteData* pDepthQuoteData)
+    {
+        int64_t recvTime = GetTimeNs();
+        static thread_local TMarketTick tick;
+        TickAdapter::Convert(*pDepthQuoteData, tick);
+        m_Sink->OnTick(tick, recvTime);
+    }
+private:
+    EESQuoteApi* m_Api;
+    bool m_Owned;
+    std::vector<EqsTcpInfo> m_TcpInfo;
+    std::vector<EqsMulticastInfo> m_MulticastInfo;
+};
+
+}
+
+#endif // REMMARKETFEED_HPP
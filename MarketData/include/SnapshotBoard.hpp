@@ -0,0 +1,413 @@
+#ifndef SNAPSHOTBOARD_HPP
+#define SNAPSHOTBOARD_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include "MarketTick.hpp"
+#include "InstrumentIndex.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+struct alignas(64) TSnapshotBoardHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    int32_t Capacity;
+    uint32_t SlotSize;
+    std::atomic<int32_t> Count;         // 已注册合约数，目录项在Count发布前写入
+};
+
+struct TSnapshotBoardKey
+{
+    char InstrumentID[TMarketTick::INSTRUMENT_ID_LEN];
+};
+
+// 每个合约一个槽位，Sequence为奇数表示正在写入
+struct alignas(64) TSnapshotBoardSlot
+{
+    std::atomic<uint32_t> Sequence;
+    TMarketTick Tick;
+};
+
+// 盘口最优价，只读取槽位前部字段时使用
+struct TBoardTop
+{
+    int64_t ExchangeTime;
+    int64_t RecvTime;
+    double LastPrice;
+    int64_t Volume;
+    double BidPrice;
+    double AskPrice;
+    int64_t BidVolume;
+    int64_t AskVolume;
+};
+
+// 共享内存最新行情快照表
+// 行情网关按合约原地覆盖槽位，任意数量的读取进程按序号读取任一合约的最新快照。
+// 每个槽位一个seqlock：写入方将序号置为奇数后写入，写完置为下一个偶数；读取方前后两次
+// 读到相同偶数序号时数据一致，否则重试，最多重试指定次数，读取方从不阻塞写入方。
+// 多个写入线程可更新同一合约(如多路行情源)，写入方以CAS取得槽位。
+// 合约序号由写入方注册时分配，读取方通过目录一次性解析InstrumentID/ticker后缓存序号。
+class SnapshotBoard
+{
+public:
+    enum
+    {
+        MAGIC = 0x44524F42,     // "BORD"
+        VERSION = 1,
+        INVALID_SLOT = TradeUtil::InstrumentIndex::INVALID_SLOT,
+        DEFAULT_READ_RETRIES = 64
+    };
+
+    SnapshotBoard(): m_Base(NULL), m_Size(0), m_Header(NULL), m_Keys(NULL), m_Slots(NULL), m_Index(NULL),
+        m_Known(0), m_Writable(false)
+    {
+    }
+
+    ~SnapshotBoard()
+    {
+        if(m_Base != NULL)
+        {
+            munmap(m_Base, m_Size);
+        }
+        delete m_Index;
+    }
+
+    // 写入方创建或接管共享内存，已存在且容量一致时保留原有槽位及序号，停留在写入中的槽位序号推进到偶数
+    bool Create(const char* name, int capacity)
+    {
+        if(capacity <= 0 || m_Base != NULL)
+        {
+            return false;
+        }
+        int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+        {
+            return false;
+        }
+        size_t size = GetSize(capacity);
+        struct stat st;
+        bool ret = fstat(fd, &st) == 0;
+        bool created = ret && st.st_size == 0;
+        if(created)
+        {
+            ret = ftruncate(fd, size) == 0;
+        }
+        else if(ret)
+        {
+            ret = (size_t)st.st_size == size;
+        }
+        ret = ret && Map(fd, size, true);
+        close(fd);
+        if(!ret)
+        {
+            return false;
+        }
+        if(created)
+        {
+            m_Header->Magic = MAGIC;
+            m_Header->Version = VERSION;
+            m_Header->Capacity = capacity;
+            m_Header->SlotSize = sizeof(TSnapshotBoardSlot);
+            m_Header->Count.store(0, std::memory_order_release);
+        }
+        if(!CheckHeader() || m_Header->Capacity != capacity)
+        {
+            Unmap();
+            return false;
+        }
+        if(!created)
+        {
+            // 原写入方在写入途中退出时槽位序号停留在奇数，Update会一直自旋、读取方一直重试，
+            // 接管时将其推进到下一个偶数；接管前原写入方须已全部退出
+            for(int i = 0; i < capacity; i++)
+            {
+                uint32_t sequence = m_Slots[i].Sequence.load(std::memory_order_relaxed);
+                if(sequence & 1)
+                {
+                    m_Slots[i].Sequence.store(sequence + 1, std::memory_order_release);
+                }
+            }
+        }
+        m_Index = new TradeUtil::InstrumentIndex(capacity);
+        Refresh();
+        return true;
+    }
+
+    // 读取方只读打开
+    bool Open(const char* name)
+    {
+        if(m_Base != NULL)
+        {
+            return false;
+        }
+        int fd = shm_open(name, O_RDONLY, 0);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        bool ret = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TSnapshotBoardHeader) && Map(fd, st.st_size, false);
+        close(fd);
+        if(!ret)
+        {
+            return false;
+        }
+        if(!CheckHeader() || GetSize(m_Header->Capacity) != m_Size)
+        {
+            Unmap();
+            return false;
+        }
+        m_Index = new TradeUtil::InstrumentIndex(m_Header->Capacity);
+        Refresh();
+        return true;
+    }
+
+    static void Remove(const char* name)
+    {
+        shm_unlink(name);
+    }
+
+    // 写入方注册合约，返回序号，容量满返回INVALID_SLOT；须在单一线程调用
+    int Register(const char* instrumentID)
+    {
+        if(!m_Writable)
+        {
+            return INVALID_SLOT;
+        }
+        int slot = m_Index->Register(instrumentID);
+        if(slot != INVALID_SLOT && slot >= m_Known)
+        {
+            // 接管的目录中槽位可能残留旧合约，显式补结尾0
+            size_t length = strnlen(instrumentID, sizeof(m_Keys[slot].InstrumentID) - 1);
+            memcpy(m_Keys[slot].InstrumentID, instrumentID, length);
+            m_Keys[slot].InstrumentID[length] = '\0';
+            m_Known = slot + 1;
+            m_Header->Count.store(m_Known, std::memory_order_release);
+        }
+        return slot;
+    }
+
+    // 读取方解析合约序号，未找到时同步写入方新注册的合约后再查找
+    int Resolve(const char* instrumentID)
+    {
+        int slot = m_Index->Find(instrumentID);
+        if(slot == INVALID_SLOT && Refresh())
+        {
+            slot = m_Index->Find(instrumentID);
+        }
+        return slot;
+    }
+
+    // 只查找本地已同步的合约，不访问目录，可与Update在不同线程并发调用
+    force_inline inline int Find(const char* instrumentID) const
+    {
+        return m_Index->Find(instrumentID);
+    }
+
+    int Count() const
+    {
+        return m_Header->Count.load(std::memory_order_acquire);
+    }
+
+    int Capacity() const
+    {
+        return m_Header->Capacity;
+    }
+
+    const char* GetInstrumentID(int slot) const
+    {
+        return m_Keys[slot].InstrumentID;
+    }
+
+    force_inline inline void Update(int slot, const TMarketTick& tick)
+    {
+        TSnapshotBoardSlot& target = m_Slots[slot];
+        uint32_t sequence = target.Sequence.load(std::memory_order_relaxed);
+        while(true)
+        {
+            if((sequence & 1) == 0 &&
+               target.Sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+            __builtin_ia32_pause();
+            sequence = target.Sequence.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&target.Tick, &tick, sizeof(tick));
+        target.Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // 按InstrumentID写入，未注册的合约自动注册
+    bool Update(const TMarketTick& tick)
+    {
+        int slot = m_Index->Find(tick.InstrumentID);
+        if(slot == INVALID_SLOT)
+        {
+            slot = Register(tick.InstrumentID);
+            if(slot == INVALID_SLOT)
+            {
+                return false;
+            }
+        }
+        Update(slot, tick);
+        return true;
+    }
+
+    // 读取完整快照，sequence返回槽位序号(每次更新加2，0表示从未写入)，重试次数用尽返回false
+    force_inline inline bool Read(int slot, TMarketTick& tick, uint32_t* sequence = NULL, int retries = DEFAULT_READ_RETRIES) const
+    {
+        const TSnapshotBoardSlot& source = m_Slots[slot];
+        for(int i = 0; i < retries; i++)
+        {
+            uint32_t begin = source.Sequence.load(std::memory_order_acquire);
+            if(begin & 1)
+            {
+                __builtin_ia32_pause();
+                continue;
+            }
+            memcpy(&tick, &source.Tick, sizeof(tick));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(source.Sequence.load(std::memory_order_relaxed) == begin)
+            {
+                if(sequence != NULL)
+                {
+                    *sequence = begin;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 只读取最优价等字段
+    force_inline inline bool ReadTop(int slot, TBoardTop& top, uint32_t* sequence = NULL, int retries = DEFAULT_READ_RETRIES) const
+    {
+        const TSnapshotBoardSlot& source = m_Slots[slot];
+        for(int i = 0; i < retries; i++)
+        {
+            uint32_t begin = source.Sequence.load(std::memory_order_acquire);
+            if(begin & 1)
+            {
+                __builtin_ia32_pause();
+                continue;
+            }
+            top.ExchangeTime = source.Tick.ExchangeTime;
+            top.RecvTime = source.Tick.RecvTime;
+            top.LastPrice = source.Tick.LastPrice;
+            top.Volume = source.Tick.Volume;
+            top.BidPrice = source.Tick.BidPrice[0];
+            top.AskPrice = source.Tick.AskPrice[0];
+            top.BidVolume = source.Tick.BidVolume[0];
+            top.AskVolume = source.Tick.AskVolume[0];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(source.Sequence.load(std::memory_order_relaxed) == begin)
+            {
+                if(sequence != NULL)
+                {
+                    *sequence = begin;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 槽位当前序号，与上次读取的序号比较可判断是否有更新
+    force_inline inline uint32_t GetSequence(int slot) const
+    {
+        return m_Slots[slot].Sequence.load(std::memory_order_acquire);
+    }
+
+protected:
+    static size_t GetSize(int capacity)
+    {
+        return GetSlotOffset(capacity) + sizeof(TSnapshotBoardSlot) * capacity;
+    }
+
+    static size_t GetSlotOffset(int capacity)
+    {
+        size_t offset = sizeof(TSnapshotBoardHeader) + sizeof(TSnapshotBoardKey) * capacity;
+        return (offset + 63) / 64 * 64;
+    }
+
+    bool Map(int fd, size_t size, bool writable)
+    {
+        void* base = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if(base == MAP_FAILED)
+        {
+            return false;
+        }
+        m_Base = (uint8_t*)base;
+        m_Size = size;
+        m_Writable = writable;
+        m_Header = (TSnapshotBoardHeader*)m_Base;
+        return true;
+    }
+
+    // 校验失败时解除映射，以便对象可再次Create/Open
+    void Unmap()
+    {
+        munmap(m_Base, m_Size);
+        m_Base = NULL;
+        m_Size = 0;
+        m_Header = NULL;
+        m_Keys = NULL;
+        m_Slots = NULL;
+        m_Writable = false;
+    }
+
+    bool CheckHeader()
+    {
+        if(m_Header->Magic != MAGIC || m_Header->Version != VERSION || m_Header->Capacity <= 0 ||
+           m_Header->SlotSize != sizeof(TSnapshotBoardSlot))
+        {
+            return false;
+        }
+        m_Keys = (TSnapshotBoardKey*)(m_Base + sizeof(TSnapshotBoardHeader));
+        m_Slots = (TSnapshotBoardSlot*)(m_Base + GetSlotOffset(m_Header->Capacity));
+        return true;
+    }
+
+    // 将目录中新增的合约加入本地索引，返回是否有新增
+    bool Refresh()
+    {
+        int count = m_Header->Count.load(std::memory_order_acquire);
+        bool added = count > m_Known;
+        for(int slot = m_Known; slot < count; slot++)
+        {
+            m_Index->Register(m_Keys[slot].InstrumentID);
+        }
+        m_Known = count > m_Known ? count : m_Known;
+        return added;
+    }
+
+private:
+    SnapshotBoard(const SnapshotBoard&);
+    SnapshotBoard& operator=(const SnapshotBoard&);
+private:
+    uint8_t* m_Base;
+    size_t m_Size;
+    TSnapshotBoardHeader* m_Header;
+    TSnapshotBoardKey* m_Keys;
+    TSnapshotBoardSlot* m_Slots;
+    TradeUtil::InstrumentIndex* m_Index;
+    int m_Known;
+    bool m_Writable;
+};
+
+}
+
+#endif // SNAPSHOTBOARD_HPP
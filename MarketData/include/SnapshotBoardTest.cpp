@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "SnapshotBoard.hpp"
+#include "HRTimer.hpp"
+
+static const char* BOARD = "/SnapshotBoardTest";
+
+// 第k次更新，各字段均由k推出，读取方据此判断是否读到撕裂的快照
+static void MakeTick(MarketData::TMarketTick& tick, const char* instrumentID, int64_t k)
+{
+    memset(&tick, 0, sizeof(tick));
+    strncpy(tick.InstrumentID, instrumentID, sizeof(tick.InstrumentID) - 1);
+    tick.TradingDay = 20240603;
+    tick.ExchangeTime = k * 500000000LL;
+    tick.RecvTime = k * 7;
+    tick.Sequence = k;
+    tick.LastPrice = 3600 + k * 0.5;
+    tick.Volume = k;
+    tick.Turnover = k * 36000.0;
+    tick.OpenInterest = 200000 - k;
+    for(int level = 0; level < 10; level++)
+    {
+        tick.BidPrice[level] = tick.LastPrice - 1 - level;
+        tick.AskPrice[level] = tick.LastPrice + 1 + level;
+        tick.BidVolume[level] = k + level;
+        tick.AskVolume[level] = k * 2 + level;
+    }
+}
+
+static void CheckTick(const MarketData::TMarketTick& tick, const char* instrumentID)
+{
+    MarketData::TMarketTick expected;
+    MakeTick(expected, instrumentID, tick.Volume);
+    assert(memcmp(&tick, &expected, sizeof(tick)) == 0);
+}
+
+// 模拟写入方在写入途中退出：直接映射共享内存，将槽位序号置为奇数，槽位区位于末尾
+static void BeginWrite(const char* name, int slot)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    assert(fd >= 0);
+    struct stat st;
+    assert(fstat(fd, &st) == 0);
+    void* base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    assert(base != MAP_FAILED);
+    const MarketData::TSnapshotBoardHeader* header = (const MarketData::TSnapshotBoardHeader*)base;
+    MarketData::TSnapshotBoardSlot* slots = (MarketData::TSnapshotBoardSlot*)((char*)base + st.st_size) - header->Capacity;
+    slots[slot].Sequence.fetch_add(1);
+    munmap(base, st.st_size);
+}
+
+static void TestBasic()
+{
+    MarketData::SnapshotBoard writer;
+    assert(writer.Create(BOARD, 4));
+    int rb = writer.Register("rb2410");
+    int ticker = writer.Register("600000");
+    assert(rb == 0 && ticker == 1 && writer.Register("rb2410") == 0);
+
+    MarketData::SnapshotBoard reader;
+    assert(reader.Open(BOARD));
+    assert(reader.Capacity() == 4 && reader.Count() == 2);
+    assert(reader.Resolve("600000") == ticker && reader.Resolve("IF2406") == MarketData::SnapshotBoard::INVALID_SLOT);
+    assert(reader.Register("IF2406") == MarketData::SnapshotBoard::INVALID_SLOT);
+
+    MarketData::TMarketTick tick;
+    uint32_t sequence = 1;
+    assert(reader.Read(rb, tick, &sequence) && sequence == 0);
+    MakeTick(tick, "rb2410", 10);
+    writer.Update(rb, tick);
+    MakeTick(tick, "rb2410", 11);
+    writer.Update(rb, tick);
+    assert(reader.GetSequence(rb) == 4 && reader.GetSequence(ticker) == 0);
+    memset(&tick, 0, sizeof(tick));
+    assert(reader.Read(rb, tick, &sequence) && sequence == 4);
+    CheckTick(tick, "rb2410");
+    assert(tick.Volume == 11);
+    MarketData::TBoardTop top;
+    assert(reader.ReadTop(rb, top));
+    assert(top.LastPrice == tick.LastPrice && top.BidPrice == tick.BidPrice[0] && top.AskVolume == tick.AskVolume[0]);
+
+    // 写入方新注册的合约，读取方解析时同步目录
+    MakeTick(tick, "IF2406", 1);
+    assert(writer.Update(tick));
+    assert(reader.Resolve("IF2406") == 2 && strcmp(reader.GetInstrumentID(2), "IF2406") == 0);
+    MakeTick(tick, "ag2408", 1);
+    assert(writer.Update(tick));
+    MakeTick(tick, "au2408", 1);
+    assert(!writer.Update(tick));
+    assert(reader.Count() == 4);
+
+    // 写入方重启后接管原有槽位，容量不一致则失败
+    MarketData::SnapshotBoard restarted;
+    assert(restarted.Create(BOARD, 4));
+    assert(restarted.Register("ag2408") == 3 && restarted.GetSequence(rb) == 4);
+    // 原写入方写入途中退出，序号停留在奇数，接管时推进到下一个偶数
+    BeginWrite(BOARD, rb);
+    assert(reader.GetSequence(rb) == 5 && !reader.Read(rb, tick, NULL, 4));
+    MarketData::SnapshotBoard reattached;
+    assert(reattached.Create(BOARD, 4));
+    assert(reader.GetSequence(rb) == 6 && reader.GetSequence(ticker) == 0);
+    assert(reader.Read(rb, tick, &sequence) && sequence == 6);
+    MakeTick(tick, "rb2410", 12);
+    reattached.Update(rb, tick);
+    assert(reader.Read(rb, tick, &sequence) && sequence == 8 && tick.Volume == 12);
+    MarketData::SnapshotBoard mismatch;
+    assert(!mismatch.Create(BOARD, 8));
+    MarketData::SnapshotBoard::Remove(BOARD);
+    MarketData::SnapshotBoard missing;
+    assert(!missing.Open(BOARD));
+    // 首部校验失败时解除映射，同一对象可再次打开
+    int fd = shm_open(BOARD, O_RDWR | O_CREAT, 0644);
+    assert(fd >= 0 && ftruncate(fd, 4096) == 0);
+    close(fd);
+    assert(!missing.Open(BOARD));
+    MarketData::SnapshotBoard::Remove(BOARD);
+    MarketData::SnapshotBoard recreated;
+    assert(recreated.Create(BOARD, 4));
+    assert(missing.Open(BOARD) && missing.Count() == 0);
+    MarketData::SnapshotBoard::Remove(BOARD);
+}
+
+// 两个写入线程(多路行情源)更新同一合约，子进程及本进程读取线程校验每次读到的快照完整
+static void TestConcurrent()
+{
+    const int N = 200000;
+    MarketData::SnapshotBoard writer;
+    assert(writer.Create(BOARD, 16));
+    int slot = writer.Register("rb2410");
+    MarketData::TMarketTick tick;
+    MakeTick(tick, "rb2410", 0);
+    writer.Update(slot, tick);
+
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        MarketData::SnapshotBoard reader;
+        assert(reader.Open(BOARD));
+        int id = reader.Resolve("rb2410");
+        MarketData::TMarketTick snapshot;
+        int64_t last = 0;
+        while(last < 2 * N - 1)
+        {
+            if(reader.Read(id, snapshot))
+            {
+                CheckTick(snapshot, "rb2410");
+                last = snapshot.Volume > last ? snapshot.Volume : last;
+            }
+        }
+        _exit(0);
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<int> reads(0);
+    std::atomic<int> fails(0);
+    std::thread reader([&]()
+    {
+        MarketData::SnapshotBoard board;
+        assert(board.Open(BOARD));
+        int id = board.Resolve("rb2410");
+        MarketData::TMarketTick snapshot;
+        while(!done.load())
+        {
+            if(board.Read(id, snapshot, NULL, 4))
+            {
+                CheckTick(snapshot, "rb2410");
+                reads++;
+            }
+            else
+            {
+                fails++;
+            }
+        }
+    });
+    std::vector<std::thread> writers;
+    for(int w = 0; w < 2; w++)
+    {
+        writers.push_back(std::thread([&, w]()
+        {
+            MarketData::TMarketTick update;
+            for(int i = 0; i < N; i++)
+            {
+                MakeTick(update, "rb2410", 2 * i + w);
+                writer.Update(slot, update);
+            }
+        }));
+    }
+    for(size_t w = 0; w < writers.size(); w++)
+    {
+        writers[w].join();
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    done = true;
+    reader.join();
+    assert(writer.GetSequence(slot) == 2 + 4 * N);
+    fprintf(stderr, "SnapshotBoard concurrent reads %d, retries exhausted %d\n", reads.load(), fails.load());
+    MarketData::SnapshotBoard::Remove(BOARD);
+}
+
+int main(int argc, char* argv[])
+{
+    MarketData::SnapshotBoard::Remove(BOARD);
+    TestBasic();
+    TestConcurrent();
+
+    // 写入与读取延迟
+    const int N = 1000000;
+    const int COUNT = 1000;
+    MarketData::SnapshotBoard writer;
+    assert(writer.Create(BOARD, COUNT));
+    char instrumentID[32];
+    for(int i = 0; i < COUNT; i++)
+    {
+        sprintf(instrumentID, "IF%04d", i);
+        writer.Register(instrumentID);
+    }
+    MarketData::SnapshotBoard reader;
+    assert(reader.Open(BOARD));
+    MarketData::TMarketTick tick;
+    MakeTick(tick, "IF0000", 1);
+    TimeUtil::HRTimer timer;
+    uint64_t begin = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        tick.Volume = i;
+        writer.Update(i % COUNT, tick);
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "SnapshotBoard Update Latency: %.1f ns\n", (double)(end - begin) / N);
+    int64_t sum = 0;
+    begin = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        if(reader.Read(i % COUNT, tick))
+        {
+            sum += tick.Volume;
+        }
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "SnapshotBoard Read Latency: %.1f ns\n", (double)(end - begin) / N);
+    MarketData::TBoardTop top;
+    begin = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        if(reader.ReadTop(i % COUNT, top))
+        {
+            sum += top.Volume;
+        }
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "SnapshotBoard ReadTop Latency: %.1f ns (%ld)\n", (double)(end - begin) / N, sum);
+    begin = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        sprintf(instrumentID, "IF%04d", i % COUNT);
+        sum += reader.Resolve(instrumentID);
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "SnapshotBoard Resolve Latency: %.1f ns\n", (double)(end - begin) / N);
+    MarketData::SnapshotBoard::Remove(BOARD);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 SnapshotBoardTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include -lrt
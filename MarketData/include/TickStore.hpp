@@ -0,0 +1,927 @@
+#ifndef TICKSTORE_HPP
+#define TICKSTORE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MarketTick.hpp"
+#include "InstrumentIndex.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace MarketData
+{
+
+// 存储列，价格按PRICE_SCALE、成交额按TURNOVER_SCALE转为整数，时间为交易日起点起算纳秒
+enum ETickColumn
+{
+    ETICK_COL_TIME = 0,
+    ETICK_COL_RECV_TIME,
+    ETICK_COL_LAST_PRICE,
+    ETICK_COL_VOLUME,
+    ETICK_COL_TURNOVER,
+    ETICK_COL_OPEN_INTEREST,
+    ETICK_COL_BID_PRICE,
+    ETICK_COL_ASK_PRICE = ETICK_COL_BID_PRICE + 5,
+    ETICK_COL_BID_VOLUME = ETICK_COL_ASK_PRICE + 5,
+    ETICK_COL_ASK_VOLUME = ETICK_COL_BID_VOLUME + 5,
+    ETICK_COL_COUNT = ETICK_COL_ASK_VOLUME + 5
+};
+
+enum ETickBlockState
+{
+    ETICK_BLOCK_EMPTY = 0,
+    ETICK_BLOCK_RAW = 1,            // 定长列，写入中或待压缩
+    ETICK_BLOCK_ENCODED = 2         // 各列差分+zigzag变长编码，原始区已释放
+};
+
+// 段文件头，写入进程与读取进程共享
+struct alignas(64) TTickSegmentHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t BlockTicks;
+    uint32_t MaxBlocks;
+    uint64_t SegmentSize;
+    uint32_t TradingDay;
+    uint32_t Reserved;
+    char InstrumentID[TMarketTick::INSTRUMENT_ID_LEN];
+    alignas(64) std::atomic<uint64_t> DataEnd;      // 数据区分配位置
+    std::atomic<int32_t> BlockCount;                // 已发布块数，最后一块未封存时为写入块
+    std::atomic<int32_t> Closed;                    // 写入结束，全部块已封存
+};
+
+// 块索引，MinTime/MaxTime/PrefixMax在块封存后有效
+struct alignas(64) TTickBlockEntry
+{
+    std::atomic<uint32_t> State;
+    std::atomic<uint32_t> Count;
+    int64_t MinTime;
+    int64_t MaxTime;
+    int64_t PrefixMax;          // 本块及之前各块MaxTime的最大值，单调不减，用于二分查找
+    uint64_t RawOffset;
+    uint64_t EncodedOffset;
+    uint64_t EncodedSize;
+};
+
+// 单合约单交易日的段文件，映射为共享内存
+// 写入线程追加行情到写入块；压缩线程将已封存块编码后释放原始区(madvise(MADV_REMOVE)打洞)；
+// 映射完成后即关闭文件描述符，打开大量段文件不占用描述符；
+// 其它进程以只读方式映射，读取原始块时按块状态做类似seqlock的校验，读取期间块被压缩则改读编码数据。
+class TickSegment
+{
+public:
+    enum
+    {
+        MAGIC = 0x31534B54,     // "TKS1"
+        VERSION = 1,
+        PAGE_SIZE = 4096,
+        STORE_LEVELS = 5,
+        TURNOVER_SCALE = 100
+    };
+
+    static const int64_t PRICE_SCALE = 10000;
+
+    TickSegment(): m_Base(NULL), m_Size(0), m_Header(NULL), m_Blocks(NULL), m_Writable(false),
+        m_Hot(-1), m_HotMin(0), m_HotMax(0), m_PrefixMax(INT64_MIN)
+    {
+    }
+
+    ~TickSegment()
+    {
+        Unmap();
+    }
+
+    // 创建或续写段文件，已存在且格式一致时从最后一块继续追加
+    bool Create(const char* path, const char* instrumentID, uint32_t tradingDay, uint32_t blockTicks, uint32_t maxBlocks,
+                uint64_t segmentSize)
+    {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        bool created = false;
+        bool mapped = false;
+        if(fstat(fd, &st) == 0)
+        {
+            created = st.st_size == 0;
+            if(created ? ftruncate(fd, segmentSize) == 0 : (uint64_t)st.st_size == segmentSize)
+            {
+                mapped = Map(fd, segmentSize, true);
+            }
+        }
+        close(fd);
+        if(!mapped)
+        {
+            return false;
+        }
+        if(created)
+        {
+            m_Header->Magic = MAGIC;
+            m_Header->Version = VERSION;
+            m_Header->BlockTicks = blockTicks;
+            m_Header->MaxBlocks = maxBlocks;
+            m_Header->SegmentSize = segmentSize;
+            m_Header->TradingDay = tradingDay;
+            strncpy(m_Header->InstrumentID, instrumentID, sizeof(m_Header->InstrumentID) - 1);
+            m_Header->DataEnd.store(Align(sizeof(TTickSegmentHeader) + sizeof(TTickBlockEntry) * maxBlocks, PAGE_SIZE));
+            m_Header->BlockCount.store(0, std::memory_order_release);
+        }
+        else if(m_Header->Magic != MAGIC || m_Header->Version != VERSION || m_Header->BlockTicks != blockTicks ||
+                m_Header->MaxBlocks != maxBlocks || m_Header->TradingDay != tradingDay)
+        {
+            return false;
+        }
+        m_Blocks = (TTickBlockEntry*)(m_Base + sizeof(TTickSegmentHeader));
+        Recover();
+        m_Header->Closed.store(0, std::memory_order_release);
+        return true;
+    }
+
+    // 只读打开
+    bool Open(const char* path)
+    {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        bool mapped = fstat(fd, &st) == 0 && (uint64_t)st.st_size >= sizeof(TTickSegmentHeader) && Map(fd, st.st_size, false);
+        close(fd);
+        if(!mapped)
+        {
+            return false;
+        }
+        if(m_Header->Magic != MAGIC || m_Header->Version != VERSION || m_Header->SegmentSize != (uint64_t)st.st_size)
+        {
+            return false;
+        }
+        m_Blocks = (TTickBlockEntry*)(m_Base + sizeof(TTickSegmentHeader));
+        return true;
+    }
+
+    void Unmap()
+    {
+        if(m_Base != NULL)
+        {
+            munmap(m_Base, m_Size);
+            m_Base = NULL;
+            m_Header = NULL;
+            m_Blocks = NULL;
+        }
+    }
+
+    const TTickSegmentHeader* GetHeader() const
+    {
+        return m_Header;
+    }
+
+    // 写入线程调用，块或数据区满返回false
+    bool Append(const TMarketTick& tick)
+    {
+        uint32_t blockTicks = m_Header->BlockTicks;
+        if(m_Hot < 0 || m_Blocks[m_Hot].Count.load(std::memory_order_relaxed) >= blockTicks)
+        {
+            if(!StartBlock())
+            {
+                return false;
+            }
+        }
+        TTickBlockEntry& entry = m_Blocks[m_Hot];
+        uint32_t n = entry.Count.load(std::memory_order_relaxed);
+        int64_t* raw = (int64_t*)(m_Base + entry.RawOffset) + n;
+        int64_t time = ToTradingTime(tick.ExchangeTime);
+        raw[ETICK_COL_TIME * blockTicks] = time;
+        raw[ETICK_COL_RECV_TIME * blockTicks] = tick.RecvTime;
+        raw[ETICK_COL_LAST_PRICE * blockTicks] = ScalePrice(tick.LastPrice);
+        raw[ETICK_COL_VOLUME * blockTicks] = tick.Volume;
+        raw[ETICK_COL_TURNOVER * blockTicks] = llround(tick.Turnover * TURNOVER_SCALE);
+        raw[ETICK_COL_OPEN_INTEREST * blockTicks] = llround(tick.OpenInterest);
+        for(int level = 0; level < STORE_LEVELS; level++)
+        {
+            raw[(ETICK_COL_BID_PRICE + level) * blockTicks] = ScalePrice(tick.BidPrice[level]);
+            raw[(ETICK_COL_ASK_PRICE + level) * blockTicks] = ScalePrice(tick.AskPrice[level]);
+            raw[(ETICK_COL_BID_VOLUME + level) * blockTicks] = tick.BidVolume[level];
+            raw[(ETICK_COL_ASK_VOLUME + level) * blockTicks] = tick.AskVolume[level];
+        }
+        m_HotMin = n == 0 || time < m_HotMin ? time : m_HotMin;
+        m_HotMax = n == 0 || time > m_HotMax ? time : m_HotMax;
+        entry.Count.store(n + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 封存写入块并结束写入，之后全部块可被压缩
+    void Close()
+    {
+        if(m_Header == NULL || !m_Writable)
+        {
+            return;
+        }
+        SealHot();
+        m_Header->Closed.store(1, std::memory_order_release);
+    }
+
+    bool IsClosed() const
+    {
+        return m_Header->Closed.load(std::memory_order_acquire) != 0;
+    }
+
+    // 写入已结束且全部块已编码，压缩线程不再需要该段
+    bool IsCompressed() const
+    {
+        if(!IsClosed())
+        {
+            return false;
+        }
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        for(int b = 0; b < count; b++)
+        {
+            if(m_Blocks[b].State.load(std::memory_order_acquire) != ETICK_BLOCK_ENCODED)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 压缩线程调用，编码已封存的原始块，返回本次编码块数，rawBytes/encodedBytes累加编码前后字节数
+    int Compress(std::vector<uint8_t>& buffer, uint64_t& rawBytes, uint64_t& encodedBytes)
+    {
+        bool closed = IsClosed();
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        int sealed = closed ? count : count - 1;
+        int encoded = 0;
+        for(int b = 0; b < sealed; b++)
+        {
+            TTickBlockEntry& entry = m_Blocks[b];
+            if(entry.State.load(std::memory_order_acquire) != ETICK_BLOCK_RAW)
+            {
+                continue;
+            }
+            uint32_t n = entry.Count.load(std::memory_order_acquire);
+            EncodeBlock((const int64_t*)(m_Base + entry.RawOffset), n, m_Header->BlockTicks, buffer);
+            uint64_t offset = 0;
+            if(!Allocate(buffer.size(), 8, offset))
+            {
+                break;
+            }
+            memcpy(m_Base + offset, &buffer[0], buffer.size());
+            entry.EncodedOffset = offset;
+            entry.EncodedSize = buffer.size();
+            entry.State.store(ETICK_BLOCK_ENCODED, std::memory_order_release);
+            // 读取方在状态切换后读到的原始区全为0，由状态校验丢弃
+            madvise(m_Base + entry.RawOffset, RawBlockBytes(), MADV_REMOVE);
+            rawBytes += (uint64_t)n * ETICK_COL_COUNT * sizeof(int64_t);
+            encodedBytes += buffer.size();
+            encoded++;
+        }
+        return encoded;
+    }
+
+    // 查询[from, to]内行情，时间为交易日起点起算纳秒；行情时间乱序不跨块时结果完整
+    int Query(int64_t from, int64_t to, std::vector<TMarketTick>& ticks) const
+    {
+        size_t begin = ticks.size();
+        std::vector<int64_t> columns;
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        bool closed = IsClosed();
+        for(int b = FirstBlock(from, count, closed); b < count; b++)
+        {
+            bool sealed = closed || b < count - 1;
+            if(sealed && m_Blocks[b].MinTime > to)
+            {
+                break;
+            }
+            uint32_t n = ReadBlock(b, columns);
+            const int64_t* time = columns.data();
+            for(uint32_t i = 0; i < n; i++)
+            {
+                if(time[i] >= from && time[i] <= to)
+                {
+                    ticks.resize(ticks.size() + 1);
+                    FillTick(columns.data(), n, i, ticks.back());
+                }
+            }
+        }
+        return (int)(ticks.size() - begin);
+    }
+
+    // 查询单列，只解码时间列与指定列
+    int QueryColumn(int column, int64_t from, int64_t to, std::vector<int64_t>& times, std::vector<int64_t>& values) const
+    {
+        size_t begin = times.size();
+        std::vector<int64_t> columns;
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        bool closed = IsClosed();
+        for(int b = FirstBlock(from, count, closed); b < count; b++)
+        {
+            bool sealed = closed || b < count - 1;
+            if(sealed && m_Blocks[b].MinTime > to)
+            {
+                break;
+            }
+            uint32_t n = ReadBlock(b, columns, column);
+            for(uint32_t i = 0; i < n; i++)
+            {
+                if(columns[i] >= from && columns[i] <= to)
+                {
+                    times.push_back(columns[i]);
+                    values.push_back(columns[(size_t)column * n + i]);
+                }
+            }
+        }
+        return (int)(times.size() - begin);
+    }
+
+    // 最新一笔行情时间，无数据返回-1
+    int64_t GetLastTime() const
+    {
+        std::vector<int64_t> columns;
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        for(int b = count - 1; b >= 0; b--)
+        {
+            uint32_t n = ReadBlock(b, columns, ETICK_COL_TIME);
+            if(n > 0)
+            {
+                int64_t last = columns[0];
+                for(uint32_t i = 1; i < n; i++)
+                {
+                    last = columns[i] > last ? columns[i] : last;
+                }
+                return last;
+            }
+        }
+        return -1;
+    }
+
+    static force_inline inline int64_t ScalePrice(double price)
+    {
+        return llround(price * PRICE_SCALE);
+    }
+
+protected:
+    static uint64_t Align(uint64_t value, uint64_t align)
+    {
+        return (value + align - 1) / align * align;
+    }
+
+    bool Map(int fd, uint64_t size, bool writable)
+    {
+        void* base = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if(base == MAP_FAILED)
+        {
+            return false;
+        }
+        m_Base = (uint8_t*)base;
+        m_Size = size;
+        m_Header = (TTickSegmentHeader*)m_Base;
+        m_Writable = writable;
+        return true;
+    }
+
+    uint64_t RawBlockBytes() const
+    {
+        return Align((uint64_t)m_Header->BlockTicks * ETICK_COL_COUNT * sizeof(int64_t), PAGE_SIZE);
+    }
+
+    // 写入线程与压缩线程共用数据区
+    bool Allocate(uint64_t size, uint64_t align, uint64_t& offset)
+    {
+        uint64_t current = m_Header->DataEnd.load(std::memory_order_relaxed);
+        uint64_t aligned;
+        do
+        {
+            aligned = Align(current, align);
+            if(aligned + size > m_Header->SegmentSize)
+            {
+                return false;
+            }
+        } while(!m_Header->DataEnd.compare_exchange_weak(current, aligned + size, std::memory_order_relaxed));
+        offset = aligned;
+        return true;
+    }
+
+    // 续写时恢复写入块
+    void Recover()
+    {
+        int count = m_Header->BlockCount.load(std::memory_order_acquire);
+        m_Hot = -1;
+        m_PrefixMax = count > 0 ? m_Blocks[count - 1].PrefixMax : INT64_MIN;
+        if(count == 0 || m_Header->Closed.load(std::memory_order_acquire) || m_Blocks[count - 1].State.load() != ETICK_BLOCK_RAW)
+        {
+            return;
+        }
+        m_Hot = count - 1;
+        m_PrefixMax = m_Hot > 0 ? m_Blocks[m_Hot - 1].PrefixMax : INT64_MIN;
+        const int64_t* time = (const int64_t*)(m_Base + m_Blocks[m_Hot].RawOffset);
+        uint32_t n = m_Blocks[m_Hot].Count.load();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            m_HotMin = i == 0 || time[i] < m_HotMin ? time[i] : m_HotMin;
+            m_HotMax = i == 0 || time[i] > m_HotMax ? time[i] : m_HotMax;
+        }
+    }
+
+    void SealHot()
+    {
+        if(m_Hot < 0)
+        {
+            return;
+        }
+        TTickBlockEntry& entry = m_Blocks[m_Hot];
+        entry.MinTime = m_HotMin;
+        entry.MaxTime = m_HotMax;
+        m_PrefixMax = m_HotMax > m_PrefixMax ? m_HotMax : m_PrefixMax;
+        entry.PrefixMax = m_PrefixMax;
+        m_Hot = -1;
+    }
+
+    bool StartBlock()
+    {
+        int count = m_Header->BlockCount.load(std::memory_order_relaxed);
+        uint64_t offset = 0;
+        if(count >= (int)m_Header->MaxBlocks || !Allocate(RawBlockBytes(), PAGE_SIZE, offset))
+        {
+            return false;
+        }
+        SealHot();
+        TTickBlockEntry& entry = m_Blocks[count];
+        entry.Count.store(0, std::memory_order_relaxed);
+        entry.MinTime = 0;
+        entry.MaxTime = 0;
+        entry.PrefixMax = 0;
+        entry.RawOffset = offset;
+        entry.EncodedOffset = 0;
+        entry.EncodedSize = 0;
+        entry.State.store(ETICK_BLOCK_RAW, std::memory_order_relaxed);
+        m_Hot = count;
+        // 发布新块即封存上一块
+        m_Header->BlockCount.store(count + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 二分查找第一个可能含from之后行情的块
+    int FirstBlock(int64_t from, int count, bool closed) const
+    {
+        int low = 0;
+        int high = closed ? count : count - 1;
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+            if(m_Blocks[mid].PrefixMax < from)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    // 读取块到columns，按列连续存放(列c第i行为columns[c * n + i])，column非负时只读时间列与该列
+    uint32_t ReadBlock(int b, std::vector<int64_t>& columns, int column = -1) const
+    {
+        const TTickBlockEntry& entry = m_Blocks[b];
+        uint32_t blockTicks = m_Header->BlockTicks;
+        while(true)
+        {
+            uint32_t state = entry.State.load(std::memory_order_acquire);
+            if(state == ETICK_BLOCK_ENCODED)
+            {
+                return DecodeBlock(m_Base + entry.EncodedOffset, columns, column);
+            }
+            if(state != ETICK_BLOCK_RAW)
+            {
+                return 0;
+            }
+            uint32_t n = entry.Count.load(std::memory_order_acquire);
+            if(n == 0)
+            {
+                return 0;
+            }
+            columns.resize((size_t)ETICK_COL_COUNT * n);
+            const int64_t* raw = (const int64_t*)(m_Base + entry.RawOffset);
+            for(int c = 0; c < ETICK_COL_COUNT; c++)
+            {
+                if(column < 0 || c == ETICK_COL_TIME || c == column)
+                {
+                    memcpy(&columns[(size_t)c * n], raw + (size_t)c * blockTicks, sizeof(int64_t) * n);
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(entry.State.load(std::memory_order_relaxed) == ETICK_BLOCK_RAW)
+            {
+                return n;
+            }
+        }
+    }
+
+    void FillTick(const int64_t* columns, uint32_t n, uint32_t i, TMarketTick& tick) const
+    {
+        memset(&tick, 0, sizeof(tick));
+        memcpy(tick.InstrumentID, m_Header->InstrumentID, sizeof(tick.InstrumentID));
+        tick.TradingDay = m_Header->TradingDay;
+        tick.ExchangeTime = FromTradingTime(columns[ETICK_COL_TIME * n + i]);
+        tick.RecvTime = columns[ETICK_COL_RECV_TIME * n + i];
+        tick.DepthLevels = STORE_LEVELS;
+        tick.LastPrice = (double)columns[ETICK_COL_LAST_PRICE * n + i] / PRICE_SCALE;
+        tick.Volume = columns[ETICK_COL_VOLUME * n + i];
+        tick.Turnover = (double)columns[ETICK_COL_TURNOVER * n + i] / TURNOVER_SCALE;
+        tick.OpenInterest = (double)columns[ETICK_COL_OPEN_INTEREST * n + i];
+        for(int level = 0; level < STORE_LEVELS; level++)
+        {
+            tick.BidPrice[level] = (double)columns[(ETICK_COL_BID_PRICE + level) * n + i] / PRICE_SCALE;
+            tick.AskPrice[level] = (double)columns[(ETICK_COL_ASK_PRICE + level) * n + i] / PRICE_SCALE;
+            tick.BidVolume[level] = columns[(ETICK_COL_BID_VOLUME + level) * n + i];
+            tick.AskVolume[level] = columns[(ETICK_COL_ASK_VOLUME + level) * n + i];
+        }
+    }
+
+    // 编码块：uint32行数，uint32各列起始偏移[ETICK_COL_COUNT + 1]，之后为各列差分zigzag变长编码
+    static void EncodeBlock(const int64_t* raw, uint32_t n, uint32_t blockTicks, std::vector<uint8_t>& buffer)
+    {
+        uint32_t headerSize = sizeof(uint32_t) * (ETICK_COL_COUNT + 2);
+        buffer.resize(headerSize + (size_t)n * ETICK_COL_COUNT * 10);
+        uint8_t* out = &buffer[0];
+        uint32_t* offsets = (uint32_t*)out;
+        offsets[0] = n;
+        uint32_t pos = headerSize;
+        for(int c = 0; c < ETICK_COL_COUNT; c++)
+        {
+            offsets[c + 1] = pos;
+            const int64_t* column = raw + (size_t)c * blockTicks;
+            int64_t previous = 0;
+            for(uint32_t i = 0; i < n; i++)
+            {
+                uint64_t delta = (uint64_t)column[i] - (uint64_t)previous;
+                uint64_t zigzag = (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+                while(zigzag >= 0x80)
+                {
+                    out[pos++] = (uint8_t)(zigzag | 0x80);
+                    zigzag >>= 7;
+                }
+                out[pos++] = (uint8_t)zigzag;
+                previous = column[i];
+            }
+        }
+        offsets[ETICK_COL_COUNT + 1] = pos;
+        buffer.resize(pos);
+    }
+
+    static uint32_t DecodeBlock(const uint8_t* data, std::vector<int64_t>& columns, int column)
+    {
+        const uint32_t* offsets = (const uint32_t*)data;
+        uint32_t n = offsets[0];
+        columns.resize((size_t)ETICK_COL_COUNT * n);
+        for(int c = 0; c < ETICK_COL_COUNT; c++)
+        {
+            if(column >= 0 && c != ETICK_COL_TIME && c != column)
+            {
+                continue;
+            }
+            const uint8_t* in = data + offsets[c + 1];
+            int64_t* out = columns.data() + (size_t)c * n;
+            uint64_t previous = 0;
+            for(uint32_t i = 0; i < n; i++)
+            {
+                uint64_t zigzag = 0;
+                int shift = 0;
+                uint8_t byte;
+                do
+                {
+                    byte = *in++;
+                    zigzag |= (uint64_t)(byte & 0x7F) << shift;
+                    shift += 7;
+                } while(byte & 0x80);
+                previous += (zigzag >> 1) ^ (0 - (zigzag & 1));
+                out[i] = (int64_t)previous;
+            }
+        }
+        return n;
+    }
+
+private:
+    TickSegment(const TickSegment&);
+    TickSegment& operator=(const TickSegment&);
+private:
+    uint8_t* m_Base;
+    uint64_t m_Size;
+    TTickSegmentHeader* m_Header;
+    TTickBlockEntry* m_Blocks;
+    bool m_Writable;
+    int m_Hot;
+    int64_t m_HotMin;
+    int64_t m_HotMax;
+    int64_t m_PrefixMax;
+};
+
+struct TTickStoreStats
+{
+    uint64_t Ticks;
+    uint64_t Dropped;           // 段文件块数或空间用尽
+    uint64_t Segments;
+    uint64_t ActiveSegments;    // 仍映射在写入进程中、尚未全部编码的段
+    uint64_t EncodedBlocks;
+    uint64_t RawBytes;          // 已压缩块的原始字节数
+    uint64_t EncodedBytes;
+};
+
+// 按合约、交易日分段的列式行情存储，写入端
+// 各柜台行情经TickAdapter转换后在行情回调线程Append；段文件名为dir/InstrumentID_TradingDay.tks，
+// 建议放在/dev/shm，查询进程用TickStoreReader映射同一文件。后台压缩线程编码已写满的块。
+class TickStore
+{
+public:
+    enum
+    {
+        DEFAULT_BLOCK_TICKS = 1024,
+        DEFAULT_MAX_BLOCKS = 1024,
+        INVALID_SLOT = TradeUtil::InstrumentIndex::INVALID_SLOT
+    };
+
+    TickStore(): m_Index(NULL), m_BlockTicks(DEFAULT_BLOCK_TICKS), m_MaxBlocks(DEFAULT_MAX_BLOCKS),
+        m_SegmentSize(256ULL << 20), m_Stop(false)
+    {
+        memset(&m_Stats, 0, sizeof(m_Stats));
+        m_EncodedBlocks = 0;
+        m_RawBytes = 0;
+        m_EncodedBytes = 0;
+        m_ActiveSegments = 0;
+    }
+
+    ~TickStore()
+    {
+        StopCompressor();
+        for(size_t i = 0; i < m_Segments.size(); i++)
+        {
+            delete m_Segments[i];
+        }
+        delete m_Index;
+    }
+
+    // blockTicks须为64的倍数，使原始块按页对齐以便释放；段文件为稀疏文件，只占用实际写入的页
+    bool Init(const char* dir, int capacity, uint32_t blockTicks = DEFAULT_BLOCK_TICKS, uint32_t maxBlocks = DEFAULT_MAX_BLOCKS,
+              uint64_t segmentSize = 256ULL << 20)
+    {
+        if(capacity <= 0 || blockTicks == 0 || blockTicks % 64 != 0 || maxBlocks == 0)
+        {
+            return false;
+        }
+        if(mkdir(dir, 0755) != 0 && errno != EEXIST)
+        {
+            return false;
+        }
+        m_Dir = dir;
+        m_BlockTicks = blockTicks;
+        m_MaxBlocks = maxBlocks;
+        m_SegmentSize = segmentSize;
+        m_Index = new TradeUtil::InstrumentIndex(capacity);
+        m_Current.assign(capacity, (TickSegment*)NULL);
+        return true;
+    }
+
+    int Register(const char* instrumentID)
+    {
+        return m_Index->Register(instrumentID);
+    }
+
+    bool Append(const TMarketTick& tick)
+    {
+        int slot = m_Index->Register(tick.InstrumentID);
+        if(slot == INVALID_SLOT)
+        {
+            m_Stats.Dropped++;
+            return false;
+        }
+        return Append(slot, tick);
+    }
+
+    bool Append(int slot, const TMarketTick& tick)
+    {
+        TickSegment* segment = m_Current[slot];
+        if(segment == NULL || segment->GetHeader()->TradingDay != tick.TradingDay)
+        {
+            segment = OpenSegment(slot, tick);
+            if(segment == NULL)
+            {
+                m_Stats.Dropped++;
+                return false;
+            }
+        }
+        if(!segment->Append(tick))
+        {
+            m_Stats.Dropped++;
+            return false;
+        }
+        m_Stats.Ticks++;
+        return true;
+    }
+
+    // 结束全部段写入，收盘后调用
+    void Close()
+    {
+        for(size_t i = 0; i < m_Current.size(); i++)
+        {
+            if(m_Current[i] != NULL)
+            {
+                m_Current[i]->Close();
+                m_Current[i] = NULL;
+            }
+        }
+    }
+
+    // 压缩一轮，返回编码块数，可由StartCompressor线程定时调用或外部调用，不可并发调用；
+    // 已结束写入且全部编码的段解除映射并移出压缩列表
+    int Compress()
+    {
+        std::vector<TickSegment*> segments;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            segments = m_Segments;
+        }
+        int encoded = 0;
+        uint64_t rawBytes = 0;
+        uint64_t encodedBytes = 0;
+        std::vector<TickSegment*> finished;
+        for(size_t i = 0; i < segments.size(); i++)
+        {
+            encoded += segments[i]->Compress(m_Buffer, rawBytes, encodedBytes);
+            if(segments[i]->IsCompressed())
+            {
+                finished.push_back(segments[i]);
+            }
+        }
+        if(!finished.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for(size_t i = 0; i < finished.size(); i++)
+            {
+                m_Segments.erase(std::find(m_Segments.begin(), m_Segments.end(), finished[i]));
+                delete finished[i];
+            }
+            m_ActiveSegments = m_Segments.size();
+        }
+        m_EncodedBlocks += encoded;
+        m_RawBytes += rawBytes;
+        m_EncodedBytes += encodedBytes;
+        return encoded;
+    }
+
+    void StartCompressor(int intervalMs = 1000)
+    {
+        m_Stop = false;
+        m_Compressor = std::thread([this, intervalMs]()
+        {
+            while(!m_Stop.load())
+            {
+                Compress();
+                for(int i = 0; i < intervalMs && !m_Stop.load(); i += 10)
+                {
+                    usleep(10000);
+                }
+            }
+        });
+    }
+
+    void StopCompressor()
+    {
+        m_Stop = true;
+        if(m_Compressor.joinable())
+        {
+            m_Compressor.join();
+        }
+    }
+
+    void GetStats(TTickStoreStats& stats) const
+    {
+        stats = m_Stats;
+        stats.EncodedBlocks = m_EncodedBlocks.load();
+        stats.RawBytes = m_RawBytes.load();
+        stats.EncodedBytes = m_EncodedBytes.load();
+        stats.ActiveSegments = m_ActiveSegments.load();
+    }
+
+    static std::string GetSegmentPath(const std::string& dir, const char* instrumentID, uint32_t tradingDay)
+    {
+        char name[128] = {0};
+        snprintf(name, sizeof(name), "/%s_%u.tks", instrumentID, tradingDay);
+        return dir + name;
+    }
+
+protected:
+    TickSegment* OpenSegment(int slot, const TMarketTick& tick)
+    {
+        if(m_Current[slot] != NULL)
+        {
+            m_Current[slot]->Close();
+            m_Current[slot] = NULL;
+        }
+        std::string path = GetSegmentPath(m_Dir, tick.InstrumentID, tick.TradingDay);
+        TickSegment* segment = new TickSegment();
+        if(!segment->Create(path.c_str(), tick.InstrumentID, tick.TradingDay, m_BlockTicks, m_MaxBlocks, m_SegmentSize))
+        {
+            delete segment;
+            return NULL;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Segments.push_back(segment);
+            m_ActiveSegments = m_Segments.size();
+        }
+        m_Current[slot] = segment;
+        m_Stats.Segments++;
+        return segment;
+    }
+
+private:
+    TickStore(const TickStore&);
+    TickStore& operator=(const TickStore&);
+private:
+    TradeUtil::InstrumentIndex* m_Index;
+    std::string m_Dir;
+    uint32_t m_BlockTicks;
+    uint32_t m_MaxBlocks;
+    uint64_t m_SegmentSize;
+    std::vector<TickSegment*> m_Current;
+    std::vector<TickSegment*> m_Segments;
+    std::mutex m_Mutex;
+    std::thread m_Compressor;
+    std::atomic<bool> m_Stop;
+    std::vector<uint8_t> m_Buffer;
+    TTickStoreStats m_Stats;
+    std::atomic<uint64_t> m_EncodedBlocks;
+    std::atomic<uint64_t> m_RawBytes;
+    std::atomic<uint64_t> m_EncodedBytes;
+    std::atomic<uint64_t> m_ActiveSegments;
+};
+
+// 查询端，可在其它进程打开写入中的段文件，查询不阻塞写入
+class TickStoreReader
+{
+public:
+    bool Open(const char* dir, const char* instrumentID, uint32_t tradingDay)
+    {
+        return m_Segment.Open(TickStore::GetSegmentPath(dir, instrumentID, tradingDay).c_str());
+    }
+
+    // 时间为当地零点起算纳秒，夜盘跨零点按交易日先后比较
+    int Query(int64_t from, int64_t to, std::vector<TMarketTick>& ticks) const
+    {
+        return m_Segment.Query(ToTradingTime(from), ToTradingTime(to), ticks);
+    }
+
+    // 最新一笔行情之前duration纳秒内的行情
+    int QueryLast(int64_t duration, std::vector<TMarketTick>& ticks) const
+    {
+        int64_t last = m_Segment.GetLastTime();
+        if(last < 0)
+        {
+            return 0;
+        }
+        return m_Segment.Query(last - duration, last, ticks);
+    }
+
+    // 单列原始整数值，价格为实际价格乘以TickSegment::PRICE_SCALE，times为当地零点起算纳秒
+    int QueryColumn(int column, int64_t from, int64_t to, std::vector<int64_t>& times, std::vector<int64_t>& values) const
+    {
+        size_t begin = times.size();
+        int count = m_Segment.QueryColumn(column, ToTradingTime(from), ToTradingTime(to), times, values);
+        for(size_t i = begin; i < times.size(); i++)
+        {
+            times[i] = FromTradingTime(times[i]);
+        }
+        return count;
+    }
+
+    const TTickSegmentHeader* GetHeader() const
+    {
+        return m_Segment.GetHeader();
+    }
+
+private:
+    TickSegment m_Segment;
+};
+
+}
+
+#endif // TICKSTORE_HPP
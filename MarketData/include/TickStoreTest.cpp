@@ -0,0 +1,266 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+#include "TickStore.hpp"
+#include "HRTimer.hpp"
+
+static const char* DIR = "/dev/shm/TickStoreTest";
+
+static int64_t T(const char* hhmmss, int millisec = 0)
+{
+    return MarketData::ParseTimeOfDay(hhmmss, millisec);
+}
+
+// 第i笔行情，各字段可由i推出，用于校验读取结果
+static void MakeTick(MarketData::TMarketTick& tick, const char* instrumentID, uint32_t tradingDay, int64_t start, int i)
+{
+    memset(&tick, 0, sizeof(tick));
+    strncpy(tick.InstrumentID, instrumentID, sizeof(tick.InstrumentID) - 1);
+    tick.TradingDay = tradingDay;
+    tick.ExchangeTime = MarketData::FromTradingTime(MarketData::ToTradingTime(start) + i * 500000000LL);
+    tick.RecvTime = 1717419600000000000LL + i * 500000123LL;
+    tick.LastPrice = 3600 + (i % 50) * 0.5;
+    tick.Volume = 1000 + i * 3;
+    tick.Turnover = tick.Volume * 36000.25;
+    tick.OpenInterest = 200000 - i;
+    for(int level = 0; level < 5; level++)
+    {
+        tick.BidPrice[level] = tick.LastPrice - 1 - level;
+        tick.AskPrice[level] = tick.LastPrice + 1 + level;
+        tick.BidVolume[level] = 10 + (i + level) % 7;
+        tick.AskVolume[level] = 20 + (i * level) % 5;
+    }
+}
+
+static void CheckTick(const MarketData::TMarketTick& tick, const char* instrumentID, uint32_t tradingDay, int64_t start)
+{
+    int i = (int)((tick.Volume - 1000) / 3);
+    MarketData::TMarketTick expected;
+    MakeTick(expected, instrumentID, tradingDay, start, i);
+    assert(strcmp(tick.InstrumentID, instrumentID) == 0 && tick.TradingDay == tradingDay);
+    assert(tick.ExchangeTime == expected.ExchangeTime && tick.RecvTime == expected.RecvTime);
+    assert(tick.LastPrice == expected.LastPrice && tick.Turnover == expected.Turnover);
+    assert(tick.OpenInterest == expected.OpenInterest);
+    for(int level = 0; level < 5; level++)
+    {
+        assert(tick.BidPrice[level] == expected.BidPrice[level] && tick.AskPrice[level] == expected.AskPrice[level]);
+        assert(tick.BidVolume[level] == expected.BidVolume[level] && tick.AskVolume[level] == expected.AskVolume[level]);
+    }
+}
+
+static void TestQuery()
+{
+    MarketData::TickStore store;
+    assert(!store.Init(DIR, 16, 100));
+    assert(store.Init(DIR, 16, 64, 64, 4 << 20));
+    // 23:58:00起1000笔，跨零点
+    const int64_t start = T("23:58:00");
+    MarketData::TMarketTick tick;
+    for(int i = 0; i < 1000; i++)
+    {
+        MakeTick(tick, "rb2410", 20240603, start, i);
+        assert(store.Append(tick));
+    }
+
+    MarketData::TickStoreReader reader;
+    assert(!reader.Open(DIR, "rb2410", 20240604));
+    assert(reader.Open(DIR, "rb2410", 20240603));
+    assert(reader.GetHeader()->BlockCount.load() == 16);
+    std::vector<MarketData::TMarketTick> ticks;
+    for(int round = 0; round < 3; round++)
+    {
+        ticks.clear();
+        assert(reader.QueryLast(60000000000LL, ticks) == 121);
+        assert(ticks.front().ExchangeTime == T("00:05:19", 500) && ticks.back().ExchangeTime == T("00:06:19", 500));
+        for(size_t i = 0; i < ticks.size(); i++)
+        {
+            CheckTick(ticks[i], "rb2410", 20240603, start);
+        }
+        ticks.clear();
+        assert(reader.Query(T("23:59:00"), T("00:01:00"), ticks) == 241);
+        assert(ticks.front().Volume == 1000 + 120 * 3 && ticks.back().Volume == 1000 + 360 * 3);
+        for(size_t i = 0; i < ticks.size(); i++)
+        {
+            CheckTick(ticks[i], "rb2410", 20240603, start);
+        }
+        ticks.clear();
+        assert(reader.Query(T("21:00:00"), T("23:57:59"), ticks) == 0);
+        assert(reader.Query(T("00:07:00"), T("01:00:00"), ticks) == 0);
+
+        std::vector<int64_t> times;
+        std::vector<int64_t> prices;
+        assert(reader.QueryColumn(MarketData::ETICK_COL_LAST_PRICE, T("00:00:00"), T("00:00:10"), times, prices) == 21);
+        assert(times[0] == T("00:00:00") && prices[0] == MarketData::TickSegment::ScalePrice(3600 + 40 * 0.5));
+
+        // 第一轮读原始块，第二轮读编码块，第三轮写入结束后全部编码
+        if(round == 0)
+        {
+            assert(store.Compress() == 15);
+            assert(store.Compress() == 0);
+        }
+        else if(round == 1)
+        {
+            store.Close();
+            assert(store.Compress() == 1);
+            // 全部编码后写入端解除映射，原始块已释放
+            MarketData::TTickStoreStats closed;
+            store.GetStats(closed);
+            assert(closed.ActiveSegments == 0);
+            struct stat st;
+            assert(stat(MarketData::TickStore::GetSegmentPath(DIR, "rb2410", 20240603).c_str(), &st) == 0);
+            assert((uint64_t)st.st_blocks * 512 < 16 * 64 * MarketData::ETICK_COL_COUNT * sizeof(int64_t));
+        }
+    }
+    MarketData::TTickStoreStats stats;
+    store.GetStats(stats);
+    assert(stats.Ticks == 1000 && stats.Dropped == 0 && stats.Segments == 1 && stats.EncodedBlocks == 16);
+    fprintf(stderr, "TickStore raw %lu bytes encoded %lu bytes ratio %.1f\n", stats.RawBytes, stats.EncodedBytes,
+            (double)stats.RawBytes / stats.EncodedBytes);
+    assert(stats.EncodedBytes * 4 < stats.RawBytes);
+
+    // 续写同一交易日，新交易日另建段文件
+    MarketData::TickStore store2;
+    assert(store2.Init(DIR, 16, 64, 64, 4 << 20));
+    for(int i = 1000; i < 1100; i++)
+    {
+        MakeTick(tick, "rb2410", 20240603, start, i);
+        assert(store2.Append(tick));
+    }
+    MakeTick(tick, "rb2410", 20240604, start, 0);
+    assert(store2.Append(tick));
+    ticks.clear();
+    assert(reader.Query(T("23:58:00"), T("02:00:00"), ticks) == 1100);
+    for(size_t i = 0; i < ticks.size(); i++)
+    {
+        assert(ticks[i].Volume == 1000 + (int64_t)i * 3);
+    }
+    store2.GetStats(stats);
+    assert(stats.Segments == 2);
+    MarketData::TickStoreReader reader2;
+    assert(reader2.Open(DIR, "rb2410", 20240604));
+    ticks.clear();
+    assert(reader2.QueryLast(0, ticks) == 1);
+
+    // 段文件块数用尽
+    MarketData::TickStore small;
+    assert(small.Init(DIR, 16, 64, 2, 4 << 20));
+    for(int i = 0; i < 129; i++)
+    {
+        MakeTick(tick, "IF2406", 20240603, T("09:30:00"), i);
+        assert(small.Append(tick) == (i < 128));
+    }
+    small.GetStats(stats);
+    assert(stats.Ticks == 128 && stats.Dropped == 1);
+}
+
+// 写入线程、后台压缩线程与读取线程并发，读取结果须与写入一致
+static void TestConcurrent()
+{
+    const int N = 100000;
+    const int64_t start = T("17:00:00");
+    MarketData::TickStore store;
+    assert(store.Init(DIR, 16, 256, 1024, 64 << 20));
+    store.StartCompressor(1);
+    std::atomic<bool> done(false);
+    std::thread writer([&]()
+    {
+        MarketData::TMarketTick tick;
+        for(int i = 0; i < N; i++)
+        {
+            MakeTick(tick, "ag2408", 20240603, start, i);
+            store.Append(tick);
+        }
+        done = true;
+    });
+    MarketData::TickStoreReader reader;
+    while(!reader.Open(DIR, "ag2408", 20240603))
+    {
+        usleep(100);
+    }
+    std::vector<MarketData::TMarketTick> ticks;
+    int queries = 0;
+    while(!done.load() || queries == 0)
+    {
+        ticks.clear();
+        int count = reader.QueryLast(30000000000LL, ticks);
+        for(int i = 0; i < count; i++)
+        {
+            CheckTick(ticks[i], "ag2408", 20240603, start);
+            assert(i == 0 || ticks[i].Volume == ticks[i - 1].Volume + 3);
+        }
+        queries++;
+    }
+    writer.join();
+    store.StopCompressor();
+    MarketData::TTickStoreStats stats;
+    store.GetStats(stats);
+    uint64_t background = stats.EncodedBlocks;
+    // 最后一块仍在写入
+    store.Compress();
+    store.GetStats(stats);
+    assert(stats.Ticks == (uint64_t)N && stats.EncodedBlocks == (uint64_t)N / 256);
+    ticks.clear();
+    assert(reader.Query(T("17:00:00"), T("16:59:59"), ticks) == N);
+    fprintf(stderr, "TickStore concurrent %d queries, %lu blocks encoded in background\n", queries, background);
+}
+
+int main(int argc, char* argv[])
+{
+    system("rm -rf /dev/shm/TickStoreTest");
+    TestQuery();
+    TestConcurrent();
+    system("rm -rf /dev/shm/TickStoreTest");
+
+    // 写入延迟与查询最近5分钟耗时
+    const int N = 1000000;
+    MarketData::TickStore store;
+    assert(store.Init(DIR, 16, 1024, 1024, 256 << 20));
+    int slot = store.Register("IF2406");
+    MarketData::TMarketTick tick;
+    MakeTick(tick, "IF2406", 20240603, T("09:30:00"), 0);
+    TimeUtil::HRTimer timer;
+    uint64_t begin = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        tick.ExchangeTime = T("09:30:00") + i * 10000000LL;
+        tick.Volume = i;
+        tick.LastPrice = 3500 + (i % 20) * 0.2;
+        store.Append(slot, tick);
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "TickStore Append Latency: %.1f ns\n", (double)(end - begin) / N);
+    begin = timer.GetTimeNs();
+    int blocks = store.Compress();
+    end = timer.GetTimeNs();
+    fprintf(stderr, "TickStore Compress %d blocks: %.1f us/block\n", blocks, (double)(end - begin) / 1000 / blocks);
+
+    MarketData::TickStoreReader reader;
+    assert(reader.Open(DIR, "IF2406", 20240603));
+    std::vector<MarketData::TMarketTick> ticks;
+    std::vector<int64_t> times;
+    std::vector<int64_t> values;
+    const int ROUNDS = 100;
+    begin = timer.GetTimeNs();
+    for(int r = 0; r < ROUNDS; r++)
+    {
+        ticks.clear();
+        reader.QueryLast(300000000000LL, ticks);
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "TickStore QueryLast 5min %lu ticks: %.1f us\n", ticks.size(), (double)(end - begin) / 1000 / ROUNDS);
+    begin = timer.GetTimeNs();
+    for(int r = 0; r < ROUNDS; r++)
+    {
+        times.clear();
+        values.clear();
+        reader.QueryColumn(MarketData::ETICK_COL_LAST_PRICE, T("10:00:00"), T("10:05:00"), times, values);
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "TickStore QueryColumn 5min %lu ticks: %.1f us\n", times.size(), (double)(end - begin) / 1000 / ROUNDS);
+    system("rm -rf /dev/shm/TickStoreTest");
+    return 0;
+}
+
+// g++ -std=c++11 -O2 TickStoreTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../TradeUtil/include
@@ -0,0 +1,138 @@
+#ifndef TORAMARKETFEED_HPP
+#define TORAMARKETFEED_HPP
+
+#include "TORATstpLev2MdApi.h"
+#include "MarketFeed.hpp"
+
+namespace MarketData
+{
+
+// 华鑫Tora Level2行情适配，合约代码为600000.SH/000001.SZ
+// 配置Multicast时使用组播模式，否则连接FrontAddress；API内部线程(含回调线程)按RecvCpus
+// 在Init(cpuCores)中绑核。行情结构体中无交易日，取登录应答中的交易日，未登录时取当日日期。
+class ToraMarketFeed: public MarketFeed, public TORALEV2API::CTORATstpLev2MdSpi
+{
+public:
+    ToraMarketFeed(): m_Api(NULL), m_RequestID(0), m_TradingDay(0)
+    {
+    }
+
+    virtual ~ToraMarketFeed()
+    {
+        Stop();
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        MarketFeed::Init(config, sink);
+        if(m_Config.FrontAddress.empty() && m_Config.Multicast.empty())
+        {
+            return false;
+        }
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+        m_TradingDay = (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+        GroupInstruments(m_Instruments);
+        TORALEV2API::TTORATstpMDSubModeType mode = m_Config.Multicast.empty() ? TORALEV2API::TORA_TSTP_MST_TCP : TORALEV2API::TORA_TSTP_MST_MCAST;
+        m_Api = TORALEV2API::CTORATstpLev2MdApi::CreateTstpLev2MdApi(mode);
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        m_Api->RegisterSpi(this);
+        for(size_t i = 0; i < m_Config.FrontAddress.size(); i++)
+        {
+            m_Api->RegisterFront(&m_Config.FrontAddress[i][0]);
+        }
+        for(size_t i = 0; i < m_Config.Multicast.size(); i++)
+        {
+            m_Api->RegisterMulticast(&m_Config.Multicast[i][0], m_Config.LocalIP.empty() ? NULL : &m_Config.LocalIP[0], NULL,
+                                     m_Config.Interface.c_str());
+        }
+        return true;
+    }
+
+    virtual bool Start()
+    {
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        std::string cpus = FormatCpuList(m_Config.RecvCpus);
+        m_Api->Init(cpus.c_str());
+        return true;
+    }
+
+    virtual void Stop()
+    {
+        if(m_Api != NULL)
+        {
+            m_Api->RegisterSpi(NULL);
+            m_Api->Release();
+            m_Api = NULL;
+        }
+    }
+
+    virtual void OnFrontConnected()
+    {
+        TORALEV2API::CTORATstpReqUserLoginField request;
+        memset(&request, 0, sizeof(request));
+        strncpy(request.LogInAccount, m_Config.UserID.c_str(), sizeof(request.LogInAccount) - 1);
+        request.LogInAccountType = TORALEV2API::TORA_TSTP_LACT_UserID;
+        strncpy(request.Password, m_Config.Password.c_str(), sizeof(request.Password) - 1);
+        m_Api->ReqUserLogin(&request, ++m_RequestID);
+    }
+
+    virtual void OnFrontDisconnected(int nReason)
+    {
+        char message[32];
+        snprintf(message, sizeof(message), "reason %d", nReason);
+        m_Sink->OnStatus(false, message);
+    }
+
+    virtual void OnRspUserLogin(TORALEV2API::CTORATstpRspUserLoginField* pRspUserLogin, TORALEV2API::CTORATstpRspInfoField* pRspInfo,
+                                int nRequestID, bool bIsLast)
+    {
+        if(pRspInfo != NULL && pRspInfo->ErrorID != 0)
+        {
+            m_Sink->OnStatus(false, pRspInfo->ErrorMsg);
+            return;
+        }
+        if(pRspUserLogin != NULL && atoi(pRspUserLogin->TradingDay) > 0)
+        {
+            m_TradingDay = atoi(pRspUserLogin->TradingDay);
+        }
+        m_Sink->OnStatus(true, "login");
+        std::vector<char*> argv;
+        for(std::map<std::string, std::vector<std::string> >::iterator it = m_Instruments.begin(); it != m_Instruments.end(); ++it)
+        {
+            MakeArgv(it->second, argv);
+            TORALEV2API::TTORATstpExchangeIDType exchange = it->first == "SH" ? TORALEV2API::TORA_TSTP_EXD_SSE : TORALEV2API::TORA_TSTP_EXD_SZSE;
+            if(!argv.empty())
+            {
+                m_Api->SubscribeMarketData(&argv[0], (int)argv.size(), exchange);
+            }
+        }
+    }
+
+    virtual void OnRtnMarketData(TORALEV2API::CTORATstpLev2MarketDataField* pMarketData, const int FirstLevelBuyNum,
+                                 const int FirstLevelBuyOrderVolumes[], const int FirstLevelSellNum, const int FirstLevelSellOrderVolumes[])
+    {
+        int64_t recvTime = GetTimeNs();
+        static thread_local TMarketTick tick;
+        TickAdapter::Convert(*pMarketData, tick);
+        tick.TradingDay = m_TradingDay;
+        tick.ActionDay = m_TradingDay;
+        m_Sink->OnTick(tick, recvTime);
+    }
+private:
+    TORALEV2API::CTORATstpLev2MdApi* m_Api;
+    int m_RequestID;
+    uint32_t m_TradingDay;
+    std::map<std::string, std::vector<std::string> > m_Instruments;
+};
+
+}
+
+#endif // TORAMARKETFEED_HPP
@@ -0,0 +1,127 @@
+#ifndef XTPMARKETFEED_HPP
+#define XTPMARKETFEED_HPP
+
+#include "xtp_quote_api.h"
+#include "MarketFeed.hpp"
+
+namespace MarketData
+{
+
+// XTP行情适配，合约代码为600000.SH/000001.SZ
+// UDP行情由XTP接收线程与解析线程处理，行情回调在解析线程上，绑核通过
+// SetUDPRecvThreadAffinityArray/SetUDPParseThreadAffinityArray在登录前设置；
+// 配置多个解析线程时须设置MultiThreaded。
+class XTPMarketFeed: public MarketFeed, public XTP::API::QuoteSpi
+{
+public:
+    XTPMarketFeed(): m_Api(NULL), m_Port(0)
+    {
+    }
+
+    virtual ~XTPMarketFeed()
+    {
+        Stop();
+    }
+
+    virtual bool Init(const TFeedConfig& config, FeedSink* sink)
+    {
+        MarketFeed::Init(config, sink);
+        if(m_Config.FrontAddress.empty() || !SplitAddress(m_Config.FrontAddress[0], m_IP, m_Port))
+        {
+            return false;
+        }
+        m_Api = XTP::API::QuoteApi::CreateQuoteApi((uint8_t)m_Config.ClientID, m_Config.FlowPath.c_str(), XTP_LOG_LEVEL_INFO);
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        m_Api->RegisterSpi(this);
+        m_Api->SetHeartBeatInterval(m_Config.HeartBeatInterval);
+        if(m_Config.Protocol == "UDP")
+        {
+            m_Api->SetUDPBufferSize(m_Config.BufferSize);
+            std::vector<int32_t> recvCpus(m_Config.RecvCpus.begin(), m_Config.RecvCpus.end());
+            std::vector<int32_t> parseCpus(m_Config.ParseCpus.begin(), m_Config.ParseCpus.end());
+            if(!recvCpus.empty())
+            {
+                m_Api->SetUDPRecvThreadAffinityArray(&recvCpus[0], (int32_t)recvCpus.size());
+            }
+            if(!parseCpus.empty())
+            {
+                m_Api->SetUDPParseThreadAffinityArray(&parseCpus[0], (int32_t)parseCpus.size());
+            }
+        }
+        else
+        {
+            m_Sink->SetCallbackCpu(m_Config.CallbackCpu);
+        }
+        GroupInstruments(m_Instruments);
+        return true;
+    }
+
+    // XTP登录为同步调用，登录成功后按交易所订阅
+    virtual bool Start()
+    {
+        if(m_Api == NULL)
+        {
+            return false;
+        }
+        XTP_PROTOCOL_TYPE protocol = m_Config.Protocol == "UDP" ? XTP_PROTOCOL_UDP : XTP_PROTOCOL_TCP;
+        const char* localIP = m_Config.LocalIP.empty() ? NULL : m_Config.LocalIP.c_str();
+        if(m_Api->Login(m_IP.c_str(), m_Port, m_Config.UserID.c_str(), m_Config.Password.c_str(), protocol, localIP) != 0)
+        {
+            XTPRI* error = m_Api->GetApiLastError();
+            m_Sink->OnStatus(false, error != NULL ? error->error_msg : "login failed");
+            return false;
+        }
+        m_Sink->OnStatus(true, "login");
+        std::vector<char*> argv;
+        for(std::map<std::string, std::vector<std::string> >::iterator it = m_Instruments.begin(); it != m_Instruments.end(); ++it)
+        {
+            MakeArgv(it->second, argv);
+            XTP_EXCHANGE_TYPE exchange = it->first == "SH" ? XTP_EXCHANGE_SH : XTP_EXCHANGE_SZ;
+            if(!argv.empty() && m_Api->SubscribeMarketData(&argv[0], (int)argv.size(), exchange) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    virtual void Stop()
+    {
+        if(m_Api != NULL)
+        {
+            m_Api->Logout();
+            m_Api->RegisterSpi(NULL);
+            m_Api->Release();
+            m_Api = NULL;
+        }
+    }
+
+    // XTP断线后不自动重连，由运维重启网关
+    virtual void OnDisconnected(int reason)
+    {
+        char message[32];
+        snprintf(message, sizeof(message), "reason %d", reason);
+        m_Sink->OnStatus(false, message);
+    }
+
+    virtual void OnDepthMarketData(XTPMD* market_data, int64_t bid1_qty[], int32_t bid1_count, int32_t max_bid1_count,
+                                   int64_t ask1_qty[], int32_t ask1_count, int32_t max_ask1_count)
+    {
+        int64_t recvTime = GetTimeNs();
+        static thread_local TMarketTick tick;
+        TickAdapter::Convert(*market_data, tick);
+        m_Sink->OnTick(tick, recvTime);
+    }
+private:
+    XTP::API::QuoteApi* m_Api;
+    std::string m_IP;
+    int m_Port;
+    std::map<std::string, std::vector<std::string> > m_Instruments;
+};
+
+}
+
+#endif // XTPMARKETFEED_HPP
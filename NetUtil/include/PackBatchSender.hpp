@@ -0,0 +1,556 @@
+#ifndef PACKBATCHSENDER_HPP
+#define PACKBATCHSENDER_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include "SocketInterface.h"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace NetUtil
+{
+
+// 单连接积压统计
+struct TPackBacklog
+{
+    uint64_t PendingPacks;      // 本层尚未刷出的包数
+    uint64_t PendingBytes;      // 本层尚未刷出的字节数，含包头
+    uint64_t MaxPendingBytes;
+    uint64_t OldestPendingNs;   // 最早未刷出包的入队时间，无积压为0
+    int64_t SocketPending;      // 组件发送队列中未发出的字节数，GetPendingDataLength
+    uint64_t Packs;             // 已刷出的包数
+    uint64_t Bytes;             // 已刷出的字节数，含包头
+    uint64_t Flushes;           // SendPackets调用次数
+    uint64_t Failures;          // SendPackets失败次数
+};
+
+// HP-Socket PACK协议批量发送
+// 在PUSH模型的ITcpServer/ITcpAgent之上自行按PACK协议组帧(包头为(包头标识 << 22) | 包长的主机序DWORD)，
+// 对端仍使用ITcpPackClient/ITcpPackServer/ITcpPackAgent，包头标识和最大包长须与对端一致。
+// 底层组件不能是PACK组件，否则SendPackets会把整批数据再组成一个包。
+// 每个连接的待发包在时间/字节预算内累积，到达预算时由一次SendPackets聚集写出：
+// 连续的小包复制到连接缓冲区合并为一段，广播包组帧一次由各连接引用，大包直接引用调用方内存。
+// 超时刷出由调用方周期调用FlushExpired驱动。
+// AddConnection/RemoveConnection在OnAccept(OnConnect)/OnClose中调用，各接口可在任意线程并发调用，
+// 同一连接的操作由连接自旋锁串行化。
+template <class TSocket>
+class PackBatchSender
+{
+public:
+    enum
+    {
+        PACK_HEADER_SIZE = 4,
+        PACK_LENGTH_BITS = 22,
+        PACK_LENGTH_MASK = 0x3FFFFF,
+        MAX_HEADER_FLAG = 0x3FF,
+        MAX_SEGMENT_COUNT = 64      // 单次SendPackets最多的缓冲区段数
+    };
+
+    PackBatchSender(): m_Socket(NULL), m_Connections(NULL), m_Mask(0), m_BatchBytes(0), m_MaxDelayNs(0),
+        m_MaxPackSize(0x40000), m_HeaderFlag(0)
+    {
+    }
+
+    ~PackBatchSender()
+    {
+        if(m_Connections != NULL)
+        {
+            for(uint32_t i = 0; i <= m_Mask; i++)
+            {
+                ReleasePending(m_Connections[i]);
+                free(m_Connections[i].Buffer);
+            }
+            free(m_Connections);
+        }
+    }
+
+    // batchBytes为单连接累积字节预算，maxDelayNs为最早待发包的最长停留时间，为0时每包立即刷出
+    bool Init(TSocket* socket, int maxConnections, uint32_t batchBytes = 16 * 1024, uint64_t maxDelayNs = 50000)
+    {
+        if(socket == NULL || maxConnections <= 0 || batchBytes < PACK_HEADER_SIZE || m_Connections != NULL)
+        {
+            return false;
+        }
+        uint32_t size = 2;
+        while(size < (uint32_t)maxConnections * 2)
+        {
+            size <<= 1;
+        }
+        void* memory = NULL;
+        if(posix_memalign(&memory, 64, sizeof(TConnection) * size) != 0)
+        {
+            return false;
+        }
+        memset(memory, 0, sizeof(TConnection) * size);
+        m_Connections = (TConnection*)memory;
+        for(uint32_t i = 0; i < size; i++)
+        {
+            m_Connections[i].Buffer = (char*)malloc(batchBytes);
+            if(m_Connections[i].Buffer == NULL)
+            {
+                return false;
+            }
+        }
+        m_Mask = size - 1;
+        m_Socket = socket;
+        m_BatchBytes = batchBytes;
+        m_MaxDelayNs = maxDelayNs;
+        return true;
+    }
+
+    // 与对端IPackSocket/IPackClient的设置一致
+    void SetMaxPackSize(DWORD maxPackSize)
+    {
+        m_MaxPackSize = maxPackSize < PACK_LENGTH_MASK ? maxPackSize : PACK_LENGTH_MASK;
+    }
+
+    void SetPackHeaderFlag(USHORT headerFlag)
+    {
+        m_HeaderFlag = headerFlag < MAX_HEADER_FLAG ? headerFlag : MAX_HEADER_FLAG;
+    }
+
+    DWORD GetMaxPackSize() const
+    {
+        return m_MaxPackSize;
+    }
+
+    USHORT GetPackHeaderFlag() const
+    {
+        return m_HeaderFlag;
+    }
+
+    bool AddConnection(CONNID connID)
+    {
+        if(connID == EMPTY_CONNID || connID == REMOVED_CONNID)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_TableLock);
+        if(FindSlot(connID) != NULL)
+        {
+            return true;
+        }
+        for(uint32_t i = 0, index = Hash(connID); i <= m_Mask; i++, index = (index + 1) & m_Mask)
+        {
+            TConnection& connection = m_Connections[index];
+            CONNID current = connection.ConnID.load(std::memory_order_relaxed);
+            if(current == EMPTY_CONNID || current == REMOVED_CONNID)
+            {
+                Lock(connection);
+                ResetStats(connection);
+                connection.ConnID.store(connID, std::memory_order_release);
+                Unlock(connection);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 丢弃未刷出的包
+    void RemoveConnection(CONNID connID)
+    {
+        std::lock_guard<std::mutex> lock(m_TableLock);
+        TConnection* connection = FindSlot(connID);
+        if(connection != NULL)
+        {
+            Lock(*connection);
+            ReleasePending(*connection);
+            connection->ConnID.store(REMOVED_CONNID, std::memory_order_release);
+            Unlock(*connection);
+        }
+    }
+
+    bool Send(CONNID connID, const BYTE* data, int length, uint64_t nowNs)
+    {
+        if(length < 0 || (DWORD)length > m_MaxPackSize)
+        {
+            return false;
+        }
+        TConnection* connection = Acquire(connID);
+        if(connection == NULL)
+        {
+            return false;
+        }
+        bool ret = true;
+        uint32_t frameSize = PACK_HEADER_SIZE + length;
+        if(frameSize > m_BatchBytes)
+        {
+            // 大包连同积压一次写出，不复制包体
+            uint32_t header = MakeHeader(length);
+            ret = FlushLocked(*connection, (const BYTE*)&header, data, length);
+        }
+        else
+        {
+            if(connection->PendingBytes + frameSize > m_BatchBytes || connection->SegmentCount == MAX_SEGMENT_COUNT)
+            {
+                ret = FlushLocked(*connection, NULL, NULL, 0);
+            }
+            AppendLocal(*connection, data, length, nowNs);
+            if(m_MaxDelayNs == 0 || connection->PendingBytes >= m_BatchBytes)
+            {
+                ret = FlushLocked(*connection, NULL, NULL, 0) && ret;
+            }
+        }
+        Unlock(*connection);
+        return ret;
+    }
+
+    // 组帧一次追加到各连接，返回成功入队的连接数
+    int Broadcast(const CONNID connIDs[], int count, const BYTE* data, int length, uint64_t nowNs)
+    {
+        if(count <= 0 || length < 0 || (DWORD)length > m_MaxPackSize)
+        {
+            return 0;
+        }
+        TSharedFrame* frame = (TSharedFrame*)malloc(sizeof(TSharedFrame) + PACK_HEADER_SIZE + length);
+        if(frame == NULL)
+        {
+            return 0;
+        }
+        // 持有一个引用直到分发结束
+        frame->RefCount.store(1, std::memory_order_relaxed);
+        frame->Length = PACK_HEADER_SIZE + length;
+        uint32_t header = MakeHeader(length);
+        memcpy(frame->Data, &header, PACK_HEADER_SIZE);
+        memcpy(frame->Data + PACK_HEADER_SIZE, data, length);
+        int queued = 0;
+        for(int i = 0; i < count; i++)
+        {
+            TConnection* connection = Acquire(connIDs[i]);
+            if(connection == NULL)
+            {
+                continue;
+            }
+            if(connection->PendingBytes + frame->Length > m_BatchBytes || connection->SegmentCount == MAX_SEGMENT_COUNT)
+            {
+                FlushLocked(*connection, NULL, NULL, 0);
+            }
+            frame->RefCount.fetch_add(1, std::memory_order_relaxed);
+            TSegment& segment = connection->Segments[connection->SegmentCount++];
+            segment.Shared = frame;
+            segment.Offset = 0;
+            segment.Length = frame->Length;
+            OnAppend(*connection, frame->Length, nowNs);
+            if(m_MaxDelayNs == 0 || connection->PendingBytes >= m_BatchBytes)
+            {
+                FlushLocked(*connection, NULL, NULL, 0);
+            }
+            Unlock(*connection);
+            queued++;
+        }
+        ReleaseFrame(frame);
+        return queued;
+    }
+
+    bool Flush(CONNID connID)
+    {
+        TConnection* connection = Acquire(connID);
+        if(connection == NULL)
+        {
+            return false;
+        }
+        bool ret = FlushLocked(*connection, NULL, NULL, 0);
+        Unlock(*connection);
+        return ret;
+    }
+
+    // 刷出积压超过maxDelayNs的连接，返回刷出的连接数
+    int FlushExpired(uint64_t nowNs)
+    {
+        int flushed = 0;
+        for(uint32_t i = 0; i <= m_Mask; i++)
+        {
+            TConnection& connection = m_Connections[i];
+            uint64_t oldest = connection.OldestPendingNs.load(std::memory_order_relaxed);
+            if(oldest == 0 || nowNs - oldest < m_MaxDelayNs)
+            {
+                continue;
+            }
+            Lock(connection);
+            CONNID connID = connection.ConnID.load(std::memory_order_relaxed);
+            if(connID != EMPTY_CONNID && connID != REMOVED_CONNID && connection.SegmentCount > 0)
+            {
+                FlushLocked(connection, NULL, NULL, 0);
+                flushed++;
+            }
+            Unlock(connection);
+        }
+        return flushed;
+    }
+
+    int FlushAll()
+    {
+        return FlushExpired(UINT64_MAX);
+    }
+
+    bool GetBacklog(CONNID connID, TPackBacklog& backlog)
+    {
+        TConnection* connection = Acquire(connID);
+        if(connection == NULL)
+        {
+            return false;
+        }
+        backlog.PendingPacks = connection->PendingPacks;
+        backlog.PendingBytes = connection->PendingBytes;
+        backlog.MaxPendingBytes = connection->MaxPendingBytes;
+        backlog.OldestPendingNs = connection->OldestPendingNs.load(std::memory_order_relaxed);
+        backlog.Packs = connection->Packs;
+        backlog.Bytes = connection->Bytes;
+        backlog.Flushes = connection->Flushes;
+        backlog.Failures = connection->Failures;
+        Unlock(*connection);
+        int pending = 0;
+        backlog.SocketPending = m_Socket->GetPendingDataLength(connID, pending) ? pending : -1;
+        return true;
+    }
+
+    static force_inline inline uint64_t GetMonotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+    }
+protected:
+    static const CONNID EMPTY_CONNID = 0;
+    static const CONNID REMOVED_CONNID = (CONNID)-1;
+
+    struct TSharedFrame
+    {
+        std::atomic<int> RefCount;
+        uint32_t Length;
+        char Data[0];
+    };
+
+    // 待发缓冲区段，Shared为NULL时指向连接缓冲区
+    struct TSegment
+    {
+        TSharedFrame* Shared;
+        uint32_t Offset;
+        uint32_t Length;
+    };
+
+    struct alignas(64) TConnection
+    {
+        std::atomic<uint32_t> Locked;
+        std::atomic<CONNID> ConnID;
+        std::atomic<uint64_t> OldestPendingNs;
+        char* Buffer;
+        uint32_t BufferSize;
+        int SegmentCount;
+        uint64_t PendingPacks;
+        uint64_t PendingBytes;
+        uint64_t MaxPendingBytes;
+        uint64_t Packs;
+        uint64_t Bytes;
+        uint64_t Flushes;
+        uint64_t Failures;
+        TSegment Segments[MAX_SEGMENT_COUNT];
+    };
+
+    force_inline inline uint32_t MakeHeader(int length) const
+    {
+        return ((uint32_t)m_HeaderFlag << PACK_LENGTH_BITS) | (uint32_t)length;
+    }
+
+    force_inline inline uint32_t Hash(CONNID connID) const
+    {
+        return (uint32_t)(((uint64_t)connID * 0x9E3779B97F4A7C15ull) >> 32) & m_Mask;
+    }
+
+    TConnection* FindSlot(CONNID connID) const
+    {
+        for(uint32_t i = 0, index = Hash(connID); i <= m_Mask; i++, index = (index + 1) & m_Mask)
+        {
+            CONNID current = m_Connections[index].ConnID.load(std::memory_order_acquire);
+            if(current == connID)
+            {
+                return &m_Connections[index];
+            }
+            if(current == EMPTY_CONNID)
+            {
+                return NULL;
+            }
+        }
+        return NULL;
+    }
+
+    // 查找并锁定连接，槽位在加锁前被回收时返回NULL
+    TConnection* Acquire(CONNID connID)
+    {
+        if(connID == EMPTY_CONNID || connID == REMOVED_CONNID)
+        {
+            return NULL;
+        }
+        TConnection* connection = FindSlot(connID);
+        if(connection == NULL)
+        {
+            return NULL;
+        }
+        Lock(*connection);
+        if(connection->ConnID.load(std::memory_order_relaxed) != connID)
+        {
+            Unlock(*connection);
+            return NULL;
+        }
+        return connection;
+    }
+
+    force_inline inline void AppendLocal(TConnection& connection, const BYTE* data, int length, uint64_t nowNs)
+    {
+        uint32_t header = MakeHeader(length);
+        char* dest = connection.Buffer + connection.BufferSize;
+        memcpy(dest, &header, PACK_HEADER_SIZE);
+        memcpy(dest + PACK_HEADER_SIZE, data, length);
+        uint32_t frameSize = PACK_HEADER_SIZE + length;
+        // 与上一段在连接缓冲区内相邻时合并
+        TSegment* last = connection.SegmentCount > 0 ? &connection.Segments[connection.SegmentCount - 1] : NULL;
+        if(last != NULL && last->Shared == NULL && last->Offset + last->Length == connection.BufferSize)
+        {
+            last->Length += frameSize;
+        }
+        else
+        {
+            TSegment& segment = connection.Segments[connection.SegmentCount++];
+            segment.Shared = NULL;
+            segment.Offset = connection.BufferSize;
+            segment.Length = frameSize;
+        }
+        connection.BufferSize += frameSize;
+        OnAppend(connection, frameSize, nowNs);
+    }
+
+    static force_inline inline void OnAppend(TConnection& connection, uint32_t frameSize, uint64_t nowNs)
+    {
+        if(connection.PendingPacks == 0)
+        {
+            connection.OldestPendingNs.store(nowNs > 0 ? nowNs : 1, std::memory_order_relaxed);
+        }
+        connection.PendingPacks++;
+        connection.PendingBytes += frameSize;
+        if(connection.PendingBytes > connection.MaxPendingBytes)
+        {
+            connection.MaxPendingBytes = connection.PendingBytes;
+        }
+    }
+
+    // 积压与可选的额外包(header+body，不复制)由一次SendPackets写出
+    bool FlushLocked(TConnection& connection, const BYTE* header, const BYTE* body, int length)
+    {
+        int count = connection.SegmentCount;
+        if(count == 0 && header == NULL)
+        {
+            return true;
+        }
+        WSABUF buffers[MAX_SEGMENT_COUNT + 2];
+        for(int i = 0; i < count; i++)
+        {
+            const TSegment& segment = connection.Segments[i];
+            buffers[i].buf = (LPBYTE)(segment.Shared != NULL ? segment.Shared->Data : connection.Buffer + segment.Offset);
+            buffers[i].len = segment.Length;
+        }
+        uint64_t packs = connection.PendingPacks;
+        uint64_t bytes = connection.PendingBytes;
+        if(header != NULL)
+        {
+            buffers[count].buf = (LPBYTE)header;
+            buffers[count].len = PACK_HEADER_SIZE;
+            count++;
+            if(length > 0)
+            {
+                buffers[count].buf = (LPBYTE)body;
+                buffers[count].len = length;
+                count++;
+            }
+            packs++;
+            bytes += PACK_HEADER_SIZE + length;
+        }
+        // SendPackets返回时数据已复制进组件发送队列
+        bool ret = m_Socket->SendPackets(connection.ConnID.load(std::memory_order_relaxed), buffers, count);
+        connection.Flushes++;
+        if(ret)
+        {
+            connection.Packs += packs;
+            connection.Bytes += bytes;
+        }
+        else
+        {
+            connection.Failures++;
+        }
+        ReleasePending(connection);
+        return ret;
+    }
+
+    static void ReleasePending(TConnection& connection)
+    {
+        for(int i = 0; i < connection.SegmentCount; i++)
+        {
+            if(connection.Segments[i].Shared != NULL)
+            {
+                ReleaseFrame(connection.Segments[i].Shared);
+            }
+        }
+        connection.SegmentCount = 0;
+        connection.BufferSize = 0;
+        connection.PendingPacks = 0;
+        connection.PendingBytes = 0;
+        connection.OldestPendingNs.store(0, std::memory_order_relaxed);
+    }
+
+    static force_inline inline void ReleaseFrame(TSharedFrame* frame)
+    {
+        if(frame->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            free(frame);
+        }
+    }
+
+    static void ResetStats(TConnection& connection)
+    {
+        connection.MaxPendingBytes = 0;
+        connection.Packs = 0;
+        connection.Bytes = 0;
+        connection.Flushes = 0;
+        connection.Failures = 0;
+    }
+
+    static force_inline inline void Lock(TConnection& connection)
+    {
+        while(connection.Locked.exchange(1, std::memory_order_acquire) != 0)
+        {
+            while(connection.Locked.load(std::memory_order_relaxed) != 0)
+            {
+                __builtin_ia32_pause();
+            }
+        }
+    }
+
+    static force_inline inline void Unlock(TConnection& connection)
+    {
+        connection.Locked.store(0, std::memory_order_release);
+    }
+private:
+    PackBatchSender(const PackBatchSender&);
+    PackBatchSender& operator=(const PackBatchSender&);
+private:
+    TSocket* m_Socket;
+    TConnection* m_Connections;
+    uint32_t m_Mask;
+    uint32_t m_BatchBytes;
+    uint64_t m_MaxDelayNs;
+    DWORD m_MaxPackSize;
+    USHORT m_HeaderFlag;
+    std::mutex m_TableLock;     // 仅串行化连接增删
+};
+
+typedef PackBatchSender<ITcpServer> TcpServerPackBatchSender;
+typedef PackBatchSender<ITcpAgent> TcpAgentPackBatchSender;
+
+}
+
+#endif // PACKBATCHSENDER_HPP
@@ -0,0 +1,220 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <thread>
+#include <vector>
+#include "PackBatchSender.hpp"
+#include "HRTimer.hpp"
+
+// 模拟PUSH模型组件：每个连接对应一个socketpair，SendPackets以一次writev写出
+class MockSocket
+{
+public:
+    MockSocket(): m_Calls(0)
+    {
+        for(int i = 0; i < 8; i++)
+        {
+            assert(socketpair(AF_UNIX, SOCK_STREAM, 0, m_Fds[i]) == 0);
+            int size = 4 * 1024 * 1024;
+            setsockopt(m_Fds[i][0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+            setsockopt(m_Fds[i][1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        }
+    }
+
+    ~MockSocket()
+    {
+        for(int i = 0; i < 8; i++)
+        {
+            close(m_Fds[i][0]);
+            close(m_Fds[i][1]);
+        }
+    }
+
+    BOOL SendPackets(CONNID connID, const WSABUF buffers[], int count)
+    {
+        struct iovec iov[128];
+        size_t total = 0;
+        for(int i = 0; i < count; i++)
+        {
+            iov[i].iov_base = buffers[i].buf;
+            iov[i].iov_len = buffers[i].len;
+            total += buffers[i].len;
+        }
+        m_Calls++;
+        return writev(m_Fds[connID][0], iov, count) == (ssize_t)total;
+    }
+
+    BOOL GetPendingDataLength(CONNID connID, int& pending)
+    {
+        return ioctl(m_Fds[connID][0], SIOCOUTQ, &pending) == 0;
+    }
+
+    int ReceiverFd(CONNID connID) const
+    {
+        return m_Fds[connID][1];
+    }
+
+    uint64_t m_Calls;
+private:
+    int m_Fds[8][2];
+};
+
+// 按PACK协议读取一个包，返回包长
+static int ReadPack(int fd, char* body, uint32_t headerFlag)
+{
+    uint32_t header = 0;
+    assert(recv(fd, &header, sizeof(header), MSG_WAITALL) == sizeof(header));
+    assert((header >> 22) == headerFlag);
+    int length = header & 0x3FFFFF;
+    if(length > 0)
+    {
+        assert(recv(fd, body, length, MSG_WAITALL) == length);
+    }
+    return length;
+}
+
+static bool HasData(int fd)
+{
+    char c;
+    return recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1;
+}
+
+int main(int argc, char* argv[])
+{
+    MockSocket socket;
+    NetUtil::PackBatchSender<MockSocket> sender;
+    assert(sender.Init(&socket, 16, 1024, 1000000));
+    for(CONNID connID = 1; connID <= 4; connID++)
+    {
+        assert(sender.AddConnection(connID));
+    }
+    assert(!sender.AddConnection(0));
+    std::vector<char> body(512 * 1024);
+
+    // 小包在预算内累积，Flush一次写出
+    uint64_t now = 1000;
+    assert(sender.Send(1, (const BYTE*)"order-1", 7, now));
+    assert(sender.Send(1, (const BYTE*)"", 0, now + 10));
+    assert(sender.Send(1, (const BYTE*)"order-3", 7, now + 20));
+    NetUtil::TPackBacklog backlog;
+    assert(sender.GetBacklog(1, backlog));
+    assert(backlog.PendingPacks == 3 && backlog.PendingBytes == 3 * 4 + 14 && backlog.OldestPendingNs == now);
+    assert(backlog.SocketPending == 0);
+    assert(!HasData(socket.ReceiverFd(1)));
+    assert(sender.Flush(1));
+    assert(socket.m_Calls == 1);
+    assert(ReadPack(socket.ReceiverFd(1), &body[0], 0) == 7 && memcmp(&body[0], "order-1", 7) == 0);
+    assert(ReadPack(socket.ReceiverFd(1), &body[0], 0) == 0);
+    assert(ReadPack(socket.ReceiverFd(1), &body[0], 0) == 7 && memcmp(&body[0], "order-3", 7) == 0);
+    assert(sender.GetBacklog(1, backlog));
+    assert(backlog.PendingPacks == 0 && backlog.Packs == 3 && backlog.Flushes == 1 && backlog.MaxPendingBytes == 26);
+
+    // 超过字节预算时先写出积压
+    char payload[300];
+    memset(payload, 'x', sizeof(payload));
+    for(int i = 0; i < 4; i++)
+    {
+        payload[0] = (char)i;
+        assert(sender.Send(2, (const BYTE*)payload, sizeof(payload), now));
+    }
+    assert(socket.m_Calls == 2);
+    for(int i = 0; i < 3; i++)
+    {
+        assert(ReadPack(socket.ReceiverFd(2), &body[0], 0) == (int)sizeof(payload) && body[0] == (char)i);
+    }
+    assert(!HasData(socket.ReceiverFd(2)));
+
+    // 超时刷出
+    assert(sender.FlushExpired(now + 999999) == 0);
+    assert(sender.FlushExpired(now + 1000000) == 1);
+    assert(ReadPack(socket.ReceiverFd(2), &body[0], 0) == (int)sizeof(payload) && body[0] == 3);
+
+    // 大包不复制，与积压一次写出
+    assert(sender.Send(3, (const BYTE*)"head", 4, now));
+    body[0] = 'L';
+    uint64_t calls = socket.m_Calls;
+    assert(sender.Send(3, (const BYTE*)&body[0], 4096, now));
+    assert(socket.m_Calls == calls + 1);
+    std::vector<char> received(4096);
+    assert(ReadPack(socket.ReceiverFd(3), &received[0], 0) == 4);
+    assert(ReadPack(socket.ReceiverFd(3), &received[0], 0) == 4096 && received[0] == 'L');
+    assert(!sender.Send(3, (const BYTE*)&body[0], 0x40001, now));
+
+    // 广播组帧一次，与各连接积压合并
+    assert(sender.Send(4, (const BYTE*)"private", 7, now));
+    CONNID all[] = {1, 2, 3, 4, 5};
+    assert(sender.Broadcast(all, 5, (const BYTE*)"status", 6, now) == 4);
+    assert(sender.FlushAll() == 4);
+    assert(ReadPack(socket.ReceiverFd(4), &body[0], 0) == 7 && memcmp(&body[0], "private", 7) == 0);
+    for(CONNID connID = 1; connID <= 4; connID++)
+    {
+        assert(ReadPack(socket.ReceiverFd(connID), &body[0], 0) == 6 && memcmp(&body[0], "status", 6) == 0);
+        assert(!HasData(socket.ReceiverFd(connID)));
+    }
+
+    // 包头标识，关闭连接丢弃积压
+    sender.SetPackHeaderFlag(0x169);
+    assert(sender.Send(1, (const BYTE*)"flag", 4, now));
+    assert(sender.Flush(1));
+    assert(ReadPack(socket.ReceiverFd(1), &body[0], 0x169) == 4);
+    sender.SetPackHeaderFlag(0);
+    assert(sender.Send(2, (const BYTE*)"dropped", 7, now));
+    sender.RemoveConnection(2);
+    assert(!sender.Send(2, (const BYTE*)"closed", 6, now));
+    assert(!sender.GetBacklog(2, backlog));
+    assert(sender.AddConnection(2));
+    assert(sender.GetBacklog(2, backlog) && backlog.PendingPacks == 0 && backlog.Packs == 0);
+    assert(!HasData(socket.ReceiverFd(2)));
+
+    // 延迟测试：64字节包，逐包writev对比批量发送
+    const int N = 200000;
+    const int PACK_SIZE = 64;
+    std::thread reader([&]()
+    {
+        std::vector<char> data(PACK_SIZE);
+        for(int i = 0; i < 2 * N; i++)
+        {
+            int length = ReadPack(socket.ReceiverFd(5 + (i >= N)), &data[0], 0);
+            assert(length == PACK_SIZE && *(int*)&data[0] == i % N);
+        }
+    });
+    TimeUtil::HRTimer timer;
+    NetUtil::PackBatchSender<MockSocket> direct;
+    assert(direct.Init(&socket, 16, 16 * 1024, 0));
+    assert(direct.AddConnection(5));
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        *(int*)payload = i;
+        direct.Send(5, (const BYTE*)payload, PACK_SIZE, 0);
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "PackBatchSender Unbatched Send Latency: %.1f ns\n", (double)(end - start) / N);
+    NetUtil::PackBatchSender<MockSocket> batched;
+    assert(batched.Init(&socket, 16, 16 * 1024, 20000));
+    assert(batched.AddConnection(6));
+    calls = socket.m_Calls;
+    start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        *(int*)payload = i;
+        batched.Send(6, (const BYTE*)payload, PACK_SIZE, start);
+        if((i & 63) == 0)
+        {
+            batched.FlushExpired(timer.GetTimeNs());
+        }
+    }
+    batched.FlushAll();
+    end = timer.GetTimeNs();
+    reader.join();
+    fprintf(stderr, "PackBatchSender Batched Send Latency: %.1f ns, %.1f Packs/SendPackets\n", (double)(end - start) / N,
+            (double)N / (socket.m_Calls - calls));
+    return 0;
+}
+
+// g++ -std=c++11 -O2 PackBatchSenderTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../HP-Socket/5.8.2/include
@@ -0,0 +1,1323 @@
+#ifndef SHMTCPTRANSPORT_HPP
+#define SHMTCPTRANSPORT_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "TcpSocketDelegate.hpp"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace NetUtil
+{
+
+struct alignas(64) TShmRingHeader
+{
+    std::atomic<uint64_t> WritePos;
+    char Reserved0[56];
+    std::atomic<uint64_t> ReadPos;
+    char Reserved1[56];
+};
+
+// 共享内存单生产者单消费者环，每条记录为8字节头(数据长度)加数据，按8字节对齐，
+// 环尾放不下时写入回绕标记从头开始。一个ShmRing对象只用于写或只用于读
+class ShmRing
+{
+public:
+    enum
+    {
+        RECORD_HEADER_SIZE = 8
+    };
+    static const uint32_t WRAP_FLAG = 0xFFFFFFFF;
+
+    ShmRing(): m_Header(NULL), m_Data(NULL), m_Capacity(0), m_CachedPos(0), m_PeekSize(0)
+    {
+    }
+
+    // capacity须为2的幂
+    void Attach(TShmRingHeader* header, char* data, uint64_t capacity)
+    {
+        m_Header = header;
+        m_Data = data;
+        m_Capacity = capacity;
+        m_CachedPos = 0;
+        m_PeekSize = 0;
+    }
+
+    uint32_t GetMaxRecordSize() const
+    {
+        return (uint32_t)(m_Capacity / 2 - RECORD_HEADER_SIZE);
+    }
+
+    // 空间不足返回false
+    bool Write(const WSABUF buffers[], int count, uint32_t length)
+    {
+        uint64_t total = Align(RECORD_HEADER_SIZE + length);
+        uint64_t pos = m_Header->WritePos.load(std::memory_order_relaxed);
+        uint64_t offset = pos & (m_Capacity - 1);
+        uint64_t padding = offset + total > m_Capacity ? m_Capacity - offset : 0;
+        // m_CachedPos为读位置缓存
+        if(pos + padding + total - m_CachedPos > m_Capacity)
+        {
+            m_CachedPos = m_Header->ReadPos.load(std::memory_order_acquire);
+            if(pos + padding + total - m_CachedPos > m_Capacity)
+            {
+                return false;
+            }
+        }
+        if(padding > 0)
+        {
+            *(uint32_t*)(m_Data + offset) = WRAP_FLAG;
+            pos += padding;
+            offset = 0;
+        }
+        char* dest = m_Data + offset;
+        *(uint32_t*)dest = length;
+        dest += RECORD_HEADER_SIZE;
+        for(int i = 0; i < count; i++)
+        {
+            memcpy(dest, buffers[i].buf, buffers[i].len);
+            dest += buffers[i].len;
+        }
+        m_Header->WritePos.store(pos + total, std::memory_order_release);
+        return true;
+    }
+
+    // 返回下一条记录，处理完后调用Pop，无数据返回NULL
+    const BYTE* Peek(uint32_t& length)
+    {
+        uint64_t pos = m_Header->ReadPos.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            // m_CachedPos为写位置缓存
+            if(pos == m_CachedPos)
+            {
+                m_CachedPos = m_Header->WritePos.load(std::memory_order_acquire);
+                if(pos == m_CachedPos)
+                {
+                    return NULL;
+                }
+            }
+            uint64_t offset = pos & (m_Capacity - 1);
+            uint32_t size = *(const uint32_t*)(m_Data + offset);
+            if(size == WRAP_FLAG)
+            {
+                pos += m_Capacity - offset;
+                m_Header->ReadPos.store(pos, std::memory_order_release);
+                continue;
+            }
+            length = size;
+            m_PeekSize = Align(RECORD_HEADER_SIZE + size);
+            return (const BYTE*)(m_Data + offset + RECORD_HEADER_SIZE);
+        }
+    }
+
+    void Pop()
+    {
+        uint64_t pos = m_Header->ReadPos.load(std::memory_order_relaxed);
+        m_Header->ReadPos.store(pos + m_PeekSize, std::memory_order_release);
+    }
+
+    // 已写入未被读取的字节数
+    uint64_t GetUsed() const
+    {
+        return m_Header->WritePos.load(std::memory_order_acquire) - m_Header->ReadPos.load(std::memory_order_acquire);
+    }
+protected:
+    static force_inline inline uint64_t Align(uint64_t size)
+    {
+        return (size + 7) & ~7ull;
+    }
+private:
+    TShmRingHeader* m_Header;
+    char* m_Data;
+    uint64_t m_Capacity;
+    uint64_t m_CachedPos;
+    uint64_t m_PeekSize;
+};
+
+// 一个连接的共享内存环对：客户端创建并在握手消息中告知名字，服务端打开后删除名字，
+// 进程退出后由内核回收
+class ShmChannel
+{
+public:
+    static const uint64_t MAGIC = 0x4C4E4E4148434D53ull;   // "SMCHANNL"
+
+    ShmChannel(): m_Memory(NULL), m_Size(0), m_Creator(false), m_Linked(false)
+    {
+        m_Name[0] = 0;
+    }
+
+    ~ShmChannel()
+    {
+        Close();
+    }
+
+    // 客户端：ringSize向上取2的幂
+    bool Create(const char* name, uint64_t ringSize)
+    {
+        uint64_t capacity = 4096;
+        while(capacity < ringSize)
+        {
+            capacity <<= 1;
+        }
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0)
+        {
+            return false;
+        }
+        size_t size = HEADER_SIZE + 2 * capacity;
+        if(ftruncate(fd, size) != 0)
+        {
+            close(fd);
+            shm_unlink(name);
+            return false;
+        }
+        strncpy(m_Name, name, sizeof(m_Name) - 1);
+        m_Name[sizeof(m_Name) - 1] = 0;
+        m_Creator = true;
+        m_Linked = true;
+        if(!Map(fd, size))
+        {
+            Close();
+            return false;
+        }
+        TChannelHeader* header = (TChannelHeader*)m_Memory;
+        header->RingSize = capacity;
+        header->Magic = MAGIC;
+        Bind();
+        return true;
+    }
+
+    // 共享内存名字固定为"/HPShm.<pid>.<序号>"，由客户端按此格式生成
+    static void FormatName(char* buffer, size_t size, int pid, uint32_t sequence)
+    {
+        snprintf(buffer, size, "/HPShm.%d.%u", pid, sequence);
+    }
+
+    // 名字来自对端握手消息，服务端打开并删除前校验格式，不接受本传输以外的共享内存对象
+    static bool IsChannelName(const char* name)
+    {
+        static const char prefix[] = "/HPShm.";
+        if(strncmp(name, prefix, sizeof(prefix) - 1) != 0)
+        {
+            return false;
+        }
+        const char* p = name + sizeof(prefix) - 1;
+        for(int field = 0; field < 2; field++)
+        {
+            const char* begin = p;
+            while(*p >= '0' && *p <= '9')
+            {
+                p++;
+            }
+            if(p == begin || p - begin > 10 || *p != (field == 0 ? '.' : '\0'))
+            {
+                return false;
+            }
+            p++;
+        }
+        return true;
+    }
+
+    // 服务端
+    bool Open(const char* name)
+    {
+        if(!IsChannelName(name))
+        {
+            return false;
+        }
+        int fd = shm_open(name, O_RDWR, 0600);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t)st.st_size <= HEADER_SIZE)
+        {
+            close(fd);
+            return false;
+        }
+        if(!Map(fd, st.st_size))
+        {
+            return false;
+        }
+        // 环按2的幂取模定位，RingSize来自对端须校验
+        TChannelHeader* header = (TChannelHeader*)m_Memory;
+        uint64_t ringSize = header->RingSize;
+        if(header->Magic != MAGIC || ringSize == 0 || (ringSize & (ringSize - 1)) != 0 ||
+           HEADER_SIZE + 2 * ringSize != m_Size)
+        {
+            Close();
+            return false;
+        }
+        shm_unlink(name);
+        Bind();
+        return true;
+    }
+
+    // 双方都已映射后删除名字
+    void Unlink()
+    {
+        if(m_Linked)
+        {
+            shm_unlink(m_Name);
+            m_Linked = false;
+        }
+    }
+
+    void Close()
+    {
+        Unlink();
+        if(m_Memory != NULL)
+        {
+            munmap(m_Memory, m_Size);
+            m_Memory = NULL;
+        }
+    }
+
+    ShmRing& GetTxRing()
+    {
+        return m_TxRing;
+    }
+
+    ShmRing& GetRxRing()
+    {
+        return m_RxRing;
+    }
+
+    const char* GetName() const
+    {
+        return m_Name;
+    }
+protected:
+    struct TChannelHeader
+    {
+        uint64_t Magic;
+        uint64_t RingSize;
+    };
+
+    // 通道头64字节，其后为客户端到服务端、服务端到客户端两个环头，再后为两个环的数据
+    static const size_t HEADER_SIZE = 64 + 2 * sizeof(TShmRingHeader);
+
+    bool Map(int fd, size_t size)
+    {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        close(fd);
+        if(memory == MAP_FAILED)
+        {
+            return false;
+        }
+        m_Memory = (char*)memory;
+        m_Size = size;
+        return true;
+    }
+
+    void Bind()
+    {
+        uint64_t capacity = ((TChannelHeader*)m_Memory)->RingSize;
+        TShmRingHeader* upstream = (TShmRingHeader*)(m_Memory + 64);
+        TShmRingHeader* downstream = upstream + 1;
+        char* upstreamData = m_Memory + HEADER_SIZE;
+        char* downstreamData = upstreamData + capacity;
+        if(m_Creator)
+        {
+            m_TxRing.Attach(upstream, upstreamData, capacity);
+            m_RxRing.Attach(downstream, downstreamData, capacity);
+        }
+        else
+        {
+            m_TxRing.Attach(downstream, downstreamData, capacity);
+            m_RxRing.Attach(upstream, upstreamData, capacity);
+        }
+    }
+private:
+    ShmChannel(const ShmChannel&);
+    ShmChannel& operator=(const ShmChannel&);
+private:
+    char* m_Memory;
+    size_t m_Size;
+    bool m_Creator;
+    bool m_Linked;
+    char m_Name[64];
+    ShmRing m_TxRing;
+    ShmRing m_RxRing;
+};
+
+struct TShmConnection
+{
+    CONNID ConnID;
+    ShmChannel Channel;
+    std::atomic<uint32_t> TxLocked;     // 多个线程可向同一连接发送
+    std::atomic<uint32_t> RxLocked;     // 轮询线程与OnClose排空互斥
+    std::atomic<bool> Closed;
+    std::atomic<bool> Paused;
+
+    explicit TShmConnection(CONNID connID): ConnID(connID), TxLocked(0), RxLocked(0), Closed(false), Paused(false)
+    {
+    }
+};
+
+typedef std::shared_ptr<TShmConnection> ShmConnectionPtr;
+
+// 握手消息，经TCP连接收发
+struct TShmHello
+{
+    uint64_t Magic;
+    uint64_t RingSize;
+    char BootID[40];
+    char Name[64];
+};
+
+struct TShmAck
+{
+    uint64_t Magic;
+    uint64_t Accepted;
+};
+
+// 共享内存传输公共部分：握手消息、环写入、接收轮询线程
+class ShmTransport
+{
+public:
+    static const uint64_t HELLO_MAGIC = 0x4F4C4C45484D4853ull;    // "SHMHELLO"
+    static const uint64_t ACK_MAGIC = 0x4B434148454D4853ull;      // "SHMEHACK"
+
+    ShmTransport(): m_Enabled(true), m_RingSize(4 * 1024 * 1024), m_SpinCount(100000), m_SleepUs(0), m_PollCpu(-1),
+        m_Running(false), m_Version(0)
+    {
+    }
+
+    virtual ~ShmTransport()
+    {
+        StopPoller();
+    }
+
+    // 须在连接建立前设置
+    void SetShmEnabled(bool enabled)
+    {
+        m_Enabled = enabled;
+    }
+
+    // 单方向环大小，由客户端决定
+    void SetShmRingSize(uint64_t ringSize)
+    {
+        m_RingSize = ringSize;
+    }
+
+    // 轮询线程空闲时先自旋spinCount轮，之后每轮sched_yield让出CPU，默认不休眠；cpu为绑核编号。
+    // sleepUs大于0时改为每轮usleep，用于不要求时延的场景节省CPU，唤醒延迟可达数十微秒
+    void SetPollPolicy(uint32_t spinCount, uint32_t sleepUs, int cpu = -1)
+    {
+        m_SpinCount = spinCount;
+        m_SleepUs = sleepUs;
+        m_PollCpu = cpu;
+    }
+
+    // 本机内核启动标识，相同即为同一主机
+    static const char* GetBootID()
+    {
+        static char bootID[40] = {0};
+        if(bootID[0] == 0)
+        {
+            FILE* file = fopen("/proc/sys/kernel/random/boot_id", "r");
+            if(file != NULL)
+            {
+                if(fgets(bootID, sizeof(bootID), file) == NULL)
+                {
+                    bootID[0] = 0;
+                }
+                bootID[strcspn(bootID, "\n")] = 0;
+                fclose(file);
+            }
+        }
+        return bootID;
+    }
+
+    static bool IsHello(const BYTE* data, int length)
+    {
+        return length == (int)sizeof(TShmHello) && ((const TShmHello*)data)->Magic == HELLO_MAGIC;
+    }
+
+    static bool IsAck(const BYTE* data, int length)
+    {
+        return length == (int)sizeof(TShmAck) && ((const TShmAck*)data)->Magic == ACK_MAGIC;
+    }
+protected:
+    // 在轮询线程回调，返回HR_ERROR时断开连接
+    virtual EnHandleResult OnShmReceive(TShmConnection& connection, const BYTE* data, int length) = 0;
+    virtual void OnShmError(TShmConnection& connection) = 0;
+
+    static BOOL WriteRecord(TShmConnection& connection, const WSABUF buffers[], int count)
+    {
+        uint64_t length = 0;
+        for(int i = 0; i < count; i++)
+        {
+            length += buffers[i].len;
+        }
+        ShmRing& ring = connection.Channel.GetTxRing();
+        if(length > ring.GetMaxRecordSize())
+        {
+            errno = EMSGSIZE;
+            return FALSE;
+        }
+        Lock(connection.TxLocked);
+        BOOL ret = FALSE;
+        if(connection.Closed.load(std::memory_order_relaxed))
+        {
+            errno = ENOTCONN;
+        }
+        else if(!ring.Write(buffers, count, (uint32_t)length))
+        {
+            errno = ENOBUFS;
+        }
+        else
+        {
+            ret = TRUE;
+        }
+        Unlock(connection.TxLocked);
+        return ret;
+    }
+
+    void AddPolling(const ShmConnectionPtr& connection)
+    {
+        std::lock_guard<std::mutex> lock(m_PollLock);
+        m_Polling.push_back(connection);
+        m_Version.fetch_add(1, std::memory_order_release);
+        if(!m_Running.load(std::memory_order_relaxed))
+        {
+            m_Running.store(true, std::memory_order_relaxed);
+            m_Poller = std::thread(&ShmTransport::PollLoop, this);
+        }
+    }
+
+    // 关闭连接：停止轮询，把对端已写入的数据全部回调后移除
+    void RemovePolling(const ShmConnectionPtr& connection)
+    {
+        connection->Closed.store(true, std::memory_order_relaxed);
+        Lock(connection->TxLocked);
+        Unlock(connection->TxLocked);
+        Lock(connection->RxLocked);
+        bool error = false;
+        Drain(*connection, UINT32_MAX, error);
+        Unlock(connection->RxLocked);
+        std::lock_guard<std::mutex> lock(m_PollLock);
+        for(size_t i = 0; i < m_Polling.size(); i++)
+        {
+            if(m_Polling[i] == connection)
+            {
+                m_Polling.erase(m_Polling.begin() + i);
+                m_Version.fetch_add(1, std::memory_order_release);
+                break;
+            }
+        }
+    }
+
+    void StopPoller()
+    {
+        if(m_Running.exchange(false))
+        {
+            m_Poller.join();
+        }
+    }
+
+    static force_inline inline void Lock(std::atomic<uint32_t>& locked)
+    {
+        while(locked.exchange(1, std::memory_order_acquire) != 0)
+        {
+            while(locked.load(std::memory_order_relaxed) != 0)
+            {
+                __builtin_ia32_pause();
+            }
+        }
+    }
+
+    static force_inline inline bool TryLock(std::atomic<uint32_t>& locked)
+    {
+        return locked.load(std::memory_order_relaxed) == 0 && locked.exchange(1, std::memory_order_acquire) == 0;
+    }
+
+    static force_inline inline void Unlock(std::atomic<uint32_t>& locked)
+    {
+        locked.store(0, std::memory_order_release);
+    }
+private:
+    void PollLoop()
+    {
+        if(m_PollCpu >= 0)
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(m_PollCpu, &cpuset);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        }
+        std::vector<ShmConnectionPtr> polling;
+        uint64_t version = UINT64_MAX;
+        uint32_t idle = 0;
+        while(m_Running.load(std::memory_order_relaxed))
+        {
+            if(version != m_Version.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(m_PollLock);
+                polling = m_Polling;
+                version = m_Version.load(std::memory_order_relaxed);
+            }
+            uint32_t received = 0;
+            for(size_t i = 0; i < polling.size(); i++)
+            {
+                TShmConnection& connection = *polling[i];
+                if(connection.Closed.load(std::memory_order_relaxed) || connection.Paused.load(std::memory_order_relaxed)
+                   || !TryLock(connection.RxLocked))
+                {
+                    continue;
+                }
+                bool error = false;
+                if(!connection.Closed.load(std::memory_order_relaxed))
+                {
+                    received += Drain(connection, MAX_POLL_BATCH, error);
+                }
+                Unlock(connection.RxLocked);
+                // 断开连接会回调OnClose并排空，须在释放接收锁后调用
+                if(error)
+                {
+                    OnShmError(connection);
+                }
+            }
+            if(received > 0)
+            {
+                idle = 0;
+            }
+            else if(idle < m_SpinCount)
+            {
+                idle++;
+                __builtin_ia32_pause();
+            }
+            else if(m_SleepUs > 0)
+            {
+                usleep(m_SleepUs);
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+    }
+
+    uint32_t Drain(TShmConnection& connection, uint32_t maxCount, bool& error)
+    {
+        ShmRing& ring = connection.Channel.GetRxRing();
+        uint32_t count = 0;
+        uint32_t length = 0;
+        const BYTE* data = NULL;
+        while(count < maxCount && (data = ring.Peek(length)) != NULL)
+        {
+            EnHandleResult result = OnShmReceive(connection, data, length);
+            ring.Pop();
+            count++;
+            if(result == HR_ERROR)
+            {
+                error = true;
+                break;
+            }
+        }
+        return count;
+    }
+protected:
+    enum
+    {
+        MAX_POLL_BATCH = 64
+    };
+    bool m_Enabled;
+    uint64_t m_RingSize;
+private:
+    uint32_t m_SpinCount;
+    uint32_t m_SleepUs;
+    int m_PollCpu;
+    std::atomic<bool> m_Running;
+    std::atomic<uint64_t> m_Version;
+    std::mutex m_PollLock;
+    std::vector<ShmConnectionPtr> m_Polling;
+    std::thread m_Poller;
+};
+
+// 读取SendSmallFile的文件内容
+static inline bool ReadSmallFile(LPCTSTR fileName, std::vector<BYTE>& content)
+{
+    FILE* file = fopen(fileName, "rb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    content.clear();
+    BYTE buffer[64 * 1024];
+    size_t size = 0;
+    while((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.insert(content.end(), buffer, buffer + size);
+    }
+    fclose(file);
+    return true;
+}
+
+// 同主机共享内存TCP服务端
+// 与ITcpServer接口一致，连接仍经内部HP-Socket组件建立；客户端为ShmTcpClient且与服务端在同一主机
+// (内核boot_id相同且能打开客户端创建的共享内存)时，连接的数据收发改走共享内存环对，
+// TCP连接保留用于握手和关闭通知。应用的CTcpServerListener不变：
+// OnReceive由轮询线程回调，OnSend在Send返回前回调，OnClose在排空共享内存中的数据后回调。
+// 只支持PUSH模型。普通HP-Socket客户端的连接不受影响。
+// 用法：
+//     ShmTcpServer server(&listener);
+//     CTcpServerPtr socket(server.GetInnerListener());
+//     server.Attach(socket.Get());
+//     server.Start("0.0.0.0", 5555);
+class ShmTcpServer: public TcpServerDelegate, public ShmTransport
+{
+public:
+    explicit ShmTcpServer(ITcpServerListener* listener): m_Listener(listener), m_InnerListener(this)
+    {
+    }
+
+    ~ShmTcpServer()
+    {
+        StopPoller();
+    }
+
+    ITcpServerListener* GetInnerListener()
+    {
+        return &m_InnerListener;
+    }
+
+    void Attach(ITcpServer* socket)
+    {
+        SetInnerSocket(socket);
+    }
+
+    bool IsShmConnection(CONNID connID)
+    {
+        return Find(connID).get() != NULL;
+    }
+
+    virtual BOOL Send(CONNID dwConnID, const BYTE* pBuffer, int iLength, int iOffset = 0) override
+    {
+        WSABUF buffer;
+        buffer.buf = (LPBYTE)pBuffer + iOffset;
+        buffer.len = iLength;
+        return SendPackets(dwConnID, &buffer, 1);
+    }
+
+    virtual BOOL SendPackets(CONNID dwConnID, const WSABUF pBuffers[], int iCount) override
+    {
+        ShmConnectionPtr connection = Find(dwConnID);
+        if(connection.get() == NULL)
+        {
+            return m_Socket->SendPackets(dwConnID, pBuffers, iCount);
+        }
+        if(!WriteRecord(*connection, pBuffers, iCount))
+        {
+            return FALSE;
+        }
+        for(int i = 0; i < iCount; i++)
+        {
+            m_Listener->OnSend(this, dwConnID, pBuffers[i].buf, pBuffers[i].len);
+        }
+        return TRUE;
+    }
+
+    virtual BOOL SendSmallFile(CONNID dwConnID, LPCTSTR lpszFileName, const LPWSABUF pHead = nullptr, const LPWSABUF pTail = nullptr) override
+    {
+        if(!IsShmConnection(dwConnID))
+        {
+            return m_Socket->SendSmallFile(dwConnID, lpszFileName, pHead, pTail);
+        }
+        std::vector<BYTE> content;
+        if(!ReadSmallFile(lpszFileName, content))
+        {
+            return FALSE;
+        }
+        WSABUF buffers[3];
+        int count = 0;
+        if(pHead != NULL)
+        {
+            buffers[count++] = *pHead;
+        }
+        buffers[count].buf = content.data();
+        buffers[count++].len = content.size();
+        if(pTail != NULL)
+        {
+            buffers[count++] = *pTail;
+        }
+        return SendPackets(dwConnID, buffers, count);
+    }
+
+    virtual BOOL PauseReceive(CONNID dwConnID, BOOL bPause = TRUE) override
+    {
+        ShmConnectionPtr connection = Find(dwConnID);
+        if(connection.get() == NULL)
+        {
+            return m_Socket->PauseReceive(dwConnID, bPause);
+        }
+        connection->Paused.store(bPause != FALSE, std::memory_order_relaxed);
+        return TRUE;
+    }
+
+    virtual BOOL IsPauseReceive(CONNID dwConnID, BOOL& bPaused) override
+    {
+        ShmConnectionPtr connection = Find(dwConnID);
+        if(connection.get() == NULL)
+        {
+            return m_Socket->IsPauseReceive(dwConnID, bPaused);
+        }
+        bPaused = connection->Paused.load(std::memory_order_relaxed) ? TRUE : FALSE;
+        return TRUE;
+    }
+
+    // 共享内存连接为对端尚未读取的字节数
+    virtual BOOL GetPendingDataLength(CONNID dwConnID, int& iPending) override
+    {
+        ShmConnectionPtr connection = Find(dwConnID);
+        if(connection.get() == NULL)
+        {
+            return m_Socket->GetPendingDataLength(dwConnID, iPending);
+        }
+        iPending = (int)connection->Channel.GetTxRing().GetUsed();
+        return TRUE;
+    }
+protected:
+    enum EConnectionMode
+    {
+        ECONNECTION_NEW = 0,    // 尚未收到数据
+        ECONNECTION_TCP = 1,
+        ECONNECTION_SHM = 2
+    };
+
+    struct TConnectionState
+    {
+        int Mode;
+        ShmConnectionPtr Connection;
+    };
+
+    class InnerListener: public ITcpServerListener
+    {
+    public:
+        explicit InnerListener(ShmTcpServer* owner): m_Owner(owner)
+        {
+        }
+
+        virtual EnHandleResult OnPrepareListen(ITcpServer* pSender, SOCKET soListen) override
+        {
+            return m_Owner->m_Listener->OnPrepareListen(m_Owner, soListen);
+        }
+
+        virtual EnHandleResult OnAccept(ITcpServer* pSender, CONNID dwConnID, UINT_PTR soClient) override
+        {
+            m_Owner->SetMode(dwConnID, ECONNECTION_NEW, ShmConnectionPtr());
+            EnHandleResult result = m_Owner->m_Listener->OnAccept(m_Owner, dwConnID, soClient);
+            if(result == HR_ERROR)
+            {
+                m_Owner->Erase(dwConnID);
+            }
+            return result;
+        }
+
+        virtual EnHandleResult OnHandShake(ITcpServer* pSender, CONNID dwConnID) override
+        {
+            return m_Owner->m_Listener->OnHandShake(m_Owner, dwConnID);
+        }
+
+        virtual EnHandleResult OnSend(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+        {
+            if(IsAck(pData, iLength))
+            {
+                return HR_IGNORE;
+            }
+            return m_Owner->m_Listener->OnSend(m_Owner, dwConnID, pData, iLength);
+        }
+
+        virtual EnHandleResult OnReceive(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+        {
+            if(m_Owner->GetMode(dwConnID) == ECONNECTION_NEW)
+            {
+                if(IsHello(pData, iLength))
+                {
+                    return m_Owner->OnHello(dwConnID, *(const TShmHello*)pData);
+                }
+                m_Owner->SetMode(dwConnID, ECONNECTION_TCP, ShmConnectionPtr());
+            }
+            return m_Owner->m_Listener->OnReceive(m_Owner, dwConnID, pData, iLength);
+        }
+
+        virtual EnHandleResult OnReceive(ITcpServer* pSender, CONNID dwConnID, int iLength) override
+        {
+            return m_Owner->m_Listener->OnReceive(m_Owner, dwConnID, iLength);
+        }
+
+        virtual EnHandleResult OnClose(ITcpServer* pSender, CONNID dwConnID, EnSocketOperation enOperation, int iErrorCode) override
+        {
+            ShmConnectionPtr connection = m_Owner->Find(dwConnID);
+            if(connection.get() != NULL)
+            {
+                m_Owner->RemovePolling(connection);
+            }
+            m_Owner->Erase(dwConnID);
+            return m_Owner->m_Listener->OnClose(m_Owner, dwConnID, enOperation, iErrorCode);
+        }
+
+        virtual EnHandleResult OnShutdown(ITcpServer* pSender) override
+        {
+            return m_Owner->m_Listener->OnShutdown(m_Owner);
+        }
+    private:
+        ShmTcpServer* m_Owner;
+    };
+
+    EnHandleResult OnHello(CONNID connID, const TShmHello& hello)
+    {
+        TShmAck ack;
+        ack.Magic = ACK_MAGIC;
+        ack.Accepted = 0;
+        ShmConnectionPtr connection;
+        if(m_Enabled && strncmp(hello.BootID, GetBootID(), sizeof(hello.BootID)) == 0 && GetBootID()[0] != 0)
+        {
+            char name[sizeof(hello.Name) + 1] = {0};
+            memcpy(name, hello.Name, sizeof(hello.Name));
+            connection = std::make_shared<TShmConnection>(connID);
+            if(connection->Channel.Open(name))
+            {
+                ack.Accepted = 1;
+            }
+            else
+            {
+                connection.reset();
+            }
+        }
+        // 先开始轮询再应答，客户端收到应答后的数据即走共享内存
+        if(connection.get() != NULL)
+        {
+            SetMode(connID, ECONNECTION_SHM, connection);
+            AddPolling(connection);
+        }
+        else
+        {
+            SetMode(connID, ECONNECTION_TCP, ShmConnectionPtr());
+        }
+        if(!m_Socket->Send(connID, (const BYTE*)&ack, sizeof(ack)))
+        {
+            return HR_ERROR;
+        }
+        return HR_OK;
+    }
+
+    virtual EnHandleResult OnShmReceive(TShmConnection& connection, const BYTE* data, int length) override
+    {
+        return m_Listener->OnReceive(this, connection.ConnID, data, length);
+    }
+
+    virtual void OnShmError(TShmConnection& connection) override
+    {
+        connection.Paused.store(true, std::memory_order_relaxed);
+        m_Socket->Disconnect(connection.ConnID);
+    }
+
+    ShmConnectionPtr Find(CONNID connID)
+    {
+        Lock(m_StateLocked);
+        ShmConnectionPtr connection;
+        std::unordered_map<CONNID, TConnectionState>::iterator it = m_States.find(connID);
+        if(it != m_States.end())
+        {
+            connection = it->second.Connection;
+        }
+        Unlock(m_StateLocked);
+        return connection;
+    }
+
+    int GetMode(CONNID connID)
+    {
+        Lock(m_StateLocked);
+        std::unordered_map<CONNID, TConnectionState>::iterator it = m_States.find(connID);
+        int mode = it != m_States.end() ? it->second.Mode : ECONNECTION_TCP;
+        Unlock(m_StateLocked);
+        return mode;
+    }
+
+    void SetMode(CONNID connID, int mode, const ShmConnectionPtr& connection)
+    {
+        Lock(m_StateLocked);
+        TConnectionState& state = m_States[connID];
+        state.Mode = mode;
+        state.Connection = connection;
+        Unlock(m_StateLocked);
+    }
+
+    void Erase(CONNID connID)
+    {
+        ShmConnectionPtr connection;
+        Lock(m_StateLocked);
+        std::unordered_map<CONNID, TConnectionState>::iterator it = m_States.find(connID);
+        if(it != m_States.end())
+        {
+            connection.swap(it->second.Connection);
+            m_States.erase(it);
+        }
+        Unlock(m_StateLocked);
+    }
+private:
+    ShmTcpServer(const ShmTcpServer&);
+    ShmTcpServer& operator=(const ShmTcpServer&);
+private:
+    ITcpServerListener* m_Listener;
+    InnerListener m_InnerListener;
+    std::atomic<uint32_t> m_StateLocked{0};
+    std::unordered_map<CONNID, TConnectionState> m_States;
+};
+
+// 同主机共享内存TCP客户端，与ShmTcpServer配合使用
+// 连接建立后先经TCP发送握手消息，收到服务端接受应答前的发送数据暂存，应答后按序写入共享内存；
+// 服务端拒绝(不同主机或打开失败)时暂存数据经TCP发出，此后与普通客户端相同。
+// 对端不是ShmTcpServer时须SetShmEnabled(false)。
+// 用法：
+//     ShmTcpClient client(&listener);
+//     CTcpClientPtr socket(client.GetInnerListener());
+//     client.Attach(socket.Get());
+//     client.Start("127.0.0.1", 5555);
+class ShmTcpClient: public TcpClientDelegate, public ShmTransport
+{
+public:
+    explicit ShmTcpClient(ITcpClientListener* listener): m_Listener(listener), m_InnerListener(this), m_Mode(ECONNECTION_NONE)
+    {
+    }
+
+    ~ShmTcpClient()
+    {
+        StopPoller();
+    }
+
+    ITcpClientListener* GetInnerListener()
+    {
+        return &m_InnerListener;
+    }
+
+    void Attach(ITcpClient* socket)
+    {
+        SetInnerSocket(socket);
+    }
+
+    bool IsShmConnection()
+    {
+        return m_Mode.load(std::memory_order_acquire) == ECONNECTION_SHM;
+    }
+
+    virtual BOOL Send(const BYTE* pBuffer, int iLength, int iOffset = 0) override
+    {
+        WSABUF buffer;
+        buffer.buf = (LPBYTE)pBuffer + iOffset;
+        buffer.len = iLength;
+        return SendPackets(&buffer, 1);
+    }
+
+    virtual BOOL SendPackets(const WSABUF pBuffers[], int iCount) override
+    {
+        int mode = m_Mode.load(std::memory_order_acquire);
+        if(mode == ECONNECTION_PENDING)
+        {
+            std::lock_guard<std::mutex> lock(m_PendingLock);
+            mode = m_Mode.load(std::memory_order_acquire);
+            if(mode == ECONNECTION_PENDING)
+            {
+                uint32_t length = 0;
+                for(int i = 0; i < iCount; i++)
+                {
+                    length += pBuffers[i].len;
+                }
+                m_Pending.insert(m_Pending.end(), (const BYTE*)&length, (const BYTE*)&length + sizeof(length));
+                for(int i = 0; i < iCount; i++)
+                {
+                    m_Pending.insert(m_Pending.end(), pBuffers[i].buf, pBuffers[i].buf + pBuffers[i].len);
+                }
+                return TRUE;
+            }
+        }
+        if(mode == ECONNECTION_SHM)
+        {
+            ShmConnectionPtr connection = GetConnection();
+            if(connection.get() != NULL)
+            {
+                if(!WriteRecord(*connection, pBuffers, iCount))
+                {
+                    return FALSE;
+                }
+                for(int i = 0; i < iCount; i++)
+                {
+                    m_Listener->OnSend(this, connection->ConnID, pBuffers[i].buf, pBuffers[i].len);
+                }
+                return TRUE;
+            }
+        }
+        return m_Socket->SendPackets(pBuffers, iCount);
+    }
+
+    virtual BOOL SendSmallFile(LPCTSTR lpszFileName, const LPWSABUF pHead = nullptr, const LPWSABUF pTail = nullptr) override
+    {
+        if(m_Mode.load(std::memory_order_acquire) == ECONNECTION_TCP || m_Mode.load(std::memory_order_acquire) == ECONNECTION_NONE)
+        {
+            return m_Socket->SendSmallFile(lpszFileName, pHead, pTail);
+        }
+        std::vector<BYTE> content;
+        if(!ReadSmallFile(lpszFileName, content))
+        {
+            return FALSE;
+        }
+        WSABUF buffers[3];
+        int count = 0;
+        if(pHead != NULL)
+        {
+            buffers[count++] = *pHead;
+        }
+        buffers[count].buf = content.data();
+        buffers[count++].len = content.size();
+        if(pTail != NULL)
+        {
+            buffers[count++] = *pTail;
+        }
+        return SendPackets(buffers, count);
+    }
+
+    virtual BOOL PauseReceive(BOOL bPause = TRUE) override
+    {
+        ShmConnectionPtr connection = GetConnection();
+        if(connection.get() == NULL)
+        {
+            return m_Socket->PauseReceive(bPause);
+        }
+        connection->Paused.store(bPause != FALSE, std::memory_order_relaxed);
+        return TRUE;
+    }
+
+    virtual BOOL IsPauseReceive(BOOL& bPaused) override
+    {
+        ShmConnectionPtr connection = GetConnection();
+        if(connection.get() == NULL)
+        {
+            return m_Socket->IsPauseReceive(bPaused);
+        }
+        bPaused = connection->Paused.load(std::memory_order_relaxed) ? TRUE : FALSE;
+        return TRUE;
+    }
+
+    virtual BOOL GetPendingDataLength(int& iPending) override
+    {
+        ShmConnectionPtr connection = GetConnection();
+        if(connection.get() == NULL || !IsShmConnection())
+        {
+            return m_Socket->GetPendingDataLength(iPending);
+        }
+        iPending = (int)connection->Channel.GetTxRing().GetUsed();
+        return TRUE;
+    }
+protected:
+    enum EConnectionMode
+    {
+        ECONNECTION_NONE = 0,
+        ECONNECTION_PENDING = 1,    // 已发握手消息，等待应答
+        ECONNECTION_TCP = 2,
+        ECONNECTION_SHM = 3
+    };
+
+    class InnerListener: public ITcpClientListener
+    {
+    public:
+        explicit InnerListener(ShmTcpClient* owner): m_Owner(owner)
+        {
+        }
+
+        virtual EnHandleResult OnPrepareConnect(ITcpClient* pSender, CONNID dwConnID, SOCKET socket) override
+        {
+            return m_Owner->m_Listener->OnPrepareConnect(m_Owner, dwConnID, socket);
+        }
+
+        virtual EnHandleResult OnConnect(ITcpClient* pSender, CONNID dwConnID) override
+        {
+            m_Owner->SendHello(dwConnID);
+            return m_Owner->m_Listener->OnConnect(m_Owner, dwConnID);
+        }
+
+        virtual EnHandleResult OnHandShake(ITcpClient* pSender, CONNID dwConnID) override
+        {
+            return m_Owner->m_Listener->OnHandShake(m_Owner, dwConnID);
+        }
+
+        virtual EnHandleResult OnSend(ITcpClient* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+        {
+            if(IsHello(pData, iLength))
+            {
+                return HR_IGNORE;
+            }
+            return m_Owner->m_Listener->OnSend(m_Owner, dwConnID, pData, iLength);
+        }
+
+        virtual EnHandleResult OnReceive(ITcpClient* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+        {
+            if(m_Owner->m_Mode.load(std::memory_order_acquire) == ECONNECTION_PENDING && IsAck(pData, iLength))
+            {
+                return m_Owner->OnAck(dwConnID, *(const TShmAck*)pData);
+            }
+            return m_Owner->m_Listener->OnReceive(m_Owner, dwConnID, pData, iLength);
+        }
+
+        virtual EnHandleResult OnReceive(ITcpClient* pSender, CONNID dwConnID, int iLength) override
+        {
+            return m_Owner->m_Listener->OnReceive(m_Owner, dwConnID, iLength);
+        }
+
+        virtual EnHandleResult OnClose(ITcpClient* pSender, CONNID dwConnID, EnSocketOperation enOperation, int iErrorCode) override
+        {
+            m_Owner->OnDisconnected();
+            return m_Owner->m_Listener->OnClose(m_Owner, dwConnID, enOperation, iErrorCode);
+        }
+    private:
+        ShmTcpClient* m_Owner;
+    };
+
+    void SendHello(CONNID connID)
+    {
+        if(!m_Enabled || GetBootID()[0] == 0)
+        {
+            m_Mode.store(ECONNECTION_TCP, std::memory_order_release);
+            return;
+        }
+        static std::atomic<uint32_t> sequence(0);
+        TShmHello hello;
+        memset(&hello, 0, sizeof(hello));
+        hello.Magic = HELLO_MAGIC;
+        hello.RingSize = m_RingSize;
+        snprintf(hello.BootID, sizeof(hello.BootID), "%s", GetBootID());
+        ShmChannel::FormatName(hello.Name, sizeof(hello.Name), getpid(), sequence.fetch_add(1));
+        ShmConnectionPtr connection = std::make_shared<TShmConnection>(connID);
+        if(!connection->Channel.Create(hello.Name, m_RingSize))
+        {
+            m_Mode.store(ECONNECTION_TCP, std::memory_order_release);
+            return;
+        }
+        SetConnection(connection);
+        m_Mode.store(ECONNECTION_PENDING, std::memory_order_release);
+        if(!m_Socket->Send((const BYTE*)&hello, sizeof(hello)))
+        {
+            FallbackToTcp();
+        }
+    }
+
+    EnHandleResult OnAck(CONNID connID, const TShmAck& ack)
+    {
+        if(ack.Accepted == 0)
+        {
+            FallbackToTcp();
+            return HR_OK;
+        }
+        ShmConnectionPtr connection = GetConnection();
+        std::lock_guard<std::mutex> lock(m_PendingLock);
+        connection->Channel.Unlink();
+        for(size_t offset = 0; offset < m_Pending.size();)
+        {
+            WSABUF buffer;
+            buffer.len = *(const uint32_t*)&m_Pending[offset];
+            buffer.buf = &m_Pending[offset + sizeof(uint32_t)];
+            if(!WriteRecord(*connection, &buffer, 1))
+            {
+                return HR_ERROR;
+            }
+            m_Listener->OnSend(this, connID, buffer.buf, buffer.len);
+            offset += sizeof(uint32_t) + buffer.len;
+        }
+        m_Pending.clear();
+        AddPolling(connection);
+        m_Mode.store(ECONNECTION_SHM, std::memory_order_release);
+        return HR_OK;
+    }
+
+    void FallbackToTcp()
+    {
+        std::lock_guard<std::mutex> lock(m_PendingLock);
+        SetConnection(ShmConnectionPtr());
+        for(size_t offset = 0; offset < m_Pending.size();)
+        {
+            uint32_t length = *(const uint32_t*)&m_Pending[offset];
+            m_Socket->Send(&m_Pending[offset + sizeof(uint32_t)], length);
+            offset += sizeof(uint32_t) + length;
+        }
+        m_Pending.clear();
+        m_Mode.store(ECONNECTION_TCP, std::memory_order_release);
+    }
+
+    void OnDisconnected()
+    {
+        ShmConnectionPtr connection = GetConnection();
+        if(connection.get() != NULL)
+        {
+            if(m_Mode.load(std::memory_order_acquire) == ECONNECTION_SHM)
+            {
+                RemovePolling(connection);
+            }
+            SetConnection(ShmConnectionPtr());
+        }
+        std::lock_guard<std::mutex> lock(m_PendingLock);
+        m_Pending.clear();
+        m_Mode.store(ECONNECTION_NONE, std::memory_order_release);
+    }
+
+    virtual EnHandleResult OnShmReceive(TShmConnection& connection, const BYTE* data, int length) override
+    {
+        return m_Listener->OnReceive(this, connection.ConnID, data, length);
+    }
+
+    virtual void OnShmError(TShmConnection& connection) override
+    {
+        connection.Paused.store(true, std::memory_order_relaxed);
+        m_Socket->Stop();
+    }
+
+    ShmConnectionPtr GetConnection()
+    {
+        Lock(m_ConnectionLocked);
+        ShmConnectionPtr connection = m_Connection;
+        Unlock(m_ConnectionLocked);
+        return connection;
+    }
+
+    void SetConnection(const ShmConnectionPtr& connection)
+    {
+        Lock(m_ConnectionLocked);
+        ShmConnectionPtr previous = m_Connection;
+        m_Connection = connection;
+        Unlock(m_ConnectionLocked);
+    }
+private:
+    ShmTcpClient(const ShmTcpClient&);
+    ShmTcpClient& operator=(const ShmTcpClient&);
+private:
+    ITcpClientListener* m_Listener;
+    InnerListener m_InnerListener;
+    std::atomic<int> m_Mode;
+    std::atomic<uint32_t> m_ConnectionLocked{0};
+    ShmConnectionPtr m_Connection;
+    std::mutex m_PendingLock;
+    std::vector<BYTE> m_Pending;    // 握手完成前的发送数据，每条为4字节长度加数据
+};
+
+}
+
+#endif // SHMTCPTRANSPORT_HPP
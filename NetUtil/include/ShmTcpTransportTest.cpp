@@ -0,0 +1,421 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShmTcpTransport.hpp"
+#include "HRTimer.hpp"
+
+// 进程内模拟的HP-Socket组件对：连接、收发与关闭均同步回调监听器
+class MockServer;
+
+class MockClient: public NetUtil::TcpClientDelegate
+{
+public:
+    MockClient(ITcpClientListener* listener, MockServer* server): m_Listener(listener), m_Server(server), m_ConnID(0)
+    {
+    }
+
+    virtual BOOL Start(LPCTSTR lpszRemoteAddress, USHORT usPort, BOOL bAsyncConnect = TRUE, LPCTSTR lpszBindAddress = nullptr, USHORT usLocalPort = 0) override;
+    virtual BOOL Stop() override;
+    virtual BOOL Send(const BYTE* pBuffer, int iLength, int iOffset = 0) override
+    {
+        WSABUF buffer;
+        buffer.buf = (LPBYTE)pBuffer + iOffset;
+        buffer.len = iLength;
+        return SendPackets(&buffer, 1);
+    }
+    virtual BOOL SendPackets(const WSABUF pBuffers[], int iCount) override;
+    virtual BOOL GetPendingDataLength(int& iPending) override
+    {
+        iPending = 0;
+        return TRUE;
+    }
+    virtual CONNID GetConnectionID() override
+    {
+        return m_ConnID;
+    }
+
+    void OnPeerData(const BYTE* data, int length)
+    {
+        m_Listener->OnReceive(this, m_ConnID, data, length);
+    }
+
+    void OnPeerClose()
+    {
+        CONNID connID = m_ConnID;
+        m_ConnID = 0;
+        m_Listener->OnClose(this, connID, SO_CLOSE, 0);
+    }
+private:
+    ITcpClientListener* m_Listener;
+    MockServer* m_Server;
+    CONNID m_ConnID;
+};
+
+class MockServer: public NetUtil::TcpServerDelegate
+{
+public:
+    explicit MockServer(ITcpServerListener* listener): m_Listener(listener), m_NextID(0)
+    {
+    }
+
+    virtual BOOL SendPackets(CONNID dwConnID, const WSABUF pBuffers[], int iCount) override
+    {
+        std::string data;
+        for(int i = 0; i < iCount; i++)
+        {
+            data.append((const char*)pBuffers[i].buf, pBuffers[i].len);
+        }
+        m_Clients[dwConnID]->OnPeerData((const BYTE*)data.data(), data.size());
+        m_Listener->OnSend(this, dwConnID, (const BYTE*)data.data(), data.size());
+        return TRUE;
+    }
+    virtual BOOL Send(CONNID dwConnID, const BYTE* pBuffer, int iLength, int iOffset = 0) override
+    {
+        WSABUF buffer;
+        buffer.buf = (LPBYTE)pBuffer + iOffset;
+        buffer.len = iLength;
+        return SendPackets(dwConnID, &buffer, 1);
+    }
+    virtual BOOL Disconnect(CONNID dwConnID, BOOL bForce = TRUE) override
+    {
+        MockClient* client = m_Clients[dwConnID];
+        m_Clients.erase(dwConnID);
+        client->OnPeerClose();
+        m_Listener->OnClose(this, dwConnID, SO_CLOSE, 0);
+        return TRUE;
+    }
+    virtual BOOL GetPendingDataLength(CONNID dwConnID, int& iPending) override
+    {
+        iPending = 0;
+        return TRUE;
+    }
+
+    CONNID Accept(MockClient* client)
+    {
+        CONNID connID = ++m_NextID;
+        m_Clients[connID] = client;
+        m_Listener->OnAccept(this, connID, 0);
+        m_Listener->OnHandShake(this, connID);
+        return connID;
+    }
+
+    void OnPeerData(CONNID connID, const BYTE* data, int length)
+    {
+        m_Listener->OnReceive(this, connID, data, length);
+    }
+private:
+    ITcpServerListener* m_Listener;
+    CONNID m_NextID;
+    std::map<CONNID, MockClient*> m_Clients;
+};
+
+BOOL MockClient::Start(LPCTSTR lpszRemoteAddress, USHORT usPort, BOOL bAsyncConnect, LPCTSTR lpszBindAddress, USHORT usLocalPort)
+{
+    m_ConnID = m_Server->Accept(this);
+    m_Listener->OnConnect(this, m_ConnID);
+    m_Listener->OnHandShake(this, m_ConnID);
+    return TRUE;
+}
+
+BOOL MockClient::Stop()
+{
+    return m_ConnID != 0 ? m_Server->Disconnect(m_ConnID) : FALSE;
+}
+
+BOOL MockClient::SendPackets(const WSABUF pBuffers[], int iCount)
+{
+    std::string data;
+    for(int i = 0; i < iCount; i++)
+    {
+        data.append((const char*)pBuffers[i].buf, pBuffers[i].len);
+    }
+    m_Server->OnPeerData(m_ConnID, (const BYTE*)data.data(), data.size());
+    m_Listener->OnSend(this, m_ConnID, (const BYTE*)data.data(), data.size());
+    return TRUE;
+}
+
+// 应用监听器：服务端回显，客户端记录
+class ServerApp: public CTcpServerListener
+{
+public:
+    using CTcpServerListener::OnReceive;
+
+    ServerApp(): m_Echo(true), m_Closed(0), m_Sent(0)
+    {
+    }
+
+    virtual EnHandleResult OnReceive(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+    {
+        m_Received.push_back(std::string((const char*)pData, iLength));
+        if(m_Echo)
+        {
+            pSender->Send(dwConnID, pData, iLength);
+        }
+        return HR_OK;
+    }
+
+    virtual EnHandleResult OnSend(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+    {
+        m_Sent++;
+        return HR_OK;
+    }
+
+    virtual EnHandleResult OnClose(ITcpServer* pSender, CONNID dwConnID, EnSocketOperation enOperation, int iErrorCode) override
+    {
+        m_Closed++;
+        return HR_OK;
+    }
+
+    bool m_Echo;
+    std::vector<std::string> m_Received;
+    std::atomic<int> m_Closed;
+    std::atomic<int> m_Sent;
+};
+
+class ClientApp: public CTcpClientListener
+{
+public:
+    using CTcpClientListener::OnReceive;
+
+    ClientApp(): m_Count(0), m_Closed(0)
+    {
+    }
+
+    virtual EnHandleResult OnConnect(ITcpClient* pSender, CONNID dwConnID) override
+    {
+        // 握手完成前发送的数据
+        return pSender->Send((const BYTE*)"hello", 5) ? HR_OK : HR_ERROR;
+    }
+
+    virtual EnHandleResult OnReceive(ITcpClient* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override
+    {
+        m_Last.assign((const char*)pData, iLength);
+        m_Count.fetch_add(1, std::memory_order_release);
+        return HR_OK;
+    }
+
+    virtual EnHandleResult OnClose(ITcpClient* pSender, CONNID dwConnID, EnSocketOperation enOperation, int iErrorCode) override
+    {
+        m_Closed++;
+        return HR_OK;
+    }
+
+    std::string m_Last;
+    std::atomic<uint64_t> m_Count;
+    int m_Closed;
+};
+
+static void WaitCount(ClientApp& app, uint64_t count)
+{
+    while(app.m_Count.load(std::memory_order_acquire) < count)
+    {
+        sched_yield();
+    }
+}
+
+// 回环TCP往返延迟，对比基准
+static double TcpLoopbackRtt(int rounds)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(listener, (struct sockaddr*)&address, sizeof(address)) == 0);
+    socklen_t length = sizeof(address);
+    getsockname(listener, (struct sockaddr*)&address, &length);
+    listen(listener, 1);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    assert(connect(client, (struct sockaddr*)&address, sizeof(address)) == 0);
+    int server = accept(listener, NULL, NULL);
+    int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::thread echo([&]()
+    {
+        char buffer[64];
+        for(int i = 0; i < rounds; i++)
+        {
+            recv(server, buffer, sizeof(buffer), MSG_WAITALL);
+            send(server, buffer, sizeof(buffer), 0);
+        }
+    });
+    char buffer[64] = {0};
+    TimeUtil::HRTimer timer;
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < rounds; i++)
+    {
+        send(client, buffer, sizeof(buffer), 0);
+        recv(client, buffer, sizeof(buffer), MSG_WAITALL);
+    }
+    uint64_t end = timer.GetTimeNs();
+    echo.join();
+    close(client);
+    close(server);
+    close(listener);
+    return (double)(end - start) / rounds;
+}
+
+int main(int argc, char* argv[])
+{
+    // 环回绕与满
+    {
+        std::vector<char> memory(sizeof(NetUtil::TShmRingHeader) + 4096);
+        NetUtil::TShmRingHeader* header = new (&memory[0]) NetUtil::TShmRingHeader();
+        header->WritePos = 0;
+        header->ReadPos = 0;
+        NetUtil::ShmRing writer, reader;
+        writer.Attach(header, &memory[sizeof(*header)], 4096);
+        reader.Attach(header, &memory[sizeof(*header)], 4096);
+        char payload[1000];
+        for(int i = 0; i < 100; i++)
+        {
+            memset(payload, i, sizeof(payload));
+            WSABUF buffer = {(UINT)(300 + i * 7), (LPBYTE)payload};
+            assert(writer.Write(&buffer, 1, buffer.len));
+            uint32_t length = 0;
+            const BYTE* data = reader.Peek(length);
+            assert(data != NULL && length == buffer.len && data[0] == i && data[length - 1] == i);
+            reader.Pop();
+            assert(reader.Peek(length) == NULL);
+        }
+        header->WritePos = 0;
+        header->ReadPos = 0;
+        writer.Attach(header, &memory[sizeof(*header)], 4096);
+        WSABUF buffer = {1000, (LPBYTE)payload};
+        int written = 0;
+        while(writer.Write(&buffer, 1, buffer.len))
+        {
+            written++;
+        }
+        assert(written == 4 && writer.GetMaxRecordSize() == 2040);
+    }
+
+    // 服务端只打开、删除本传输格式的共享内存名字
+    {
+        char name[64];
+        NetUtil::ShmChannel::FormatName(name, sizeof(name), 1234, 4294967295u);
+        assert(strcmp(name, "/HPShm.1234.4294967295") == 0 && NetUtil::ShmChannel::IsChannelName(name));
+        assert(!NetUtil::ShmChannel::IsChannelName("/SnapshotBoard"));
+        assert(!NetUtil::ShmChannel::IsChannelName("/HPShm.1234"));
+        assert(!NetUtil::ShmChannel::IsChannelName("/HPShm.1234."));
+        assert(!NetUtil::ShmChannel::IsChannelName("/HPShm.1234.5x"));
+        assert(!NetUtil::ShmChannel::IsChannelName("/HPShm..5"));
+        assert(!NetUtil::ShmChannel::IsChannelName("/HPShm.1234.12345678901"));
+        NetUtil::ShmChannel channel;
+        assert(!channel.Open("/SnapshotBoard"));
+        // 环大小不是2的幂的通道拒绝打开
+        NetUtil::ShmChannel::FormatName(name, sizeof(name), getpid(), 0);
+        NetUtil::ShmChannel creator;
+        assert(creator.Create(name, 8192));
+        int fd = shm_open(name, O_RDWR, 0600);
+        struct stat st;
+        assert(fd >= 0 && fstat(fd, &st) == 0);
+        uint64_t* header = (uint64_t*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        assert(header != MAP_FAILED && header[0] == NetUtil::ShmChannel::MAGIC);
+        header[1] = 6144;
+        munmap(header, st.st_size);
+        assert(ftruncate(fd, st.st_size - 2 * (8192 - 6144)) == 0);
+        close(fd);
+        assert(!channel.Open(name));
+        creator.Close();
+    }
+
+    ServerApp serverApp;
+    NetUtil::ShmTcpServer server(&serverApp);
+    MockServer serverSocket(server.GetInnerListener());
+    server.Attach(&serverSocket);
+    server.SetPollPolicy(0, 0);
+
+    // 同主机客户端切换为共享内存，握手前的数据按序送达
+    ClientApp clientApp;
+    NetUtil::ShmTcpClient client(&clientApp);
+    MockClient clientSocket(client.GetInnerListener(), &serverSocket);
+    client.Attach(&clientSocket);
+    client.SetPollPolicy(0, 0);
+    client.SetShmRingSize(64 * 1024);
+    assert(client.Start("127.0.0.1", 5555));
+    assert(client.IsShmConnection());
+    CONNID connID = client.GetConnectionID();
+    assert(server.IsShmConnection(connID));
+    WaitCount(clientApp, 1);
+    assert(clientApp.m_Last == "hello" && serverApp.m_Received.size() == 1);
+    assert(client.Send((const BYTE*)"order", 5));
+    WaitCount(clientApp, 2);
+    assert(clientApp.m_Last == "order");
+    WSABUF buffers[2] = {{4, (LPBYTE)"pack"}, {3, (LPBYTE)"ets"}};
+    assert(client.SendPackets(buffers, 2));
+    WaitCount(clientApp, 3);
+    assert(clientApp.m_Last == "packets" && serverApp.m_Received.back() == "packets");
+    assert(serverApp.m_Sent == 3);
+
+    // 暂停接收时数据留在环中
+    serverApp.m_Echo = false;
+    assert(server.PauseReceive(connID, TRUE));
+    assert(client.Send((const BYTE*)"paused", 6));
+    usleep(1000);
+    assert(serverApp.m_Received.size() == 3);
+    int pending = 0;
+    assert(client.GetPendingDataLength(pending) && pending == 16);
+    // 关闭前排空环中数据再回调OnClose
+    assert(client.Stop());
+    assert(serverApp.m_Received.size() == 4 && serverApp.m_Received.back() == "paused");
+    assert(serverApp.m_Closed == 1 && clientApp.m_Closed == 1);
+    assert(!server.IsShmConnection(connID) && !client.IsShmConnection());
+
+    // 服务端不接受共享内存时回退TCP，握手前的数据经TCP发出
+    serverApp.m_Echo = true;
+    server.SetShmEnabled(false);
+    ClientApp tcpApp;
+    NetUtil::ShmTcpClient tcpClient(&tcpApp);
+    MockClient tcpSocket(tcpClient.GetInnerListener(), &serverSocket);
+    tcpClient.Attach(&tcpSocket);
+    assert(tcpClient.Start("127.0.0.1", 5555));
+    assert(!tcpClient.IsShmConnection() && !server.IsShmConnection(tcpClient.GetConnectionID()));
+    assert(tcpApp.m_Last == "hello");
+    assert(tcpClient.Send((const BYTE*)"tcp", 3) && tcpApp.m_Last == "tcp");
+    tcpClient.Stop();
+
+    // 普通客户端不发握手消息，首个数据即转发
+    server.SetShmEnabled(true);
+    ClientApp plainApp;
+    MockClient plainSocket(&plainApp, &serverSocket);
+    assert(plainSocket.Start("127.0.0.1", 5555));
+    assert(plainApp.m_Last == "hello" && !server.IsShmConnection(plainSocket.GetConnectionID()));
+    plainSocket.Stop();
+
+    // 往返延迟：64字节经共享内存回显
+    ClientApp latencyApp;
+    NetUtil::ShmTcpClient latencyClient(&latencyApp);
+    MockClient latencySocket(latencyClient.GetInnerListener(), &serverSocket);
+    latencyClient.Attach(&latencySocket);
+    latencyClient.SetPollPolicy(0, 0);
+    assert(latencyClient.Start("127.0.0.1", 5555));
+    assert(latencyClient.IsShmConnection());
+    WaitCount(latencyApp, 1);
+    serverApp.m_Received.clear();
+    serverApp.m_Received.reserve(200000);
+    const int N = 100000;
+    char message[64] = {0};
+    TimeUtil::HRTimer timer;
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        latencyClient.Send((const BYTE*)message, sizeof(message));
+        WaitCount(latencyApp, i + 2);
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "ShmTcpTransport RTT: %.1f ns, TCP Loopback RTT: %.1f ns\n", (double)(end - start) / N, TcpLoopbackRtt(N));
+    latencyClient.Stop();
+    return 0;
+}
+
+// g++ -std=c++11 -O2 ShmTcpTransportTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../HP-Socket/5.8.2/include -lrt
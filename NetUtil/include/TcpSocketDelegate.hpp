@@ -0,0 +1,187 @@
+#ifndef TCPSOCKETDELEGATE_HPP
+#define TCPSOCKETDELEGATE_HPP
+
+#include <stddef.h>
+#include "SocketInterface.h"
+
+namespace NetUtil
+{
+
+// ITcpServer转发基类，全部接口转发给内部组件，派生类只覆盖需要改变行为的接口
+class TcpServerDelegate: public ITcpServer
+{
+public:
+    explicit TcpServerDelegate(ITcpServer* socket = NULL): m_Socket(socket)
+    {
+    }
+
+    void SetInnerSocket(ITcpServer* socket)
+    {
+        m_Socket = socket;
+    }
+
+    ITcpServer* GetInnerSocket() const
+    {
+        return m_Socket;
+    }
+
+    virtual BOOL Start(LPCTSTR lpszBindAddress, USHORT usPort) override {return m_Socket->Start(lpszBindAddress, usPort);}
+    virtual BOOL Stop() override {return m_Socket->Stop();}
+    virtual BOOL Send(CONNID dwConnID, const BYTE* pBuffer, int iLength, int iOffset = 0) override {return m_Socket->Send(dwConnID, pBuffer, iLength, iOffset);}
+    virtual BOOL SendPackets(CONNID dwConnID, const WSABUF pBuffers[], int iCount) override {return m_Socket->SendPackets(dwConnID, pBuffers, iCount);}
+    virtual BOOL SendSmallFile(CONNID dwConnID, LPCTSTR lpszFileName, const LPWSABUF pHead = nullptr, const LPWSABUF pTail = nullptr) override {return m_Socket->SendSmallFile(dwConnID, lpszFileName, pHead, pTail);}
+    virtual BOOL PauseReceive(CONNID dwConnID, BOOL bPause = TRUE) override {return m_Socket->PauseReceive(dwConnID, bPause);}
+    virtual BOOL Disconnect(CONNID dwConnID, BOOL bForce = TRUE) override {return m_Socket->Disconnect(dwConnID, bForce);}
+    virtual BOOL DisconnectLongConnections(DWORD dwPeriod, BOOL bForce = TRUE) override {return m_Socket->DisconnectLongConnections(dwPeriod, bForce);}
+    virtual BOOL DisconnectSilenceConnections(DWORD dwPeriod, BOOL bForce = TRUE) override {return m_Socket->DisconnectSilenceConnections(dwPeriod, bForce);}
+    virtual BOOL Wait(DWORD dwMilliseconds = INFINITE) override {return m_Socket->Wait(dwMilliseconds);}
+
+    virtual BOOL SetConnectionExtra(CONNID dwConnID, PVOID pExtra) override {return m_Socket->SetConnectionExtra(dwConnID, pExtra);}
+    virtual BOOL GetConnectionExtra(CONNID dwConnID, PVOID* ppExtra) override {return m_Socket->GetConnectionExtra(dwConnID, ppExtra);}
+    virtual BOOL IsSecure() override {return m_Socket->IsSecure();}
+    virtual BOOL HasStarted() override {return m_Socket->HasStarted();}
+    virtual EnServiceState GetState() override {return m_Socket->GetState();}
+    virtual DWORD GetConnectionCount() override {return m_Socket->GetConnectionCount();}
+    virtual BOOL GetAllConnectionIDs(CONNID pIDs[], DWORD& dwCount) override {return m_Socket->GetAllConnectionIDs(pIDs, dwCount);}
+    virtual BOOL GetConnectPeriod(CONNID dwConnID, DWORD& dwPeriod) override {return m_Socket->GetConnectPeriod(dwConnID, dwPeriod);}
+    virtual BOOL GetSilencePeriod(CONNID dwConnID, DWORD& dwPeriod) override {return m_Socket->GetSilencePeriod(dwConnID, dwPeriod);}
+    virtual BOOL GetLocalAddress(CONNID dwConnID, TCHAR lpszAddress[], int& iAddressLen, USHORT& usPort) override {return m_Socket->GetLocalAddress(dwConnID, lpszAddress, iAddressLen, usPort);}
+    virtual BOOL GetRemoteAddress(CONNID dwConnID, TCHAR lpszAddress[], int& iAddressLen, USHORT& usPort) override {return m_Socket->GetRemoteAddress(dwConnID, lpszAddress, iAddressLen, usPort);}
+    virtual EnSocketError GetLastError() override {return m_Socket->GetLastError();}
+    virtual LPCTSTR GetLastErrorDesc() override {return m_Socket->GetLastErrorDesc();}
+    virtual BOOL GetPendingDataLength(CONNID dwConnID, int& iPending) override {return m_Socket->GetPendingDataLength(dwConnID, iPending);}
+    virtual BOOL IsPauseReceive(CONNID dwConnID, BOOL& bPaused) override {return m_Socket->IsPauseReceive(dwConnID, bPaused);}
+    virtual BOOL IsConnected(CONNID dwConnID) override {return m_Socket->IsConnected(dwConnID);}
+    virtual BOOL GetListenAddress(TCHAR lpszAddress[], int& iAddressLen, USHORT& usPort) override {return m_Socket->GetListenAddress(lpszAddress, iAddressLen, usPort);}
+
+    virtual void SetReuseAddressPolicy(EnReuseAddressPolicy enReusePolicy) override {m_Socket->SetReuseAddressPolicy(enReusePolicy);}
+    virtual void SetSendPolicy(EnSendPolicy enSendPolicy) override {m_Socket->SetSendPolicy(enSendPolicy);}
+    virtual void SetOnSendSyncPolicy(EnOnSendSyncPolicy enSyncPolicy) override {m_Socket->SetOnSendSyncPolicy(enSyncPolicy);}
+    virtual void SetMaxConnectionCount(DWORD dwMaxConnectionCount) override {m_Socket->SetMaxConnectionCount(dwMaxConnectionCount);}
+    virtual void SetFreeSocketObjLockTime(DWORD dwFreeSocketObjLockTime) override {m_Socket->SetFreeSocketObjLockTime(dwFreeSocketObjLockTime);}
+    virtual void SetFreeSocketObjPool(DWORD dwFreeSocketObjPool) override {m_Socket->SetFreeSocketObjPool(dwFreeSocketObjPool);}
+    virtual void SetFreeBufferObjPool(DWORD dwFreeBufferObjPool) override {m_Socket->SetFreeBufferObjPool(dwFreeBufferObjPool);}
+    virtual void SetFreeSocketObjHold(DWORD dwFreeSocketObjHold) override {m_Socket->SetFreeSocketObjHold(dwFreeSocketObjHold);}
+    virtual void SetFreeBufferObjHold(DWORD dwFreeBufferObjHold) override {m_Socket->SetFreeBufferObjHold(dwFreeBufferObjHold);}
+    virtual void SetWorkerThreadCount(DWORD dwWorkerThreadCount) override {m_Socket->SetWorkerThreadCount(dwWorkerThreadCount);}
+    virtual void SetMarkSilence(BOOL bMarkSilence) override {m_Socket->SetMarkSilence(bMarkSilence);}
+    virtual void SetAcceptSocketCount(DWORD dwAcceptSocketCount) override {m_Socket->SetAcceptSocketCount(dwAcceptSocketCount);}
+    virtual void SetSocketBufferSize(DWORD dwSocketBufferSize) override {m_Socket->SetSocketBufferSize(dwSocketBufferSize);}
+    virtual void SetSocketListenQueue(DWORD dwSocketListenQueue) override {m_Socket->SetSocketListenQueue(dwSocketListenQueue);}
+    virtual void SetKeepAliveTime(DWORD dwKeepAliveTime) override {m_Socket->SetKeepAliveTime(dwKeepAliveTime);}
+    virtual void SetKeepAliveInterval(DWORD dwKeepAliveInterval) override {m_Socket->SetKeepAliveInterval(dwKeepAliveInterval);}
+
+    virtual EnReuseAddressPolicy GetReuseAddressPolicy() override {return m_Socket->GetReuseAddressPolicy();}
+    virtual EnSendPolicy GetSendPolicy() override {return m_Socket->GetSendPolicy();}
+    virtual EnOnSendSyncPolicy GetOnSendSyncPolicy() override {return m_Socket->GetOnSendSyncPolicy();}
+    virtual DWORD GetMaxConnectionCount() override {return m_Socket->GetMaxConnectionCount();}
+    virtual DWORD GetFreeSocketObjLockTime() override {return m_Socket->GetFreeSocketObjLockTime();}
+    virtual DWORD GetFreeSocketObjPool() override {return m_Socket->GetFreeSocketObjPool();}
+    virtual DWORD GetFreeBufferObjPool() override {return m_Socket->GetFreeBufferObjPool();}
+    virtual DWORD GetFreeSocketObjHold() override {return m_Socket->GetFreeSocketObjHold();}
+    virtual DWORD GetFreeBufferObjHold() override {return m_Socket->GetFreeBufferObjHold();}
+    virtual DWORD GetWorkerThreadCount() override {return m_Socket->GetWorkerThreadCount();}
+    virtual BOOL IsMarkSilence() override {return m_Socket->IsMarkSilence();}
+    virtual DWORD GetAcceptSocketCount() override {return m_Socket->GetAcceptSocketCount();}
+    virtual DWORD GetSocketBufferSize() override {return m_Socket->GetSocketBufferSize();}
+    virtual DWORD GetSocketListenQueue() override {return m_Socket->GetSocketListenQueue();}
+    virtual DWORD GetKeepAliveTime() override {return m_Socket->GetKeepAliveTime();}
+    virtual DWORD GetKeepAliveInterval() override {return m_Socket->GetKeepAliveInterval();}
+
+#ifdef _SSL_SUPPORT
+    virtual BOOL SetupSSLContext(int iVerifyMode = SSL_VM_NONE, LPCTSTR lpszPemCertFile = nullptr, LPCTSTR lpszPemKeyFile = nullptr, LPCTSTR lpszKeyPassword = nullptr, LPCTSTR lpszCAPemCertFileOrPath = nullptr, Fn_SNI_ServerNameCallback fnServerNameCallback = nullptr) override
+    {return m_Socket->SetupSSLContext(iVerifyMode, lpszPemCertFile, lpszPemKeyFile, lpszKeyPassword, lpszCAPemCertFileOrPath, fnServerNameCallback);}
+    virtual BOOL SetupSSLContextByMemory(int iVerifyMode = SSL_VM_NONE, LPCSTR lpszPemCert = nullptr, LPCSTR lpszPemKey = nullptr, LPCSTR lpszKeyPassword = nullptr, LPCSTR lpszCAPemCert = nullptr, Fn_SNI_ServerNameCallback fnServerNameCallback = nullptr) override
+    {return m_Socket->SetupSSLContextByMemory(iVerifyMode, lpszPemCert, lpszPemKey, lpszKeyPassword, lpszCAPemCert, fnServerNameCallback);}
+    virtual int AddSSLContext(int iVerifyMode = SSL_VM_NONE, LPCTSTR lpszPemCertFile = nullptr, LPCTSTR lpszPemKeyFile = nullptr, LPCTSTR lpszKeyPassword = nullptr, LPCTSTR lpszCAPemCertFileOrPath = nullptr) override
+    {return m_Socket->AddSSLContext(iVerifyMode, lpszPemCertFile, lpszPemKeyFile, lpszKeyPassword, lpszCAPemCertFileOrPath);}
+    virtual int AddSSLContextByMemory(int iVerifyMode = SSL_VM_NONE, LPCSTR lpszPemCert = nullptr, LPCSTR lpszPemKey = nullptr, LPCSTR lpszKeyPassword = nullptr, LPCSTR lpszCAPemCert = nullptr) override
+    {return m_Socket->AddSSLContextByMemory(iVerifyMode, lpszPemCert, lpszPemKey, lpszKeyPassword, lpszCAPemCert);}
+    virtual BOOL BindSSLServerName(LPCTSTR lpszServerName, int iContextIndex) override {return m_Socket->BindSSLServerName(lpszServerName, iContextIndex);}
+    virtual void CleanupSSLContext() override {m_Socket->CleanupSSLContext();}
+    virtual BOOL StartSSLHandShake(CONNID dwConnID) override {return m_Socket->StartSSLHandShake(dwConnID);}
+    virtual void SetSSLAutoHandShake(BOOL bAutoHandShake) override {m_Socket->SetSSLAutoHandShake(bAutoHandShake);}
+    virtual BOOL IsSSLAutoHandShake() override {return m_Socket->IsSSLAutoHandShake();}
+    virtual void SetSSLCipherList(LPCTSTR lpszCipherList) override {m_Socket->SetSSLCipherList(lpszCipherList);}
+    virtual LPCTSTR GetSSLCipherList() override {return m_Socket->GetSSLCipherList();}
+    virtual BOOL GetSSLSessionInfo(CONNID dwConnID, EnSSLSessionInfo enInfo, LPVOID* lppInfo) override {return m_Socket->GetSSLSessionInfo(dwConnID, enInfo, lppInfo);}
+#endif
+protected:
+    ITcpServer* m_Socket;
+};
+
+// ITcpClient转发基类
+class TcpClientDelegate: public ITcpClient
+{
+public:
+    explicit TcpClientDelegate(ITcpClient* socket = NULL): m_Socket(socket)
+    {
+    }
+
+    void SetInnerSocket(ITcpClient* socket)
+    {
+        m_Socket = socket;
+    }
+
+    ITcpClient* GetInnerSocket() const
+    {
+        return m_Socket;
+    }
+
+    virtual BOOL Start(LPCTSTR lpszRemoteAddress, USHORT usPort, BOOL bAsyncConnect = TRUE, LPCTSTR lpszBindAddress = nullptr, USHORT usLocalPort = 0) override
+    {return m_Socket->Start(lpszRemoteAddress, usPort, bAsyncConnect, lpszBindAddress, usLocalPort);}
+    virtual BOOL Stop() override {return m_Socket->Stop();}
+    virtual BOOL Send(const BYTE* pBuffer, int iLength, int iOffset = 0) override {return m_Socket->Send(pBuffer, iLength, iOffset);}
+    virtual BOOL SendPackets(const WSABUF pBuffers[], int iCount) override {return m_Socket->SendPackets(pBuffers, iCount);}
+    virtual BOOL SendSmallFile(LPCTSTR lpszFileName, const LPWSABUF pHead = nullptr, const LPWSABUF pTail = nullptr) override {return m_Socket->SendSmallFile(lpszFileName, pHead, pTail);}
+    virtual BOOL PauseReceive(BOOL bPause = TRUE) override {return m_Socket->PauseReceive(bPause);}
+    virtual BOOL Wait(DWORD dwMilliseconds = INFINITE) override {return m_Socket->Wait(dwMilliseconds);}
+
+    virtual void SetExtra(PVOID pExtra) override {m_Socket->SetExtra(pExtra);}
+    virtual PVOID GetExtra() override {return m_Socket->GetExtra();}
+    virtual BOOL IsSecure() override {return m_Socket->IsSecure();}
+    virtual BOOL HasStarted() override {return m_Socket->HasStarted();}
+    virtual EnServiceState GetState() override {return m_Socket->GetState();}
+    virtual EnSocketError GetLastError() override {return m_Socket->GetLastError();}
+    virtual LPCTSTR GetLastErrorDesc() override {return m_Socket->GetLastErrorDesc();}
+    virtual CONNID GetConnectionID() override {return m_Socket->GetConnectionID();}
+    virtual BOOL GetLocalAddress(TCHAR lpszAddress[], int& iAddressLen, USHORT& usPort) override {return m_Socket->GetLocalAddress(lpszAddress, iAddressLen, usPort);}
+    virtual BOOL GetRemoteHost(TCHAR lpszHost[], int& iHostLen, USHORT& usPort) override {return m_Socket->GetRemoteHost(lpszHost, iHostLen, usPort);}
+    virtual BOOL GetPendingDataLength(int& iPending) override {return m_Socket->GetPendingDataLength(iPending);}
+    virtual BOOL IsPauseReceive(BOOL& bPaused) override {return m_Socket->IsPauseReceive(bPaused);}
+    virtual BOOL IsConnected() override {return m_Socket->IsConnected();}
+
+    virtual void SetReuseAddressPolicy(EnReuseAddressPolicy enReusePolicy) override {m_Socket->SetReuseAddressPolicy(enReusePolicy);}
+    virtual void SetFreeBufferPoolSize(DWORD dwFreeBufferPoolSize) override {m_Socket->SetFreeBufferPoolSize(dwFreeBufferPoolSize);}
+    virtual void SetFreeBufferPoolHold(DWORD dwFreeBufferPoolHold) override {m_Socket->SetFreeBufferPoolHold(dwFreeBufferPoolHold);}
+    virtual void SetSocketBufferSize(DWORD dwSocketBufferSize) override {m_Socket->SetSocketBufferSize(dwSocketBufferSize);}
+    virtual void SetKeepAliveTime(DWORD dwKeepAliveTime) override {m_Socket->SetKeepAliveTime(dwKeepAliveTime);}
+    virtual void SetKeepAliveInterval(DWORD dwKeepAliveInterval) override {m_Socket->SetKeepAliveInterval(dwKeepAliveInterval);}
+
+    virtual EnReuseAddressPolicy GetReuseAddressPolicy() override {return m_Socket->GetReuseAddressPolicy();}
+    virtual DWORD GetFreeBufferPoolSize() override {return m_Socket->GetFreeBufferPoolSize();}
+    virtual DWORD GetFreeBufferPoolHold() override {return m_Socket->GetFreeBufferPoolHold();}
+    virtual DWORD GetSocketBufferSize() override {return m_Socket->GetSocketBufferSize();}
+    virtual DWORD GetKeepAliveTime() override {return m_Socket->GetKeepAliveTime();}
+    virtual DWORD GetKeepAliveInterval() override {return m_Socket->GetKeepAliveInterval();}
+
+#ifdef _SSL_SUPPORT
+    virtual BOOL SetupSSLContext(int iVerifyMode = SSL_VM_NONE, LPCTSTR lpszPemCertFile = nullptr, LPCTSTR lpszPemKeyFile = nullptr, LPCTSTR lpszKeyPassword = nullptr, LPCTSTR lpszCAPemCertFileOrPath = nullptr) override
+    {return m_Socket->SetupSSLContext(iVerifyMode, lpszPemCertFile, lpszPemKeyFile, lpszKeyPassword, lpszCAPemCertFileOrPath);}
+    virtual BOOL SetupSSLContextByMemory(int iVerifyMode = SSL_VM_NONE, LPCSTR lpszPemCert = nullptr, LPCSTR lpszPemKey = nullptr, LPCSTR lpszKeyPassword = nullptr, LPCSTR lpszCAPemCert = nullptr) override
+    {return m_Socket->SetupSSLContextByMemory(iVerifyMode, lpszPemCert, lpszPemKey, lpszKeyPassword, lpszCAPemCert);}
+    virtual void CleanupSSLContext() override {m_Socket->CleanupSSLContext();}
+    virtual BOOL StartSSLHandShake() override {return m_Socket->StartSSLHandShake();}
+    virtual void SetSSLAutoHandShake(BOOL bAutoHandShake) override {m_Socket->SetSSLAutoHandShake(bAutoHandShake);}
+    virtual BOOL IsSSLAutoHandShake() override {return m_Socket->IsSSLAutoHandShake();}
+    virtual void SetSSLCipherList(LPCTSTR lpszCipherList) override {m_Socket->SetSSLCipherList(lpszCipherList);}
+    virtual LPCTSTR GetSSLCipherList() override {return m_Socket->GetSSLCipherList();}
+    virtual BOOL GetSSLSessionInfo(EnSSLSessionInfo enInfo, LPVOID* lppInfo) override {return m_Socket->GetSSLSessionInfo(enInfo, lppInfo);}
+#endif
+protected:
+    ITcpClient* m_Socket;
+};
+
+}
+
+#endif // TCPSOCKETDELEGATE_HPP
@@ -0,0 +1,151 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+//
+// Per-call latency of async logging with 1, 4 and 16 producer threads.
+// Build twice to compare the default mpmc_blocking_queue with the lock-free queue:
+//   g++ -std=c++11 -O2 async_queue_bench.cpp -o async_queue_bench -I../include -pthread
+//   g++ -std=c++11 -O2 -DSPDLOG_LOCKFREE_ASYNC_QUEUE async_queue_bench.cpp -o async_queue_bench_lockfree -I../include -pthread
+//
+
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// formats every message like a file sink would, but only counts the bytes
+class counting_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+    std::atomic<size_t> messages{0};
+    std::atomic<size_t> bytes{0};
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override
+    {
+        spdlog::memory_buf_t formatted;
+        formatter_->format(msg, formatted);
+        messages.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(formatted.size(), std::memory_order_relaxed);
+    }
+
+    void flush_() override {}
+};
+
+struct bench_result
+{
+    double avg_ns;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+    double total_ms;
+};
+
+static bench_result bench_producers(
+    size_t producers, size_t msgs_per_thread, spdlog::async_overflow_policy policy, std::shared_ptr<counting_sink> sink)
+{
+    auto tp = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+    auto logger = std::make_shared<spdlog::async_logger>("bench", sink, tp, policy);
+    std::vector<std::vector<uint32_t>> latencies(producers, std::vector<uint32_t>(msgs_per_thread));
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    auto start = steady_clock::now();
+    for (size_t t = 0; t < producers; t++)
+    {
+        threads.emplace_back([&, t] {
+            auto &samples = latencies[t];
+            ready++;
+            while (!go.load())
+            {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < msgs_per_thread; i++)
+            {
+                auto before = steady_clock::now();
+                logger->info("order {} px {:.2f} qty {} thread {}", i, 3500.0 + (i & 7), 10, t);
+                auto after = steady_clock::now();
+                samples[i] = static_cast<uint32_t>(duration_cast<nanoseconds>(after - before).count());
+            }
+        });
+    }
+    while (ready.load() < producers)
+    {
+        std::this_thread::yield();
+    }
+    start = steady_clock::now();
+    go = true;
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    logger.reset();
+    tp.reset(); // drains the queue and joins the worker
+    auto end = steady_clock::now();
+
+    std::vector<uint32_t> all;
+    all.reserve(producers * msgs_per_thread);
+    for (auto &samples : latencies)
+    {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    double sum = 0;
+    for (auto v : all)
+    {
+        sum += v;
+    }
+    bench_result result;
+    result.avg_ns = sum / all.size();
+    result.p50_ns = all[all.size() / 2];
+    result.p99_ns = all[all.size() * 99 / 100];
+    result.p999_ns = all[all.size() * 999 / 1000];
+    result.total_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t total_msgs = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 1600000;
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+    const char *queue_name = "lockfree_ring_queue";
+#else
+    const char *queue_name = "mpmc_blocking_queue";
+#endif
+    const size_t producer_counts[] = {1, 4, 16};
+    const spdlog::async_overflow_policy policies[] = {
+        spdlog::async_overflow_policy::block, spdlog::async_overflow_policy::overrun_oldest};
+    for (auto policy : policies)
+    {
+        for (auto producers : producer_counts)
+        {
+            auto sink = std::make_shared<counting_sink>();
+            size_t msgs_per_thread = total_msgs / producers;
+            bench_result result = bench_producers(producers, msgs_per_thread, policy, sink);
+            size_t expected = msgs_per_thread * producers;
+            bool block = policy == spdlog::async_overflow_policy::block;
+            if (block && sink->messages.load() != expected)
+            {
+                fprintf(stderr, "lost messages with block policy: %zu of %zu\n", sink->messages.load(), expected);
+                return 1;
+            }
+            printf("%s %-14s producers %2zu: avg %7.1f ns p50 %6.0f ns p99 %7.0f ns p99.9 %8.0f ns, "
+                   "total %8.1f ms, delivered %zu/%zu\n",
+                queue_name, block ? "block" : "overrun_oldest", producers, result.avg_ns, result.p50_ns, result.p99_ns,
+                result.p999_ns, result.total_ms, sink->messages.load(), expected);
+        }
+    }
+    return 0;
+}
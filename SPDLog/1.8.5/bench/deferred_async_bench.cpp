@@ -0,0 +1,152 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+//
+// Caller-side latency of async_logger::log() (format on caller) versus
+// async_logger::log_deferred() (raw arguments copied, format on the worker).
+// Also checks that both paths write identical lines through rotating_file_sink.
+//   g++ -std=c++11 -O2 deferred_async_bench.cpp -o deferred_async_bench -I../include -pthread
+//
+
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/sinks/rotating_file_sink.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+struct tick
+{
+    int volume;
+    double price;
+};
+
+template<typename F>
+static void bench(const char *name, size_t iters, F &&f)
+{
+    std::vector<uint32_t> samples(iters);
+    for (size_t i = 0; i < iters; i++)
+    {
+        auto before = steady_clock::now();
+        f(i);
+        auto after = steady_clock::now();
+        samples[i] = static_cast<uint32_t>(duration_cast<nanoseconds>(after - before).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (auto v : samples)
+    {
+        sum += v;
+    }
+    printf("%-14s avg %6.1f ns p50 %5u ns p99 %6u ns p99.9 %7u ns\n", name, sum / iters, samples[iters / 2],
+        samples[iters * 99 / 100], samples[iters * 999 / 1000]);
+}
+
+// counts messages and flushes, to check flush_on on the deferred path
+struct counting_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+    std::atomic<int> messages{0};
+    std::atomic<int> flushes{0};
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &) override
+    {
+        messages++;
+    }
+    void flush_() override
+    {
+        flushes++;
+    }
+};
+
+static std::vector<std::string> read_lines(const std::string &path)
+{
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        lines.push_back(line.substr(line.find(']') + 1)); // strip the time stamp
+    }
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iters = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 1000000;
+
+    // same output through an unchanged file sink
+    {
+        auto tp = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+        auto eager_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>("logs/eager.log", 1024 * 1024, 1, true);
+        auto deferred_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>("logs/deferred.log", 1024 * 1024, 1, true);
+        auto eager = std::make_shared<spdlog::async_logger>("bench", eager_sink, tp);
+        auto deferred = std::make_shared<spdlog::async_logger>("bench", deferred_sink, tp);
+        eager->set_pattern("[%H:%M:%S.%f] [%n] [%l] %v");
+        deferred->set_pattern("[%H:%M:%S.%f] [%n] [%l] %v");
+        for (int i = 0; i < 1000; i++)
+        {
+            tick t{i, 3500.0 + i * 0.5};
+            eager->log(spdlog::level::info, "order {} px {:.2f} qty {} side {} ok {}", i, t.price, t.volume, 'B', i % 2 == 0);
+            SPDLOG_LOGGER_DEFERRED(deferred, spdlog::level::info, "order {} px {:.2f} qty {} side {} ok {}", i, t.price, t.volume, 'B', i % 2 == 0);
+        }
+        SPDLOG_LOGGER_DEFERRED(deferred, spdlog::level::debug, "filtered {}", 1);
+        eager->flush();
+        deferred->flush();
+        eager.reset();
+        deferred.reset();
+        tp.reset();
+        auto eager_lines = read_lines("logs/eager.log");
+        auto deferred_lines = read_lines("logs/deferred.log");
+        if (eager_lines.size() != 1000 || eager_lines != deferred_lines)
+        {
+            fprintf(stderr, "deferred output differs from eager output (%zu vs %zu lines)\n", eager_lines.size(),
+                deferred_lines.size());
+            return 1;
+        }
+    }
+
+    // flush_on(err) flushes after a deferred error message, as it does for log()
+    {
+        auto tp = std::make_shared<spdlog::details::thread_pool>(1024, 1);
+        auto sink = std::make_shared<counting_sink>();
+        auto deferred = std::make_shared<spdlog::async_logger>("bench", sink, tp);
+        deferred->flush_on(spdlog::level::err);
+        SPDLOG_LOGGER_DEFERRED(deferred, spdlog::level::info, "info {}", 1);
+        SPDLOG_LOGGER_DEFERRED(deferred, spdlog::level::err, "err {}", 2);
+        for (int i = 0; i < 1000 && sink->flushes.load() == 0; i++)
+        {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        if (sink->messages.load() != 2 || sink->flushes.load() != 1)
+        {
+            fprintf(stderr, "flush_on not applied to deferred messages (%d messages, %d flushes)\n", sink->messages.load(),
+                sink->flushes.load());
+            return 1;
+        }
+    }
+
+    auto tp = std::make_shared<spdlog::details::thread_pool>(1 << 20, 1);
+    auto logger = std::make_shared<spdlog::async_logger>(
+        "bench", std::make_shared<spdlog::sinks::null_sink_mt>(), tp, spdlog::async_overflow_policy::overrun_oldest);
+    bench("log", iters, [&](size_t i) {
+        logger->log(spdlog::level::info, "order {} px {:.2f} qty {} side {} ok {}", i, 3500.0 + (i & 7), 10, 'B', true);
+    });
+    bench("log_deferred", iters, [&](size_t i) {
+        logger->log_deferred(spdlog::level::info, FMT_STRING("order {} px {:.2f} qty {} side {} ok {}"), i, 3500.0 + (i & 7), 10, 'B', true);
+    });
+    return 0;
+}
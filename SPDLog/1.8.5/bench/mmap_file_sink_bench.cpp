@@ -0,0 +1,170 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+//
+// Per-call latency of rotating_file_sink versus mmap_rotating_file_sink, with and without
+// flush after every record. Also checks that rolled files hold every record exactly once and
+// that a writer killed with SIGKILL leaves only complete records behind.
+//   g++ -std=c++11 -O2 mmap_file_sink_bench.cpp -o mmap_file_sink_bench -I../include -pthread
+//
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/mmap_rotating_file_sink.h"
+#include "spdlog/sinks/rotating_file_sink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+template<typename F>
+static void bench(const char *name, size_t iters, F &&f)
+{
+    std::vector<uint32_t> samples(iters);
+    for (size_t i = 0; i < iters; i++)
+    {
+        auto before = steady_clock::now();
+        f(i);
+        auto after = steady_clock::now();
+        samples[i] = static_cast<uint32_t>(duration_cast<nanoseconds>(after - before).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (auto v : samples)
+    {
+        sum += v;
+    }
+    printf("%-20s avg %6.1f ns p50 %5u ns p99 %6u ns p99.9 %7u ns\n", name, sum / iters, samples[iters / 2],
+        samples[iters * 99 / 100], samples[iters * 999 / 1000]);
+}
+
+// sequence numbers of "seq <n>" lines in a file, -1 for a malformed line
+static std::vector<long> read_sequence(const std::string &path)
+{
+    std::vector<long> seq;
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (in.eof() || line.size() < 5 || line.compare(0, 4, "seq ") != 0 || line.find('\0') != std::string::npos)
+        {
+            seq.push_back(-1);
+            continue;
+        }
+        seq.push_back(atol(line.c_str() + 4));
+    }
+    return seq;
+}
+
+// records of all rolled files, oldest first
+static std::vector<long> read_all(size_t max_files)
+{
+    std::vector<long> all;
+    for (size_t i = max_files + 1; i > 0; i--)
+    {
+        auto name = spdlog::sinks::mmap_rotating_file_sink_st::calc_filename("logs/mmap_check.log", i - 1);
+        auto seq = read_sequence(name);
+        all.insert(all.end(), seq.begin(), seq.end());
+    }
+    return all;
+}
+
+// the oldest files may have been deleted, the rest must follow without gaps
+static bool is_consecutive(const std::vector<long> &seq)
+{
+    for (size_t i = 0; i < seq.size(); i++)
+    {
+        if (seq[i] < 0 || seq[i] != seq[0] + static_cast<long>(i))
+        {
+            fprintf(stderr, "record %zu is %ld\n", i, seq[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void remove_check_files(size_t max_files)
+{
+    for (size_t i = 0; i <= max_files; i++)
+    {
+        std::remove(spdlog::sinks::mmap_rotating_file_sink_st::calc_filename("logs/mmap_check.log", i).c_str());
+    }
+    std::remove("logs/mmap_check.next.log");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iters = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 1000000;
+    const size_t max_files = 64;
+
+    // every record once, in order, across the rolled files
+    {
+        remove_check_files(max_files);
+        auto logger = spdlog::mmap_rotating_logger_st("mmap_check", "logs/mmap_check.log", 64 * 1024, max_files);
+        logger->set_pattern("%v");
+        for (long i = 0; i < 40000; i++)
+        {
+            logger->info("seq {}", i);
+        }
+        spdlog::drop("mmap_check");
+        logger.reset();
+        auto all = read_all(max_files);
+        if (all.size() != 40000 || all[0] != 0 || !is_consecutive(all))
+        {
+            fprintf(stderr, "rolled files lost or reordered records (%zu)\n", all.size());
+            return 1;
+        }
+    }
+
+    // kill -9 in the middle of writing, then reopen
+    for (int round = 0; round < 5; round++)
+    {
+        remove_check_files(max_files);
+        pid_t child = fork();
+        if (child == 0)
+        {
+            auto logger = spdlog::mmap_rotating_logger_st("mmap_crash", "logs/mmap_check.log", 256 * 1024, max_files);
+            logger->set_pattern("%v");
+            for (long i = 0;; i++)
+            {
+                logger->info("seq {}", i);
+            }
+        }
+        usleep(50000 + round * 30000);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        {
+            // recovers the interrupted segment
+            spdlog::sinks::mmap_rotating_file_sink_st sink("logs/mmap_check.log", 256 * 1024, max_files);
+        }
+        auto all = read_all(max_files);
+        if (all.empty() || !is_consecutive(all))
+        {
+            fprintf(stderr, "crash round %d left broken records (%zu)\n", round, all.size());
+            return 1;
+        }
+        printf("crash round %d: %zu records recovered\n", round, all.size());
+    }
+    remove_check_files(max_files);
+
+    auto rotating = spdlog::rotating_logger_st("rotating", "logs/rotating_bench.log", 64 * 1024 * 1024, 2);
+    auto mapped = spdlog::mmap_rotating_logger_st("mmap", "logs/mmap_bench.log", 64 * 1024 * 1024, 2);
+    bench("rotating", iters, [&](size_t i) { rotating->info("order {} px {:.2f} qty {}", i, 3500.0 + (i & 7), 10); });
+    bench("mmap", iters, [&](size_t i) { mapped->info("order {} px {:.2f} qty {}", i, 3500.0 + (i & 7), 10); });
+    rotating->flush_on(spdlog::level::info);
+    mapped->flush_on(spdlog::level::info);
+    bench("rotating+flush", iters, [&](size_t i) { rotating->info("order {} px {:.2f} qty {}", i, 3500.0 + (i & 7), 10); });
+    bench("mmap+flush", iters, [&](size_t i) { mapped->info("order {} px {:.2f} qty {}", i, 3500.0 + (i & 7), 10); });
+    return 0;
+}
@@ -49,6 +49,20 @@ SPDLOG_INLINE void spdlog::async_logger::flush_()
     }
 }
 
+// send the raw arguments of a deferred message to the thread pool,
+// flush_on is applied by the worker once the message has been formatted
+SPDLOG_INLINE void spdlog::async_logger::sink_deferred_(const details::log_msg &msg)
+{
+    if (auto pool_ptr = thread_pool_.lock())
+    {
+        pool_ptr->post_deferred_log(shared_from_this(), msg, overflow_policy_);
+    }
+    else
+    {
+        throw_spdlog_ex("async log: thread pool doesn't exist anymore");
+    }
+}
+
 //
 // backend functions - called from the thread pool to do the actual job
 //
@@ -72,6 +86,29 @@ SPDLOG_INLINE void spdlog::async_logger::backend_sink_it_(const details::log_msg
     }
 }
 
+SPDLOG_INLINE void spdlog::async_logger::backend_sink_deferred_(const details::log_msg &incoming_log_msg)
+{
+    memory_buf_t buf;
+    bool formatted_ok = false;
+    SPDLOG_TRY
+    {
+        details::format_deferred_payload(incoming_log_msg.payload, buf);
+        formatted_ok = true;
+    }
+    SPDLOG_LOGGER_CATCH()
+    if (formatted_ok)
+    {
+        details::log_msg formatted(incoming_log_msg);
+        formatted.payload = string_view_t(buf.data(), buf.size());
+        backend_sink_it_(formatted);
+    }
+    else if (should_flush_(incoming_log_msg))
+    {
+        // a message that failed to format still honours flush_on
+        backend_flush_();
+    }
+}
+
 SPDLOG_INLINE void spdlog::async_logger::backend_flush_()
 {
     for (auto &sink : sinks_)
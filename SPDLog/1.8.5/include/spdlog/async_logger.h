@@ -13,8 +13,13 @@
 //    space is available in the queue)
 // Upon destruction, logs all remaining messages in the queue before
 // destructing..
+//
+// log_deferred(..) skips formatting on the caller thread: the format string
+// pointer and the raw bytes of the arguments are copied into the queue and
+// fmt and the sinks' pattern formatter run on the thread pool worker.
 
 #include <spdlog/logger.h>
+#include <spdlog/details/deferred_args.h>
 
 namespace spdlog {
 
@@ -51,11 +56,51 @@ public:
 
     std::shared_ptr<logger> clone(std::string new_name) override;
 
+    // Arguments must be arithmetic or enum values (no pointers, strings or views, use log() for those)
+    // and fmt must be a compile-time string, FMT_STRING("..."), so that it outlives the queue;
+    // SPDLOG_LOGGER_DEFERRED wraps the literal and the source location.
+    // With SPDLOG_COMPILED_LIB the prebuilt thread pool cannot format deferred
+    // messages, so this falls back to formatting on the caller thread.
+    template<typename S, typename... Args, typename std::enable_if<fmt::is_compile_string<S>::value, int>::type = 0>
+    void log_deferred(source_loc loc, level::level_enum lvl, const S &fmt, const Args &... args)
+    {
+        static_assert(details::deferred_args_capturable<Args...>::value,
+            "log_deferred() arguments must be arithmetic or enum values, use log() for strings and other types");
+        string_view_t fmt_view = fmt;
+#ifdef SPDLOG_HEADER_ONLY
+        bool log_enabled = should_log(lvl);
+        if (!log_enabled || tracer_.enabled())
+        {
+            // the backtrace ring stores formatted messages
+            log(loc, lvl, fmt_view, args...);
+            return;
+        }
+        SPDLOG_TRY
+        {
+            char payload[details::deferred_payload<Args...>::size];
+            details::deferred_payload<Args...>::pack(payload, fmt_view, args...);
+            details::log_msg log_msg(loc, name_, lvl, string_view_t(payload, sizeof(payload)));
+            sink_deferred_(log_msg);
+        }
+        SPDLOG_LOGGER_CATCH()
+#else
+        log(loc, lvl, fmt_view, args...);
+#endif
+    }
+
+    template<typename S, typename... Args, typename std::enable_if<fmt::is_compile_string<S>::value, int>::type = 0>
+    void log_deferred(level::level_enum lvl, const S &fmt, const Args &... args)
+    {
+        log_deferred(source_loc{}, lvl, fmt, args...);
+    }
+
 protected:
     void sink_it_(const details::log_msg &msg) override;
     void flush_() override;
     void backend_sink_it_(const details::log_msg &incoming_log_msg);
     void backend_flush_();
+    void sink_deferred_(const details::log_msg &msg);
+    void backend_sink_deferred_(const details::log_msg &incoming_log_msg);
 
 private:
     std::weak_ptr<details::thread_pool> thread_pool_;
@@ -63,6 +108,9 @@ private:
 };
 } // namespace spdlog
 
+#define SPDLOG_LOGGER_DEFERRED(logger, level, fmt, ...)                                                                                    \
+    (logger)->log_deferred(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, level, FMT_STRING(fmt), ##__VA_ARGS__)
+
 #ifdef SPDLOG_HEADER_ONLY
 #include "async_logger-inl.h"
 #endif
@@ -0,0 +1,116 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Raw argument capture for deferred formatting (async_logger::log_deferred).
+// The caller copies the format string view and the bytes of each argument into
+// the message payload; the thread pool worker decodes them and runs fmt there.
+// The format string itself is not copied, so it must have static storage
+// (async_logger::log_deferred only accepts FMT_STRING literals).
+//
+// payload layout: [deferred_format_fn][string_view_t fmt][arg0][arg1]...
+// arguments are stored unaligned and read back with memcpy.
+
+#include <spdlog/common.h>
+
+#include <cstring>
+#include <type_traits>
+
+namespace spdlog {
+namespace details {
+
+// formats a deferred payload into dest
+using deferred_format_fn = void (*)(string_view_t payload, memory_buf_t &dest);
+
+// Only arithmetic and enum values are captured. Anything else that is trivially
+// copyable may still refer to caller memory (string_view_t, structs holding a
+// const char *) and would dangle by the time the worker formats it.
+template<typename... Args>
+struct deferred_args_capturable : std::true_type
+{};
+
+template<typename T, typename... Rest>
+struct deferred_args_capturable<T, Rest...>
+    : std::integral_constant<bool, (std::is_arithmetic<T>::value || std::is_enum<T>::value) && deferred_args_capturable<Rest...>::value>
+{};
+
+template<typename... Args>
+struct deferred_args_size : std::integral_constant<size_t, 0>
+{};
+
+template<typename T, typename... Rest>
+struct deferred_args_size<T, Rest...> : std::integral_constant<size_t, sizeof(T) + deferred_args_size<Rest...>::value>
+{};
+
+template<typename... Args>
+struct deferred_args;
+
+template<>
+struct deferred_args<>
+{
+    static void pack(char *) {}
+
+    template<typename... Done>
+    static void format(const char *, memory_buf_t &dest, string_view_t fmt, const Done &... done)
+    {
+        fmt::format_to(dest, fmt, done...);
+    }
+};
+
+template<typename T, typename... Rest>
+struct deferred_args<T, Rest...>
+{
+    static void pack(char *dest, const T &value, const Rest &... rest)
+    {
+        std::memcpy(dest, &value, sizeof(T));
+        deferred_args<Rest...>::pack(dest + sizeof(T), rest...);
+    }
+
+    template<typename... Done>
+    static void format(const char *data, memory_buf_t &dest, string_view_t fmt, const Done &... done)
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type raw;
+        std::memcpy(&raw, data, sizeof(T));
+        deferred_args<Rest...>::format(data + sizeof(T), dest, fmt, done..., *reinterpret_cast<const T *>(&raw));
+    }
+};
+
+template<typename... Args>
+struct deferred_payload
+{
+    static constexpr size_t header_size = sizeof(deferred_format_fn) + sizeof(string_view_t);
+    static constexpr size_t size = header_size + deferred_args_size<Args...>::value;
+
+    static void pack(char *dest, string_view_t fmt, const Args &... args)
+    {
+        deferred_format_fn fn = &deferred_payload::format;
+        std::memcpy(dest, &fn, sizeof(fn));
+        std::memcpy(dest + sizeof(fn), &fmt, sizeof(fmt));
+        deferred_args<Args...>::pack(dest + header_size, args...);
+    }
+
+    static void format(string_view_t payload, memory_buf_t &dest)
+    {
+        string_view_t fmt;
+        std::memcpy(&fmt, payload.data() + sizeof(deferred_format_fn), sizeof(fmt));
+        deferred_args<Args...>::format(payload.data() + header_size, dest, fmt);
+    }
+};
+
+template<typename... Args>
+constexpr size_t deferred_payload<Args...>::header_size;
+
+template<typename... Args>
+constexpr size_t deferred_payload<Args...>::size;
+
+// format a payload produced by deferred_payload<Args...>::pack
+inline void format_deferred_payload(string_view_t payload, memory_buf_t &dest)
+{
+    deferred_format_fn fn;
+    std::memcpy(&fn, payload.data(), sizeof(fn));
+    fn(payload, dest);
+}
+
+} // namespace details
+} // namespace spdlog
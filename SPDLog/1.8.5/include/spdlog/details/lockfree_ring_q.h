@@ -0,0 +1,250 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// bounded lock-free queue for the async thread pool (enabled by SPDLOG_LOCKFREE_ASYNC_QUEUE).
+// Drop-in replacement for mpmc_blocking_queue without mutex or condition variables:
+// enqueue(..) - spin, yield and finally sleep until room found to put the new message.
+// enqueue_nowait(..) - overrun oldest message in the queue if no room left.
+// dequeue_for(..) - poll with adaptive backoff until the queue is not empty or timeout have
+// passed.
+// dequeue_bulk(..) - like dequeue_for(..), but drain up to max_items messages at once.
+//
+// Based on the bounded queue of Dmitry Vyukov: every cell carries a sequence number that
+// tells producers and the consumer whether it is free or holds a message.
+// Tuned for many producers and a single worker thread; the dequeue side uses a CAS as well,
+// so producers can discard the oldest message on overrun and several workers stay correct.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace spdlog {
+namespace details {
+
+template<typename T>
+class lockfree_ring_queue
+{
+public:
+    using item_type = T;
+
+    // max_items is rounded up to a power of 2
+    explicit lockfree_ring_queue(size_t max_items)
+    {
+        size_t capacity = 2;
+        while (capacity < max_items)
+        {
+            capacity <<= 1;
+        }
+        mask_ = capacity - 1;
+        buffer_.reset(new cell[capacity]);
+        for (size_t i = 0; i < capacity; i++)
+        {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+        overrun_counter_.store(0, std::memory_order_relaxed);
+    }
+
+    lockfree_ring_queue(const lockfree_ring_queue &) = delete;
+    lockfree_ring_queue &operator=(const lockfree_ring_queue &) = delete;
+
+    // try to enqueue and block if no room left
+    void enqueue(T &&item)
+    {
+        size_t attempt = 0;
+        while (!try_enqueue_(std::move(item)))
+        {
+            backoff_(attempt, max_producer_sleep);
+        }
+    }
+
+    // enqueue immediately. overrun oldest message in the queue if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        size_t attempt = 0;
+        while (!try_enqueue_(std::move(item)))
+        {
+            T discarded;
+            if (try_dequeue_(discarded))
+            {
+                overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                // the oldest slot is still being written or read by another thread
+                backoff_(attempt, max_producer_sleep);
+            }
+        }
+    }
+
+    // try to dequeue item. if no item found. wait upto timeout and try again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        return dequeue_bulk(&popped_item, 1, wait_duration) == 1;
+    }
+
+    // dequeue up to max_items into items[], waiting up to timeout for the first one.
+    // Return the number of dequeued items.
+    size_t dequeue_bulk(T *items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        size_t count = 0;
+        while (count < max_items && try_dequeue_(items[count]))
+        {
+            count++;
+        }
+        if (count > 0)
+        {
+            return count;
+        }
+
+        // adaptive wait: spin, then yield, then sleep with growing intervals
+        auto deadline = std::chrono::steady_clock::now() + wait_duration;
+        size_t attempt = 0;
+        while (!try_dequeue_(items[0]))
+        {
+            backoff_(attempt, max_consumer_sleep);
+            if ((attempt & 15) == 0 && std::chrono::steady_clock::now() >= deadline)
+            {
+                return 0;
+            }
+        }
+        count = 1;
+        while (count < max_items && try_dequeue_(items[count]))
+        {
+            count++;
+        }
+        return count;
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+private:
+    static constexpr size_t cache_line_size = 64;
+    static constexpr size_t spin_attempts = 64;
+    static constexpr size_t yield_attempts = 128;
+    static constexpr std::chrono::microseconds max_producer_sleep{100};
+    static constexpr std::chrono::microseconds max_consumer_sleep{1000};
+
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    bool try_enqueue_(T &&item)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell *target;
+        for (;;)
+        {
+            target = &buffer_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (dif < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        target->data = std::move(item);
+        target->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_dequeue_(T &popped_item)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell *target;
+        for (;;)
+        {
+            target = &buffer_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (dif == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (dif < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        popped_item = std::move(target->data);
+        target->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    static void backoff_(size_t &attempt, std::chrono::microseconds max_sleep)
+    {
+        if (attempt < spin_attempts)
+        {
+#if defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause();
+#endif
+        }
+        else if (attempt < yield_attempts)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            // sleep interval doubles every 16 attempts, capped at max_sleep
+            size_t shift = (attempt - yield_attempts) / 16;
+            auto interval = std::chrono::microseconds(1) * (shift < 10 ? (1 << shift) : 1024);
+            std::this_thread::sleep_for(interval < max_sleep ? interval : max_sleep);
+        }
+        attempt++;
+    }
+
+    // producers and the worker update different positions, keep them on separate cache lines
+    using pad_t = char[cache_line_size - sizeof(std::atomic<size_t>)];
+
+    std::atomic<size_t> enqueue_pos_;
+    pad_t pad0_;
+    std::atomic<size_t> dequeue_pos_;
+    pad_t pad1_;
+    std::atomic<size_t> overrun_counter_;
+    pad_t pad2_;
+    size_t mask_;
+    std::unique_ptr<cell[]> buffer_;
+};
+
+template<typename T>
+constexpr std::chrono::microseconds lockfree_ring_queue<T>::max_producer_sleep;
+
+template<typename T>
+constexpr std::chrono::microseconds lockfree_ring_queue<T>::max_consumer_sleep;
+
+} // namespace details
+} // namespace spdlog
@@ -10,6 +10,10 @@
 #include <spdlog/common.h>
 #include <cassert>
 
+#if defined(SPDLOG_LOCKFREE_ASYNC_QUEUE) && defined(SPDLOG_COMPILED_LIB)
+#error "SPDLOG_LOCKFREE_ASYNC_QUEUE changes the thread_pool layout and requires the header only version"
+#endif
+
 namespace spdlog {
 namespace details {
 
@@ -58,6 +62,13 @@ void SPDLOG_INLINE thread_pool::post_log(async_logger_ptr &&worker_ptr, const de
     post_async_msg_(std::move(async_m), overflow_policy);
 }
 
+void SPDLOG_INLINE thread_pool::post_deferred_log(
+    async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy)
+{
+    async_msg async_m(std::move(worker_ptr), async_msg_type::deferred_log, msg);
+    post_async_msg_(std::move(async_m), overflow_policy);
+}
+
 void SPDLOG_INLINE thread_pool::post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy)
 {
     post_async_msg_(async_msg(std::move(worker_ptr), async_msg_type::flush), overflow_policy);
@@ -82,7 +93,12 @@ void SPDLOG_INLINE thread_pool::post_async_msg_(async_msg &&new_msg, async_overf
 
 void SPDLOG_INLINE thread_pool::worker_loop_()
 {
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+    std::vector<async_msg> batch(batch_size);
+    while (process_next_batch_(batch)) {}
+#else
     while (process_next_msg_()) {}
+#endif
 }
 
 // process next message in the queue
@@ -103,6 +119,10 @@ bool SPDLOG_INLINE thread_pool::process_next_msg_()
         incoming_async_msg.worker_ptr->backend_sink_it_(incoming_async_msg);
         return true;
     }
+    case async_msg_type::deferred_log: {
+        incoming_async_msg.worker_ptr->backend_sink_deferred_(incoming_async_msg);
+        return true;
+    }
     case async_msg_type::flush: {
         incoming_async_msg.worker_ptr->backend_flush_();
         return true;
@@ -120,5 +140,53 @@ bool SPDLOG_INLINE thread_pool::process_next_msg_()
     return true;
 }
 
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+bool SPDLOG_INLINE thread_pool::process_next_batch_(std::vector<async_msg> &batch)
+{
+    size_t count = q_.dequeue_bulk(batch.data(), batch.size(), std::chrono::seconds(10));
+    size_t terminate_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        async_msg &incoming_async_msg = batch[i];
+        switch (incoming_async_msg.msg_type)
+        {
+        case async_msg_type::log: {
+            incoming_async_msg.worker_ptr->backend_sink_it_(incoming_async_msg);
+            break;
+        }
+        case async_msg_type::deferred_log: {
+            incoming_async_msg.worker_ptr->backend_sink_deferred_(incoming_async_msg);
+            break;
+        }
+        case async_msg_type::flush: {
+            // consecutive flush requests of the same logger are served once
+            bool repeated = i + 1 < count && batch[i + 1].msg_type == async_msg_type::flush &&
+                            batch[i + 1].worker_ptr == incoming_async_msg.worker_ptr;
+            if (!repeated)
+            {
+                incoming_async_msg.worker_ptr->backend_flush_();
+            }
+            break;
+        }
+        case async_msg_type::terminate: {
+            terminate_count++;
+            break;
+        }
+        default: {
+            assert(false);
+        }
+        }
+        // release the logger now, the slot may stay unused for a long time
+        incoming_async_msg.worker_ptr.reset();
+    }
+    // one terminate msg per worker: hand back the ones this worker drained for the others
+    for (size_t i = 1; i < terminate_count; i++)
+    {
+        post_async_msg_(async_msg(async_msg_type::terminate), async_overflow_policy::block);
+    }
+    return terminate_count == 0;
+}
+#endif
+
 } // namespace details
 } // namespace spdlog
@@ -4,7 +4,11 @@
 #pragma once
 
 #include <spdlog/details/log_msg_buffer.h>
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+#include <spdlog/details/lockfree_ring_q.h>
+#else
 #include <spdlog/details/mpmc_blocking_q.h>
+#endif
 #include <spdlog/details/os.h>
 
 #include <chrono>
@@ -24,7 +28,8 @@ enum class async_msg_type
 {
     log,
     flush,
-    terminate
+    terminate,
+    deferred_log // payload holds raw arguments, formatted by the worker (see deferred_args.h)
 };
 
 #include <spdlog/details/log_msg_buffer.h>
@@ -83,7 +88,13 @@ class SPDLOG_API thread_pool
 {
 public:
     using item_type = async_msg;
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+    using q_type = details::lockfree_ring_queue<item_type>;
+    // max messages the worker drains from the queue per wakeup
+    static constexpr size_t batch_size = 64;
+#else
     using q_type = details::mpmc_blocking_queue<item_type>;
+#endif
 
     thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start);
     thread_pool(size_t q_max_items, size_t threads_n);
@@ -95,6 +106,7 @@ public:
     thread_pool &operator=(thread_pool &&) = delete;
 
     void post_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy);
+    void post_deferred_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy);
     void post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy);
     size_t overrun_counter();
 
@@ -110,6 +122,12 @@ private:
     // return true if this thread should still be active (while no terminate msg
     // was received)
     bool process_next_msg_();
+
+#ifdef SPDLOG_LOCKFREE_ASYNC_QUEUE
+    // process a batch of messages drained from the queue in one go
+    // return false if a terminate msg was received
+    bool process_next_batch_(std::vector<async_msg> &batch);
+#endif
 };
 
 } // namespace details
@@ -0,0 +1,497 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#ifdef _WIN32
+#error "mmap_rotating_file_sink is only available on POSIX systems"
+#endif
+
+#include <spdlog/common.h>
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/os.h>
+#include <spdlog/details/synchronous_factory.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace spdlog {
+namespace sinks {
+
+//
+// Rotating file sink based on size, writing through a shared memory mapping.
+//
+// Each segment is preallocated to max_size (rounded up to whole pages) and mapped MAP_SHARED;
+// records are appended with memcpy and written back by the kernel, so sink_it_ and flush_
+// make no syscalls. On roll the logging thread switches to a spare segment prepared in the
+// background and hands the full one to the rotation thread, which truncates it to the real
+// length and renames the files:
+// log.txt -> log.1.txt
+// log.1.txt -> log.2.txt
+// log.next.txt -> log.txt
+// Until that rename completes the new records are in log.next.txt.
+//
+// Crash safety: the mapped pages belong to the page cache, so after kill -9 everything already
+// copied is in the file, followed by the zero filled tail of the segment. The last byte of a
+// record is stored after the rest of it, and on open the sink cuts a zero filled file back to
+// the last '\n' before the zeros (records must end with the default '\n' eol for this).
+// Power loss is not covered: only the kernel writeback has happened by then.
+//
+template<typename Mutex>
+class mmap_rotating_file_sink final : public base_sink<Mutex>
+{
+public:
+    mmap_rotating_file_sink(filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open = false)
+        : base_filename_(std::move(base_filename))
+        , max_size_(max_size)
+        , max_files_(max_files)
+        , spare_filename_(calc_spare_filename(base_filename_))
+    {
+        if (max_size == 0)
+        {
+            throw_spdlog_ex("mmap_rotating_file_sink: max_size must be greater than 0");
+        }
+        size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        // at least one zero byte always follows the last record
+        capacity_ = (max_size_ + page_size) / page_size * page_size;
+
+        details::os::create_dir(details::os::dir_name(base_filename_));
+        recover_spare_();
+        if (rotate_on_open && details::os::path_exists(base_filename_) && finalize_file_(base_filename_) > 0)
+        {
+            std::string error;
+            if (!rotate_files_(error))
+            {
+                throw_spdlog_ex(error, errno);
+            }
+        }
+        open_segment_(base_filename_, false, active_);
+        spare_wanted_ = true;
+        worker_ = std::thread([this] { worker_loop_(); });
+    }
+
+    ~mmap_rotating_file_sink() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(rotation_mutex_);
+            stop_ = true;
+        }
+        rotation_cv_.notify_all();
+        if (worker_.joinable())
+        {
+            worker_.join();
+        }
+        close_segment_(active_);
+        if (spare_.data != nullptr)
+        {
+            close_segment_(spare_);
+            details::os::remove(spare_filename_);
+        }
+    }
+
+    mmap_rotating_file_sink(const mmap_rotating_file_sink &) = delete;
+    mmap_rotating_file_sink &operator=(const mmap_rotating_file_sink &) = delete;
+
+    // calc filename according to index and file extension if exists.
+    // e.g. calc_filename("logs/mylog.txt, 3) => "logs/mylog.3.txt".
+    static filename_t calc_filename(const filename_t &filename, std::size_t index)
+    {
+        if (index == 0u)
+        {
+            return filename;
+        }
+
+        filename_t basename, ext;
+        std::tie(basename, ext) = details::file_helper::split_by_extension(filename);
+        return fmt::format(SPDLOG_FILENAME_T("{}.{}{}"), basename, index, ext);
+    }
+
+    // e.g. calc_spare_filename("logs/mylog.txt") => "logs/mylog.next.txt".
+    static filename_t calc_spare_filename(const filename_t &filename)
+    {
+        filename_t basename, ext;
+        std::tie(basename, ext) = details::file_helper::split_by_extension(filename);
+        return fmt::format(SPDLOG_FILENAME_T("{}.next{}"), basename, ext);
+    }
+
+    // length of the complete records in a mapped file of the given size.
+    // a file that does not end with zeros was closed properly (or written by someone else) and is kept.
+    static size_t recover_length(const char *data, size_t size)
+    {
+        if (size == 0 || data[size - 1] != '\0')
+        {
+            return size;
+        }
+        size_t end = size;
+        while (end >= sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, data + end - sizeof(word), sizeof(word));
+            if (word != 0)
+            {
+                break;
+            }
+            end -= sizeof(word);
+        }
+        while (end > 0 && data[end - 1] == '\0')
+        {
+            end--;
+        }
+        while (end > 0 && data[end - 1] != '\n')
+        {
+            end--;
+        }
+        return end;
+    }
+
+    filename_t filename()
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+        return base_filename_;
+    }
+
+    // number of completed background rotations
+    size_t rotations() const
+    {
+        return rotations_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        memory_buf_t formatted;
+        base_sink<Mutex>::formatter_->format(msg, formatted);
+        size_t n = formatted.size();
+        if (n == 0)
+        {
+            return;
+        }
+        if (n >= capacity_)
+        {
+            throw_spdlog_ex("mmap_rotating_file_sink: record larger than the segment size");
+        }
+        std::string rotation_error;
+        if (active_.size + n > max_size_ && active_.size > 0)
+        {
+            rotation_error = roll_();
+        }
+        char *dest = active_.data + active_.size;
+        std::memcpy(dest, formatted.data(), n - 1);
+        // the eol must not become visible before the rest of the record. a release fence orders the
+        // stores on weakly ordered CPUs too (ARM, POWER), on x86 it only restrains the compiler
+        std::atomic_thread_fence(std::memory_order_release);
+        dest[n - 1] = formatted.data()[n - 1];
+        active_.size += n;
+        if (!rotation_error.empty())
+        {
+            throw_spdlog_ex(rotation_error);
+        }
+    }
+
+    void flush_() override
+    {
+        // records are in the page cache as soon as they are copied, writeback is left to the kernel
+    }
+
+private:
+    struct segment
+    {
+        int fd = -1;
+        char *data = nullptr;
+        size_t capacity = 0;
+        size_t size = 0;
+    };
+
+    // map path preallocated to the segment capacity, recovering the existing content unless truncate.
+    void open_segment_(const filename_t &path, bool truncate, segment &seg)
+    {
+        using details::os::filename_to_str;
+        int flags = O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        int fd = ::open(path.c_str(), flags, 0644);
+        if (fd == -1)
+        {
+            throw_spdlog_ex("mmap_rotating_file_sink: failed opening file " + filename_to_str(path), errno);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw_spdlog_ex("mmap_rotating_file_sink: failed getting file size of " + filename_to_str(path), errno);
+        }
+        size_t existing = static_cast<size_t>(st.st_size);
+        size_t capacity = capacity_;
+        if (existing >= capacity)
+        {
+            capacity = existing + 1;
+        }
+        // reserve the blocks up front, writing into a hole of a full disk would raise SIGBUS
+        int rc = ::posix_fallocate(fd, 0, static_cast<off_t>(capacity));
+        if (rc != 0)
+        {
+            ::close(fd);
+            throw_spdlog_ex("mmap_rotating_file_sink: failed preallocating " + filename_to_str(path), rc);
+        }
+        int map_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        map_flags |= MAP_POPULATE;
+#endif
+        void *data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, map_flags, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            throw_spdlog_ex("mmap_rotating_file_sink: failed mapping " + filename_to_str(path), errno);
+        }
+        seg.fd = fd;
+        seg.data = static_cast<char *>(data);
+        seg.capacity = capacity;
+        seg.size = recover_length(seg.data, existing);
+    }
+
+    // unmap and cut the file to the real length
+    static void close_segment_(segment &seg)
+    {
+        if (seg.data == nullptr)
+        {
+            return;
+        }
+        ::munmap(seg.data, seg.capacity);
+        (void)::ftruncate(seg.fd, static_cast<off_t>(seg.size));
+        ::close(seg.fd);
+        seg = segment();
+    }
+
+    // cut a file left by a previous run to its complete records, return the new length.
+    static size_t finalize_file_(const filename_t &path)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return 0;
+        }
+        struct stat st;
+        size_t length = 0;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            size_t size = static_cast<size_t>(st.st_size);
+            void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                length = recover_length(static_cast<const char *>(data), size);
+                ::munmap(data, size);
+                if (length != size)
+                {
+                    (void)::ftruncate(fd, static_cast<off_t>(length));
+                }
+            }
+        }
+        ::close(fd);
+        return length;
+    }
+
+    // a spare segment with records means the previous run died before its rotation finished.
+    void recover_spare_()
+    {
+        if (!details::os::path_exists(spare_filename_))
+        {
+            return;
+        }
+        if (finalize_file_(spare_filename_) == 0)
+        {
+            details::os::remove(spare_filename_);
+            return;
+        }
+        finalize_file_(base_filename_);
+        std::string error;
+        if (!rotate_files_(error))
+        {
+            throw_spdlog_ex(error, errno);
+        }
+    }
+
+    // switch to the spare segment, waiting for the rotation thread to prepare it if needed.
+    // return the error of the previous background rotation, if any.
+    std::string roll_()
+    {
+        std::unique_lock<std::mutex> lock(rotation_mutex_);
+        rotation_cv_.wait(lock, [this] { return spare_.data != nullptr || !rotation_error_.empty(); });
+        if (spare_.data == nullptr)
+        {
+            // keep writing into the current segment, try again on the next roll
+            std::string error;
+            error.swap(rotation_error_);
+            spare_wanted_ = true;
+            lock.unlock();
+            rotation_cv_.notify_all();
+            throw_spdlog_ex(error);
+        }
+        retired_ = active_;
+        active_ = spare_;
+        spare_ = segment();
+        spare_wanted_ = true;
+        std::string error;
+        error.swap(rotation_error_);
+        lock.unlock();
+        rotation_cv_.notify_all();
+        return error;
+    }
+
+    void worker_loop_()
+    {
+        std::unique_lock<std::mutex> lock(rotation_mutex_);
+        for (;;)
+        {
+            rotation_cv_.wait(lock, [this] { return stop_ || retired_.data != nullptr || (spare_wanted_ && spare_.data == nullptr); });
+            if (retired_.data != nullptr)
+            {
+                segment retired = retired_;
+                retired_ = segment();
+                lock.unlock();
+                close_segment_(retired);
+                std::string error;
+                bool ok = rotate_files_(error);
+                lock.lock();
+                if (!ok)
+                {
+                    rotation_error_ = error;
+                }
+                rotations_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (stop_)
+            {
+                return;
+            }
+            // spare segment
+            lock.unlock();
+            segment spare;
+            std::string error;
+            try
+            {
+                open_segment_(spare_filename_, true, spare);
+            }
+            catch (const spdlog_ex &ex)
+            {
+                error = ex.what();
+            }
+            lock.lock();
+            if (spare.data != nullptr)
+            {
+                spare_ = spare;
+            }
+            else
+            {
+                rotation_error_ = error;
+                spare_wanted_ = false;
+            }
+            rotation_cv_.notify_all();
+        }
+    }
+
+    // Rotate files:
+    // log.txt -> log.1.txt
+    // log.1.txt -> log.2.txt
+    // log.2.txt -> log.3.txt
+    // log.3.txt -> delete
+    // log.next.txt -> log.txt
+    bool rotate_files_(std::string &error)
+    {
+        using details::os::filename_to_str;
+        using details::os::path_exists;
+        if (max_files_ == 0)
+        {
+            (void)details::os::remove(base_filename_);
+        }
+        for (auto i = max_files_; i > 0; --i)
+        {
+            filename_t src = calc_filename(base_filename_, i - 1);
+            if (!path_exists(src))
+            {
+                continue;
+            }
+            filename_t target = calc_filename(base_filename_, i);
+            if (!rename_file_(src, target))
+            {
+                details::os::sleep_for_millis(100);
+                if (!rename_file_(src, target))
+                {
+                    error = "mmap_rotating_file_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target);
+                    // the records must not stay under the spare name
+                    (void)details::os::remove(base_filename_);
+                    break;
+                }
+            }
+        }
+        if (path_exists(spare_filename_) && details::os::rename(spare_filename_, base_filename_) != 0)
+        {
+            error = "mmap_rotating_file_sink: failed renaming " + filename_to_str(spare_filename_) + " to " +
+                    filename_to_str(base_filename_);
+        }
+        return error.empty();
+    }
+
+    // delete the target if exists, and rename the src file  to target
+    // return true on success, false otherwise.
+    static bool rename_file_(const filename_t &src_filename, const filename_t &target_filename)
+    {
+        (void)details::os::remove(target_filename);
+        return details::os::rename(src_filename, target_filename) == 0;
+    }
+
+    filename_t base_filename_;
+    std::size_t max_size_;
+    std::size_t max_files_;
+    filename_t spare_filename_;
+    std::size_t capacity_ = 0;
+
+    // written by the logging thread only
+    segment active_;
+
+    // shared with the rotation thread
+    std::mutex rotation_mutex_;
+    std::condition_variable rotation_cv_;
+    segment spare_;
+    segment retired_;
+    bool spare_wanted_ = false;
+    bool stop_ = false;
+    std::string rotation_error_;
+    std::atomic<size_t> rotations_{0};
+    std::thread worker_;
+};
+
+using mmap_rotating_file_sink_mt = mmap_rotating_file_sink<std::mutex>;
+using mmap_rotating_file_sink_st = mmap_rotating_file_sink<details::null_mutex>;
+
+} // namespace sinks
+
+//
+// factory functions
+//
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> mmap_rotating_logger_mt(
+    const std::string &logger_name, const filename_t &filename, size_t max_file_size, size_t max_files, bool rotate_on_open = false)
+{
+    return Factory::template create<sinks::mmap_rotating_file_sink_mt>(logger_name, filename, max_file_size, max_files, rotate_on_open);
+}
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> mmap_rotating_logger_st(
+    const std::string &logger_name, const filename_t &filename, size_t max_file_size, size_t max_files, bool rotate_on_open = false)
+{
+    return Factory::template create<sinks::mmap_rotating_file_sink_st>(logger_name, filename, max_file_size, max_files, rotate_on_open);
+}
+} // namespace spdlog
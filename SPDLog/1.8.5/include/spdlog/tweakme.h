@@ -114,3 +114,12 @@
 //
 // #define SPDLOG_FUNCTION __PRETTY_FUNCTION__
 ///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to back the async thread pool with a bounded lock-free queue instead
+// of the mutex/condition variable based mpmc_blocking_queue.
+// Producers never take a lock, the worker polls with adaptive backoff and drains
+// messages in batches. Requires the header only version (not SPDLOG_COMPILED_LIB).
+//
+// #define SPDLOG_LOCKFREE_ASYNC_QUEUE
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,134 @@
+#ifndef INSTRUMENTINDEX_HPP
+#define INSTRUMENTINDEX_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace TradeUtil
+{
+
+// 合约代码到稠密序号的映射，序号从0开始连续分配
+// 仅在初始化或收到新合约时注册，热路径上应缓存返回的序号，不再做字符串查找
+class InstrumentIndex
+{
+public:
+    enum
+    {
+        INSTRUMENT_ID_LEN = 32,
+        INVALID_SLOT = -1
+    };
+
+    explicit InstrumentIndex(int capacity = 4096)
+    {
+        m_Capacity = capacity;
+        // 开放寻址表容量取2的幂，负载因子不超过0.5
+        m_BucketCount = 1;
+        while(m_BucketCount < capacity * 2)
+        {
+            m_BucketCount <<= 1;
+        }
+        m_Buckets = (int*)malloc(sizeof(int) * m_BucketCount);
+        for(int i = 0; i < m_BucketCount; i++)
+        {
+            m_Buckets[i] = INVALID_SLOT;
+        }
+        m_Keys = (TKey*)calloc(capacity, sizeof(TKey));
+        m_Count = 0;
+    }
+
+    ~InstrumentIndex()
+    {
+        free(m_Buckets);
+        free(m_Keys);
+    }
+
+    // 注册合约，已存在则返回原序号，容量满返回INVALID_SLOT
+    int Register(const char* instrumentID)
+    {
+        uint32_t mask = m_BucketCount - 1;
+        uint32_t pos = Hash(instrumentID) & mask;
+        while(m_Buckets[pos] != INVALID_SLOT)
+        {
+            if(strncmp(m_Keys[m_Buckets[pos]].ID, instrumentID, INSTRUMENT_ID_LEN) == 0)
+            {
+                return m_Buckets[pos];
+            }
+            pos = (pos + 1) & mask;
+        }
+        if(m_Count >= m_Capacity)
+        {
+            return INVALID_SLOT;
+        }
+        int slot = m_Count++;
+        size_t length = strnlen(instrumentID, INSTRUMENT_ID_LEN - 1);
+        memcpy(m_Keys[slot].ID, instrumentID, length);
+        m_Keys[slot].ID[length] = '\0';
+        m_Buckets[pos] = slot;
+        return slot;
+    }
+
+    // 查找合约序号，不存在返回INVALID_SLOT
+    force_inline inline int Find(const char* instrumentID) const
+    {
+        uint32_t mask = m_BucketCount - 1;
+        uint32_t pos = Hash(instrumentID) & mask;
+        while(m_Buckets[pos] != INVALID_SLOT)
+        {
+            if(strncmp(m_Keys[m_Buckets[pos]].ID, instrumentID, INSTRUMENT_ID_LEN) == 0)
+            {
+                return m_Buckets[pos];
+            }
+            pos = (pos + 1) & mask;
+        }
+        return INVALID_SLOT;
+    }
+
+    const char* GetInstrumentID(int slot) const
+    {
+        return (slot >= 0 && slot < m_Count) ? m_Keys[slot].ID : NULL;
+    }
+
+    int Size() const
+    {
+        return m_Count;
+    }
+
+    int Capacity() const
+    {
+        return m_Capacity;
+    }
+protected:
+    // FNV-1a
+    static force_inline inline uint32_t Hash(const char* key)
+    {
+        uint32_t hash = 2166136261u;
+        for(int i = 0; i < INSTRUMENT_ID_LEN && key[i] != '\0'; i++)
+        {
+            hash ^= (uint8_t)key[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+protected:
+    struct TKey
+    {
+        char ID[INSTRUMENT_ID_LEN];
+    };
+    int* m_Buckets;
+    TKey* m_Keys;
+    int m_BucketCount;
+    int m_Capacity;
+    int m_Count;
+private:
+    InstrumentIndex(const InstrumentIndex &);
+    InstrumentIndex &operator=(const InstrumentIndex &);
+};
+
+}
+
+#endif // INSTRUMENTINDEX_HPP
@@ -0,0 +1,584 @@
+#ifndef ORDERTABLE_HPP
+#define ORDERTABLE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace TradeUtil
+{
+
+// 统一订单状态，数值越大越接近终态
+enum EOrderStatus
+{
+    EORDER_NONE = 0,
+    EORDER_PENDING_NEW = 1,         // 已发出，柜台未确认
+    EORDER_ACCEPTED = 2,            // 柜台已接受
+    EORDER_EXCHANGE_ACCEPTED = 3,   // 交易所已接受，未成交
+    EORDER_PARTIAL_FILLED = 4,      // 部分成交，在队列中
+    EORDER_FILLED = 5,              // 全部成交
+    EORDER_PARTIAL_CANCELLED = 6,   // 部成部撤
+    EORDER_CANCELLED = 7,           // 已撤单
+    EORDER_REJECTED = 8,            // 柜台或交易所拒单
+    EORDER_STATUS_COUNT
+};
+
+// 订单快照，回调线程写入，策略线程通过seqlock无锁读取
+struct TOrderSnapshot
+{
+    uint64_t LocalID;           // 本地报单编号：CTP OrderRef、REM ClientOrderToken、XTP order_client_id、YD OrderRef
+    uint64_t VendorID;          // 柜台订单编号：CTP OrderSysID、REM MarketOrderToken、XTP order_xtp_id、YD OrderSysID
+    int32_t InstrumentSlot;
+    uint8_t Direction;
+    uint8_t Offset;
+    uint8_t Status;
+    uint8_t Reserved;
+    int32_t Volume;
+    int32_t TradedVolume;
+    int32_t CancelledVolume;
+    int32_t ErrorID;
+    double Price;
+    double TradeAmount;         // 成交金额，仅由成交回报累计
+    uint64_t UpdateNs;
+};
+
+struct alignas(64) TOrderSlot
+{
+    std::atomic<uint32_t> Sequence;
+    int32_t TradeVolume;        // 成交回报累计成交量，仅写线程使用
+    TOrderSnapshot Snapshot;
+};
+
+// 预分配订单表
+// 本地报单编号需由报单方递增分配，按编号低位直接定位槽位，无需哈希表和锁；
+// 柜台订单编号通过开放寻址表映射回本地编号，槽位复用时删除旧订单的映射，
+// 映射表占用不超过一半，未命中的查找在空位处结束。写操作只能在柜台回调线程执行，
+// Read可在任意线程调用
+class OrderTable
+{
+public:
+    enum
+    {
+        MAX_CAPACITY = 1 << 30      // 柜台编号映射表为两倍容量，须在uint32_t内
+    };
+
+    OrderTable(): m_Slots(NULL), m_Mask(0), m_VendorMap(NULL), m_VendorMask(0), m_FrontID(0), m_SessionID(0)
+    {
+    }
+
+    ~OrderTable()
+    {
+        free(m_Slots);
+        free(m_VendorMap);
+    }
+
+    // capacity向上取2的幂，应大于同时存活的订单数，超过MAX_CAPACITY返回false
+    bool Init(uint32_t capacity)
+    {
+        if(capacity > MAX_CAPACITY)
+        {
+            return false;
+        }
+        uint32_t size = 1;
+        while(size < capacity)
+        {
+            size <<= 1;
+        }
+        free(m_Slots);
+        free(m_VendorMap);
+        m_Slots = NULL;
+        m_VendorMap = NULL;
+        if(posix_memalign((void**)&m_Slots, 64, sizeof(TOrderSlot) * size) != 0)
+        {
+            return false;
+        }
+        memset((void*)m_Slots, 0, sizeof(TOrderSlot) * size);
+        m_Mask = size - 1;
+        m_VendorMap = (TVendorEntry*)calloc(size * 2, sizeof(TVendorEntry));
+        if(m_VendorMap == NULL)
+        {
+            return false;
+        }
+        m_VendorMask = size * 2 - 1;
+        return true;
+    }
+
+    // 报单发出时登记，槽位被未结束订单占用时返回false
+    bool OnInsert(uint64_t localID, int32_t instrumentSlot, uint8_t direction, uint8_t offset,
+                  double price, int32_t volume, uint64_t nowNs)
+    {
+        TOrderSlot& slot = m_Slots[localID & m_Mask];
+        const TOrderSnapshot& current = slot.Snapshot;
+        if(current.Status != EORDER_NONE && current.LocalID != localID && !IsFinished(current.Status))
+        {
+            return false;
+        }
+        if(current.VendorID != 0 && current.LocalID != localID)
+        {
+            EraseVendorID(current.VendorID, current.LocalID);
+        }
+        TOrderSnapshot snapshot;
+        memset(&snapshot, 0, sizeof(snapshot));
+        snapshot.LocalID = localID;
+        snapshot.InstrumentSlot = instrumentSlot;
+        snapshot.Direction = direction;
+        snapshot.Offset = offset;
+        snapshot.Status = EORDER_PENDING_NEW;
+        snapshot.Volume = volume;
+        snapshot.Price = price;
+        snapshot.UpdateNs = nowNs;
+        slot.TradeVolume = 0;
+        Publish(slot, snapshot);
+        return true;
+    }
+
+    // 订单状态回报，tradedVolume为柜台回报的累计成交量，vendorID为0表示未知
+    bool OnStatus(uint64_t localID, int status, int32_t tradedVolume, uint64_t vendorID, int32_t errorID, uint64_t nowNs)
+    {
+        TOrderSlot* slot = Locate(localID);
+        if(slot == NULL || status == EORDER_NONE)
+        {
+            return false;
+        }
+        TOrderSnapshot snapshot = slot->Snapshot;
+        if(tradedVolume > snapshot.TradedVolume)
+        {
+            snapshot.TradedVolume = tradedVolume;
+        }
+        // 状态码不区分是否有成交时按成交量修正
+        if(snapshot.TradedVolume > 0)
+        {
+            if(status == EORDER_ACCEPTED || status == EORDER_EXCHANGE_ACCEPTED)
+            {
+                status = EORDER_PARTIAL_FILLED;
+            }
+            else if(status == EORDER_CANCELLED)
+            {
+                status = EORDER_PARTIAL_CANCELLED;
+            }
+        }
+        bool changed = Transition(snapshot, status);
+        if(changed && (status == EORDER_PARTIAL_CANCELLED || status == EORDER_CANCELLED || status == EORDER_REJECTED))
+        {
+            snapshot.CancelledVolume = snapshot.Volume - snapshot.TradedVolume;
+        }
+        if(errorID != 0)
+        {
+            snapshot.ErrorID = errorID;
+        }
+        if(vendorID != 0 && snapshot.VendorID != vendorID)
+        {
+            if(snapshot.VendorID != 0)
+            {
+                EraseVendorID(snapshot.VendorID, localID);
+            }
+            snapshot.VendorID = vendorID;
+            MapVendorID(vendorID, localID);
+            changed = true;
+        }
+        if(!changed && tradedVolume <= slot->Snapshot.TradedVolume)
+        {
+            return false;
+        }
+        snapshot.UpdateNs = nowNs;
+        Publish(*slot, snapshot);
+        return true;
+    }
+
+    // 成交回报，成交金额总是累计，状态只前进不回退
+    bool OnTrade(uint64_t localID, int32_t volume, double price, uint64_t nowNs)
+    {
+        TOrderSlot* slot = Locate(localID);
+        if(slot == NULL)
+        {
+            return false;
+        }
+        TOrderSnapshot snapshot = slot->Snapshot;
+        slot->TradeVolume += volume;
+        snapshot.TradeAmount += volume * price;
+        if(slot->TradeVolume > snapshot.TradedVolume)
+        {
+            snapshot.TradedVolume = slot->TradeVolume;
+        }
+        Transition(snapshot, snapshot.TradedVolume >= snapshot.Volume ? EORDER_FILLED : EORDER_PARTIAL_FILLED);
+        snapshot.UpdateNs = nowNs;
+        Publish(*slot, snapshot);
+        return true;
+    }
+
+    // 撤单回报，cancelledVolume为本次撤销量
+    bool OnCancelled(uint64_t localID, int32_t cancelledVolume, uint64_t nowNs)
+    {
+        TOrderSlot* slot = Locate(localID);
+        if(slot == NULL)
+        {
+            return false;
+        }
+        TOrderSnapshot snapshot = slot->Snapshot;
+        snapshot.CancelledVolume += cancelledVolume;
+        if(snapshot.TradedVolume + snapshot.CancelledVolume >= snapshot.Volume)
+        {
+            Transition(snapshot, snapshot.TradedVolume > 0 ? EORDER_PARTIAL_CANCELLED : EORDER_CANCELLED);
+        }
+        snapshot.UpdateNs = nowNs;
+        Publish(*slot, snapshot);
+        return true;
+    }
+
+    // 按柜台订单编号查找本地编号，仅限写线程调用，未找到返回0
+    uint64_t FindLocalID(uint64_t vendorID) const
+    {
+        uint32_t pos = HashVendorID(vendorID) & m_VendorMask;
+        for(uint32_t i = 0; i <= m_VendorMask; i++)
+        {
+            const TVendorEntry& entry = m_VendorMap[(pos + i) & m_VendorMask];
+            if(entry.VendorID == 0)
+            {
+                return 0;
+            }
+            if(entry.VendorID == vendorID && !IsStale(entry))
+            {
+                return entry.LocalID;
+            }
+        }
+        return 0;
+    }
+
+    // 无锁读取订单快照，槽位已被其他订单复用时返回false
+    bool Read(uint64_t localID, TOrderSnapshot& snapshot) const
+    {
+        const TOrderSlot& slot = m_Slots[localID & m_Mask];
+        uint32_t begin, end;
+        do
+        {
+            begin = slot.Sequence.load(std::memory_order_acquire);
+            memcpy(&snapshot, &slot.Snapshot, sizeof(snapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = slot.Sequence.load(std::memory_order_relaxed);
+        } while((begin & 1) || begin != end);
+        return snapshot.LocalID == localID && snapshot.Status != EORDER_NONE;
+    }
+
+    static force_inline inline bool IsFinished(int status)
+    {
+        return status >= EORDER_FILLED;
+    }
+
+    static const char* GetStatusString(int status)
+    {
+        static const char* Names[EORDER_STATUS_COUNT] =
+        {
+            "None", "PendingNew", "Accepted", "ExchangeAccepted", "PartialFilled",
+            "Filled", "PartialCancelled", "Cancelled", "Rejected"
+        };
+        return (unsigned)status < EORDER_STATUS_COUNT ? Names[status] : "Unknown";
+    }
+
+#ifdef THOST_FTDCSTRUCT_H
+    // CTP订单状态映射，报单提交被拒优先
+    static int ConvertStatus(const CThostFtdcOrderField& field)
+    {
+        if(field.OrderSubmitStatus == THOST_FTDC_OSS_InsertRejected)
+        {
+            return EORDER_REJECTED;
+        }
+        switch(field.OrderStatus)
+        {
+        case THOST_FTDC_OST_AllTraded:
+            return EORDER_FILLED;
+        case THOST_FTDC_OST_PartTradedQueueing:
+            return EORDER_PARTIAL_FILLED;
+        case THOST_FTDC_OST_PartTradedNotQueueing:
+            return EORDER_PARTIAL_CANCELLED;
+        case THOST_FTDC_OST_NoTradeQueueing:
+            return EORDER_EXCHANGE_ACCEPTED;
+        case THOST_FTDC_OST_Canceled:
+            return EORDER_CANCELLED;
+        case THOST_FTDC_OST_NoTradeNotQueueing:
+        case THOST_FTDC_OST_Unknown:
+            return EORDER_ACCEPTED;
+        default:
+            return EORDER_NONE;
+        }
+    }
+
+    // OrderRef只在会话内唯一，登录成功后设置本会话的FrontID、SessionID，
+    // 同一账户其他会话的回报被丢弃
+    void SetCTPSession(int frontID, int sessionID)
+    {
+        m_FrontID = frontID;
+        m_SessionID = sessionID;
+    }
+
+    bool OnRtnOrder(const CThostFtdcOrderField& field, uint64_t nowNs)
+    {
+        if(field.FrontID != m_FrontID || field.SessionID != m_SessionID)
+        {
+            return false;
+        }
+        return OnStatus(strtoull(field.OrderRef, NULL, 10), ConvertStatus(field), field.VolumeTraded,
+                        strtoull(field.OrderSysID, NULL, 10), 0, nowNs);
+    }
+
+    // 成交回报不带会话信息：OrderSysID已由本会话订单回报映射时按映射定位，
+    // 否则仅匹配尚无OrderSysID的本地订单(成交先于订单回报到达)
+    bool OnRtnTrade(const CThostFtdcTradeField& field, uint64_t nowNs)
+    {
+        uint64_t localID = strtoull(field.OrderRef, NULL, 10);
+        uint64_t vendorID = strtoull(field.OrderSysID, NULL, 10);
+        uint64_t mappedID = vendorID != 0 ? FindLocalID(vendorID) : 0;
+        if(mappedID != 0)
+        {
+            if(mappedID != localID)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            TOrderSlot* slot = Locate(localID);
+            if(slot == NULL || slot->Snapshot.VendorID != 0)
+            {
+                return false;
+            }
+        }
+        return OnTrade(localID, field.Volume, field.Price, nowNs);
+    }
+
+    // 输入报单不带会话信息，应在只推送给报单会话的OnRspOrderInsert中调用；
+    // 只拒绝尚未被柜台接受的订单
+    bool OnErrRtnOrderInsert(const CThostFtdcInputOrderField& field, int errorID, uint64_t nowNs)
+    {
+        uint64_t localID = strtoull(field.OrderRef, NULL, 10);
+        TOrderSlot* slot = Locate(localID);
+        if(slot == NULL || slot->Snapshot.Status != EORDER_PENDING_NEW)
+        {
+            return false;
+        }
+        return OnStatus(localID, EORDER_REJECTED, 0, 0, errorID, nowNs);
+    }
+#endif
+
+#ifdef _EES_TRADE_API_STRUCT_DEFINE_H_
+    bool OnOrderAccept(const EES_OrderAcceptField& field, uint64_t nowNs)
+    {
+        return OnStatus(field.m_ClientOrderToken, EORDER_ACCEPTED, 0, field.m_MarketOrderToken, 0, nowNs);
+    }
+
+    bool OnOrderMarketAccept(const EES_OrderMarketAcceptField& field, uint64_t nowNs)
+    {
+        return OnStatus(field.m_ClientOrderToken, EORDER_EXCHANGE_ACCEPTED, 0, field.m_MarketOrderToken, 0, nowNs);
+    }
+
+    bool OnOrderReject(const EES_OrderRejectField& field, uint64_t nowNs)
+    {
+        return OnStatus(field.m_ClientOrderToken, EORDER_REJECTED, 0, 0, field.m_ReasonCode, nowNs);
+    }
+
+    bool OnOrderMarketReject(const EES_OrderMarketRejectField& field, uint64_t nowNs)
+    {
+        return OnStatus(field.m_ClientOrderToken, EORDER_REJECTED, 0, field.m_MarketOrderToken, -1, nowNs);
+    }
+
+    bool OnOrderExecution(const EES_OrderExecutionField& field, uint64_t nowNs)
+    {
+        return OnTrade(field.m_ClientOrderToken, field.m_Quantity, field.m_Price, nowNs);
+    }
+
+    bool OnOrderCxled(const EES_OrderCxled& field, uint64_t nowNs)
+    {
+        return OnCancelled(field.m_ClientOrderToken, field.m_Decrement, nowNs);
+    }
+#endif
+
+#ifdef YD_DATA_STRUCT_H
+    // YD订单状态映射，下标为YD_OS_*
+    static int ConvertStatus(const YDOrder& field)
+    {
+        static const uint8_t StatusTable[] =
+        {
+            EORDER_ACCEPTED,            // YD_OS_Accepted
+            EORDER_EXCHANGE_ACCEPTED,   // YD_OS_Queuing
+            EORDER_CANCELLED,           // YD_OS_Canceled
+            EORDER_FILLED,              // YD_OS_AllTraded
+            EORDER_REJECTED             // YD_OS_Rejected
+        };
+        return (unsigned)field.OrderStatus < sizeof(StatusTable) ? StatusTable[field.OrderStatus] : (int)EORDER_NONE;
+    }
+
+    bool notifyOrder(const YDOrder& field, uint64_t nowNs)
+    {
+        return OnStatus((uint32_t)field.OrderRef, ConvertStatus(field), field.TradeVolume,
+                        field.OrderStatus == YD_OS_Rejected ? 0 : (uint32_t)field.OrderSysID, field.ErrorNo, nowNs);
+    }
+
+    bool notifyTrade(const YDTrade& field, uint64_t nowNs)
+    {
+        return OnTrade((uint32_t)field.OrderRef, field.Volume, field.Price, nowNs);
+    }
+#endif
+
+#ifdef _XOMS_API_STRUCT_H_
+    // XTP订单状态映射，下标为XTP_ORDER_STATUS_TYPE
+    static int ConvertStatus(const XTPOrderInfo& field)
+    {
+        static const uint8_t StatusTable[] =
+        {
+            EORDER_ACCEPTED,            // XTP_ORDER_STATUS_INIT
+            EORDER_FILLED,              // XTP_ORDER_STATUS_ALLTRADED
+            EORDER_PARTIAL_FILLED,      // XTP_ORDER_STATUS_PARTTRADEDQUEUEING
+            EORDER_PARTIAL_CANCELLED,   // XTP_ORDER_STATUS_PARTTRADEDNOTQUEUEING
+            EORDER_EXCHANGE_ACCEPTED,   // XTP_ORDER_STATUS_NOTRADEQUEUEING
+            EORDER_CANCELLED,           // XTP_ORDER_STATUS_CANCELED
+            EORDER_REJECTED,            // XTP_ORDER_STATUS_REJECTED
+            EORDER_NONE                 // XTP_ORDER_STATUS_UNKNOWN
+        };
+        return (unsigned)field.order_status < sizeof(StatusTable) ? StatusTable[field.order_status] : (int)EORDER_NONE;
+    }
+
+    bool OnOrderEvent(const XTPOrderInfo& field, int32_t errorID, uint64_t nowNs)
+    {
+        return OnStatus(field.order_client_id, ConvertStatus(field), (int32_t)field.qty_traded,
+                        field.order_xtp_id, errorID, nowNs);
+    }
+
+    bool OnTradeEvent(const XTPTradeReport& field, uint64_t nowNs)
+    {
+        return OnTrade(field.order_client_id, (int32_t)field.quantity, field.price, nowNs);
+    }
+#endif
+protected:
+    struct TVendorEntry
+    {
+        uint64_t VendorID;
+        uint64_t LocalID;
+    };
+
+    force_inline inline TOrderSlot* Locate(uint64_t localID)
+    {
+        TOrderSlot& slot = m_Slots[localID & m_Mask];
+        if(slot.Snapshot.LocalID != localID || slot.Snapshot.Status == EORDER_NONE)
+        {
+            return NULL;
+        }
+        return &slot;
+    }
+
+    // 状态迁移表，行为当前状态，列为目标状态；乱序到达的旧状态被丢弃
+    static force_inline inline bool Transition(TOrderSnapshot& snapshot, int status)
+    {
+        static const uint8_t TransitionTable[EORDER_STATUS_COUNT][EORDER_STATUS_COUNT] =
+        {
+            // None PendingNew Accepted ExchAccepted Partial Filled PartialCxl Cxl Rejected
+            {0, 1, 0, 0, 0, 0, 0, 0, 0},    // None
+            {0, 0, 1, 1, 1, 1, 1, 1, 1},    // PendingNew
+            {0, 0, 0, 1, 1, 1, 1, 1, 1},    // Accepted
+            {0, 0, 0, 0, 1, 1, 1, 1, 1},    // ExchangeAccepted
+            {0, 0, 0, 0, 0, 1, 1, 0, 0},    // PartialFilled
+            {0, 0, 0, 0, 0, 0, 0, 0, 0},    // Filled
+            {0, 0, 0, 0, 0, 0, 0, 0, 0},    // PartialCancelled
+            {0, 0, 0, 0, 0, 0, 0, 0, 0},    // Cancelled
+            {0, 0, 0, 0, 0, 0, 0, 0, 0}     // Rejected
+        };
+        if(TransitionTable[snapshot.Status][status])
+        {
+            snapshot.Status = status;
+            return true;
+        }
+        return false;
+    }
+
+    static force_inline inline void Publish(TOrderSlot& slot, const TOrderSnapshot& snapshot)
+    {
+        uint32_t sequence = slot.Sequence.load(std::memory_order_relaxed);
+        slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&slot.Snapshot, &snapshot, sizeof(snapshot));
+        slot.Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    static force_inline inline uint32_t HashVendorID(uint64_t vendorID)
+    {
+        vendorID ^= vendorID >> 33;
+        vendorID *= 0xff51afd7ed558ccdULL;
+        vendorID ^= vendorID >> 33;
+        return (uint32_t)vendorID;
+    }
+
+    // 对应订单已被新订单覆盖的映射视为过期，可被复用
+    force_inline inline bool IsStale(const TVendorEntry& entry) const
+    {
+        const TOrderSnapshot& snapshot = m_Slots[entry.LocalID & m_Mask].Snapshot;
+        return snapshot.LocalID != entry.LocalID || snapshot.VendorID != entry.VendorID;
+    }
+
+    void MapVendorID(uint64_t vendorID, uint64_t localID)
+    {
+        uint32_t pos = HashVendorID(vendorID) & m_VendorMask;
+        for(uint32_t i = 0; i <= m_VendorMask; i++)
+        {
+            TVendorEntry& entry = m_VendorMap[(pos + i) & m_VendorMask];
+            if(entry.VendorID == 0 || entry.VendorID == vendorID || IsStale(entry))
+            {
+                entry.VendorID = vendorID;
+                entry.LocalID = localID;
+                return;
+            }
+        }
+    }
+
+    // 线性探测的后移删除，不留墓碑：空位之后仍在探测链上的表项前移填补
+    void EraseVendorID(uint64_t vendorID, uint64_t localID)
+    {
+        uint32_t hole = HashVendorID(vendorID) & m_VendorMask;
+        while(m_VendorMap[hole].VendorID != vendorID)
+        {
+            if(m_VendorMap[hole].VendorID == 0)
+            {
+                return;
+            }
+            hole = (hole + 1) & m_VendorMask;
+        }
+        if(m_VendorMap[hole].LocalID != localID)
+        {
+            return;
+        }
+        uint32_t next = hole;
+        while(true)
+        {
+            next = (next + 1) & m_VendorMask;
+            const TVendorEntry& entry = m_VendorMap[next];
+            if(entry.VendorID == 0)
+            {
+                break;
+            }
+            uint32_t home = HashVendorID(entry.VendorID) & m_VendorMask;
+            if(((next - home) & m_VendorMask) >= ((next - hole) & m_VendorMask))
+            {
+                m_VendorMap[hole] = entry;
+                hole = next;
+            }
+        }
+        m_VendorMap[hole].VendorID = 0;
+        m_VendorMap[hole].LocalID = 0;
+    }
+protected:
+    TOrderSlot* m_Slots;
+    uint64_t m_Mask;
+    TVendorEntry* m_VendorMap;
+    uint32_t m_VendorMask;
+    int32_t m_FrontID;
+    int32_t m_SessionID;
+private:
+    OrderTable(const OrderTable &);
+    OrderTable &operator=(const OrderTable &);
+};
+
+}
+
+#endif // ORDERTABLE_HPP
@@ -0,0 +1,222 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include "ThostFtdcUserApiStruct.h"
+#include "xoms_api_struct.h"
+#include "ydDataStruct.h"
+#include "EesTraderDefine.h"
+#include "OrderTable.hpp"
+#include "HRTimer.hpp"
+
+int main(int argc, char* argv[])
+{
+    TradeUtil::OrderTable table;
+    assert(!table.Init(0x80000001u));
+    assert(table.Init(1000));
+    TradeUtil::TOrderSnapshot snapshot;
+
+    // CTP：成交回报先于订单回报到达
+    {
+        assert(table.OnInsert(1, 0, 0, 0, 3500.0, 10, 1));
+        CThostFtdcTradeField trade;
+        memset(&trade, 0, sizeof(trade));
+        strcpy(trade.OrderRef, "1");
+        trade.Volume = 4;
+        trade.Price = 3500.0;
+        assert(table.OnRtnTrade(trade, 2));
+        CThostFtdcOrderField order;
+        memset(&order, 0, sizeof(order));
+        strcpy(order.OrderRef, "1");
+        strcpy(order.OrderSysID, "      88001");
+        order.OrderSubmitStatus = THOST_FTDC_OSS_Accepted;
+        order.OrderStatus = THOST_FTDC_OST_NoTradeQueueing;
+        assert(table.OnRtnOrder(order, 3));
+        assert(table.Read(1, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_PARTIAL_FILLED && snapshot.TradedVolume == 4);
+        assert(snapshot.VendorID == 88001 && table.FindLocalID(88001) == 1);
+        order.OrderStatus = THOST_FTDC_OST_Canceled;
+        order.VolumeTraded = 4;
+        assert(table.OnRtnOrder(order, 4));
+        assert(table.Read(1, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_PARTIAL_CANCELLED && snapshot.CancelledVolume == 6);
+    }
+
+    // CTP：同一账户其他会话相同OrderRef的回报被丢弃
+    {
+        table.SetCTPSession(1, 100);
+        assert(table.OnInsert(5, 0, 0, 0, 3500.0, 10, 1));
+        CThostFtdcOrderField order;
+        memset(&order, 0, sizeof(order));
+        strcpy(order.OrderRef, "5");
+        strcpy(order.OrderSysID, "      88005");
+        order.FrontID = 2;
+        order.SessionID = 200;
+        order.OrderSubmitStatus = THOST_FTDC_OSS_Accepted;
+        order.OrderStatus = THOST_FTDC_OST_AllTraded;
+        order.VolumeTraded = 10;
+        assert(!table.OnRtnOrder(order, 2));
+        strcpy(order.OrderSysID, "      88006");
+        order.FrontID = 1;
+        order.SessionID = 100;
+        order.OrderStatus = THOST_FTDC_OST_NoTradeQueueing;
+        order.VolumeTraded = 0;
+        assert(table.OnRtnOrder(order, 3));
+        CThostFtdcTradeField trade;
+        memset(&trade, 0, sizeof(trade));
+        strcpy(trade.OrderRef, "5");
+        strcpy(trade.OrderSysID, "      88005");
+        trade.Volume = 10;
+        trade.Price = 3500.0;
+        assert(!table.OnRtnTrade(trade, 4));
+        strcpy(trade.OrderSysID, "      88006");
+        trade.Volume = 3;
+        assert(table.OnRtnTrade(trade, 5));
+        CThostFtdcInputOrderField input;
+        memset(&input, 0, sizeof(input));
+        strcpy(input.OrderRef, "5");
+        assert(!table.OnErrRtnOrderInsert(input, 31, 6));
+        assert(table.Read(5, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_PARTIAL_FILLED && snapshot.TradedVolume == 3 && snapshot.ErrorID == 0);
+        table.SetCTPSession(0, 0);
+    }
+
+    // REM
+    {
+        assert(table.OnInsert(2, 0, 1, 0, 3600.0, 5, 1));
+        EES_OrderAcceptField accept;
+        memset(&accept, 0, sizeof(accept));
+        accept.m_ClientOrderToken = 2;
+        accept.m_MarketOrderToken = 70001;
+        assert(table.OnOrderAccept(accept, 2));
+        EES_OrderMarketAcceptField marketAccept;
+        memset(&marketAccept, 0, sizeof(marketAccept));
+        marketAccept.m_ClientOrderToken = 2;
+        marketAccept.m_MarketOrderToken = 70001;
+        assert(table.OnOrderMarketAccept(marketAccept, 3));
+        EES_OrderExecutionField execution;
+        memset(&execution, 0, sizeof(execution));
+        execution.m_ClientOrderToken = 2;
+        execution.m_Quantity = 5;
+        execution.m_Price = 3600.0;
+        assert(table.OnOrderExecution(execution, 4));
+        assert(table.Read(2, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_FILLED && snapshot.TradeAmount == 18000.0);
+        // 终态后的撤单回报不改变状态
+        EES_OrderCxled cxled;
+        memset(&cxled, 0, sizeof(cxled));
+        cxled.m_ClientOrderToken = 2;
+        table.OnOrderCxled(cxled, 5);
+        assert(table.Read(2, snapshot) && snapshot.Status == TradeUtil::EORDER_FILLED);
+    }
+
+    // YD
+    {
+        assert(table.OnInsert(3, 0, 0, 1, 3400.0, 2, 1));
+        YDOrder order;
+        memset(&order, 0, sizeof(order));
+        order.OrderRef = 3;
+        order.OrderSysID = 501;
+        order.OrderStatus = YD_OS_Rejected;
+        order.ErrorNo = 12;
+        assert(table.notifyOrder(order, 2));
+        assert(table.Read(3, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_REJECTED && snapshot.ErrorID == 12);
+    }
+
+    // XTP：旧状态乱序到达被丢弃
+    {
+        assert(table.OnInsert(4, 0, 0, 0, 10.5, 300, 1));
+        XTPOrderInfo order;
+        memset(&order, 0, sizeof(order));
+        order.order_client_id = 4;
+        order.order_xtp_id = 0x1000000000001ull;
+        order.order_status = XTP_ORDER_STATUS_ALLTRADED;
+        order.qty_traded = 300;
+        assert(table.OnOrderEvent(order, 0, 2));
+        order.order_status = XTP_ORDER_STATUS_NOTRADEQUEUEING;
+        order.qty_traded = 0;
+        assert(!table.OnOrderEvent(order, 0, 3));
+        XTPTradeReport trade;
+        memset(&trade, 0, sizeof(trade));
+        trade.order_client_id = 4;
+        trade.quantity = 300;
+        trade.price = 10.5;
+        assert(table.OnTradeEvent(trade, 4));
+        assert(table.Read(4, snapshot));
+        assert(snapshot.Status == TradeUtil::EORDER_FILLED && snapshot.TradedVolume == 300);
+        assert(table.FindLocalID(0x1000000000001ull) == 4);
+    }
+
+    // 槽位复用：1024 + 4与4同槽，订单4已结束可复用
+    assert(table.OnInsert(1028, 0, 0, 0, 10.0, 1, 5));
+    assert(!table.Read(4, snapshot));
+    assert(table.FindLocalID(0x1000000000001ull) == 0);
+
+    // 槽位反复复用后映射表无残留：已结束订单的柜台编号查不到，存活订单均可查到
+    {
+        TradeUtil::OrderTable churn;
+        assert(churn.Init(64));
+        for(uint64_t localID = 1; localID <= 64 * 100; localID++)
+        {
+            assert(churn.OnInsert(localID, 0, 0, 0, 10.0, 1, localID));
+            assert(churn.OnStatus(localID, TradeUtil::EORDER_ACCEPTED, 0, 500000 + localID, 0, localID));
+            if(localID > 32)
+            {
+                assert(churn.OnStatus(localID - 32, TradeUtil::EORDER_CANCELLED, 0, 0, 0, localID));
+            }
+        }
+        for(uint64_t localID = 1; localID <= 64 * 100; localID++)
+        {
+            uint64_t expected = localID > 64 * 100 - 64 ? localID : 0;
+            assert(churn.FindLocalID(500000 + localID) == expected);
+        }
+        assert(churn.FindLocalID(1) == 0);
+    }
+
+    // 单写多读：读线程检查快照一致性
+    {
+        const int N = 1000000;
+        std::atomic<bool> done(false);
+        std::atomic<uint64_t> reads(0);
+        auto reader = [&]()
+        {
+            TradeUtil::TOrderSnapshot result;
+            uint64_t count = 0;
+            while(!done.load(std::memory_order_relaxed))
+            {
+                for(uint64_t id = 10000; id < 10016; id++)
+                {
+                    if(table.Read(id, result))
+                    {
+                        assert(result.TradeAmount == result.TradedVolume * 100.0);
+                        assert(result.TradedVolume <= result.Volume);
+                        count++;
+                    }
+                }
+            }
+            reads += count;
+        };
+        TimeUtil::HRTimer timer;
+        std::thread reader1(reader);
+        std::thread reader2(reader);
+        uint64_t start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            uint64_t id = 10000 + (i & 15);
+            if((i & 255) < 16)
+            {
+                table.OnInsert(id, 0, 0, 0, 100.0, 1 << 30, i);
+            }
+            table.OnTrade(id, 1, 100.0, i);
+        }
+        uint64_t end = timer.GetTimeNs();
+        done = true;
+        reader1.join();
+        reader2.join();
+        fprintf(stderr, "OrderTable OnTrade Latency: %.1f ns, reads: %lu\n", (double)(end - start) / N, reads.load());
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 OrderTableTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../CTP/6.7.8/include -I../../XTP/2.2.36.1/include -I../../YD/1.486.96/include -I../../REM/3.1.3.49/include
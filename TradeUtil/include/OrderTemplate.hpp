@@ -0,0 +1,248 @@
+#ifndef ORDERTEMPLATE_HPP
+#define ORDERTEMPLATE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+namespace TradeUtil
+{
+
+// 单个报单模板，独占缓存行，Context保存柜台接口需要的附加参数，如YD的YDInstrument指针
+template <typename Field>
+struct alignas(64) TOrderTemplate
+{
+    Field Order;
+    const void* Context;
+    bool Ready;
+};
+
+// 报单模板缓存
+// 按合约序号、方向、开平预先构造完整的柜台报单结构体，热路径只改写价格、数量和本地报单编号，
+// 返回的指针可直接传给柜台报单接口，省去逐字段赋值、合约代码拷贝和清零。
+// 模板在原地改写，须由报单线程单线程调用；柜台接口回写的字段（如YD ErrorNo）不影响下次使用
+template <typename Field, typename Adapter>
+class OrderTemplateCache
+{
+public:
+    // 方向取值同ERiskDirection，开平取值0开仓、1平仓、2平今
+    enum
+    {
+        DIRECTION_COUNT = 2,
+        OFFSET_COUNT = 3,
+        VARIANT_COUNT = DIRECTION_COUNT * OFFSET_COUNT
+    };
+
+    OrderTemplateCache(): m_Templates(NULL), m_InstrumentCount(0)
+    {
+    }
+
+    ~OrderTemplateCache()
+    {
+        free(m_Templates);
+    }
+
+    bool Init(int instrumentCount)
+    {
+        free(m_Templates);
+        m_Templates = NULL;
+        m_InstrumentCount = 0;
+        if(instrumentCount <= 0)
+        {
+            return false;
+        }
+        void* p = NULL;
+        size_t size = sizeof(TOrderTemplate<Field>) * instrumentCount * VARIANT_COUNT;
+        if(posix_memalign(&p, 64, size) != 0)
+        {
+            return false;
+        }
+        memset(p, 0, size);
+        m_Templates = (TOrderTemplate<Field>*)p;
+        m_InstrumentCount = instrumentCount;
+        return true;
+    }
+
+    // 登记模板，通常在登录后按合约列表构造，field须已填好除价格、数量、报单编号外的全部字段
+    bool SetTemplate(int instrumentSlot, int direction, int offset, const Field& field, const void* context = NULL)
+    {
+        if(!Valid(instrumentSlot, direction, offset))
+        {
+            return false;
+        }
+        TOrderTemplate<Field>& slot = m_Templates[Index(instrumentSlot, direction, offset)];
+        slot.Order = field;
+        slot.Context = context;
+        slot.Ready = true;
+        return true;
+    }
+
+    // 改写价格、数量和本地报单编号，返回可直接报出的结构体，未登记的模板返回NULL
+    force_inline inline Field* Prepare(int instrumentSlot, int direction, int offset, double price, int volume, uint32_t clientID)
+    {
+        if(unlikely(!Valid(instrumentSlot, direction, offset)))
+        {
+            return NULL;
+        }
+        TOrderTemplate<Field>& slot = m_Templates[Index(instrumentSlot, direction, offset)];
+        if(unlikely(!slot.Ready))
+        {
+            return NULL;
+        }
+        Adapter::Patch(slot.Order, price, volume, clientID);
+        return &slot.Order;
+    }
+
+    // 行情到达、信号计算之前预取模板所在缓存行
+    force_inline inline void Prefetch(int instrumentSlot, int direction, int offset) const
+    {
+        if(Valid(instrumentSlot, direction, offset))
+        {
+            __builtin_prefetch(&m_Templates[Index(instrumentSlot, direction, offset)], 1, 3);
+        }
+    }
+
+    force_inline inline const void* GetContext(int instrumentSlot, int direction, int offset) const
+    {
+        return Valid(instrumentSlot, direction, offset) ? m_Templates[Index(instrumentSlot, direction, offset)].Context : NULL;
+    }
+
+    int InstrumentCount() const
+    {
+        return m_InstrumentCount;
+    }
+protected:
+    force_inline inline bool Valid(int instrumentSlot, int direction, int offset) const
+    {
+        return (unsigned)instrumentSlot < (unsigned)m_InstrumentCount &&
+               (unsigned)direction < (unsigned)DIRECTION_COUNT && (unsigned)offset < (unsigned)OFFSET_COUNT;
+    }
+
+    static force_inline inline int Index(int instrumentSlot, int direction, int offset)
+    {
+        return instrumentSlot * VARIANT_COUNT + direction * OFFSET_COUNT + offset;
+    }
+protected:
+    TOrderTemplate<Field>* m_Templates;
+    int m_InstrumentCount;
+private:
+    OrderTemplateCache(const OrderTemplateCache &);
+    OrderTemplateCache &operator=(const OrderTemplateCache &);
+};
+
+// 无符号整数转十进制字符串，返回写入长度，buffer至少12字节
+force_inline inline int FormatOrderRef(uint32_t value, char* buffer)
+{
+    char digits[12];
+    int n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while(value != 0);
+    for(int i = 0; i < n; i++)
+    {
+        buffer[i] = digits[n - 1 - i];
+    }
+    buffer[n] = '\0';
+    return n;
+}
+
+// 柜台报单结构体适配，需在本头文件之前包含对应柜台头文件
+// Build按常用限价单参数构造模板，Patch在热路径改写价格、数量和本地报单编号
+
+#ifdef THOST_FTDCSTRUCT_H
+// CTP ReqOrderInsert，OrderRef为字符串，由Patch格式化
+struct CTPOrderTemplateAdapter
+{
+    static void Build(CThostFtdcInputOrderField& field, const char* brokerID, const char* investorID,
+                      const char* instrumentID, const char* exchangeID, int direction, int offset)
+    {
+        static const char offsetFlag[] = {THOST_FTDC_OF_Open, THOST_FTDC_OF_Close, THOST_FTDC_OF_CloseToday};
+        memset(&field, 0, sizeof(field));
+        strncpy(field.BrokerID, brokerID, sizeof(field.BrokerID) - 1);
+        strncpy(field.InvestorID, investorID, sizeof(field.InvestorID) - 1);
+        strncpy(field.UserID, investorID, sizeof(field.UserID) - 1);
+        strncpy(field.InstrumentID, instrumentID, sizeof(field.InstrumentID) - 1);
+        strncpy(field.ExchangeID, exchangeID, sizeof(field.ExchangeID) - 1);
+        field.OrderPriceType = THOST_FTDC_OPT_LimitPrice;
+        field.Direction = direction == 0 ? THOST_FTDC_D_Buy : THOST_FTDC_D_Sell;
+        field.CombOffsetFlag[0] = offsetFlag[offset % 3];
+        field.CombHedgeFlag[0] = THOST_FTDC_HF_Speculation;
+        field.TimeCondition = THOST_FTDC_TC_GFD;
+        field.VolumeCondition = THOST_FTDC_VC_AV;
+        field.MinVolume = 1;
+        field.ContingentCondition = THOST_FTDC_CC_Immediately;
+        field.ForceCloseReason = THOST_FTDC_FCC_NotForceClose;
+    }
+
+    static force_inline inline void Patch(CThostFtdcInputOrderField& field, double price, int volume, uint32_t clientID)
+    {
+        field.LimitPrice = price;
+        field.VolumeTotalOriginal = volume;
+        FormatOrderRef(clientID, field.OrderRef);
+    }
+};
+#endif
+
+#ifdef _XOMS_API_STRUCT_H_
+// XTP InsertOrder，order_xtp_id由API填写
+struct XTPOrderTemplateAdapter
+{
+    static void Build(XTPOrderInsertInfo& field, const char* ticker, XTP_MARKET_TYPE market, XTP_SIDE_TYPE side,
+                      XTP_POSITION_EFFECT_TYPE positionEffect, XTP_BUSINESS_TYPE businessType)
+    {
+        memset(&field, 0, sizeof(field));
+        strncpy(field.ticker, ticker, sizeof(field.ticker) - 1);
+        field.market = market;
+        field.price_type = XTP_PRICE_LIMIT;
+        field.side = side;
+        field.position_effect = positionEffect;
+        field.business_type = businessType;
+    }
+
+    static force_inline inline void Patch(XTPOrderInsertInfo& field, double price, int volume, uint32_t clientID)
+    {
+        field.price = price;
+        field.quantity = volume;
+        field.order_client_id = clientID;
+    }
+};
+#endif
+
+#ifdef YD_DATA_STRUCT_H
+// YD insertOrder，YDInstrument指针作为模板Context保存
+struct YDOrderTemplateAdapter
+{
+    static void Build(YDInputOrder& field, int direction, int offset)
+    {
+        static const char offsetFlag[] = {YD_OF_Open, YD_OF_Close, YD_OF_CloseToday};
+        memset(&field, 0, sizeof(field));
+        field.Direction = direction == 0 ? YD_D_Buy : YD_D_Sell;
+        field.OffsetFlag = offsetFlag[offset % 3];
+        field.HedgeFlag = YD_HF_Speculation;
+        field.ConnectionSelectionType = YD_CS_Any;
+        field.OrderType = YD_ODT_Limit;
+        field.YDOrderFlag = YD_YOF_Normal;
+    }
+
+    static force_inline inline void Patch(YDInputOrder& field, double price, int volume, uint32_t clientID)
+    {
+        field.Price = price;
+        field.OrderVolume = volume;
+        field.OrderRef = (int)clientID;
+    }
+};
+#endif
+
+}
+
+#endif // ORDERTEMPLATE_HPP
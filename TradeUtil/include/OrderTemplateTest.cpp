@@ -0,0 +1,217 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include "ThostFtdcUserApiStruct.h"
+#include "xoms_api_struct.h"
+#include "ydDataStruct.h"
+#include "OrderTemplate.hpp"
+#include "InstrumentIndex.hpp"
+#include "HRTimer.hpp"
+
+// 模拟柜台报单接口，读取报单结构体中热路径改写的字段，避免编译器优化掉报单构造
+static uint64_t g_Sink = 0;
+
+__attribute__((noinline)) void ReqOrderInsert(CThostFtdcInputOrderField* order, int requestID)
+{
+    g_Sink += order->VolumeTotalOriginal + order->OrderRef[0] + order->InstrumentID[0] + requestID;
+}
+
+__attribute__((noinline)) uint64_t InsertOrder(XTPOrderInsertInfo* order, uint64_t sessionID)
+{
+    g_Sink += order->quantity + order->order_client_id + order->ticker[0];
+    return sessionID;
+}
+
+__attribute__((noinline)) bool insertOrder(YDInputOrder* order, const void* instrument)
+{
+    g_Sink += order->OrderVolume + order->OrderRef + (instrument != NULL);
+    return true;
+}
+
+// 逐字段构造报单，作为对比基准
+static inline void BuildCTPOrder(CThostFtdcInputOrderField& field, const char* instrumentID, double price, int volume, uint32_t clientID)
+{
+    memset(&field, 0, sizeof(field));
+    strcpy(field.BrokerID, "9999");
+    strcpy(field.InvestorID, "000001");
+    strcpy(field.UserID, "000001");
+    strcpy(field.InstrumentID, instrumentID);
+    strcpy(field.ExchangeID, "SHFE");
+    sprintf(field.OrderRef, "%u", clientID);
+    field.OrderPriceType = THOST_FTDC_OPT_LimitPrice;
+    field.Direction = THOST_FTDC_D_Buy;
+    field.CombOffsetFlag[0] = THOST_FTDC_OF_Open;
+    field.CombHedgeFlag[0] = THOST_FTDC_HF_Speculation;
+    field.LimitPrice = price;
+    field.VolumeTotalOriginal = volume;
+    field.TimeCondition = THOST_FTDC_TC_GFD;
+    field.VolumeCondition = THOST_FTDC_VC_AV;
+    field.MinVolume = 1;
+    field.ContingentCondition = THOST_FTDC_CC_Immediately;
+    field.ForceCloseReason = THOST_FTDC_FCC_NotForceClose;
+}
+
+static inline void BuildXTPOrder(XTPOrderInsertInfo& field, const char* ticker, double price, int volume, uint32_t clientID)
+{
+    memset(&field, 0, sizeof(field));
+    strcpy(field.ticker, ticker);
+    field.market = XTP_MKT_SH_A;
+    field.price_type = XTP_PRICE_LIMIT;
+    field.side = XTP_SIDE_BUY;
+    field.position_effect = XTP_POSITION_EFFECT_INIT;
+    field.business_type = XTP_BUSINESS_TYPE_CASH;
+    field.price = price;
+    field.quantity = volume;
+    field.order_client_id = clientID;
+}
+
+static inline void BuildYDOrder(YDInputOrder& field, double price, int volume, uint32_t clientID)
+{
+    memset(&field, 0, sizeof(field));
+    field.Direction = YD_D_Buy;
+    field.OffsetFlag = YD_OF_Open;
+    field.HedgeFlag = YD_HF_Speculation;
+    field.ConnectionSelectionType = YD_CS_Any;
+    field.OrderType = YD_ODT_Limit;
+    field.YDOrderFlag = YD_YOF_Normal;
+    field.Price = price;
+    field.OrderVolume = volume;
+    field.OrderRef = clientID;
+}
+
+int main(int argc, char* argv[])
+{
+    typedef TradeUtil::OrderTemplateCache<CThostFtdcInputOrderField, TradeUtil::CTPOrderTemplateAdapter> CTPCache;
+    typedef TradeUtil::OrderTemplateCache<XTPOrderInsertInfo, TradeUtil::XTPOrderTemplateAdapter> XTPCache;
+    typedef TradeUtil::OrderTemplateCache<YDInputOrder, TradeUtil::YDOrderTemplateAdapter> YDCache;
+
+    assert(sizeof(TradeUtil::TOrderTemplate<XTPOrderInsertInfo>) % 64 == 0);
+    assert(sizeof(TradeUtil::TOrderTemplate<CThostFtdcInputOrderField>) % 64 == 0);
+
+    char buffer[12];
+    assert(TradeUtil::FormatOrderRef(0, buffer) == 1 && strcmp(buffer, "0") == 0);
+    assert(TradeUtil::FormatOrderRef(4294967295u, buffer) == 10 && strcmp(buffer, "4294967295") == 0);
+
+    TradeUtil::InstrumentIndex index(64);
+    int rb = index.Register("rb2410");
+    int ag = index.Register("ag2412");
+
+    // CTP：模板字段保持不变，只改写价格、数量、OrderRef
+    CTPCache ctp;
+    assert(ctp.Init(64));
+    {
+        CThostFtdcInputOrderField field;
+        TradeUtil::CTPOrderTemplateAdapter::Build(field, "9999", "000001", "rb2410", "SHFE", 1, 2);
+        assert(ctp.SetTemplate(rb, 1, 2, field));
+        CThostFtdcInputOrderField* order = ctp.Prepare(rb, 1, 2, 3500.0, 3, 123);
+        assert(order != NULL && ((uintptr_t)order & 63) == 0);
+        assert(strcmp(order->InstrumentID, "rb2410") == 0 && strcmp(order->OrderRef, "123") == 0);
+        assert(order->Direction == THOST_FTDC_D_Sell && order->CombOffsetFlag[0] == THOST_FTDC_OF_CloseToday);
+        assert(order->LimitPrice == 3500.0 && order->VolumeTotalOriginal == 3);
+        order = ctp.Prepare(rb, 1, 2, 3501.0, 1, 7);
+        assert(strcmp(order->OrderRef, "7") == 0 && order->LimitPrice == 3501.0);
+        // 未登记、越界的模板
+        assert(ctp.Prepare(ag, 1, 2, 3500.0, 1, 8) == NULL);
+        assert(ctp.Prepare(rb, 0, 3, 3500.0, 1, 8) == NULL);
+        assert(ctp.Prepare(64, 0, 0, 3500.0, 1, 8) == NULL);
+        assert(ctp.Prepare(-1, 0, 0, 3500.0, 1, 8) == NULL);
+    }
+
+    // XTP
+    XTPCache xtp;
+    assert(xtp.Init(64));
+    {
+        XTPOrderInsertInfo field;
+        TradeUtil::XTPOrderTemplateAdapter::Build(field, "600000", XTP_MKT_SH_A, XTP_SIDE_BUY, XTP_POSITION_EFFECT_INIT, XTP_BUSINESS_TYPE_CASH);
+        assert(xtp.SetTemplate(rb, 0, 0, field));
+        XTPOrderInsertInfo* order = xtp.Prepare(rb, 0, 0, 10.5, 100, 42);
+        assert(order != NULL && strcmp(order->ticker, "600000") == 0);
+        assert(order->market == XTP_MKT_SH_A && order->side == XTP_SIDE_BUY && order->price_type == XTP_PRICE_LIMIT);
+        assert(order->price == 10.5 && order->quantity == 100 && order->order_client_id == 42);
+    }
+
+    // YD：YDInstrument指针作为Context
+    YDCache yd;
+    assert(yd.Init(64));
+    static int instrument = 0;
+    {
+        YDInputOrder field;
+        TradeUtil::YDOrderTemplateAdapter::Build(field, 0, 1);
+        assert(yd.SetTemplate(ag, 0, 1, field, &instrument));
+        YDInputOrder* order = yd.Prepare(ag, 0, 1, 5600.0, 2, 99);
+        assert(order != NULL && order->OffsetFlag == YD_OF_Close && order->Direction == YD_D_Buy);
+        assert(order->Price == 5600.0 && order->OrderVolume == 2 && order->OrderRef == 99);
+        assert(yd.GetContext(ag, 0, 1) == &instrument && yd.GetContext(rb, 0, 1) == NULL);
+        // 柜台回写ErrorNo不影响下次使用
+        order->ErrorNo = 5;
+        order = yd.Prepare(ag, 0, 1, 5601.0, 1, 100);
+        assert(order->OrderRef == 100 && order->HedgeFlag == YD_HF_Speculation);
+    }
+
+    // 信号到调用报单接口的耗时：逐字段构造对比模板改写
+    const int N = 1000000;
+    TimeUtil::HRTimer timer;
+    uint32_t clientID = 1000;
+    uint64_t start, end;
+
+    {
+        CThostFtdcInputOrderField field;
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            BuildCTPOrder(field, "rb2410", 3500.0 + (i & 7), 1 + (i & 3), clientID++);
+            ReqOrderInsert(&field, i);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "CTP Build Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            ReqOrderInsert(ctp.Prepare(rb, 1, 2, 3500.0 + (i & 7), 1 + (i & 3), clientID++), i);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "CTP Template Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+    }
+
+    {
+        XTPOrderInsertInfo field;
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            BuildXTPOrder(field, "600000", 10.5 + (i & 7), 100 * (1 + (i & 3)), clientID++);
+            InsertOrder(&field, 1);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "XTP Build Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            InsertOrder(xtp.Prepare(rb, 0, 0, 10.5 + (i & 7), 100 * (1 + (i & 3)), clientID++), 1);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "XTP Template Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+    }
+
+    {
+        YDInputOrder field;
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            BuildYDOrder(field, 5600.0 + (i & 7), 1 + (i & 3), clientID++);
+            insertOrder(&field, &instrument);
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "YD Build Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+        start = timer.GetTimeNs();
+        for(int i = 0; i < N; i++)
+        {
+            insertOrder(yd.Prepare(ag, 0, 1, 5600.0 + (i & 7), 1 + (i & 3), clientID++), yd.GetContext(ag, 0, 1));
+        }
+        end = timer.GetTimeNs();
+        fprintf(stderr, "YD Template Signal-to-API Latency: %.1f ns/order\n", (double)(end - start) / N);
+    }
+    fprintf(stderr, "Sink: %lu\n", g_Sink);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 OrderTemplateTest.cpp -o test -I. -I../../FMTLogger/include -I../../CTP/6.7.8/include -I../../XTP/2.2.36.1/include -I../../YD/1.486.96/include
@@ -0,0 +1,623 @@
+#ifndef POSITIONENGINE_HPP
+#define POSITIONENGINE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <string>
+#include "libipc/shm.h"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+namespace TradeUtil
+{
+
+enum EPositionDirection
+{
+    EPOSITION_LONG = 0,
+    EPOSITION_SHORT = 1
+};
+
+// 平仓不指定今昨时先平昨再平今
+enum EPositionOffset
+{
+    EPOSITION_OPEN = 0,
+    EPOSITION_CLOSE = 1,
+    EPOSITION_CLOSE_TODAY = 2,
+    EPOSITION_CLOSE_YESTERDAY = 3
+};
+
+// 单合约持仓记录，即共享内存快照中的记录格式
+struct TPositionRecord
+{
+    int32_t InstrumentSlot;
+    int32_t LongVolume;
+    int32_t LongTodayVolume;
+    int32_t LongYesterdayVolume;
+    int32_t ShortVolume;
+    int32_t ShortTodayVolume;
+    int32_t ShortYesterdayVolume;
+    int32_t Reserved;
+    double LongCost;        // 多头持仓成本，昨仓按昨结算价
+    double ShortCost;
+    double LastPrice;
+    double PositionProfit;  // 盯市持仓盈亏
+    double CloseProfit;     // 平仓盈亏
+    double Margin;          // 按最新价估算的保证金
+    double Commission;
+};
+
+// 共享内存快照头，其后紧跟InstrumentCount条TPositionRecord
+struct alignas(64) TPositionSnapshotHeader
+{
+    std::atomic<uint32_t> Sequence;
+    int32_t InstrumentCount;
+    uint64_t UpdateNs;
+    double PositionProfit;
+    double CloseProfit;
+    double Margin;
+    double Commission;
+};
+
+// 单账户持仓盈亏引擎
+// 各字段按合约序号以数组结构(SoA)存放，成交与行情为O(1)增量更新，
+// Recompute对全部合约做一次可向量化的全量重算，用于消除增量累计误差
+class PositionEngine
+{
+public:
+    PositionEngine(): m_Capacity(0), m_Memory(NULL), m_DirtyCount(0), m_Snapshot(NULL)
+    {
+        m_TotalPositionProfit = 0.0;
+        m_TotalCloseProfit = 0.0;
+        m_TotalMargin = 0.0;
+        m_TotalCommission = 0.0;
+    }
+
+    ~PositionEngine()
+    {
+        free(m_Memory);
+    }
+
+    bool Init(int capacity)
+    {
+        free(m_Memory);
+        // 每个数组按8个double对齐，便于AVX-512整块加载
+        m_Capacity = (capacity + 7) & ~7;
+        size_t bytes = sizeof(double) * m_Capacity * DOUBLE_ARRAY_COUNT + sizeof(int32_t) * m_Capacity * INT_ARRAY_COUNT;
+        if(posix_memalign(&m_Memory, 64, bytes) != 0)
+        {
+            m_Memory = NULL;
+            return false;
+        }
+        memset(m_Memory, 0, bytes);
+        double* base = (double*)m_Memory;
+        m_Multiplier = base + m_Capacity * 0;
+        m_LastPrice = base + m_Capacity * 1;
+        m_LongVolume = base + m_Capacity * 2;
+        m_ShortVolume = base + m_Capacity * 3;
+        m_LongCost = base + m_Capacity * 4;
+        m_ShortCost = base + m_Capacity * 5;
+        m_LongMarginByMoney = base + m_Capacity * 6;
+        m_LongMarginByVolume = base + m_Capacity * 7;
+        m_ShortMarginByMoney = base + m_Capacity * 8;
+        m_ShortMarginByVolume = base + m_Capacity * 9;
+        m_PositionProfit = base + m_Capacity * 10;
+        m_Margin = base + m_Capacity * 11;
+        m_CloseProfit = base + m_Capacity * 12;
+        m_Commission = base + m_Capacity * 13;
+        int32_t* intBase = (int32_t*)(base + m_Capacity * DOUBLE_ARRAY_COUNT);
+        m_TodayVolume[EPOSITION_LONG] = intBase + m_Capacity * 0;
+        m_TodayVolume[EPOSITION_SHORT] = intBase + m_Capacity * 1;
+        m_YesterdayVolume[EPOSITION_LONG] = intBase + m_Capacity * 2;
+        m_YesterdayVolume[EPOSITION_SHORT] = intBase + m_Capacity * 3;
+        m_DirtyFlag = intBase + m_Capacity * 4;
+        m_DirtyList = intBase + m_Capacity * 5;
+        m_ChangedFlag = intBase + m_Capacity * 6;
+        m_DirtyCount = 0;
+        m_TotalPositionProfit = 0.0;
+        m_TotalCloseProfit = 0.0;
+        m_TotalMargin = 0.0;
+        m_TotalCommission = 0.0;
+        return true;
+    }
+
+    void SetInstrument(int slot, double multiplier, double lastPrice)
+    {
+        if(!ValidSlot(slot))
+        {
+            return;
+        }
+        m_Multiplier[slot] = multiplier;
+        m_LastPrice[slot] = lastPrice;
+        UpdateSlot(slot);
+    }
+
+    void SetMarginRate(int slot, double longByMoney, double longByVolume, double shortByMoney, double shortByVolume)
+    {
+        if(!ValidSlot(slot))
+        {
+            return;
+        }
+        m_LongMarginByMoney[slot] = longByMoney;
+        m_LongMarginByVolume[slot] = longByVolume;
+        m_ShortMarginByMoney[slot] = shortByMoney;
+        m_ShortMarginByVolume[slot] = shortByVolume;
+        UpdateSlot(slot);
+    }
+
+    // 初始化持仓，cost为持仓成本金额（已乘合约乘数）
+    void SetPosition(int slot, int direction, int32_t todayVolume, int32_t yesterdayVolume, double cost)
+    {
+        if(!ValidSlot(slot))
+        {
+            return;
+        }
+        direction &= 1;
+        m_TodayVolume[direction][slot] = todayVolume;
+        m_YesterdayVolume[direction][slot] = yesterdayVolume;
+        Volume(direction)[slot] = todayVolume + yesterdayVolume;
+        Cost(direction)[slot] = cost;
+        UpdateSlot(slot);
+    }
+
+    // 成交回报，direction为成交买卖方向：买开、买平分别作用于多头、空头
+    force_inline inline void OnTrade(int slot, int direction, int offset, double price, int32_t volume, double commission)
+    {
+        if(!ValidSlot(slot) || volume <= 0)
+        {
+            return;
+        }
+        direction &= 1;
+        const double amount = price * volume * m_Multiplier[slot];
+        if(offset == EPOSITION_OPEN)
+        {
+            m_TodayVolume[direction][slot] += volume;
+            Volume(direction)[slot] += volume;
+            Cost(direction)[slot] += amount;
+        }
+        else
+        {
+            const int side = direction ^ 1;
+            int32_t& today = m_TodayVolume[side][slot];
+            int32_t& yesterday = m_YesterdayVolume[side][slot];
+            if(offset == EPOSITION_CLOSE_TODAY)
+            {
+                today -= volume;
+            }
+            else if(offset == EPOSITION_CLOSE_YESTERDAY)
+            {
+                yesterday = yesterday > volume ? yesterday - volume : 0;
+            }
+            else
+            {
+                int32_t fromYesterday = yesterday < volume ? yesterday : volume;
+                yesterday -= fromYesterday;
+                today -= volume - fromYesterday;
+            }
+            double& held = Volume(side)[slot];
+            double& cost = Cost(side)[slot];
+            double released = held > 0.0 ? cost * volume / held : 0.0;
+            double profit = side == EPOSITION_LONG ? amount - released : released - amount;
+            held -= volume;
+            cost = held > 0.0 ? cost - released : 0.0;
+            m_CloseProfit[slot] += profit;
+            m_TotalCloseProfit += profit;
+        }
+        m_Commission[slot] += commission;
+        m_TotalCommission += commission;
+        UpdateSlot(slot);
+    }
+
+    // 行情更新，按价差增量调整持仓盈亏和保证金
+    force_inline inline void OnTick(int slot, double lastPrice)
+    {
+        if(!ValidSlot(slot))
+        {
+            return;
+        }
+        const double delta = (lastPrice - m_LastPrice[slot]) * m_Multiplier[slot];
+        const double profit = delta * (m_LongVolume[slot] - m_ShortVolume[slot]);
+        const double margin = delta * (m_LongVolume[slot] * m_LongMarginByMoney[slot] +
+                                       m_ShortVolume[slot] * m_ShortMarginByMoney[slot]);
+        m_LastPrice[slot] = lastPrice;
+        m_PositionProfit[slot] += profit;
+        m_Margin[slot] += margin;
+        m_TotalPositionProfit += profit;
+        m_TotalMargin += margin;
+        MarkDirty(slot);
+    }
+
+    // 全量重算持仓盈亏与保证金，循环无分支、无别名，可由编译器向量化；结果有变化的合约待发布
+    void Recompute()
+    {
+        const int count = m_Capacity;
+        const double* __restrict multiplier = m_Multiplier;
+        const double* __restrict lastPrice = m_LastPrice;
+        const double* __restrict longVolume = m_LongVolume;
+        const double* __restrict shortVolume = m_ShortVolume;
+        const double* __restrict longCost = m_LongCost;
+        const double* __restrict shortCost = m_ShortCost;
+        const double* __restrict longByMoney = m_LongMarginByMoney;
+        const double* __restrict longByVolume = m_LongMarginByVolume;
+        const double* __restrict shortByMoney = m_ShortMarginByMoney;
+        const double* __restrict shortByVolume = m_ShortMarginByVolume;
+        double* __restrict positionProfit = m_PositionProfit;
+        double* __restrict margin = m_Margin;
+        int32_t* __restrict changed = m_ChangedFlag;
+        // 按8路分别累加，避免浮点求和的顺序依赖阻止向量化
+        double sumProfit[8] = {0.0};
+        double sumMargin[8] = {0.0};
+        for(int i = 0; i < count; i += 8)
+        {
+            for(int j = 0; j < 8; j++)
+            {
+                int k = i + j;
+                double value = lastPrice[k] * multiplier[k];
+                double profit = (value * longVolume[k] - longCost[k]) + (shortCost[k] - value * shortVolume[k]);
+                double used = longVolume[k] * (value * longByMoney[k] + longByVolume[k]) +
+                              shortVolume[k] * (value * shortByMoney[k] + shortByVolume[k]);
+                changed[k] = (profit != positionProfit[k]) | (used != margin[k]);
+                positionProfit[k] = profit;
+                margin[k] = used;
+                sumProfit[j] += profit;
+                sumMargin[j] += used;
+            }
+        }
+        double totalProfit = 0.0;
+        double totalMargin = 0.0;
+        for(int j = 0; j < 8; j++)
+        {
+            totalProfit += sumProfit[j];
+            totalMargin += sumMargin[j];
+        }
+        m_TotalPositionProfit = totalProfit;
+        m_TotalMargin = totalMargin;
+        for(int i = 0; i < count; i++)
+        {
+            if(changed[i])
+            {
+                MarkDirty(i);
+            }
+        }
+    }
+
+    bool GetRecord(int slot, TPositionRecord& record) const
+    {
+        if(!ValidSlot(slot))
+        {
+            return false;
+        }
+        record.InstrumentSlot = slot;
+        record.LongVolume = (int32_t)m_LongVolume[slot];
+        record.LongTodayVolume = m_TodayVolume[EPOSITION_LONG][slot];
+        record.LongYesterdayVolume = m_YesterdayVolume[EPOSITION_LONG][slot];
+        record.ShortVolume = (int32_t)m_ShortVolume[slot];
+        record.ShortTodayVolume = m_TodayVolume[EPOSITION_SHORT][slot];
+        record.ShortYesterdayVolume = m_YesterdayVolume[EPOSITION_SHORT][slot];
+        record.Reserved = 0;
+        record.LongCost = m_LongCost[slot];
+        record.ShortCost = m_ShortCost[slot];
+        record.LastPrice = m_LastPrice[slot];
+        record.PositionProfit = m_PositionProfit[slot];
+        record.CloseProfit = m_CloseProfit[slot];
+        record.Margin = m_Margin[slot];
+        record.Commission = m_Commission[slot];
+        return true;
+    }
+
+    double GetPositionProfit() const
+    {
+        return m_TotalPositionProfit;
+    }
+
+    double GetCloseProfit() const
+    {
+        return m_TotalCloseProfit;
+    }
+
+    double GetMargin() const
+    {
+        return m_TotalMargin;
+    }
+
+    double GetCommission() const
+    {
+        return m_TotalCommission;
+    }
+
+    // 创建共享内存快照区，其他进程通过PositionSnapshotReader读取
+    bool OpenSnapshot(const char* name)
+    {
+        size_t size = sizeof(TPositionSnapshotHeader) + sizeof(TPositionRecord) * m_Capacity;
+        if(!m_SnapshotHandle.acquire(name, size))
+        {
+            return false;
+        }
+        m_Snapshot = (TPositionSnapshotHeader*)m_SnapshotHandle.get();
+        m_Snapshot->InstrumentCount = m_Capacity;
+        // 首次发布写入全部记录
+        for(int i = 0; i < m_Capacity; i++)
+        {
+            MarkDirty(i);
+        }
+        return true;
+    }
+
+    // 仅写出自上次发布以来变化的合约记录
+    void PublishSnapshot(uint64_t nowNs)
+    {
+        if(m_Snapshot == NULL)
+        {
+            return;
+        }
+        TPositionRecord* records = (TPositionRecord*)(m_Snapshot + 1);
+        uint32_t sequence = m_Snapshot->Sequence.load(std::memory_order_relaxed);
+        m_Snapshot->Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for(int i = 0; i < m_DirtyCount; i++)
+        {
+            int slot = m_DirtyList[i];
+            GetRecord(slot, records[slot]);
+            m_DirtyFlag[slot] = 0;
+        }
+        m_DirtyCount = 0;
+        m_Snapshot->UpdateNs = nowNs;
+        m_Snapshot->PositionProfit = m_TotalPositionProfit;
+        m_Snapshot->CloseProfit = m_TotalCloseProfit;
+        m_Snapshot->Margin = m_TotalMargin;
+        m_Snapshot->Commission = m_TotalCommission;
+        m_Snapshot->Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+#ifdef YD_DATA_STRUCT_H
+    void SetPrePosition(int slot, const YDPrePosition& field)
+    {
+        if(!ValidSlot(slot))
+        {
+            return;
+        }
+        int direction = field.PositionDirection == YD_PD_Long ? EPOSITION_LONG : EPOSITION_SHORT;
+        double multiplier = field.m_pInstrument != NULL ? field.m_pInstrument->Multiple : m_Multiplier[slot];
+        SetPosition(slot, direction, 0, field.PrePosition, field.PrePosition * field.PreSettlementPrice * multiplier);
+    }
+
+    void SetMarginRate(int slot, const YDMarginRate& field)
+    {
+        SetMarginRate(slot, field.LongMarginRatioByMoney, field.LongMarginRatioByVolume,
+                      field.ShortMarginRatioByMoney, field.ShortMarginRatioByVolume);
+    }
+
+    void OnTrade(int slot, const YDTrade& field)
+    {
+        static const uint8_t OffsetTable[] =
+        {
+            EPOSITION_OPEN,             // YD_OF_Open
+            EPOSITION_CLOSE,            // YD_OF_Close
+            EPOSITION_CLOSE,            // YD_OF_ForceClose
+            EPOSITION_CLOSE_TODAY,      // YD_OF_CloseToday
+            EPOSITION_CLOSE_YESTERDAY   // YD_OF_CloseYesterday
+        };
+        int offset = (unsigned)field.OffsetFlag < sizeof(OffsetTable) ? OffsetTable[(int)field.OffsetFlag] : (int)EPOSITION_CLOSE;
+        OnTrade(slot, field.Direction == YD_D_Buy ? EPOSITION_LONG : EPOSITION_SHORT, offset,
+                field.Price, field.Volume, field.Commission);
+    }
+#endif
+
+#ifdef THOST_FTDCSTRUCT_H
+    // 上期所、能源中心今昨仓分两条记录返回，其他交易所一条记录含今仓量
+    void AddPosition(int slot, const CThostFtdcInvestorPositionField& field)
+    {
+        if(!ValidSlot(slot) || field.PosiDirection == THOST_FTDC_PD_Net)
+        {
+            return;
+        }
+        int direction = field.PosiDirection == THOST_FTDC_PD_Long ? EPOSITION_LONG : EPOSITION_SHORT;
+        int32_t today = m_TodayVolume[direction][slot];
+        int32_t yesterday = m_YesterdayVolume[direction][slot];
+        if(field.PositionDate == THOST_FTDC_PSD_History)
+        {
+            yesterday += field.Position;
+        }
+        else
+        {
+            today += field.TodayPosition;
+            yesterday += field.Position - field.TodayPosition;
+        }
+        SetPosition(slot, direction, today, yesterday, Cost(direction)[slot] + field.PositionCost);
+    }
+
+    void OnTrade(int slot, const CThostFtdcTradeField& field)
+    {
+        int offset = EPOSITION_CLOSE;
+        if(field.OffsetFlag == THOST_FTDC_OF_Open)
+        {
+            offset = EPOSITION_OPEN;
+        }
+        else if(field.OffsetFlag == THOST_FTDC_OF_CloseToday)
+        {
+            offset = EPOSITION_CLOSE_TODAY;
+        }
+        else if(field.OffsetFlag == THOST_FTDC_OF_CloseYesterday)
+        {
+            offset = EPOSITION_CLOSE_YESTERDAY;
+        }
+        OnTrade(slot, field.Direction == THOST_FTDC_D_Buy ? EPOSITION_LONG : EPOSITION_SHORT, offset,
+                field.Price, field.Volume, 0.0);
+    }
+#endif
+
+#ifdef _XOMS_API_STRUCT_H_
+    // 现货买入计入今仓，卖出优先扣减昨仓
+    void OnTrade(int slot, const XTPTradeReport& field, double commission)
+    {
+        int direction = field.side == XTP_SIDE_BUY ? EPOSITION_LONG : EPOSITION_SHORT;
+        int offset = direction == EPOSITION_LONG ? EPOSITION_OPEN : EPOSITION_CLOSE;
+        if(field.position_effect == XTP_POSITION_EFFECT_OPEN)
+        {
+            offset = EPOSITION_OPEN;
+        }
+        else if(field.position_effect == XTP_POSITION_EFFECT_CLOSE)
+        {
+            offset = EPOSITION_CLOSE;
+        }
+        OnTrade(slot, direction, offset, field.price, (int32_t)field.quantity, commission);
+    }
+#endif
+protected:
+    enum
+    {
+        DOUBLE_ARRAY_COUNT = 14,
+        INT_ARRAY_COUNT = 7
+    };
+
+    force_inline inline bool ValidSlot(int slot) const
+    {
+        return (unsigned)slot < (unsigned)m_Capacity;
+    }
+
+    force_inline inline double* Volume(int direction)
+    {
+        return direction == EPOSITION_LONG ? m_LongVolume : m_ShortVolume;
+    }
+
+    force_inline inline double* Cost(int direction)
+    {
+        return direction == EPOSITION_LONG ? m_LongCost : m_ShortCost;
+    }
+
+    force_inline inline void MarkDirty(int slot)
+    {
+        if(m_DirtyFlag[slot] == 0)
+        {
+            m_DirtyFlag[slot] = 1;
+            m_DirtyList[m_DirtyCount++] = slot;
+        }
+    }
+
+    // 单合约重算，并按差值调整汇总
+    force_inline inline void UpdateSlot(int slot)
+    {
+        double value = m_LastPrice[slot] * m_Multiplier[slot];
+        double profit = (value * m_LongVolume[slot] - m_LongCost[slot]) + (m_ShortCost[slot] - value * m_ShortVolume[slot]);
+        double used = m_LongVolume[slot] * (value * m_LongMarginByMoney[slot] + m_LongMarginByVolume[slot]) +
+                      m_ShortVolume[slot] * (value * m_ShortMarginByMoney[slot] + m_ShortMarginByVolume[slot]);
+        m_TotalPositionProfit += profit - m_PositionProfit[slot];
+        m_TotalMargin += used - m_Margin[slot];
+        m_PositionProfit[slot] = profit;
+        m_Margin[slot] = used;
+        MarkDirty(slot);
+    }
+protected:
+    int m_Capacity;
+    void* m_Memory;
+    double* m_Multiplier;
+    double* m_LastPrice;
+    double* m_LongVolume;
+    double* m_ShortVolume;
+    double* m_LongCost;
+    double* m_ShortCost;
+    double* m_LongMarginByMoney;
+    double* m_LongMarginByVolume;
+    double* m_ShortMarginByMoney;
+    double* m_ShortMarginByVolume;
+    double* m_PositionProfit;
+    double* m_Margin;
+    double* m_CloseProfit;
+    double* m_Commission;
+    int32_t* m_TodayVolume[2];
+    int32_t* m_YesterdayVolume[2];
+    int32_t* m_DirtyFlag;
+    int32_t* m_DirtyList;
+    int32_t* m_ChangedFlag;     // Recompute的逐合约变化标记
+    int m_DirtyCount;
+    double m_TotalPositionProfit;
+    double m_TotalCloseProfit;
+    double m_TotalMargin;
+    double m_TotalCommission;
+    ipc::shm::handle m_SnapshotHandle;
+    TPositionSnapshotHeader* m_Snapshot;
+private:
+    PositionEngine(const PositionEngine &);
+    PositionEngine &operator=(const PositionEngine &);
+};
+
+// 持仓快照读取端，可在任意进程中使用
+class PositionSnapshotReader
+{
+public:
+    PositionSnapshotReader(): m_Snapshot(NULL)
+    {
+    }
+
+    // 先只读映射头部取得InstrumentCount，再按与写端相同的大小打开，
+    // cpp-ipc的引用计数位于区域末尾，大小不一致会写到记录区或越过文件末尾
+    bool Open(const char* name)
+    {
+        std::string path = std::string("/") + name;
+        int fd = shm_open(path.c_str(), O_RDONLY, 0);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        int32_t count = 0;
+        if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TPositionSnapshotHeader))
+        {
+            void* header = mmap(NULL, sizeof(TPositionSnapshotHeader), PROT_READ, MAP_SHARED, fd, 0);
+            if(header != MAP_FAILED)
+            {
+                count = ((const TPositionSnapshotHeader*)header)->InstrumentCount;
+                munmap(header, sizeof(TPositionSnapshotHeader));
+            }
+        }
+        close(fd);
+        // 写端尚未写入头部
+        if(count <= 0)
+        {
+            return false;
+        }
+        size_t size = sizeof(TPositionSnapshotHeader) + sizeof(TPositionRecord) * count;
+        if((size_t)st.st_size < size || !m_SnapshotHandle.acquire(name, size, ipc::shm::open))
+        {
+            return false;
+        }
+        m_Snapshot = (TPositionSnapshotHeader*)m_SnapshotHandle.get();
+        return true;
+    }
+
+    // 读取汇总及指定合约记录，写端发布期间自动重试
+    bool Read(int slot, TPositionRecord& record, double& positionProfit, double& closeProfit, double& margin) const
+    {
+        if(m_Snapshot == NULL || (unsigned)slot >= (unsigned)m_Snapshot->InstrumentCount)
+        {
+            return false;
+        }
+        const TPositionRecord* records = (const TPositionRecord*)(m_Snapshot + 1);
+        uint32_t begin, end;
+        do
+        {
+            begin = m_Snapshot->Sequence.load(std::memory_order_acquire);
+            memcpy(&record, &records[slot], sizeof(record));
+            positionProfit = m_Snapshot->PositionProfit;
+            closeProfit = m_Snapshot->CloseProfit;
+            margin = m_Snapshot->Margin;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = m_Snapshot->Sequence.load(std::memory_order_relaxed);
+        } while((begin & 1) || begin != end);
+        return true;
+    }
+protected:
+    ipc::shm::handle m_SnapshotHandle;
+    TPositionSnapshotHeader* m_Snapshot;
+};
+
+}
+
+#endif // POSITIONENGINE_HPP
@@ -0,0 +1,213 @@
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include "ThostFtdcUserApiStruct.h"
+#include "xoms_api_struct.h"
+#include "ydDataStruct.h"
+#include "PositionEngine.hpp"
+#include "HRTimer.hpp"
+
+static bool Near(double a, double b)
+{
+    return fabs(a - b) < 1e-6 * (1.0 + fabs(a) + fabs(b));
+}
+
+// 模拟增量更新的累计误差
+class DriftEngine : public TradeUtil::PositionEngine
+{
+public:
+    void Drift(int slot, double profit)
+    {
+        m_PositionProfit[slot] += profit;
+        m_TotalPositionProfit += profit;
+        MarkDirty(slot);
+    }
+
+    int GetDirtyCount() const
+    {
+        return m_DirtyCount;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    DriftEngine engine;
+    assert(engine.Init(4096));
+    const int rb = 0, au = 1, stock = 2;
+    engine.SetInstrument(rb, 10.0, 3500.0);
+    engine.SetInstrument(au, 1000.0, 450.0);
+    engine.SetInstrument(stock, 1.0, 10.0);
+
+    // YD昨仓与保证金率
+    {
+        YDInstrument instrument;
+        memset(&instrument, 0, sizeof(instrument));
+        instrument.Multiple = 10;
+        YDPrePosition prePosition;
+        memset(&prePosition, 0, sizeof(prePosition));
+        prePosition.PositionDirection = YD_PD_Long;
+        prePosition.PrePosition = 5;
+        prePosition.PreSettlementPrice = 3480.0;
+        prePosition.m_pInstrument = &instrument;
+        engine.SetPrePosition(rb, prePosition);
+        YDMarginRate marginRate;
+        memset(&marginRate, 0, sizeof(marginRate));
+        marginRate.LongMarginRatioByMoney = 0.1;
+        marginRate.ShortMarginRatioByMoney = 0.1;
+        engine.SetMarginRate(rb, marginRate);
+
+        TradeUtil::TPositionRecord record;
+        engine.GetRecord(rb, record);
+        assert(record.LongYesterdayVolume == 5 && Near(record.PositionProfit, 5 * 20.0 * 10.0));
+        assert(Near(record.Margin, 5 * 3500.0 * 10.0 * 0.1));
+
+        // 买开2手，卖平3手先平昨
+        YDTrade trade;
+        memset(&trade, 0, sizeof(trade));
+        trade.Direction = YD_D_Buy;
+        trade.OffsetFlag = YD_OF_Open;
+        trade.Price = 3500.0;
+        trade.Volume = 2;
+        trade.Commission = 1.0;
+        engine.OnTrade(rb, trade);
+        trade.Direction = YD_D_Sell;
+        trade.OffsetFlag = YD_OF_Close;
+        trade.Price = 3520.0;
+        trade.Volume = 3;
+        engine.OnTrade(rb, trade);
+        engine.GetRecord(rb, record);
+        assert(record.LongVolume == 4 && record.LongTodayVolume == 2 && record.LongYesterdayVolume == 2);
+        assert(Near(record.Commission, 2.0));
+    }
+
+    // CTP今昨分条持仓
+    {
+        CThostFtdcInvestorPositionField position;
+        memset(&position, 0, sizeof(position));
+        position.PosiDirection = THOST_FTDC_PD_Short;
+        position.PositionDate = THOST_FTDC_PSD_History;
+        position.Position = 3;
+        position.PositionCost = 3 * 452.0 * 1000.0;
+        engine.AddPosition(au, position);
+        position.PositionDate = THOST_FTDC_PSD_Today;
+        position.Position = 1;
+        position.TodayPosition = 1;
+        position.PositionCost = 451.0 * 1000.0;
+        engine.AddPosition(au, position);
+        CThostFtdcTradeField trade;
+        memset(&trade, 0, sizeof(trade));
+        trade.Direction = THOST_FTDC_D_Buy;
+        trade.OffsetFlag = THOST_FTDC_OF_CloseToday;
+        trade.Price = 449.0;
+        trade.Volume = 1;
+        engine.OnTrade(au, trade);
+        TradeUtil::TPositionRecord record;
+        engine.GetRecord(au, record);
+        assert(record.ShortVolume == 3 && record.ShortTodayVolume == 0 && record.ShortYesterdayVolume == 3);
+        // 平仓按持仓均价释放成本：(3 * 452 + 451) / 4 - 449
+        assert(Near(record.CloseProfit, 2750.0));
+    }
+
+    // XTP现货
+    {
+        XTPTradeReport trade;
+        memset(&trade, 0, sizeof(trade));
+        trade.side = XTP_SIDE_BUY;
+        trade.price = 10.0;
+        trade.quantity = 1000;
+        engine.OnTrade(stock, trade, 5.0);
+        TradeUtil::TPositionRecord record;
+        engine.GetRecord(stock, record);
+        assert(record.LongVolume == 1000 && record.LongTodayVolume == 1000);
+    }
+
+    // 增量与全量重算一致
+    engine.OnTick(rb, 3550.0);
+    engine.OnTick(au, 448.0);
+    engine.OnTick(stock, 10.2);
+    double profit = engine.GetPositionProfit();
+    double margin = engine.GetMargin();
+    engine.Recompute();
+    assert(Near(profit, engine.GetPositionProfit()));
+    assert(Near(margin, engine.GetMargin()));
+
+    // 共享内存快照
+    {
+        const char* name = "PositionEngineTest";
+        assert(engine.OpenSnapshot(name));
+        engine.PublishSnapshot(1);
+        TradeUtil::PositionSnapshotReader reader;
+        assert(!reader.Open("PositionEngineTestMissing"));
+        assert(reader.Open(name));
+        TradeUtil::TPositionRecord record;
+        double positionProfit, closeProfit, usedMargin;
+        assert(reader.Read(stock, record, positionProfit, closeProfit, usedMargin));
+        assert(record.LongVolume == 1000 && Near(positionProfit, engine.GetPositionProfit()));
+        engine.OnTick(stock, 10.5);
+        engine.PublishSnapshot(2);
+        assert(reader.Read(stock, record, positionProfit, closeProfit, usedMargin));
+        assert(Near(record.LastPrice, 10.5));
+        // 全量重算的结果在下次发布时写出
+        double expected = record.PositionProfit;
+        engine.Drift(stock, 100.0);
+        engine.PublishSnapshot(3);
+        // 只有结果变化的合约待发布
+        engine.Recompute();
+        assert(engine.GetDirtyCount() == 1);
+        engine.PublishSnapshot(4);
+        assert(reader.Read(stock, record, positionProfit, closeProfit, usedMargin));
+        assert(Near(record.PositionProfit, expected) && Near(positionProfit, engine.GetPositionProfit()));
+    }
+
+    // 平昨超过昨仓时昨仓置0
+    {
+        TradeUtil::PositionEngine clamp;
+        assert(clamp.Init(8));
+        clamp.SetInstrument(0, 10.0, 3500.0);
+        clamp.SetPosition(0, TradeUtil::EPOSITION_LONG, 2, 1, 3 * 3500.0 * 10.0);
+        clamp.OnTrade(0, TradeUtil::EPOSITION_SHORT, TradeUtil::EPOSITION_CLOSE_YESTERDAY, 3500.0, 2, 0.0);
+        TradeUtil::TPositionRecord record;
+        clamp.GetRecord(0, record);
+        assert(record.LongYesterdayVolume == 0 && record.LongTodayVolume == 2 && record.LongVolume == 1);
+    }
+
+    // 延迟测试
+    TimeUtil::HRTimer timer;
+    const int N = 1000000;
+    for(int i = 0; i < 4096; i++)
+    {
+        engine.SetInstrument(i, 10.0, 100.0);
+        engine.SetMarginRate(i, 0.1, 0.0, 0.1, 0.0);
+        engine.SetPosition(i, i & 1, 10, 10, 20 * 100.0 * 10.0);
+    }
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        engine.OnTick(i & 4095, 100.0 + (i & 7));
+    }
+    uint64_t end = timer.GetTimeNs();
+    fprintf(stderr, "PositionEngine OnTick Latency: %.1f ns\n", (double)(end - start) / N);
+    start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        engine.OnTrade(i & 4095, i & 1, (i >> 1) & 1, 100.0, 1, 0.1);
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "PositionEngine OnTrade Latency: %.1f ns\n", (double)(end - start) / N);
+    const int M = 1000;
+    start = timer.GetTimeNs();
+    for(int i = 0; i < M; i++)
+    {
+        engine.Recompute();
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "PositionEngine Recompute 4096 Instruments Latency: %.1f ns\n", (double)(end - start) / M);
+    start = timer.GetTimeNs();
+    engine.PublishSnapshot(3);
+    end = timer.GetTimeNs();
+    fprintf(stderr, "PositionEngine PublishSnapshot Latency: %lu ns\n", end - start);
+    return 0;
+}
+
+// g++ -std=c++11 -O3 -march=native PositionEngineTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../CPP-IPC/include -I../../CTP/6.7.8/include -I../../XTP/2.2.36.1/include -I../../YD/1.486.96/include -L../../CPP-IPC/lib -lipc -lrt
@@ -0,0 +1,497 @@
+#ifndef RISKENGINE_HPP
+#define RISKENGINE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+#ifndef likely
+#define likely(x) __builtin_expect(!!(x), 1)
+#endif
+
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+namespace TradeUtil
+{
+
+// 风控检查结果，多项同时不通过时返回编号最小的一项
+enum ERiskCode
+{
+    ERISK_OK = 0,
+    ERISK_INVALID_SLOT = 1,
+    ERISK_PRICE_BAND = 2,
+    ERISK_ORDER_VOLUME = 3,
+    ERISK_POSITION_LIMIT = 4,
+    ERISK_NOTIONAL_LIMIT = 5,
+    ERISK_ORDER_RATE = 6,
+    ERISK_SELF_TRADE = 7,
+    ERISK_WORKING_LIMIT = 8,
+    ERISK_CODE_COUNT
+};
+
+enum ERiskDirection
+{
+    ERISK_BUY = 0,
+    ERISK_SELL = 1
+};
+
+enum ERiskOffset
+{
+    ERISK_OPEN = 0,
+    ERISK_CLOSE = 1
+};
+
+// 柜台无关的报单描述，由各柜台适配函数从报单结构体转换得到
+struct TRiskOrder
+{
+    int32_t InstrumentSlot;
+    int32_t AccountSlot;
+    uint8_t Direction;
+    uint8_t Offset;
+    uint16_t Reserved;
+    int32_t Volume;
+    double Price;
+    uint64_t OrderKey;    // 本地报单编号，成交和撤单回报用于定位挂单
+};
+
+struct TInstrumentRiskLimit
+{
+    double LowerPrice;      // 价格下限，通常取跌停价
+    double UpperPrice;      // 价格上限，通常取涨停价
+    double Multiplier;      // 合约乘数，股票为1
+    int32_t MaxOrderVolume; // 单笔最大报单量
+    int32_t MaxPosition;    // 单边最大持仓，含开仓挂单
+};
+
+struct TAccountRiskLimit
+{
+    double MaxNotional;         // 开仓挂单最大名义金额
+    int32_t MaxOrderPerWindow;  // 流控窗口内最大报单笔数
+    uint64_t WindowNs;          // 流控窗口长度
+};
+
+// 单账户单合约风控状态，按缓存行对齐避免伪共享
+struct alignas(64) TPositionRiskState
+{
+    enum { MAX_WORKING = 8 };
+    int32_t Position[2];        // 多头、空头持仓
+    int32_t OpenFrozen[2];      // 多头、空头开仓冻结
+    int32_t CloseFrozen[2];     // 多头、空头平仓冻结
+    int32_t WorkingCount[2];    // 买、卖挂单数
+    double BestWorking[2];      // 买挂单最高价、卖挂单最低价，用于自成交检查
+    double WorkingPrice[2][MAX_WORKING];
+    int32_t WorkingVolume[2][MAX_WORKING];
+    uint64_t WorkingKey[2][MAX_WORKING];
+};
+
+struct alignas(64) TAccountRiskState
+{
+    double PendingNotional;
+    uint64_t TheoreticalArrivalNs;  // GCRA流控的理论到达时间
+    uint64_t IntervalNs;
+    uint64_t ToleranceNs;
+};
+
+// 报前风控引擎
+// 状态按合约稠密序号和账户序号平铺在预分配数组中，检查过程无内存分配、无锁，
+// 须由报单线程单线程调用，回报线程的成交、撤单事件应转发到报单线程处理
+class RiskEngine
+{
+public:
+    RiskEngine(): m_InstrumentCount(0), m_AccountCount(0),
+        m_InstrumentLimit(NULL), m_AccountLimit(NULL),
+        m_PositionState(NULL), m_AccountState(NULL)
+    {
+        memset(m_RejectCount, 0, sizeof(m_RejectCount));
+    }
+
+    ~RiskEngine()
+    {
+        Release();
+    }
+
+    bool Init(int instrumentCount, int accountCount)
+    {
+        Release();
+        if(instrumentCount <= 0 || accountCount <= 0)
+        {
+            return false;
+        }
+        // 持仓状态按int下标访问，合约数与账户数之积不得超过INT_MAX
+        size_t stateCount = (size_t)instrumentCount * (size_t)accountCount;
+        if(stateCount > (size_t)INT_MAX)
+        {
+            return false;
+        }
+        m_InstrumentCount = instrumentCount;
+        m_AccountCount = accountCount;
+        m_InstrumentLimit = (TInstrumentRiskLimit*)AlignedAlloc(sizeof(TInstrumentRiskLimit) * instrumentCount);
+        m_AccountLimit = (TAccountRiskLimit*)AlignedAlloc(sizeof(TAccountRiskLimit) * accountCount);
+        m_PositionState = (TPositionRiskState*)AlignedAlloc(sizeof(TPositionRiskState) * stateCount);
+        m_AccountState = (TAccountRiskState*)AlignedAlloc(sizeof(TAccountRiskState) * accountCount);
+        if(m_InstrumentLimit == NULL || m_AccountLimit == NULL || m_PositionState == NULL || m_AccountState == NULL)
+        {
+            Release();
+            return false;
+        }
+        // 未配置的合约价格区间为空，报单一律拒绝
+        for(int i = 0; i < instrumentCount; i++)
+        {
+            m_InstrumentLimit[i].LowerPrice = 1.0;
+            m_InstrumentLimit[i].UpperPrice = 0.0;
+        }
+        for(size_t i = 0; i < stateCount; i++)
+        {
+            m_PositionState[i].BestWorking[ERISK_BUY] = -1e300;
+            m_PositionState[i].BestWorking[ERISK_SELL] = 1e300;
+        }
+        return true;
+    }
+
+    void SetInstrumentLimit(int instrumentSlot, const TInstrumentRiskLimit& limit)
+    {
+        if((unsigned)instrumentSlot < (unsigned)m_InstrumentCount)
+        {
+            m_InstrumentLimit[instrumentSlot] = limit;
+        }
+    }
+
+    void SetAccountLimit(int accountSlot, const TAccountRiskLimit& limit)
+    {
+        if((unsigned)accountSlot < (unsigned)m_AccountCount)
+        {
+            m_AccountLimit[accountSlot] = limit;
+            TAccountRiskState& state = m_AccountState[accountSlot];
+            int32_t count = limit.MaxOrderPerWindow > 0 ? limit.MaxOrderPerWindow : 1;
+            state.IntervalNs = limit.WindowNs / count;
+            state.ToleranceNs = limit.WindowNs - state.IntervalNs;
+        }
+    }
+
+    // 初始化持仓，通常来自柜台持仓查询
+    void SetPosition(int instrumentSlot, int accountSlot, int32_t longPosition, int32_t shortPosition)
+    {
+        if((unsigned)instrumentSlot < (unsigned)m_InstrumentCount && (unsigned)accountSlot < (unsigned)m_AccountCount)
+        {
+            TPositionRiskState& state = m_PositionState[accountSlot * m_InstrumentCount + instrumentSlot];
+            state.Position[ERISK_BUY] = longPosition;
+            state.Position[ERISK_SELL] = shortPosition;
+        }
+    }
+
+    // 报前检查，通过时冻结持仓、名义金额并登记挂单
+    // 各项检查先全部求值再合并为位掩码，只在最后做一次分支
+    force_inline inline int Check(const TRiskOrder& order, uint64_t nowNs)
+    {
+        if(unlikely((unsigned)order.InstrumentSlot >= (unsigned)m_InstrumentCount ||
+                    (unsigned)order.AccountSlot >= (unsigned)m_AccountCount))
+        {
+            m_RejectCount[ERISK_INVALID_SLOT]++;
+            return ERISK_INVALID_SLOT;
+        }
+        const TInstrumentRiskLimit& limit = m_InstrumentLimit[order.InstrumentSlot];
+        const TAccountRiskLimit& accountLimit = m_AccountLimit[order.AccountSlot];
+        TAccountRiskState& account = m_AccountState[order.AccountSlot];
+        TPositionRiskState& state = m_PositionState[order.AccountSlot * m_InstrumentCount + order.InstrumentSlot];
+
+        const int side = order.Direction & 1;
+        const int isOpen = (order.Offset == ERISK_OPEN);
+        // 开仓增加同向持仓，平仓减少反向持仓
+        const int positionSide = isOpen ? side : (side ^ 1);
+        const double notional = order.Price * order.Volume * limit.Multiplier * isOpen;
+        const int32_t openAfter = state.Position[positionSide] + state.OpenFrozen[positionSide] + order.Volume;
+        const int32_t closeAvailable = state.Position[positionSide] - state.CloseFrozen[positionSide];
+        // 买单价格不低于卖挂单最低价、卖单价格不高于买挂单最高价即构成自成交
+        const double opposite = state.BestWorking[side ^ 1];
+        const int selfTrade = side == ERISK_BUY ? (order.Price >= opposite) : (order.Price <= opposite);
+
+        uint32_t fail = 0;
+        fail |= (uint32_t)((order.Price < limit.LowerPrice) | (order.Price > limit.UpperPrice)) << ERISK_PRICE_BAND;
+        fail |= (uint32_t)((order.Volume <= 0) | (order.Volume > limit.MaxOrderVolume)) << ERISK_ORDER_VOLUME;
+        fail |= (uint32_t)(isOpen ? (openAfter > limit.MaxPosition) : (closeAvailable < order.Volume)) << ERISK_POSITION_LIMIT;
+        fail |= (uint32_t)(account.PendingNotional + notional > accountLimit.MaxNotional) << ERISK_NOTIONAL_LIMIT;
+        fail |= (uint32_t)(nowNs + account.ToleranceNs < account.TheoreticalArrivalNs) << ERISK_ORDER_RATE;
+        fail |= (uint32_t)selfTrade << ERISK_SELF_TRADE;
+        fail |= (uint32_t)(state.WorkingCount[side] >= TPositionRiskState::MAX_WORKING) << ERISK_WORKING_LIMIT;
+        if(unlikely(fail != 0))
+        {
+            int code = __builtin_ctz(fail);
+            m_RejectCount[code]++;
+            return code;
+        }
+
+        // 冻结
+        state.OpenFrozen[positionSide] += order.Volume * isOpen;
+        state.CloseFrozen[positionSide] += order.Volume * (isOpen ^ 1);
+        account.PendingNotional += notional;
+        uint64_t arrival = account.TheoreticalArrivalNs > nowNs ? account.TheoreticalArrivalNs : nowNs;
+        account.TheoreticalArrivalNs = arrival + account.IntervalNs;
+        // 登记挂单
+        int index = state.WorkingCount[side]++;
+        state.WorkingPrice[side][index] = order.Price;
+        state.WorkingVolume[side][index] = order.Volume;
+        state.WorkingKey[side][index] = order.OrderKey;
+        double best = state.BestWorking[side];
+        state.BestWorking[side] = side == ERISK_BUY ? (order.Price > best ? order.Price : best) : (order.Price < best ? order.Price : best);
+        return ERISK_OK;
+    }
+
+    // 成交回报，volume为本次成交量
+    void OnTrade(const TRiskOrder& order, int32_t volume)
+    {
+        if(!ValidOrder(order))
+        {
+            return;
+        }
+        const TInstrumentRiskLimit& limit = m_InstrumentLimit[order.InstrumentSlot];
+        TPositionRiskState& state = m_PositionState[order.AccountSlot * m_InstrumentCount + order.InstrumentSlot];
+        const int side = order.Direction & 1;
+        if(order.Offset == ERISK_OPEN)
+        {
+            state.OpenFrozen[side] -= volume;
+            state.Position[side] += volume;
+            m_AccountState[order.AccountSlot].PendingNotional -= order.Price * volume * limit.Multiplier;
+        }
+        else
+        {
+            state.CloseFrozen[side ^ 1] -= volume;
+            state.Position[side ^ 1] -= volume;
+        }
+        ReduceWorking(state, side, order.OrderKey, volume);
+    }
+
+    // 撤单或拒单回报，volume为撤销的剩余数量
+    void OnCancel(const TRiskOrder& order, int32_t volume)
+    {
+        if(!ValidOrder(order))
+        {
+            return;
+        }
+        const TInstrumentRiskLimit& limit = m_InstrumentLimit[order.InstrumentSlot];
+        TPositionRiskState& state = m_PositionState[order.AccountSlot * m_InstrumentCount + order.InstrumentSlot];
+        const int side = order.Direction & 1;
+        if(order.Offset == ERISK_OPEN)
+        {
+            state.OpenFrozen[side] -= volume;
+            m_AccountState[order.AccountSlot].PendingNotional -= order.Price * volume * limit.Multiplier;
+        }
+        else
+        {
+            state.CloseFrozen[side ^ 1] -= volume;
+        }
+        ReduceWorking(state, side, order.OrderKey, volume);
+    }
+
+    const TPositionRiskState* GetPositionState(int instrumentSlot, int accountSlot) const
+    {
+        if((unsigned)instrumentSlot < (unsigned)m_InstrumentCount && (unsigned)accountSlot < (unsigned)m_AccountCount)
+        {
+            return &m_PositionState[accountSlot * m_InstrumentCount + instrumentSlot];
+        }
+        return NULL;
+    }
+
+    double GetPendingNotional(int accountSlot) const
+    {
+        return (unsigned)accountSlot < (unsigned)m_AccountCount ? m_AccountState[accountSlot].PendingNotional : 0.0;
+    }
+
+    uint64_t GetRejectCount(int code) const
+    {
+        return (unsigned)code < ERISK_CODE_COUNT ? m_RejectCount[code] : 0;
+    }
+
+    static const char* GetRiskCodeString(int code)
+    {
+        static const char* Names[ERISK_CODE_COUNT] =
+        {
+            "OK", "InvalidSlot", "PriceBand", "OrderVolume", "PositionLimit",
+            "NotionalLimit", "OrderRate", "SelfTrade", "WorkingLimit"
+        };
+        return (unsigned)code < ERISK_CODE_COUNT ? Names[code] : "Unknown";
+    }
+protected:
+    force_inline inline bool ValidOrder(const TRiskOrder& order) const
+    {
+        return (unsigned)order.InstrumentSlot < (unsigned)m_InstrumentCount &&
+               (unsigned)order.AccountSlot < (unsigned)m_AccountCount;
+    }
+
+    // 挂单数不超过MAX_WORKING，查找与删除均为常数时间
+    static void ReduceWorking(TPositionRiskState& state, int side, uint64_t orderKey, int32_t volume)
+    {
+        int count = state.WorkingCount[side];
+        for(int i = 0; i < count; i++)
+        {
+            if(state.WorkingKey[side][i] != orderKey)
+            {
+                continue;
+            }
+            state.WorkingVolume[side][i] -= volume;
+            if(state.WorkingVolume[side][i] > 0)
+            {
+                return;
+            }
+            count--;
+            state.WorkingPrice[side][i] = state.WorkingPrice[side][count];
+            state.WorkingVolume[side][i] = state.WorkingVolume[side][count];
+            state.WorkingKey[side][i] = state.WorkingKey[side][count];
+            state.WorkingCount[side] = count;
+            double best = side == ERISK_BUY ? -1e300 : 1e300;
+            for(int j = 0; j < count; j++)
+            {
+                double price = state.WorkingPrice[side][j];
+                best = side == ERISK_BUY ? (price > best ? price : best) : (price < best ? price : best);
+            }
+            state.BestWorking[side] = best;
+            return;
+        }
+    }
+
+    static void* AlignedAlloc(size_t size)
+    {
+        void* p = NULL;
+        if(posix_memalign(&p, 64, size) != 0)
+        {
+            return NULL;
+        }
+        memset(p, 0, size);
+        return p;
+    }
+
+    void Release()
+    {
+        free(m_InstrumentLimit);
+        free(m_AccountLimit);
+        free(m_PositionState);
+        free(m_AccountState);
+        m_InstrumentLimit = NULL;
+        m_AccountLimit = NULL;
+        m_PositionState = NULL;
+        m_AccountState = NULL;
+        m_InstrumentCount = 0;
+        m_AccountCount = 0;
+    }
+protected:
+    int m_InstrumentCount;
+    int m_AccountCount;
+    TInstrumentRiskLimit* m_InstrumentLimit;
+    TAccountRiskLimit* m_AccountLimit;
+    TPositionRiskState* m_PositionState;
+    TAccountRiskState* m_AccountState;
+    uint64_t m_RejectCount[ERISK_CODE_COUNT];
+private:
+    RiskEngine(const RiskEngine &);
+    RiskEngine &operator=(const RiskEngine &);
+};
+
+// 柜台报单结构体适配，需在本头文件之前包含对应柜台头文件
+struct RiskAdapter
+{
+#ifdef THOST_FTDCSTRUCT_H
+    // CTP ReqOrderInsert
+    static force_inline inline void Convert(const CThostFtdcInputOrderField& field, int instrumentSlot, int accountSlot, TRiskOrder& order)
+    {
+        order.InstrumentSlot = instrumentSlot;
+        order.AccountSlot = accountSlot;
+        order.Direction = field.Direction == THOST_FTDC_D_Buy ? ERISK_BUY : ERISK_SELL;
+        order.Offset = field.CombOffsetFlag[0] == THOST_FTDC_OF_Open ? ERISK_OPEN : ERISK_CLOSE;
+        order.Volume = field.VolumeTotalOriginal;
+        order.Price = field.LimitPrice;
+        order.OrderKey = strtoull(field.OrderRef, NULL, 10);
+    }
+#endif
+
+#ifdef _XOMS_API_STRUCT_H_
+    // XTP InsertOrder，未指定开平标志时买入视为开仓、卖出视为平仓
+    static force_inline inline void Convert(const XTPOrderInsertInfo& field, int instrumentSlot, int accountSlot, TRiskOrder& order)
+    {
+        order.InstrumentSlot = instrumentSlot;
+        order.AccountSlot = accountSlot;
+        order.Direction = field.side == XTP_SIDE_BUY ? ERISK_BUY : ERISK_SELL;
+        if(field.position_effect == XTP_POSITION_EFFECT_INIT)
+        {
+            order.Offset = order.Direction == ERISK_BUY ? ERISK_OPEN : ERISK_CLOSE;
+        }
+        else
+        {
+            order.Offset = field.position_effect == XTP_POSITION_EFFECT_OPEN ? ERISK_OPEN : ERISK_CLOSE;
+        }
+        order.Volume = (int32_t)field.quantity;
+        order.Price = field.price;
+        order.OrderKey = field.order_client_id;
+    }
+#endif
+
+#ifdef YD_DATA_STRUCT_H
+    // YD insertOrder，合约序号可直接取YDInstrument::InstrumentRef
+    static force_inline inline void Convert(const YDInputOrder& field, int instrumentSlot, int accountSlot, TRiskOrder& order)
+    {
+        order.InstrumentSlot = instrumentSlot;
+        order.AccountSlot = accountSlot;
+        order.Direction = field.Direction == YD_D_Buy ? ERISK_BUY : ERISK_SELL;
+        order.Offset = field.OffsetFlag == YD_OF_Open ? ERISK_OPEN : ERISK_CLOSE;
+        order.Volume = field.OrderVolume;
+        order.Price = field.Price;
+        order.OrderKey = (uint32_t)field.OrderRef;
+    }
+#endif
+
+#ifdef _EES_TRADE_API_STRUCT_DEFINE_H_
+    // REM EnterOrder
+    static force_inline inline void Convert(const EES_EnterOrderField& field, int instrumentSlot, int accountSlot, TRiskOrder& order)
+    {
+        order.InstrumentSlot = instrumentSlot;
+        order.AccountSlot = accountSlot;
+        switch(field.m_Side)
+        {
+        case EES_SideType_open_long:
+            order.Direction = ERISK_BUY;
+            order.Offset = ERISK_OPEN;
+            break;
+        case EES_SideType_open_short:
+            order.Direction = ERISK_SELL;
+            order.Offset = ERISK_OPEN;
+            break;
+        case EES_SideType_close_today_short:
+        case EES_SideType_close_ovn_short:
+        case EES_SideType_close_short:
+            order.Direction = ERISK_BUY;
+            order.Offset = ERISK_CLOSE;
+            break;
+        default:
+            order.Direction = ERISK_SELL;
+            order.Offset = ERISK_CLOSE;
+            break;
+        }
+        order.Volume = field.m_Qty;
+        order.Price = field.m_Price;
+        order.OrderKey = field.m_ClientOrderToken;
+    }
+#endif
+
+#ifdef _OES_BASE_MODEL_H
+    // OES OesAsyncApi_SendOrderReq，委托价格单位为0.0001元，现货买入视为开仓、卖出视为平仓
+    static force_inline inline void Convert(const OesOrdReqT& field, int instrumentSlot, int accountSlot, TRiskOrder& order)
+    {
+        order.InstrumentSlot = instrumentSlot;
+        order.AccountSlot = accountSlot;
+        order.Direction = field.bsType == OES_BS_TYPE_BUY ? ERISK_BUY : ERISK_SELL;
+        order.Offset = order.Direction == ERISK_BUY ? ERISK_OPEN : ERISK_CLOSE;
+        order.Volume = field.ordQty;
+        order.Price = field.ordPrice * 0.0001;
+        order.OrderKey = (uint32_t)field.clSeqNo;
+    }
+#endif
+};
+
+}
+
+#endif // RISKENGINE_HPP
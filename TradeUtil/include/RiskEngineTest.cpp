@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <assert.h>
+#include "ThostFtdcUserApiStruct.h"
+#include "xoms_api_struct.h"
+#include "ydDataStruct.h"
+#include "EesTraderDefine.h"
+#include "oes_global/oes_base_model.h"
+#include "RiskEngine.hpp"
+#include "InstrumentIndex.hpp"
+#include "HRTimer.hpp"
+
+int main(int argc, char* argv[])
+{
+    TradeUtil::InstrumentIndex index(1024);
+    int rb = index.Register("rb2410");
+    int ag = index.Register("ag2412");
+    assert(index.Register("rb2410") == rb);
+    assert(index.Find("ag2412") == ag);
+    assert(index.Find("cu2410") == TradeUtil::InstrumentIndex::INVALID_SLOT);
+    // 超长合约代码截断保存
+    int spread = index.Register("SPD rb2410&rb2501&rb2505&rb2509&rb2601");
+    assert(strcmp(index.GetInstrumentID(spread), "SPD rb2410&rb2501&rb2505&rb2509") == 0);
+
+    TradeUtil::RiskEngine engine;
+    // 合约数与账户数之积溢出int
+    assert(!engine.Init(65536, 65536));
+    assert(engine.Init(1024, 2));
+    TradeUtil::TInstrumentRiskLimit limit = {3000.0, 4000.0, 10.0, 100, 500};
+    engine.SetInstrumentLimit(rb, limit);
+    TradeUtil::TAccountRiskLimit accountLimit = {1e8, 1000, 1000000000ul};
+    engine.SetAccountLimit(0, accountLimit);
+    engine.SetPosition(rb, 0, 20, 0);
+
+    uint64_t now = 1000000000ul;
+    TradeUtil::TRiskOrder order = {rb, 0, TradeUtil::ERISK_BUY, TradeUtil::ERISK_OPEN, 0, 10, 3500.0, 1};
+    assert(engine.Check(order, now) == TradeUtil::ERISK_OK);
+    assert(engine.GetPositionState(rb, 0)->OpenFrozen[TradeUtil::ERISK_BUY] == 10);
+
+    // 价格区间
+    TradeUtil::TRiskOrder bad = order;
+    bad.Price = 4500.0;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_PRICE_BAND);
+    // 单笔数量
+    bad = order;
+    bad.Volume = 200;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_ORDER_VOLUME);
+    // 平仓可用不足
+    bad = order;
+    bad.Direction = TradeUtil::ERISK_SELL;
+    bad.Offset = TradeUtil::ERISK_CLOSE;
+    bad.Price = 3600.0;
+    bad.Volume = 30;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_POSITION_LIMIT);
+    // 自成交：卖价不高于买挂单3500
+    bad.Volume = 5;
+    bad.Price = 3500.0;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_SELF_TRADE);
+    // 未配置合约
+    bad = order;
+    bad.InstrumentSlot = ag;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_PRICE_BAND);
+
+    // 成交与撤单释放冻结
+    engine.OnTrade(order, 4);
+    assert(engine.GetPositionState(rb, 0)->Position[TradeUtil::ERISK_BUY] == 24);
+    engine.OnCancel(order, 6);
+    assert(engine.GetPositionState(rb, 0)->OpenFrozen[TradeUtil::ERISK_BUY] == 0);
+    assert(engine.GetPositionState(rb, 0)->WorkingCount[TradeUtil::ERISK_BUY] == 0);
+    assert(engine.GetPendingNotional(0) < 1e-6);
+    bad.InstrumentSlot = rb;
+    bad.Direction = TradeUtil::ERISK_SELL;
+    bad.Offset = TradeUtil::ERISK_CLOSE;
+    bad.Price = 3500.0;
+    bad.Volume = 5;
+    bad.OrderKey = 2;
+    assert(engine.Check(bad, now) == TradeUtil::ERISK_OK);
+    engine.OnCancel(bad, 5);
+
+    // 流控：1秒最多3笔
+    TradeUtil::TAccountRiskLimit rateLimit = {1e8, 3, 1000000000ul};
+    engine.SetAccountLimit(1, rateLimit);
+    engine.SetPosition(rb, 1, 0, 0);
+    TradeUtil::TRiskOrder rateOrder = order;
+    rateOrder.AccountSlot = 1;
+    rateOrder.Volume = 1;
+    for(int i = 0; i < 3; i++)
+    {
+        rateOrder.OrderKey = 100 + i;
+        assert(engine.Check(rateOrder, now) == TradeUtil::ERISK_OK);
+    }
+    assert(engine.Check(rateOrder, now) == TradeUtil::ERISK_ORDER_RATE);
+    assert(engine.Check(rateOrder, now + 400000000ul) == TradeUtil::ERISK_OK);
+
+    // 柜台适配
+    {
+        CThostFtdcInputOrderField field;
+        memset(&field, 0, sizeof(field));
+        strcpy(field.OrderRef, "123");
+        field.Direction = THOST_FTDC_D_Sell;
+        field.CombOffsetFlag[0] = THOST_FTDC_OF_Close;
+        field.LimitPrice = 3510.0;
+        field.VolumeTotalOriginal = 3;
+        TradeUtil::TRiskOrder converted;
+        TradeUtil::RiskAdapter::Convert(field, rb, 0, converted);
+        assert(converted.Direction == TradeUtil::ERISK_SELL && converted.Offset == TradeUtil::ERISK_CLOSE);
+        assert(converted.OrderKey == 123 && converted.Volume == 3);
+    }
+    {
+        XTPOrderInsertInfo field;
+        memset(&field, 0, sizeof(field));
+        field.side = XTP_SIDE_SELL;
+        field.quantity = 300;
+        field.price = 10.5;
+        field.order_client_id = 7;
+        TradeUtil::TRiskOrder converted;
+        TradeUtil::RiskAdapter::Convert(field, rb, 0, converted);
+        assert(converted.Direction == TradeUtil::ERISK_SELL && converted.Offset == TradeUtil::ERISK_CLOSE);
+    }
+    {
+        YDInputOrder field;
+        memset(&field, 0, sizeof(field));
+        field.Direction = YD_D_Buy;
+        field.OffsetFlag = YD_OF_Open;
+        field.Price = 3500.0;
+        field.OrderVolume = 2;
+        field.OrderRef = 9;
+        TradeUtil::TRiskOrder converted;
+        TradeUtil::RiskAdapter::Convert(field, rb, 0, converted);
+        assert(converted.Direction == TradeUtil::ERISK_BUY && converted.Offset == TradeUtil::ERISK_OPEN);
+    }
+    {
+        EES_EnterOrderField field;
+        field.m_Side = EES_SideType_close_today_short;
+        field.m_Price = 3500.0;
+        field.m_Qty = 1;
+        TradeUtil::TRiskOrder converted;
+        TradeUtil::RiskAdapter::Convert(field, rb, 0, converted);
+        assert(converted.Direction == TradeUtil::ERISK_BUY && converted.Offset == TradeUtil::ERISK_CLOSE);
+    }
+    {
+        OesOrdReqT field;
+        memset(&field, 0, sizeof(field));
+        field.bsType = OES_BS_TYPE_BUY;
+        field.ordPrice = 105000;
+        field.ordQty = 100;
+        TradeUtil::TRiskOrder converted;
+        TradeUtil::RiskAdapter::Convert(field, rb, 0, converted);
+        assert(converted.Price > 10.49 && converted.Price < 10.51);
+    }
+
+    // 延迟测试：检查通过后立即撤单，状态保持稳定
+    TimeUtil::HRTimer timer;
+    const int N = 1000000;
+    TradeUtil::TAccountRiskLimit benchLimit = {1e12, 1000000000, 1000000000ul};
+    engine.SetAccountLimit(0, benchLimit);
+    uint64_t passed = 0;
+    uint64_t start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        order.OrderKey = i;
+        now += 1000;
+        if(engine.Check(order, now) == TradeUtil::ERISK_OK)
+        {
+            passed++;
+            engine.OnCancel(order, order.Volume);
+        }
+    }
+    uint64_t end = timer.GetTimeNs();
+    assert(passed == (uint64_t)N);
+    fprintf(stderr, "RiskEngine Check+Cancel Latency: %.1f ns/order\n", (double)(end - start) / N);
+
+    start = timer.GetTimeNs();
+    for(int i = 0; i < N; i++)
+    {
+        bad.Price = 4500.0 + (i & 1);
+        passed += engine.Check(bad, now) == TradeUtil::ERISK_OK;
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "RiskEngine Reject Latency: %.1f ns/order\n", (double)(end - start) / N);
+    for(int i = 0; i < TradeUtil::ERISK_CODE_COUNT; i++)
+    {
+        fprintf(stderr, "%s: %lu\n", TradeUtil::RiskEngine::GetRiskCodeString(i), engine.GetRejectCount(i));
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 RiskEngineTest.cpp -o test -I. -I../../FMTLogger/include -I../../CTP/6.7.8/include -I../../XTP/2.2.36.1/include -I../../YD/1.486.96/include -I../../REM/3.1.3.49/include -I../../OES/0.17.4.1/include
@@ -0,0 +1,800 @@
+#ifndef YAMLBINDING_HPP
+#define YAMLBINDING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ctype.h>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include "yaml-cpp/eventhandler.h"
+#include "yaml-cpp/parser.h"
+#include "yaml-cpp/exceptions.h"
+#include "yaml-cpp/mark.h"
+
+#ifndef force_inline
+#define force_inline __attribute__ ((__always_inline__))
+#endif
+
+// 配置结构体声明字段表，与结构体定义放在同一命名空间：
+// struct TInstrument { char InstrumentID[32]; double PriceTick; std::vector<int> Sessions; };
+// YAML_BIND(TInstrument,
+//     YAML_REQUIRED(InstrumentID),
+//     YAML_FIELD(PriceTick),
+//     YAML_FIELD_AS(Sessions, "TradingSessions"))
+// 已出现字段以64位位图记录，每个结构体最多YAML_BIND_MAX_FIELDS个字段，超出时编译失败
+#define YAML_BIND_MAX_FIELDS 64
+#define YAML_BIND(Type, ...)                                                                                       \
+inline const YAMLUtil::TTypeInfo* YAMLBindType(Type*)                                                              \
+{                                                                                                                  \
+    typedef Type BindType;                                                                                         \
+    static const YAMLUtil::TFieldInfo fields[] = {__VA_ARGS__};                                                    \
+    static_assert(sizeof(fields) / sizeof(fields[0]) <= YAML_BIND_MAX_FIELDS, "YAML_BIND: too many fields in " #Type); \
+    static const YAMLUtil::TTypeInfo type = YAMLUtil::MakeStructType(#Type, fields, sizeof(fields) / sizeof(fields[0])); \
+    return &type;                                                                                                  \
+}
+
+#define YAML_FIELD_IMPL(Field, Key, Required) \
+    {Key, sizeof(Key) - 1, offsetof(BindType, Field), YAMLUtil::TypeOf((decltype(BindType::Field)*)0), Required}
+#define YAML_FIELD(Field) YAML_FIELD_IMPL(Field, #Field, false)
+#define YAML_REQUIRED(Field) YAML_FIELD_IMPL(Field, #Field, true)
+#define YAML_FIELD_AS(Field, Key) YAML_FIELD_IMPL(Field, Key, false)
+#define YAML_REQUIRED_AS(Field, Key) YAML_FIELD_IMPL(Field, Key, true)
+
+namespace YAMLUtil
+{
+
+enum EBindErrorCode
+{
+    EBIND_OK = 0,
+    EBIND_FILE_ERROR,
+    EBIND_SYNTAX_ERROR,
+    EBIND_EMPTY_DOCUMENT,
+    EBIND_TYPE_MISMATCH,
+    EBIND_INVALID_VALUE,
+    EBIND_OUT_OF_RANGE,
+    EBIND_STRING_TOO_LONG,
+    EBIND_UNKNOWN_KEY,
+    EBIND_MISSING_FIELD,
+    EBIND_UNSUPPORTED,
+    EBIND_CALLBACK_ERROR,
+};
+
+// Line、Column从1开始，无位置信息时为0；Path形如Instruments[3].PriceTick
+struct TBindError
+{
+    EBindErrorCode Code;
+    int Line;
+    int Column;
+    std::string Path;
+    std::string Message;
+};
+
+enum ETypeKind
+{
+    ETYPE_SCALAR = 0,
+    ETYPE_STRUCT,
+    ETYPE_SEQUENCE,
+};
+
+struct TFieldInfo;
+
+// 类型描述，由TypeOf和YAML_BIND生成，均为静态常量
+struct TTypeInfo
+{
+    ETypeKind Kind;
+    const char* Name;
+    size_t Size;
+    // 标量：解析成功返回EBIND_OK
+    EBindErrorCode (*Parse)(const std::string& value, void* dest);
+    // 结构体
+    const TFieldInfo* Fields;
+    int FieldCount;
+    // 序列：Element为元素类型，Append追加一个值初始化的元素并返回其地址
+    const TTypeInfo* Element;
+    void (*Clear)(void* sequence);
+    void* (*Append)(void* sequence);
+};
+
+struct TFieldInfo
+{
+    const char* Key;
+    size_t KeyLength;
+    size_t Offset;
+    const TTypeInfo* Type;
+    bool Required;
+};
+
+inline TTypeInfo MakeStructType(const char* name, const TFieldInfo* fields, int count)
+{
+    TTypeInfo type = {ETYPE_STRUCT, name, 0, NULL, fields, count, NULL, NULL, NULL};
+    return type;
+}
+
+// 标量解析
+template<class T>
+inline EBindErrorCode ParseInteger(const std::string& value, void* dest)
+{
+    const char* begin = value.c_str();
+    const char* digits = begin[0] == '-' || begin[0] == '+' ? begin + 1 : begin;
+    int base = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X') ? 16 : 10;
+    if(value.empty() || !(isdigit((unsigned char)digits[0])))
+    {
+        return EBIND_INVALID_VALUE;
+    }
+    char* end = NULL;
+    errno = 0;
+    if(std::numeric_limits<T>::is_signed)
+    {
+        long long result = strtoll(begin, &end, base);
+        if(*end != 0)
+        {
+            return EBIND_INVALID_VALUE;
+        }
+        if(errno == ERANGE || result < (long long)std::numeric_limits<T>::min() || result > (long long)std::numeric_limits<T>::max())
+        {
+            return EBIND_OUT_OF_RANGE;
+        }
+        *(T*)dest = (T)result;
+    }
+    else
+    {
+        if(begin[0] == '-')
+        {
+            return EBIND_OUT_OF_RANGE;
+        }
+        unsigned long long result = strtoull(begin, &end, base);
+        if(*end != 0)
+        {
+            return EBIND_INVALID_VALUE;
+        }
+        if(errno == ERANGE || result > (unsigned long long)std::numeric_limits<T>::max())
+        {
+            return EBIND_OUT_OF_RANGE;
+        }
+        *(T*)dest = (T)result;
+    }
+    return EBIND_OK;
+}
+
+template<class T>
+inline EBindErrorCode ParseFloat(const std::string& value, void* dest)
+{
+    const char* text = value.c_str();
+    if(value == ".inf" || value == ".Inf" || value == ".INF" || value == "+.inf" || value == "+.Inf" || value == "+.INF")
+    {
+        *(T*)dest = std::numeric_limits<T>::infinity();
+        return EBIND_OK;
+    }
+    if(value == "-.inf" || value == "-.Inf" || value == "-.INF")
+    {
+        *(T*)dest = -std::numeric_limits<T>::infinity();
+        return EBIND_OK;
+    }
+    if(value == ".nan" || value == ".NaN" || value == ".NAN")
+    {
+        *(T*)dest = std::numeric_limits<T>::quiet_NaN();
+        return EBIND_OK;
+    }
+    if(value.empty() || isspace((unsigned char)text[0]))
+    {
+        return EBIND_INVALID_VALUE;
+    }
+    char* end = NULL;
+    errno = 0;
+    double result = strtod(text, &end);
+    if(*end != 0)
+    {
+        return EBIND_INVALID_VALUE;
+    }
+    if(errno == ERANGE && (result > 1.0 || result < -1.0))
+    {
+        return EBIND_OUT_OF_RANGE;
+    }
+    *(T*)dest = (T)result;
+    return EBIND_OK;
+}
+
+// 与YAML::convert<bool>一致：y/n、yes/no、true/false、on/off，全小写、全大写或首字母大写
+inline EBindErrorCode ParseBool(const std::string& value, void* dest)
+{
+    static const char* names[][2] = {{"y", "n"}, {"yes", "no"}, {"true", "false"}, {"on", "off"}};
+    for(int i = 0; i < 4; i++)
+    {
+        for(int j = 0; j < 2; j++)
+        {
+            const char* name = names[i][j];
+            size_t length = strlen(name);
+            if(value.size() != length)
+            {
+                continue;
+            }
+            bool lower = true, upper = true, capital = true;
+            for(size_t k = 0; k < length; k++)
+            {
+                lower = lower && value[k] == name[k];
+                upper = upper && value[k] == toupper(name[k]);
+                capital = capital && value[k] == (k == 0 ? toupper(name[k]) : name[k]);
+            }
+            if(lower || upper || capital)
+            {
+                *(bool*)dest = j == 0;
+                return EBIND_OK;
+            }
+        }
+    }
+    return EBIND_INVALID_VALUE;
+}
+
+template<size_t N>
+inline EBindErrorCode ParseFixedString(const std::string& value, void* dest)
+{
+    if(value.size() >= N)
+    {
+        return EBIND_STRING_TOO_LONG;
+    }
+    memcpy(dest, value.c_str(), value.size() + 1);
+    return EBIND_OK;
+}
+
+inline EBindErrorCode ParseString(const std::string& value, void* dest)
+{
+    *(std::string*)dest = value;
+    return EBIND_OK;
+}
+
+template<class T>
+inline void ClearSequence(void* sequence)
+{
+    ((std::vector<T>*)sequence)->clear();
+}
+
+template<class T>
+inline void* AppendSequence(void* sequence)
+{
+    std::vector<T>* items = (std::vector<T>*)sequence;
+    items->emplace_back();
+    return &items->back();
+}
+
+// 类型描述查找：标量为重载，结构体经ADL找到YAML_BIND生成的YAMLBindType
+#define YAML_BIND_SCALAR(Type, TypeName, Parser)              \
+inline const TTypeInfo* TypeOf(Type*)                         \
+{                                                             \
+    static const TTypeInfo type = {ETYPE_SCALAR, TypeName, sizeof(Type), Parser, NULL, 0, NULL, NULL, NULL}; \
+    return &type;                                             \
+}
+
+YAML_BIND_SCALAR(bool, "bool", ParseBool)
+YAML_BIND_SCALAR(signed char, "int8", ParseInteger<signed char>)
+YAML_BIND_SCALAR(unsigned char, "uint8", ParseInteger<unsigned char>)
+YAML_BIND_SCALAR(short, "int16", ParseInteger<short>)
+YAML_BIND_SCALAR(unsigned short, "uint16", ParseInteger<unsigned short>)
+YAML_BIND_SCALAR(int, "int32", ParseInteger<int>)
+YAML_BIND_SCALAR(unsigned int, "uint32", ParseInteger<unsigned int>)
+YAML_BIND_SCALAR(long, "int64", ParseInteger<long>)
+YAML_BIND_SCALAR(unsigned long, "uint64", ParseInteger<unsigned long>)
+YAML_BIND_SCALAR(long long, "int64", ParseInteger<long long>)
+YAML_BIND_SCALAR(unsigned long long, "uint64", ParseInteger<unsigned long long>)
+YAML_BIND_SCALAR(float, "float", ParseFloat<float>)
+YAML_BIND_SCALAR(double, "double", ParseFloat<double>)
+YAML_BIND_SCALAR(std::string, "string", ParseString)
+
+#undef YAML_BIND_SCALAR
+
+template<size_t N>
+inline const TTypeInfo* TypeOf(char (*)[N])
+{
+    static const TTypeInfo type = {ETYPE_SCALAR, "char[]", N, ParseFixedString<N>, NULL, 0, NULL, NULL, NULL};
+    return &type;
+}
+
+template<class T>
+inline const TTypeInfo* TypeOf(T* p)
+{
+    return YAMLBindType(p);
+}
+
+template<class T>
+inline const TTypeInfo* TypeOf(std::vector<T>*)
+{
+    static const TTypeInfo type = {ETYPE_SEQUENCE, "sequence", sizeof(std::vector<T>), NULL, NULL, 0,
+                                   TypeOf((T*)0), ClearSequence<T>, AppendSequence<T>};
+    return &type;
+}
+
+// 直接消费Parser事件写入目标结构体，不构建YAML::Node
+// 仅处理第一个文档，出错后忽略后续事件；不支持锚点别名
+class BindHandler : public YAML::EventHandler
+{
+public:
+    BindHandler(): m_Root(NULL), m_RootType(NULL), m_Strict(false), m_Done(false), m_SkipDepth(0), m_PathPrefix(NULL),
+                   m_PathIndex(0), m_LineOffset(0)
+    {
+        m_Stack.reserve(16);
+        m_Error.Code = EBIND_OK;
+        m_Error.Line = 0;
+        m_Error.Column = 0;
+    }
+
+    void Reset(void* root, const TTypeInfo* type, bool strict)
+    {
+        m_Root = root;
+        m_RootType = type;
+        m_Strict = strict;
+        m_Done = false;
+        m_SkipDepth = 0;
+        m_PathPrefix = NULL;
+        m_PathIndex = 0;
+        m_LineOffset = 0;
+        m_Stack.clear();
+        m_Error.Code = EBIND_OK;
+        m_Error.Line = 0;
+        m_Error.Column = 0;
+        m_Error.Path.clear();
+        m_Error.Message.clear();
+    }
+
+    // 绑定序列中的单个元素时，错误路径前加prefix[index]，行号加lineOffset；prefix须在加载期间有效
+    void SetOrigin(const std::string* prefix, int index, int lineOffset)
+    {
+        m_PathPrefix = prefix;
+        m_PathIndex = index;
+        m_LineOffset = lineOffset;
+    }
+
+    bool IsDone() const
+    {
+        return m_Done;
+    }
+
+    bool HasError() const
+    {
+        return m_Error.Code != EBIND_OK;
+    }
+
+    const TBindError& GetError() const
+    {
+        return m_Error;
+    }
+
+    void SetError(EBindErrorCode code, const YAML::Mark& mark, const std::string& path, const std::string& message)
+    {
+        if(m_Error.Code != EBIND_OK)
+        {
+            return;
+        }
+        m_Error.Code = code;
+        m_Error.Line = mark.is_null() ? 0 : mark.line + 1 + m_LineOffset;
+        m_Error.Column = mark.is_null() ? 0 : mark.column + 1;
+        m_Error.Path = path;
+        char location[64] = {0};
+        if(m_Error.Line > 0)
+        {
+            snprintf(location, sizeof(location), "line %d, column %d: ", m_Error.Line, m_Error.Column);
+        }
+        m_Error.Message = std::string(location) + (path.empty() ? std::string() : path + ": ") + message;
+    }
+
+    virtual void OnDocumentStart(const YAML::Mark& mark) override
+    {
+    }
+
+    virtual void OnDocumentEnd() override
+    {
+        if(!m_Done && !HasError())
+        {
+            SetError(EBIND_EMPTY_DOCUMENT, YAML::Mark::null_mark(), "", std::string("empty document, expected ") + m_RootType->Name);
+        }
+        m_Done = true;
+    }
+
+    virtual void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override
+    {
+        if(Skipping() || CheckAnchor(mark, anchor))
+        {
+            return;
+        }
+        TFrame* frame = Top();
+        if(frame == NULL)
+        {
+            return;
+        }
+        if(frame->Type->Kind == ETYPE_STRUCT && frame->Field == NULL && !frame->UnknownKey)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, Path(), "null key");
+            return;
+        }
+        // 空值保留默认值，序列中追加一个值初始化的元素
+        void* dest = NULL;
+        BeginValue(frame, dest);
+        frame->PendingField = NULL;
+    }
+
+    virtual void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override
+    {
+        if(Skipping())
+        {
+            return;
+        }
+        SetError(EBIND_UNSUPPORTED, mark, Path(), "alias is not supported");
+    }
+
+    virtual void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override
+    {
+        if(Skipping() || CheckAnchor(mark, anchor))
+        {
+            return;
+        }
+        TFrame* frame = Top();
+        if(frame == NULL)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, Path(), std::string("expected ") + m_RootType->Name + ", got scalar \"" + value + "\"");
+            return;
+        }
+        if(frame->Type->Kind == ETYPE_STRUCT && frame->Field == NULL && !frame->UnknownKey)
+        {
+            OnKey(frame, mark, value);
+            return;
+        }
+        void* dest = NULL;
+        const TTypeInfo* type = BeginValue(frame, dest);
+        if(type == NULL)
+        {
+            return;
+        }
+        if(type->Kind != ETYPE_SCALAR)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, Path(), std::string("expected ") + type->Name + ", got scalar \"" + value + "\"");
+            return;
+        }
+        EBindErrorCode code = type->Parse(value, dest);
+        if(code != EBIND_OK)
+        {
+            char expected[64];
+            if(code == EBIND_STRING_TOO_LONG)
+            {
+                snprintf(expected, sizeof(expected), "string longer than %zu", type->Size - 1);
+            }
+            else
+            {
+                snprintf(expected, sizeof(expected), "%s %s", code == EBIND_OUT_OF_RANGE ? "out of range" : "expected", type->Name);
+            }
+            SetError(code, mark, Path(), std::string(expected) + ", got \"" + value + "\"");
+            return;
+        }
+        frame->PendingField = NULL;
+    }
+
+    virtual void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override
+    {
+        BeginContainer(mark, anchor, ETYPE_SEQUENCE, "sequence");
+    }
+
+    virtual void OnSequenceEnd() override
+    {
+        EndContainer();
+    }
+
+    virtual void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override
+    {
+        BeginContainer(mark, anchor, ETYPE_STRUCT, "map");
+    }
+
+    virtual void OnMapEnd() override
+    {
+        if(m_SkipDepth == 0 && !HasError() && !m_Stack.empty())
+        {
+            CheckRequired(m_Stack.back());
+        }
+        EndContainer();
+    }
+protected:
+    struct TFrame
+    {
+        char* Object;
+        const TTypeInfo* Type;
+        // 结构体：Field为已读到键、尚未读到值的字段，PendingField为正在解析值的字段，Seen为已出现字段位图
+        // 序列：Count为已追加元素数
+        const TFieldInfo* Field;
+        const TFieldInfo* PendingField;
+        int Hint;
+        bool UnknownKey;
+        uint64_t Seen;
+        int Count;
+        YAML::Mark StartMark;
+    };
+
+    force_inline inline TFrame* Top()
+    {
+        return m_Stack.empty() ? NULL : &m_Stack.back();
+    }
+
+    // 未知键的值整体跳过
+    force_inline inline bool Skipping()
+    {
+        if(m_Done || HasError())
+        {
+            return true;
+        }
+        if(m_SkipDepth > 0)
+        {
+            return true;
+        }
+        TFrame* frame = Top();
+        if(frame != NULL && frame->UnknownKey)
+        {
+            frame->UnknownKey = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool CheckAnchor(const YAML::Mark& mark, YAML::anchor_t anchor)
+    {
+        if(anchor != YAML::NullAnchor)
+        {
+            SetError(EBIND_UNSUPPORTED, mark, Path(), "anchor is not supported");
+            return true;
+        }
+        return false;
+    }
+
+    void OnKey(TFrame* frame, const YAML::Mark& mark, const std::string& key)
+    {
+        const TTypeInfo* type = frame->Type;
+        size_t length = key.size();
+        frame->PendingField = NULL;
+        // 键通常按字段声明顺序出现，从上次命中的下一个字段开始查找
+        for(int i = 0; i < type->FieldCount; i++)
+        {
+            int index = frame->Hint + i;
+            if(index >= type->FieldCount)
+            {
+                index -= type->FieldCount;
+            }
+            const TFieldInfo& field = type->Fields[index];
+            if(field.KeyLength == length && memcmp(field.Key, key.data(), length) == 0)
+            {
+                frame->Field = &field;
+                frame->Hint = index + 1 < type->FieldCount ? index + 1 : 0;
+                frame->Seen |= 1ull << index;
+                return;
+            }
+        }
+        if(m_Strict)
+        {
+            std::string path = Path();
+            SetError(EBIND_UNKNOWN_KEY, mark, path.empty() ? key : path + "." + key, std::string("unknown key for ") + type->Name);
+            return;
+        }
+        frame->UnknownKey = true;
+    }
+
+    // 返回下一个值的目标类型与地址
+    const TTypeInfo* BeginValue(TFrame* frame, void*& dest)
+    {
+        if(frame->Type->Kind == ETYPE_STRUCT)
+        {
+            const TFieldInfo* field = frame->Field;
+            frame->Field = NULL;
+            frame->PendingField = field;
+            dest = frame->Object + field->Offset;
+            return field->Type;
+        }
+        frame->Count++;
+        dest = frame->Type->Append(frame->Object);
+        return frame->Type->Element;
+    }
+
+    void BeginContainer(const YAML::Mark& mark, YAML::anchor_t anchor, ETypeKind kind, const char* name)
+    {
+        if(Skipping())
+        {
+            m_SkipDepth++;
+            return;
+        }
+        if(CheckAnchor(mark, anchor))
+        {
+            return;
+        }
+        TFrame* frame = Top();
+        void* dest = m_Root;
+        const TTypeInfo* type = m_RootType;
+        if(frame != NULL)
+        {
+            if(frame->Type->Kind == ETYPE_STRUCT && frame->Field == NULL)
+            {
+                SetError(EBIND_TYPE_MISMATCH, mark, Path(), std::string("expected scalar key, got ") + name);
+                return;
+            }
+            type = BeginValue(frame, dest);
+        }
+        if(type->Kind != kind)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, Path(), std::string("expected ") + (type->Kind == ETYPE_SCALAR ? type->Name :
+                     (type->Kind == ETYPE_STRUCT ? "map" : "sequence")) + ", got " + name);
+            return;
+        }
+        if(kind == ETYPE_SEQUENCE)
+        {
+            type->Clear(dest);
+        }
+        TFrame child;
+        child.Object = (char*)dest;
+        child.Type = type;
+        child.Field = NULL;
+        child.PendingField = NULL;
+        child.Hint = 0;
+        child.UnknownKey = false;
+        child.Seen = 0;
+        child.Count = 0;
+        child.StartMark = mark;
+        m_Stack.push_back(child);
+    }
+
+    void EndContainer()
+    {
+        if(m_SkipDepth > 0)
+        {
+            m_SkipDepth--;
+            return;
+        }
+        if(m_Done || HasError())
+        {
+            return;
+        }
+        m_Stack.pop_back();
+        if(m_Stack.empty())
+        {
+            m_Done = true;
+        }
+        else
+        {
+            m_Stack.back().PendingField = NULL;
+        }
+    }
+
+    void CheckRequired(const TFrame& frame)
+    {
+        if(frame.Type->Kind != ETYPE_STRUCT)
+        {
+            return;
+        }
+        for(int i = 0; i < frame.Type->FieldCount; i++)
+        {
+            const TFieldInfo& field = frame.Type->Fields[i];
+            if(field.Required && (frame.Seen & (1ull << i)) == 0)
+            {
+                std::string path = Path();
+                SetError(EBIND_MISSING_FIELD, frame.StartMark, path.empty() ? field.Key : path + "." + field.Key,
+                         std::string("missing required field of ") + frame.Type->Name);
+                return;
+            }
+        }
+    }
+
+    // 仅在出错时构造
+    std::string Path() const
+    {
+        std::string path;
+        if(m_PathPrefix != NULL)
+        {
+            char index[32];
+            snprintf(index, sizeof(index), "[%d]", m_PathIndex);
+            path = *m_PathPrefix + index;
+        }
+        for(size_t i = 0; i < m_Stack.size(); i++)
+        {
+            const TFrame& frame = m_Stack[i];
+            if(frame.Type->Kind == ETYPE_STRUCT)
+            {
+                const TFieldInfo* field = frame.Field != NULL ? frame.Field : frame.PendingField;
+                if(field != NULL)
+                {
+                    if(!path.empty())
+                    {
+                        path += ".";
+                    }
+                    path += field->Key;
+                }
+            }
+            else if(frame.Count > 0)
+            {
+                char index[32];
+                snprintf(index, sizeof(index), "[%d]", frame.Count - 1);
+                path += index;
+            }
+        }
+        return path;
+    }
+private:
+    void* m_Root;
+    const TTypeInfo* m_RootType;
+    bool m_Strict;
+    bool m_Done;
+    int m_SkipDepth;
+    std::vector<TFrame> m_Stack;
+    TBindError m_Error;
+    const std::string* m_PathPrefix;
+    int m_PathIndex;
+    int m_LineOffset;
+};
+
+// 加载入口：成功返回true，失败通过GetError获取错误码、位置、字段路径与消息
+// 未出现的字段保持调用前的值，序列字段在出现时先清空
+class SchemaLoader
+{
+public:
+    SchemaLoader(): m_Strict(false)
+    {
+    }
+
+    // 严格模式下出现未声明的键报错，默认跳过
+    void SetStrict(bool strict)
+    {
+        m_Strict = strict;
+    }
+
+    const TBindError& GetError() const
+    {
+        return m_Handler.GetError();
+    }
+
+    template<class T>
+    bool Load(std::istream& in, T& config)
+    {
+        m_Handler.Reset(&config, TypeOf(&config), m_Strict);
+        try
+        {
+            YAML::Parser parser(in);
+            parser.HandleNextDocument(m_Handler);
+        }
+        catch(const YAML::Exception& e)
+        {
+            m_Handler.SetError(EBIND_SYNTAX_ERROR, e.mark, "", e.msg);
+            return false;
+        }
+        if(!m_Handler.IsDone() && !m_Handler.HasError())
+        {
+            m_Handler.OnDocumentEnd();
+        }
+        return !m_Handler.HasError();
+    }
+
+    template<class T>
+    bool LoadString(const std::string& text, T& config)
+    {
+        std::istringstream in(text);
+        return Load(in, config);
+    }
+
+    template<class T>
+    bool LoadFile(const char* path, T& config)
+    {
+        std::ifstream in(path);
+        if(!in)
+        {
+            m_Handler.Reset(&config, TypeOf(&config), m_Strict);
+            m_Handler.SetError(EBIND_FILE_ERROR, YAML::Mark::null_mark(), "", std::string("failed to open ") + path);
+            return false;
+        }
+        return Load(in, config);
+    }
+private:
+    SchemaLoader(const SchemaLoader&);
+    SchemaLoader& operator=(const SchemaLoader&);
+private:
+    BindHandler m_Handler;
+    bool m_Strict;
+};
+
+} // namespace YAMLUtil
+
+#endif // YAMLBINDING_HPP
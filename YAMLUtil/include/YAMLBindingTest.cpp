@@ -0,0 +1,296 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <math.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "YAMLBinding.hpp"
+#include "yaml-cpp/yaml.h"
+#include "HRTimer.hpp"
+
+// 统计堆分配次数
+static uint64_t g_Allocations = 0;
+
+void* operator new(size_t size)
+{
+    g_Allocations++;
+    void* p = malloc(size);
+    if(p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace Config
+{
+
+struct TInstrument
+{
+    char InstrumentID[32];
+    char ExchangeID[16];
+    int VolumeMultiple;
+    double PriceTick;
+    bool Enabled;
+    std::vector<int> Sessions;
+};
+
+YAML_BIND(TInstrument,
+    YAML_REQUIRED(InstrumentID),
+    YAML_REQUIRED(ExchangeID),
+    YAML_FIELD(VolumeMultiple),
+    YAML_FIELD(PriceTick),
+    YAML_FIELD(Enabled),
+    YAML_FIELD_AS(Sessions, "TradingSessions"))
+
+struct TServer
+{
+    char IP[16];
+    uint16_t Port;
+};
+
+YAML_BIND(TServer,
+    YAML_REQUIRED(IP),
+    YAML_REQUIRED(Port))
+
+struct TTraderConfig
+{
+    std::string Account;
+    TServer Server;
+    int64_t OrderRef;
+    uint8_t CPU;
+    float Ratio;
+    std::vector<std::string> Products;
+    std::vector<TInstrument> Instruments;
+};
+
+YAML_BIND(TTraderConfig,
+    YAML_REQUIRED(Account),
+    YAML_FIELD(Server),
+    YAML_FIELD(OrderRef),
+    YAML_FIELD(CPU),
+    YAML_FIELD(Ratio),
+    YAML_FIELD(Products),
+    YAML_FIELD(Instruments))
+
+// 字段数达到YAML_BIND_MAX_FIELDS，最后一个字段为必填
+struct TWide
+{
+    int F00, F01, F02, F03, F04, F05, F06, F07;
+    int F08, F09, F10, F11, F12, F13, F14, F15;
+    int F16, F17, F18, F19, F20, F21, F22, F23;
+    int F24, F25, F26, F27, F28, F29, F30, F31;
+    int F32, F33, F34, F35, F36, F37, F38, F39;
+    int F40, F41, F42, F43, F44, F45, F46, F47;
+    int F48, F49, F50, F51, F52, F53, F54, F55;
+    int F56, F57, F58, F59, F60, F61, F62, F63;
+};
+
+YAML_BIND(TWide,
+    YAML_FIELD(F00), YAML_FIELD(F01), YAML_FIELD(F02), YAML_FIELD(F03), YAML_FIELD(F04), YAML_FIELD(F05), YAML_FIELD(F06), YAML_FIELD(F07),
+    YAML_FIELD(F08), YAML_FIELD(F09), YAML_FIELD(F10), YAML_FIELD(F11), YAML_FIELD(F12), YAML_FIELD(F13), YAML_FIELD(F14), YAML_FIELD(F15),
+    YAML_FIELD(F16), YAML_FIELD(F17), YAML_FIELD(F18), YAML_FIELD(F19), YAML_FIELD(F20), YAML_FIELD(F21), YAML_FIELD(F22), YAML_FIELD(F23),
+    YAML_FIELD(F24), YAML_FIELD(F25), YAML_FIELD(F26), YAML_FIELD(F27), YAML_FIELD(F28), YAML_FIELD(F29), YAML_FIELD(F30), YAML_FIELD(F31),
+    YAML_FIELD(F32), YAML_FIELD(F33), YAML_FIELD(F34), YAML_FIELD(F35), YAML_FIELD(F36), YAML_FIELD(F37), YAML_FIELD(F38), YAML_FIELD(F39),
+    YAML_FIELD(F40), YAML_FIELD(F41), YAML_FIELD(F42), YAML_FIELD(F43), YAML_FIELD(F44), YAML_FIELD(F45), YAML_FIELD(F46), YAML_FIELD(F47),
+    YAML_FIELD(F48), YAML_FIELD(F49), YAML_FIELD(F50), YAML_FIELD(F51), YAML_FIELD(F52), YAML_FIELD(F53), YAML_FIELD(F54), YAML_FIELD(F55),
+    YAML_FIELD(F56), YAML_FIELD(F57), YAML_FIELD(F58), YAML_FIELD(F59), YAML_FIELD(F60), YAML_FIELD(F61), YAML_FIELD(F62), YAML_REQUIRED(F63))
+
+}
+
+static const char* CONFIG =
+    "Account: 188795\n"
+    "Server:\n"
+    "  IP: 180.168.146.187\n"
+    "  Port: 10130\n"
+    "OrderRef: 0x100000000\n"
+    "CPU: 3\n"
+    "Ratio: 0.5\n"
+    "Comment: {Author: test, Tags: [a, b]}\n"
+    "Products: [rb, 'ag', \"au\"]\n"
+    "Instruments:\n"
+    "  - {InstrumentID: rb2405, ExchangeID: SHFE, VolumeMultiple: 10, PriceTick: 1, Enabled: Yes, TradingSessions: [1, 2]}\n"
+    "  - InstrumentID: IF2403\n"
+    "    ExchangeID: CFFEX\n"
+    "    PriceTick: 0.2\n"
+    "    Enabled: off\n"
+    "    Extra: ~\n";
+
+static YAMLUtil::EBindErrorCode LoadError(const char* text, std::string* message = NULL, bool strict = false)
+{
+    Config::TTraderConfig config;
+    YAMLUtil::SchemaLoader loader;
+    loader.SetStrict(strict);
+    if(loader.LoadString(text, config))
+    {
+        return YAMLUtil::EBIND_OK;
+    }
+    if(message != NULL)
+    {
+        *message = loader.GetError().Message;
+    }
+    return loader.GetError().Code;
+}
+
+static std::string MakeInstruments(int count)
+{
+    std::string text = "Account: bench\nInstruments:\n";
+    char line[256];
+    for(int i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line), "  - InstrumentID: ag%05d\n    ExchangeID: SHFE\n    VolumeMultiple: %d\n    PriceTick: %.2f\n"
+                 "    Enabled: true\n    TradingSessions: [1, 2, 3]\n", i, 10 + i % 7, 0.5 + i % 3);
+        text += line;
+    }
+    return text;
+}
+
+// 仅遍历Parser事件，作为事件解析本身的耗时下限
+class NullHandler : public YAML::EventHandler
+{
+public:
+    virtual void OnDocumentStart(const YAML::Mark& mark) override {}
+    virtual void OnDocumentEnd() override {}
+    virtual void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override {}
+    virtual void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override {}
+    virtual void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override {}
+    virtual void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {}
+    virtual void OnSequenceEnd() override {}
+    virtual void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {}
+    virtual void OnMapEnd() override {}
+};
+
+// 对照：YAML::Load构建节点树后逐字段as<T>()
+static void LoadByNode(const std::string& text, Config::TTraderConfig& config)
+{
+    YAML::Node root = YAML::Load(text);
+    config.Account = root["Account"].as<std::string>();
+    YAML::Node instruments = root["Instruments"];
+    config.Instruments.clear();
+    config.Instruments.reserve(instruments.size());
+    for(size_t i = 0; i < instruments.size(); i++)
+    {
+        YAML::Node node = instruments[i];
+        Config::TInstrument instrument;
+        strncpy(instrument.InstrumentID, node["InstrumentID"].as<std::string>().c_str(), sizeof(instrument.InstrumentID) - 1);
+        strncpy(instrument.ExchangeID, node["ExchangeID"].as<std::string>().c_str(), sizeof(instrument.ExchangeID) - 1);
+        instrument.VolumeMultiple = node["VolumeMultiple"].as<int>();
+        instrument.PriceTick = node["PriceTick"].as<double>();
+        instrument.Enabled = node["Enabled"].as<bool>();
+        instrument.Sessions = node["TradingSessions"].as<std::vector<int> >();
+        config.Instruments.push_back(instrument);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // 绑定结果与嵌套结构
+    Config::TTraderConfig config;
+    config.CPU = 0;
+    YAMLUtil::SchemaLoader loader;
+    assert(loader.LoadString(CONFIG, config));
+    assert(config.Account == "188795");
+    assert(strcmp(config.Server.IP, "180.168.146.187") == 0 && config.Server.Port == 10130);
+    assert(config.OrderRef == 0x100000000ll && config.CPU == 3 && config.Ratio == 0.5f);
+    assert(config.Products.size() == 3 && config.Products[1] == "ag" && config.Products[2] == "au");
+    assert(config.Instruments.size() == 2);
+    const Config::TInstrument& rb = config.Instruments[0];
+    assert(strcmp(rb.InstrumentID, "rb2405") == 0 && strcmp(rb.ExchangeID, "SHFE") == 0);
+    assert(rb.VolumeMultiple == 10 && rb.PriceTick == 1.0 && rb.Enabled);
+    assert(rb.Sessions.size() == 2 && rb.Sessions[1] == 2);
+    const Config::TInstrument& index = config.Instruments[1];
+    assert(strcmp(index.InstrumentID, "IF2403") == 0 && index.VolumeMultiple == 0 && index.PriceTick == 0.2 && !index.Enabled);
+    assert(index.Sessions.empty());
+    // 再次加载时序列先清空
+    assert(loader.LoadString(CONFIG, config) && config.Instruments.size() == 2 && config.Products.size() == 3);
+
+    // 类型化错误：错误码、位置与字段路径
+    std::string message;
+    assert(LoadError("Account: a\nCPU: 256\n", &message) == YAMLUtil::EBIND_OUT_OF_RANGE);
+    assert(message == "line 2, column 6: CPU: out of range uint8, got \"256\"");
+    assert(LoadError("Account: a\nInstruments:\n  - {InstrumentID: a, ExchangeID: b}\n  - {InstrumentID: c, ExchangeID: d, PriceTick: x}\n",
+                     &message) == YAMLUtil::EBIND_INVALID_VALUE);
+    assert(message == "line 4, column 49: Instruments[1].PriceTick: expected double, got \"x\"");
+    assert(LoadError("Account: a\nInstruments:\n  - {InstrumentID: a}\n", &message) == YAMLUtil::EBIND_MISSING_FIELD);
+    assert(message == "line 3, column 5: Instruments[0].ExchangeID: missing required field of TInstrument");
+    assert(LoadError("Server: {IP: 1.1.1.1, Port: 1}\n", &message) == YAMLUtil::EBIND_MISSING_FIELD);
+    assert(message == "line 1, column 1: Account: missing required field of TTraderConfig");
+    assert(LoadError("Account: a\nServer: {IP: 1234567890.1234567, Port: 1}\n", &message) == YAMLUtil::EBIND_STRING_TOO_LONG);
+    assert(message == "line 2, column 14: Server.IP: string longer than 15, got \"1234567890.1234567\"");
+    assert(LoadError("Account: a\nServer: [1, 2]\n", &message) == YAMLUtil::EBIND_TYPE_MISMATCH);
+    assert(message == "line 2, column 9: Server: expected map, got sequence");
+    assert(LoadError("Account: a\nProducts: {a: 1}\n") == YAMLUtil::EBIND_TYPE_MISMATCH);
+    assert(LoadError("Account: [a]\n") == YAMLUtil::EBIND_TYPE_MISMATCH);
+    assert(LoadError("- a\n") == YAMLUtil::EBIND_TYPE_MISMATCH);
+    assert(LoadError("Account: a\nCPU: -1\n") == YAMLUtil::EBIND_OUT_OF_RANGE);
+    assert(LoadError("Account: a\nOrderRef: 12abc\n") == YAMLUtil::EBIND_INVALID_VALUE);
+    assert(LoadError("Account: a\nUnknown: 1\n") == YAMLUtil::EBIND_OK);
+    {
+        Config::TWide wide;
+        YAMLUtil::SchemaLoader loader;
+        assert(!loader.LoadString("F00: 1\nF62: 2\n", wide) && loader.GetError().Code == YAMLUtil::EBIND_MISSING_FIELD);
+        assert(loader.GetError().Message == "line 1, column 1: F63: missing required field of TWide");
+        assert(loader.LoadString("F00: 1\nF63: 3\n", wide) && wide.F00 == 1 && wide.F63 == 3);
+    }
+    assert(LoadError("Account: a\nUnknown: 1\n", &message, true) == YAMLUtil::EBIND_UNKNOWN_KEY);
+    assert(message == "line 2, column 1: Unknown: unknown key for TTraderConfig");
+    assert(LoadError("Account: &x a\n") == YAMLUtil::EBIND_UNSUPPORTED);
+    assert(LoadError("Account: a: b\n", &message) == YAMLUtil::EBIND_SYNTAX_ERROR);
+    assert(message == "line 1, column 11: illegal map value");
+    assert(LoadError("") == YAMLUtil::EBIND_EMPTY_DOCUMENT);
+    assert(LoadError("~\n") == YAMLUtil::EBIND_EMPTY_DOCUMENT);
+    {
+        Config::TTraderConfig missing;
+        assert(!loader.LoadFile("/nonexistent/config.yml", missing));
+        assert(loader.GetError().Code == YAMLUtil::EBIND_FILE_ERROR);
+    }
+
+    // 加载耗时与分配次数：10000个合约
+    const int N = 10000;
+    std::string text = MakeInstruments(N);
+    TimeUtil::HRTimer timer;
+    Config::TTraderConfig byNode;
+    uint64_t allocations = g_Allocations;
+    uint64_t start = timer.GetTimeNs();
+    LoadByNode(text, byNode);
+    uint64_t end = timer.GetTimeNs();
+    uint64_t nodeAllocations = g_Allocations - allocations;
+    fprintf(stderr, "YAML::Node Load %d Instruments: %.2f ms, %lu Allocations\n", N, (end - start) / 1e6, nodeAllocations);
+    Config::TTraderConfig bound;
+    allocations = g_Allocations;
+    start = timer.GetTimeNs();
+    assert(loader.LoadString(text, bound));
+    end = timer.GetTimeNs();
+    uint64_t bindAllocations = g_Allocations - allocations;
+    fprintf(stderr, "YAMLUtil::SchemaLoader Load %d Instruments: %.2f ms, %lu Allocations\n", N, (end - start) / 1e6, bindAllocations);
+    NullHandler handler;
+    std::istringstream in(text);
+    YAML::Parser parser(in);
+    allocations = g_Allocations;
+    start = timer.GetTimeNs();
+    parser.HandleNextDocument(handler);
+    end = timer.GetTimeNs();
+    fprintf(stderr, "YAML::Parser Events Only %d Instruments: %.2f ms, %lu Allocations\n", N, (end - start) / 1e6, g_Allocations - allocations);
+    assert(bound.Instruments.size() == (size_t)N && byNode.Instruments.size() == (size_t)N);
+    for(int i = 0; i < N; i++)
+    {
+        const Config::TInstrument& a = bound.Instruments[i];
+        const Config::TInstrument& b = byNode.Instruments[i];
+        assert(strcmp(a.InstrumentID, b.InstrumentID) == 0 && strcmp(a.ExchangeID, b.ExchangeID) == 0);
+        assert(a.VolumeMultiple == b.VolumeMultiple && a.PriceTick == b.PriceTick && a.Enabled == b.Enabled && a.Sessions == b.Sessions);
+    }
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 YAMLBindingTest.cpp -o test -I. -I../../FMTLogger/include -I../../YAML-CPP/0.8.0/include -L../../YAML-CPP/0.8.0/lib -lyaml-cpp
@@ -0,0 +1,693 @@
+#ifndef YAMLSTREAMLOADER_HPP
+#define YAMLSTREAMLOADER_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <streambuf>
+#include <istream>
+#include <fstream>
+#include <type_traits>
+#include <exception>
+#include "YAMLBinding.hpp"
+
+namespace YAMLUtil
+{
+
+// 只读内存区间上的输入流缓冲，不复制数据
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char* data, size_t size)
+    {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+// 提前结束解析：回调要求停止、绑定出错或目标序列已读完
+struct TStopParsing
+{
+};
+
+// 逐个绑定目标序列的元素并回调，其余内容只计数嵌套深度后丢弃
+// key为空时文档根节点即目标序列，否则目标为根映射中key对应的值
+template<class T, class Callback>
+class StreamHandler : public YAML::EventHandler
+{
+public:
+    StreamHandler(Callback& callback, const std::string& key, const T& defaultValue, bool strict)
+        : m_Callback(callback), m_Key(key), m_Default(defaultValue), m_Value(defaultValue), m_Type(TypeOf((T*)0)),
+          m_Strict(strict), m_RootSequence(key.empty()), m_IndexBase(0), m_LineOffset(0), m_Stop(NULL)
+    {
+        m_Depth = 0;
+        m_SequenceDepth = 0;
+        m_ExpectKey = false;
+        m_TargetNext = false;
+        m_InSequence = false;
+        m_InElement = false;
+        m_Found = false;
+        m_Stopped = false;
+        m_Count = 0;
+    }
+
+    // 并行分段：分段按根序列解析，错误路径仍以key为前缀，元素序号与行号加上分段起点
+    void SetOrigin(size_t indexBase, int lineOffset, std::atomic<bool>* stop)
+    {
+        m_RootSequence = true;
+        m_IndexBase = indexBase;
+        m_LineOffset = lineOffset;
+        m_Stop = stop;
+    }
+
+    size_t GetCount() const
+    {
+        return m_Count;
+    }
+
+    bool IsStopped() const
+    {
+        return m_Stopped;
+    }
+
+    bool HasError() const
+    {
+        return m_Element.HasError();
+    }
+
+    const TBindError& GetError() const
+    {
+        return m_Element.GetError();
+    }
+
+    void SetError(EBindErrorCode code, const YAML::Mark& mark, const std::string& path, const std::string& message)
+    {
+        m_Element.SetOrigin(NULL, 0, m_LineOffset);
+        m_Element.SetError(code, mark, path, message);
+    }
+
+    virtual void OnDocumentStart(const YAML::Mark& mark) override
+    {
+    }
+
+    virtual void OnDocumentEnd() override
+    {
+        if(m_Found)
+        {
+            return;
+        }
+        if(m_RootSequence)
+        {
+            SetError(EBIND_EMPTY_DOCUMENT, YAML::Mark::null_mark(), "", "empty document, expected sequence");
+        }
+        else
+        {
+            SetError(EBIND_MISSING_FIELD, YAML::Mark::null_mark(), m_Key, "sequence not found");
+        }
+    }
+
+    virtual void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override
+    {
+        if(m_InElement)
+        {
+            m_Element.OnNull(mark, anchor);
+            EndEvent();
+            return;
+        }
+        if(m_InSequence && m_Depth == m_SequenceDepth)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, ElementPath(m_Count), std::string("expected ") + m_Type->Name + ", got null");
+            throw TStopParsing();
+        }
+        if(!m_RootSequence && m_Depth == 1)
+        {
+            OnRootScalar(mark, NULL);
+        }
+    }
+
+    virtual void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override
+    {
+        if(m_InElement)
+        {
+            m_Element.OnAlias(mark, anchor);
+            EndEvent();
+            return;
+        }
+        if(m_InSequence && m_Depth == m_SequenceDepth)
+        {
+            SetError(EBIND_UNSUPPORTED, mark, ElementPath(m_Count), "alias is not supported");
+            throw TStopParsing();
+        }
+        if(!m_RootSequence && m_Depth == 1)
+        {
+            OnRootScalar(mark, NULL);
+        }
+    }
+
+    virtual void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override
+    {
+        if(m_InElement)
+        {
+            m_Element.OnScalar(mark, tag, anchor, value);
+            EndEvent();
+            return;
+        }
+        if(m_InSequence && m_Depth == m_SequenceDepth)
+        {
+            BeginElement();
+            m_Element.OnScalar(mark, tag, anchor, value);
+            EndEvent();
+            return;
+        }
+        if(m_Depth == 0)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, "", std::string("expected ") + (m_RootSequence ? "sequence" : "map") + ", got scalar");
+            throw TStopParsing();
+        }
+        if(!m_RootSequence && m_Depth == 1)
+        {
+            OnRootScalar(mark, &value);
+        }
+    }
+
+    virtual void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override
+    {
+        if(m_InElement || (m_InSequence && m_Depth == m_SequenceDepth))
+        {
+            if(!m_InElement)
+            {
+                BeginElement();
+            }
+            m_Element.OnSequenceStart(mark, tag, anchor, style);
+            EndEvent();
+            return;
+        }
+        if((m_Depth == 0 && m_RootSequence) || m_TargetNext)
+        {
+            m_Depth++;
+            m_SequenceDepth = m_Depth;
+            m_InSequence = true;
+            m_TargetNext = false;
+            m_Found = true;
+            return;
+        }
+        if(m_Depth == 0)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, "", "expected map, got sequence");
+            throw TStopParsing();
+        }
+        m_Depth++;
+    }
+
+    virtual void OnSequenceEnd() override
+    {
+        if(m_InElement)
+        {
+            m_Element.OnSequenceEnd();
+            EndEvent();
+            return;
+        }
+        m_Depth--;
+        if(m_InSequence && m_Depth < m_SequenceDepth)
+        {
+            // 目标序列已读完，其后内容不再解析
+            m_InSequence = false;
+            throw TStopParsing();
+        }
+        m_ExpectKey = true;
+    }
+
+    virtual void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override
+    {
+        if(m_InElement || (m_InSequence && m_Depth == m_SequenceDepth))
+        {
+            if(!m_InElement)
+            {
+                BeginElement();
+            }
+            m_Element.OnMapStart(mark, tag, anchor, style);
+            EndEvent();
+            return;
+        }
+        if(m_TargetNext)
+        {
+            SetError(EBIND_TYPE_MISMATCH, mark, m_Key, "expected sequence, got map");
+            throw TStopParsing();
+        }
+        if(m_Depth == 0)
+        {
+            if(m_RootSequence)
+            {
+                SetError(EBIND_TYPE_MISMATCH, mark, "", "expected sequence, got map");
+                throw TStopParsing();
+            }
+            m_ExpectKey = true;
+        }
+        m_Depth++;
+    }
+
+    virtual void OnMapEnd() override
+    {
+        if(m_InElement)
+        {
+            m_Element.OnMapEnd();
+            EndEvent();
+            return;
+        }
+        m_Depth--;
+        m_ExpectKey = true;
+    }
+protected:
+    void OnRootScalar(const YAML::Mark& mark, const std::string* value)
+    {
+        if(m_ExpectKey)
+        {
+            m_TargetNext = value != NULL && *value == m_Key;
+            m_ExpectKey = false;
+            return;
+        }
+        if(m_TargetNext)
+        {
+            // 键存在但值为空，视为空序列
+            if(value == NULL)
+            {
+                m_Found = true;
+                throw TStopParsing();
+            }
+            SetError(EBIND_TYPE_MISMATCH, mark, m_Key, "expected sequence, got scalar \"" + *value + "\"");
+            throw TStopParsing();
+        }
+        m_ExpectKey = true;
+    }
+
+    void BeginElement()
+    {
+        if(m_Stop != NULL && m_Stop->load(std::memory_order_relaxed))
+        {
+            m_Stopped = true;
+            throw TStopParsing();
+        }
+        // 复制赋值复用元素中序列字段的内存
+        m_Value = m_Default;
+        m_Element.Reset(&m_Value, m_Type, m_Strict);
+        m_Element.SetOrigin(&m_Key, (int)(m_IndexBase + m_Count), m_LineOffset);
+        m_InElement = true;
+    }
+
+    void EndEvent()
+    {
+        if(m_Element.HasError())
+        {
+            throw TStopParsing();
+        }
+        if(!m_Element.IsDone())
+        {
+            return;
+        }
+        m_InElement = false;
+        size_t index = m_IndexBase + m_Count;
+        m_Count++;
+        // 并行模式下回调在工作线程执行，异常不能抛出线程，转为加载错误并停止其他线程
+        bool next = false;
+        try
+        {
+            next = m_Callback(m_Value, index);
+        }
+        catch(const std::exception& e)
+        {
+            SetError(EBIND_CALLBACK_ERROR, YAML::Mark::null_mark(), ElementPath(m_Count - 1), e.what());
+        }
+        catch(...)
+        {
+            SetError(EBIND_CALLBACK_ERROR, YAML::Mark::null_mark(), ElementPath(m_Count - 1), "unknown exception in callback");
+        }
+        if(!next)
+        {
+            m_Stopped = true;
+            if(m_Stop != NULL)
+            {
+                m_Stop->store(true, std::memory_order_relaxed);
+            }
+            throw TStopParsing();
+        }
+    }
+
+    std::string ElementPath(size_t count) const
+    {
+        char index[32];
+        snprintf(index, sizeof(index), "[%lu]", (unsigned long)(m_IndexBase + count));
+        return m_Key + index;
+    }
+private:
+    StreamHandler(const StreamHandler&);
+    StreamHandler& operator=(const StreamHandler&);
+private:
+    Callback& m_Callback;
+    std::string m_Key;
+    const T& m_Default;
+    T m_Value;
+    const TTypeInfo* m_Type;
+    BindHandler m_Element;
+    bool m_Strict;
+    bool m_RootSequence;
+    size_t m_IndexBase;
+    int m_LineOffset;
+    std::atomic<bool>* m_Stop;
+    int m_Depth;
+    int m_SequenceDepth;
+    bool m_ExpectKey;
+    bool m_TargetNext;
+    bool m_InSequence;
+    bool m_InElement;
+    bool m_Found;
+    bool m_Stopped;
+    size_t m_Count;
+};
+
+// 流式加载大序列：每绑定完一个元素即回调callback(T& element, size_t index)，回调返回false则停止，
+// 回调抛出异常时停止并以EBIND_CALLBACK_ERROR返回失败
+// 顺序模式内存占用与文件大小无关；读完目标序列即停止解析，其后内容不做校验
+// 并行模式将块格式的目标序列按元素切分到多个线程解析，回调在各线程中并发执行且不保证顺序，
+// 目标序列以外的内容不解析；无法切分时(流格式序列等)退回顺序模式
+template<class T>
+class StreamLoader
+{
+public:
+    StreamLoader(): m_Default(), m_Strict(false), m_Threads(1), m_Count(0)
+    {
+        m_Error.Code = EBIND_OK;
+        m_Error.Line = 0;
+        m_Error.Column = 0;
+    }
+
+    // 目标序列在根映射中的键，空则根节点为序列
+    void SetSequenceKey(const std::string& key)
+    {
+        m_Key = key;
+    }
+
+    void SetStrict(bool strict)
+    {
+        m_Strict = strict;
+    }
+
+    // 每个元素绑定前的初始值
+    void SetDefault(const T& value)
+    {
+        m_Default = value;
+    }
+
+    void SetThreads(int threads)
+    {
+        m_Threads = threads < 1 ? 1 : threads;
+    }
+
+    // 已回调的元素数
+    size_t GetCount() const
+    {
+        return m_Count;
+    }
+
+    const TBindError& GetError() const
+    {
+        return m_Error;
+    }
+
+    template<class Callback>
+    bool Load(std::istream& in, Callback&& callback)
+    {
+        typedef typename std::remove_reference<Callback>::type TCallback;
+        StreamHandler<T, TCallback> handler(callback, m_Key, m_Default, m_Strict);
+        bool ret = Parse(in, handler);
+        m_Count = handler.GetCount();
+        m_Error = handler.GetError();
+        return ret;
+    }
+
+    template<class Callback>
+    bool LoadString(const std::string& text, Callback&& callback)
+    {
+        return LoadBuffer(text.data(), text.size(), callback);
+    }
+
+    // 顺序模式逐块读取文件，并行模式映射整个文件
+    template<class Callback>
+    bool LoadFile(const char* path, Callback&& callback)
+    {
+        m_Count = 0;
+        if(m_Threads <= 1)
+        {
+            std::ifstream in(path);
+            if(!in)
+            {
+                SetFileError(path);
+                return false;
+            }
+            return Load(in, callback);
+        }
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if(fd < 0 || fstat(fd, &st) != 0)
+        {
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+            SetFileError(path);
+            return false;
+        }
+        if(st.st_size == 0)
+        {
+            close(fd);
+            return LoadBuffer("", 0, callback);
+        }
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(data == MAP_FAILED)
+        {
+            SetFileError(path);
+            return false;
+        }
+        bool ret = LoadBuffer((const char*)data, st.st_size, callback);
+        munmap(data, st.st_size);
+        return ret;
+    }
+
+    template<class Callback>
+    bool LoadBuffer(const char* data, size_t size, Callback&& callback)
+    {
+        std::vector<TChunk> chunks;
+        if(m_Threads <= 1 || !Split(data, size, chunks))
+        {
+            MemoryStreamBuf buffer(data, size);
+            std::istream in(&buffer);
+            return Load(in, callback);
+        }
+        typedef typename std::remove_reference<Callback>::type TCallback;
+        std::vector<TBindError> errors(chunks.size());
+        std::vector<size_t> counts(chunks.size(), 0);
+        std::vector<char> results(chunks.size(), 1);
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> threads;
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            auto parse = [&, i]()
+            {
+                StreamHandler<T, TCallback> handler(callback, m_Key, m_Default, m_Strict);
+                handler.SetOrigin(chunks[i].IndexBase, chunks[i].LineOffset, &stop);
+                MemoryStreamBuf buffer(data + chunks[i].Begin, chunks[i].End - chunks[i].Begin);
+                std::istream in(&buffer);
+                results[i] = Parse(in, handler);
+                errors[i] = handler.GetError();
+                counts[i] = handler.GetCount();
+                if(!results[i])
+                {
+                    stop.store(true, std::memory_order_relaxed);
+                }
+            };
+            if(i + 1 < chunks.size())
+            {
+                threads.push_back(std::thread(parse));
+            }
+            else
+            {
+                parse();
+            }
+        }
+        for(size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i].join();
+        }
+        m_Count = 0;
+        m_Error = errors[0];
+        bool ret = true;
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            m_Count += counts[i];
+            // 取序号最小的错误
+            if(!results[i] && ret)
+            {
+                m_Error = errors[i];
+                ret = false;
+            }
+        }
+        return ret;
+    }
+protected:
+    struct TChunk
+    {
+        size_t Begin;
+        size_t End;
+        size_t IndexBase;
+        int LineOffset;
+    };
+
+    // 各线程独立调用，不修改成员
+    template<class Handler>
+    static bool Parse(std::istream& in, Handler& handler)
+    {
+        try
+        {
+            YAML::Parser parser(in);
+            parser.HandleNextDocument(handler);
+        }
+        catch(const TStopParsing&)
+        {
+        }
+        catch(const YAML::Exception& e)
+        {
+            handler.SetError(EBIND_SYNTAX_ERROR, e.mark, "", e.msg);
+        }
+        return !handler.HasError();
+    }
+
+    void SetFileError(const char* path)
+    {
+        m_Error.Code = EBIND_FILE_ERROR;
+        m_Error.Line = 0;
+        m_Error.Column = 0;
+        m_Error.Path.clear();
+        m_Error.Message = std::string("failed to open ") + path;
+    }
+
+    // 按行扫描定位块格式目标序列，在与首元素同缩进的"- "行处切分
+    bool Split(const char* data, size_t size, std::vector<TChunk>& chunks) const
+    {
+        size_t pos = 0;
+        int line = 0;
+        int indent = -1;
+        bool header = m_Key.empty();
+        std::vector<size_t> items;
+        std::vector<int> itemLines;
+        size_t end = size;
+        while(pos < size)
+        {
+            size_t next = pos;
+            while(next < size && data[next] != '\n')
+            {
+                next++;
+            }
+            size_t lineEnd = next;
+            next = next < size ? next + 1 : size;
+            size_t first = pos;
+            while(first < lineEnd && data[first] == ' ')
+            {
+                first++;
+            }
+            int column = (int)(first - pos);
+            bool blank = first == lineEnd || data[first] == '#' || data[first] == '\r';
+            if(!header)
+            {
+                // 根映射中独占一行的"Key:"
+                size_t length = m_Key.size();
+                if(column == 0 && lineEnd - pos > length && memcmp(data + pos, m_Key.data(), length) == 0 && data[pos + length] == ':')
+                {
+                    size_t rest = pos + length + 1;
+                    while(rest < lineEnd && data[rest] == ' ')
+                    {
+                        rest++;
+                    }
+                    if(rest < lineEnd && data[rest] != '#' && data[rest] != '\r')
+                    {
+                        return false;
+                    }
+                    header = true;
+                }
+            }
+            else if(!blank)
+            {
+                bool item = data[first] == '-' && (first + 1 == lineEnd || data[first + 1] == ' ' || data[first + 1] == '\r');
+                if(indent < 0)
+                {
+                    if(m_Key.empty() && column == 0 && lineEnd - pos >= 3 && memcmp(data + pos, "---", 3) == 0)
+                    {
+                        // 根序列前的文档起始标记
+                        if(lineEnd - pos > 3 && data[pos + 3] != ' ' && data[pos + 3] != '\r')
+                        {
+                            return false;
+                        }
+                        pos = next;
+                        line++;
+                        continue;
+                    }
+                    if(!item)
+                    {
+                        return false;
+                    }
+                    indent = column;
+                }
+                if(column < indent || (column == indent && !item))
+                {
+                    end = pos;
+                    break;
+                }
+                if(column == indent)
+                {
+                    items.push_back(pos);
+                    itemLines.push_back(line);
+                }
+            }
+            pos = next;
+            line++;
+        }
+        if(items.size() < 2)
+        {
+            return false;
+        }
+        size_t count = items.size();
+        size_t chunkCount = (size_t)m_Threads < count ? (size_t)m_Threads : count;
+        for(size_t i = 0; i < chunkCount; i++)
+        {
+            size_t first = count * i / chunkCount;
+            size_t last = count * (i + 1) / chunkCount;
+            TChunk chunk;
+            chunk.Begin = items[first];
+            chunk.End = last < count ? items[last] : end;
+            chunk.IndexBase = first;
+            chunk.LineOffset = itemLines[first];
+            chunks.push_back(chunk);
+        }
+        return true;
+    }
+private:
+    StreamLoader(const StreamLoader&);
+    StreamLoader& operator=(const StreamLoader&);
+private:
+    std::string m_Key;
+    T m_Default;
+    bool m_Strict;
+    int m_Threads;
+    size_t m_Count;
+    TBindError m_Error;
+};
+
+} // namespace YAMLUtil
+
+#endif // YAMLSTREAMLOADER_HPP
@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "YAMLStreamLoader.hpp"
+#include "yaml-cpp/yaml.h"
+#include "HRTimer.hpp"
+
+namespace Config
+{
+
+struct TParameter
+{
+    char InstrumentID[32];
+    double UpperLimitPrice;
+    double LowerLimitPrice;
+    int MaxOrderVolume;
+    std::vector<double> Weights;
+};
+
+YAML_BIND(TParameter,
+    YAML_REQUIRED(InstrumentID),
+    YAML_FIELD(UpperLimitPrice),
+    YAML_FIELD(LowerLimitPrice),
+    YAML_FIELD(MaxOrderVolume),
+    YAML_FIELD(Weights))
+
+}
+
+static std::string MakeParameters(int count)
+{
+    std::string text = "TradingDay: 20240301\nSource: {Host: 127.0.0.1, Files: [a, b]}\nInstruments:\n";
+    char line[256];
+    for(int i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line), "  # %d\n  - InstrumentID: ag%05d\n    UpperLimitPrice: %d.5\n    LowerLimitPrice: %d\n"
+                 "    MaxOrderVolume: %d\n    Weights: [0.25, 0.75]\n", i, i, 6000 + i, 5000 + i, i % 500);
+        text += line;
+    }
+    text += "Checksum: 12345\n";
+    return text;
+}
+
+static void CheckParameter(const Config::TParameter& parameter, size_t index)
+{
+    char id[32];
+    snprintf(id, sizeof(id), "ag%05d", (int)index);
+    assert(strcmp(parameter.InstrumentID, id) == 0);
+    assert(parameter.UpperLimitPrice == 6000.5 + index && parameter.LowerLimitPrice == 5000.0 + index);
+    assert(parameter.MaxOrderVolume == (int)(index % 500) && parameter.Weights.size() == 2 && parameter.Weights[1] == 0.75);
+}
+
+// 返回加载错误消息，成功返回空串
+static std::string LoadError(const char* text, const char* key, int threads)
+{
+    YAMLUtil::StreamLoader<Config::TParameter> loader;
+    loader.SetSequenceKey(key);
+    loader.SetThreads(threads);
+    if(loader.LoadString(text, [](Config::TParameter&, size_t) { return true; }))
+    {
+        return "";
+    }
+    return loader.GetError().Message;
+}
+
+static long MaxRSS()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+int main(int argc, char* argv[])
+{
+    // 根序列，元素默认值与回调序号
+    {
+        YAMLUtil::StreamLoader<Config::TParameter> loader;
+        Config::TParameter value;
+        memset(value.InstrumentID, 0, sizeof(value.InstrumentID));
+        value.UpperLimitPrice = 0;
+        value.LowerLimitPrice = 0;
+        value.MaxOrderVolume = 100;
+        loader.SetDefault(value);
+        std::vector<std::string> ids;
+        std::vector<int> volumes;
+        assert(loader.LoadString("- {InstrumentID: a, Weights: [1]}\n- {InstrumentID: b, MaxOrderVolume: 5}\n- {InstrumentID: c}\n",
+                                 [&](Config::TParameter& parameter, size_t index)
+                                 {
+                                     assert(index == ids.size());
+                                     ids.push_back(parameter.InstrumentID);
+                                     volumes.push_back(parameter.MaxOrderVolume);
+                                     assert(parameter.Weights.size() == (index == 0 ? 1u : 0u));
+                                     return true;
+                                 }));
+        assert(loader.GetCount() == 3 && ids[2] == "c" && volumes[0] == 100 && volumes[1] == 5 && volumes[2] == 100);
+        // 回调返回false即停止
+        assert(loader.LoadString("- {InstrumentID: a}\n- {InstrumentID: b}\n- [\n", [](Config::TParameter&, size_t index) { return index < 1; }));
+        assert(loader.GetCount() == 2);
+    }
+
+    // 目标键：其他键整体跳过，空值视为空序列，流格式序列
+    {
+        YAMLUtil::StreamLoader<Config::TParameter> loader;
+        loader.SetSequenceKey("Instruments");
+        size_t count = 0;
+        auto counter = [&](Config::TParameter&, size_t) { count++; return true; };
+        assert(loader.LoadString("Other: [{InstrumentID: x}]\nInstruments: [{InstrumentID: a}, {InstrumentID: b}]\nTail: 1\n", counter));
+        assert(count == 2);
+        assert(loader.LoadString("Instruments:\nTail: 1\n", counter) && loader.GetCount() == 0);
+        loader.SetThreads(4);
+        assert(loader.LoadString("Instruments: [{InstrumentID: a}, {InstrumentID: b}]\n", counter) && loader.GetCount() == 2);
+    }
+
+    // 错误：元素路径与行号，顺序与并行一致
+    for(int threads = 1; threads <= 4; threads += 3)
+    {
+        const char* text = "Instruments:\n  - InstrumentID: a\n  - InstrumentID: b\n    UpperLimitPrice: high\n  - InstrumentID: c\n";
+        assert(LoadError(text, "Instruments", threads) == "line 4, column 22: Instruments[1].UpperLimitPrice: expected double, got \"high\"");
+        text = "Instruments:\n  - InstrumentID: a\n  - InstrumentID: b\n  - MaxOrderVolume: 1\n";
+        assert(LoadError(text, "Instruments", threads) == "line 4, column 5: Instruments[2].InstrumentID: missing required field of TParameter");
+        assert(LoadError("Instruments:\n  - {InstrumentID: a}\n  - abc\n", "Instruments", threads) ==
+               "line 3, column 5: Instruments[1]: expected TParameter, got scalar \"abc\"");
+        assert(LoadError("- {InstrumentID: a}\n- ~\n", "", threads) == "line 2, column 3: [1]: expected TParameter, got null");
+        assert(LoadError("Other: 1\n", "Instruments", threads) == "Instruments: sequence not found");
+        assert(LoadError("Instruments: 1\n", "Instruments", threads) == "line 1, column 14: Instruments: expected sequence, got scalar \"1\"");
+        assert(LoadError("Instruments: {a: 1}\n", "Instruments", threads) == "line 1, column 14: Instruments: expected sequence, got map");
+        assert(LoadError("a: 1\n", "", threads) == "line 1, column 1: expected sequence, got map");
+    }
+
+    // 回调抛出异常：并行模式在工作线程捕获，与顺序模式一样以加载错误返回
+    for(int threads = 1; threads <= 4; threads += 3)
+    {
+        std::string text = "Instruments:\n";
+        for(int i = 0; i < 64; i++)
+        {
+            text += "  - InstrumentID: a\n";
+        }
+        YAMLUtil::StreamLoader<Config::TParameter> loader;
+        loader.SetSequenceKey("Instruments");
+        loader.SetThreads(threads);
+        assert(!loader.LoadString(text, [](Config::TParameter&, size_t index)
+        {
+            if(index == 40)
+            {
+                throw std::runtime_error("bad instrument");
+            }
+            return true;
+        }));
+        assert(loader.GetError().Code == YAMLUtil::EBIND_CALLBACK_ERROR);
+        assert(loader.GetError().Message == "Instruments[40]: bad instrument");
+        assert(!loader.LoadString(text, [](Config::TParameter&, size_t index)
+        {
+            if(index == 3)
+            {
+                throw 1;
+            }
+            return true;
+        }));
+        assert(loader.GetError().Message == "Instruments[3]: unknown exception in callback");
+    }
+
+    // 大文件：顺序流式、并行与YAML::LoadFile对比
+    const int N = 10000;
+    const char* path = "/tmp/YAMLStreamLoaderTest.yml";
+    {
+        std::string text = MakeParameters(N);
+        FILE* fp = fopen(path, "w");
+        assert(fp != NULL && fwrite(text.data(), 1, text.size(), fp) == text.size());
+        fclose(fp);
+        fprintf(stderr, "File Size: %.2f MB\n", text.size() / 1048576.0);
+    }
+    TimeUtil::HRTimer timer;
+    YAMLUtil::StreamLoader<Config::TParameter> loader;
+    loader.SetSequenceKey("Instruments");
+    size_t count = 0;
+    long rss = MaxRSS();
+    uint64_t start = timer.GetTimeNs();
+    assert(loader.LoadFile(path, [&](Config::TParameter& parameter, size_t index)
+    {
+        assert(index == count);
+        CheckParameter(parameter, index);
+        count++;
+        return true;
+    }));
+    uint64_t end = timer.GetTimeNs();
+    assert(loader.GetCount() == (size_t)N && count == (size_t)N);
+    fprintf(stderr, "StreamLoader Sequential: %.2f ms, MaxRSS +%ld KB\n", (end - start) / 1e6, MaxRSS() - rss);
+
+    loader.SetThreads(4);
+    std::vector<char> seen(N, 0);
+    std::atomic<int> total(0);
+    start = timer.GetTimeNs();
+    assert(loader.LoadFile(path, [&](Config::TParameter& parameter, size_t index)
+    {
+        CheckParameter(parameter, index);
+        seen[index]++;
+        total++;
+        return true;
+    }));
+    end = timer.GetTimeNs();
+    assert(loader.GetCount() == (size_t)N && total == N);
+    for(int i = 0; i < N; i++)
+    {
+        assert(seen[i] == 1);
+    }
+    fprintf(stderr, "StreamLoader 4 Threads: %.2f ms\n", (end - start) / 1e6);
+
+    rss = MaxRSS();
+    start = timer.GetTimeNs();
+    {
+        YAML::Node root = YAML::LoadFile(path);
+        YAML::Node instruments = root["Instruments"];
+        assert(instruments.size() == (size_t)N);
+        for(size_t i = 0; i < instruments.size(); i++)
+        {
+            assert(instruments[i]["MaxOrderVolume"].as<int>() == (int)(i % 500));
+        }
+    }
+    end = timer.GetTimeNs();
+    fprintf(stderr, "YAML::LoadFile: %.2f ms, MaxRSS +%ld KB\n", (end - start) / 1e6, MaxRSS() - rss);
+    unlink(path);
+    return 0;
+}
+
+// g++ -std=c++11 -O2 -D_GLIBCXX_USE_CXX11_ABI=0 YAMLStreamLoaderTest.cpp -o test -pthread -I. -I../../FMTLogger/include -I../../YAML-CPP/0.8.0/include -L../../YAML-CPP/0.8.0/lib -lyaml-cpp
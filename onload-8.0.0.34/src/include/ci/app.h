@@ -35,6 +35,7 @@ extern "C" {
 #include <ci/app/net.h>
 #include <ci/app/ctimer.h>
 #include <ci/app/stats.h>
+#include <ci/app/lat_hist.h>
 #include <ci/app/testpattern.h>
 
 #ifdef __cplusplus
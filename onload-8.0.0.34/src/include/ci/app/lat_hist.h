@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_HEADER>
+**  \brief  Constant-memory streaming latency statistics.
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/*! \cidoxg_include_ci_app */
+
+/* A log-linear histogram: values below 2^(LAT_HIST_SUB_BITS+1) get a
+ * bucket each, and every larger power-of-two range is split into
+ * 2^LAT_HIST_SUB_BITS equal buckets.  Quantiles are therefore accurate to
+ * within 1/2^(LAT_HIST_SUB_BITS+1) (0.4%) of the true value whatever the
+ * range, min/max/mean/stddev are exact, and the footprint is fixed
+ * (~58KB) however many samples are recorded.  Histograms merge by adding
+ * bucket counts, so per-thread and per-run results can be combined, and
+ * can be saved to and reloaded from a text file.
+ *
+ * This file has no dependencies beyond libc so that it can be shared with
+ * applications built outside the Onload tree (e.g. TCPDirect zf_apps).
+ */
+
+#ifndef __CI_APP_LAT_HIST_H__
+#define __CI_APP_LAT_HIST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define LAT_HIST_SUB_BITS   7
+#define LAT_HIST_SUB        (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_N_BUCKETS  ((64 - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB)
+
+
+struct lat_hist {
+  uint64_t n;
+  uint64_t min;
+  uint64_t max;
+  double   sum;
+  double   sum_sq;
+  uint64_t buckets[LAT_HIST_N_BUCKETS];
+};
+
+
+/* A histogram that is reported and folded into a running total every
+ * [period_ns].  The clock is only read once every 256 samples.
+ */
+struct lat_hist_live {
+  struct lat_hist total;
+  struct lat_hist interval;
+  uint64_t        period_ns;
+  uint64_t        start_ns;
+  uint64_t        next_ns;
+  unsigned        n_checks;
+  double          percentile;
+  double          scale;
+  const char*     units;
+  FILE*           out;
+};
+
+
+static inline unsigned lat_hist_bucket(uint64_t v)
+{
+  unsigned shift;
+  if( v < 2 * LAT_HIST_SUB )
+    return (unsigned) v;
+  shift = 63 - __builtin_clzll(v) - LAT_HIST_SUB_BITS;
+  return shift * LAT_HIST_SUB + (unsigned) (v >> shift);
+}
+
+static inline void lat_hist_record(struct lat_hist* h, uint64_t v)
+{
+  double d = (double) v;
+  ++h->buckets[lat_hist_bucket(v)];
+  ++h->n;
+  h->sum += d;
+  h->sum_sq += d * d;
+  if( v < h->min )
+    h->min = v;
+  if( v > h->max )
+    h->max = v;
+}
+
+extern void lat_hist_init(struct lat_hist* h);
+
+/* Add the samples in [from] to [to]. */
+extern void lat_hist_merge(struct lat_hist* to, const struct lat_hist* from);
+
+/* Returns the value at percentile [pct] (0..100), or 0 if [h] is empty.
+ * Percentiles 0 and 100 return the exact min and max.
+ */
+extern uint64_t lat_hist_percentile(const struct lat_hist* h, double pct);
+
+extern double lat_hist_mean(const struct lat_hist* h);
+
+/* Sample standard deviation (n - 1 denominator). */
+extern double lat_hist_stddev(const struct lat_hist* h);
+
+/* Write [h] to [f] as text: a header line, a summary line and one line
+ * per non-empty bucket.  Returns 0 on success or -1 on I/O error.
+ */
+extern int lat_hist_write(const struct lat_hist* h, FILE* f);
+
+/* Read a histogram written by lat_hist_write() and merge it into [h].
+ * Returns 0 on success or -1 if the file is malformed.
+ */
+extern int lat_hist_read(struct lat_hist* h, FILE* f);
+
+
+/* [period_ms] of zero disables interval reports.  Reports are written to
+ * [out] as comment lines, with values multiplied by [scale] and labelled
+ * with [units].
+ */
+extern void lat_hist_live_init(struct lat_hist_live* l, unsigned period_ms,
+                               double percentile, double scale,
+                               const char* units, FILE* out);
+
+/* Report the current interval if it is due. */
+extern void lat_hist_live_poll(struct lat_hist_live* l);
+
+/* Fold the final partial interval into the total.  Call before reading
+ * [l->total].
+ */
+extern void lat_hist_live_finish(struct lat_hist_live* l);
+
+static inline void lat_hist_live_record(struct lat_hist_live* l, uint64_t v)
+{
+  lat_hist_record(&l->interval, v);
+  if( l->period_ns && (++l->n_checks & 0xff) == 0 )
+    lat_hist_live_poll(l);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __CI_APP_LAT_HIST_H__ */
+
+/*! \cidoxg_end */
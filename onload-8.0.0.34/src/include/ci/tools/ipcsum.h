@@ -269,6 +269,21 @@ extern unsigned ci_ip_csum_copy2(void* dest, const void* src,
 				 int n, unsigned sum) CI_HF;
 
 
+  /*! As ci_ip_csum_copy_aligned(), but copies and sums in SSE4.1 or AVX2
+  ** blocks at user-level when the CPU supports them.  [sum] is a partial
+  ** checksum.  Returns the new partial checksum.
+  */
+extern unsigned ci_ip_csum_copy_partial(void* dest, const void* src,
+                                        int n, unsigned sum) CI_HF;
+
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+extern unsigned ci_ip_csum_copy_partial_sse4(void* dest, const void* src,
+                                             int n, unsigned sum) CI_HF;
+extern unsigned ci_ip_csum_copy_partial_avx2(void* dest, const void* src,
+                                             int n, unsigned sum) CI_HF;
+#endif
+
+
   /*! Copy from [src] to [dest] whilst checksumming. If [dest] is not
   ** aligned on a 2-byte boundary from start of checksum then
   ** [dest_unalign] must be set.
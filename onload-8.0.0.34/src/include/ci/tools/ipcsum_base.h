@@ -27,3 +27,20 @@ extern unsigned ci_ip_checksum(const struct ci_ip4_hdr_s* ip) CI_HF;
   */
 extern unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
 				   int bytes) CI_HF;
+
+  /*! Portable word-at-a-time version of ci_ip_csum_partial(). */
+extern unsigned ci_ip_csum_partial_c(unsigned sum, const volatile void* in_buf,
+                                     int bytes) CI_HF;
+
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+  /*! SSE4.1 and AVX2 versions of ci_ip_csum_partial().  The caller must
+  ** check the CPU supports the instruction set; ci_ip_csum_partial()
+  ** picks one at runtime.  The result is folded to 16 bits.
+  */
+extern unsigned ci_ip_csum_partial_sse4(unsigned sum,
+                                        const volatile void* in_buf,
+                                        int bytes) CI_HF;
+extern unsigned ci_ip_csum_partial_avx2(unsigned sum,
+                                        const volatile void* in_buf,
+                                        int bytes) CI_HF;
+#endif
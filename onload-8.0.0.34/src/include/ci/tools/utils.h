@@ -112,10 +112,22 @@ extern ci_uint32 ci_crc32_partial_copy(ci_uint8 *dest, const ci_uint8 *buf,
 
 extern ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input,
                                   int n);
-  /*!< Toeplitz hash */
+  /*!< Toeplitz hash.  [key] must be at least [n] + 4 bytes long.  At
+   * user-level this uses PCLMULQDQ when the CPU supports it. */
+
+extern ci_uint32 ci_toeplitz_hash_c(const ci_uint8 *key, const ci_uint8 *input,
+                                    int n);
+  /*!< Bit-at-a-time Toeplitz hash */
 
 #if !defined(__KERNEL__)
 
+#if defined(CI_HAVE_X86INTRIN)
+extern ci_uint32 ci_toeplitz_hash_sse4(const ci_uint8 *key,
+                                       const ci_uint8 *input, int n);
+  /*!< PCLMULQDQ/SSE4.1 Toeplitz hash.  The caller must check the CPU
+   * supports both. */
+#endif
+
 extern ci_uint32
 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8* sse_key,
                     const ci_uint8 *input, int n);
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  Constant-memory streaming latency statistics.
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/*! \cidoxg_lib_ciapp */
+
+#include <ci/app/lat_hist.h>
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+
+#define LAT_HIST_MAGIC  "# lat_hist 1"
+
+
+void lat_hist_init(struct lat_hist* h)
+{
+  memset(h, 0, sizeof(*h));
+  h->min = UINT64_MAX;
+}
+
+
+void lat_hist_merge(struct lat_hist* to, const struct lat_hist* from)
+{
+  unsigned i;
+
+  if( from->n == 0 )
+    return;
+  for( i = 0; i < LAT_HIST_N_BUCKETS; ++i )
+    to->buckets[i] += from->buckets[i];
+  to->n += from->n;
+  to->sum += from->sum;
+  to->sum_sq += from->sum_sq;
+  if( from->min < to->min )
+    to->min = from->min;
+  if( from->max > to->max )
+    to->max = from->max;
+}
+
+
+/* Lowest value that maps to bucket [i], and the number of values that do. */
+static uint64_t bucket_low(unsigned i, uint64_t* width)
+{
+  unsigned shift;
+
+  if( i < 2 * LAT_HIST_SUB ) {
+    *width = 1;
+    return i;
+  }
+  shift = i / LAT_HIST_SUB - 1;
+  *width = (uint64_t) 1 << shift;
+  return (uint64_t) (i - shift * LAT_HIST_SUB) << shift;
+}
+
+
+uint64_t lat_hist_percentile(const struct lat_hist* h, double pct)
+{
+  uint64_t rank, seen = 0, low, width, v;
+  unsigned i;
+
+  if( h->n == 0 )
+    return 0;
+  if( pct <= 0 )
+    return h->min;
+  if( pct >= 100 )
+    return h->max;
+
+  /* Nearest-rank: the smallest sample with at least pct% of the samples
+   * at or below it.
+   */
+  rank = (uint64_t) ceil(pct / 100 * h->n);
+  if( rank == 0 )
+    rank = 1;
+  for( i = 0; i < LAT_HIST_N_BUCKETS; ++i ) {
+    seen += h->buckets[i];
+    if( seen >= rank )
+      break;
+  }
+
+  low = bucket_low(i, &width);
+  v = low + width / 2;
+  if( v < h->min )
+    v = h->min;
+  if( v > h->max )
+    v = h->max;
+  return v;
+}
+
+
+double lat_hist_mean(const struct lat_hist* h)
+{
+  return h->n ? h->sum / h->n : 0;
+}
+
+
+double lat_hist_stddev(const struct lat_hist* h)
+{
+  double var;
+
+  if( h->n < 2 )
+    return 0;
+  var = (h->sum_sq - h->sum * h->sum / h->n) / (h->n - 1);
+  return var > 0 ? sqrt(var) : 0;
+}
+
+
+int lat_hist_write(const struct lat_hist* h, FILE* f)
+{
+  uint64_t low, width;
+  unsigned i;
+
+  fprintf(f, "%s sub_bits %u\n", LAT_HIST_MAGIC, LAT_HIST_SUB_BITS);
+  fprintf(f, "n %llu min %llu max %llu sum %.17g sum_sq %.17g\n",
+          (unsigned long long) h->n,
+          (unsigned long long) (h->n ? h->min : 0),
+          (unsigned long long) h->max, h->sum, h->sum_sq);
+  for( i = 0; i < LAT_HIST_N_BUCKETS; ++i )
+    if( h->buckets[i] ) {
+      low = bucket_low(i, &width);
+      fprintf(f, "%llu %llu\n", (unsigned long long) low,
+              (unsigned long long) h->buckets[i]);
+    }
+  return ferror(f) ? -1 : 0;
+}
+
+
+int lat_hist_read(struct lat_hist* h, FILE* f)
+{
+  struct lat_hist in;
+  unsigned long long n, min, max, low, count;
+  unsigned sub_bits;
+  char line[256];
+
+  lat_hist_init(&in);
+  if( fgets(line, sizeof(line), f) == NULL ||
+      strncmp(line, LAT_HIST_MAGIC, strlen(LAT_HIST_MAGIC)) != 0 ||
+      sscanf(line + strlen(LAT_HIST_MAGIC), " sub_bits %u", &sub_bits) != 1 ||
+      sub_bits != LAT_HIST_SUB_BITS )
+    return -1;
+  if( fgets(line, sizeof(line), f) == NULL ||
+      sscanf(line, "n %llu min %llu max %llu sum %lg sum_sq %lg",
+             &n, &min, &max, &in.sum, &in.sum_sq) != 5 )
+    return -1;
+  while( fgets(line, sizeof(line), f) != NULL ) {
+    if( sscanf(line, "%llu %llu", &low, &count) != 2 )
+      return -1;
+    in.buckets[lat_hist_bucket(low)] += count;
+    in.n += count;
+  }
+  if( in.n != n )
+    return -1;
+  if( n ) {
+    in.min = min;
+    in.max = max;
+  }
+  lat_hist_merge(h, &in);
+  return 0;
+}
+
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+void lat_hist_live_init(struct lat_hist_live* l, unsigned period_ms,
+                        double percentile, double scale,
+                        const char* units, FILE* out)
+{
+  lat_hist_init(&l->total);
+  lat_hist_init(&l->interval);
+  l->period_ns = (uint64_t) period_ms * 1000000;
+  l->start_ns = now_ns();
+  l->next_ns = l->start_ns + l->period_ns;
+  l->n_checks = 0;
+  l->percentile = percentile;
+  l->scale = scale;
+  l->units = units;
+  l->out = out;
+}
+
+
+void lat_hist_live_poll(struct lat_hist_live* l)
+{
+  const struct lat_hist* h = &l->interval;
+  uint64_t now = now_ns();
+  int prec = l->scale < 1 ? 3 : 0;
+
+  if( now < l->next_ns )
+    return;
+  if( h->n ) {
+    fprintf(l->out, "# %.3f s: n %llu  mean %.*f  min %.*f  50%% %.*f  "
+            "%g%% %.*f  max %.*f %s\n",
+            (now - l->start_ns) / 1e9, (unsigned long long) h->n,
+            prec, lat_hist_mean(h) * l->scale, prec, h->min * l->scale,
+            prec, lat_hist_percentile(h, 50) * l->scale, l->percentile,
+            prec, lat_hist_percentile(h, l->percentile) * l->scale,
+            prec, h->max * l->scale, l->units);
+    fflush(l->out);
+  }
+  lat_hist_merge(&l->total, &l->interval);
+  lat_hist_init(&l->interval);
+  l->next_ns = now + l->period_ns;
+}
+
+
+void lat_hist_live_finish(struct lat_hist_live* l)
+{
+  lat_hist_merge(&l->total, &l->interval);
+  lat_hist_init(&l->interval);
+}
+
+/*! \cidoxg_end */
@@ -10,6 +10,7 @@ LIB_SRCS	:= \
 		bytepattern.c \
 		ctimer.c \
 		stats.c \
+		lat_hist.c \
 		iarray_mean_and_limits.c \
 		iarray_median.c \
 		iarray_mode.c \
@@ -152,6 +152,21 @@ get_cpuid(int op, int *eax, int *ebx, int *ecx, int *edx)
                         : "a" (op));
 }
 
+ci_inline void
+get_cpuid_count(int op, int count, int *eax, int *ebx, int *ecx, int *edx)
+{
+  __asm__ __volatile__ ("cpuid\n\t"
+                        : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+                        : "a" (op), "c" (count));
+}
+
+ci_inline ci_uint64 get_xcr0(void)
+{
+  ci_uint32 lo, hi;
+  __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+  return ((ci_uint64) hi << 32) | lo;
+}
+
 #else
 
 /*****************************************************************************
@@ -177,6 +192,26 @@ int ci_cpu_has_feature(char* feature)
 
   if( ! strcmp(feature, "pclmul") )
     return ecx & 0x00000002;
+  if( ! strcmp(feature, "sse4.1") )
+    return ecx & 0x00080000;
+  if( ! strcmp(feature, "sse4.2") )
+    return ecx & 0x00100000;
+#endif
+
+#if defined(__x86_64__)
+  if( ! strcmp(feature, "avx2") ) {
+    int max_leaf;
+
+    /* The YMM registers are only usable if the OS saves them: needs
+     * OSXSAVE and AVX in leaf 1, and SSE+AVX state enabled in XCR0. */
+    if( (ecx & 0x18000000) != 0x18000000 || (get_xcr0() & 0x6) != 0x6 )
+      return 0;
+    get_cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+    if( max_leaf < 7 )
+      return 0;
+    get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+    return ebx & 0x00000020;
+  }
 #endif
 
   /* Not supported on platforms that don't implement the CPUID instruction */
@@ -41,7 +41,7 @@ int ci_ip_csum_copy_iovec(void* dest, int dest_len, int dest_unalign,
     n = CI_ALIGN_BACK( CI_IOVEC_LEN(&src->io), 2);
     if( n > dest_len ) n = dest_len;
 
-    sum = ci_ip_csum_copy_aligned(dest, CI_IOVEC_BASE(&src->io), n, sum); 
+    sum = ci_ip_csum_copy_partial(dest, CI_IOVEC_BASE(&src->io), n, sum);
     dest_len -= n;
     total += n;
 
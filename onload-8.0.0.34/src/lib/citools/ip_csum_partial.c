@@ -17,8 +17,8 @@
 #include <ci/net/ipv4.h>
 
 
-unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
-			    int bytes)
+unsigned ci_ip_csum_partial_c(unsigned sum, const volatile void* in_buf,
+                              int bytes)
 {
   const ci_uint16* buf = (const ci_uint16*) in_buf;
 
@@ -38,4 +38,255 @@ unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
   return sum;
 }
 
+
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+
+#include <x86intrin.h>
+
+/* Vector kernels consume 32-byte blocks.  Each 32-bit lane accumulator
+ * gains at most 0xffff per block, so it is widened into the 64-bit
+ * accumulator at least every 64K blocks.  Shorter buffers (headers) stay
+ * on the scalar loop, where the vector set-up would cost more than it
+ * saves.
+ */
+#define CSUM_BLOCK        32
+#define CSUM_BATCH        32768
+#define CSUM_SIMD_MIN     64
+
+enum {
+  CSUM_ISA_SCALAR,
+  CSUM_ISA_SSE4,
+  CSUM_ISA_AVX2,
+};
+
+static int csum_isa = -1;
+
+
+ci_inline int csum_get_isa(void)
+{
+  if(CI_UNLIKELY( csum_isa < 0 )) {
+    if( ci_cpu_has_feature("avx2") )
+      csum_isa = CSUM_ISA_AVX2;
+    else if( ci_cpu_has_feature("sse4.1") )
+      csum_isa = CSUM_ISA_SSE4;
+    else
+      csum_isa = CSUM_ISA_SCALAR;
+  }
+  return csum_isa;
+}
+
+
+/* Fold the 64-bit block sum plus the caller's partial sum to 16 bits. */
+ci_inline unsigned csum_fold64(ci_uint64 acc, unsigned sum)
+{
+  acc += sum;
+  while( acc >> 16 )
+    acc = (acc >> 16) + (acc & 0xffff);
+  return (unsigned) acc;
+}
+
+
+/* Sum (and optionally copy) [blocks] 32-byte blocks.  [dest] is a
+ * compile-time constant at each call site so the store drops out of the
+ * checksum-only variant.
+ */
+__attribute__((target("sse4.1"), always_inline)) static inline ci_uint64
+csum_blocks_sse4(void* dest, const void* src, int blocks)
+{
+  const __m128i mask = _mm_set1_epi32(0xffff);
+  const __m128i* s = (const __m128i*) src;
+  __m128i* d = (__m128i*) dest;
+  __m128i acc = _mm_setzero_si128();
+
+  while( blocks > 0 ) {
+    int n = CI_MIN(blocks, CSUM_BATCH);
+    __m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+    __m128i a2 = _mm_setzero_si128(), a3 = _mm_setzero_si128();
+
+    blocks -= n;
+    do {
+      __m128i v0 = _mm_loadu_si128(s);
+      __m128i v1 = _mm_loadu_si128(s + 1);
+      if( d != NULL ) {
+        _mm_storeu_si128(d, v0);
+        _mm_storeu_si128(d + 1, v1);
+        d += 2;
+      }
+      a0 = _mm_add_epi32(a0, _mm_and_si128(v0, mask));
+      a1 = _mm_add_epi32(a1, _mm_srli_epi32(v0, 16));
+      a2 = _mm_add_epi32(a2, _mm_and_si128(v1, mask));
+      a3 = _mm_add_epi32(a3, _mm_srli_epi32(v1, 16));
+      s += 2;
+    } while( --n );
+
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(a0));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(a0, 8)));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(a1));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(a1, 8)));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(a2));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(a2, 8)));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(a3));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(a3, 8)));
+  }
+
+  return (ci_uint64) _mm_extract_epi64(acc, 0) +
+         (ci_uint64) _mm_extract_epi64(acc, 1);
+}
+
+
+__attribute__((target("avx2"), always_inline)) static inline ci_uint64
+csum_blocks_avx2(void* dest, const void* src, int blocks)
+{
+  const __m256i mask = _mm256_set1_epi32(0xffff);
+  const __m256i* s = (const __m256i*) src;
+  __m256i* d = (__m256i*) dest;
+  __m256i acc = _mm256_setzero_si256();
+  __m128i r;
+
+  while( blocks > 0 ) {
+    int n = CI_MIN(blocks, CSUM_BATCH);
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+
+    blocks -= n;
+    do {
+      __m256i v = _mm256_loadu_si256(s++);
+      if( d != NULL )
+        _mm256_storeu_si256(d++, v);
+      lo = _mm256_add_epi32(lo, _mm256_and_si256(v, mask));
+      hi = _mm256_add_epi32(hi, _mm256_srli_epi32(v, 16));
+    } while( --n );
+
+    acc = _mm256_add_epi64(acc,
+                  _mm256_cvtepu32_epi64(_mm256_castsi256_si128(lo)));
+    acc = _mm256_add_epi64(acc,
+                  _mm256_cvtepu32_epi64(_mm256_extracti128_si256(lo, 1)));
+    acc = _mm256_add_epi64(acc,
+                  _mm256_cvtepu32_epi64(_mm256_castsi256_si128(hi)));
+    acc = _mm256_add_epi64(acc,
+                  _mm256_cvtepu32_epi64(_mm256_extracti128_si256(hi, 1)));
+  }
+
+  r = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                    _mm256_extracti128_si256(acc, 1));
+  return (ci_uint64) _mm_extract_epi64(r, 0) +
+         (ci_uint64) _mm_extract_epi64(r, 1);
+}
+
+
+__attribute__((target("sse4.1"))) unsigned
+ci_ip_csum_partial_sse4(unsigned sum, const volatile void* in_buf, int bytes)
+{
+  const ci_uint8* buf = (const ci_uint8*) in_buf;
+  int blocks = bytes / CSUM_BLOCK;
+  ci_uint64 acc;
+
+  ci_assert(in_buf || bytes == 0);
+  ci_assert(bytes >= 0);
+
+  acc = csum_blocks_sse4(NULL, buf, blocks);
+  buf += blocks * CSUM_BLOCK;
+  acc += ci_ip_csum_partial_c(0, buf, bytes - blocks * CSUM_BLOCK);
+  return csum_fold64(acc, sum);
+}
+
+
+__attribute__((target("avx2"))) unsigned
+ci_ip_csum_partial_avx2(unsigned sum, const volatile void* in_buf, int bytes)
+{
+  const ci_uint8* buf = (const ci_uint8*) in_buf;
+  int blocks = bytes / CSUM_BLOCK;
+  ci_uint64 acc;
+
+  ci_assert(in_buf || bytes == 0);
+  ci_assert(bytes >= 0);
+
+  acc = csum_blocks_avx2(NULL, buf, blocks);
+  buf += blocks * CSUM_BLOCK;
+  acc += ci_ip_csum_partial_c(0, buf, bytes - blocks * CSUM_BLOCK);
+  return csum_fold64(acc, sum);
+}
+
+
+__attribute__((target("sse4.1"))) unsigned
+ci_ip_csum_copy_partial_sse4(void* dest, const void* src, int n, unsigned sum)
+{
+  int blocks = n / CSUM_BLOCK;
+  int done = blocks * CSUM_BLOCK;
+  ci_uint64 acc;
+
+  ci_assert(dest || n == 0);
+  ci_assert(src  || n == 0);
+  ci_assert(n >= 0);
+
+  acc = csum_blocks_sse4(dest, src, blocks);
+  acc += ci_ip_csum_copy_aligned_c((char*) dest + done,
+                                   (const char*) src + done, n - done, 0);
+  return csum_fold64(acc, sum);
+}
+
+
+__attribute__((target("avx2"))) unsigned
+ci_ip_csum_copy_partial_avx2(void* dest, const void* src, int n, unsigned sum)
+{
+  int blocks = n / CSUM_BLOCK;
+  int done = blocks * CSUM_BLOCK;
+  ci_uint64 acc;
+
+  ci_assert(dest || n == 0);
+  ci_assert(src  || n == 0);
+  ci_assert(n >= 0);
+
+  acc = csum_blocks_avx2(dest, src, blocks);
+  acc += ci_ip_csum_copy_aligned_c((char*) dest + done,
+                                   (const char*) src + done, n - done, 0);
+  return csum_fold64(acc, sum);
+}
+
+
+unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
+                            int bytes)
+{
+  if( bytes >= CSUM_SIMD_MIN ) {
+    switch( csum_get_isa() ) {
+    case CSUM_ISA_AVX2:
+      return ci_ip_csum_partial_avx2(sum, in_buf, bytes);
+    case CSUM_ISA_SSE4:
+      return ci_ip_csum_partial_sse4(sum, in_buf, bytes);
+    }
+  }
+  return ci_ip_csum_partial_c(sum, in_buf, bytes);
+}
+
+
+unsigned ci_ip_csum_copy_partial(void* dest, const void* src, int n,
+                                 unsigned sum)
+{
+  if( n >= CSUM_SIMD_MIN ) {
+    switch( csum_get_isa() ) {
+    case CSUM_ISA_AVX2:
+      return ci_ip_csum_copy_partial_avx2(dest, src, n, sum);
+    case CSUM_ISA_SSE4:
+      return ci_ip_csum_copy_partial_sse4(dest, src, n, sum);
+    }
+  }
+  return ci_ip_csum_copy_aligned_c(dest, src, n, sum);
+}
+
+#else
+
+unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
+                            int bytes)
+{
+  return ci_ip_csum_partial_c(sum, in_buf, bytes);
+}
+
+
+unsigned ci_ip_csum_copy_partial(void* dest, const void* src, int n,
+                                 unsigned sum)
+{
+  return ci_ip_csum_copy_aligned_c(dest, src, n, sum);
+}
+
+#endif /* !__KERNEL__ && CI_HAVE_X86INTRIN */
+
 /*! \cidoxg_end */
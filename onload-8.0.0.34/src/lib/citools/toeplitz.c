@@ -17,7 +17,7 @@
 
 #include "citools_internal.h"
 
-ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input, int n)
+ci_uint32 ci_toeplitz_hash_c(const ci_uint8 *key, const ci_uint8 *input, int n)
 {
   ci_uint32 key_bits;
   ci_uint32 result = 0;
@@ -40,6 +40,15 @@ ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input, int n)
   return result;
 }
 
+#if defined(__KERNEL__) || ! defined(CI_HAVE_X86INTRIN)
+
+ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input, int n)
+{
+  return ci_toeplitz_hash_c(key, input, n);
+}
+
+#endif
+
 #if !defined(__KERNEL__)
 
 #if defined(CI_HAVE_X86INTRIN)
@@ -89,18 +98,88 @@ ci_toeplitz_hash_sse_ip6(const uint32_t *key, const uint32_t *input, int size)
 }
 #endif
 
+/* Reverse the bits within each byte of [v]. */
+__attribute__((target("pclmul,sse4.1"))) ci_inline __m128i
+ci_toeplitz_rev8(__m128i v)
+{
+  const __m128i lo = _mm_set_epi64x(0x0f070b030d050901LL,
+                                    0x0e060a020c040800LL);
+  const __m128i hi = _mm_set_epi64x((long long) 0xf070b030d0509010ULL,
+                                    (long long) 0xe060a020c0408000ULL);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+
+  return _mm_or_si128(_mm_shuffle_epi8(hi, _mm_and_si128(v, nibble)),
+               _mm_shuffle_epi8(lo, _mm_and_si128(_mm_srli_epi16(v, 4),
+                                                  nibble)));
+}
+
+/* Hash one 32-bit input group against the 64 key bits that start at the
+ * group.  Input bit c (counting from the MSB) selects key bits [c, c+32),
+ * which is bits 32..63 of the carry-less product of the key with the
+ * bit-reversed input.
+ */
+__attribute__((target("pclmul,sse4.1"))) ci_inline __m128i
+ci_toeplitz_hash_sse_group(const ci_uint8 *key, const ci_uint8 *input)
+{
+  ci_uint64 k;
+  ci_uint32 x;
+
+  memcpy(&k, key, sizeof(k));
+  memcpy(&x, input, sizeof(x));
+  return _mm_clmulepi64_si128(_mm_cvtsi64_si128(__builtin_bswap64(k)),
+                              ci_toeplitz_rev8(_mm_cvtsi32_si128(x)), 0x00);
+}
+
+/* General Toeplitz hash of [n] input bytes with a key of at least [n] + 4
+ * bytes, four input bytes per PCLMULQDQ.  Unlike the tuple-specific
+ * versions above it needs no pre-processed key.
+ */
+__attribute__((target("pclmul,sse4.1"))) ci_uint32
+ci_toeplitz_hash_sse4(const ci_uint8 *key, const ci_uint8 *input, int n)
+{
+  __m128i acc = _mm_setzero_si128();
+  int i;
+
+  for( i = 0; i + 4 <= n; i += 4 )
+    acc = _mm_xor_si128(acc, ci_toeplitz_hash_sse_group(key + i, input + i));
+
+  if( i < n ) {
+    /* Zero input bits select nothing, so pad the tail and copy only the
+     * key bytes the scalar hash would read. */
+    ci_uint8 k[8] = { 0 };
+    ci_uint8 x[4] = { 0 };
+    memcpy(k, key + i, n - i + 4);
+    memcpy(x, input + i, n - i);
+    acc = _mm_xor_si128(acc, ci_toeplitz_hash_sse_group(k, x));
+  }
+
+  return _mm_extract_epi32(acc, 1);
+}
+
+static int ci_toeplitz_sse_support(void)
+{
+  static int sse_support = -1;
+
+  if(CI_UNLIKELY( sse_support < 0 ))
+    sse_support = ci_cpu_has_feature("pclmul") &&
+                  ci_cpu_has_feature("sse4.1");
+  return sse_support;
+}
+
+ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input, int n)
+{
+  if( ci_toeplitz_sse_support() )
+    return ci_toeplitz_hash_sse4(key, input, n);
+  return ci_toeplitz_hash_c(key, input, n);
+}
+
 #endif /* CI_HAVE_X86INTRIN */
 
 ci_uint32 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8 *sse_key,
                               const ci_uint8 *input, int size)
 {
 #if defined(CI_HAVE_X86INTRIN)
-  static int pclmul_support = -1;
-
-  if(CI_UNLIKELY( pclmul_support < 0 ))
-    pclmul_support = ci_cpu_has_feature("pclmul");
-
-  if( pclmul_support ) {
+  if( ci_toeplitz_sse_support() ) {
 #if defined(CI_CFG_IPV6) && CI_CFG_IPV6
     if( size == IPV6_TUPLE_SIZE )
       return ci_toeplitz_hash_sse_ip6((ci_uint32*) sse_key, (ci_uint32*) input,
@@ -112,7 +191,7 @@ ci_uint32 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8 *sse_key,
   }
   else
 #endif /* CI_HAVE_X86INTRIN */
-    return ci_toeplitz_hash(key, input, size);
+    return ci_toeplitz_hash_c(key, input, size);
 }
 
 #endif /* __KERNEL__ */
@@ -0,0 +1,196 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/* csum_bench
+ *
+ * Microbenchmark for the Internet checksum and Toeplitz hash routines in
+ * citools.  Reports the mean time per call and throughput of the scalar,
+ * SSE4.1 and AVX2 versions over a range of buffer sizes, for checksum
+ * only and for checksum-and-copy, and of the bit-at-a-time and PCLMULQDQ
+ * Toeplitz hashes for IPv4 and IPv6 4-tuples.
+ *
+ *   ./csum_bench [-n iterations] [-s size]...
+ */
+
+#include <ci/tools.h>
+#include <ci/tools/ipcsum_base.h>
+#include <ci/tools/cpu_features.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define MAX_SIZES     16
+#define MAX_SIZE      (1024 * 1024)
+
+
+typedef unsigned (*csum_fn)(unsigned, const volatile void*, int);
+typedef unsigned (*csum_copy_fn)(void*, const void*, int, unsigned);
+typedef ci_uint32 (*hash_fn)(const ci_uint8*, const ci_uint8*, int);
+
+struct variant {
+  const char*  name;
+  const char*  feature;
+  csum_fn      csum;
+  csum_copy_fn csum_copy;
+};
+
+
+static unsigned csum_copy_c(void* dest, const void* src, int n, unsigned sum)
+{
+  return ci_ip_csum_copy_aligned_c(dest, src, n, sum);
+}
+
+
+static struct variant variants[] = {
+  { "scalar", NULL,     ci_ip_csum_partial_c,    csum_copy_c },
+  { "sse4",   "sse4.1", ci_ip_csum_partial_sse4, ci_ip_csum_copy_partial_sse4 },
+  { "avx2",   "avx2",   ci_ip_csum_partial_avx2, ci_ip_csum_copy_partial_avx2 },
+};
+#define N_VARIANTS  (sizeof(variants) / sizeof(variants[0]))
+
+
+static int cfg_iter = 1000000;
+static int cfg_sizes[MAX_SIZES] = { 20, 64, 256, 1472, 8972, 65536 };
+static int cfg_n_sizes = 6;
+
+/* Results are accumulated here so that the calls cannot be elided. */
+static volatile unsigned sink;
+
+
+static ci_uint64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ci_uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static int iterations(int size)
+{
+  /* Keep the bytes touched per run roughly constant for large sizes. */
+  ci_int64 n = (ci_int64) cfg_iter * 256 / CI_MAX(size, 256);
+  return (int) CI_MAX(n, 1000);
+}
+
+
+static void bench_csum(const struct variant* v, const ci_uint8* src,
+                       ci_uint8* dest, int size)
+{
+  int i, n = iterations(size);
+  unsigned sum = 0;
+  ci_uint64 start, csum_ns, copy_ns;
+
+  start = now_ns();
+  for( i = 0; i < n; ++i )
+    sum += v->csum(i, src, size);
+  csum_ns = now_ns() - start;
+
+  start = now_ns();
+  for( i = 0; i < n; ++i )
+    sum += v->csum_copy(dest, src, size, i);
+  copy_ns = now_ns() - start;
+  sink += sum;
+
+  printf("%-8s %8d %10.1f %10.2f %10.1f %10.2f\n", v->name, size,
+         (double) csum_ns / n, (double) size * n / csum_ns,
+         (double) copy_ns / n, (double) size * n / copy_ns);
+}
+
+
+static void bench_hash(const char* name, hash_fn fn, const ci_uint8* key,
+                       const ci_uint8* input, int size)
+{
+  int i;
+  ci_uint32 h = 0;
+  ci_uint64 start = now_ns();
+
+  for( i = 0; i < cfg_iter; ++i )
+    h += fn(key, input + (i & 7), size);
+  sink += h;
+  printf("%-8s %8d %10.1f\n", name, size,
+         (double) (now_ns() - start) / cfg_iter);
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "\nusage:\n");
+  fprintf(stderr, "  csum_bench [options]\n");
+  fprintf(stderr, "\noptions:\n");
+  fprintf(stderr, "  -n <iterations>   - calls per small-buffer test\n");
+  fprintf(stderr, "  -s <size>         - buffer size (may be repeated)\n");
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  ci_uint8 *src, *dest, key[40 + 8], input[36 + 8];
+  int have_sizes = 0;
+  unsigned i, j;
+  int c;
+
+  while( (c = getopt(argc, argv, "n:s:")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_iter = atoi(optarg);
+      break;
+    case 's':
+      if( ! have_sizes )
+        cfg_n_sizes = 0;
+      have_sizes = 1;
+      if( cfg_n_sizes == MAX_SIZES || atoi(optarg) <= 0 ||
+          atoi(optarg) > MAX_SIZE )
+        usage();
+      cfg_sizes[cfg_n_sizes++] = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc || cfg_iter <= 0 )
+    usage();
+
+  src = malloc(MAX_SIZE);
+  dest = malloc(MAX_SIZE);
+  if( src == NULL || dest == NULL )
+    return 1;
+  for( i = 0; i < MAX_SIZE; ++i )
+    src[i] = rand();
+  for( i = 0; i < sizeof(key); ++i )
+    key[i] = rand();
+  for( i = 0; i < sizeof(input); ++i )
+    input[i] = rand();
+
+  printf("%-8s %8s %10s %10s %10s %10s\n", "#csum", "bytes",
+         "ns", "GB/s", "copy_ns", "copy_GB/s");
+  for( i = 0; i < N_VARIANTS; ++i ) {
+    const struct variant* v = &variants[i];
+    if( v->feature != NULL && ! ci_cpu_has_feature((char*) v->feature) ) {
+      printf("# %s: not supported by this CPU\n", v->name);
+      continue;
+    }
+    for( j = 0; j < cfg_n_sizes; ++j )
+      bench_csum(v, src, dest, cfg_sizes[j]);
+  }
+
+  printf("\n%-8s %8s %10s\n", "#hash", "bytes", "ns");
+  bench_hash("scalar", ci_toeplitz_hash_c, key, input, 12);
+  bench_hash("scalar", ci_toeplitz_hash_c, key, input, 36);
+  if( ci_cpu_has_feature("pclmul") && ci_cpu_has_feature("sse4.1") ) {
+    bench_hash("sse4", ci_toeplitz_hash_sse4, key, input, 12);
+    bench_hash("sse4", ci_toeplitz_hash_sse4, key, input, 36);
+  }
+  else {
+    printf("# sse4: not supported by this CPU\n");
+  }
+
+  free(src);
+  free(dest);
+  return 0;
+}
+
+/*! \cidoxg_end */
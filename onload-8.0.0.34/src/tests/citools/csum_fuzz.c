@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/* csum_fuzz
+ *
+ * Randomised comparison of the vectorised Internet checksum and Toeplitz
+ * hash routines in citools against their scalar versions.  Each variant
+ * the CPU supports is checked over random lengths, buffer alignments,
+ * initial sums and contents, including all-ones buffers long enough to
+ * overflow the 32-bit lane accumulators.  The fused copy is also checked
+ * through ci_ip_csum_copy_iovec() with random segment splits.
+ *
+ *   ./csum_fuzz [-n iterations] [-s seed]
+ */
+
+#include <ci/tools.h>
+#include <ci/tools/ipcsum_base.h>
+#include <ci/tools/cpu_features.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define MAX_LEN       4096
+#define BIG_LEN       (3 * 1024 * 1024 + 7)
+#define GUARD         64
+#define MAX_SEGS      16
+#define KEY_LEN       (40 + 4)
+
+
+#define TEST(x)                                                 \
+  do {                                                          \
+    if( ! (x) ) {                                               \
+      fprintf(stderr, "ERROR: %s: TEST(%s) failed\n", __func__, #x); \
+      fprintf(stderr, "ERROR: at %s:%d seed=%u iter=%d\n",      \
+              __FILE__, __LINE__, cfg_seed, iter);              \
+      abort();                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+typedef unsigned (*csum_fn)(unsigned, const volatile void*, int);
+typedef unsigned (*csum_copy_fn)(void*, const void*, int, unsigned);
+
+struct variant {
+  const char*  name;
+  const char*  feature;
+  csum_fn      csum;
+  csum_copy_fn csum_copy;
+};
+
+
+static unsigned cfg_seed;
+static int      cfg_iter = 200000;
+static int      iter;
+
+
+static struct variant variants[] = {
+  { "sse4", "sse4.1", ci_ip_csum_partial_sse4, ci_ip_csum_copy_partial_sse4 },
+  { "avx2", "avx2",   ci_ip_csum_partial_avx2, ci_ip_csum_copy_partial_avx2 },
+  { "auto", NULL,     ci_ip_csum_partial,      ci_ip_csum_copy_partial },
+};
+#define N_VARIANTS  (sizeof(variants) / sizeof(variants[0]))
+
+
+static int all_ones;
+
+
+static void fill_random(ci_uint8* p, int n)
+{
+  int i, mode = all_ones ? 0 : rand() % 4;
+  for( i = 0; i < n; ++i )
+    p[i] = mode == 0 ? 0xff : mode == 1 ? 0 : rand();
+}
+
+
+/* Reference checksum that cannot overflow: sum in 32KB chunks with the
+ * scalar loop and fold in between. */
+static unsigned ref_csum(unsigned sum, const ci_uint8* p, int n)
+{
+  while( n > 0 ) {
+    int chunk = CI_MIN(n, 32768);
+    sum = ci_ip_csum_fold(ci_ip_csum_fold(sum));
+    sum = ci_ip_csum_partial_c(sum, p, chunk);
+    p += chunk;
+    n -= chunk;
+  }
+  return sum;
+}
+
+
+static void check_csum(const struct variant* v, ci_uint8* buf, int len)
+{
+  int off = rand() % 32;
+  unsigned sum = rand() & 0x1ffff;
+  unsigned got;
+
+  fill_random(buf + off, len);
+  got = v->csum(sum, buf + off, len);
+  TEST(ci_ip_hdr_csum_finish(got) ==
+       ci_ip_hdr_csum_finish(ref_csum(sum, buf + off, len)));
+}
+
+
+static void check_csum_copy(const struct variant* v, ci_uint8* src,
+                            ci_uint8* dest, int len)
+{
+  int soff = rand() % 32, doff = rand() % 32;
+  unsigned sum = rand() & 0x1ffff;
+  unsigned got;
+  int i;
+
+  fill_random(src + soff, len);
+  memset(dest, 0xa5, len + 2 * GUARD);
+  got = v->csum_copy(dest + GUARD + doff, src + soff, len, sum);
+  TEST(ci_ip_hdr_csum_finish(got) ==
+       ci_ip_hdr_csum_finish(ref_csum(sum, src + soff, len)));
+  TEST(memcmp(dest + GUARD + doff, src + soff, len) == 0);
+  for( i = 0; i < GUARD + doff; ++i )
+    TEST(dest[i] == 0xa5);
+  for( i = GUARD + doff + len; i < len + 2 * GUARD; ++i )
+    TEST(dest[i] == 0xa5);
+}
+
+
+static void check_csum_copy_iovec(ci_uint8* src, ci_uint8* dest)
+{
+  ci_iovec iov[MAX_SEGS];
+  ci_iovec_ptr piov;
+  int n_segs = 1 + rand() % MAX_SEGS;
+  int i, len = 0, copied;
+  unsigned sum = rand() & 0x1ffff, ref = sum;
+
+  for( i = 0; i < n_segs; ++i ) {
+    int seg_len = rand() % 4 ? rand() % (MAX_LEN / MAX_SEGS) : 0;
+    CI_IOVEC_BASE(&iov[i]) = src + len + i;
+    CI_IOVEC_LEN(&iov[i]) = seg_len;
+    fill_random(src + len + i, seg_len);
+    len += seg_len;
+  }
+  ci_iovec_ptr_init_nz(&piov, iov, n_segs);
+  copied = ci_ip_csum_copy_iovec(dest, len, 0, &piov, &sum);
+  TEST(copied == len);
+
+  len = 0;
+  for( i = 0; i < n_segs; ++i ) {
+    TEST(memcmp(dest + len, CI_IOVEC_BASE(&iov[i]),
+                CI_IOVEC_LEN(&iov[i])) == 0);
+    len += CI_IOVEC_LEN(&iov[i]);
+  }
+  ref = ref_csum(ref, dest, len);
+  TEST(ci_ip_hdr_csum_finish(sum) == ci_ip_hdr_csum_finish(ref));
+}
+
+
+static void check_toeplitz(void)
+{
+  ci_uint8 key[KEY_LEN], input[KEY_LEN - 4];
+  int n = rand() % (KEY_LEN - 4 + 1);
+  ci_uint32 ref;
+
+  fill_random(key, sizeof(key));
+  fill_random(input, n);
+  ref = ci_toeplitz_hash_c(key, input, n);
+  TEST(ci_toeplitz_hash(key, input, n) == ref);
+  if( ci_cpu_has_feature("pclmul") && ci_cpu_has_feature("sse4.1") )
+    TEST(ci_toeplitz_hash_sse4(key, input, n) == ref);
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "\nusage:\n");
+  fprintf(stderr, "  csum_fuzz [options]\n");
+  fprintf(stderr, "\noptions:\n");
+  fprintf(stderr, "  -n <iterations>   - number of random cases\n");
+  fprintf(stderr, "  -s <seed>         - random seed\n");
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  ci_uint8 *src, *dest;
+  unsigned i;
+  int c;
+
+  cfg_seed = getpid();
+  while( (c = getopt(argc, argv, "n:s:")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_iter = atoi(optarg);
+      break;
+    case 's':
+      cfg_seed = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc )
+    usage();
+  srand(cfg_seed);
+
+  src = malloc(BIG_LEN + 2 * GUARD);
+  dest = malloc(BIG_LEN + 2 * GUARD);
+  if( src == NULL || dest == NULL )
+    return 1;
+
+  for( i = 0; i < N_VARIANTS; ++i ) {
+    const struct variant* v = &variants[i];
+    if( v->feature != NULL && ! ci_cpu_has_feature((char*) v->feature) ) {
+      printf("%s: not supported by this CPU, skipped\n", v->name);
+      continue;
+    }
+    for( iter = 0; iter < cfg_iter; ++iter ) {
+      int len = rand() % 8 ? rand() % 256 : rand() % MAX_LEN;
+      check_csum(v, src, len);
+      check_csum_copy(v, src, dest, len);
+    }
+    /* Long enough to flush the 32-bit lane sums more than once. */
+    all_ones = 1;
+    check_csum(v, src, BIG_LEN - GUARD);
+    check_csum_copy(v, src, dest, BIG_LEN - GUARD);
+    all_ones = 0;
+    printf("%s: ok\n", v->name);
+  }
+
+  for( iter = 0; iter < cfg_iter; ++iter ) {
+    check_csum_copy_iovec(src, dest);
+    check_toeplitz();
+  }
+  printf("csum_copy_iovec: ok\n");
+  printf("toeplitz: ok\n");
+
+  free(src);
+  free(dest);
+  return 0;
+}
+
+/*! \cidoxg_end */
@@ -0,0 +1,17 @@
+# SPDX-License-Identifier: BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc.
+
+TEST_APPS	:= csum_fuzz \
+		csum_bench
+
+TARGETS		:= $(TEST_APPS:%=$(AppPattern))
+
+
+all: $(TARGETS)
+
+clean:
+	@$(MakeClean)
+
+
+MMAKE_LIBS	:= $(LINK_CITOOLS_LIB)
+MMAKE_LIB_DEPS	:= $(CITOOLS_LIB_DEPEND)
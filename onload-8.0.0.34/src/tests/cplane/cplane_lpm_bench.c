@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/* cplane_lpm_bench
+ *
+ * Benchmark for the control plane's route lookup.  For a range of table
+ * sizes, a random IPv4 or IPv6 route table is loaded from a synthetic
+ * netlink dump and the prefix index is built.  The bench then reports:
+ *  - the time per lookup through the index (cp_route_find());
+ *  - the time per lookup with a linear scan of the sorted route list, as
+ *    cp_route_find() worked before the index;
+ *  - the time to build the index from scratch;
+ *  - the time to refresh it after a 1% change to the table;
+ *  - the index's size.
+ *
+ *   ./cplane_lpm_bench [-n lookups] [-s size]... [-4|-6]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+
+#include "lpm.h"
+#include "route_model.h"
+
+
+#define MAX_SIZES     16
+#define N_ADDRS       4096
+
+
+static int cfg_lookups = 1000000;
+static int cfg_sizes[MAX_SIZES] = { 16, 256, 4096, 65536 };
+static int cfg_n_sizes = 4;
+static int cfg_af = 0;
+
+/* Results are accumulated here so that the lookups cannot be elided. */
+static volatile int sink;
+
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void load(void* arg, uint16_t type, int af,
+                 const struct test_route* r)
+{
+  if( model_table_update(arg, type, r) < 0 ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    exit(1);
+  }
+}
+
+
+static void feed(struct model_table* t, uint16_t type,
+                 const struct test_route* routes, int n)
+{
+  size_t len = (n + 1) * 256;
+  void* buf = malloc(len);
+
+  len = route_dump_build(buf, len, t->af, type, routes, n);
+  if( len == 0 || route_dump_parse(buf, len, load, t) != n ) {
+    fprintf(stderr, "ERROR: bad route dump\n");
+    exit(1);
+  }
+  free(buf);
+}
+
+
+static double bench_lookup(const struct model_table* t,
+                           uint8_t (*addrs)[16], int n, int linear)
+{
+  uint64_t start;
+  int i, r = 0;
+
+  start = now_ns();
+  if( linear )
+    for( i = 0; i < n; i++ )
+      r += model_table_find_linear(t, addrs[i % N_ADDRS], 0);
+  else
+    for( i = 0; i < n; i++ )
+      r += model_table_find(t, addrs[i % N_ADDRS], 0);
+  sink += r;
+  return (double) (now_ns() - start) / n;
+}
+
+
+static void bench(int af, int size)
+{
+  struct model_table t;
+  struct test_route* routes = malloc(size * sizeof(*routes));
+  uint8_t (*addrs)[16] = malloc(N_ADDRS * sizeof(*addrs));
+  int i, n_change = size / 100 + 1, n_linear;
+  uint64_t start, build_ns, refresh_ns;
+  double lpm_ns, linear_ns;
+  size_t bytes;
+
+  if( routes == NULL || addrs == NULL ||
+      model_table_init(&t, af, RT_TABLE_MAIN) != 0 ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    exit(1);
+  }
+  route_dump_random(routes, size, af, 1);
+  feed(&t, RTM_NEWROUTE, routes, size);
+  for( i = 0; i < N_ADDRS; i++ )
+    route_dump_random_addr(addrs[i], af);
+
+  start = now_ns();
+  model_table_refresh(&t);
+  build_ns = now_ns() - start;
+
+  /* Replace 1% of the routes, keeping the default route at [0] */
+  feed(&t, RTM_DELROUTE, routes + 1, n_change);
+  route_dump_random(routes, n_change + 1, af, 1);
+  feed(&t, RTM_NEWROUTE, routes + 1, n_change);
+  start = now_ns();
+  model_table_refresh(&t);
+  refresh_ns = now_ns() - start;
+
+  lpm_ns = bench_lookup(&t, addrs, cfg_lookups, 0);
+  /* Keep the linear scan to a sensible run time */
+  n_linear = cfg_lookups / (t.n / 16 + 1);
+  if( n_linear < N_ADDRS )
+    n_linear = N_ADDRS;
+  linear_ns = bench_lookup(&t, addrs, n_linear, 1);
+
+  bytes = t.lpm.n_nodes * (t.lpm.fanout * sizeof(struct cp_lpm_slot) +
+                           (2 * t.lpm.fanout - 1) * sizeof(int32_t) +
+                           sizeof(struct cp_lpm_node_ctl)) +
+          t.lpm.n_prefixes * sizeof(struct cp_lpm_prefix);
+  printf("%-6s %8d %8d %8d %10.1f %10.1f %10.1f %10.1f %10zu\n",
+         af == AF_INET ? "ipv4" : "ipv6", t.n, t.lpm.n_prefixes,
+         t.lpm.n_nodes, lpm_ns, linear_ns, build_ns / 1e3, refresh_ns / 1e3,
+         bytes / 1024);
+
+  model_table_fini(&t);
+  free(routes);
+  free(addrs);
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "\nusage:\n");
+  fprintf(stderr, "  cplane_lpm_bench [options]\n");
+  fprintf(stderr, "\noptions:\n");
+  fprintf(stderr, "  -n <lookups>      - lookups per table\n");
+  fprintf(stderr, "  -s <size>         - routes in the table (may be "
+                  "repeated)\n");
+  fprintf(stderr, "  -4                - IPv4 only\n");
+  fprintf(stderr, "  -6                - IPv6 only\n");
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int have_sizes = 0;
+  int i, c;
+
+  while( (c = getopt(argc, argv, "n:s:46")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_lookups = atoi(optarg);
+      break;
+    case 's':
+      if( ! have_sizes )
+        cfg_n_sizes = 0;
+      have_sizes = 1;
+      if( cfg_n_sizes == MAX_SIZES || atoi(optarg) < 2 )
+        usage();
+      cfg_sizes[cfg_n_sizes++] = atoi(optarg);
+      break;
+    case '4':
+      cfg_af = AF_INET;
+      break;
+    case '6':
+      cfg_af = AF_INET6;
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc || cfg_lookups <= 0 )
+    usage();
+  srand(1);
+
+  printf("%-6s %8s %8s %8s %10s %10s %10s %10s %10s\n", "#af", "routes",
+         "prefixes", "nodes", "lpm_ns", "linear_ns", "build_us",
+         "refresh_us", "KB");
+  for( i = 0; i < cfg_n_sizes; i++ ) {
+    if( cfg_af != AF_INET6 )
+      bench(AF_INET, cfg_sizes[i]);
+    if( cfg_af != AF_INET )
+      bench(AF_INET6, cfg_sizes[i]);
+  }
+  return 0;
+}
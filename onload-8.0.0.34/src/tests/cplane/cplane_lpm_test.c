@@ -0,0 +1,370 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/* cplane_lpm_test
+ *
+ * Unit test for the control plane's longest-prefix-match route index
+ * (tools/cplane/lpm.c).  Random IPv4 and IPv6 route tables are fed in as
+ * synthetic netlink dumps, then updated with batches of RTM_NEWROUTE and
+ * RTM_DELROUTE messages.  After each batch the index is refreshed the way
+ * cp_route_table_lpm_refresh() does it, and lookups are checked against a
+ * linear scan of the sorted route list, which is how cp_route_find()
+ * worked before the index.  Prefixes which are not touched by a batch must
+ * keep their ids, and deleting everything must free every node but the
+ * root.
+ *
+ * Each model table is also copied into a struct cp_route_table and looked
+ * up with the server's own cp_route_find() and cp_route_find_linear()
+ * (tools/cplane/route_lpm.c), starting without a trie the way a table is
+ * left when cp_lpm_init() fails, and with some lookups made while the
+ * table is under dump.
+ *
+ *   ./cplane_lpm_test [-n routes] [-r rounds] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+
+#include "private.h"
+#include "lpm.h"
+#include "route_model.h"
+
+
+#define N_TABLES      4
+#define N_LOOKUPS     5000
+
+
+#define TEST(x)                                                 \
+  do {                                                          \
+    if( ! (x) ) {                                               \
+      fprintf(stderr, "ERROR: %s: TEST(%s) failed\n", __func__, #x); \
+      fprintf(stderr, "ERROR: at %s:%d seed=%u\n",              \
+              __FILE__, __LINE__, cfg_seed);                    \
+      abort();                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+struct model {
+  int af;
+  int key_bytes;
+  struct model_table tables[N_TABLES];
+  struct cp_route_table server[N_TABLES];
+};
+
+
+static unsigned cfg_seed;
+static int      cfg_routes = 5000;
+static int      cfg_rounds = 20;
+
+
+/* Netlink callback */
+static void model_update(void* arg, uint16_t type, int af,
+                         const struct test_route* r)
+{
+  struct model* m = arg;
+  int i;
+
+  TEST(af == m->af);
+  for( i = 0; i < N_TABLES; i++ )
+    if( m->tables[i].id == r->table ) {
+      TEST(model_table_update(&m->tables[i], type, r) >= 0);
+      return;
+    }
+  TEST(0);
+}
+
+
+static int lookup_shorter_brute(struct model_table* t, const uint8_t* addr,
+                                int max_len)
+{
+  int i;
+  for( i = 0; i < t->n; i++ )
+    if( t->routes[i].len <= max_len &&
+        route_pfx_match(addr, t->routes[i].addr, t->routes[i].len) )
+      return t->routes[i].len;
+  return -1;
+}
+
+
+/* Random address, every other one under an existing route */
+static void lookup_addr(struct model* m, struct model_table* t, int i,
+                        uint8_t* addr)
+{
+  int j;
+
+  route_dump_random_addr(addr, m->af);
+  if( t->n > 0 && i % 2 ) {
+    const struct test_route* r = &t->routes[rand() % t->n];
+    for( j = 0; j < r->len; j++ ) {
+      uint8_t bit = 0x80 >> (j % 8);
+      addr[j / 8] = (addr[j / 8] & ~bit) | (r->addr[j / 8] & bit);
+    }
+  }
+}
+
+
+static void check_table(struct model* m, struct model_table* t)
+{
+  uint8_t addr[16];
+  int i;
+
+  for( i = 0; i < N_LOOKUPS; i++ ) {
+    uint8_t tos = rand() % 4 == 0 ? (rand() % 8) << 2 : 0;
+
+    lookup_addr(m, t, i, addr);
+    TEST(model_table_find(t, addr, tos) ==
+         model_table_find_linear(t, addr, tos));
+
+    if( i % 16 == 0 ) {
+      int max_len = rand() % (m->key_bytes * 8 + 1);
+      int id = cp_lpm_lookup_shorter(&t->lpm, addr, max_len);
+      int len = lookup_shorter_brute(t, addr, max_len);
+      TEST(len == (id == CP_LPM_NONE ? -1 : cp_lpm_prefix(&t->lpm, id)->len));
+    }
+  }
+
+  for( i = 0; i < t->n; i++ ) {
+    int id = cp_lpm_find(&t->lpm, t->routes[i].addr, t->routes[i].len);
+    TEST(id != CP_LPM_NONE);
+    TEST(cp_lpm_prefix(&t->lpm, id)->len == t->routes[i].len);
+    TEST(memcmp(cp_lpm_prefix(&t->lpm, id)->addr, t->routes[i].addr,
+                m->key_bytes) == 0);
+  }
+}
+
+
+/* The server's table starts without a trie, as cp_route_add() leaves it if
+ * cp_lpm_init() fails, so the first refresh has to create it. */
+static void server_table_init(struct cp_route_table* rt, uint32_t id)
+{
+  memset(rt, 0, sizeof(*rt));
+  rt->id = id;
+  rt->routes.stride = sizeof(struct cp_route);
+  rt->lpm_ok = false;
+  rt->lpm_stale = true;
+}
+
+
+static void server_table_fini(struct cp_route_table* rt)
+{
+  if( rt->lpm_ok )
+    cp_lpm_fini(&rt->lpm);
+  free(rt->lpm_next);
+  free(rt->routes.list);
+}
+
+
+static ci_addr_sh_t server_addr(int af, const uint8_t* addr)
+{
+  ci_ip_addr_t ip4;
+
+  if( af == AF_INET6 )
+    return CI_ADDR_SH_FROM_IP6(addr);
+  memcpy(&ip4, addr, sizeof(ip4));
+  return CI_ADDR_SH_FROM_IP4(ip4);
+}
+
+
+/* Copy the model's sorted route list into the server's table, as
+ * cp_nl_route_table_update() would have left it */
+static void server_table_sync(struct cp_route_table* rt,
+                              const struct model_table* t)
+{
+  int i;
+
+  TEST(t->n < 0x7fff);
+  if( rt->routes.max < t->n ) {
+    void* list = realloc(rt->routes.list, t->n * rt->routes.stride);
+    TEST(list != NULL);
+    rt->routes.list = list;
+    rt->routes.max = t->n;
+  }
+  for( i = 0; i < t->n; i++ ) {
+    struct cp_route* route = cp_route_entry_by_idx(rt, i);
+    memset(route, 0, sizeof(*route));
+    route->dst.addr = server_addr(t->af, t->routes[i].addr);
+    route->dst.prefix = t->routes[i].len;
+    route->metric = t->routes[i].metric;
+    route->tos = t->routes[i].tos;
+  }
+  rt->routes.used = rt->routes.sorted = t->n;
+  rt->lpm_stale = true;
+}
+
+
+static void check_server_table(struct model* m, struct model_table* t,
+                               struct cp_route_table* rt)
+{
+  struct cp_fwd_key key;
+  uint8_t addr[16];
+  int i;
+
+  server_table_sync(rt, t);
+  memset(&key, 0, sizeof(key));
+  for( i = 0; i < N_LOOKUPS; i++ ) {
+    struct cp_route* route;
+    int expected;
+
+    lookup_addr(m, t, i, addr);
+    key.dst = server_addr(m->af, addr);
+    key.tos = rand() % 4 == 0 ? (rand() % 8) << 2 : 0;
+    expected = model_table_find_linear(t, addr, key.tos);
+
+    /* The list may not be sorted under dump, so no refresh then */
+    rt->routes.in_dump = i % 8 == 0;
+    route = cp_route_find(&key, rt, m->af);
+    TEST(route == cp_route_find_linear(&key, rt, m->af));
+    TEST((route == NULL ? -1 : cp_ippl_idx(&rt->routes, &route->dst)) ==
+         expected);
+  }
+  rt->routes.in_dump = 0;
+  TEST(cp_route_table_lpm_refresh(rt, m->af) == 0);
+  TEST(rt->lpm_ok && ! rt->lpm_stale);
+  TEST(rt->lpm.n_prefixes == t->lpm.n_prefixes);
+}
+
+
+static void feed(struct model* m, uint16_t type,
+                 const struct test_route* routes, int n)
+{
+  size_t len = (n + 1) * 256;
+  void* buf = malloc(len);
+  TEST(buf != NULL);
+  len = route_dump_build(buf, len, m->af, type, routes, n);
+  TEST(len != 0);
+  TEST(route_dump_parse(buf, len, model_update, m) == n);
+  free(buf);
+}
+
+
+static void test_af(int af)
+{
+  struct model m;
+  struct test_route* routes = malloc(cfg_routes * sizeof(*routes));
+  struct test_route* batch = malloc(cfg_routes * sizeof(*batch));
+  int i, round;
+
+  TEST(routes != NULL && batch != NULL);
+  m.af = af;
+  m.key_bytes = af == AF_INET ? 4 : 16;
+  for( i = 0; i < N_TABLES; i++ ) {
+    TEST(model_table_init(&m.tables[i], af, 100 + i) == 0);
+    server_table_init(&m.server[i], 100 + i);
+  }
+
+  /* Initial dump */
+  route_dump_random(routes, cfg_routes, af, N_TABLES);
+  feed(&m, RTM_NEWROUTE, routes, cfg_routes);
+  for( i = 0; i < N_TABLES; i++ ) {
+    TEST(model_table_refresh(&m.tables[i]) == 0);
+    check_table(&m, &m.tables[i]);
+    check_server_table(&m, &m.tables[i], &m.server[i]);
+  }
+
+  /* Incremental updates */
+  for( round = 0; round < cfg_rounds; round++ ) {
+    struct model_table* t;
+    int n_del = rand() % (cfg_routes / 10 + 1);
+    int n_add = rand() % (cfg_routes / 10 + 1);
+    int* kept_ids;
+
+    /* Delete some existing routes (and maybe some which do not exist) */
+    for( i = 0; i < n_del; i++ ) {
+      t = &m.tables[rand() % N_TABLES];
+      if( t->n > 0 && rand() % 8 != 0 )
+        batch[i] = t->routes[rand() % t->n];
+      else
+        route_dump_random(&batch[i], 1, af, N_TABLES);
+    }
+    feed(&m, RTM_DELROUTE, batch, n_del);
+    route_dump_random(batch, n_add, af, N_TABLES);
+    feed(&m, RTM_NEWROUTE, batch, n_add);
+
+    /* Ids of prefixes present before and after must not change */
+    t = &m.tables[round % N_TABLES];
+    kept_ids = malloc((t->n + 1) * sizeof(int));
+    TEST(kept_ids != NULL);
+    for( i = 0; i < t->n; i++ )
+      kept_ids[i] = cp_lpm_find(&t->lpm, t->routes[i].addr, t->routes[i].len);
+    for( i = 0; i < N_TABLES; i++ ) {
+      TEST(model_table_refresh(&m.tables[i]) == 0);
+      check_table(&m, &m.tables[i]);
+      check_server_table(&m, &m.tables[i], &m.server[i]);
+    }
+    for( i = 0; i < t->n; i++ )
+      if( kept_ids[i] != CP_LPM_NONE )
+        TEST(cp_lpm_find(&t->lpm, t->routes[i].addr, t->routes[i].len) ==
+             kept_ids[i]);
+    free(kept_ids);
+  }
+
+  for( i = 0; i < N_TABLES; i++ )
+    printf("%s table %d: %d routes, %d prefixes, %d nodes\n",
+           af == AF_INET ? "ipv4" : "ipv6", m.tables[i].id, m.tables[i].n,
+           m.tables[i].lpm.n_prefixes, m.tables[i].lpm.n_nodes);
+
+  /* Remove everything: only the root node may be left */
+  for( i = 0; i < N_TABLES; i++ ) {
+    struct model_table* t = &m.tables[i];
+
+    t->n = 0;
+    TEST(model_table_refresh(t) == 0);
+    TEST(t->lpm.n_prefixes == 0);
+    TEST(t->lpm.n_nodes == 1);
+    TEST(cp_lpm_lookup(&t->lpm, routes[0].addr) == CP_LPM_NONE);
+    check_server_table(&m, t, &m.server[i]);
+    TEST(m.server[i].lpm.n_nodes == 1);
+    server_table_fini(&m.server[i]);
+    model_table_fini(t);
+  }
+
+  free(routes);
+  free(batch);
+  printf("%s: ok\n", af == AF_INET ? "ipv4" : "ipv6");
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "\nusage:\n");
+  fprintf(stderr, "  cplane_lpm_test [options]\n");
+  fprintf(stderr, "\noptions:\n");
+  fprintf(stderr, "  -n <routes>       - routes in the initial dump\n");
+  fprintf(stderr, "  -r <rounds>       - batches of updates\n");
+  fprintf(stderr, "  -s <seed>         - random seed\n");
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int c;
+
+  cfg_seed = getpid();
+  while( (c = getopt(argc, argv, "n:r:s:")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_routes = atoi(optarg);
+      break;
+    case 'r':
+      cfg_rounds = atoi(optarg);
+      break;
+    case 's':
+      cfg_seed = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc || cfg_routes <= 0 )
+    usage();
+  srand(cfg_seed);
+
+  test_af(AF_INET);
+  test_af(AF_INET6);
+  return 0;
+}
@@ -0,0 +1,30 @@
+# SPDX-License-Identifier: BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc.
+
+TEST_APPS	:= cplane_lpm_test \
+		cplane_lpm_bench
+
+TARGETS		:= $(TEST_APPS:%=$(AppPattern))
+
+
+all: $(TARGETS)
+
+clean:
+	@$(MakeClean)
+
+
+MMAKE_CPPFLAGS	+= -I$(SRCPATH)/tools/cplane
+MMAKE_LIBS	:= $(LINK_CITOOLS_LIB)
+MMAKE_LIB_DEPS	:= $(CITOOLS_LIB_DEPEND)
+
+# The prefix index and the route lookup are built from the control plane
+# server's source, so that they can be tested without the rest of the server.
+lpm.o: $(SRCPATH)/tools/cplane/lpm.c
+	$(MMakeCompileC)
+
+route_lpm.o: $(SRCPATH)/tools/cplane/route_lpm.c
+	$(MMakeCompileC)
+
+cplane_lpm_test: cplane_lpm_test.o route_model.o lpm.o route_lpm.o
+
+cplane_lpm_bench: cplane_lpm_bench.o route_model.o lpm.o
@@ -0,0 +1,348 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "route_model.h"
+
+
+#define N_CLUSTERS  8
+
+
+static void mask_addr(uint8_t* addr, int len, int key_bytes)
+{
+  int i;
+  for( i = 0; i < key_bytes; i++ ) {
+    if( len <= 0 )
+      addr[i] = 0;
+    else if( len < 8 )
+      addr[i] &= 0xff00 >> len;
+    len -= 8;
+  }
+}
+
+
+/* Cluster [c] is 10.c.0.0/16 or fd00:c::/32. */
+static void cluster_base(uint8_t* addr, int af, int c)
+{
+  memset(addr, 0, 16);
+  if( af == AF_INET ) {
+    addr[0] = 10;
+    addr[1] = c;
+  }
+  else {
+    addr[0] = 0xfd;
+    addr[3] = c;
+  }
+}
+
+
+void route_dump_random_addr(uint8_t* addr, int af)
+{
+  int key_bytes = af == AF_INET ? 4 : 16;
+  int i, keep;
+
+  for( i = 0; i < key_bytes; i++ )
+    addr[i] = rand();
+  if( rand() % 4 != 0 ) {
+    uint8_t base[16];
+    cluster_base(base, af, rand() % N_CLUSTERS);
+    keep = af == AF_INET ? 2 : 4;
+    memcpy(addr, base, keep);
+  }
+}
+
+
+static int random_len(int af)
+{
+  int r = rand() % 16;
+  if( af == AF_INET ) {
+    /* Mostly /24 and /32 (multicast groups and unicast hosts) */
+    if( r < 6 )
+      return 24;
+    if( r < 10 )
+      return 32;
+    return 8 + rand() % 25;
+  }
+  if( r < 6 )
+    return 64;
+  if( r < 10 )
+    return 128;
+  return 16 + rand() % 113;
+}
+
+
+void route_dump_random(struct test_route* routes, int n, int af,
+                       int n_tables)
+{
+  int key_bytes = af == AF_INET ? 4 : 16;
+  int i;
+
+  for( i = 0; i < n; i++ ) {
+    struct test_route* r = &routes[i];
+
+    if( i > 0 && rand() % 16 == 0 ) {
+      /* Same destination, different metric or TOS */
+      *r = routes[rand() % i];
+      if( rand() % 2 )
+        r->metric += 1 + rand() % 10;
+      else
+        r->tos = (1 + rand() % 7) << 2;
+      continue;
+    }
+    memset(r, 0, sizeof(*r));
+    route_dump_random_addr(r->addr, af);
+    r->len = i == 0 ? 0 : random_len(af);
+    mask_addr(r->addr, r->len, key_bytes);
+    r->metric = rand() % 4 == 0 ? rand() % 1000 : 0;
+    r->table = n_tables > 1 ? 100 + rand() % n_tables : RT_TABLE_MAIN;
+  }
+}
+
+
+static struct rtattr*
+add_attr(struct nlmsghdr* nlh, int type, const void* data, int len)
+{
+  struct rtattr* rta = (void*) ((char*) nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+  rta->rta_type = type;
+  rta->rta_len = RTA_LENGTH(len);
+  memcpy(RTA_DATA(rta), data, len);
+  nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+  return rta;
+}
+
+
+size_t route_dump_build(void* buf, size_t buf_len, int af,
+                        uint16_t nlmsg_type,
+                        const struct test_route* routes, int n)
+{
+  /* Header, rtmsg, and at most 4 attributes of up to 16 bytes */
+  const size_t max_msg = NLMSG_SPACE(sizeof(struct rtmsg) +
+                                     4 * RTA_SPACE(16));
+  int key_bytes = af == AF_INET ? 4 : 16;
+  size_t off = 0;
+  int i;
+
+  for( i = 0; i <= n; i++ ) {
+    struct nlmsghdr* nlh = (void*) ((char*) buf + off);
+    struct rtmsg* rtm;
+
+    if( off + max_msg > buf_len )
+      return 0;
+    memset(nlh, 0, max_msg);
+    nlh->nlmsg_seq = 1;
+    nlh->nlmsg_flags = NLM_F_MULTI;
+    if( i == n ) {
+      nlh->nlmsg_type = NLMSG_DONE;
+      nlh->nlmsg_len = NLMSG_LENGTH(sizeof(int));
+      off += NLMSG_ALIGN(nlh->nlmsg_len);
+      break;
+    }
+
+    nlh->nlmsg_type = nlmsg_type;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*rtm));
+    rtm = NLMSG_DATA(nlh);
+    rtm->rtm_family = af;
+    rtm->rtm_dst_len = routes[i].len;
+    rtm->rtm_tos = routes[i].tos;
+    rtm->rtm_table = routes[i].table < 256 ? routes[i].table : RT_TABLE_UNSPEC;
+    rtm->rtm_protocol = RTPROT_STATIC;
+    rtm->rtm_scope = RT_SCOPE_UNIVERSE;
+    rtm->rtm_type = RTN_UNICAST;
+
+    if( routes[i].len != 0 )
+      add_attr(nlh, RTA_DST, routes[i].addr, key_bytes);
+    add_attr(nlh, RTA_TABLE, &routes[i].table, sizeof(uint32_t));
+    if( routes[i].metric != 0 )
+      add_attr(nlh, RTA_PRIORITY, &routes[i].metric, sizeof(uint32_t));
+    off += NLMSG_ALIGN(nlh->nlmsg_len);
+  }
+  return off;
+}
+
+
+int route_dump_parse(const void* buf, size_t len,
+                     route_dump_cb cb, void* arg)
+{
+  const struct nlmsghdr* nlh;
+  int n = 0;
+
+  for( nlh = buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len) ) {
+    const struct rtmsg* rtm;
+    const struct rtattr* attr;
+    struct test_route route;
+    int bytes;
+
+    if( nlh->nlmsg_type == NLMSG_DONE )
+      return n;
+    if( nlh->nlmsg_type != RTM_NEWROUTE && nlh->nlmsg_type != RTM_DELROUTE )
+      return -1;
+
+    rtm = NLMSG_DATA(nlh);
+    memset(&route, 0, sizeof(route));
+    route.len = rtm->rtm_dst_len;
+    route.tos = rtm->rtm_tos;
+    route.table = rtm->rtm_table;
+
+    bytes = RTM_PAYLOAD(nlh);
+    for( attr = RTM_RTA(rtm); RTA_OK(attr, bytes);
+         attr = RTA_NEXT(attr, bytes) ) {
+      switch( attr->rta_type & NLA_TYPE_MASK ) {
+      case RTA_DST:
+        memcpy(route.addr, RTA_DATA(attr),
+               rtm->rtm_family == AF_INET6 ? 16 : 4);
+        break;
+      case RTA_TABLE:
+        route.table = *(const uint32_t*) RTA_DATA(attr);
+        break;
+      case RTA_PRIORITY:
+        route.metric = *(const uint32_t*) RTA_DATA(attr);
+        break;
+      }
+    }
+    cb(arg, nlh->nlmsg_type, rtm->rtm_family, &route);
+    n++;
+  }
+  return -1;
+}
+
+
+static int route_cmp(const struct test_route* a, const struct test_route* b)
+{
+  if( a->len != b->len )
+    return b->len - a->len;
+  if( a->metric != b->metric )
+    return a->metric < b->metric ? -1 : 1;
+  if( a->tos != b->tos )
+    return b->tos - a->tos;
+  return memcmp(b->addr, a->addr, sizeof(a->addr));
+}
+
+
+int route_pfx_match(const uint8_t* addr, const uint8_t* pfx, int len)
+{
+  int i;
+  for( i = 0; len > 0; i++, len -= 8 ) {
+    uint8_t mask = len >= 8 ? 0xff : 0xff00 >> len;
+    if( (addr[i] ^ pfx[i]) & mask )
+      return 0;
+  }
+  return 1;
+}
+
+
+int model_table_init(struct model_table* t, int af, uint32_t id)
+{
+  memset(t, 0, sizeof(*t));
+  t->af = af;
+  t->id = id;
+  return cp_lpm_init(&t->lpm, af) == 0 ? 0 : -1;
+}
+
+
+void model_table_fini(struct model_table* t)
+{
+  cp_lpm_fini(&t->lpm);
+  free(t->routes);
+  free(t->next);
+}
+
+
+int model_table_update(struct model_table* t, uint16_t nlmsg_type,
+                       const struct test_route* r)
+{
+  int lo = 0, hi = t->n;
+
+  /* Binary search for the route or its insertion point */
+  while( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    int c = route_cmp(&t->routes[mid], r);
+    if( c == 0 ) {
+      lo = hi = mid;
+      break;
+    }
+    if( c < 0 )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if( nlmsg_type == RTM_DELROUTE ) {
+    if( lo == t->n || route_cmp(&t->routes[lo], r) != 0 )
+      return 0;
+    memmove(&t->routes[lo], &t->routes[lo + 1],
+            (t->n - lo - 1) * sizeof(*r));
+    t->n--;
+    return 1;
+  }
+
+  if( lo < t->n && route_cmp(&t->routes[lo], r) == 0 )
+    return 0;
+  if( t->n == t->max ) {
+    int max = t->max ? t->max * 2 : 64;
+    struct test_route* routes = realloc(t->routes, max * sizeof(*r));
+    int* next;
+    if( routes == NULL )
+      return -1;
+    t->routes = routes;
+    next = realloc(t->next, max * sizeof(*next));
+    if( next == NULL )
+      return -1;
+    t->next = next;
+    t->max = max;
+  }
+  memmove(&t->routes[lo + 1], &t->routes[lo], (t->n - lo) * sizeof(*r));
+  t->routes[lo] = *r;
+  t->n++;
+  return 1;
+}
+
+
+int model_table_refresh(struct model_table* t)
+{
+  int i;
+
+  cp_lpm_start_update(&t->lpm);
+  for( i = t->n - 1; i >= 0; i-- ) {
+    int id = cp_lpm_insert(&t->lpm, t->routes[i].addr, t->routes[i].len);
+    struct cp_lpm_prefix* p;
+    if( id == CP_LPM_NONE )
+      return -1;
+    p = cp_lpm_prefix(&t->lpm, id);
+    t->next[i] = p->value;
+    p->value = i;
+  }
+  cp_lpm_finish_update(&t->lpm);
+  return 0;
+}
+
+
+int model_table_find(const struct model_table* t, const uint8_t* addr,
+                     uint8_t tos)
+{
+  int id, i;
+
+  for( id = cp_lpm_lookup(&t->lpm, addr);
+       id != CP_LPM_NONE;
+       id = cp_lpm_lookup_shorter(&t->lpm, addr,
+                                  cp_lpm_prefix(&t->lpm, id)->len - 1) )
+    for( i = cp_lpm_prefix(&t->lpm, id)->value; i != CP_LPM_NONE;
+         i = t->next[i] )
+      if( t->routes[i].tos == 0 || t->routes[i].tos == tos )
+        return i;
+  return -1;
+}
+
+
+int model_table_find_linear(const struct model_table* t,
+                            const uint8_t* addr, uint8_t tos)
+{
+  int i;
+  for( i = 0; i < t->n; i++ )
+    if( route_pfx_match(addr, t->routes[i].addr, t->routes[i].len) &&
+        (t->routes[i].tos == 0 || t->routes[i].tos == tos) )
+      return i;
+  return -1;
+}
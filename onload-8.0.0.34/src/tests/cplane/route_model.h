@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+#ifndef __TESTS_CPLANE_ROUTE_MODEL_H__
+#define __TESTS_CPLANE_ROUTE_MODEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "lpm.h"
+
+
+/* Synthetic netlink route dumps, and a model of a control plane route
+ * table, for exercising the route lookup without a NIC or a real routing
+ * table. */
+
+struct test_route {
+  uint8_t  addr[16];  /* network order; the first 4 bytes for IPv4 */
+  int      len;
+  uint32_t metric;
+  uint8_t  tos;
+  uint32_t table;
+};
+
+/* Fill [routes] with [n] random routes, with addresses clustered under a
+ * few "exchange" prefixes as on a market data host.  Destinations are
+ * masked to the prefix length and may repeat with different metric or
+ * TOS. */
+extern void route_dump_random(struct test_route* routes, int n, int af,
+                              int n_tables);
+
+/* Random address, biased towards the clusters used by
+ * route_dump_random(). */
+extern void route_dump_random_addr(uint8_t* addr, int af);
+
+/* Build a dump of [routes] as RTM_NEWROUTE (or RTM_DELROUTE) messages
+ * followed by NLMSG_DONE.  Returns the number of bytes written, or 0 if
+ * [buf_len] is too small. */
+extern size_t route_dump_build(void* buf, size_t buf_len, int af,
+                               uint16_t nlmsg_type,
+                               const struct test_route* routes, int n);
+
+/* Parse a dump built as above, calling [cb] for each route message the
+ * way cp_nl_route_table_update() sees it.  Returns the number of routes,
+ * or -1 if the dump is malformed. */
+typedef void (*route_dump_cb)(void* arg, uint16_t nlmsg_type, int af,
+                              const struct test_route* route);
+extern int route_dump_parse(const void* buf, size_t len,
+                            route_dump_cb cb, void* arg);
+
+
+/* A route table as the control plane keeps it: a route list sorted the
+ * way cp_route_compare() sorts it, and the prefix index over it. */
+struct model_table {
+  int af;
+  uint32_t id;
+  struct test_route* routes;
+  int n;
+  int max;
+  struct cp_lpm lpm;
+  int* next;
+};
+
+/* Return 0 or -1 if out of memory. */
+extern int model_table_init(struct model_table* t, int af, uint32_t id);
+extern void model_table_fini(struct model_table* t);
+
+/* Apply an RTM_NEWROUTE or RTM_DELROUTE for this table.  Returns 1 if the
+ * table changed, 0 if not, or -1 if out of memory. */
+extern int model_table_update(struct model_table* t, uint16_t nlmsg_type,
+                              const struct test_route* route);
+
+/* As cp_route_table_lpm_refresh() */
+extern int model_table_refresh(struct model_table* t);
+
+/* As cp_route_find(): returns the index of the best route or -1. */
+extern int model_table_find(const struct model_table* t, const uint8_t* addr,
+                            uint8_t tos);
+
+/* As cp_route_find() was before the prefix index */
+extern int model_table_find_linear(const struct model_table* t,
+                                   const uint8_t* addr, uint8_t tos);
+
+extern int route_pfx_match(const uint8_t* addr, const uint8_t* pfx, int len);
+
+#endif /* __TESTS_CPLANE_ROUTE_MODEL_H__ */
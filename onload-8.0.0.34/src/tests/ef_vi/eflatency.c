@@ -18,6 +18,7 @@
 #include <ci/tools.h>
 #include <ci/tools/ipcsum_base.h>
 #include <ci/tools/ippacket.h>
+#include <ci/app/lat_hist.h>
 
 #include <stddef.h>
 #include <inttypes.h>
@@ -43,6 +44,8 @@ static int              cfg_payload_step = 1;
 static int              cfg_ctpio_no_poison;
 static unsigned         cfg_ctpio_thresh = 64;
 static const char*      cfg_save_file = NULL;
+static const char*      cfg_hist_file = NULL;
+static unsigned         cfg_interval_ms;
 enum mode {
   MODE_DMA = 1,
   MODE_PIO = 2,
@@ -86,6 +89,7 @@ struct pkt_buf*          pkt_bufs[N_BUFS];
 static ef_pio            pio;
 static int               tx_frame_len;
 static uint64_t*         timings;
+static struct lat_hist_live latency;
 static double            last_mean_latency_usec;
 
 
@@ -134,58 +138,63 @@ static inline void rx_post(ef_vi* vi)
 }
 
 
-static int cmp_u64(const void* ap, const void* bp)
+/* Open [name] for writing, replacing "$s" with the payload length. */
+static FILE* open_output(const char* name)
 {
-  uint64_t a = *(const uint64_t*)ap;
-  uint64_t b = *(const uint64_t*)bp;
-  if (a < b)
-    return -1;
-  return a > b;
+  char* subst = strstr(name, "$s");
+  FILE* fp;
+
+  if( subst ) {
+    size_t ix = subst - name;
+    size_t len = strlen(name);
+    char* path = malloc(len + 12);
+    memcpy(path, name, ix);
+    snprintf(path + ix, 12, "%d", cfg_payload_len);
+    memcpy(path + strlen(path), name + ix + 2, len - ix - 1);
+    fp = fopen(path, "wt");
+    free(path);
+  }
+  else {
+    fp = fopen(name, "wt");
+  }
+  TEST(fp != NULL);
+  return fp;
 }
 
 
 static void output_results(struct timeval start, struct timeval end)
 {
-  unsigned freq = 0;
-  double div;
+  const struct lat_hist* h = &latency.total;
   int usec = (end.tv_sec - start.tv_sec) * 1000000;
   usec += end.tv_usec - start.tv_usec;
 
-  ci_get_cpu_khz(&freq);
-  div = freq / 1e3;
+  lat_hist_live_finish(&latency);
   if( cfg_save_file ) {
+    unsigned freq = 0;
+    double div;
     int i;
-    char* subst = strstr(cfg_save_file, "$s");
-    FILE* fp;
-
-    if( subst ) {
-      size_t ix = subst - cfg_save_file;
-      size_t len = strlen(cfg_save_file);
-      char* path = malloc(len + 12);
-      memcpy(path, cfg_save_file, ix);
-      snprintf(path + ix, 12, "%d", cfg_payload_len);
-      memcpy(path + strlen(path), cfg_save_file + ix + 2, len - ix - 1);
-      fp = fopen(path, "wt");
-      free(path);
-    }
-    else {
-      fp = fopen(cfg_save_file, "wt");
-    }
-    TEST(fp != NULL);
+    FILE* fp = open_output(cfg_save_file);
+
+    ci_get_cpu_khz(&freq);
+    div = freq / 1e3;
     for( i = 0 ; i < cfg_iter; ++i )
       fprintf(fp, "%lld\n", (long long)(timings[i] * 1000. / div));
     fclose(fp);
   }
+  if( cfg_hist_file ) {
+    FILE* fp = open_output(cfg_hist_file);
+    TEST(lat_hist_write(h, fp) == 0);
+    fclose(fp);
+  }
 
-  qsort(timings, cfg_iter, sizeof(timings[0]), cmp_u64);
   printf("%d\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\n",
          cfg_payload_len,
          (double) usec / cfg_iter,
-         timings[0] / div,
-         timings[cfg_iter / 2] / div,
-         timings[cfg_iter - cfg_iter / 20] / div,
-         timings[cfg_iter - cfg_iter / 100] / div,
-         timings[cfg_iter - 1] / div);
+         h->min / 1e3,
+         lat_hist_percentile(h, 50) / 1e3,
+         lat_hist_percentile(h, 95) / 1e3,
+         lat_hist_percentile(h, 99) / 1e3,
+         h->max / 1e3);
   last_mean_latency_usec = (double) usec / cfg_iter;
 }
 
@@ -209,9 +218,14 @@ generic_ping(struct eflatency_vi* rx_vi, struct eflatency_vi* tx_vi,
              void (*tx_send)(struct eflatency_vi*))
 {
   struct timeval start, end;
+  unsigned freq = 0;
+  double nsec_per_frc;
   int i;
   int do_rx_post = ( rx_vi->vi.nic_type.arch != EF_VI_ARCH_EFCT );
 
+  ci_get_cpu_khz(&freq);
+  nsec_per_frc = 1e6 / freq;
+
   for( i = 0; i < cfg_warmups; ++i ) {
     tx_send(tx_vi);
     if( do_rx_post )
@@ -220,6 +234,7 @@ generic_ping(struct eflatency_vi* rx_vi, struct eflatency_vi* tx_vi,
    generic_desc_check(tx_vi, 0);
   }
 
+  lat_hist_live_init(&latency, cfg_interval_ms, 99, 1e-3, "usec", stdout);
   gettimeofday(&start, NULL);
 
   for( i = 0; i < cfg_iter; ++i ) {
@@ -229,7 +244,9 @@ generic_ping(struct eflatency_vi* rx_vi, struct eflatency_vi* tx_vi,
       rx_post(&rx_vi->vi);
     rx_wait(rx_vi);
     uint64_t stop = ci_frc64_get();
-    timings[i] = stop - start;
+    if( timings != NULL )
+      timings[i] = stop - start;
+    lat_hist_live_record(&latency, (stop - start) * nsec_per_frc);
     generic_desc_check(tx_vi, 0);
   }
 
@@ -687,6 +704,8 @@ static CI_NORETURN usage(void)
   fprintf(stderr, "  -m <modes>          - allow mode of the set: [c]tpio, \n");
   fprintf(stderr, "                      [pio], [a]lternatives, [d]ma, [x]dp\n");
   fprintf(stderr, "  -o <filename>       - save raw timings to file\n");
+  fprintf(stderr, "  -H <filename>       - save latency histogram to file\n");
+  fprintf(stderr, "  -I <millis>         - report latency every interval\n");
   fprintf(stderr, "\n");
   exit(1);
 }
@@ -708,7 +727,7 @@ int main(int argc, char* argv[])
 
   printf("# ef_vi_version_str: %s\n", ef_vi_version_str());
 
-  while( (c = getopt (argc, argv, "n:s:w:c:pm:o:")) != -1 )
+  while( (c = getopt (argc, argv, "n:s:w:c:pm:o:H:I:")) != -1 )
     switch( c ) {
     case 'n':
       cfg_iter = atoi(optarg);
@@ -737,6 +756,12 @@ int main(int argc, char* argv[])
     case 'o':
       cfg_save_file = optarg;
       break;
+    case 'H':
+      cfg_hist_file = optarg;
+      break;
+    case 'I':
+      cfg_interval_ms = atoi(optarg);
+      break;
     case 'm':
       #define OPT_C(ch) (strchr(optarg, ch) != NULL)
       cfg_mode =
@@ -831,7 +856,9 @@ int main(int argc, char* argv[])
 
   prepare(&rx_vi.vi);
 
-  if( ping ) {
+  /* Raw timings are only kept when they are to be saved: the reported
+   * statistics come from a fixed-size histogram. */
+  if( ping && cfg_save_file ) {
     timings = mmap(NULL, cfg_iter * sizeof(timings[0]), PROT_READ | PROT_WRITE,
                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
   }
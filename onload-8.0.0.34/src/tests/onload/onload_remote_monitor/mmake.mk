@@ -2,9 +2,22 @@
 # X-SPDX-Copyright-Text: (c) Copyright 2002-2019 Xilinx, Inc.
 SUBDIRS	:= internal_tests
 
-all:
+TEST_APPS	:= orm_bin_test
+
+TARGETS		:= $(TEST_APPS:%=$(AppPattern))
+
+
+all: $(TARGETS)
 	+@$(MakeSubdirs)
 
 clean:
 	@$(MakeClean)
 
+
+MMAKE_CPPFLAGS	+= -I$(SRCPATH)/tools/onload_remote_monitor
+
+# The codec has no dependencies on the rest of onload_remote_monitor
+orm_bin.o: $(SRCPATH)/tools/onload_remote_monitor/orm_bin.c
+	$(MMakeCompileC)
+
+orm_bin_test: orm_bin_test.o orm_bin.o
@@ -0,0 +1,455 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/* orm_bin_test
+ *
+ * Unit test for the onload_remote_monitor binary stats encoding
+ * (tools/onload_remote_monitor/orm_bin.c).  A synthetic set of stacks and
+ * sockets with counters, addresses and state strings is walked into the
+ * encoder the way orm_json_lib.c walks a real stack, while sockets come
+ * and go and counters change.  Every frame is applied to a decoder, whose
+ * state must match the model exactly.  Decoders that join late or miss a
+ * frame must wait for the next keyframe and then match; corrupt frames
+ * must be rejected.  The JSON export is checked against a fixed document.
+ * Finally frame sizes and encode time are reported for a large sample
+ * with few changes, which is the case that makes frequent sampling cheap.
+ *
+ *   ./orm_bin_test [-r rounds] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "orm_bin.h"
+
+
+#define N_STACKS       4
+#define N_SOCKETS      64
+#define N_COUNTERS     24
+
+
+#define TEST(x)                                                 \
+  do {                                                          \
+    if( ! (x) ) {                                               \
+      fprintf(stderr, "ERROR: %s: TEST(%s) failed\n", __func__, #x); \
+      fprintf(stderr, "ERROR: at %s:%d seed=%u\n",              \
+              __FILE__, __LINE__, cfg_seed);                    \
+      abort();                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+struct model_sock {
+  int      live;
+  uint32_t laddr;
+  int      lport;
+  char     state[16];
+  uint64_t counters[N_COUNTERS];
+};
+
+struct model {
+  int               n_stacks;
+  int               n_sockets;
+  uint32_t          evs[N_STACKS];
+  struct model_sock socks[N_STACKS][N_SOCKETS];
+};
+
+
+static unsigned cfg_seed;
+static int      cfg_rounds = 200;
+
+static const char* states[] = {
+  "CLOSED", "LISTEN", "SYN-SENT", "ESTABLISHED", "FIN-WAIT1", "TIME-WAIT",
+};
+
+
+static void model_sock_init(struct model_sock* s)
+{
+  int i;
+  s->live = 1;
+  s->laddr = rand();
+  s->lport = rand() & 0xffff;
+  strcpy(s->state, states[rand() % 6]);
+  for( i = 0; i < N_COUNTERS; i++ )
+    s->counters[i] = rand() % 4 ? (uint64_t) rand() : (uint64_t) rand() << 32;
+}
+
+
+static void model_init(struct model* m, int n_stacks, int n_sockets)
+{
+  int i, j;
+  memset(m, 0, sizeof(*m));
+  m->n_stacks = n_stacks;
+  m->n_sockets = n_sockets;
+  for( i = 0; i < n_stacks; i++ )
+    for( j = 0; j < n_sockets; j++ )
+      if( rand() % 2 )
+        model_sock_init(&m->socks[i][j]);
+}
+
+
+/* Change roughly one in change_1_in counters, open and close some sockets */
+static void model_step(struct model* m, int change_1_in, int churn)
+{
+  int i, j, k;
+  for( i = 0; i < m->n_stacks; i++ ) {
+    m->evs[i] += rand() % 100;
+    for( j = 0; j < m->n_sockets; j++ ) {
+      struct model_sock* s = &m->socks[i][j];
+      if( churn && rand() % 50 == 0 ) {
+        if( s->live )
+          s->live = 0;
+        else
+          model_sock_init(s);
+      }
+      if( ! s->live )
+        continue;
+      for( k = 0; k < N_COUNTERS; k++ )
+        if( rand() % change_1_in == 0 )
+          s->counters[k] += rand() % 1000;
+      if( rand() % (change_1_in * 4) == 0 )
+        strcpy(s->state, states[rand() % 6]);
+    }
+  }
+}
+
+
+static int model_n_keys(const struct model* m)
+{
+  int i, j, n = 0;
+  for( i = 0; i < m->n_stacks; i++ ) {
+    n += 1;
+    for( j = 0; j < m->n_sockets; j++ )
+      if( m->socks[i][j].live )
+        n += 3 + N_COUNTERS;
+  }
+  return n;
+}
+
+
+static void model_encode(const struct model* m, struct orm_bin_enc* enc,
+                         uint64_t ts)
+{
+  char name[16];
+  int i, j, k;
+
+  orm_bin_enc_begin(enc, ts);
+  orm_bin_enc_push(enc, "json");
+  for( i = 0; i < m->n_stacks; i++ ) {
+    orm_bin_enc_push_index(enc, i + 1);
+    orm_bin_enc_push(enc, "stats");
+    orm_bin_enc_value(enc, "evs", ORM_BIN_KIND_UINT, m->evs[i]);
+    orm_bin_enc_pop(enc);
+    orm_bin_enc_push(enc, "tcp");
+    for( j = 0; j < m->n_sockets; j++ ) {
+      const struct model_sock* s = &m->socks[i][j];
+      if( ! s->live )
+        continue;
+      sprintf(name, "%d", j);
+      orm_bin_enc_push(enc, name);
+      orm_bin_enc_value(enc, "laddr", ORM_BIN_KIND_IP4, s->laddr);
+      orm_bin_enc_value(enc, "lport", ORM_BIN_KIND_UINT, s->lport);
+      orm_bin_enc_str(enc, "state", s->state, sizeof(s->state));
+      orm_bin_enc_push(enc, "counters");
+      for( k = 0; k < N_COUNTERS; k++ )
+        orm_bin_enc_value_at(enc, k, ORM_BIN_KIND_QUINT, s->counters[k]);
+      orm_bin_enc_pop(enc);
+      orm_bin_enc_pop(enc);
+    }
+    orm_bin_enc_pop(enc);
+    orm_bin_enc_pop(enc);
+  }
+  orm_bin_enc_pop(enc);
+  TEST(enc->depth == 0);
+}
+
+
+static void model_check(const struct model* m, const struct orm_bin_dec* dec)
+{
+  const struct orm_bin_key* key;
+  char path[128];
+  int i, j, k;
+
+  TEST(dec->n_live == model_n_keys(m));
+  for( i = 0; i < m->n_stacks; i++ ) {
+    sprintf(path, "/json#%d/stats/evs", i + 1);
+    TEST((key = orm_bin_dec_find(dec, path)) != NULL);
+    TEST(key->value == m->evs[i]);
+    for( j = 0; j < m->n_sockets; j++ ) {
+      const struct model_sock* s = &m->socks[i][j];
+      int n = sprintf(path, "/json#%d/tcp/%d", i + 1, j);
+      strcpy(path + n, "/laddr");
+      key = orm_bin_dec_find(dec, path);
+      if( ! s->live ) {
+        TEST(key == NULL);
+        continue;
+      }
+      TEST(key != NULL && key->kind == ORM_BIN_KIND_IP4);
+      TEST((uint32_t) key->value == s->laddr);
+      strcpy(path + n, "/lport");
+      TEST((key = orm_bin_dec_find(dec, path)) != NULL);
+      TEST(key->value == s->lport);
+      strcpy(path + n, "/state");
+      TEST((key = orm_bin_dec_find(dec, path)) != NULL);
+      TEST(key->str != NULL && strcmp(key->str, s->state) == 0);
+      for( k = 0; k < N_COUNTERS; k++ ) {
+        sprintf(path + n, "/counters#%d", k);
+        TEST((key = orm_bin_dec_find(dec, path)) != NULL);
+        TEST((uint64_t) key->value == s->counters[k]);
+      }
+    }
+  }
+}
+
+
+static void test_roundtrip(void)
+{
+  struct orm_bin_enc enc;
+  struct orm_bin_dec dec, late, gappy;
+  struct model m;
+  const void* frame;
+  size_t len, key_len = 0, delta_len = 0;
+  int round, n_delta = 0, rc;
+
+  model_init(&m, N_STACKS, N_SOCKETS);
+  TEST(orm_bin_enc_init(&enc, 16) == 0);
+  orm_bin_dec_init(&dec);
+  orm_bin_dec_init(&late);
+  orm_bin_dec_init(&gappy);
+
+  for( round = 0; round < cfg_rounds; round++ ) {
+    int keyframe = round % 16 == 0;
+    model_step(&m, 20, 1);
+    model_encode(&m, &enc, round);
+    TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+    TEST(!!(((const struct orm_bin_frame_hdr*) frame)->flags &
+            ORM_BIN_FLAG_KEYFRAME) == keyframe);
+    if( keyframe ) {
+      key_len = len;
+    }
+    else {
+      delta_len += len;
+      ++n_delta;
+      TEST(enc.n_predicted > 0);
+    }
+
+    TEST(orm_bin_dec_apply(&dec, frame, len) == 0);
+    TEST(dec.seq == (uint64_t) round && dec.timestamp_ns == (uint64_t) round);
+    model_check(&m, &dec);
+
+    /* A subscriber which joins at round 5 waits for the next keyframe */
+    if( round >= 5 ) {
+      rc = orm_bin_dec_apply(&late, frame, len);
+      TEST(rc == (round < 16 ? -EAGAIN : 0));
+      if( rc == 0 )
+        model_check(&m, &late);
+    }
+
+    /* A subscriber which misses round 20 waits for round 32 */
+    if( round != 20 ) {
+      rc = orm_bin_dec_apply(&gappy, frame, len);
+      TEST(rc == (round > 20 && round < 32 ? -EAGAIN : 0));
+      if( rc == 0 )
+        model_check(&m, &gappy);
+    }
+  }
+  /* Deltas with 5% of counters changing are much smaller than keyframes */
+  TEST(n_delta > 0 && delta_len / n_delta < key_len / 4);
+
+  /* Forced keyframe, e.g. when a new subscriber connects */
+  orm_bin_enc_force_keyframe(&enc);
+  model_encode(&m, &enc, round);
+  TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+  TEST(((const struct orm_bin_frame_hdr*) frame)->flags &
+       ORM_BIN_FLAG_KEYFRAME);
+  TEST(orm_bin_dec_apply(&dec, frame, len) == 0);
+  model_check(&m, &dec);
+
+  /* Everything closed: all removed in one frame */
+  memset(m.socks, 0, sizeof(m.socks));
+  model_encode(&m, &enc, round + 1);
+  TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+  TEST(enc.n_removed > 0 && enc.n_live == m.n_stacks);
+  TEST(orm_bin_dec_apply(&dec, frame, len) == 0);
+  model_check(&m, &dec);
+
+  orm_bin_dec_fini(&gappy);
+  orm_bin_dec_fini(&late);
+  orm_bin_dec_fini(&dec);
+  orm_bin_enc_fini(&enc);
+}
+
+
+static void test_corrupt(void)
+{
+  struct orm_bin_enc enc;
+  struct orm_bin_dec dec;
+  struct model m;
+  const void* frame;
+  uint8_t* copy;
+  size_t len;
+
+  model_init(&m, 1, 8);
+  TEST(orm_bin_enc_init(&enc, 0) == 0);
+  orm_bin_dec_init(&dec);
+  model_encode(&m, &enc, 0);
+  TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+  TEST((copy = malloc(len)) != NULL);
+  memcpy(copy, frame, len);
+
+  TEST(orm_bin_dec_apply(&dec, copy, 8) == -EPROTO);
+  TEST(orm_bin_dec_apply(&dec, copy, len - 1) == -EPROTO);
+  TEST(dec.synced == 0);
+  copy[0] ^= 1;
+  TEST(orm_bin_dec_apply(&dec, copy, len) == -EPROTO);
+  copy[0] ^= 1;
+  TEST(orm_bin_dec_apply(&dec, copy, len) == 0);
+  model_check(&m, &dec);
+
+  free(copy);
+  orm_bin_dec_fini(&dec);
+  orm_bin_enc_fini(&enc);
+}
+
+
+static void test_json(void)
+{
+  static const char expect[] =
+    "{\"json\":[{\"a/b~#\":\"x\\\"y\",\"n\":\"12\"},"
+    "{\"2\":{\"ip\":\"192.168.0.1\"},\"10\":-3,\"s\":\"\"},"
+    "{},{\"x\":1}],"
+    "\"z\":[7,8,9,10,11,12,13,14,15,16,17,18]}\n";
+  struct orm_bin_enc enc;
+  struct orm_bin_dec dec;
+  const void* frame;
+  char* out;
+  size_t len, out_len;
+  FILE* f;
+  int i;
+
+  TEST(orm_bin_enc_init(&enc, 0) == 0);
+  orm_bin_dec_init(&dec);
+  orm_bin_enc_begin(&enc, 0);
+  orm_bin_enc_push(&enc, "z");
+  for( i = 11; i >= 0; i-- )
+    orm_bin_enc_value_at(&enc, i, ORM_BIN_KIND_UINT, i + 7);
+  orm_bin_enc_pop(&enc);
+  orm_bin_enc_push(&enc, "json");
+  orm_bin_enc_push_index(&enc, 1);
+  orm_bin_enc_str(&enc, "s", "", 8);
+  orm_bin_enc_value(&enc, "10", ORM_BIN_KIND_INT, -3);
+  orm_bin_enc_push(&enc, "2");
+  orm_bin_enc_value(&enc, "ip", ORM_BIN_KIND_IP4, 0x0100a8c0);
+  orm_bin_enc_pop(&enc);
+  orm_bin_enc_pop(&enc);
+  /* Element 2 is missing and is exported as an empty object */
+  orm_bin_enc_push_index(&enc, 3);
+  orm_bin_enc_value(&enc, "x", ORM_BIN_KIND_UINT, 1);
+  orm_bin_enc_pop(&enc);
+  orm_bin_enc_push_index(&enc, 0);
+  orm_bin_enc_value(&enc, "n", ORM_BIN_KIND_QUINT, 12);
+  orm_bin_enc_str(&enc, "a/b~#", "x\"y", 8);
+  orm_bin_enc_pop(&enc);
+  orm_bin_enc_pop(&enc);
+  TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+  TEST(orm_bin_dec_apply(&dec, frame, len) == 0);
+  TEST(orm_bin_dec_find(&dec, "/json#0/a~1b~0~2") != NULL);
+
+  TEST((f = open_memstream(&out, &out_len)) != NULL);
+  TEST(orm_bin_dec_json(&dec, f) == 0);
+  fclose(f);
+  if( strcmp(out, expect) != 0 )
+    fprintf(stderr, "got:    %sexpect: %s", out, expect);
+  TEST(strcmp(out, expect) == 0);
+  free(out);
+
+  orm_bin_dec_fini(&dec);
+  orm_bin_enc_fini(&enc);
+}
+
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+/* Not a pass/fail test: frame size and encode cost for a larger sample in
+ * which 1% of counters change between samples. */
+static void bench(void)
+{
+  struct orm_bin_enc enc;
+  struct model m;
+  const void* frame;
+  size_t len, key_len = 0, delta_len = 0;
+  uint64_t t, t_key = 0, t_delta = 0;
+  int round, n_delta = 0, rounds = 50, i, j;
+
+  model_init(&m, N_STACKS, N_SOCKETS);
+  for( i = 0; i < N_STACKS; i++ )
+    for( j = 0; j < N_SOCKETS; j++ )
+      if( ! m.socks[i][j].live )
+        model_sock_init(&m.socks[i][j]);
+  TEST(orm_bin_enc_init(&enc, rounds) == 0);
+  for( round = 0; round < rounds; round++ ) {
+    model_step(&m, 100, 0);
+    t = now_ns();
+    model_encode(&m, &enc, round);
+    TEST(orm_bin_enc_end(&enc, &frame, &len) == 0);
+    t = now_ns() - t;
+    if( round == 0 ) {
+      key_len = len;
+      t_key = t;
+    }
+    else {
+      delta_len += len;
+      t_delta += t;
+      ++n_delta;
+    }
+  }
+  printf("bench: %d values, keyframe %zu bytes %"PRIu64" ns, "
+         "delta %zu bytes %"PRIu64" ns\n", model_n_keys(&m), key_len, t_key,
+         delta_len / n_delta, t_delta / n_delta);
+  orm_bin_enc_fini(&enc);
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: orm_bin_test [-r rounds] [-s seed]\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int c;
+
+  cfg_seed = getpid();
+  while( (c = getopt(argc, argv, "r:s:")) != -1 )
+    switch( c ) {
+    case 'r':
+      cfg_rounds = atoi(optarg);
+      break;
+    case 's':
+      cfg_seed = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc || cfg_rounds < 40 )
+    usage();
+  srand(cfg_seed);
+
+  test_roundtrip();
+  test_corrupt();
+  test_json();
+  bench();
+  return 0;
+}
@@ -20,6 +20,9 @@ static void usage_msg(FILE* f)
   fprintf(f, "  -w WARMUPS              - num warm-up iterations\n");
   fprintf(f, "  -f FRAME_LEN            - frame length (bytes)\n");
   fprintf(f, "  -g GAP_NANOS            - pause between iterations (nanos)\n");
+  fprintf(f, "  -s                      - print summary stats, not samples\n");
+  fprintf(f, "  -I MILLIS               - print summary stats every interval\n");
+  fprintf(f, "  -H FILE                 - save latency histogram to file\n");
 }
 
 
@@ -122,8 +125,9 @@ static int do_measure_overhead(const struct rtt_options* opts,
   struct timespec a, b;
   int i;
 
-  int* results;
-  RTT_TEST( results = malloc(n_iters * sizeof(results[0])) );
+  struct lat_hist* results;
+  RTT_TEST( results = malloc(sizeof(*results)) );
+  lat_hist_init(results);
 
   /* NB. No need to do warm-ups here as we're only interested in the
    * median.
@@ -133,12 +137,10 @@ static int do_measure_overhead(const struct rtt_options* opts,
     tx_ep->ping(tx_ep);
     rx_ep->pong(rx_ep);
     clock_gettime(CLOCK_REALTIME, &b);
-    results[i] = timespec_diff_ns(b, a);
+    lat_hist_record(results, timespec_diff_ns(b, a));
   }
 
-  int median;
-  qsort(results, n_iters, sizeof(int), ci_qsort_compare_int);
-  ci_iarray_median(results, results + n_iters, &median);
+  int median = lat_hist_percentile(results, 50);
   free(results);
   return median;
 }
@@ -150,6 +152,21 @@ static int measure_overhead(const struct rtt_options* opts)
 }
 
 
+static void print_summary(const struct lat_hist* h)
+{
+  printf("#n\tmean\tmin\t50%%\t90%%\t99%%\t99.9%%\tmax\tstddev\n");
+  printf("%llu\t%.0f\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%.0f\n",
+         (unsigned long long) h->n, lat_hist_mean(h),
+         (unsigned long long) lat_hist_percentile(h, 0),
+         (unsigned long long) lat_hist_percentile(h, 50),
+         (unsigned long long) lat_hist_percentile(h, 90),
+         (unsigned long long) lat_hist_percentile(h, 99),
+         (unsigned long long) lat_hist_percentile(h, 99.9),
+         (unsigned long long) lat_hist_percentile(h, 100),
+         lat_hist_stddev(h));
+}
+
+
 static void do_pinger(const struct rtt_options* opts,
                       struct rtt_endpoint* tx_ep,
                       struct rtt_endpoint* rx_ep)
@@ -157,10 +174,17 @@ static void do_pinger(const struct rtt_options* opts,
   int overhead = measure_overhead(opts);
   int n_warm_ups = opts->n_warm_ups;
   int n_iters = opts->n_iters;
-  int* results;
-  int i;
+  int* results = NULL;
+  struct lat_hist_live* hist = NULL;
+  int i, rtt;
 
-  RTT_TEST( results = malloc(n_iters * sizeof(results[0])) );
+  /* Summary stats come from a fixed-size histogram, so only keep the
+   * samples themselves if they are to be printed.
+   */
+  if( opts->summary )
+    RTT_TEST( hist = malloc(sizeof(*hist)) );
+  else
+    RTT_TEST( results = malloc(n_iters * sizeof(results[0])) );
 
   for( i = 0; i < n_warm_ups; ++i ) {
     tx_ep->ping(tx_ep);
@@ -173,7 +197,10 @@ static void do_pinger(const struct rtt_options* opts,
     rx_ep->reset_stats(rx_ep);
 
   /* Touch to ensure resident. */
-  memset(results, 0, n_iters * sizeof(results[0]));
+  if( results != NULL )
+    memset(results, 0, n_iters * sizeof(results[0]));
+  else
+    lat_hist_live_init(hist, opts->interval_ms, 99, 1, "nsec", stdout);
   struct timespec start, end;
 
   for( i = 0; i < n_iters; ++i ) {
@@ -181,7 +208,11 @@ static void do_pinger(const struct rtt_options* opts,
     tx_ep->ping(tx_ep);
     rx_ep->pong(rx_ep);
     clock_gettime(CLOCK_REALTIME, &end);
-    results[i] = timespec_diff_ns(end, start) - overhead;
+    rtt = timespec_diff_ns(end, start) - overhead;
+    if( results != NULL )
+      results[i] = rtt;
+    else
+      lat_hist_live_record(hist, rtt > 0 ? rtt : 0);
     if( opts->inter_iter_gap_ns ) {
       do
         clock_gettime(CLOCK_REALTIME, &start);
@@ -194,8 +225,22 @@ static void do_pinger(const struct rtt_options* opts,
     tx_ep->dump_info(tx_ep, stdout);
   if( rx_ep != tx_ep && rx_ep->dump_info != NULL )
     rx_ep->dump_info(rx_ep, stdout);
-  for( i = 0; i < n_iters; ++i )
-    printf("%d\n", results[i]);
+  if( results != NULL ) {
+    for( i = 0; i < n_iters; ++i )
+      printf("%d\n", results[i]);
+    free(results);
+  }
+  else {
+    lat_hist_live_finish(hist);
+    print_summary(&hist->total);
+    if( opts->hist_file != NULL ) {
+      FILE* fp;
+      RTT_TEST( fp = fopen(opts->hist_file, "w") );
+      RTT_TEST( lat_hist_write(&hist->total, fp) == 0 );
+      fclose(fp);
+    }
+    free(hist);
+  }
 }
 
 
@@ -245,9 +290,12 @@ int main(int argc, char* argv[])
   opts.n_warm_ups = 10000;
   opts.n_iters = 100000;
   opts.inter_iter_gap_ns = 0;
+  opts.summary = 0;
+  opts.interval_ms = 0;
+  opts.hist_file = NULL;
 
   int c;
-  while( (c = getopt(argc, argv, "i:w:f:g:h")) != -1 )
+  while( (c = getopt(argc, argv, "i:w:f:g:sI:H:h")) != -1 )
     switch( c ) {
     case 'i':
       opts.n_iters = atoi(optarg);
@@ -262,6 +310,17 @@ int main(int argc, char* argv[])
     case 'g':
       opts.inter_iter_gap_ns = atoi(optarg);
       break;
+    case 's':
+      opts.summary = 1;
+      break;
+    case 'I':
+      opts.interval_ms = atoi(optarg);
+      opts.summary = 1;
+      break;
+    case 'H':
+      opts.hist_file = optarg;
+      opts.summary = 1;
+      break;
     case 'h':
       usage_msg(stdout);
       exit(0);
@@ -27,6 +27,9 @@ struct rtt_options {
   int     n_warm_ups;
   int     n_iters;
   int     inter_iter_gap_ns;
+  int     summary;
+  int     interval_ms;
+  const char* hist_file;
 };
 
 
@@ -2,7 +2,8 @@
 # X-SPDX-Copyright-Text: (c) Copyright 2018-2020 Xilinx, Inc.
 
 TEST_APPS	:= exchange \
-		trader_onload_ds_efvi
+		trader_onload_ds_efvi \
+		trader_sockets
 
 TARGETS		:= $(TEST_APPS:%=$(AppPattern))
 
@@ -22,3 +23,5 @@ trader_onload_ds_efvi: \
 	MMAKE_LIBS     += $(LINK_ONLOAD_EXT_LIB) $(LINK_CIUL_LIB)
 trader_onload_ds_efvi: \
 	MMAKE_LIB_DEPS += $(ONLOAD_EXT_LIB_DEPEND) $(CIUL_LIB_DEPEND)
+
+trader_sockets: trader_sockets.o utils.o
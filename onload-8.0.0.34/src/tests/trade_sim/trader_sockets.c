@@ -0,0 +1,596 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2015-2019 Xilinx, Inc. */
+/* trader_sockets
+ *
+ * A trader that uses nothing but BSD sockets, so that the tick-to-order
+ * benchmark can be run on any Linux host and gives a kernel-stack baseline
+ * to compare the ef_vi, Onload and TCPDirect traders against.  Please read
+ * README for details of what the exchange and trader applications do.
+ *
+ * The UDP receive path uses recvmmsg() to drain a batch of market data
+ * messages per system call.  By default the trader spins on a non-blocking
+ * socket.  With -B the socket is given SO_BUSY_POLL and the trader blocks
+ * in recvmmsg(), so that the kernel busy-polls the device queue instead.
+ * Software receive timestamps (SO_TIMESTAMPING) are used to measure the
+ * time from the kernel receiving a "hit me" message to the trader being
+ * about to send() the order.
+ *
+ * To run against the exchange on another host:
+ *
+ *   ./exchange -s <mcast-intf>
+ *   ./trader_sockets <mcast-intf> <server>
+ *
+ * To run the exchange in-process over the loopback interface:
+ *
+ *   ./trader_sockets -L
+ *
+ * In loopback mode the exchange reads CLOCK_MONOTONIC just before sending
+ * the timed market data message and when recv() returns the whole order,
+ * so that both ends of the round trip come from the same clock, and
+ * reports the latency in the same format as the exchange application.
+ */
+
+#define _GNU_SOURCE 1
+
+#include "utils.h"
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+
+#ifndef SO_BUSY_POLL
+# define SO_BUSY_POLL  46
+#endif
+
+#define MTU                   1500
+#define MAX_BATCH             64
+#define CMSG_BUF_SIZE         256
+
+#define INTERESTING_MSG       "hit me 0 0"
+#define BORING_MSG            "boring"
+
+
+static int         cfg_rx_size = 300;
+static int         cfg_tx_size = 200;
+static const char* cfg_port = "8122";
+static const char* cfg_mcast_addr = "224.1.2.3";
+static int         cfg_batch = 32;
+static int         cfg_busy_poll_usec = -1;
+static bool        cfg_block;
+static bool        cfg_sw_ts = true;
+static bool        cfg_loopback;
+/* In-process exchange (-L) only. */
+static int         cfg_send_rate = 10000;
+static int         cfg_measure_nth = 10;
+static int         cfg_iter;
+static int         cfg_warm_n;
+
+
+struct client_state {
+  int                tcp_sock;
+  int                udp_sock;
+  char*              msg_buf;
+  int                msg_len;
+  struct mmsghdr     msgs[MAX_BATCH];
+  struct iovec       iovs[MAX_BATCH];
+  char               bufs[MAX_BATCH][MTU];
+  char               cmsg_bufs[MAX_BATCH][CMSG_BUF_SIZE];
+  char               recv_buf[MTU];
+  unsigned           n_sends;
+  uint64_t           n_recv_calls;
+  uint64_t           n_recv_msgs;
+  uint64_t           rx_to_tx_sum;
+  unsigned           rx_to_tx_min, rx_to_tx_max;
+  unsigned           rx_to_tx_n;
+};
+
+
+struct exchange_state {
+  int                listen_sock;
+  int                tcp_sock;
+  int                udp_sock;
+  struct sockaddr_in udp_dest;
+  int                rx_msg_size;
+  int                tx_msg_size;
+  char*              rx_buf;
+  char*              tx_buf;
+  char*              tx_buf_ts;
+  int                inter_tx_gap_ns;
+  bool               have_sent;
+  unsigned*          rtts;
+  int                rtt_n;
+  unsigned           n_lost_msgs;
+  unsigned           n_dropped_rtts;
+};
+
+
+static int64_t timespec_diff_ns(struct timespec a, struct timespec b)
+{
+  return (a.tv_sec - b.tv_sec) * (int64_t) 1000000000
+    + (a.tv_nsec - b.tv_nsec);
+}
+
+
+static void timespec_add_ns(struct timespec* ts, unsigned long ns)
+{
+  assert( ns < 1000000000 );
+  if( (ts->tv_nsec += ns) >= 1000000000 ) {
+    ts->tv_nsec -= 1000000000;
+    ts->tv_sec += 1;
+  }
+}
+
+
+static bool timespec_le(struct timespec a, struct timespec b)
+{
+  return a.tv_sec < b.tv_sec ||
+    (a.tv_sec == b.tv_sec && a.tv_nsec <= b.tv_nsec);
+}
+
+
+/* Find the software timestamp in the control messages of [msg].  Returns
+ * false if there is none.
+ */
+static bool get_sw_ts(struct msghdr* msg, struct timespec* ts)
+{
+  struct cmsghdr* cmsg;
+  for( cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg) )
+    if( cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SO_TIMESTAMPING ) {
+      memcpy(ts, CMSG_DATA(cmsg), sizeof(*ts));
+      return ts->tv_sec != 0;
+    }
+  return false;
+}
+
+
+static void enable_sw_ts(int sock, int flags)
+{
+  int tsm = flags | SOF_TIMESTAMPING_SOFTWARE;
+  if( setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &tsm, sizeof(tsm)) < 0 )
+    fprintf(stderr, "WARNING: failed to enable software timestamping (%s)\n",
+            strerror(errno));
+}
+
+
+/**********************************************************************
+ * The trader.
+ */
+
+static void normal_send(struct client_state* cs)
+{
+  ssize_t rc = send(cs->tcp_sock, cs->msg_buf, cs->msg_len, 0);
+  TEST( rc == cs->msg_len );
+  ++(cs->n_sends);
+}
+
+
+/* Time from the kernel receiving the market data message to the trader
+ * being about to send the order.
+ */
+static void measure_rx_to_tx(struct client_state* cs, struct mmsghdr* m)
+{
+  struct timespec rx_ts, now;
+  if( get_sw_ts(&m->msg_hdr, &rx_ts) ) {
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t ns = timespec_diff_ns(now, rx_ts);
+    /* A clock step between the two readings; drop the sample. */
+    if( ns < 0 )
+      return;
+    cs->rx_to_tx_sum += ns;
+    if( ns < cs->rx_to_tx_min )
+      cs->rx_to_tx_min = ns;
+    if( ns > cs->rx_to_tx_max )
+      cs->rx_to_tx_max = ns;
+    ++(cs->rx_to_tx_n);
+  }
+}
+
+
+static int poll_udp_rx(struct client_state* cs, int flags)
+{
+  int i, n;
+  for( i = 0; i < cfg_batch; ++i ) {
+    cs->msgs[i].msg_hdr.msg_controllen = cfg_sw_ts ? CMSG_BUF_SIZE : 0;
+    cs->msgs[i].msg_hdr.msg_flags = 0;
+  }
+  n = recvmmsg(cs->udp_sock, cs->msgs, cfg_batch, flags, NULL);
+  if( n < 0 ) {
+    TEST( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR );
+    return 0;
+  }
+  ++(cs->n_recv_calls);
+  cs->n_recv_msgs += n;
+  for( i = 0; i < n; ++i )
+    if( cs->msgs[i].msg_len >= 6 &&
+        memcmp(cs->bufs[i], "hit me", 6) == 0 ) {
+      if( cfg_sw_ts )
+        measure_rx_to_tx(cs, &cs->msgs[i]);
+      normal_send(cs);
+    }
+  return n;
+}
+
+
+static void ev_loop(struct client_state* cs)
+{
+  int flags = cfg_block ? MSG_WAITFORONE : MSG_DONTWAIT;
+
+  while( 1 ) {
+    /* Spend most of our time polling the UDP socket, since that is the
+     * latency sensitive path.  A blocking receive times out periodically
+     * so that we notice the exchange going away.
+     */
+    int i;
+    for( i = 0; i < 100; ++i )
+      if( poll_udp_rx(cs, flags) == 0 && cfg_block )
+        break;
+
+    int rc = recv(cs->tcp_sock, cs->recv_buf, sizeof(cs->recv_buf),
+                  MSG_DONTWAIT);
+    if( rc == 0 || (rc < 0 && errno == ECONNRESET) )
+      break;
+  }
+  close(cs->tcp_sock);
+
+  printf("n_sends: %u\n", cs->n_sends);
+  printf("n_recv_calls: %llu (%.2f msgs/call)\n",
+         (unsigned long long) cs->n_recv_calls,
+         cs->n_recv_calls ?
+         (double) cs->n_recv_msgs / cs->n_recv_calls : 0.0);
+  if( cs->rx_to_tx_n )
+    printf("rx_to_tx: mean=%u min=%u max=%u\n",
+           (unsigned) (cs->rx_to_tx_sum / cs->rx_to_tx_n),
+           cs->rx_to_tx_min, cs->rx_to_tx_max);
+}
+
+
+static void init(struct client_state* cs, const char* mcast_intf,
+                 const char* server, const char* port)
+{
+  int i;
+
+  /* Create UDP socket, bind, join multicast group.  This is done before
+   * connecting so that an in-process exchange never sends to a port that
+   * is not yet bound.
+   */
+  if( cfg_loopback ) {
+    TRY( cs->udp_sock = mk_socket(AF_INET, SOCK_DGRAM, bind,
+                                  "127.0.0.1", port) );
+  }
+  else {
+    TRY( cs->udp_sock = mk_socket(0, SOCK_DGRAM, bind,
+                                  cfg_mcast_addr, port) );
+    if( mcast_intf != NULL ) {
+      struct ip_mreqn mreqn;
+      TEST( inet_aton(cfg_mcast_addr, &mreqn.imr_multiaddr) );
+      mreqn.imr_address.s_addr = htonl(INADDR_ANY);
+      TEST( (mreqn.imr_ifindex = if_nametoindex(mcast_intf)) != 0 );
+      TRY( setsockopt(cs->udp_sock, SOL_IP, IP_ADD_MEMBERSHIP,
+                      &mreqn, sizeof(mreqn)) );
+    }
+  }
+  if( cfg_busy_poll_usec >= 0 &&
+      setsockopt(cs->udp_sock, SOL_SOCKET, SO_BUSY_POLL,
+                 &cfg_busy_poll_usec, sizeof(cfg_busy_poll_usec)) < 0 )
+    fprintf(stderr, "WARNING: failed to set SO_BUSY_POLL (%s)\n",
+            strerror(errno));
+  if( cfg_block ) {
+    struct timeval tv = { 0, 100000 };
+    TRY( setsockopt(cs->udp_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) );
+  }
+  if( cfg_sw_ts )
+    enable_sw_ts(cs->udp_sock, SOF_TIMESTAMPING_RX_SOFTWARE);
+
+  for( i = 0; i < MAX_BATCH; ++i ) {
+    cs->iovs[i].iov_base = cs->bufs[i];
+    cs->iovs[i].iov_len = MTU;
+    memset(&cs->msgs[i].msg_hdr, 0, sizeof(cs->msgs[i].msg_hdr));
+    cs->msgs[i].msg_hdr.msg_iov = &cs->iovs[i];
+    cs->msgs[i].msg_hdr.msg_iovlen = 1;
+    cs->msgs[i].msg_hdr.msg_control = cs->cmsg_bufs[i];
+  }
+  cs->rx_to_tx_min = -1;
+
+  /* Create TCP socket, connect to server, give it configuration. */
+  TRY( cs->tcp_sock = mk_socket(0, SOCK_STREAM, connect, server, port) );
+  int one = 1;
+  TRY( setsockopt(cs->tcp_sock, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) );
+  sock_put_int(cs->tcp_sock, cfg_tx_size);
+  sock_put_int(cs->tcp_sock, cfg_rx_size);
+
+  cs->msg_len = cfg_tx_size;
+  TEST( cs->msg_buf = calloc(1, cs->msg_len) );
+}
+
+
+/**********************************************************************
+ * In-process exchange for loopback mode.  This follows exchange.c, but
+ * uses kernel software timestamps and sends unicast to the trader.
+ */
+
+static int cmp_unsigned(const void* a, const void* b)
+{
+  unsigned x = *(const unsigned*) a, y = *(const unsigned*) b;
+  return x < y ? -1 : x > y;
+}
+
+
+static void exchange_report(struct exchange_state* ex)
+{
+  int n = ex->rtt_n;
+  uint64_t sum = 0;
+  int i;
+  for( i = 0; i < n; ++i )
+    sum += ex->rtts[i];
+  qsort(ex->rtts, n, sizeof(ex->rtts[0]), cmp_unsigned);
+  printf("n_lost_msgs:  %u\n", ex->n_lost_msgs);
+  if( ex->n_dropped_rtts )
+    printf("n_dropped_rtts: %u\n", ex->n_dropped_rtts);
+  printf("n_samples:    %d\n", n);
+  if( n == 0 ) {
+    fflush(stdout);
+    return;
+  }
+  printf("latency_mean: %u\n", (unsigned) (sum / n));
+  printf("latency_min:  %u\n", ex->rtts[0]);
+  printf("latency_50:   %u\n", ex->rtts[n / 2]);
+  printf("latency_99:   %u\n", ex->rtts[(int) (n * 0.99)]);
+  printf("latency_max:  %u\n", ex->rtts[n - 1]);
+  fflush(stdout);
+}
+
+
+static void exchange_measured_rtt(struct exchange_state* ex,
+                                  struct timespec tx_ts,
+                                  struct timespec rx_ts)
+{
+  ex->have_sent = false;
+  int64_t ns = timespec_diff_ns(rx_ts, tx_ts);
+  if( ex->rtt_n < 0 ) {
+    ++(ex->rtt_n);
+    return;
+  }
+  /* Both timestamps come from CLOCK_MONOTONIC so this should not happen.
+   * Drop rather than record a bogus sample, and count it so that it is
+   * visible in the report.
+   */
+  if( ns < 0 ) {
+    ++(ex->n_dropped_rtts);
+    return;
+  }
+  ex->rtts[ex->rtt_n++] = ns;
+}
+
+
+static void exchange_init(struct exchange_state* ex, const char* port)
+{
+  /* Back-to-back runs would otherwise hit the previous connection in
+   * TIME_WAIT.
+   */
+  int one = 1;
+  memset(&ex->udp_dest, 0, sizeof(ex->udp_dest));
+  ex->udp_dest.sin_family = AF_INET;
+  ex->udp_dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ex->udp_dest.sin_port = htons(atoi(port));
+  TRY( ex->listen_sock = socket(AF_INET, SOCK_STREAM, 0) );
+  TRY( setsockopt(ex->listen_sock, SOL_SOCKET, SO_REUSEADDR,
+                  &one, sizeof(one)) );
+  TRY( bind(ex->listen_sock, (void*) &ex->udp_dest, sizeof(ex->udp_dest)) );
+  TRY( listen(ex->listen_sock, 1) );
+  TRY( ex->udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) );
+  ex->inter_tx_gap_ns = 1000000000 / cfg_send_rate;
+  ex->n_lost_msgs = 0;
+  ex->n_dropped_rtts = 0;
+  if( cfg_iter == 0 )
+    cfg_iter = 5/*seconds*/ * cfg_send_rate / cfg_measure_nth;
+  if( cfg_warm_n == 0 ) {
+    cfg_warm_n = cfg_iter / 10;
+    if( cfg_warm_n == 0 )
+      cfg_warm_n = 2;
+  }
+  TEST( ex->rtts = calloc(cfg_iter, sizeof(ex->rtts[0])) );
+  ex->rtt_n = -cfg_warm_n;
+}
+
+
+static void exchange_send(struct exchange_state* ex, int sock, char* buf)
+{
+  TEST( sendto(sock, buf, ex->tx_msg_size, 0, (void*) &ex->udp_dest,
+               sizeof(ex->udp_dest)) == ex->tx_msg_size );
+}
+
+
+static void* exchange_thread(void* arg)
+{
+  struct exchange_state* ex = arg;
+
+  TRY( ex->tcp_sock = accept(ex->listen_sock, NULL, NULL) );
+  int one = 1;
+  TRY( setsockopt(ex->tcp_sock, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) );
+  ex->rx_msg_size = sock_get_int(ex->tcp_sock);
+  ex->tx_msg_size = sock_get_int(ex->tcp_sock);
+  TEST( ex->tx_msg_size >= (int) strlen(INTERESTING_MSG) );
+  TEST( ex->tx_buf = calloc(1, ex->tx_msg_size) );
+  strncpy(ex->tx_buf, BORING_MSG, ex->tx_msg_size);
+  TEST( ex->tx_buf_ts = calloc(1, ex->tx_msg_size) );
+  strncpy(ex->tx_buf_ts, INTERESTING_MSG, ex->tx_msg_size);
+  TEST( ex->rx_buf = malloc(ex->rx_msg_size) );
+
+  struct timespec tx_ts, rx_ts, next_tx_ts, now, lost_tx_ts = { 0, 0 };
+  int rc, rx_left = ex->rx_msg_size;
+  int send_i = 0;
+  ex->have_sent = false;
+  clock_gettime(CLOCK_REALTIME, &next_tx_ts);
+
+  while( ex->rtt_n < cfg_iter ) {
+    rc = recv(ex->tcp_sock, ex->rx_buf, rx_left, MSG_DONTWAIT);
+    if( rc > 0 ) {
+      if( (rx_left -= rc) == 0 ) {
+        clock_gettime(CLOCK_MONOTONIC, &rx_ts);
+        send(ex->tcp_sock, ex->rx_buf, 1, MSG_NOSIGNAL);
+        rx_left = ex->rx_msg_size;
+        if( ex->have_sent )
+          exchange_measured_rtt(ex, tx_ts, rx_ts);
+      }
+      continue;
+    }
+    else if( rc == 0 ) {
+      fprintf(stderr, "ERROR: trader disconnected\n");
+      exit(2);
+    }
+    TEST( errno == EAGAIN );
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if( ! timespec_le(next_tx_ts, now) ) {
+      /* Let the trader have the CPU if we are sharing one. */
+      sched_yield();
+      continue;
+    }
+    timespec_add_ns(&next_tx_ts, ex->inter_tx_gap_ns);
+    if( ++send_i >= cfg_measure_nth && ! ex->have_sent ) {
+      clock_gettime(CLOCK_MONOTONIC, &tx_ts);
+      exchange_send(ex, ex->udp_sock, ex->tx_buf_ts);
+      send_i = 0;
+      ex->have_sent = true;
+      lost_tx_ts = now;
+    }
+    else {
+      exchange_send(ex, ex->udp_sock, ex->tx_buf);
+      if( ex->have_sent && timespec_diff_ns(now, lost_tx_ts) > 10000000 ) {
+        /* No response to the timed message. */
+        if( ex->rtt_n > 0 )
+          ++(ex->n_lost_msgs);
+        ex->have_sent = false;
+      }
+    }
+  }
+
+  exchange_report(ex);
+  TRY( shutdown(ex->tcp_sock, SHUT_RDWR) );
+  return NULL;
+}
+
+
+/**********************************************************************/
+
+static void usage_msg(FILE* f)
+{
+  fprintf(f, "\nusage:\n");
+  fprintf(f, "  trader_sockets [options] <mcast-interface> <server>\n");
+  fprintf(f, "  trader_sockets [options] -L\n");
+  fprintf(f, "\noptions:\n");
+  fprintf(f, "  -h                - print usage info\n");
+  fprintf(f, "  -s <msg-size>     - TX (TCP) message size\n");
+  fprintf(f, "  -r <msg-size>     - RX (UDP) message size\n");
+  fprintf(f, "  -p <port>         - set TCP/UDP port number\n");
+  fprintf(f, "  -b <batch>        - max messages per recvmmsg() (1-%d)\n",
+          MAX_BATCH);
+  fprintf(f, "  -B <usec>         - block in recvmmsg() with SO_BUSY_POLL\n");
+  fprintf(f, "  -k                - block in recvmmsg() without busy poll\n");
+  fprintf(f, "  -T                - disable software timestamps\n");
+  fprintf(f, "\nloopback exchange options:\n");
+  fprintf(f, "  -L                - run the exchange in-process on loopback\n");
+  fprintf(f, "  -R <send-rate>    - set UDP message send rate\n");
+  fprintf(f, "  -n <n>            - measure latency for 1-in-n sends\n");
+  fprintf(f, "  -i <num-iter>     - number of samples to measure\n");
+  fprintf(f, "  -w <num-warmups>  - number of warmup samples\n");
+  fprintf(f, "\n");
+}
+
+
+static void usage_err(void)
+{
+  usage_msg(stderr);
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int c;
+
+  while( (c = getopt(argc, argv, "hs:r:p:b:B:kTLR:n:i:w:")) != -1 )
+    switch( c ) {
+    case 'h':
+      usage_msg(stdout);
+      exit(0);
+      break;
+    case 's':
+      cfg_tx_size = atoi(optarg);
+      break;
+    case 'r':
+      cfg_rx_size = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = optarg;
+      break;
+    case 'b':
+      cfg_batch = atoi(optarg);
+      break;
+    case 'B':
+      cfg_busy_poll_usec = atoi(optarg);
+      cfg_block = true;
+      break;
+    case 'k':
+      cfg_block = true;
+      break;
+    case 'T':
+      cfg_sw_ts = false;
+      break;
+    case 'L':
+      cfg_loopback = true;
+      break;
+    case 'R':
+      cfg_send_rate = atoi(optarg);
+      break;
+    case 'n':
+      cfg_measure_nth = atoi(optarg);
+      break;
+    case 'i':
+      cfg_iter = atoi(optarg);
+      break;
+    case 'w':
+      cfg_warm_n = atoi(optarg);
+      break;
+    case '?':
+      usage_err();
+      break;
+    default:
+      TEST(0);
+      break;
+    }
+  argc -= optind;
+  argv += optind;
+  if( argc != (cfg_loopback ? 0 : 2) || cfg_batch < 1 ||
+      cfg_batch > MAX_BATCH || cfg_send_rate <= 0 || cfg_measure_nth <= 0 )
+    usage_err();
+
+  struct client_state* cs = calloc(1, sizeof(*cs));
+  TEST( cs != NULL );
+  if( cfg_loopback ) {
+    struct exchange_state* ex = calloc(1, sizeof(*ex));
+    pthread_t tid;
+    TEST( ex != NULL );
+    exchange_init(ex, cfg_port);
+    TEST( pthread_create(&tid, NULL, exchange_thread, ex) == 0 );
+    init(cs, NULL, "127.0.0.1", cfg_port);
+    ev_loop(cs);
+    TEST( pthread_join(tid, NULL) == 0 );
+  }
+  else {
+    init(cs, argv[0], argv[1], cfg_port);
+    ev_loop(cs);
+  }
+  return 0;
+}
+
+/*! \cidoxg_end */
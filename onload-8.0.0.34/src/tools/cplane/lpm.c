@@ -0,0 +1,370 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <ci/compat.h>
+#include <ci/tools.h>
+
+#include "lpm.h"
+
+
+#define LPM_MAX_DEPTH  32
+
+
+static inline int lpm_n_exact(const struct cp_lpm* lpm)
+{
+  return 2 * lpm->fanout - 1;
+}
+
+static inline struct cp_lpm_slot*
+lpm_slot(const struct cp_lpm* lpm, int node, unsigned chunk)
+{
+  return &lpm->slots[node * lpm->fanout + chunk];
+}
+
+/* Exact-prefix table entry for the local prefix of [bits] bits of [chunk] */
+static inline int32_t*
+lpm_exact(const struct cp_lpm* lpm, int node, int bits, unsigned chunk)
+{
+  return &lpm->exact[node * lpm_n_exact(lpm) + (1 << bits) - 1 +
+                     (chunk >> (lpm->stride - bits))];
+}
+
+/* A prefix of length [len] lives in the node at depth [*depth_p] as a local
+ * prefix of [*bits_p] bits.  /0 is the only prefix with 0 local bits. */
+static inline void
+lpm_split_len(const struct cp_lpm* lpm, int len, int* depth_p, int* bits_p)
+{
+  *depth_p = len == 0 ? 0 : (len - 1) / lpm->stride;
+  *bits_p = len - *depth_p * lpm->stride;
+}
+
+static void
+lpm_mask(uint8_t* dst, const uint8_t* src, int len, int key_bytes)
+{
+  int i;
+  for( i = 0; i < key_bytes; i++ ) {
+    if( len >= 8 )
+      dst[i] = src[i];
+    else if( len > 0 )
+      dst[i] = src[i] & (0xff00 >> len);
+    else
+      dst[i] = 0;
+    len -= 8;
+  }
+}
+
+
+static int
+lpm_node_alloc(struct cp_lpm* lpm)
+{
+  int id, i;
+
+  if( lpm->node_free != CP_LPM_NONE ) {
+    id = lpm->node_free;
+    lpm->node_free = lpm->ctl[id].next_free;
+  }
+  else {
+    if( lpm->nodes_used == lpm->nodes_max ) {
+      int max = lpm->nodes_max * 2;
+      struct cp_lpm_slot* slots;
+      int32_t* exact;
+      struct cp_lpm_node_ctl* ctl;
+
+      slots = realloc(lpm->slots, max * lpm->fanout * sizeof(*slots));
+      if( slots == NULL )
+        return CP_LPM_NONE;
+      lpm->slots = slots;
+      exact = realloc(lpm->exact, max * lpm_n_exact(lpm) * sizeof(*exact));
+      if( exact == NULL )
+        return CP_LPM_NONE;
+      lpm->exact = exact;
+      ctl = realloc(lpm->ctl, max * sizeof(*ctl));
+      if( ctl == NULL )
+        return CP_LPM_NONE;
+      lpm->ctl = ctl;
+      lpm->nodes_max = max;
+    }
+    id = lpm->nodes_used++;
+  }
+
+  for( i = 0; i < lpm->fanout; i++ ) {
+    lpm_slot(lpm, id, i)->prefix = CP_LPM_NONE;
+    lpm_slot(lpm, id, i)->child = CP_LPM_NONE;
+  }
+  for( i = 0; i < lpm_n_exact(lpm); i++ )
+    lpm->exact[id * lpm_n_exact(lpm) + i] = CP_LPM_NONE;
+  lpm->ctl[id].n_exact = 0;
+  lpm->ctl[id].n_child = 0;
+  lpm->ctl[id].next_free = CP_LPM_NONE;
+  lpm->n_nodes++;
+  return id;
+}
+
+static void
+lpm_node_free(struct cp_lpm* lpm, int id)
+{
+  ci_assert_gt(id, 0);
+  ci_assert_equal(lpm->ctl[id].n_exact, 0);
+  ci_assert_equal(lpm->ctl[id].n_child, 0);
+  lpm->ctl[id].next_free = lpm->node_free;
+  lpm->node_free = id;
+  lpm->n_nodes--;
+}
+
+static int
+lpm_prefix_alloc(struct cp_lpm* lpm)
+{
+  int id;
+
+  if( lpm->prefix_free != CP_LPM_NONE ) {
+    id = lpm->prefix_free;
+    lpm->prefix_free = lpm->prefixes[id].value;
+  }
+  else {
+    if( lpm->prefixes_used == lpm->prefixes_max ) {
+      int max = lpm->prefixes_max * 2;
+      struct cp_lpm_prefix* prefixes;
+
+      prefixes = realloc(lpm->prefixes, max * sizeof(*prefixes));
+      if( prefixes == NULL )
+        return CP_LPM_NONE;
+      lpm->prefixes = prefixes;
+      lpm->prefixes_max = max;
+    }
+    id = lpm->prefixes_used++;
+  }
+  lpm->n_prefixes++;
+  return id;
+}
+
+static void
+lpm_prefix_free(struct cp_lpm* lpm, int id)
+{
+  lpm->prefixes[id].len = -1;
+  lpm->prefixes[id].value = lpm->prefix_free;
+  lpm->prefix_free = id;
+  lpm->n_prefixes--;
+}
+
+
+/* Re-expand the local prefixes of [node] over the slots covered by the
+ * local prefix of [bits] bits of [chunk]. */
+static void
+lpm_node_expand(struct cp_lpm* lpm, int node, int bits, unsigned chunk)
+{
+  int shift = lpm->stride - bits;
+  unsigned first = (chunk >> shift) << shift;
+  unsigned s;
+  int b;
+
+  for( s = first; s < first + (1u << shift); s++ ) {
+    int best = CP_LPM_NONE;
+    for( b = lpm->stride; b >= 0; b-- ) {
+      best = *lpm_exact(lpm, node, b, s);
+      if( best != CP_LPM_NONE )
+        break;
+    }
+    lpm_slot(lpm, node, s)->prefix = best;
+  }
+}
+
+
+int cp_lpm_init(struct cp_lpm* lpm, int af)
+{
+  memset(lpm, 0, sizeof(*lpm));
+  if( af == AF_INET6 ) {
+    lpm->key_bytes = 16;
+    lpm->stride = 4;
+  }
+  else {
+    lpm->key_bytes = 4;
+    lpm->stride = 8;
+  }
+  lpm->fanout = 1 << lpm->stride;
+  lpm->node_free = CP_LPM_NONE;
+  lpm->prefix_free = CP_LPM_NONE;
+
+  lpm->nodes_max = 4;
+  lpm->slots = malloc(lpm->nodes_max * lpm->fanout * sizeof(*lpm->slots));
+  lpm->exact = malloc(lpm->nodes_max * lpm_n_exact(lpm) *
+                      sizeof(*lpm->exact));
+  lpm->ctl = malloc(lpm->nodes_max * sizeof(*lpm->ctl));
+  lpm->prefixes_max = 16;
+  lpm->prefixes = malloc(lpm->prefixes_max * sizeof(*lpm->prefixes));
+  if( lpm->slots == NULL || lpm->exact == NULL || lpm->ctl == NULL ||
+      lpm->prefixes == NULL ) {
+    cp_lpm_fini(lpm);
+    return -ENOMEM;
+  }
+
+  /* The root is node 0 and is never freed. */
+  lpm_node_alloc(lpm);
+  return 0;
+}
+
+void cp_lpm_fini(struct cp_lpm* lpm)
+{
+  free(lpm->slots);
+  free(lpm->exact);
+  free(lpm->ctl);
+  free(lpm->prefixes);
+  lpm->slots = NULL;
+  lpm->exact = NULL;
+  lpm->ctl = NULL;
+  lpm->prefixes = NULL;
+}
+
+
+int cp_lpm_insert(struct cp_lpm* lpm, const void* addr, int len)
+{
+  uint8_t key[16];
+  int depth, bits, d, node = 0, id;
+  unsigned chunk;
+
+  ci_assert_ge(len, 0);
+  ci_assert_le(len, lpm->key_bytes * 8);
+  lpm_mask(key, addr, len, lpm->key_bytes);
+  lpm_split_len(lpm, len, &depth, &bits);
+
+  for( d = 0; d < depth; d++ ) {
+    chunk = cp_lpm_chunk(lpm, key, d);
+    if( lpm_slot(lpm, node, chunk)->child == CP_LPM_NONE ) {
+      int child = lpm_node_alloc(lpm);
+      if( child == CP_LPM_NONE )
+        return CP_LPM_NONE;
+      /* lpm_node_alloc() may have moved the slots */
+      lpm_slot(lpm, node, chunk)->child = child;
+      lpm->ctl[node].n_child++;
+    }
+    node = lpm_slot(lpm, node, chunk)->child;
+  }
+
+  chunk = cp_lpm_chunk(lpm, key, depth);
+  id = *lpm_exact(lpm, node, bits, chunk);
+  if( id != CP_LPM_NONE ) {
+    struct cp_lpm_prefix* p = &lpm->prefixes[id];
+    if( p->gen != lpm->gen ) {
+      p->gen = lpm->gen;
+      p->value = CP_LPM_NONE;
+    }
+    return id;
+  }
+
+  /* If this fails we may leave empty nodes behind; they are reused by the
+   * next insert on this path. */
+  id = lpm_prefix_alloc(lpm);
+  if( id == CP_LPM_NONE )
+    return CP_LPM_NONE;
+  memcpy(lpm->prefixes[id].addr, key, lpm->key_bytes);
+  lpm->prefixes[id].len = len;
+  lpm->prefixes[id].gen = lpm->gen;
+  lpm->prefixes[id].value = CP_LPM_NONE;
+
+  *lpm_exact(lpm, node, bits, chunk) = id;
+  lpm->ctl[node].n_exact++;
+  lpm_node_expand(lpm, node, bits, chunk);
+  return id;
+}
+
+
+void cp_lpm_delete(struct cp_lpm* lpm, int id)
+{
+  struct cp_lpm_prefix* p = &lpm->prefixes[id];
+  int path[LPM_MAX_DEPTH];
+  int depth, bits, d, node = 0;
+  unsigned chunk;
+
+  ci_assert_ge(p->len, 0);
+  lpm_split_len(lpm, p->len, &depth, &bits);
+
+  for( d = 0; d < depth; d++ ) {
+    path[d] = node;
+    node = lpm_slot(lpm, node, cp_lpm_chunk(lpm, p->addr, d))->child;
+    ci_assert_nequal(node, CP_LPM_NONE);
+  }
+
+  chunk = cp_lpm_chunk(lpm, p->addr, depth);
+  ci_assert_equal(*lpm_exact(lpm, node, bits, chunk), id);
+  *lpm_exact(lpm, node, bits, chunk) = CP_LPM_NONE;
+  lpm->ctl[node].n_exact--;
+  lpm_node_expand(lpm, node, bits, chunk);
+
+  /* Free the nodes which have become empty, bottom up. */
+  for( d = depth - 1; d >= 0; d-- ) {
+    if( lpm->ctl[node].n_exact != 0 || lpm->ctl[node].n_child != 0 )
+      break;
+    lpm_node_free(lpm, node);
+    node = path[d];
+    lpm_slot(lpm, node, cp_lpm_chunk(lpm, p->addr, d))->child = CP_LPM_NONE;
+    lpm->ctl[node].n_child--;
+  }
+
+  lpm_prefix_free(lpm, id);
+}
+
+
+int cp_lpm_find(const struct cp_lpm* lpm, const void* addr, int len)
+{
+  uint8_t key[16];
+  int depth, bits, d, node = 0;
+
+  if( len < 0 || len > lpm->key_bytes * 8 )
+    return CP_LPM_NONE;
+  lpm_mask(key, addr, len, lpm->key_bytes);
+  lpm_split_len(lpm, len, &depth, &bits);
+
+  for( d = 0; d < depth; d++ ) {
+    node = lpm_slot(lpm, node, cp_lpm_chunk(lpm, key, d))->child;
+    if( node == CP_LPM_NONE )
+      return CP_LPM_NONE;
+  }
+  return *lpm_exact(lpm, node, bits, cp_lpm_chunk(lpm, key, depth));
+}
+
+
+int cp_lpm_lookup_shorter(const struct cp_lpm* lpm, const void* addr,
+                          int max_len)
+{
+  const uint8_t* key = addr;
+  int best = CP_LPM_NONE;
+  int d, b, node = 0;
+
+  if( max_len > lpm->key_bytes * 8 )
+    max_len = lpm->key_bytes * 8;
+
+  for( d = 0; node != CP_LPM_NONE; d++ ) {
+    unsigned chunk = cp_lpm_chunk(lpm, key, d);
+    int max_bits = max_len - d * lpm->stride;
+    if( max_bits > lpm->stride )
+      max_bits = lpm->stride;
+    for( b = max_bits; b >= (d == 0 ? 0 : 1); b-- ) {
+      int id = *lpm_exact(lpm, node, b, chunk);
+      if( id != CP_LPM_NONE ) {
+        best = id;
+        break;
+      }
+    }
+    if( max_len <= (d + 1) * lpm->stride )
+      break;
+    node = lpm_slot(lpm, node, chunk)->child;
+  }
+  return best;
+}
+
+
+int cp_lpm_finish_update(struct cp_lpm* lpm)
+{
+  int id, removed = 0;
+
+  for( id = 0; id < lpm->prefixes_used; id++ ) {
+    if( lpm->prefixes[id].len >= 0 && lpm->prefixes[id].gen != lpm->gen ) {
+      cp_lpm_delete(lpm, id);
+      removed++;
+    }
+  }
+  return removed;
+}
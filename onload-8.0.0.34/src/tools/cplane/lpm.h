@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+#ifndef __TOOLS_CPLANE_LPM_H__
+#define __TOOLS_CPLANE_LPM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* Longest-prefix-match index for IPv4 and IPv6 prefixes.
+ *
+ * This is a multibit trie with controlled prefix expansion: each node
+ * covers [stride] bits of the address, and every slot of a node holds the
+ * longest prefix ending within those bits which covers it, plus the child
+ * node for the next bits.  A lookup is one dependent load per stride until
+ * there is no child, regardless of the number of prefixes.
+ *
+ * IPv4 uses a stride of 8 (at most 4 loads, 4KB per node).  DIR-24-8 would
+ * give 1-2 loads, but it costs 64MB for every table however small, which
+ * does not suit the policy routing case with many small tables.  The trie
+ * is not smaller for a large table: each sparse /24 costs a node per
+ * level, and a table of tens of thousands of routes can exceed 64MB.
+ * IPv6 uses a stride of 4 (at most 32 loads, 256 bytes per node), as
+ * sparse IPv6 tables would otherwise need a mostly empty 4KB node for each
+ * byte of each long prefix.
+ *
+ * Each prefix has an id which is stable for as long as the prefix is
+ * present, and an integer value which belongs to the caller.  Lookups
+ * return the id.
+ *
+ * Nodes are split in two: the slots used by lookups, and the per-node
+ * table of exact prefixes which is only needed to update the slots.
+ *
+ * Bulk updates are done by mark-and-sweep: call cp_lpm_start_update(),
+ * insert every prefix which should be present, then call
+ * cp_lpm_finish_update() to remove the others.  Prefixes which are
+ * unchanged keep their ids and trie nodes are only touched for prefixes
+ * that come or go.
+ */
+
+#define CP_LPM_NONE   (-1)
+
+struct cp_lpm_slot {
+  int32_t prefix; /* longest prefix covering this slot, or CP_LPM_NONE */
+  int32_t child;  /* node for the next stride, or CP_LPM_NONE */
+};
+
+struct cp_lpm_node_ctl {
+  uint16_t n_exact;
+  uint16_t n_child;
+  int32_t next_free;
+};
+
+struct cp_lpm_prefix {
+  uint8_t addr[16];  /* masked to len */
+  int len;           /* -1 if this id is free */
+  uint32_t gen;
+  int value;         /* for use by the caller */
+};
+
+struct cp_lpm {
+  int key_bytes;     /* 4 or 16 */
+  int stride;        /* 8 or 4 */
+  int fanout;        /* 1 << stride */
+  uint32_t gen;
+
+  /* Node [n] has slots [n * fanout, (n + 1) * fanout) and, for each local
+   * prefix of 0..stride bits, the prefix id at
+   * exact[n * (2 * fanout - 1) + (1 << bits) - 1 + local_prefix]. */
+  struct cp_lpm_slot* slots;
+  int32_t* exact;
+  struct cp_lpm_node_ctl* ctl;
+  int nodes_max;
+  int nodes_used;    /* high-water mark */
+  int node_free;
+  int n_nodes;
+
+  struct cp_lpm_prefix* prefixes;
+  int prefixes_max;
+  int prefixes_used; /* high-water mark */
+  int prefix_free;
+  int n_prefixes;
+};
+
+
+/* Returns 0 or -ENOMEM.  [af] is AF_INET or AF_INET6. */
+int cp_lpm_init(struct cp_lpm* lpm, int af);
+void cp_lpm_fini(struct cp_lpm* lpm);
+
+/* Add the prefix [addr]/[len] if it is not present, and mark it as seen by
+ * the current update.  If the prefix is new, or has not been inserted since
+ * cp_lpm_start_update(), its value is reset to CP_LPM_NONE.  [addr] is in
+ * network order, [lpm->key_bytes] long, and need not be masked.  Returns
+ * the prefix id or CP_LPM_NONE if out of memory.
+ */
+int cp_lpm_insert(struct cp_lpm* lpm, const void* addr, int len);
+void cp_lpm_delete(struct cp_lpm* lpm, int id);
+
+/* Returns the id of exactly [addr]/[len], or CP_LPM_NONE. */
+int cp_lpm_find(const struct cp_lpm* lpm, const void* addr, int len);
+
+/* Returns the id of the longest prefix of length [max_len] or less which
+ * matches [addr], or CP_LPM_NONE.  This walks the exact-prefix tables and
+ * is slower than cp_lpm_lookup().
+ */
+int cp_lpm_lookup_shorter(const struct cp_lpm* lpm, const void* addr,
+                          int max_len);
+
+static inline void cp_lpm_start_update(struct cp_lpm* lpm)
+{
+  lpm->gen++;
+}
+
+/* Remove all prefixes not inserted since cp_lpm_start_update().  Returns
+ * the number of prefixes removed. */
+int cp_lpm_finish_update(struct cp_lpm* lpm);
+
+static inline struct cp_lpm_prefix*
+cp_lpm_prefix(const struct cp_lpm* lpm, int id)
+{
+  return &lpm->prefixes[id];
+}
+
+/* The [stride] bits of [key] at depth [depth] */
+static inline unsigned
+cp_lpm_chunk(const struct cp_lpm* lpm, const uint8_t* key, int depth)
+{
+  int bit = depth * lpm->stride;
+  return (key[bit >> 3] >> (8 - lpm->stride - (bit & 7))) &
+         (lpm->fanout - 1);
+}
+
+/* Returns the id of the longest prefix which matches [addr], or
+ * CP_LPM_NONE. */
+static inline int cp_lpm_lookup(const struct cp_lpm* lpm, const void* addr)
+{
+  const uint8_t* key = addr;
+  int levels = lpm->key_bytes * 8 / lpm->stride;
+  int best = CP_LPM_NONE;
+  int node = 0;
+  int d;
+
+  for( d = 0; d < levels; d++ ) {
+    const struct cp_lpm_slot* slot =
+        &lpm->slots[node * lpm->fanout + cp_lpm_chunk(lpm, key, d)];
+    if( slot->prefix != CP_LPM_NONE )
+      best = slot->prefix;
+    node = slot->child;
+    if( node == CP_LPM_NONE )
+      break;
+  }
+  return best;
+}
+
+#endif /*__TOOLS_CPLANE_LPM_H__*/
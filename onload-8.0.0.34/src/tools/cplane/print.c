@@ -85,6 +85,9 @@ print_route_table(struct cp_session* s, struct cp_route_table** tables)
     for( table = tables[i];
          table != NULL; table = table->next ) {
       cp_print(s, "Route table %d:", table->id);
+      cp_print(s, "  lpm prefixes/nodes: %d / %d%s",
+               table->lpm.n_prefixes, table->lpm.n_nodes,
+               table->lpm_stale ? " (stale)" : "");
       cp_ippl_print(s, &table->routes, print_route);
     }
   }
@@ -38,6 +38,7 @@
 #include <cplane/ioctl.h>
 #include "mask.h"
 #include "ip_prefix_list.h"
+#include "lpm.h"
 
 /* CP_FWD_FLAG_* flags
  * Definitions are in:
@@ -325,9 +326,41 @@ struct cp_route {
 struct cp_route_table {
   uint32_t id;
   struct cp_ip_prefix_list routes;
+
+  /* Destination prefix index over [routes].  The value of each prefix is
+   * the index of its first route in [routes], and lpm_next[] chains the
+   * other routes with the same destination in list order.  Rebuilt on
+   * the next lookup after the list changes.  [lpm_ok] is false if
+   * cp_lpm_init() failed; lookups then use [routes] directly. */
+  struct cp_lpm lpm;
+  int* lpm_next;
+  int lpm_next_max;
+  bool lpm_stale;
+  bool lpm_ok;
+
   struct cp_route_table* next;
 };
 
+static inline struct cp_route*
+cp_route_entry_from_dst(struct cp_ip_with_prefix* dst)
+{
+  return CI_CONTAINER(struct cp_route, dst, dst);
+}
+
+static inline struct cp_route*
+cp_route_entry_by_idx(struct cp_route_table* table, int idx)
+{
+  return cp_route_entry_from_dst(cp_ippl_entry(&table->routes, idx));
+}
+
+/* route_lpm.c */
+extern int cp_route_table_lpm_refresh(struct cp_route_table* table, int af);
+extern struct cp_route* cp_route_find_linear(struct cp_fwd_key* key,
+                                             struct cp_route_table* table,
+                                             int af);
+extern struct cp_route* cp_route_find(struct cp_fwd_key* key,
+                                      struct cp_route_table* table, int af);
+
 /*
  *** Private part of LLAP table ***
  */
@@ -284,12 +284,6 @@ cp_routes_under_dump(struct cp_session* s, int af)
   return s->state == (af == AF_INET ? CP_DUMP_ROUTE : CP_DUMP_ROUTE6);
 }
 
-static struct cp_route*
-cp_route_entry_from_dst(struct cp_ip_with_prefix* dst)
-{
-  return CI_CONTAINER(struct cp_route, dst, dst);
-}
-
 static bool
 cp_route_del(struct cp_session* s, uint32_t table_id,
              struct cp_route* route, int af)
@@ -323,12 +317,6 @@ cp_route_del(struct cp_session* s, uint32_t table_id,
   return changed;
 }
 
-static struct cp_route*
-cp_route_entry_by_idx(struct cp_route_table* table, int idx)
-{
-  return cp_route_entry_from_dst(cp_ippl_entry(&table->routes, idx));
-}
-
 static void
 cp_route2laddr(struct cp_session* s, struct cp_route* route, int af)
 {
@@ -349,6 +337,10 @@ cp_route_add(struct cp_session* s, uint32_t table_id,
     table->id = table_id;
     cp_ippl_init(&table->routes, sizeof(struct cp_route),
                  cp_route_compare, 4);
+    table->lpm_ok = cp_lpm_init(&table->lpm, af) == 0;
+    table->lpm_next = NULL;
+    table->lpm_next_max = 0;
+    table->lpm_stale = true;
     if( cp_routes_under_dump(s,af) )
       cp_ippl_start_dump(&table->routes);
     table->next =
@@ -605,33 +597,13 @@ cp_nl_route_table_update(struct cp_session* s, struct nlmsghdr* nlhdr,
     changed = cp_route_add(s, table_id, &route, af);
 
  out:
-  if( changed )
+  if( changed ) {
+    struct cp_route_table* table = cp_route_table_find(s, table_id, af);
+    if( table != NULL )
+      table->lpm_stale = true;
     s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
                 CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
-}
-
-static struct cp_route *
-cp_route_find(struct cp_session* s, struct cp_fwd_key* key,
-              struct cp_route_table* table, int af)
-{
-  struct cp_ip_with_prefix* ipp = NULL;
-  struct cp_route *route = NULL;
-  int i;
-
-  /* Find the best prefix and metric.
-   * The list is ordered by prefix length, then by metric,
-   * so the first match is the best prefix & metric. */
-  for( i = 0; i < table->routes.used; i++ ) {
-    ipp = cp_ippl_entry(&table->routes, i);
-    route = CI_CONTAINER(struct cp_route, dst, ipp);
-    if( cp_ipx_ippl_pfx_match(af, key->dst, ipp->addr, ipp->prefix) &&
-        (route->tos == 0 || route->tos == key->tos) )
-      break;
   }
-  if( i == table->routes.used )
-    return NULL;
-
-  return route;
 }
 
 /* This function finds the preferred source address for a given route.
@@ -652,7 +624,7 @@ cp_route_find_src(struct cp_session* s, struct cp_fwd_key* key,
     struct cp_fwd_key newkey = *key;
     struct cp_route *route1;
     newkey.dst = route->data.next_hop;
-    route1 = cp_route_find(s, &newkey, table, af);
+    route1 = cp_route_find(&newkey, table, af);
     if( ! CI_IPX_ADDR_IS_ANY(route1->data.src) )
       return route1->data.src;
   }
@@ -907,7 +879,7 @@ cp_route_check_multipath(struct cp_session* s, struct cp_fwd_state* fwd_state,
   }
 
   /* Find the best prefix */
-  struct cp_route *route = cp_route_find(s, key, table, af);
+  struct cp_route *route = cp_route_find(key, table, af);
   if( route == NULL ) {
     static bool printed = false;
     if( ! printed ) {
@@ -2721,6 +2693,7 @@ void cp_route_dump_done(struct cp_session* s, int af)
     struct cp_route_table* table;
     for( table = tables[i]; table != NULL; table = table->next ) {
       if( cp_ippl_finalize(s, &table->routes, NULL) ) {
+        table->lpm_stale = true;
         s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
                     CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
         s->flags &=~ CP_SESSION_FLAG_FWD_REFRESHED;
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+/* Route lookup within one route table.  Kept apart from route.c, which
+ * needs a whole cp_session, so that tests/cplane can run it against
+ * synthetic tables. */
+
+#include "private.h"
+
+
+static inline const void*
+cp_route_lpm_key(int af, const ci_addr_sh_t* addr)
+{
+  return af == AF_INET6 ? (const void*) addr->ip6 : (const void*) &addr->ip4;
+}
+
+/* Bring table->lpm up to date with table->routes.  Prefixes which did not
+ * change keep their place in the trie; only the route chains are rebuilt.
+ * Returns 0, or -1 if we run out of memory, in which case the table stays
+ * stale and lookups use the route list directly.  If the trie could not be
+ * initialised when the table was created, try again here. */
+int
+cp_route_table_lpm_refresh(struct cp_route_table* table, int af)
+{
+  int i;
+
+  if( ! table->lpm_ok ) {
+    if( cp_lpm_init(&table->lpm, af) != 0 )
+      return -1;
+    table->lpm_ok = true;
+    table->lpm_stale = true;
+  }
+  if( ! table->lpm_stale )
+    return 0;
+  ci_assert(! table->routes.in_dump);
+
+  if( table->lpm_next_max < table->routes.used ) {
+    int* next = realloc(table->lpm_next,
+                        table->routes.max * sizeof(*table->lpm_next));
+    if( next == NULL )
+      return -1;
+    table->lpm_next = next;
+    table->lpm_next_max = table->routes.max;
+  }
+
+  /* Walk the list backwards so that each chain ends up in list order, i.e.
+   * the best route for the prefix first. */
+  cp_lpm_start_update(&table->lpm);
+  for( i = table->routes.used - 1; i >= 0; i-- ) {
+    struct cp_ip_with_prefix* dst = cp_ippl_entry(&table->routes, i);
+    struct cp_lpm_prefix* p;
+    int id;
+
+    table->lpm_next[i] = CP_LPM_NONE;
+    if( dst->prefix < 0 )
+      continue;
+    id = cp_lpm_insert(&table->lpm, cp_route_lpm_key(af, &dst->addr),
+                       dst->prefix);
+    if( id == CP_LPM_NONE )
+      return -1;
+    p = cp_lpm_prefix(&table->lpm, id);
+    table->lpm_next[i] = p->value;
+    p->value = i;
+  }
+  cp_lpm_finish_update(&table->lpm);
+
+  table->lpm_stale = false;
+  return 0;
+}
+
+struct cp_route *
+cp_route_find_linear(struct cp_fwd_key* key, struct cp_route_table* table,
+                     int af)
+{
+  struct cp_ip_with_prefix* ipp = NULL;
+  struct cp_route *route = NULL;
+  int i;
+
+  /* Find the best prefix and metric.
+   * The list is ordered by prefix length, then by metric,
+   * so the first match is the best prefix & metric. */
+  for( i = 0; i < table->routes.used; i++ ) {
+    ipp = cp_ippl_entry(&table->routes, i);
+    route = CI_CONTAINER(struct cp_route, dst, ipp);
+    if( cp_ipx_ippl_pfx_match(af, key->dst, ipp->addr, ipp->prefix) &&
+        (route->tos == 0 || route->tos == key->tos) )
+      break;
+  }
+  if( i == table->routes.used )
+    return NULL;
+
+  return route;
+}
+
+struct cp_route *
+cp_route_find(struct cp_fwd_key* key, struct cp_route_table* table, int af)
+{
+  const void* dst = cp_route_lpm_key(af, &key->dst);
+  int id;
+
+  /* The list is not sorted while we are under dump. */
+  if( table->routes.in_dump || cp_route_table_lpm_refresh(table, af) != 0 )
+    return cp_route_find_linear(key, table, af);
+
+  /* All the routes for a matching prefix have the same destination, so the
+   * best route is the first one in the longest prefix's chain with a
+   * suitable TOS.  If there is none, fall back to the next shorter
+   * prefix. */
+  for( id = cp_lpm_lookup(&table->lpm, dst);
+       id != CP_LPM_NONE;
+       id = cp_lpm_lookup_shorter(&table->lpm, dst,
+                                  cp_lpm_prefix(&table->lpm, id)->len - 1) ) {
+    int i;
+    for( i = cp_lpm_prefix(&table->lpm, id)->value;
+         i != CP_LPM_NONE;
+         i = table->lpm_next[i] ) {
+      struct cp_route* route = cp_route_entry_by_idx(table, i);
+      if( route->tos == 0 || route->tos == key->tos )
+        return route;
+    }
+  }
+  return NULL;
+}
@@ -1,9 +1,9 @@
 # SPDX-License-Identifier: GPL-2.0
 # X-SPDX-Copyright-Text: (c) Copyright 2014-2020 Xilinx, Inc.
 
-APPS := orm_json
+APPS := orm_json orm_bin_publisher orm_bin_decode
 
-SRCS := orm_json orm_json_lib
+SRCS := orm_json orm_json_lib orm_bin
 
 OBJS := $(patsubst %,%.o,$(SRCS))
 
@@ -22,6 +22,9 @@ ifeq  ($(shell CC="${CC}" CFLAGS="${CFLAGS} ${MMAKE_CFLAGS}" check_library_prese
 APPS	+= orm_zmq_publisher zmq_subscriber
 ZMQ_LIBS	:= -lzmq -lczmq
 ZMQ_INCS	:= -I/usr/include
+CFLAGS	+= -DORM_HAVE_ZMQ=1
+else
+CFLAGS	+= -DORM_HAVE_ZMQ=0
 endif
 
 MMAKE_LIBS	:= $(LINK_CIIP_LIB) $(LINK_CIAPP_LIB) $(MMAKE_LIBS_LIBPCAP) \
@@ -41,12 +44,19 @@ all: $(APPS)
 orm_json: $(DEPS)
 	(libs="$(LIBS)"; $(MMakeLinkCApp))
 
-orm_zmq_publisher: orm_zmq_publisher.o orm_json_lib.o
+orm_zmq_publisher: orm_zmq_publisher.o orm_json_lib.o orm_bin.o
 	(libs="$(LIBS)"; $(MMakeLinkCApp))
 
 zmq_subscriber: zmq_subscriber.o
 	(libs="$(LIBS)"; $(MMakeLinkCApp))
 
+orm_bin_publisher: orm_bin_publisher.o orm_json_lib.o orm_bin.o \
+		   $(MMAKE_LIB_DEPS)
+	(libs="$(LIBS)"; $(MMakeLinkCApp))
+
+orm_bin_decode: orm_bin_decode.o orm_bin.o
+	(libs="$(LIBS)"; $(MMakeLinkCApp))
+
 clean:
 	@$(MakeClean)
 	rm -f *.o $(APPS)
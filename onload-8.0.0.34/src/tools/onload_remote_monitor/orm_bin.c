@@ -0,0 +1,1010 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Binary delta encoding of onload_remote_monitor statistics.
+*//*
+\**************************************************************************/
+
+/* See orm_bin.h for the format.  This file has no dependencies on the
+ * rest of Onload so that the decoder can be built anywhere. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "orm_bin.h"
+
+
+#define ORM_BIN_HASH_MIN     1024
+/* Ids above this are treated as a corrupt frame by the decoder */
+#define ORM_BIN_ID_MAX       (1 << 24)
+/* Limit on array elements added by the JSON export to fill gaps */
+#define ORM_BIN_FILL_MAX     65536
+
+
+static inline uint64_t orm_bin_zigzag(int64_t v)
+{
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+
+static inline int64_t orm_bin_unzigzag(uint64_t v)
+{
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+
+static uint32_t orm_bin_hash(const char* path, int len)
+{
+  uint32_t h = 2166136261u;
+  int i;
+  for( i = 0; i < len; ++i )
+    h = (h ^ (uint8_t) path[i]) * 16777619u;
+  return h;
+}
+
+
+/* Append "/key" with escaping.  Returns new length or -1 if too long. */
+static int orm_bin_path_key(char* path, int len, const char* key)
+{
+  const char* p;
+  if( len + 1 >= ORM_BIN_PATH_MAX )
+    return -1;
+  path[len++] = '/';
+  for( p = key; *p; ++p ) {
+    char esc = 0;
+    switch( *p ) {
+    case '~': esc = '0'; break;
+    case '/': esc = '1'; break;
+    case '#': esc = '2'; break;
+    }
+    if( len + 2 >= ORM_BIN_PATH_MAX )
+      return -1;
+    if( esc ) {
+      path[len++] = '~';
+      path[len++] = esc;
+    }
+    else {
+      path[len++] = *p;
+    }
+  }
+  return len;
+}
+
+
+static int orm_bin_path_index(char* path, int len, unsigned index)
+{
+  char digits[11];
+  int n = 0;
+  do {
+    digits[n++] = '0' + index % 10;
+    index /= 10;
+  } while( index );
+  if( len + 1 + n >= ORM_BIN_PATH_MAX )
+    return -1;
+  path[len++] = '#';
+  while( n )
+    path[len++] = digits[--n];
+  return len;
+}
+
+
+static void orm_bin_key_free(struct orm_bin_key* key)
+{
+  free(key->path);
+  free(key->str);
+  key->path = NULL;
+  key->str = NULL;
+  key->live = 0;
+}
+
+
+/* Grow a key array to hold at least n entries */
+static int orm_bin_keys_reserve(struct orm_bin_key** keys, int* size, int n)
+{
+  struct orm_bin_key* new_keys;
+  int new_size = *size ? *size : 256;
+  if( n <= *size )
+    return 0;
+  while( new_size < n )
+    new_size *= 2;
+  new_keys = realloc(*keys, new_size * sizeof(*new_keys));
+  if( new_keys == NULL )
+    return -ENOMEM;
+  memset(new_keys + *size, 0, (new_size - *size) * sizeof(*new_keys));
+  *keys = new_keys;
+  *size = new_size;
+  return 0;
+}
+
+
+/**********************************************************/
+/* Encoder output buffer */
+/**********************************************************/
+
+static int orm_bin_buf_reserve(struct orm_bin_enc* enc, size_t n)
+{
+  uint8_t* new_buf;
+  size_t new_size;
+  if( enc->buf_len + n <= enc->buf_size )
+    return 0;
+  new_size = enc->buf_size ? enc->buf_size : 65536;
+  while( new_size < enc->buf_len + n )
+    new_size *= 2;
+  new_buf = realloc(enc->buf, new_size);
+  if( new_buf == NULL ) {
+    enc->rc = -ENOMEM;
+    return -ENOMEM;
+  }
+  enc->buf = new_buf;
+  enc->buf_size = new_size;
+  return 0;
+}
+
+
+static inline void orm_bin_put_varint(struct orm_bin_enc* enc, uint64_t v)
+{
+  uint8_t* p = enc->buf + enc->buf_len;
+  while( v >= 0x80 ) {
+    *p++ = (uint8_t) v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (uint8_t) v;
+  enc->buf_len = p - enc->buf;
+}
+
+
+/* Header and payload must fit in the reserved space: a record header and
+ * one varint take at most 20 bytes */
+static inline void orm_bin_put_rec(struct orm_bin_enc* enc, int id, int type)
+{
+  int64_t delta = (int64_t) id - (enc->prev_id + 1);
+  orm_bin_put_varint(enc, (orm_bin_zigzag(delta) << 2) | type);
+  enc->prev_id = id;
+  ++enc->n_records;
+}
+
+
+static void orm_bin_put_define(struct orm_bin_enc* enc, int id)
+{
+  struct orm_bin_key* key = &enc->keys[id];
+  if( orm_bin_buf_reserve(enc, 32 + key->path_len) != 0 )
+    return;
+  orm_bin_put_rec(enc, id, ORM_BIN_REC_DEFINE);
+  enc->buf[enc->buf_len++] = key->kind;
+  orm_bin_put_varint(enc, key->path_len);
+  memcpy(enc->buf + enc->buf_len, key->path, key->path_len);
+  enc->buf_len += key->path_len;
+}
+
+
+/**********************************************************/
+/* Encoder dictionary */
+/**********************************************************/
+
+/* (Re)build an open-addressed index of the live keys.  Entries are id + 1,
+ * 0 is empty. */
+static int orm_bin_hash_build(int32_t** hash_p, unsigned* mask_p,
+                              const struct orm_bin_key* keys, int n_keys,
+                              unsigned n_slots)
+{
+  int32_t* hash = calloc(n_slots, sizeof(*hash));
+  int id;
+  if( hash == NULL )
+    return -ENOMEM;
+  free(*hash_p);
+  *hash_p = hash;
+  *mask_p = n_slots - 1;
+  for( id = 0; id < n_keys; ++id )
+    if( keys[id].live ) {
+      unsigned i = keys[id].hash & *mask_p;
+      while( hash[i] )
+        i = (i + 1) & *mask_p;
+      hash[i] = id + 1;
+    }
+  return 0;
+}
+
+
+static int orm_bin_hash_resize(struct orm_bin_enc* enc, unsigned n_slots)
+{
+  return orm_bin_hash_build(&enc->hash, &enc->hash_mask, enc->keys,
+                            enc->n_keys, n_slots);
+}
+
+
+static inline int orm_bin_key_matches(const struct orm_bin_key* key,
+                                      const char* path, int len)
+{
+  return key->live && key->path_len == len &&
+         memcmp(key->path, path, len) == 0;
+}
+
+
+static int orm_bin_enc_define(struct orm_bin_enc* enc, const char* path,
+                              int len, uint32_t hash, int kind)
+{
+  struct orm_bin_key* key;
+  unsigned i;
+  int id;
+
+  char* key_path;
+
+  if( (unsigned) (enc->n_live + 1) * 2 > enc->hash_mask + 1 &&
+      orm_bin_hash_resize(enc, (enc->hash_mask + 1) * 2) != 0 )
+    goto fail;
+  if( (key_path = malloc(len)) == NULL )
+    goto fail;
+  if( enc->n_free ) {
+    id = enc->free_ids[--enc->n_free];
+  }
+  else {
+    if( orm_bin_keys_reserve(&enc->keys, &enc->keys_size,
+                             enc->n_keys + 1) != 0 ) {
+      free(key_path);
+      goto fail;
+    }
+    id = enc->n_keys++;
+  }
+  key = &enc->keys[id];
+  memset(key, 0, sizeof(*key));
+  key->path = key_path;
+  memcpy(key->path, path, len);
+  key->path_len = len;
+  key->hash = hash;
+  key->kind = kind;
+  key->live = 1;
+  key->next = -1;
+  ++enc->n_live;
+  ++enc->n_defined;
+
+  i = hash & enc->hash_mask;
+  while( enc->hash[i] )
+    i = (i + 1) & enc->hash_mask;
+  enc->hash[i] = id + 1;
+  return id;
+
+ fail:
+  enc->rc = -ENOMEM;
+  return -1;
+}
+
+
+/* Resolve the path in enc->path[0..len) to an id.  Stats are walked in
+ * the same order every sample, so the id which followed the previous one
+ * last time is tried before the hash table.  *fresh is set if this is the
+ * first time the path has been seen in this sample. */
+static int orm_bin_enc_lookup(struct orm_bin_enc* enc, int len, int kind,
+                              int* fresh)
+{
+  const char* path = enc->path;
+  struct orm_bin_key* key;
+  uint32_t hash;
+  int id, created = 0;
+
+  id = enc->last_key >= 0 ? enc->keys[enc->last_key].next : -1;
+  if( id >= 0 && orm_bin_key_matches(&enc->keys[id], path, len) ) {
+    ++enc->n_predicted;
+  }
+  else {
+    unsigned i;
+    hash = orm_bin_hash(path, len);
+    id = -1;
+    for( i = hash & enc->hash_mask; enc->hash[i]; i = (i + 1) & enc->hash_mask ) {
+      int candidate = enc->hash[i] - 1;
+      if( enc->keys[candidate].hash == hash &&
+          orm_bin_key_matches(&enc->keys[candidate], path, len) ) {
+        id = candidate;
+        break;
+      }
+    }
+    if( id < 0 ) {
+      if( (id = orm_bin_enc_define(enc, path, len, hash, kind)) < 0 )
+        return -1;
+      created = 1;
+    }
+    if( enc->last_key >= 0 )
+      enc->keys[enc->last_key].next = id;
+  }
+  enc->last_key = id;
+
+  key = &enc->keys[id];
+  *fresh = key->gen != enc->gen;
+  if( *fresh ) {
+    key->gen = enc->gen;
+    if( enc->keyframe || created )
+      orm_bin_put_define(enc, id);
+  }
+  return id;
+}
+
+
+/**********************************************************/
+/* Encoder API */
+/**********************************************************/
+
+int orm_bin_enc_init(struct orm_bin_enc* enc, unsigned keyframe_interval)
+{
+  memset(enc, 0, sizeof(*enc));
+  enc->keyframe_interval = keyframe_interval ? keyframe_interval :
+                                               ORM_BIN_KEYFRAME_INTERVAL;
+  enc->last_key = -1;
+  return orm_bin_hash_resize(enc, ORM_BIN_HASH_MIN);
+}
+
+
+void orm_bin_enc_fini(struct orm_bin_enc* enc)
+{
+  int id;
+  for( id = 0; id < enc->n_keys; ++id )
+    orm_bin_key_free(&enc->keys[id]);
+  free(enc->keys);
+  free(enc->free_ids);
+  free(enc->hash);
+  free(enc->buf);
+  memset(enc, 0, sizeof(*enc));
+}
+
+
+void orm_bin_enc_force_keyframe(struct orm_bin_enc* enc)
+{
+  enc->keyframe = 1;
+}
+
+
+void orm_bin_enc_begin(struct orm_bin_enc* enc, uint64_t timestamp_ns)
+{
+  struct orm_bin_frame_hdr* hdr;
+
+  ++enc->gen;
+  if( enc->seq % enc->keyframe_interval == 0 )
+    enc->keyframe = 1;
+  enc->prev_id = -1;
+  enc->last_key = -1;
+  enc->depth = 0;
+  enc->depth_len[0] = 0;
+  enc->path_overflow = 0;
+  enc->n_records = 0;
+  enc->n_defined = 0;
+  enc->n_changed = 0;
+  enc->n_removed = 0;
+  enc->n_predicted = 0;
+  enc->rc = 0;
+  enc->buf_len = 0;
+  if( orm_bin_buf_reserve(enc, sizeof(*hdr)) != 0 )
+    return;
+  hdr = (struct orm_bin_frame_hdr*) enc->buf;
+  hdr->timestamp_ns = timestamp_ns;
+  enc->buf_len = sizeof(*hdr);
+}
+
+
+/* Paths that are too long or too deep are dropped and fail the frame, but
+ * push and pop still have to pair up. */
+static void orm_bin_enc_push_len(struct orm_bin_enc* enc, int len)
+{
+  if( enc->path_overflow || len < 0 ||
+      enc->depth + 1 >= ORM_BIN_DEPTH_MAX ) {
+    ++enc->path_overflow;
+    enc->rc = -ENAMETOOLONG;
+    return;
+  }
+  enc->depth_len[++enc->depth] = len;
+}
+
+
+void orm_bin_enc_push(struct orm_bin_enc* enc, const char* key)
+{
+  int len = enc->path_overflow ? -1 :
+    orm_bin_path_key(enc->path, enc->depth_len[enc->depth], key);
+  orm_bin_enc_push_len(enc, len);
+}
+
+
+void orm_bin_enc_push_index(struct orm_bin_enc* enc, unsigned index)
+{
+  int len = enc->path_overflow ? -1 :
+    orm_bin_path_index(enc->path, enc->depth_len[enc->depth], index);
+  orm_bin_enc_push_len(enc, len);
+}
+
+
+void orm_bin_enc_pop(struct orm_bin_enc* enc)
+{
+  if( enc->path_overflow )
+    --enc->path_overflow;
+  else if( enc->depth > 0 )
+    --enc->depth;
+}
+
+
+static void orm_bin_enc_put_value(struct orm_bin_enc* enc, int len, int kind,
+                                  int64_t value)
+{
+  struct orm_bin_key* key;
+  int64_t base;
+  int id, fresh;
+
+  if( len < 0 ) {
+    enc->rc = -ENAMETOOLONG;
+    return;
+  }
+  if( (id = orm_bin_enc_lookup(enc, len, kind, &fresh)) < 0 )
+    return;
+  key = &enc->keys[id];
+  /* A keyframe resets the decoder, so values are sent relative to zero */
+  base = enc->keyframe && fresh ? 0 : key->value;
+  key->value = value;
+  if( value == base )
+    return;
+  if( orm_bin_buf_reserve(enc, 20) != 0 )
+    return;
+  orm_bin_put_rec(enc, id, ORM_BIN_REC_VALUE);
+  orm_bin_put_varint(enc, orm_bin_zigzag((int64_t) ((uint64_t) value -
+                                                    (uint64_t) base)));
+  ++enc->n_changed;
+}
+
+
+void orm_bin_enc_value(struct orm_bin_enc* enc, const char* key, int kind,
+                       int64_t value)
+{
+  if( enc->path_overflow )
+    return;
+  orm_bin_enc_put_value(enc, orm_bin_path_key(enc->path,
+                                              enc->depth_len[enc->depth],
+                                              key),
+                        kind, value);
+}
+
+
+void orm_bin_enc_value_at(struct orm_bin_enc* enc, unsigned index, int kind,
+                          int64_t value)
+{
+  if( enc->path_overflow )
+    return;
+  orm_bin_enc_put_value(enc, orm_bin_path_index(enc->path,
+                                                enc->depth_len[enc->depth],
+                                                index),
+                        kind, value);
+}
+
+
+void orm_bin_enc_str(struct orm_bin_enc* enc, const char* key,
+                     const char* str, size_t max_len)
+{
+  struct orm_bin_key* k;
+  size_t str_len = strnlen(str, max_len);
+  int id, fresh, len;
+
+  if( enc->path_overflow )
+    return;
+  len = orm_bin_path_key(enc->path, enc->depth_len[enc->depth], key);
+  if( len < 0 ) {
+    enc->rc = -ENAMETOOLONG;
+    return;
+  }
+  if( (id = orm_bin_enc_lookup(enc, len, ORM_BIN_KIND_STR, &fresh)) < 0 )
+    return;
+  k = &enc->keys[id];
+  if( k->str != NULL && strlen(k->str) == str_len &&
+      memcmp(k->str, str, str_len) == 0 &&
+      ! (enc->keyframe && fresh) )
+    return;
+  if( str_len == 0 && k->str == NULL && ! enc->keyframe )
+    return;
+
+  free(k->str);
+  k->str = malloc(str_len + 1);
+  if( k->str == NULL ) {
+    enc->rc = -ENOMEM;
+    return;
+  }
+  memcpy(k->str, str, str_len);
+  k->str[str_len] = '\0';
+  if( str_len == 0 && enc->keyframe && fresh )
+    return;
+  if( orm_bin_buf_reserve(enc, 20 + str_len) != 0 )
+    return;
+  orm_bin_put_rec(enc, id, ORM_BIN_REC_STRING);
+  orm_bin_put_varint(enc, str_len);
+  memcpy(enc->buf + enc->buf_len, str, str_len);
+  enc->buf_len += str_len;
+  ++enc->n_changed;
+}
+
+
+int orm_bin_enc_end(struct orm_bin_enc* enc, const void** frame,
+                    size_t* frame_len)
+{
+  struct orm_bin_frame_hdr* hdr;
+  int id;
+
+  /* Paths that were not seen in this sample have gone */
+  for( id = 0; id < enc->n_keys; ++id ) {
+    struct orm_bin_key* key = &enc->keys[id];
+    if( ! key->live || key->gen == enc->gen )
+      continue;
+    if( ! enc->keyframe && orm_bin_buf_reserve(enc, 20) == 0 )
+      orm_bin_put_rec(enc, id, ORM_BIN_REC_REMOVE);
+    orm_bin_key_free(key);
+    --enc->n_live;
+    ++enc->n_removed;
+    if( enc->n_free == 0 || (enc->n_free & (enc->n_free - 1)) == 0 ) {
+      /* free_ids grows in powers of two */
+      int* new_ids = realloc(enc->free_ids,
+                             (enc->n_free ? enc->n_free * 2 : 64) *
+                             sizeof(*new_ids));
+      if( new_ids == NULL ) {
+        enc->rc = -ENOMEM;
+        continue;
+      }
+      enc->free_ids = new_ids;
+    }
+    enc->free_ids[enc->n_free++] = id;
+  }
+  if( enc->n_removed && enc->rc == 0 )
+    enc->rc = orm_bin_hash_resize(enc, enc->hash_mask + 1);
+
+  if( enc->rc != 0 ) {
+    /* The decoder can't follow what we have sent so far */
+    enc->keyframe = 1;
+    return enc->rc;
+  }
+
+  hdr = (struct orm_bin_frame_hdr*) enc->buf;
+  hdr->magic = ORM_BIN_MAGIC;
+  hdr->version = ORM_BIN_VERSION;
+  hdr->flags = enc->keyframe ? ORM_BIN_FLAG_KEYFRAME : 0;
+  hdr->hdr_len = sizeof(*hdr);
+  hdr->n_records = enc->n_records;
+  hdr->n_keys = enc->n_live;
+  hdr->seq = enc->seq++;
+  enc->keyframe = 0;
+  *frame = enc->buf;
+  *frame_len = enc->buf_len;
+  return 0;
+}
+
+
+/**********************************************************/
+/* Decoder */
+/**********************************************************/
+
+void orm_bin_dec_init(struct orm_bin_dec* dec)
+{
+  memset(dec, 0, sizeof(*dec));
+}
+
+
+static void orm_bin_dec_reset(struct orm_bin_dec* dec)
+{
+  int id;
+  for( id = 0; id < dec->keys_size; ++id )
+    if( dec->keys[id].live )
+      orm_bin_key_free(&dec->keys[id]);
+  dec->n_live = 0;
+}
+
+
+void orm_bin_dec_fini(struct orm_bin_dec* dec)
+{
+  orm_bin_dec_reset(dec);
+  free(dec->keys);
+  free(dec->hash);
+  memset(dec, 0, sizeof(*dec));
+}
+
+
+static int orm_bin_get_varint(const uint8_t** p, const uint8_t* end,
+                              uint64_t* v)
+{
+  uint64_t value = 0;
+  int shift;
+  for( shift = 0; shift < 64; shift += 7 ) {
+    uint8_t b;
+    if( *p >= end )
+      return -EPROTO;
+    b = *(*p)++;
+    value |= (uint64_t) (b & 0x7f) << shift;
+    if( ! (b & 0x80) ) {
+      *v = value;
+      return 0;
+    }
+  }
+  return -EPROTO;
+}
+
+
+static int orm_bin_dec_records(struct orm_bin_dec* dec,
+                               const struct orm_bin_frame_hdr* hdr,
+                               const uint8_t* p, const uint8_t* end)
+{
+  int64_t prev_id = -1;
+  uint32_t i;
+
+  for( i = 0; i < hdr->n_records; ++i ) {
+    struct orm_bin_key* key;
+    uint64_t h, v, len;
+    int64_t id;
+    int type;
+
+    if( orm_bin_get_varint(&p, end, &h) != 0 )
+      return -EPROTO;
+    type = h & 3;
+    id = prev_id + 1 + orm_bin_unzigzag(h >> 2);
+    if( id < 0 || id >= ORM_BIN_ID_MAX )
+      return -EPROTO;
+    prev_id = id;
+
+    if( type == ORM_BIN_REC_DEFINE ) {
+      if( orm_bin_keys_reserve(&dec->keys, &dec->keys_size, id + 1) != 0 )
+        return -ENOMEM;
+      key = &dec->keys[id];
+      if( key->live ) {
+        orm_bin_key_free(key);
+        --dec->n_live;
+      }
+      if( p >= end || *p > ORM_BIN_KIND_MAX )
+        return -EPROTO;
+      key->kind = *p++;
+      if( orm_bin_get_varint(&p, end, &len) != 0 ||
+          len == 0 || len >= ORM_BIN_PATH_MAX || len > (uint64_t) (end - p) )
+        return -EPROTO;
+      if( (key->path = malloc(len + 1)) == NULL )
+        return -ENOMEM;
+      memcpy(key->path, p, len);
+      key->path[len] = '\0';
+      key->path_len = len;
+      key->hash = orm_bin_hash(key->path, len);
+      key->value = 0;
+      key->live = 1;
+      ++dec->n_live;
+      dec->reindex = 1;
+      p += len;
+      continue;
+    }
+
+    if( id >= dec->keys_size || ! dec->keys[id].live )
+      return -EPROTO;
+    key = &dec->keys[id];
+    switch( type ) {
+    case ORM_BIN_REC_VALUE:
+      if( key->kind == ORM_BIN_KIND_STR ||
+          orm_bin_get_varint(&p, end, &v) != 0 )
+        return -EPROTO;
+      key->value = (int64_t) ((uint64_t) key->value +
+                              (uint64_t) orm_bin_unzigzag(v));
+      break;
+    case ORM_BIN_REC_STRING:
+      if( key->kind != ORM_BIN_KIND_STR ||
+          orm_bin_get_varint(&p, end, &len) != 0 ||
+          len > (uint64_t) (end - p) )
+        return -EPROTO;
+      free(key->str);
+      if( (key->str = malloc(len + 1)) == NULL )
+        return -ENOMEM;
+      memcpy(key->str, p, len);
+      key->str[len] = '\0';
+      p += len;
+      break;
+    case ORM_BIN_REC_REMOVE:
+      orm_bin_key_free(key);
+      --dec->n_live;
+      dec->reindex = 1;
+      break;
+    }
+  }
+  return p == end && (uint32_t) dec->n_live == hdr->n_keys ? 0 : -EPROTO;
+}
+
+
+int orm_bin_dec_apply(struct orm_bin_dec* dec, const void* frame,
+                      size_t frame_len)
+{
+  const struct orm_bin_frame_hdr* hdr = frame;
+  int rc;
+
+  if( frame_len < sizeof(*hdr) || hdr->magic != ORM_BIN_MAGIC ||
+      hdr->version != ORM_BIN_VERSION || hdr->hdr_len < sizeof(*hdr) ||
+      hdr->hdr_len > frame_len ) {
+    dec->synced = 0;
+    return -EPROTO;
+  }
+
+  if( hdr->flags & ORM_BIN_FLAG_KEYFRAME ) {
+    orm_bin_dec_reset(dec);
+    dec->synced = 1;
+  }
+  else if( ! dec->synced || hdr->seq != dec->seq + 1 ) {
+    dec->synced = 0;
+    return -EAGAIN;
+  }
+
+  rc = orm_bin_dec_records(dec, hdr, (const uint8_t*) frame + hdr->hdr_len,
+                           (const uint8_t*) frame + frame_len);
+  if( rc != 0 ) {
+    dec->synced = 0;
+    return rc;
+  }
+  dec->seq = hdr->seq;
+  dec->timestamp_ns = hdr->timestamp_ns;
+
+  if( dec->reindex ) {
+    unsigned n_slots = ORM_BIN_HASH_MIN;
+    while( n_slots < (unsigned) dec->n_live * 2 )
+      n_slots *= 2;
+    if( orm_bin_hash_build(&dec->hash, &dec->hash_mask, dec->keys,
+                           dec->keys_size, n_slots) != 0 )
+      return -ENOMEM;
+    dec->reindex = 0;
+  }
+  return 0;
+}
+
+
+const struct orm_bin_key*
+orm_bin_dec_find(const struct orm_bin_dec* dec, const char* path)
+{
+  size_t len = strlen(path);
+  uint32_t hash = orm_bin_hash(path, len);
+  unsigned i;
+
+  if( dec->hash == NULL )
+    return NULL;
+  for( i = hash & dec->hash_mask; dec->hash[i]; i = (i + 1) & dec->hash_mask ) {
+    const struct orm_bin_key* key = &dec->keys[dec->hash[i] - 1];
+    if( key->hash == hash && orm_bin_key_matches(key, path, len) )
+      return key;
+  }
+  return NULL;
+}
+
+
+/**********************************************************/
+/* JSON export */
+/**********************************************************/
+
+struct orm_bin_seg {
+  const char* p;
+  int         len;
+  char        sep;
+};
+
+
+/* Split a path into segments.  Returns the number of segments, or -1 if
+ * there are too many. */
+static int orm_bin_split(const char* path, int path_len,
+                         struct orm_bin_seg* segs)
+{
+  int n = 0, i = 0;
+  while( i < path_len ) {
+    int start = i + 1;
+    if( n == ORM_BIN_DEPTH_MAX + 1 )
+      return -1;
+    segs[n].sep = path[i];
+    for( i = start; i < path_len && path[i] != '/' && path[i] != '#'; ++i )
+      ;
+    segs[n].p = path + start;
+    segs[n].len = i - start;
+    ++n;
+  }
+  return n;
+}
+
+
+static int orm_bin_seg_is_number(const struct orm_bin_seg* seg)
+{
+  int i;
+  if( seg->len == 0 )
+    return 0;
+  for( i = 0; i < seg->len; ++i )
+    if( seg->p[i] < '0' || seg->p[i] > '9' )
+      return 0;
+  return 1;
+}
+
+
+static unsigned orm_bin_seg_index(const struct orm_bin_seg* seg)
+{
+  unsigned index = 0;
+  int i;
+  for( i = 0; i < seg->len && i < 10; ++i )
+    index = index * 10 + (seg->p[i] - '0');
+  return index;
+}
+
+
+/* Fill missing array elements so that the others keep their indices: the
+ * encoder does not see empty objects, and stacks are indexed by id. */
+static void orm_bin_json_fill(FILE* f, unsigned from, unsigned to,
+                              char child_sep)
+{
+  const char* filler = child_sep == '/' ? "{}," :
+                       child_sep == '#' ? "[]," : "null,";
+  if( to - from > ORM_BIN_FILL_MAX )
+    return;
+  for( ; from < to; ++from )
+    fputs(filler, f);
+}
+
+
+static int orm_bin_seg_cmp(const struct orm_bin_seg* a,
+                           const struct orm_bin_seg* b)
+{
+  int rc;
+  if( a->sep != b->sep )
+    return a->sep - b->sep;
+  /* Numbers without leading zeros sort by length first */
+  if( a->len != b->len && orm_bin_seg_is_number(a) &&
+      orm_bin_seg_is_number(b) )
+    return a->len - b->len;
+  rc = memcmp(a->p, b->p, a->len < b->len ? a->len : b->len);
+  return rc ? rc : a->len - b->len;
+}
+
+
+static int orm_bin_path_cmp(const char* a, int a_len,
+                            const char* b, int b_len)
+{
+  int ia = 0, ib = 0;
+  while( ia < a_len && ib < b_len ) {
+    struct orm_bin_seg sa, sb;
+    int rc;
+    sa.sep = a[ia];
+    sb.sep = b[ib];
+    for( sa.p = a + ++ia; ia < a_len && a[ia] != '/' && a[ia] != '#'; ++ia )
+      ;
+    for( sb.p = b + ++ib; ib < b_len && b[ib] != '/' && b[ib] != '#'; ++ib )
+      ;
+    sa.len = a + ia - sa.p;
+    sb.len = b + ib - sb.p;
+    if( (rc = orm_bin_seg_cmp(&sa, &sb)) != 0 )
+      return rc;
+  }
+  return (ia < a_len) - (ib < b_len);
+}
+
+
+static const struct orm_bin_key* orm_bin_sort_keys;
+
+static int orm_bin_id_cmp(const void* a, const void* b)
+{
+  const struct orm_bin_key* ka = &orm_bin_sort_keys[*(const int*) a];
+  const struct orm_bin_key* kb = &orm_bin_sort_keys[*(const int*) b];
+  return orm_bin_path_cmp(ka->path, ka->path_len, kb->path, kb->path_len);
+}
+
+
+/* Write a path segment as a JSON string, undoing the path escaping */
+static void orm_bin_json_key(FILE* f, const struct orm_bin_seg* seg)
+{
+  int i;
+  fputc('"', f);
+  for( i = 0; i < seg->len; ++i ) {
+    unsigned char c = seg->p[i];
+    if( c == '~' && i + 1 < seg->len ) {
+      c = "~/#"[(seg->p[++i] - '0') % 3];
+    }
+    if( c == '"' || c == '\\' )
+      fprintf(f, "\\%c", c);
+    else if( c < ' ' )
+      fprintf(f, "\\u%04x", c);
+    else
+      fputc(c, f);
+  }
+  fputc('"', f);
+}
+
+
+static void orm_bin_json_str(FILE* f, const char* str)
+{
+  const char* p;
+  fputc('"', f);
+  for( p = str; p && *p; ++p ) {
+    unsigned char c = *p;
+    if( c == '"' || c == '\\' )
+      fprintf(f, "\\%c", c);
+    else if( c < ' ' )
+      fprintf(f, "\\u%04x", c);
+    else
+      fputc(c, f);
+  }
+  fputc('"', f);
+}
+
+
+static void orm_bin_json_value(FILE* f, const struct orm_bin_key* key)
+{
+  uint32_t ip;
+  switch( key->kind ) {
+  case ORM_BIN_KIND_UINT:
+    fprintf(f, "%llu", (unsigned long long) key->value);
+    break;
+  case ORM_BIN_KIND_INT:
+    fprintf(f, "%lld", (long long) key->value);
+    break;
+  case ORM_BIN_KIND_QUINT:
+    fprintf(f, "\"%llu\"", (unsigned long long) key->value);
+    break;
+  case ORM_BIN_KIND_QINT:
+    fprintf(f, "\"%lld\"", (long long) key->value);
+    break;
+  case ORM_BIN_KIND_IP4:
+    ip = (uint32_t) key->value;
+    fprintf(f, "\"%u.%u.%u.%u\"", ip & 0xff, (ip >> 8) & 0xff,
+            (ip >> 16) & 0xff, ip >> 24);
+    break;
+  default:
+    orm_bin_json_str(f, key->str);
+    break;
+  }
+}
+
+
+int orm_bin_dec_json(const struct orm_bin_dec* dec, FILE* f)
+{
+  struct orm_bin_seg segs[2][ORM_BIN_DEPTH_MAX + 1];
+  int n_segs[2] = { 0, 0 };
+  int* ids;
+  int n_ids = 0, n_out = 0, i, k, cur = 0;
+
+  ids = malloc((dec->n_live ? dec->n_live : 1) * sizeof(*ids));
+  if( ids == NULL )
+    return -ENOMEM;
+  for( i = 0; i < dec->keys_size; ++i )
+    if( dec->keys[i].live )
+      ids[n_ids++] = i;
+  orm_bin_sort_keys = dec->keys;
+  qsort(ids, n_ids, sizeof(*ids), orm_bin_id_cmp);
+
+  /* Walk the sorted leaves, closing the containers that the previous leaf
+   * was in but this one isn't, and opening the new ones.  A container is
+   * an array if its children are indexed with '#'. */
+  fputc('{', f);
+  for( i = 0; i < n_ids; ++i ) {
+    const struct orm_bin_key* key = &dec->keys[ids[i]];
+    struct orm_bin_seg* s = segs[cur];
+    struct orm_bin_seg* prev = segs[cur ^ 1];
+    int n_prev = n_segs[cur ^ 1];
+    int n, common = 0;
+
+    n = orm_bin_split(key->path, key->path_len, s);
+    if( n <= 0 )
+      continue;
+    if( n_out++ ) {
+      while( common < n - 1 && common < n_prev - 1 &&
+             orm_bin_seg_cmp(&s[common], &prev[common]) == 0 )
+        ++common;
+      for( k = n_prev - 2; k >= common; --k )
+        fputc(prev[k + 1].sep == '#' ? ']' : '}', f);
+      fputc(',', f);
+    }
+    for( k = common; k < n; ++k ) {
+      if( s[k].sep == '#' ) {
+        unsigned from = k == common && n_out > 1 && prev[k].sep == '#' ?
+                        orm_bin_seg_index(&prev[k]) + 1 : 0;
+        orm_bin_json_fill(f, from, orm_bin_seg_index(&s[k]),
+                          k < n - 1 ? s[k + 1].sep : 0);
+      }
+      else {
+        orm_bin_json_key(f, &s[k]);
+        fputc(':', f);
+      }
+      if( k < n - 1 )
+        fputc(s[k + 1].sep == '#' ? '[' : '{', f);
+    }
+    orm_bin_json_value(f, key);
+    n_segs[cur] = n;
+    cur ^= 1;
+  }
+  if( n_out ) {
+    struct orm_bin_seg* prev = segs[cur ^ 1];
+    for( k = n_segs[cur ^ 1] - 2; k >= 0; --k )
+      fputc(prev[k + 1].sep == '#' ? ']' : '}', f);
+  }
+  fputs("}\n", f);
+  free(ids);
+  return ferror(f) ? -EIO : 0;
+}
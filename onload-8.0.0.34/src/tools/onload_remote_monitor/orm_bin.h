@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Binary delta encoding of onload_remote_monitor statistics.
+*//*
+\**************************************************************************/
+
+/* A sample is the same tree of values that orm_json produces, flattened
+ * into leaves.  Each leaf is named by its path from the root:
+ *
+ *   /<key>    member <key> of an object ('~' '/' '#' escaped as ~0 ~1 ~2)
+ *   #<n>      element n of an array
+ *
+ * e.g. "/json#1/3/stats/rx_evs".  The encoder gives each path a small id
+ * the first time it is seen and afterwards sends only the values that
+ * changed since the previous sample, as varint deltas.  Every
+ * keyframe_interval frames it sends a keyframe which defines every live
+ * path and carries every value, so that a subscriber can join (or recover
+ * from a lost frame) at any keyframe.
+ *
+ * Frame layout: struct orm_bin_frame_hdr, then records up to the end of
+ * the frame.  All fields are little-endian.  Each record starts with a
+ * varint
+ *
+ *   (zigzag(id - (previous record's id + 1)) << 2) | record type
+ *
+ * so that runs of consecutive ids cost one byte of header each.
+ *
+ *   ORM_BIN_REC_VALUE   zigzag varint of (value - previous value)
+ *   ORM_BIN_REC_STRING  varint length, bytes
+ *   ORM_BIN_REC_DEFINE  kind byte, varint path length, path bytes.  The
+ *                       value of a newly defined path is 0 or "".
+ *   ORM_BIN_REC_REMOVE  no payload; the path has gone and its id may be
+ *                       reused by a later DEFINE
+ *
+ * The decoder applies frames in order and can export its current state as
+ * JSON with the same structure as orm_json.  Objects and arrays with no
+ * leaves are not represented, so the export fills gaps in arrays with
+ * empty objects (or arrays, or nulls) to keep each element at its index.
+ */
+
+#ifndef __ORM_BIN_H__
+#define __ORM_BIN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+
+#define ORM_BIN_MAGIC           0x424d524fu  /* "ORMB" */
+#define ORM_BIN_VERSION         1
+
+#define ORM_BIN_FLAG_KEYFRAME   0x1
+
+#define ORM_BIN_REC_VALUE       0
+#define ORM_BIN_REC_STRING      1
+#define ORM_BIN_REC_DEFINE      2
+#define ORM_BIN_REC_REMOVE      3
+
+/* How a value is written when exported as JSON.  These follow the formats
+ * used by orm_json_lib.c, which quotes 64-bit counters because JSON can't
+ * cope with 64-bit integers.
+ */
+#define ORM_BIN_KIND_UINT       0   /* %u */
+#define ORM_BIN_KIND_INT        1   /* %d */
+#define ORM_BIN_KIND_QUINT      2   /* "%llu" */
+#define ORM_BIN_KIND_QINT       3   /* "%lld" */
+#define ORM_BIN_KIND_IP4        4   /* "a.b.c.d", value in network order */
+#define ORM_BIN_KIND_STR        5
+#define ORM_BIN_KIND_MAX        ORM_BIN_KIND_STR
+
+#define ORM_BIN_PATH_MAX        512
+#define ORM_BIN_DEPTH_MAX       32
+
+/* Default number of frames between keyframes */
+#define ORM_BIN_KEYFRAME_INTERVAL  50
+
+
+struct orm_bin_frame_hdr {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  flags;
+  uint16_t hdr_len;
+  uint32_t n_records;
+  uint32_t n_keys;        /* live paths after applying this frame */
+  uint64_t seq;
+  uint64_t timestamp_ns;
+};
+
+
+struct orm_bin_key {
+  char*    path;
+  char*    str;           /* ORM_BIN_KIND_STR only */
+  int64_t  value;
+  uint32_t hash;
+  uint32_t gen;           /* encoder: sample in which the path was last seen */
+  int32_t  next;          /* encoder: id that followed this one last sample */
+  uint16_t path_len;
+  uint8_t  kind;
+  uint8_t  live;
+};
+
+
+struct orm_bin_enc {
+  struct orm_bin_key* keys;
+  int       n_keys;       /* ids allocated, including free ones */
+  int       n_live;
+  int       keys_size;
+  int*      free_ids;
+  int       n_free;
+  int32_t*  hash;         /* id + 1, or 0 if empty */
+  unsigned  hash_mask;
+
+  unsigned  keyframe_interval;
+  uint64_t  seq;
+  uint32_t  gen;
+  int       keyframe;
+  int       prev_id;      /* id of the last record written */
+  int       last_key;     /* id of the last path looked up, for prediction */
+
+  char      path[ORM_BIN_PATH_MAX];
+  uint16_t  depth_len[ORM_BIN_DEPTH_MAX];
+  int       depth;
+  int       path_overflow;
+
+  uint8_t*  buf;
+  size_t    buf_len;
+  size_t    buf_size;
+  uint32_t  n_records;
+  int       rc;
+
+  /* Counters for the current frame */
+  uint32_t  n_defined;
+  uint32_t  n_changed;
+  uint32_t  n_removed;
+  uint32_t  n_predicted;
+};
+
+
+struct orm_bin_dec {
+  struct orm_bin_key* keys;
+  int       keys_size;
+  int       n_live;
+  int32_t*  hash;         /* index for orm_bin_dec_find() */
+  unsigned  hash_mask;
+  int       reindex;
+  int       synced;
+  uint64_t  seq;
+  uint64_t  timestamp_ns;
+};
+
+
+/**********************************************************/
+/* Encoder */
+/**********************************************************/
+
+extern int orm_bin_enc_init(struct orm_bin_enc* enc,
+                            unsigned keyframe_interval);
+extern void orm_bin_enc_fini(struct orm_bin_enc* enc);
+
+/* Start a new sample.  The next frame is a keyframe if keyframe_interval
+ * frames have been produced since the last one, or if
+ * orm_bin_enc_force_keyframe() was called. */
+extern void orm_bin_enc_begin(struct orm_bin_enc* enc, uint64_t timestamp_ns);
+extern void orm_bin_enc_force_keyframe(struct orm_bin_enc* enc);
+
+/* Descend into object member key, or array element index */
+extern void orm_bin_enc_push(struct orm_bin_enc* enc, const char* key);
+extern void orm_bin_enc_push_index(struct orm_bin_enc* enc, unsigned index);
+extern void orm_bin_enc_pop(struct orm_bin_enc* enc);
+
+/* Leaf values of the current object or array */
+extern void orm_bin_enc_value(struct orm_bin_enc* enc, const char* key,
+                              int kind, int64_t value);
+extern void orm_bin_enc_value_at(struct orm_bin_enc* enc, unsigned index,
+                                 int kind, int64_t value);
+extern void orm_bin_enc_str(struct orm_bin_enc* enc, const char* key,
+                            const char* str, size_t max_len);
+
+/* Finish the sample.  Paths not seen since orm_bin_enc_begin() are
+ * removed.  On success returns 0 and the frame, which is valid until the
+ * next call to orm_bin_enc_begin().  Returns negative error code if a path
+ * was too long or memory ran out. */
+extern int orm_bin_enc_end(struct orm_bin_enc* enc, const void** frame,
+                           size_t* frame_len);
+
+
+/**********************************************************/
+/* Decoder */
+/**********************************************************/
+
+extern void orm_bin_dec_init(struct orm_bin_dec* dec);
+extern void orm_bin_dec_fini(struct orm_bin_dec* dec);
+
+/* Apply a frame.  Returns 0 on success, -EAGAIN if the decoder is waiting
+ * for a keyframe (after start or a gap in sequence numbers), or -EPROTO
+ * if the frame is malformed, after which it also waits for a keyframe. */
+extern int orm_bin_dec_apply(struct orm_bin_dec* dec, const void* frame,
+                             size_t frame_len);
+
+/* Look up the current value of a path.  Returns the key or NULL. */
+extern const struct orm_bin_key*
+orm_bin_dec_find(const struct orm_bin_dec* dec, const char* path);
+
+/* Write the current state as JSON.  Members are sorted by name (numeric
+ * names numerically) and array elements by index.  Returns 0 or negative
+ * error code. */
+extern int orm_bin_dec_json(const struct orm_bin_dec* dec, FILE* f);
+
+#endif  /* __ORM_BIN_H__ */
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/*
+ * Decode binary stats frames from orm_bin_publisher and print them as
+ * JSON in the same structure as orm_json.
+ *
+ * Frames are read from a file written with orm_bin_publisher --file, or
+ * when built with czmq (ORM_HAVE_ZMQ) from a ZMQ endpoint.  Frames before
+ * the first keyframe, and after a lost frame until the next keyframe,
+ * can't be decoded and are skipped.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ci/internal/ip.h>
+#include <ci/app/testapp.h>
+#if ORM_HAVE_ZMQ
+#include <czmq.h>
+#endif
+
+#include "orm_bin.h"
+
+
+static char* cfg_file;
+static int cfg_last;
+static int cfg_summary;
+#if ORM_HAVE_ZMQ
+static char* cfg_endpoint;
+#endif
+
+static ci_cfg_desc cfg_opts[] = {
+  { 'h', "help", CI_CFG_USAGE, 0, "this message" },
+  { 0, "file",  CI_CFG_STR,  &cfg_file,
+    "Read frames from this file ('-' for stdin)" },
+#if ORM_HAVE_ZMQ
+  { 0, "endpoint",  CI_CFG_STR,  &cfg_endpoint,
+    "ZMQ endpoint to subscribe to, e.g. tcp://localhost:5557" },
+#endif
+  { 0, "last",  CI_CFG_FLAG,  &cfg_last,
+    "Print only the state after the last frame" },
+  { 0, "summary",  CI_CFG_FLAG,  &cfg_summary,
+    "Print one line per frame instead of JSON" },
+};
+#define N_CFG_OPTS (sizeof(cfg_opts) / sizeof(cfg_opts[0]))
+
+
+struct decode_stats {
+  unsigned frames;
+  unsigned skipped;
+  uint64_t bytes;
+};
+
+
+static int decode_frame(struct orm_bin_dec* dec, struct decode_stats* st,
+                        const void* frame, size_t len)
+{
+  const struct orm_bin_frame_hdr* hdr = frame;
+  int rc = orm_bin_dec_apply(dec, frame, len);
+
+  ++st->frames;
+  st->bytes += len;
+  if( rc == -EAGAIN ) {
+    ++st->skipped;
+    return 0;
+  }
+  if( rc != 0 ) {
+    fprintf(stderr, "Frame %u: bad frame rc=%d\n", st->frames, rc);
+    ++st->skipped;
+    return 0;
+  }
+  if( cfg_summary )
+    printf("seq %"PRIu64" time %"PRIu64" %s %zu bytes %u records %d keys\n",
+           hdr->seq, hdr->timestamp_ns,
+           hdr->flags & ORM_BIN_FLAG_KEYFRAME ? "key" : "delta", len,
+           hdr->n_records, dec->n_live);
+  else if( ! cfg_last )
+    return orm_bin_dec_json(dec, stdout);
+  return 0;
+}
+
+
+static int read_file(struct orm_bin_dec* dec, struct decode_stats* st,
+                     FILE* f)
+{
+  uint8_t* frame = NULL;
+  size_t size = 0;
+  uint8_t hdr[4];
+  int rc = 0;
+
+  while( fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) ) {
+    size_t len = hdr[0] | hdr[1] << 8 | hdr[2] << 16 | (size_t) hdr[3] << 24;
+    if( len > size ) {
+      uint8_t* new_frame = realloc(frame, len);
+      if( new_frame == NULL ) {
+        rc = -ENOMEM;
+        break;
+      }
+      frame = new_frame;
+      size = len;
+    }
+    if( fread(frame, 1, len, f) != len ) {
+      fprintf(stderr, "Truncated frame at end of file\n");
+      break;
+    }
+    if( (rc = decode_frame(dec, st, frame, len)) != 0 )
+      break;
+  }
+  free(frame);
+  return rc;
+}
+
+
+#if ORM_HAVE_ZMQ
+static int read_zmq(struct orm_bin_dec* dec, struct decode_stats* st)
+{
+  zsock_t* subscriber;
+  int rc = 0;
+
+  zsys_catch_interrupts();
+  fprintf(stderr, "Subscribing to ZMQ endpoint: %s\n", cfg_endpoint);
+  if( (subscriber = zsock_new_sub(cfg_endpoint, "")) == NULL )
+    return -EINVAL;
+  while( ! zsys_interrupted ) {
+    zframe_t* frame = zframe_recv(subscriber);
+    if( frame == NULL )
+      break;
+    rc = decode_frame(dec, st, zframe_data(frame), zframe_size(frame));
+    zframe_destroy(&frame);
+    if( rc != 0 )
+      break;
+    fflush(stdout);
+  }
+  zsock_destroy(&subscriber);
+  return rc;
+}
+#endif
+
+
+int main(int argc, char** argv)
+{
+  struct decode_stats st = { };
+  struct orm_bin_dec dec;
+  int rc;
+
+  ci_app_standard_opts = 0;
+  ci_app_getopt("", &argc, argv, cfg_opts, N_CFG_OPTS);
+  ++argv;  --argc;
+
+  orm_bin_dec_init(&dec);
+#if ORM_HAVE_ZMQ
+  if( cfg_endpoint != NULL ) {
+    rc = read_zmq(&dec, &st);
+  }
+  else
+#endif
+  if( cfg_file != NULL ) {
+    FILE* f = strcmp(cfg_file, "-") == 0 ? stdin : fopen(cfg_file, "rb");
+    if( f == NULL ) {
+      fprintf(stderr, "Cannot open %s: %s\n", cfg_file, strerror(errno));
+      return EXIT_FAILURE;
+    }
+    rc = read_file(&dec, &st, f);
+    if( f != stdin )
+      fclose(f);
+  }
+  else {
+    ci_app_usage("--file is required");
+    return EXIT_FAILURE;
+  }
+
+  if( rc == 0 && cfg_last && dec.synced )
+    rc = orm_bin_dec_json(&dec, stdout);
+  fprintf(stderr, "%u frames %"PRIu64" bytes, %u skipped\n",
+          st.frames, st.bytes, st.skipped);
+  orm_bin_dec_fini(&dec);
+  return rc ? EXIT_FAILURE : 0;
+}
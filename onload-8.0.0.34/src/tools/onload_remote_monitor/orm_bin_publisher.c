@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/*
+ * Publish binary delta-encoded stats (see orm_bin.h).
+ *
+ * Frames are appended to a file as a 32-bit little-endian length followed
+ * by the frame, so that a capture can be decoded offline with
+ * orm_bin_decode.  When built with czmq (ORM_HAVE_ZMQ) they can also be
+ * published on a ZMQ endpoint, one frame per message.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include <ci/internal/ip.h>
+#include <ci/app/testapp.h>
+#if ORM_HAVE_ZMQ
+#include <czmq.h>
+#endif
+
+#include "orm_bin.h"
+#include "orm_json_lib.h"
+
+
+static struct orm_cfg cfg;
+static int cfg_interval_ms = 100;
+static int cfg_keyframe = ORM_BIN_KEYFRAME_INTERVAL;
+static int cfg_count;
+static char* cfg_file;
+static int cfg_verbose;
+#if ORM_HAVE_ZMQ
+static char* cfg_endpoint;
+#endif
+
+static ci_cfg_desc cfg_opts[] = {
+  { 'h', "help", CI_CFG_USAGE, 0, "this message" },
+  { 0, "name",  CI_CFG_STR,  &cfg.stackname, "select a single stack name" },
+  { 0, "filter",  CI_CFG_STR,  &cfg.filter,
+    "dump only sockets matching pcap filter" },
+  { 0, "sum-all",  CI_CFG_FLAG,  &cfg.sum,
+    "present sum of all the stacks's stats" },
+  { 0, "interval-ms",  CI_CFG_INT,  &cfg_interval_ms,
+    "Interval between samples in milliseconds (default 100ms)" },
+  { 0, "keyframe",  CI_CFG_INT,  &cfg_keyframe,
+    "Frames between keyframes (default 50)" },
+  { 0, "count",  CI_CFG_INT,  &cfg_count,
+    "Stop after this many samples (default: run until interrupted)" },
+  { 0, "file",  CI_CFG_STR,  &cfg_file,
+    "Append frames to this file ('-' for stdout)" },
+#if ORM_HAVE_ZMQ
+  { 0, "endpoint",  CI_CFG_STR,  &cfg_endpoint,
+    "ZMQ endpoint to publish frames, e.g. tcp://*:5557" },
+#endif
+  { 'v', "verbose",  CI_CFG_FLAG,  &cfg_verbose,
+    "Log size and content of each frame to stderr" },
+};
+#define N_CFG_OPTS (sizeof(cfg_opts) / sizeof(cfg_opts[0]))
+
+
+static volatile sig_atomic_t interrupted;
+
+static void on_signal(int sig)
+{
+  interrupted = 1;
+}
+
+
+static uint64_t clock_ns(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+static int write_frame(FILE* f, const void* frame, size_t len)
+{
+  uint8_t hdr[4] = { len, len >> 8, len >> 16, len >> 24 };
+  if( fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+      fwrite(frame, 1, len, f) != len || fflush(f) != 0 )
+    return -errno;
+  return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+  struct orm_sampler* sampler;
+  struct orm_bin_enc enc;
+  struct timespec next;
+  FILE* file = NULL;
+  unsigned n = 0;
+  int i, rc;
+#if ORM_HAVE_ZMQ
+  zsock_t* publisher = NULL;
+#endif
+
+  ci_app_standard_opts = 0;
+  ci_app_getopt(
+    "[stats] [more_stats] [tcp_stats] [stack] [stack_state] [vis] [opts] "
+    "[lots] [extra] [all]",
+    &argc, argv, cfg_opts, N_CFG_OPTS);
+  ++argv;  --argc;
+
+  int output_flags = orm_parse_output_flags(argc, (const char * const*)argv);
+  if( output_flags < 0 ) {
+    fprintf(stderr, "Invalid option specified\n");
+    return EXIT_FAILURE;
+  }
+  if( cfg_interval_ms <= 0 || cfg_keyframe <= 0 ) {
+    fprintf(stderr, "--interval-ms and --keyframe must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  if( cfg_file != NULL ) {
+    file = strcmp(cfg_file, "-") == 0 ? stdout : fopen(cfg_file, "ab");
+    if( file == NULL ) {
+      fprintf(stderr, "Cannot open %s: %s\n", cfg_file, strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+#if ORM_HAVE_ZMQ
+  if( cfg_endpoint != NULL ) {
+    fprintf(stderr, "Publishing frames to ZMQ endpoint: %s\n", cfg_endpoint);
+    publisher = zsock_new_pub(cfg_endpoint);
+    if( publisher == NULL )
+      return EXIT_FAILURE;
+  }
+  if( file == NULL && publisher == NULL ) {
+    fprintf(stderr, "One of --file and --endpoint is required\n");
+    return EXIT_FAILURE;
+  }
+#else
+  if( file == NULL ) {
+    fprintf(stderr, "--file is required\n");
+    return EXIT_FAILURE;
+  }
+#endif
+
+  if( (sampler = orm_sampler_alloc(&cfg, output_flags)) == NULL ) {
+    fprintf(stderr, "Invalid configuration\n");
+    return EXIT_FAILURE;
+  }
+  if( orm_bin_enc_init(&enc, cfg_keyframe) != 0 ) {
+    orm_sampler_free(sampler);
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  for( i = 0; ! interrupted && (cfg_count <= 0 || i < cfg_count); ++i ) {
+    const void* frame;
+    size_t len;
+    uint64_t t = clock_ns(CLOCK_MONOTONIC);
+
+    rc = orm_sampler_sample(sampler, &enc, clock_ns(CLOCK_REALTIME),
+                            &frame, &len);
+    t = clock_ns(CLOCK_MONOTONIC) - t;
+    if( rc == 0 ) {
+      ++n;
+      if( cfg_verbose )
+        fprintf(stderr, "frame %u: %s %zu bytes %u keys %u changed "
+                "%u defined %u removed %"PRIu64"us\n", n,
+                ((const struct orm_bin_frame_hdr*) frame)->flags &
+                ORM_BIN_FLAG_KEYFRAME ? "key" : "delta",
+                len, enc.n_live, enc.n_changed, enc.n_defined,
+                enc.n_removed, t / 1000);
+      if( file != NULL && (rc = write_frame(file, frame, len)) != 0 ) {
+        fprintf(stderr, "Write failed: %s\n", strerror(-rc));
+        break;
+      }
+#if ORM_HAVE_ZMQ
+      if( publisher != NULL )
+        zsock_send(publisher, "b", frame, len);
+#endif
+    }
+    else {
+      fprintf(stderr, "Not able to sample stats rc=%d\n", rc);
+    }
+
+    /* Fixed rate: a slow sample doesn't push the following ones back */
+    next.tv_nsec += (cfg_interval_ms % 1000) * 1000000;
+    next.tv_sec += cfg_interval_ms / 1000 + next.tv_nsec / 1000000000;
+    next.tv_nsec %= 1000000000;
+    if( cfg_count <= 0 || i + 1 < cfg_count )
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+
+  orm_bin_enc_fini(&enc);
+  orm_sampler_free(sampler);
+#if ORM_HAVE_ZMQ
+  zsock_destroy(&publisher);
+#endif
+  if( file != NULL && file != stdout )
+    fclose(file);
+  return 0;
+}
@@ -30,6 +30,7 @@
 
 #include "../ip/sockbuf_filter.h"
 #include <ci/internal/more_stats.h>
+#include "orm_bin.h"
 #include "orm_json_lib.h"
 
 
@@ -116,7 +117,9 @@ static int orm_map_stack(orm_state_t* state, unsigned stack_id)
 }
 
 
-static int orm_map_stacks(orm_state_t* state)
+/* Call fn for each stack that we can map */
+static int orm_for_each_stack(int (*fn)(void* arg, int stack_id), void* arg,
+                              bool log_no_perms)
 {
   int rc, i;
   oo_fd fd;
@@ -140,10 +143,10 @@ static int orm_map_stacks(orm_state_t* state)
     }
     if( info.ni_exists ) {
       int stack_id = info.ni_index;
-      if( (rc = orm_map_stack(state, stack_id)) != 0 )
+      if( (rc = fn(arg, stack_id)) != 0 )
         goto out;
     }
-    else if( info.ni_no_perms_exists ) {
+    else if( info.ni_no_perms_exists && log_no_perms ) {
       LOG("User %d:%d cannot access full details of stack %d(%s) "
               "owned by %d:%d share_with=%d\n", (int) getuid(), (int) geteuid(),
               info.ni_no_perms_id, info.ni_no_perms_name,
@@ -159,6 +162,18 @@ static int orm_map_stacks(orm_state_t* state)
 }
 
 
+static int orm_map_stack_cb(void* arg, int stack_id)
+{
+  return orm_map_stack(arg, stack_id);
+}
+
+
+static int orm_map_stacks(orm_state_t* state)
+{
+  return orm_for_each_stack(orm_map_stack_cb, state, true);
+}
+
+
 static void orm_unmap_stacks(orm_state_t* state)
 {
   int i;
@@ -1185,3 +1200,637 @@ done:
 
   return rc;
 }
+
+
+/**********************************************************/
+/* Binary delta-encoded samples */
+/**********************************************************/
+
+/* The sampler walks the same state as orm_do_dump() with !cfg->flat, but
+ * into an orm_bin encoder (see orm_bin.h) instead of JSON text, and keeps
+ * the stacks mapped between samples.  The one difference in structure is
+ * that stack <id> is at index id + 1 of the "json" array, rather than at
+ * the next free index, so that the paths of a stack's stats don't change
+ * when another stack comes or goes.  Index 0 is "all" as before. */
+
+struct orm_sampler {
+  struct orm_cfg   cfg;
+  int              output_flags;
+  sockbuf_filter_t sft;
+  orm_state_t      state;
+  int*             ids;
+  int              n_ids;
+};
+
+
+/* How the types we support are exported.  Unsigned values are converted
+ * through uint64_t as dump_buf_uint_comma() does, so that the decoder
+ * prints the same numbers as orm_json. */
+#define ORM_BIN_CONV(from, kind, member)                                \
+  enum { orm_bin_kind_##from = kind };                                  \
+  static inline int64_t orm_bin_conv_##from(from value)                 \
+  {                                                                     \
+    return kind == ORM_BIN_KIND_INT || kind == ORM_BIN_KIND_QINT ?      \
+      (int64_t) (value member) : (int64_t) (uint64_t) (value member);  \
+  }                                                                     \
+  static inline void orm_bin_value_##from(struct orm_bin_enc* enc,      \
+                                          const char* key, from value)  \
+  {                                                                     \
+    orm_bin_enc_value(enc, key, kind, orm_bin_conv_##from(value));      \
+  }
+
+ORM_BIN_CONV(ci_uint64, ORM_BIN_KIND_QUINT, )
+ORM_BIN_CONV(uint64_t, ORM_BIN_KIND_QUINT, )
+ORM_BIN_CONV(ci_uint32, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(uint32_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ef_eventq_ptr, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_iptime_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(unsigned, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(oo_atomic_t, ORM_BIN_KIND_UINT, .n)
+ORM_BIN_CONV(ci_pkt_priority_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_hwport_id_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(cicp_hwport_mask_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(cicp_encap_t, ORM_BIN_KIND_UINT, .type)
+ORM_BIN_CONV(oo_waitable_lock, ORM_BIN_KIND_UINT, .wl_val)
+ORM_BIN_CONV(CI_IP_STATS_TYPE, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(__TIME_TYPE__, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(uid_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_mtu_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_ifid_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_iptime_callback_fn_t, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_uint16, ORM_BIN_KIND_UINT, )
+ORM_BIN_CONV(ci_uint8, ORM_BIN_KIND_UINT, )
+
+ORM_BIN_CONV(ci_int64, ORM_BIN_KIND_QINT, )
+ORM_BIN_CONV(ci_int32, ORM_BIN_KIND_INT, )
+ORM_BIN_CONV(int, ORM_BIN_KIND_INT, )
+ORM_BIN_CONV(oo_p, ORM_BIN_KIND_INT, )
+ORM_BIN_CONV(oo_pkt_p, ORM_BIN_KIND_INT, )
+ORM_BIN_CONV(ci_int16, ORM_BIN_KIND_INT, )
+ORM_BIN_CONV(ci_int8, ORM_BIN_KIND_INT, )
+
+static inline void orm_bin_value_ci_string256(struct orm_bin_enc* enc,
+                                              const char* key,
+                                              const char* value)
+{
+  orm_bin_enc_str(enc, key, value, sizeof(ci_string256));
+}
+
+#define ORM_BIN_VALUE_AT(enc, index, type, value)                        \
+  orm_bin_enc_value_at((enc), (index), orm_bin_kind_##type,              \
+                       orm_bin_conv_##type(value))
+
+
+/* Field names with _be16/_be32 suffixes are exported without them */
+static const char* orm_bin_be_name(char* buf, size_t size, const char* name)
+{
+  size_t len = strlen(name);
+  if( len > 5 && (strcmp(name + len - 5, "_be32") == 0 ||
+                  strcmp(name + len - 5, "_be16") == 0) &&
+      len - 5 < size ) {
+    memcpy(buf, name, len - 5);
+    buf[len - 5] = '\0';
+    return buf;
+  }
+  return name;
+}
+
+
+static void orm_bin_opts(struct orm_bin_enc* enc, ci_netif* ni)
+{
+  ci_netif_config_opts* opts = &ni->state->opts;
+  orm_bin_enc_push(enc, "opts");
+
+#ifdef NDEBUG
+  orm_bin_value_int(enc, "NDEBUG", 1);
+#else
+  orm_bin_value_int(enc, "NDEBUG", 0);
+#endif
+
+#undef CI_CFG_OPTFILE_VERSION
+#undef CI_CFG_OPT
+#undef CI_CFG_STR_OPT
+#undef CI_CFG_OPTGROUP
+
+#define CI_CFG_OPTFILE_VERSION(version)
+#define CI_CFG_OPTGROUP(group, category, expertise)
+#define CI_CFG_OPT(env, name, type, doc, bits, group, default, min, max, presentation) \
+  if( strlen(env) != 0 )                                                \
+    orm_bin_value_##type(enc, env, opts->name);
+#define CI_CFG_STR_OPT CI_CFG_OPT
+
+#include <ci/internal/opts_netif_def.h>
+
+  orm_bin_enc_pop(enc);
+}
+
+
+#define OO_STAT(desc, type, name, kind)                                 \
+  orm_bin_value_##type(enc, #name, stats->name);
+
+static void orm_bin_stats(struct orm_bin_enc* enc, const char* label,
+                          const ci_netif_stats* stats)
+{
+  orm_bin_enc_push(enc, label);
+#include <ci/internal/stats_def.h>
+  orm_bin_enc_pop(enc);
+}
+
+
+static void orm_bin_more_stats(struct orm_bin_enc* enc, const char* label,
+                               const more_stats_t* stats)
+{
+  orm_bin_enc_push(enc, label);
+#include <ci/internal/more_stats_def.h>
+  orm_bin_enc_pop(enc);
+}
+
+
+static void orm_bin_tcp_stats_count(struct orm_bin_enc* enc,
+                                    const char* label,
+                                    const ci_tcp_stats_count* stats)
+{
+  orm_bin_enc_push(enc, label);
+#include <ci/internal/tcp_stats_count_def.h>
+  orm_bin_enc_pop(enc);
+}
+
+
+static void orm_bin_tcp_ext_stats_count(struct orm_bin_enc* enc,
+                                        const char* label,
+                                        const ci_tcp_ext_stats_count* stats)
+{
+  orm_bin_enc_push(enc, label);
+#include <ci/internal/tcp_ext_stats_count_def.h>
+  orm_bin_enc_pop(enc);
+}
+
+#undef OO_STAT
+
+
+/* Structs which are not generated from ftl_defs.h, as for JSON */
+static void orm_bin_struct_ci_netif_config_opts(struct orm_bin_enc* enc,
+                                                const char* label,
+                                                ci_netif_config_opts* ignore,
+                                                int flags)
+{
+}
+
+
+static void orm_bin_struct_ci_netif_stats(struct orm_bin_enc* enc,
+                                          const char* label,
+                                          const ci_netif_stats* stats,
+                                          int flags)
+{
+  if( flags & ORM_OUTPUT_STACK )
+    orm_bin_stats(enc, label, stats);
+}
+
+
+static void orm_bin_struct_ci_tcp_stats_count(struct orm_bin_enc* enc,
+                                              const char* label,
+                                              const ci_tcp_stats_count* stats,
+                                              int flags)
+{
+  if( flags & ORM_OUTPUT_STACK )
+    orm_bin_tcp_stats_count(enc, label, stats);
+}
+
+
+static void
+orm_bin_struct_ci_tcp_ext_stats_count(struct orm_bin_enc* enc,
+                                      const char* label,
+                                      const ci_tcp_ext_stats_count* stats,
+                                      int flags)
+{
+  if( flags & ORM_OUTPUT_STACK )
+    orm_bin_tcp_ext_stats_count(enc, label, stats);
+}
+
+
+#undef FTL_TSTRUCT_BEGIN
+#undef FTL_TUNION_BEGIN
+#undef FTL_TFIELD_INT
+#undef FTL_TFIELD_CONSTINT
+#undef FTL_TFIELD_KINT
+#undef FTL_TFIELD_IPADDR
+#undef FTL_TFIELD_IPXADDR
+#undef FTL_TFIELD_PORT
+#undef FTL_TFIELD_INTBE16
+#undef FTL_TFIELD_INTBE32
+#undef FTL_TFIELD_INT2
+#undef FTL_TFIELD_INT3
+#undef FTL_TFIELD_INTBE
+#undef FTL_TFIELD_STRUCT
+#undef FTL_TFIELD_ARRAYOFINT
+#undef FTL_TFIELD_SSTR
+#undef FTL_TFIELD_ARRAYOFSTRUCT
+#undef FTL_TFIELD_ANON_STRUCT_BEGIN
+#undef FTL_TFIELD_ANON_STRUCT
+#undef FTL_TFIELD_ANON_STRUCT_END
+#undef FTL_TFIELD_ANON_UNION_BEGIN
+#undef FTL_TFIELD_ANON_UNION
+#undef FTL_TFIELD_ANON_UNION_END
+#undef FTL_TFIELD_ANON_ARRAYOFSTRUCT_BEGIN
+#undef FTL_TFIELD_ANON_ARRAYOFSTRUCT
+#undef FTL_TFIELD_ANON_ARRAYOFSTRUCT_END
+#undef FTL_TSTRUCT_END
+#undef FTL_TUNION_END
+
+#undef FTL_DECLARE
+
+#define FTL_TSTRUCT_BEGIN(ctx, name, tag)                               \
+  static void orm_bin_struct_body_##name(struct orm_bin_enc*, name*, int); \
+  static void __attribute__((unused))                                   \
+  orm_bin_struct_##name(struct orm_bin_enc* enc, const char* label,     \
+                        name* stats, int output_flags)                  \
+  {                                                                     \
+    orm_bin_enc_push(enc, label);                                       \
+    orm_bin_struct_body_##name(enc, stats, output_flags);               \
+    orm_bin_enc_pop(enc);                                               \
+  }                                                                     \
+  static void orm_bin_struct_body_##name(struct orm_bin_enc* enc,       \
+                                         name* stats, int output_flags) \
+  {
+  /* FTL_TSTRUCT_END generates the closing brace */
+
+#define FTL_TUNION_BEGIN(ctx, name, tag)        \
+  FTL_TSTRUCT_BEGIN(ctx, name, tag)
+
+#define FTL_TFIELD_INT(ctx, type, field_name, display_flags)            \
+  if( output_flags & display_flags )                                    \
+    orm_bin_value_##type(enc, #field_name, stats->field_name);
+
+#define FTL_TFIELD_CONSTINT(ctx, type, field_name, display_flags) \
+  FTL_TFIELD_INT(ctx, type, field_name, display_flags)
+
+#define FTL_TFIELD_KINT(ctx, type, field_name, display_flags) \
+  FTL_TFIELD_INT(ctx, type, field_name, display_flags)
+
+#define FTL_TFIELD_INTBE_CONV(field_name, kind, conversion, display_flags) \
+  if( output_flags & display_flags ) {                                  \
+    char name[sizeof(#field_name)];                                     \
+    orm_bin_enc_value(enc, orm_bin_be_name(name, sizeof(name), #field_name), \
+                      kind, conversion(stats->field_name));             \
+  }
+
+/* only used directly with "%u" */
+#define FTL_TFIELD_INTBE(ctx, type, field_name, format_string, conversion_function, display_flags) \
+  FTL_TFIELD_INTBE_CONV(field_name, ORM_BIN_KIND_UINT, conversion_function, \
+                        display_flags)
+
+#define FTL_TFIELD_IPADDR(ctx, uname, flags) \
+  FTL_TFIELD_INTBE_CONV(uname, ORM_BIN_KIND_IP4, (ci_uint32), flags)
+
+#define FTL_TFIELD_IPXADDR(ctx, uname, flags)                           \
+  if( output_flags & flags ) {                                          \
+    char addr[64];                                                      \
+    snprintf(addr, sizeof(addr), OOF_IPX, OOFA_IPX_L3(stats->uname));   \
+    orm_bin_enc_str(enc, #uname, addr, sizeof(addr));                   \
+  }
+
+#define FTL_TFIELD_PORT(ctx, name, flags) \
+  FTL_TFIELD_INTBE_CONV(name, ORM_BIN_KIND_INT, OOFA_PORT, flags)
+
+#define FTL_TFIELD_INTBE16(ctx, name, flags) \
+  FTL_TFIELD_INTBE_CONV(name, ORM_BIN_KIND_UINT, CI_BSWAP_BE16, flags)
+
+#define FTL_TFIELD_INTBE32(ctx, name, flags) \
+  FTL_TFIELD_INTBE_CONV(name, ORM_BIN_KIND_UINT, CI_BSWAP_BE32, flags)
+
+#define FTL_TFIELD_STRUCT(ctx, type, field_name, display_flags)         \
+  if( output_flags & display_flags )                                    \
+    orm_bin_struct_##type(enc, #field_name, &stats->field_name, output_flags);
+
+#define FTL_TFIELD_ARRAYOFINT(ctx, type, field_name, len, display_flags) \
+  if( output_flags & display_flags ) {                                  \
+    int i;                                                              \
+    orm_bin_enc_push(enc, #field_name);                                 \
+    for( i = 0; i < (len); ++i )                                        \
+      ORM_BIN_VALUE_AT(enc, i, type, stats->field_name[i]);             \
+    orm_bin_enc_pop(enc);                                               \
+  }
+
+#define FTL_TFIELD_SSTR(ctx, field_name, display_flags)                 \
+  if( output_flags & display_flags )                                    \
+    orm_bin_enc_str(enc, #field_name, stats->field_name,                \
+                    sizeof(stats->field_name));
+
+#define FTL_TFIELD_ARRAYOFSTRUCT(ctx, type, field_name, len, display_flags, field_cond) \
+  if( output_flags & display_flags ) {                                  \
+    int i;                                                              \
+    orm_bin_enc_push(enc, #field_name);                                 \
+    for( i = 0; i < (len); ++i ) {                                      \
+      if( field_cond ) {                                                \
+        orm_bin_enc_push_index(enc, i);                                 \
+        orm_bin_struct_body_##type(enc, &stats->field_name[i], output_flags); \
+        orm_bin_enc_pop(enc);                                           \
+      }                                                                 \
+    }                                                                   \
+    orm_bin_enc_pop(enc);                                               \
+  }
+
+#define FTL_TFIELD_ANON_STRUCT_BEGIN(ctx, field_name, display_flags)    \
+  if( output_flags & display_flags ) {                                  \
+    orm_bin_enc_push(enc, #field_name);
+
+#define FTL_TFIELD_ANON_STRUCT(ctx, type, field_name, child)            \
+    orm_bin_value_##type(enc, #child, stats->field_name.child);
+
+#define FTL_TFIELD_ANON_STRUCT_END(ctx, field_name)                     \
+    orm_bin_enc_pop(enc);                                               \
+  }
+
+/* anon union not yet implemented (only used for TCP/UDP headers) */
+#define FTL_TFIELD_ANON_UNION_BEGIN(ctx, field_name, display_flags)
+#define FTL_TFIELD_ANON_UNION(ctx, type, field_name, child)
+#define FTL_TFIELD_ANON_UNION_END(ctx, field_name)
+
+#define FTL_TFIELD_ANON_ARRAYOFSTRUCT_BEGIN(ctx, field_name, len, display_flags) \
+  if( output_flags & display_flags ) {                                  \
+    int i;                                                              \
+    orm_bin_enc_push(enc, #field_name);                                 \
+    for( i = 0; i < (len); ++i ) {                                      \
+      orm_bin_enc_push_index(enc, i);
+
+#define FTL_TFIELD_ANON_ARRAYOFSTRUCT(ctx, type, field_name, child, len) \
+      orm_bin_value_##type(enc, #child, stats->field_name[i].child);
+
+#define FTL_TFIELD_ANON_ARRAYOFSTRUCT_END(ctx, field_name, len)         \
+      orm_bin_enc_pop(enc);                                             \
+    }                                                                   \
+    orm_bin_enc_pop(enc);                                               \
+  }
+
+#define FTL_TSTRUCT_END(ctx)                                            \
+  }
+
+#define FTL_TUNION_END(ctx)                                             \
+  FTL_TSTRUCT_END(ctx)
+
+#define FTL_DECLARE(a) a(DECL)
+
+#include "ftl_decls.h"
+
+
+static void orm_bin_waitables(struct orm_bin_enc* enc, ci_netif* ni,
+                              const char* sock_type, int output_flags,
+                              const sockbuf_filter_t* sft)
+{
+  ci_netif_state* ns = ni->state;
+  char id_str[16];
+  unsigned id;
+
+  orm_bin_enc_push(enc, sock_type);
+  for( id = 0; id < ns->n_ep_bufs; ++id ) {
+    citp_waitable_obj* wo = ID_TO_WAITABLE_OBJ(ni, id);
+    citp_waitable* w = &wo->waitable;
+    if( w->state == CI_TCP_STATE_FREE )
+      continue;
+    snprintf(id_str, sizeof(id_str), "%d", W_FMT(w));
+
+    if( (strcmp(sock_type, "tcp_listen") == 0) &&
+        (w->state == CI_TCP_LISTEN) &&
+        sockbuf_filter_matches(sft, wo) ) {
+      orm_bin_enc_push(enc, id_str);
+      orm_bin_struct_ci_tcp_socket_listen(enc, "tcp_listen_sockets",
+                                          &wo->tcp_listen, output_flags);
+      orm_bin_enc_pop(enc);
+    }
+    else if( (strcmp(sock_type, "tcp") == 0) &&
+             (w->state & CI_TCP_STATE_TCP) &&
+             sockbuf_filter_matches(sft, wo) ) {
+      orm_bin_enc_push(enc, id_str);
+      orm_bin_struct_ci_tcp_state(enc, "tcp_state", &wo->tcp, output_flags);
+      orm_bin_enc_pop(enc);
+    }
+    else if( (strcmp(sock_type, "udp") == 0) &&
+             (w->state == CI_TCP_STATE_UDP) &&
+             sockbuf_filter_matches(sft, wo) ) {
+      orm_bin_enc_push(enc, id_str);
+      orm_bin_struct_ci_udp_state(enc, "udp_state", &wo->udp, output_flags);
+      orm_bin_enc_pop(enc);
+    }
+    else if( (strcmp(sock_type, "pipe") == 0) &&
+             (w->state == CI_TCP_STATE_PIPE) ) {
+      orm_bin_enc_push(enc, id_str);
+      orm_bin_struct_oo_pipe(enc, "oo_pipe", &wo->pipe, output_flags);
+      orm_bin_enc_pop(enc);
+    }
+  }
+  orm_bin_enc_pop(enc);
+}
+
+
+static void orm_bin_netif(struct orm_bin_enc* enc, ci_netif* ni,
+                          int output_flags, const sockbuf_filter_t* sft)
+{
+  int intf_i;
+
+  if( output_flags & ORM_OUTPUT_VIS ) {
+    orm_bin_enc_push(enc, "vis");
+    OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
+      ef_vi_state* ep_state = ci_netif_vi(ni, intf_i)->ep_state;
+      orm_bin_enc_push_index(enc, intf_i);
+      orm_bin_struct_ef_vi_rxq_state(enc, "rxq", &ep_state->rxq,
+                                     output_flags);
+      orm_bin_struct_ef_vi_txq_state(enc, "txq", &ep_state->txq,
+                                     output_flags);
+      orm_bin_struct_ef_eventq_state(enc, "evq", &ep_state->evq,
+                                     output_flags);
+      orm_bin_enc_pop(enc);
+    }
+    orm_bin_enc_pop(enc);
+  }
+  if( output_flags & (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS) ) {
+    orm_bin_enc_push(enc, "stack");
+    if( output_flags & ORM_OUTPUT_STACK )
+      orm_bin_struct_ci_netif_state(enc, "stack_state", ni->state,
+                                    output_flags);
+    if( output_flags & ORM_OUTPUT_SOCKETS ) {
+      orm_bin_waitables(enc, ni, "tcp_listen", output_flags, sft);
+      orm_bin_waitables(enc, ni, "tcp", output_flags, sft);
+      orm_bin_waitables(enc, ni, "udp", output_flags, sft);
+      orm_bin_waitables(enc, ni, "pipe", output_flags, sft);
+    }
+    orm_bin_enc_pop(enc);
+  }
+  if( output_flags & ORM_OUTPUT_STATS )
+    orm_bin_stats(enc, "stats", &ni->state->stats);
+  if( output_flags & ORM_OUTPUT_MORE_STATS ) {
+    more_stats_t more_stats;
+    get_more_stats(ni, &more_stats);
+    orm_bin_more_stats(enc, "more_stats", &more_stats);
+  }
+  if( output_flags & ORM_OUTPUT_TCP_STATS_COUNT )
+    orm_bin_tcp_stats_count(enc, "tcp_stats",
+                            &ni->state->stats_snapshot.tcp);
+  if( output_flags & ORM_OUTPUT_TCP_EXT_STATS_COUNT )
+    orm_bin_tcp_ext_stats_count(enc, "tcp_ext_stats",
+                                &ni->state->stats_snapshot.tcp_ext);
+  if( output_flags & ORM_OUTPUT_OPTS )
+    orm_bin_opts(enc, ni);
+}
+
+
+static void orm_bin_sum(struct orm_bin_enc* enc, orm_state_t* state,
+                        int output_flags)
+{
+  ci_netif_stats stats_sum = {};
+  more_stats_t more_stats_sum = {};
+  ci_tcp_stats_count tcp_stats_sum = {};
+  ci_tcp_ext_stats_count tcp_ext_stats_sum = {};
+  int i;
+
+  for( i = 0; i < state->n_stacks; ++i ) {
+    ci_netif* ni = &state->stacks[i]->os_ni;
+    if( output_flags & ORM_OUTPUT_STATS )
+      orm_oo_stats_sum(&stats_sum, &ni->state->stats);
+    if( output_flags & ORM_OUTPUT_MORE_STATS ) {
+      more_stats_t more_stats;
+      get_more_stats(ni, &more_stats);
+      orm_oo_more_stats_sum(&more_stats_sum, &more_stats);
+    }
+    if( output_flags & ORM_OUTPUT_TCP_STATS_COUNT )
+      ci_tcp_stats_count_update(&tcp_stats_sum,
+                                &ni->state->stats_snapshot.tcp);
+    if( output_flags & ORM_OUTPUT_TCP_EXT_STATS_COUNT )
+      ci_tcp_ext_stats_count_update(&tcp_ext_stats_sum,
+                                    &ni->state->stats_snapshot.tcp_ext);
+  }
+
+  orm_bin_enc_push_index(enc, 0);
+  orm_bin_enc_push(enc, "all");
+  if( output_flags & ORM_OUTPUT_STATS )
+    orm_bin_stats(enc, "stats", &stats_sum);
+  if( output_flags & ORM_OUTPUT_MORE_STATS )
+    orm_bin_more_stats(enc, "more_stats", &more_stats_sum);
+  if( output_flags & ORM_OUTPUT_TCP_STATS_COUNT )
+    orm_bin_tcp_stats_count(enc, "tcp_stats", &tcp_stats_sum);
+  if( output_flags & ORM_OUTPUT_TCP_EXT_STATS_COUNT )
+    orm_bin_tcp_ext_stats_count(enc, "tcp_ext_stats", &tcp_ext_stats_sum);
+  orm_bin_enc_pop(enc);
+  orm_bin_enc_pop(enc);
+}
+
+
+static int orm_sampler_add_id(void* arg, int stack_id)
+{
+  struct orm_sampler* s = arg;
+  int* ids = realloc(s->ids, (s->n_ids + 1) * sizeof(*ids));
+  if( ids == NULL )
+    return -ENOMEM;
+  s->ids = ids;
+  s->ids[s->n_ids++] = stack_id;
+  return 0;
+}
+
+
+static void orm_sampler_unmap(struct orm_sampler* s)
+{
+  int i;
+  for( i = 0; i < s->state.n_stacks; ++i )
+    ci_netif_dtor(&s->state.stacks[i]->os_ni);
+  orm_unmap_stacks(&s->state);
+  s->state.n_stacks = 0;
+}
+
+
+/* Mapping a stack is far more expensive than sampling it, so stacks stay
+ * mapped until the set of stacks changes. */
+static int orm_sampler_map(struct orm_sampler* s)
+{
+  int i, rc;
+
+  s->n_ids = 0;
+  if( (rc = orm_for_each_stack(orm_sampler_add_id, s, false)) != 0 )
+    return rc;
+  if( s->n_ids == s->state.n_stacks ) {
+    for( i = 0; i < s->n_ids; ++i )
+      if( s->state.stacks[i]->os_id != s->ids[i] )
+        break;
+    if( i == s->n_ids )
+      return 0;
+  }
+
+  orm_sampler_unmap(s);
+  for( i = 0; i < s->n_ids; ++i ) {
+    int n_stacks = s->state.n_stacks;
+    if( (rc = orm_map_stack(&s->state, s->ids[i])) != 0 ) {
+      /* A stack that failed to map must not be dtor'd */
+      if( s->state.n_stacks > n_stacks )
+        free(s->state.stacks[--s->state.n_stacks]);
+      orm_sampler_unmap(s);
+      return rc;
+    }
+  }
+  return 0;
+}
+
+
+struct orm_sampler* orm_sampler_alloc(const struct orm_cfg* cfg,
+                                      int output_flags)
+{
+  struct orm_sampler* s;
+
+  if( output_flags < 0 || cfg->flat || cfg->meta )
+    return NULL;
+  if( (s = calloc(1, sizeof(*s))) == NULL )
+    return NULL;
+  s->cfg = *cfg;
+  s->output_flags = output_flags;
+  if( cfg->filter && ! sockbuf_filter_prepare(&s->sft, cfg->filter) ) {
+    free(s);
+    return NULL;
+  }
+  return s;
+}
+
+
+void orm_sampler_free(struct orm_sampler* s)
+{
+  orm_sampler_unmap(s);
+  sockbuf_filter_free(&s->sft);
+  free(s->ids);
+  free(s);
+}
+
+
+int orm_sampler_sample(struct orm_sampler* s, struct orm_bin_enc* enc,
+                       uint64_t timestamp_ns, const void** frame,
+                       size_t* frame_len)
+{
+  int i, rc;
+
+  if( (rc = orm_sampler_map(s)) != 0 )
+    return rc;
+
+  orm_bin_enc_begin(enc, timestamp_ns);
+  orm_bin_enc_str(enc, "onload_version", onload_version,
+                  strlen(onload_version));
+  orm_bin_enc_push(enc, "json");
+  if( s->cfg.sum && (s->output_flags & ORM_OUTPUT_SUM) )
+    orm_bin_sum(enc, &s->state, s->output_flags);
+  for( i = 0; i < s->state.n_stacks; ++i ) {
+    ci_netif* ni = &s->state.stacks[i]->os_ni;
+    char id_str[16];
+
+    if( s->cfg.stackname != NULL &&
+        strcmp(s->cfg.stackname, ni->state->name) != 0 )
+      continue;
+    orm_bin_enc_push_index(enc, s->state.stacks[i]->os_id + 1);
+    if( s->cfg.stackname != NULL ) {
+      orm_bin_enc_push(enc, s->cfg.stackname);
+    }
+    else {
+      snprintf(id_str, sizeof(id_str), "%d", s->state.stacks[i]->os_id);
+      orm_bin_enc_push(enc, id_str);
+    }
+    orm_bin_netif(enc, ni, s->output_flags, &s->sft);
+    orm_bin_enc_pop(enc);
+    orm_bin_enc_pop(enc);
+  }
+  orm_bin_enc_pop(enc);
+
+  return orm_bin_enc_end(enc, frame, frame_len);
+}
@@ -36,3 +36,22 @@ extern int orm_parse_output_flags(int argc, const char* const* argv);
 extern int orm_do_dump(const struct orm_cfg* cfg, int output_flags,
                        FILE* output_stream);
 
+
+/* Binary delta-encoded samples of the same state as orm_do_dump() (see
+ * orm_bin.h).  cfg->flat and cfg->meta are not supported.  The sampler
+ * keeps stacks mapped between samples, so that sampling every 100ms or
+ * so is cheap.
+ */
+struct orm_sampler;
+struct orm_bin_enc;
+
+/* Returns NULL if the configuration is invalid or memory ran out */
+extern struct orm_sampler* orm_sampler_alloc(const struct orm_cfg* cfg,
+                                             int output_flags);
+extern void orm_sampler_free(struct orm_sampler* s);
+
+/* Take a sample and encode it as the next frame of enc.  Returns 0 and the
+ * frame, which is valid until the next sample, or negative error code. */
+extern int orm_sampler_sample(struct orm_sampler* s, struct orm_bin_enc* enc,
+                              uint64_t timestamp_ns, const void** frame,
+                              size_t* frame_len);
@@ -65,6 +65,17 @@ void get_stats(struct stats* s, bool halve_values, uint64_t* array,
   s->stddev = (uint64_t) sqrt(variance);
 }
 
+void get_hist_stats(struct stats* s, const struct lat_hist* hist,
+                    float percentile)
+{
+  s->min = lat_hist_percentile(hist, 0);
+  s->max = lat_hist_percentile(hist, 100);
+  s->median = lat_hist_percentile(hist, 50);
+  s->percentile = lat_hist_percentile(hist, percentile);
+  s->mean = (uint64_t) lat_hist_mean(hist);
+  s->stddev = (uint64_t) lat_hist_stddev(hist);
+}
+
 void write_raw_array(const char* raw_filename, const uint64_t* array, 
                      size_t len)
 {
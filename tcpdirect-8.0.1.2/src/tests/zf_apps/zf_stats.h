@@ -10,6 +10,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "lat_hist.h"
 
 struct stats {
   uint64_t mean;
@@ -30,6 +31,16 @@ struct stats {
  */
 void get_stats(struct stats* s, bool halve_values, uint64_t* array, uint64_t len, float percentile);
 
+/* As get_stats(), but from a histogram of samples recorded as they were
+ * measured, so that no sample array is needed.  Values are reported as
+ * recorded.
+ * @stats Struct in which stats results about the histogram will be returned
+ * @hist Histogram of the samples
+ * @percentile: identifies the k-th percentile to report in stats
+ */
+void get_hist_stats(struct stats* s, const struct lat_hist* hist,
+                    float percentile);
+
 /* Prints the array in given file with each value on single line. 
  * @raw_filename File name to which array needs to be printed out.
  * @array Array to printed to file
@@ -14,6 +14,9 @@ inline uint64_t get_frc64_time(void)
   return __rdtsc();
 }
 
+/* TSC ticks per second, set by init_tsc_frequency() */
+extern uint64_t tsc_frequency;
+
 void init_tsc_frequency(void);
 
 /* Given TSC ticks it will calculate and return number of nano seconds passed for it. 
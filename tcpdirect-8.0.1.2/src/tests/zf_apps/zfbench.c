@@ -0,0 +1,1019 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Xilinx, Inc. */
+/*
+ * Multi-flow throughput/latency benchmark for comparing TCPDirect, Onload
+ * and the kernel stack on equal terms.
+ *
+ * The "load" side opens N flows and sends on each at a fixed offered rate.
+ * Load is open loop: message k on a flow is due at start + k/rate whatever
+ * has happened to earlier messages, and its latency is measured from that
+ * due time rather than from when it was actually sent.  A stall on the
+ * sending side therefore counts against every message that should have
+ * been sent during the stall, instead of silently delaying the schedule
+ * (coordinated omission).  The latency from the actual send time is
+ * reported alongside as "service" time.  The "echo" side reflects every
+ * message back unchanged.
+ *
+ * Two backends are provided:
+ *
+ * - zf: TCPDirect zockets, driven by zf_reactor_perform().
+ * - kernel: non-blocking BSD sockets, busy polled.  Run it under onload(1)
+ *   to measure Onload, or as-is for the kernel stack.
+ *
+ * Both backends use the same schedule, framing and statistics.  Build with
+ * -DZFBENCH_NO_ZF to get a kernel-only binary for hosts without TCPDirect:
+ *
+ *   cc -O2 -std=gnu99 -DZFBENCH_NO_ZF zfbench.c zf_stats.c zf_timer.c \
+ *      lat_hist.c -lm -o zfbench
+ *
+ * TCP flows are separate connections to the same port.  UDP flow i uses
+ * port+i at both ends.  Latencies are one-way (half of round trip) unless
+ * -f is given.
+ */
+#ifndef ZFBENCH_NO_ZF
+#include <zf/zf.h>
+#endif
+#include "zf_utils.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "zf_stats.h"
+#include "zf_timer.h"
+
+static void usage_msg(FILE* f)
+{
+  fprintf(f, "usage:\n");
+  fprintf(f, "  zfbench [options] load <remote:port> [<local:port>]\n");
+  fprintf(f, "  zfbench [options] echo <local:port> [<remote:port>]\n");
+  fprintf(f, "\n");
+  fprintf(f, "The second address is required for UDP only.\n");
+  fprintf(f, "\n");
+  fprintf(f, "options:\n");
+  fprintf(f, "  -b backend: zf or kernel (default zf)\n");
+  fprintf(f, "  -u use UDP (default TCP)\n");
+  fprintf(f, "  -n number of concurrent flows\n");
+  fprintf(f, "  -R offered rate per flow in messages per second\n");
+  fprintf(f, "  -d measured duration in seconds\n");
+  fprintf(f, "  -r warmup duration in seconds\n");
+  fprintf(f, "  -s message size in bytes\n");
+  fprintf(f, "  -p show pth percentile\n");
+  fprintf(f, "  -f report full-round trip time stats\n");
+  fprintf(f, "  -o write results as JSON to file ('-' for stdout)\n");
+  fprintf(f, "  -H write latency histograms to files with this prefix\n");
+  fprintf(f, "\n");
+}
+
+
+static void usage_err(void)
+{
+  usage_msg(stderr);
+  exit(1);
+}
+
+
+/* Every message starts with this header.  Timestamps are TSC values on the
+ * load side and are echoed back untouched.
+ */
+struct bench_msg {
+  uint32_t flow;
+  uint32_t seq;
+  uint64_t due;
+  uint64_t sent;
+};
+
+/* Messages sent per flow per loop iteration while catching up */
+#define SEND_BATCH     32
+/* Messages buffered per flow for TCP reassembly */
+#define RX_BUF_MSGS    64
+
+
+struct flow {
+  int id;
+#ifndef ZFBENCH_NO_ZF
+  struct zfur* ur;
+  struct zfut* ut;
+  struct zft* zock;
+#endif
+  int fd;
+  bool closed;
+
+  uint64_t next_due;
+  uint64_t seq;
+  uint64_t sent;          /* measured messages sent */
+  uint64_t received;      /* measured messages received */
+  uint64_t bad;           /* malformed or misrouted messages */
+
+  char* rx_buf;
+  int rx_fill;
+  char* tx_buf;           /* unsent tail of a partially sent message */
+  int tx_off;
+  int tx_len;
+
+  struct lat_hist* lat;   /* from due time */
+  struct lat_hist* svc;   /* from actual send time */
+};
+
+
+/* Send returns the number of bytes sent, 0 if the stack can't take any
+ * more data now, or a negative error.  Recv returns the number of bytes
+ * received, 0 if nothing is available, or -1 if the flow has closed.
+ */
+struct backend {
+  const char* name;
+  void (*init)(void);
+  void (*udp_open)(struct flow* f, const struct sockaddr_in* laddr,
+                   const struct sockaddr_in* raddr);
+  void (*tcp_connect)(struct flow* flows, int n,
+                      const struct sockaddr_in* raddr);
+  void (*tcp_accept)(struct flow* flows, int n,
+                     const struct sockaddr_in* laddr);
+  int (*send)(struct flow* f, const void* buf, int len);
+  int (*recv)(struct flow* f, void* buf, int len);
+  void (*poll)(void);
+  void (*close)(struct flow* flows, int n);
+};
+
+
+struct cfg {
+  const struct backend* backend;
+  bool udp;
+  bool load;
+  bool full_rtt;
+  int n_flows;
+  int rate;
+  int duration;
+  int warmup;
+  int size;
+  float percentile;
+  const char* json_filename;
+  const char* hist_prefix;
+};
+
+
+static struct cfg cfg = {
+  .n_flows = 1,
+  .rate = 10000,
+  .duration = 10,
+  .warmup = 1,
+  .size = 32,
+  .percentile = 99,
+};
+
+/* Human-readable output; moved to stderr when JSON goes to stdout */
+static FILE* msg_out;
+
+static volatile sig_atomic_t interrupted;
+
+static void on_signal(int sig)
+{
+  interrupted = 1;
+}
+
+
+/**********************************************************************
+ * Kernel socket backend.
+ */
+
+static void kernel_init(void)
+{
+}
+
+
+static void set_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+  ZF_TEST(flags >= 0);
+  ZF_TEST(fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+
+static void kernel_udp_open(struct flow* f, const struct sockaddr_in* laddr,
+                            const struct sockaddr_in* raddr)
+{
+  int one = 1;
+  ZF_TEST((f->fd = socket(AF_INET, SOCK_DGRAM, 0)) >= 0);
+  ZF_TEST(setsockopt(f->fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                     sizeof(one)) == 0);
+  ZF_TEST(bind(f->fd, (const struct sockaddr*) laddr, sizeof(*laddr)) == 0);
+  ZF_TEST(connect(f->fd, (const struct sockaddr*) raddr,
+                  sizeof(*raddr)) == 0);
+  set_nonblocking(f->fd);
+}
+
+
+static void kernel_tcp_setup(int fd)
+{
+  int one = 1;
+  ZF_TEST(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == 0);
+  set_nonblocking(fd);
+}
+
+
+static void kernel_tcp_connect(struct flow* flows, int n,
+                               const struct sockaddr_in* raddr)
+{
+  int i;
+  for( i = 0; i < n; ++i ) {
+    ZF_TEST((flows[i].fd = socket(AF_INET, SOCK_STREAM, 0)) >= 0);
+    if( connect(flows[i].fd, (const struct sockaddr*) raddr,
+                sizeof(*raddr)) != 0 ) {
+      fprintf(stderr, "ERROR: connect failed: %s\n", strerror(errno));
+      exit(2);
+    }
+    kernel_tcp_setup(flows[i].fd);
+  }
+}
+
+
+static void kernel_tcp_accept(struct flow* flows, int n,
+                              const struct sockaddr_in* laddr)
+{
+  int one = 1;
+  int i, lfd;
+  ZF_TEST((lfd = socket(AF_INET, SOCK_STREAM, 0)) >= 0);
+  ZF_TEST(setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0);
+  ZF_TEST(bind(lfd, (const struct sockaddr*) laddr, sizeof(*laddr)) == 0);
+  ZF_TEST(listen(lfd, n) == 0);
+  for( i = 0; i < n; ++i ) {
+    while( (flows[i].fd = accept(lfd, NULL, NULL)) < 0 ) {
+      ZF_TEST(errno == EINTR);
+      if( interrupted )
+        exit(1);
+    }
+    kernel_tcp_setup(flows[i].fd);
+  }
+  close(lfd);
+}
+
+
+static int kernel_send(struct flow* f, const void* buf, int len)
+{
+  ssize_t rc = send(f->fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if( rc >= 0 )
+    return rc;
+  if( errno == EAGAIN || errno == ENOBUFS )
+    return 0;
+  return -errno;
+}
+
+
+static int kernel_recv(struct flow* f, void* buf, int len)
+{
+  ssize_t rc = recv(f->fd, buf, len, MSG_DONTWAIT);
+  if( rc > 0 )
+    return rc;
+  if( rc < 0 && (errno == EAGAIN || errno == ECONNREFUSED) )
+    return 0;
+  return -1;
+}
+
+
+static void kernel_poll(void)
+{
+}
+
+
+static void kernel_close(struct flow* flows, int n)
+{
+  int i;
+  for( i = 0; i < n; ++i )
+    close(flows[i].fd);
+}
+
+
+static const struct backend kernel_backend = {
+  .name = "kernel",
+  .init = kernel_init,
+  .udp_open = kernel_udp_open,
+  .tcp_connect = kernel_tcp_connect,
+  .tcp_accept = kernel_tcp_accept,
+  .send = kernel_send,
+  .recv = kernel_recv,
+  .poll = kernel_poll,
+  .close = kernel_close,
+};
+
+
+/**********************************************************************
+ * TCPDirect backend.
+ */
+
+#ifndef ZFBENCH_NO_ZF
+
+static struct zf_stack* zf_bench_stack;
+static struct zf_attr* zf_bench_attr;
+
+
+static void zf_bench_init(void)
+{
+  ZF_TRY(zf_init());
+  ZF_TRY(zf_attr_alloc(&zf_bench_attr));
+  ZF_TRY(zf_stack_alloc(zf_bench_attr, &zf_bench_stack));
+}
+
+
+static void zf_bench_udp_open(struct flow* f, const struct sockaddr_in* laddr,
+                              const struct sockaddr_in* raddr)
+{
+  /* zfur_addr_bind() may fill in the local port, so give it a copy. */
+  struct sockaddr_in bind_addr = *laddr;
+  ZF_TRY(zfur_alloc(&f->ur, zf_bench_stack, zf_bench_attr));
+  ZF_TRY(zfur_addr_bind(f->ur, (struct sockaddr*) &bind_addr,
+                        sizeof(bind_addr), (const struct sockaddr*) raddr,
+                        sizeof(*raddr), 0));
+  ZF_TRY(zfut_alloc(&f->ut, zf_bench_stack, (const struct sockaddr*) laddr,
+                    sizeof(*laddr), (const struct sockaddr*) raddr,
+                    sizeof(*raddr), 0, zf_bench_attr));
+}
+
+
+static void zf_bench_check_mss(struct flow* f)
+{
+  if( zft_get_mss(f->zock) < cfg.size ) {
+    fprintf(stderr, "ERROR: Connection MSS of %d is not large enough to "
+            "test with configured message size of %d\n",
+            zft_get_mss(f->zock), cfg.size);
+    exit(2);
+  }
+}
+
+
+static void zf_bench_tcp_connect(struct flow* flows, int n,
+                                 const struct sockaddr_in* raddr)
+{
+  int i;
+  /* Connects are non-blocking, so start them all and then wait. */
+  for( i = 0; i < n; ++i ) {
+    struct zft_handle* tcp_handle;
+    ZF_TRY(zft_alloc(zf_bench_stack, zf_bench_attr, &tcp_handle));
+    ZF_TRY(zft_connect(tcp_handle, (const struct sockaddr*) raddr,
+                       sizeof(*raddr), &flows[i].zock));
+  }
+  for( i = 0; i < n; ++i ) {
+    while( zft_state(flows[i].zock) == TCP_SYN_SENT )
+      zf_reactor_perform(zf_bench_stack);
+    ZF_TEST(zft_state(flows[i].zock) == TCP_ESTABLISHED);
+    zf_bench_check_mss(&flows[i]);
+  }
+}
+
+
+static void zf_bench_tcp_accept(struct flow* flows, int n,
+                                const struct sockaddr_in* laddr)
+{
+  struct zftl* listener;
+  int i, rc;
+  ZF_TRY(zftl_listen(zf_bench_stack, (const struct sockaddr*) laddr,
+                     sizeof(*laddr), zf_bench_attr, &listener));
+  for( i = 0; i < n; ++i ) {
+    do {
+      while( zf_reactor_perform(zf_bench_stack) == 0 )
+        if( interrupted )
+          exit(1);
+    } while( (rc = zftl_accept(listener, &flows[i].zock)) == -EAGAIN );
+    ZF_TRY(rc);
+    zf_bench_check_mss(&flows[i]);
+  }
+  ZF_TRY(zftl_free(listener));
+}
+
+
+static int zf_bench_send(struct flow* f, const void* buf, int len)
+{
+  int rc;
+  if( f->zock != NULL )
+    rc = zft_send_single(f->zock, buf, len, 0);
+  else
+    rc = zfut_send_single(f->ut, buf, len);
+  if( rc == -EAGAIN || rc == -ENOMEM || rc == -ENOBUFS )
+    return 0;
+  return rc;
+}
+
+
+static int zf_bench_recv(struct flow* f, void* buf, int len)
+{
+  if( f->zock != NULL ) {
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    int rc = zft_recv(f->zock, &iov, 1, 0);
+    if( rc > 0 )
+      return rc;
+    return rc == -EAGAIN ? 0 : -1;
+  }
+  else {
+    struct {
+      /* The iovec used by zfur_msg must be immediately afterwards */
+      struct zfur_msg msg;
+      struct iovec iov[1];
+    } rx;
+    int n;
+    rx.msg.iovcnt = 1;
+    zfur_zc_recv(f->ur, &rx.msg, 0);
+    if( rx.msg.iovcnt == 0 )
+      return 0;
+    n = rx.msg.iov[0].iov_len < (size_t) len ? rx.msg.iov[0].iov_len : len;
+    memcpy(buf, rx.msg.iov[0].iov_base, n);
+    zfur_zc_recv_done(f->ur, &rx.msg);
+    return n;
+  }
+}
+
+
+static void zf_bench_poll(void)
+{
+  zf_reactor_perform(zf_bench_stack);
+}
+
+
+static void zf_bench_close(struct flow* flows, int n)
+{
+  int i;
+  for( i = 0; i < n; ++i )
+    if( flows[i].zock != NULL )
+      while( zft_shutdown_tx(flows[i].zock) == -EAGAIN )
+        zf_reactor_perform(zf_bench_stack);
+  while( ! zf_stack_is_quiescent(zf_bench_stack) )
+    zf_reactor_perform(zf_bench_stack);
+  for( i = 0; i < n; ++i ) {
+    if( flows[i].zock != NULL )
+      ZF_TRY(zft_free(flows[i].zock));
+    if( flows[i].ur != NULL )
+      ZF_TRY(zfur_free(flows[i].ur));
+    if( flows[i].ut != NULL )
+      ZF_TRY(zfut_free(flows[i].ut));
+  }
+  ZF_TRY(zf_stack_free(zf_bench_stack));
+  zf_attr_free(zf_bench_attr);
+  ZF_TRY(zf_deinit());
+}
+
+
+static const struct backend zf_backend = {
+  .name = "zf",
+  .init = zf_bench_init,
+  .udp_open = zf_bench_udp_open,
+  .tcp_connect = zf_bench_tcp_connect,
+  .tcp_accept = zf_bench_tcp_accept,
+  .send = zf_bench_send,
+  .recv = zf_bench_recv,
+  .poll = zf_bench_poll,
+  .close = zf_bench_close,
+};
+
+#endif /* ZFBENCH_NO_ZF */
+
+
+static const struct backend* const backends[] = {
+#ifndef ZFBENCH_NO_ZF
+  &zf_backend,
+#endif
+  &kernel_backend,
+};
+#define N_BACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+
+/**********************************************************************
+ * Flows.
+ */
+
+static void flow_addr(struct sockaddr_in* sin, const struct addrinfo* ai,
+                      int port_offset)
+{
+  ZF_TEST(ai->ai_family == AF_INET);
+  memcpy(sin, ai->ai_addr, sizeof(*sin));
+  sin->sin_port = htons(ntohs(sin->sin_port) + port_offset);
+}
+
+
+static struct flow* flows_alloc(int n)
+{
+  struct flow* flows = calloc(n, sizeof(*flows));
+  int i;
+  ZF_TEST(flows != NULL);
+  for( i = 0; i < n; ++i ) {
+    flows[i].id = i;
+    flows[i].fd = -1;
+    ZF_TEST((flows[i].rx_buf = malloc(cfg.size * RX_BUF_MSGS)) != NULL);
+    ZF_TEST((flows[i].tx_buf = malloc(cfg.size)) != NULL);
+    if( cfg.load ) {
+      ZF_TEST((flows[i].lat = malloc(sizeof(struct lat_hist))) != NULL);
+      ZF_TEST((flows[i].svc = malloc(sizeof(struct lat_hist))) != NULL);
+      lat_hist_init(flows[i].lat);
+      lat_hist_init(flows[i].svc);
+    }
+  }
+  return flows;
+}
+
+
+static void flows_free(struct flow* flows, int n)
+{
+  int i;
+  for( i = 0; i < n; ++i ) {
+    free(flows[i].rx_buf);
+    free(flows[i].tx_buf);
+    free(flows[i].lat);
+    free(flows[i].svc);
+  }
+  free(flows);
+}
+
+
+/* Sends whatever is left of a partially sent message.  Returns true if
+ * nothing is left.
+ */
+static bool flow_flush(struct flow* f)
+{
+  const struct backend* be = cfg.backend;
+  int rc;
+  while( f->tx_off < f->tx_len ) {
+    rc = be->send(f, f->tx_buf + f->tx_off, f->tx_len - f->tx_off);
+    if( rc == 0 )
+      return false;
+    ZF_TRY(rc);
+    f->tx_off += rc;
+  }
+  return true;
+}
+
+
+/* Sends [len] bytes of [buf], keeping any unsent tail for flow_flush().
+ * Returns false if nothing could be sent.
+ */
+static bool flow_send(struct flow* f, const char* buf, int len)
+{
+  int rc = cfg.backend->send(f, buf, len);
+  if( rc == 0 )
+    return false;
+  ZF_TRY(rc);
+  if( rc < len ) {
+    ZF_TEST(! cfg.udp);
+    memcpy(f->tx_buf, buf + rc, len - rc);
+    f->tx_off = 0;
+    f->tx_len = len - rc;
+  }
+  return true;
+}
+
+
+/**********************************************************************
+ * Load side.
+ */
+
+static uint64_t period_frc;
+static uint64_t measure_start;
+static uint64_t measure_end;
+
+
+static void load_send_due(struct flow* f, char* buf, uint64_t now)
+{
+  struct bench_msg* m = (struct bench_msg*) buf;
+  int n;
+
+  for( n = 0; n < SEND_BATCH && f->next_due <= now &&
+              f->next_due < measure_end; ++n ) {
+    if( ! flow_flush(f) )
+      return;
+    m->flow = f->id;
+    m->seq = (uint32_t) f->seq;
+    m->due = f->next_due;
+    m->sent = get_frc64_time();
+    /* If the stack can't take it the message stays due, and the wait
+     * counts towards its latency.
+     */
+    if( ! flow_send(f, buf, cfg.size) )
+      return;
+    if( f->next_due >= measure_start )
+      ++f->sent;
+    ++f->seq;
+    f->next_due += period_frc;
+  }
+}
+
+
+static void load_record(struct flow* f, const struct bench_msg* m,
+                        uint64_t now)
+{
+  uint64_t lat, svc;
+
+  if( m->flow != (uint32_t) f->id || m->due > now || m->sent > now ) {
+    ++f->bad;
+    return;
+  }
+  if( m->due < measure_start )
+    return;
+  lat = frc_to_nsec(now - m->due);
+  svc = frc_to_nsec(now - m->sent);
+  lat_hist_record(f->lat, cfg.full_rtt ? lat : lat / 2);
+  lat_hist_record(f->svc, cfg.full_rtt ? svc : svc / 2);
+  ++f->received;
+}
+
+
+static void load_recv(struct flow* f)
+{
+  const struct backend* be = cfg.backend;
+  int cap = cfg.size * RX_BUF_MSGS;
+  int rc, off;
+  uint64_t now;
+
+  while( ! f->closed ) {
+    rc = be->recv(f, f->rx_buf + f->rx_fill, cfg.udp ? cap : cap - f->rx_fill);
+    if( rc == 0 )
+      return;
+    if( rc < 0 ) {
+      f->closed = true;
+      return;
+    }
+    now = get_frc64_time();
+    if( cfg.udp ) {
+      if( rc == cfg.size )
+        load_record(f, (const struct bench_msg*) f->rx_buf, now);
+      else
+        ++f->bad;
+      continue;
+    }
+    f->rx_fill += rc;
+    for( off = 0; f->rx_fill - off >= cfg.size; off += cfg.size ) {
+      struct bench_msg m;
+      memcpy(&m, f->rx_buf + off, sizeof(m));
+      load_record(f, &m, now);
+    }
+    if( off ) {
+      memmove(f->rx_buf, f->rx_buf + off, f->rx_fill - off);
+      f->rx_fill -= off;
+    }
+  }
+}
+
+
+static void load(struct flow* flows)
+{
+  const struct backend* be = cfg.backend;
+  char* buf = calloc(1, cfg.size);
+  uint64_t start, drain_end, now;
+  int i;
+
+  ZF_TEST(buf != NULL);
+  period_frc = tsc_frequency / cfg.rate;
+  ZF_TEST(period_frc > 0);
+
+  /* Stagger the flows across one period so their sends don't bunch. */
+  start = get_frc64_time() + tsc_frequency / 100;
+  for( i = 0; i < cfg.n_flows; ++i )
+    flows[i].next_due = start + period_frc * i / cfg.n_flows;
+  measure_start = start + tsc_frequency * cfg.warmup;
+  measure_end = measure_start + tsc_frequency * cfg.duration;
+  /* Give replies to the last messages a second to arrive. */
+  drain_end = measure_end + tsc_frequency;
+
+  while( ! interrupted ) {
+    bool done = true;
+    now = get_frc64_time();
+    for( i = 0; i < cfg.n_flows; ++i )
+      load_send_due(&flows[i], buf, now);
+    be->poll();
+    for( i = 0; i < cfg.n_flows; ++i ) {
+      load_recv(&flows[i]);
+      if( flows[i].received < flows[i].sent ||
+          flows[i].tx_off < flows[i].tx_len )
+        done = false;
+      if( flows[i].tx_off < flows[i].tx_len )
+        flow_flush(&flows[i]);
+    }
+    if( now >= measure_end && (done || now >= drain_end) )
+      break;
+  }
+  free(buf);
+}
+
+
+/**********************************************************************
+ * Echo side.
+ */
+
+static void echo(struct flow* flows)
+{
+  const struct backend* be = cfg.backend;
+  int cap = cfg.size * RX_BUF_MSGS;
+  int i, rc, open = cfg.n_flows;
+
+  while( ! interrupted && open > 0 ) {
+    be->poll();
+    for( i = 0; i < cfg.n_flows; ++i ) {
+      struct flow* f = &flows[i];
+      if( f->closed || ! flow_flush(f) )
+        continue;
+      /* Reflect bytes as they arrive.  Message boundaries don't matter for
+       * TCP, and each UDP datagram is one message.
+       */
+      rc = be->recv(f, f->rx_buf, cap);
+      if( rc < 0 && ! cfg.udp ) {
+        f->closed = true;
+        --open;
+        continue;
+      }
+      if( rc <= 0 )
+        continue;
+      while( ! flow_send(f, f->rx_buf, rc) ) {
+        if( cfg.udp || interrupted )
+          break;
+        be->poll();
+      }
+    }
+  }
+}
+
+
+/**********************************************************************
+ * Results.
+ */
+
+static const double json_percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+#define N_JSON_PERCENTILES \
+  (sizeof(json_percentiles) / sizeof(json_percentiles[0]))
+
+
+static void json_hist(FILE* f, const char* name, const struct lat_hist* h)
+{
+  unsigned i;
+  fprintf(f, "\"%s\": {\"n\": %"PRIu64", \"mean\": %.1f, \"stddev\": %.1f, "
+          "\"min\": %"PRIu64, name, h->n, lat_hist_mean(h),
+          lat_hist_stddev(h), lat_hist_percentile(h, 0));
+  for( i = 0; i < N_JSON_PERCENTILES; ++i )
+    fprintf(f, ", \"p%g\": %"PRIu64, json_percentiles[i],
+            lat_hist_percentile(h, json_percentiles[i]));
+  fprintf(f, ", \"max\": %"PRIu64"}", lat_hist_percentile(h, 100));
+}
+
+
+static void json_flow(FILE* f, const char* indent, int id, uint64_t sent,
+                      uint64_t received, uint64_t bad,
+                      const struct lat_hist* lat, const struct lat_hist* svc)
+{
+  fprintf(f, "%s{", indent);
+  if( id >= 0 )
+    fprintf(f, "\"flow\": %d, ", id);
+  fprintf(f, "\"sent\": %"PRIu64", \"received\": %"PRIu64", "
+          "\"lost\": %"PRIu64", \"bad\": %"PRIu64", "
+          "\"throughput_msg_per_s\": %.1f,\n%s  ", sent, received,
+          sent - received, bad, (double) received / cfg.duration, indent);
+  json_hist(f, "latency_ns", lat);
+  fprintf(f, ",\n%s  ", indent);
+  json_hist(f, "service_ns", svc);
+  fprintf(f, "}");
+}
+
+
+static void write_json(FILE* f, const struct flow* flows,
+                       const struct flow* total)
+{
+  int i;
+  fprintf(f, "{\n");
+  fprintf(f, "  \"backend\": \"%s\", \"protocol\": \"%s\", "
+          "\"latency\": \"%s\",\n", cfg.backend->name,
+          cfg.udp ? "udp" : "tcp", cfg.full_rtt ? "round_trip" : "one_way");
+  fprintf(f, "  \"flows\": %d, \"rate_per_flow\": %d, \"size\": %d, "
+          "\"duration_s\": %d, \"warmup_s\": %d,\n", cfg.n_flows, cfg.rate,
+          cfg.size, cfg.duration, cfg.warmup);
+  fprintf(f, "  \"total\":\n");
+  json_flow(f, "  ", -1, total->sent, total->received, total->bad,
+            total->lat, total->svc);
+  fprintf(f, ",\n  \"per_flow\": [\n");
+  for( i = 0; i < cfg.n_flows; ++i ) {
+    json_flow(f, "    ", i, flows[i].sent, flows[i].received, flows[i].bad,
+              flows[i].lat, flows[i].svc);
+    fprintf(f, "%s\n", i + 1 < cfg.n_flows ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+
+static void write_hist(const char* suffix, const struct lat_hist* h)
+{
+  char name[strlen(cfg.hist_prefix) + strlen(suffix) + 2];
+  FILE* f;
+  sprintf(name, "%s.%s", cfg.hist_prefix, suffix);
+  if( (f = fopen(name, "w")) == NULL ) {
+    fprintf(stderr, "ERROR: Could not open output file '%s'\n", name);
+    exit(2);
+  }
+  ZF_TEST(lat_hist_write(h, f) == 0);
+  fclose(f);
+}
+
+
+static void print_row(const char* label, const struct flow* f)
+{
+  struct stats s;
+  get_hist_stats(&s, f->lat, cfg.percentile);
+  fprintf(msg_out, "\t%s\t%"PRIu64"\t%"PRIu64"\t%"PRIu64"\t%"PRIu64
+          "\t%"PRIu64"\t%"PRIu64"\t%"PRIu64"\t%"PRIu64"\n", label, f->sent,
+          f->sent - f->received, s.mean, s.min, s.median, s.max,
+          s.percentile, s.stddev);
+}
+
+
+static void report(const struct flow* flows)
+{
+  struct flow total = { .id = -1 };
+  struct lat_hist lat, svc;
+  char label[16];
+  int i;
+
+  lat_hist_init(&lat);
+  lat_hist_init(&svc);
+  total.lat = &lat;
+  total.svc = &svc;
+  for( i = 0; i < cfg.n_flows; ++i ) {
+    total.sent += flows[i].sent;
+    total.received += flows[i].received;
+    total.bad += flows[i].bad;
+    lat_hist_merge(&lat, flows[i].lat);
+    lat_hist_merge(&svc, flows[i].svc);
+  }
+
+  fprintf(msg_out, "Reporting %s latency from due time in nsec for %d %s "
+          "flows at %d msg/s each\n", cfg.full_rtt ? "round-trip" : "one-way",
+          cfg.n_flows, cfg.udp ? "UDP" : "TCP", cfg.rate);
+  fprintf(msg_out,
+          "#\tflow\tsent\tlost\tmean\tmin\tmedian\tmax\t%%ile\tstddev\n");
+  if( cfg.n_flows > 1 )
+    for( i = 0; i < cfg.n_flows; ++i ) {
+      snprintf(label, sizeof(label), "%d", i);
+      print_row(label, &flows[i]);
+    }
+  print_row("all", &total);
+  if( total.bad )
+    fprintf(msg_out, "WARNING: %"PRIu64" malformed messages\n", total.bad);
+
+  if( cfg.json_filename != NULL ) {
+    FILE* f = strcmp(cfg.json_filename, "-") == 0 ?
+      stdout : fopen(cfg.json_filename, "w");
+    if( f == NULL ) {
+      fprintf(stderr, "ERROR: Could not open output file '%s'\n",
+              cfg.json_filename);
+      exit(2);
+    }
+    write_json(f, flows, &total);
+    if( f != stdout )
+      fclose(f);
+  }
+
+  if( cfg.hist_prefix != NULL ) {
+    for( i = 0; i < cfg.n_flows; ++i ) {
+      snprintf(label, sizeof(label), "%d", i);
+      write_hist(label, flows[i].lat);
+    }
+    write_hist("all", &lat);
+  }
+}
+
+
+static const struct backend* find_backend(const char* name)
+{
+  unsigned i;
+  for( i = 0; i < N_BACKENDS; ++i )
+    if( ! strcmp(backends[i]->name, name) )
+      return backends[i];
+  fprintf(stderr, "ERROR: unknown or unavailable backend '%s'\n", name);
+  exit(1);
+}
+
+
+static void lookup(const char* hostport, struct addrinfo** ai)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  if( getaddrinfo_hostport(hostport, &hints, ai) != 0 ) {
+    fprintf(stderr, "ERROR: failed to lookup address '%s'\n", hostport);
+    exit(2);
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  struct addrinfo *ai_first, *ai_second = NULL;
+  struct sockaddr_in laddr, raddr;
+  struct flow* flows;
+  int c, i;
+
+  cfg.backend = backends[0];
+  while( (c = getopt(argc, argv, "b:un:R:d:r:s:p:fo:H:")) != -1 )
+    switch( c ) {
+    case 'b':
+      cfg.backend = find_backend(optarg);
+      break;
+    case 'u':
+      cfg.udp = true;
+      break;
+    case 'n':
+      cfg.n_flows = atoi(optarg);
+      break;
+    case 'R':
+      cfg.rate = atoi(optarg);
+      break;
+    case 'd':
+      cfg.duration = atoi(optarg);
+      break;
+    case 'r':
+      cfg.warmup = atoi(optarg);
+      break;
+    case 's':
+      cfg.size = atoi(optarg);
+      break;
+    case 'p':
+      cfg.percentile = atof(optarg);
+      break;
+    case 'f':
+      cfg.full_rtt = true;
+      break;
+    case 'o':
+      cfg.json_filename = strdup(optarg);
+      break;
+    case 'H':
+      cfg.hist_prefix = strdup(optarg);
+      break;
+    case '?':
+      exit(1);
+    default:
+      ZF_TEST(0);
+    }
+
+  argc -= optind;
+  argv += optind;
+  if( argc != (cfg.udp ? 3 : 2) )
+    usage_err();
+  if( ! strcmp(argv[0], "load") )
+    cfg.load = true;
+  else if( strcmp(argv[0], "echo") )
+    usage_err();
+  if( cfg.n_flows <= 0 || cfg.rate <= 0 || cfg.duration <= 0 ||
+      cfg.warmup < 0 || cfg.size < (int) sizeof(struct bench_msg) ) {
+    fprintf(stderr, "ERROR: -n, -R and -d must be positive and -s at "
+            "least %zu\n", sizeof(struct bench_msg));
+    exit(1);
+  }
+
+  lookup(argv[1], &ai_first);
+  if( cfg.udp )
+    lookup(argv[2], &ai_second);
+
+  msg_out = cfg.json_filename != NULL && ! strcmp(cfg.json_filename, "-") ?
+    stderr : stdout;
+  init_tsc_frequency();
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  cfg.backend->init();
+  flows = flows_alloc(cfg.n_flows);
+
+  if( cfg.udp ) {
+    /* The first address is the remote one for load and the local one
+     * for echo.
+     */
+    for( i = 0; i < cfg.n_flows; ++i ) {
+      flow_addr(&laddr, cfg.load ? ai_second : ai_first, i);
+      flow_addr(&raddr, cfg.load ? ai_first : ai_second, i);
+      cfg.backend->udp_open(&flows[i], &laddr, &raddr);
+    }
+  }
+  else if( cfg.load ) {
+    flow_addr(&raddr, ai_first, 0);
+    cfg.backend->tcp_connect(flows, cfg.n_flows, &raddr);
+  }
+  else {
+    flow_addr(&laddr, ai_first, 0);
+    fprintf(msg_out, "Waiting for %d incoming connections\n", cfg.n_flows);
+    cfg.backend->tcp_accept(flows, cfg.n_flows, &laddr);
+  }
+  fprintf(msg_out, "%d %s flows open using %s backend\n", cfg.n_flows,
+          cfg.udp ? "UDP" : "TCP", cfg.backend->name);
+  fflush(msg_out);
+
+  if( cfg.load ) {
+    load(flows);
+    report(flows);
+  }
+  else {
+    echo(flows);
+  }
+
+  cfg.backend->close(flows, cfg.n_flows);
+  flows_free(flows, cfg.n_flows);
+  freeaddrinfo(ai_first);
+  if( ai_second != NULL )
+    freeaddrinfo(ai_second);
+  return 0;
+}
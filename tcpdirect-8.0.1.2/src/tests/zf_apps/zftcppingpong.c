@@ -36,6 +36,8 @@ static void usage_msg(FILE* f)
   fprintf(f, "  -p show pth percentile\n");
   fprintf(f, "  -f report full-round trip time stats\n");
   fprintf(f, "  -w write raw data to file\n");
+  fprintf(f, "  -I report stats every interval in milliseconds\n");
+  fprintf(f, "  -H write latency histogram to file\n");
   fprintf(f, "  -R read access all received data\n");
   fprintf(f, "\n");
 }
@@ -60,6 +62,9 @@ struct cfg {
   int itercount;
   int warmups;
   uint64_t* results;
+  struct lat_hist_live* hist;
+  int interval_ms;
+  const char* hist_filename;
   float percentile;
   const char* raw_filename;
   bool full_rtt;
@@ -81,10 +86,27 @@ static struct cfg cfg = {
   .percentile = 99,
   .results = NULL,
   .raw_filename = NULL,
+  .hist_filename = NULL,
 };
 
 static struct zf_muxer_set* muxer;
 
+/* Warm-ups are not recorded.  The stats come from a fixed-size histogram,
+ * so raw samples are only kept when they are to be written to a file.
+ */
+static inline void record_rtt(int i, uint64_t frc)
+{
+  uint64_t nsec;
+
+  if( cfg.results != NULL )
+    cfg.results[i] = frc;
+  if( i >= cfg.warmups ) {
+    nsec = frc_to_nsec(frc);
+    lat_hist_live_record(cfg.hist, cfg.full_rtt ? nsec : nsec / 2);
+  }
+}
+
+
 
 static void ping_pongs(struct zf_stack* stack, struct zft* zock)
 {
@@ -135,8 +157,7 @@ static void ping_pongs(struct zf_stack* stack, struct zft* zock)
 
     if( cfg.ping ) {
       end = get_frc64_time();
-      cfg.results[i] = end - begin;
-      i++;
+      record_rtt(i++, end - begin);
     }
 
     if( sends_left ) {
@@ -193,8 +214,7 @@ static void muxer_ping_pongs(struct zf_stack* stack, struct zft* zock)
       zft_zc_recv(zock, &msg.msg, 0);
       if( cfg.ping ) {
         end = get_frc64_time();
-        cfg.results[i] = end - begin;
-        i++;
+        record_rtt(i++, end - begin);
       }
       ZF_TEST(msg.msg.iovcnt == 1);
       ZF_TEST(msg.iov[0].iov_len <= rx_bytes_left);
@@ -308,8 +328,7 @@ static void pftf_ping_pong(struct zf_stack *stack, struct zft *zock)
         } while ( msg.msg.pkts_left != 0 );
         if( cfg.ping ) {
           end = get_frc64_time();
-          cfg.results[i] = end - begin;
-          i++;
+          record_rtt(i++, end - begin);
         }
     }
     else if (ev.events & ZF_EPOLLIN_OVERLAPPED) {
@@ -337,8 +356,7 @@ static void pftf_ping_pong(struct zf_stack *stack, struct zft *zock)
 
       if( cfg.ping ) {
         /* only accept timing measurement if verification passed */
-        cfg.results[i] = end - begin;
-        i++;
+        record_rtt(i++, end - begin);
       }
 
       rx_bytes_left -= msg.iov[0].iov_len;
@@ -410,13 +428,18 @@ static void pinger(struct zf_stack* stack, struct zft* zock,
   init_tsc_frequency();
   /* Touch the values will inialising to minimise page faults. */
   int i;
-  for( i = 0; i < cfg.itercount; i++)
-     cfg.results[i] = 0;
-   
+  if( cfg.results != NULL )
+    for( i = 0; i < cfg.itercount; i++)
+       cfg.results[i] = 0;
+  lat_hist_live_init(cfg.hist, cfg.interval_ms, cfg.percentile, 1, "nsec",
+                     stdout);
+
   ping_pongs_fn(stack, zock);
+  lat_hist_live_finish(cfg.hist);
   /* convert frc to nsec for stats reporting */
-  for(i = 0; i < cfg.itercount; i++)
-    cfg.results[i] = frc_to_nsec(cfg.results[i]);
+  if( cfg.results != NULL )
+    for(i = 0; i < cfg.itercount; i++)
+      cfg.results[i] = frc_to_nsec(cfg.results[i]);
 }
 
 
@@ -430,7 +453,7 @@ static void ponger(struct zf_stack* stack, struct zft* zock,
 int main(int argc, char* argv[])
 {
   int c;
-  while( (c = getopt(argc, argv, "s:i:r:c:mtfp:w:R")) != -1 )
+  while( (c = getopt(argc, argv, "s:i:r:c:mtfp:w:RI:H:")) != -1 )
     switch (c) {
     case 's':
       cfg.size = atoi(optarg);
@@ -460,6 +483,12 @@ int main(int argc, char* argv[])
     case 'w':
       cfg.raw_filename = strdup(optarg);
       break;
+    case 'I':
+      cfg.interval_ms = atoi(optarg);
+      break;
+    case 'H':
+      cfg.hist_filename = strdup(optarg);
+      break;
     case 'R':
       cfg.touch_rx = true;
       break;
@@ -487,7 +516,11 @@ int main(int argc, char* argv[])
   else
     usage_err();
 
-  cfg.results = (uint64_t*) malloc(cfg.itercount * sizeof(uint64_t));
+  if( cfg.ping ) {
+    if( cfg.raw_filename != NULL )
+      cfg.results = (uint64_t*) malloc(cfg.itercount * sizeof(uint64_t));
+    cfg.hist = malloc(sizeof(*cfg.hist));
+  }
 
   struct addrinfo* ai;
   if( getaddrinfo_hostport(argv[1], NULL, &ai) != 0 ) {
@@ -568,9 +601,15 @@ int main(int argc, char* argv[])
       write_raw_array(cfg.raw_filename, cfg.results + cfg.warmups,
                       cfg.itercount - cfg.warmups);
 
+    if( cfg.hist_filename != NULL ) {
+      FILE* f = fopen(cfg.hist_filename, "w");
+      ZF_TEST(f != NULL);
+      ZF_TEST(lat_hist_write(&cfg.hist->total, f) == 0);
+      fclose(f);
+    }
+
     struct stats s;
-    get_stats(&s, (!cfg.full_rtt), cfg.results + cfg.warmups,
-              cfg.itercount - cfg.warmups, cfg.percentile);
+    get_hist_stats(&s, &cfg.hist->total, cfg.percentile);
 
     if( cfg.raw_filename == NULL ) {
       printf("mean round-trip time: %0.3f usec\n", ((float)s.mean*2)/1000);
@@ -602,5 +641,6 @@ int main(int argc, char* argv[])
   ZF_TRY(zf_stack_free(stack));
   ZF_TRY(zf_deinit());
   free(cfg.results);
+  free(cfg.hist);
   return 0;
 }